@@ -11,6 +11,7 @@ namespace SharpVideo.MultiPlaneExample
     {
         private const int Width = 1920;
         private const int Height = 1080;
+        private const int FrameRate = 30;
         private const int FrameCount = 300; // 10 seconds at 30fps
 
         private static readonly ILoggerFactory LoggerFactory = Microsoft.Extensions.Logging.LoggerFactory
@@ -105,26 +106,6 @@ namespace SharpVideo.MultiPlaneExample
                 }
             }
 
-            // Allocate buffers for overlay plane (NV12)
-            var overlayBufferCount = 3;
-            var overlayBuffers = new List<SharedDmaBuffer>();
-            for (int i = 0; i < overlayBufferCount; i++)
-            {
-                var buffer = bufferManager.AllocateBuffer(Width, Height, KnownPixelFormats.DRM_FORMAT_NV12);
-                buffer.MapBuffer();
-                if (buffer.MapStatus == MapStatus.FailedToMap)
-                {
-                    Logger.LogError("Failed to map overlay buffer {Index}", i);
-                    return;
-                }
-
-                // Fill with NV12 color bars test pattern
-                TestPattern.FillNV12(buffer.DmaBuffer.GetMappedSpan(), Width, Height);
-                buffer.DmaBuffer.SyncMap();
-
-                overlayBuffers.Add(buffer);
-            }
-
             // Fill primary plane with ARGB8888 test pattern (semi-transparent)
             var dmaPresenter = presenter.AsDmaBufferPresenter();
             if (dmaPresenter == null)
@@ -143,40 +124,20 @@ namespace SharpVideo.MultiPlaneExample
                 return;
             }
 
-            Logger.LogInformation("Starting frame presentation ({FrameCount} frames)...", FrameCount);
-
-            var currentOverlayIndex = 0;
-
-            for (int frame = 0; frame < FrameCount; frame++)
-            {
-                // Update overlay plane - cycle through buffers to demonstrate buffer management
-                var currentBuffer = overlayBuffers[currentOverlayIndex];
-                presenter.OverlayPlanePresenter.SetOverlayPlaneBuffer(currentBuffer);
-
-                // Get completed buffers
-                var completed = presenter.OverlayPlanePresenter.GetPresentedOverlayBuffers();
-
-                // Simulate frame timing (30 fps = ~33ms per frame)
-                Thread.Sleep(33);
-
-                // Cycle to next buffer
-                currentOverlayIndex = (currentOverlayIndex + 1) % overlayBufferCount;
-
-                if (frame % 30 == 0)
-                {
-                    Logger.LogInformation("Presented {Frame} frames, completed buffers: {Count}",
-                        frame, completed.Length);
-                }
-            }
+            // Animated NV12 color bars with the frame counter burned in, from a pool of overlay buffers
+            var source = SyntheticFrameSource.CreateForOverlayPlane(
+                presenter,
+                bufferManager,
+                Width,
+                Height,
+                KnownPixelFormats.DRM_FORMAT_NV12,
+                Logger);
 
-            Logger.LogInformation("Frame presentation complete");
+            Logger.LogInformation("Starting frame presentation ({FrameCount} frames)...", FrameCount);
+            source.Run(FrameRate, FrameCount);
 
-            // Cleanup overlay buffers
-            foreach (var buffer in overlayBuffers)
-            {
-                buffer.DmaBuffer.UnmapBuffer();
-                buffer.Dispose();
-            }
+            Logger.LogInformation("Frame presentation complete: {Presented} presented, {Late} late, {Dropped} dropped",
+                source.FramesPresented, source.FramesLate, source.FramesDropped);
         }
     }
 }
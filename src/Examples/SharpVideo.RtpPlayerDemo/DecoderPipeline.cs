@@ -1,8 +1,10 @@
-using System.Collections.Concurrent;
 using System.Diagnostics;
 using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
 using SharpVideo.Drm;
+using SharpVideo.H264;
+using SharpVideo.RtpPlayerDemo.Recording;
+using SharpVideo.RtpPlayerDemo.Rtp;
 using SharpVideo.Utils;
 using SharpVideo.V4L2Decoding.Services;
 using SharpVideo.V4L2Decoding.NaluSources;
@@ -10,37 +12,50 @@ using SharpVideo.V4L2Decoding.NaluSources;
 namespace SharpVideo.RtpPlayerDemo;
 
 /// <summary>
-/// Manages H.264 decoding pipeline from RTP receiver to DRM display
+/// Manages H.264 decoding pipeline from RTP receiver to DRM display.
+/// Reassembled frames go from the receive thread through a lock-free single producer ring straight to the
+/// decoder thread, which sleeps on an eventfd while the ring is empty
 /// </summary>
 [SupportedOSPlatform("linux")]
 public class DecoderPipeline : IAsyncDisposable
 {
-    private readonly RtpReceiverService _rtpReceiver;
+    private const int FrameRingCapacity = 16;
+    private const int DisplayRingCapacity = 4;
+
+    private readonly IEncodedFrameSource _frameSource;
     private readonly H264V4L2StatelessDecoder _decoder;
     private readonly DrmPresenter _presenter;
     private readonly ILogger<DecoderPipeline> _logger;
-    private readonly BlockingCollection<SharedDmaBuffer> _buffersToPresent = new(boundedCapacity: 3);
+    private readonly Fmp4Recorder? _recorder;
+    private readonly H264RtpStreamer? _restreamer;
+    private readonly H264SpsRewriter? _spsRewriter;
+    private readonly SpscRing<SharedDmaBuffer> _buffersToPresent = new(DisplayRingCapacity);
     private readonly CancellationTokenSource _cts = new();
-    private readonly RtpNaluSource _naluSource;
+    private readonly SpscRing<INaluFrame> _frames;
 
-    private Task? _rtpFeedTask;
     private Task? _displayTask;
     private readonly Stopwatch _decodeStopwatch = new();
     private readonly Stopwatch _presentStopwatch = new();
 
     public DecoderPipeline(
-        RtpReceiverService rtpReceiver,
+        IEncodedFrameSource frameSource,
         H264V4L2StatelessDecoder decoder,
         DrmPresenter presenter,
-        ILoggerFactory loggerFactory)
+        ILoggerFactory loggerFactory,
+        Fmp4Recorder? recorder = null,
+        H264RtpStreamer? restreamer = null,
+        H264SpsRewriter? spsRewriter = null)
     {
-        _rtpReceiver = rtpReceiver;
+        _frameSource = frameSource;
         _decoder = decoder;
         _presenter = presenter;
+        _recorder = recorder;
+        _restreamer = restreamer;
+        _spsRewriter = spsRewriter;
         _logger = loggerFactory.CreateLogger<DecoderPipeline>();
 
-        // Create RTP NALU source with bounded queue for low latency
-        _naluSource = new RtpNaluSource(loggerFactory.CreateLogger<RtpNaluSource>(), queueCapacity: 30);
+        // Few frames only: a decoder that falls behind should drop frames rather than add latency
+        _frames = new SpscRing<INaluFrame>(FrameRingCapacity);
 
         Statistics = new PlayerStatistics();
     }
@@ -53,30 +68,27 @@ public class DecoderPipeline : IAsyncDisposable
     public void Initialize()
     {
         _decoder.InitializeDecoder(OnBufferDecoded);
+        _decoder.ReferenceLost += OnDecoderReferenceLost;
         _logger.LogInformation("Decoder pipeline initialized");
     }
 
     /// <summary>
     /// Start decoding and display tasks
     /// </summary>
-    public async Task StartAsync()
+    public Task StartAsync()
     {
         _decodeStopwatch.Start();
         _presentStopwatch.Start();
 
-        // Start NALU source
-        await _naluSource.StartAsync(_cts.Token);
-
-        // Start decoder with NALU source
-        _decoder.StartDecoding(_naluSource);
-
-        // Start RTP feed task to push NALUs from RTP receiver to source
-        _rtpFeedTask = Task.Run(() => RtpFeedRoutine(_cts.Token));
+        // Start decoder on the frame ring, then let the receive thread push to it
+        _decoder.StartDecoding(_frames);
+        _frameSource.SetFrameConsumer(PushFrame);
 
         // Start display task
         _displayTask = Task.Run(() => DisplayRoutine(_cts.Token));
 
         _logger.LogInformation("Decoder pipeline started");
+        return Task.CompletedTask;
     }
 
     /// <summary>
@@ -88,12 +100,9 @@ public class DecoderPipeline : IAsyncDisposable
 
         _cts.Cancel();
 
-        // Stop RTP feed
-        if (_rtpFeedTask != null)
-            await _rtpFeedTask;
-
-        // Stop NALU source
-        await _naluSource.StopAsync();
+        // Stop feeding frames, the decoder finishes the queued ones
+        _frameSource.SetFrameConsumer(null);
+        _frames.Complete();
 
         // Stop decoder
         await _decoder.StopDecodingAsync();
@@ -111,18 +120,30 @@ public class DecoderPipeline : IAsyncDisposable
         _logger.LogInformation("Decoder pipeline stopped");
     }
 
+    private void OnDecoderReferenceLost()
+    {
+        _logger.LogWarning("Decoder lost a reference picture, requesting key frame");
+        _frameSource.RequestKeyFrame();
+    }
+
     private void OnBufferDecoded(SharedDmaBuffer buffer)
     {
         Statistics.IncrementDecodedFrames();
+        Statistics.CaptureLatency = _decoder.Statistics.CaptureLatency;
 
-        // Try to add without blocking - if queue is full, drop oldest frame
-        if (!_buffersToPresent.TryAdd(buffer, 0))
+        // Try to add without blocking - if queue is full, wait for the display thread
+        if (!_buffersToPresent.TryPush(buffer))
         {
             if (_logger.IsEnabled(LogLevel.Debug))
             {
                 _logger.LogDebug("Display queue full, frame may be delayed");
             }
-            _buffersToPresent.Add(buffer); // Block until space available
+
+            // Block until space available, only fails once the pipeline stops
+            if (!_buffersToPresent.TryPush(buffer, Timeout.Infinite, _cts.Token))
+            {
+                _logger.LogDebug("Pipeline stopping, decoded frame not presented");
+            }
         }
 
         if (_logger.IsEnabled(LogLevel.Trace))
@@ -132,128 +153,59 @@ public class DecoderPipeline : IAsyncDisposable
     }
 
     /// <summary>
-    /// Feeds NAL units from RTP receiver to NALU source (minimal latency path)
+    /// Called on the receive thread for every frame of the primary stream
     /// </summary>
-    private void RtpFeedRoutine(CancellationToken cancellationToken)
+    private bool PushFrame(EncodedFrame frame)
     {
-        _logger.LogInformation("RTP feed thread started");
+        if (_spsRewriter != null)
+        {
+            RewriteParameterSets(frame);
+        }
 
-        try
+        // Recorded before the decoder owns the frame, also when the decoder has to drop it
+        _recorder?.Write(frame);
+        _restreamer?.SendFrame(frame);
+
+        if (_frames.TryPush(frame))
         {
-            while (!cancellationToken.IsCancellationRequested)
+            if (_logger.IsEnabled(LogLevel.Trace))
             {
-                if (_rtpReceiver.TryGetNalUnit(out var frameData, cancellationToken))
-                {
-                    // RTP receiver returns a complete frame with multiple NALUs,
-                    // each prefixed with Annex-B start code (00 00 00 01)
-                    // Split frame into individual NALUs and push each one
-                    SplitAndPushNalus(frameData);
-                }
+                _logger.LogTrace("Queued frame: {Size} bytes, {Count} NALUs", frame.Length, frame.NalUnitCount);
             }
+
+            return true;
         }
-        catch (OperationCanceledException)
-        {
-            _logger.LogInformation("RTP feed routine cancelled");
-        }
-        catch (Exception ex)
+
+        if (_logger.IsEnabled(LogLevel.Debug))
         {
-            _logger.LogError(ex, "Error in RTP feed routine");
+            _logger.LogDebug("Decoder frame ring full, dropping frame {Timestamp}", frame.Timestamp);
         }
 
-        _logger.LogInformation("RTP feed thread stopped");
+        return false;
     }
 
     /// <summary>
-    /// Split Annex-B formatted frame into individual NALUs and push to source
+    /// Lets the SPS rewriter look at the slices and replaces in-band SPS, so the recording, the restream and the
+    /// decoder all see the rewritten VUI
     /// </summary>
-    private void SplitAndPushNalus(byte[] frameData)
+    private void RewriteParameterSets(EncodedFrame frame)
     {
-        if (frameData == null || frameData.Length == 0)
+        for (int i = 0; i < frame.NalUnitCount; i++)
         {
-            return;
-        }
-
-        int nalusFound = 0;
-        int pos = 0;
-
-        if (_logger.IsEnabled(LogLevel.Trace))
-        {
-            _logger.LogTrace("Splitting frame data: {Size} bytes", frameData.Length);
-        }
-
-        while (pos < frameData.Length)
-        {
-            // Find start code
-            int startCodeLength = 0;
-            if (pos + 4 <= frameData.Length &&
-                frameData[pos] == 0 && frameData[pos + 1] == 0 &&
-                frameData[pos + 2] == 0 && frameData[pos + 3] == 1)
-            {
-                startCodeLength = 4;
-            }
-            else if (pos + 3 <= frameData.Length &&
-                     frameData[pos] == 0 && frameData[pos + 1] == 0 && frameData[pos + 2] == 1)
+            var nalUnit = frame.GetNalUnit(i).Slice(4);
+            if (nalUnit.Length == 0)
             {
-                startCodeLength = 3;
-            }
-            else
-            {
-                // No start code found, skip this byte
-                pos++;
                 continue;
             }
 
-            // Find next start code to determine NALU length
-            int nextPos = pos + startCodeLength;
-            int naluEnd = frameData.Length;
-
-            for (int i = nextPos; i < frameData.Length - 2; i++)
+            if ((NalUnitType)(nalUnit[0] & 0x1f) != NalUnitType.SPS_NUT)
             {
-                if ((i + 3 < frameData.Length &&
-                     frameData[i] == 0 && frameData[i + 1] == 0 && frameData[i + 2] == 0 && frameData[i + 3] == 1) ||
-                    (i + 2 < frameData.Length &&
-                     frameData[i] == 0 && frameData[i + 1] == 0 && frameData[i + 2] == 1))
-                {
-                    naluEnd = i;
-                    break;
-                }
+                _spsRewriter!.ObserveNalUnit(nalUnit);
             }
-
-            // Extract NALU (including start code)
-            int naluLength = naluEnd - pos;
-            if (naluLength > startCodeLength)
+            else if (_spsRewriter!.TryRewrite(nalUnit, out var rewritten))
             {
-                var nalu = frameData.AsSpan(pos, naluLength);
-
-                // Get NALU type for logging (skip start code to read NAL header)
-                byte nalHeader = frameData[pos + startCodeLength];
-                int nalType = nalHeader & 0x1F;
-
-                if (_logger.IsEnabled(LogLevel.Trace))
-                {
-                    _logger.LogTrace("Found NALU: type={Type}, size={Size} bytes", nalType, naluLength);
-                }
-
-                // Push NALU with existing start code
-                if (_naluSource.PushNalu(nalu, ensureStartCode: false))
-                {
-                    nalusFound++;
-                }
-                else
-                {
-                    if (_logger.IsEnabled(LogLevel.Warning))
-                    {
-                        _logger.LogWarning("Failed to push NALU type {Type}, queue full", nalType);
-                    }
-                }
+                frame.ReplaceNalUnit(i, rewritten);
             }
-
-            pos = naluEnd;
-        }
-
-        if (_logger.IsEnabled(LogLevel.Debug) && nalusFound > 0)
-        {
-            _logger.LogDebug("Split frame into {Count} NALUs", nalusFound);
         }
     }
 
@@ -265,12 +217,7 @@ public class DecoderPipeline : IAsyncDisposable
         {
             while (!cancellationToken.IsCancellationRequested)
             {
-                SharedDmaBuffer buffer;
-                try
-                {
-                    buffer = _buffersToPresent.Take(cancellationToken);
-                }
-                catch (OperationCanceledException)
+                if (!_buffersToPresent.TryPop(out var buffer, Timeout.Infinite, cancellationToken))
                 {
                     break;
                 }
@@ -305,7 +252,7 @@ public class DecoderPipeline : IAsyncDisposable
     public async ValueTask DisposeAsync()
     {
         await StopAsync();
-        await _naluSource.DisposeAsync();
+        _frames.Dispose();
         _cts.Dispose();
         _buffersToPresent.Dispose();
     }
@@ -0,0 +1,26 @@
+using SharpVideo.RtpPlayerDemo.Rtp;
+
+namespace SharpVideo.RtpPlayerDemo;
+
+/// <summary>
+/// Source of reassembled encoded frames for a decoder pipeline
+/// </summary>
+public interface IEncodedFrameSource
+{
+    /// <summary>
+    /// Try to get the next frame, waiting up to 100 ms. The caller owns the frame and must dispose it.
+    /// </summary>
+    bool TryGetFrame(out EncodedFrame frame, CancellationToken cancellationToken);
+
+    /// <summary>
+    /// Deliver frames on the receive thread straight to <paramref name="consumer"/> instead of queueing them for
+    /// <see cref="TryGetFrame"/>, null restores queueing. The consumer owns a frame it returns true for; frames it
+    /// returns false for are dropped. Calls never overlap, so the consumer may push to a single producer queue.
+    /// </summary>
+    void SetFrameConsumer(Func<EncodedFrame, bool>? consumer);
+
+    /// <summary>
+    /// Ask the sender for a key frame, e.g. after the decoder lost a reference picture
+    /// </summary>
+    void RequestKeyFrame();
+}
@@ -52,8 +52,17 @@ public class OsdRenderer
 
         // RTP Stream Info
         Hexa.NET.ImGui.ImGui.SeparatorText("RTP Stream");
+        Hexa.NET.ImGui.ImGui.Text($"Streams: {_rtpReceiver.Streams.Count} (primary #{_rtpReceiver.PrimaryStream?.Index})");
         Hexa.NET.ImGui.ImGui.Text($"Received Frames: {_rtpReceiver.ReceivedFramesCount}");
         Hexa.NET.ImGui.ImGui.Text($"Dropped (RTP): {_rtpReceiver.DroppedFramesCount}");
+        Hexa.NET.ImGui.ImGui.Text($"Damaged Frames: {_rtpReceiver.DamagedFramesCount}");
+
+        var reception = _rtpReceiver.ReceptionStatistics;
+        Hexa.NET.ImGui.ImGui.Text($"Packets: {reception.PacketsReceived} received, {reception.PacketsLost} lost");
+        Hexa.NET.ImGui.ImGui.Text($"Reordered: {reception.PacketsReordered}, Late: {reception.PacketsLate}");
+        Hexa.NET.ImGui.ImGui.Text($"Jitter: {reception.JitterTime.TotalMilliseconds:F2} ms");
+        Hexa.NET.ImGui.ImGui.Text($"NACKs: {_rtpReceiver.NacksSentCount}, Retransmitted: {_rtpReceiver.RetransmittedPacketsCount}, FEC: {_rtpReceiver.FecRecoveredPacketsCount}");
+        Hexa.NET.ImGui.ImGui.Text($"Key Frame Requests: {_rtpReceiver.KeyFrameRequestsCount}");
         
         Hexa.NET.ImGui.ImGui.Spacing();
         
@@ -63,6 +72,10 @@ public class OsdRenderer
         Hexa.NET.ImGui.ImGui.Text($"Decode FPS (current): {_statistics.CurrentDecodeFps:F2}");
         Hexa.NET.ImGui.ImGui.Text($"Decode FPS (average): {_statistics.AverageDecodeFps:F2}");
         Hexa.NET.ImGui.ImGui.Text($"Avg Decode Time: {_statistics.AverageDecodeTimeMs:F2} ms/frame");
+        if (_statistics.CaptureLatency != TimeSpan.Zero)
+        {
+            Hexa.NET.ImGui.ImGui.Text($"Capture to Decode: {_statistics.CaptureLatency.TotalMilliseconds:F1} ms");
+        }
         
         Hexa.NET.ImGui.ImGui.Spacing();
         
@@ -0,0 +1,237 @@
+using System.Globalization;
+using System.Net;
+using SharpVideo.RtpPlayerDemo.Rtp;
+using SharpVideo.RtpPlayerDemo.Rtsp;
+using SharpVideo.Srtp;
+
+namespace SharpVideo.RtpPlayerDemo;
+
+/// <summary>
+/// Command line options of the player
+/// </summary>
+/// <remarks>
+/// <c>--capture &lt;file.pcap&gt;</c> records the received RTP, <c>--replay &lt;file.pcap&gt;</c> plays a capture into
+/// the receiver over loopback instead of waiting for a sender. The replay is shaped with <c>--replay-speed &lt;x&gt;</c>
+/// (0 = as fast as possible), <c>--replay-loss &lt;p&gt;</c>, <c>--replay-reorder &lt;p&gt;</c> and <c>--replay-seed &lt;n&gt;</c>.
+/// <c>--srtp "&lt;crypto attribute&gt;"</c> or <c>--srtp-key-file &lt;file&gt;</c> require SRTP with the sender's SDES keys,
+/// e.g. <c>--srtp "AES_CM_128_HMAC_SHA1_80 inline:&lt;base64 key and salt&gt;"</c>.
+/// <c>--rtsp &lt;rtsp://[user:password@]host/path&gt;</c> pulls the stream from a camera instead of waiting for pushed RTP,
+/// <c>--rtsp-transport tcp</c> receives it interleaved in the RTSP connection instead of on the UDP port.
+/// <c>--record &lt;directory&gt;</c> stores the received stream as fragmented MP4 segments, started every
+/// <c>--record-segment &lt;seconds&gt;</c> (default 60) or after <c>--record-max-mb &lt;n&gt;</c> (default 1024).
+/// <c>--restream &lt;host:port&gt;[,&lt;host:port&gt;...]</c> forwards the received frames as RTP to other receivers.
+/// <c>--send &lt;file&gt;</c> streams an H.264, MPEG-TS or MP4 file as RTP to the receiver over loopback, or to
+/// <c>--send-to &lt;host:port&gt;[,...]</c>, at <c>--send-speed &lt;x&gt;</c> (0 = as fast as possible) and
+/// <c>--send-fps &lt;n&gt;</c> for files without timestamps, in packets of up to <c>--send-packet-size &lt;bytes&gt;</c>
+/// paced to <c>--send-rate-mbps &lt;n&gt;</c>. The pacing also applies to <c>--restream</c>.
+/// <c>--ulpfec-pt &lt;n&gt;</c> and <c>--flexfec-pt &lt;n&gt;</c> recover lost packets from ULPFEC or FlexFEC repair
+/// packets of that payload type; with RTSP they are taken from the session description.
+/// <c>--multicast &lt;group&gt;[,&lt;group&gt;...]</c> joins multicast groups on <c>--multicast-interface &lt;name or
+/// address&gt;</c>, source specific with <c>--multicast-source &lt;address&gt;</c>. <c>--receive-threads &lt;n&gt;</c>
+/// spreads the senders over n SO_REUSEPORT sockets, pinned to <c>--receive-cpus &lt;cpu&gt;[,&lt;cpu&gt;...]</c>.
+/// <c>--io-uring true</c> receives the RTP sockets and reads, records and sends files through io_uring where the
+/// kernel supports it.
+/// <c>--sps-reorder &lt;n|auto&gt;</c> rewrites the SPS to signal at most n reordered frames in the VUI, <c>auto</c> signals
+/// 0 once the stream showed it has no B slices, so players of the recording and the restream need not buffer.
+/// </remarks>
+internal sealed class PlayerOptions
+{
+    /// <summary>
+    /// File to record received datagrams to, or null
+    /// </summary>
+    public string? CapturePath { get; private set; }
+
+    /// <summary>
+    /// Capture to replay into the receiver, or null
+    /// </summary>
+    public string? ReplayPath { get; private set; }
+
+    public RtpReplayOptions Replay { get; } = new();
+
+    /// <summary>
+    /// SRTP keys of the sender, or null to receive plain RTP
+    /// </summary>
+    public SrtpPolicy? Srtp { get; private set; }
+
+    /// <summary>
+    /// RTSP URL to pull the stream from, or null to receive pushed RTP
+    /// </summary>
+    public Uri? RtspUrl { get; private set; }
+
+    public RtspTransport RtspTransport { get; private set; } = RtspTransport.Udp;
+
+    /// <summary>
+    /// Directory to record fragmented MP4 segments to, or null
+    /// </summary>
+    public string? RecordDirectory { get; private set; }
+
+    public TimeSpan RecordSegmentDuration { get; private set; } = TimeSpan.FromSeconds(60);
+
+    public long RecordMaxSegmentBytes { get; private set; } = 1024L * 1024 * 1024;
+
+    /// <summary>
+    /// Receivers to forward the received frames to, empty to not forward
+    /// </summary>
+    public IReadOnlyList<IPEndPoint> RestreamDestinations { get; private set; } = Array.Empty<IPEndPoint>();
+
+    /// <summary>
+    /// File to send as RTP, or null
+    /// </summary>
+    public string? SendPath { get; private set; }
+
+    /// <summary>
+    /// Receivers of <see cref="SendPath"/>, empty for the player itself
+    /// </summary>
+    public IReadOnlyList<IPEndPoint> SendDestinations { get; private set; } = Array.Empty<IPEndPoint>();
+
+    public RtpSendOptions Send { get; } = new();
+
+    /// <summary>
+    /// Payload type of ULPFEC repair packets, 0 if none are sent
+    /// </summary>
+    public int UlpfecPayloadType { get; private set; }
+
+    /// <summary>
+    /// Payload type of FlexFEC repair packets, 0 if none are sent
+    /// </summary>
+    public int FlexfecPayloadType { get; private set; }
+
+    public RtpSocketOptions Socket { get; } = new();
+
+    /// <summary>
+    /// Use io_uring for file reading and recording, the sockets use <see cref="RtpSocketOptions.EnableIoUring"/>
+    /// </summary>
+    public bool UseIoUring { get; private set; }
+
+    /// <summary>
+    /// Rewrite the SPS to signal <see cref="SpsMaxNumReorderFrames"/> in the VUI bitstream restriction
+    /// </summary>
+    public bool RewriteSps { get; private set; }
+
+    /// <summary>
+    /// Reorder depth to signal, null to infer it from the slice types
+    /// </summary>
+    public uint? SpsMaxNumReorderFrames { get; private set; }
+
+    public static PlayerOptions Parse(string[] args)
+    {
+        var options = new PlayerOptions();
+        for (int i = 0; i < args.Length; i++)
+        {
+            string name = args[i];
+            if (i + 1 >= args.Length)
+            {
+                throw new ArgumentException($"Missing value for {name}");
+            }
+
+            string value = args[++i];
+            switch (name)
+            {
+                case "--capture":
+                    options.CapturePath = value;
+                    break;
+                case "--replay":
+                    options.ReplayPath = value;
+                    break;
+                case "--replay-speed":
+                    options.Replay.Speed = double.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--replay-loss":
+                    options.Replay.LossProbability = double.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--replay-reorder":
+                    options.Replay.ReorderProbability = double.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--replay-seed":
+                    options.Replay.Seed = int.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--srtp":
+                    options.Srtp = SrtpPolicy.Parse(value);
+                    break;
+                case "--srtp-key-file":
+                    options.Srtp = SrtpPolicy.FromFile(value);
+                    break;
+                case "--rtsp":
+                    options.RtspUrl = new Uri(value);
+                    break;
+                case "--rtsp-transport":
+                    options.RtspTransport = Enum.Parse<RtspTransport>(value, ignoreCase: true);
+                    break;
+                case "--record":
+                    options.RecordDirectory = value;
+                    break;
+                case "--record-segment":
+                    options.RecordSegmentDuration = TimeSpan.FromSeconds(double.Parse(value, CultureInfo.InvariantCulture));
+                    break;
+                case "--record-max-mb":
+                    options.RecordMaxSegmentBytes = long.Parse(value, CultureInfo.InvariantCulture) * 1024 * 1024;
+                    break;
+                case "--restream":
+                    options.RestreamDestinations = ParseEndPoints(value);
+                    break;
+                case "--send":
+                    options.SendPath = value;
+                    break;
+                case "--send-to":
+                    options.SendDestinations = ParseEndPoints(value);
+                    break;
+                case "--send-speed":
+                    options.Send.Speed = double.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--send-fps":
+                    options.Send.FrameRate = double.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--send-packet-size":
+                    options.Send.MaxPacketSize = int.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--send-rate-mbps":
+                    options.Send.PacingBitrate = (long)(double.Parse(value, CultureInfo.InvariantCulture) * 1_000_000);
+                    break;
+                case "--ulpfec-pt":
+                    options.UlpfecPayloadType = int.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--flexfec-pt":
+                    options.FlexfecPayloadType = int.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--multicast":
+                    options.Socket.MulticastGroups = ParseList(value, IPAddress.Parse);
+                    break;
+                case "--multicast-source":
+                    options.Socket.MulticastSource = IPAddress.Parse(value);
+                    break;
+                case "--multicast-interface":
+                    options.Socket.MulticastInterface = value;
+                    break;
+                case "--receive-threads":
+                    options.Socket.ReceiveThreads = int.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                case "--receive-cpus":
+                    options.Socket.ReceiveCpus = ParseList(value, v => int.Parse(v, CultureInfo.InvariantCulture));
+                    break;
+                case "--io-uring":
+                    options.UseIoUring = bool.Parse(value);
+                    options.Socket.EnableIoUring = options.UseIoUring;
+                    break;
+                case "--sps-reorder":
+                    options.RewriteSps = true;
+                    options.SpsMaxNumReorderFrames = value.Equals("auto", StringComparison.OrdinalIgnoreCase)
+                        ? null
+                        : uint.Parse(value, CultureInfo.InvariantCulture);
+                    break;
+                default:
+                    throw new ArgumentException($"Unknown option {name}");
+            }
+        }
+
+        return options;
+    }
+
+    private static IReadOnlyList<IPEndPoint> ParseEndPoints(string value) => ParseList(value, IPEndPoint.Parse);
+
+    private static IReadOnlyList<T> ParseList<T>(string value, Func<string, T> parse)
+    {
+        return value.Split(',', StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries)
+            .Select(parse)
+            .ToArray();
+    }
+}
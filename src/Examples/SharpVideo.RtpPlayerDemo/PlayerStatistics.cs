@@ -45,6 +45,11 @@ public class PlayerStatistics
     /// </summary>
     public TimeSpan PresentElapsed { get; set; }
 
+    /// <summary>
+    /// Capture to decode time of the latest frame carrying a capture timestamp SEI, zero if the sender sends none
+    /// </summary>
+    public TimeSpan CaptureLatency { get; set; }
+
     /// <summary>
     /// Average decode time per frame in milliseconds
     /// </summary>
@@ -1,18 +1,25 @@
 ﻿using System.Diagnostics;
 using System.Net;
+using System.Net.Sockets;
 using System.Runtime.Versioning;
 using Hexa.NET.ImGui;
 using Microsoft.Extensions.Logging;
 using SharpVideo.DmaBuffers;
 using SharpVideo.Drm;
 using SharpVideo.Gbm;
+using SharpVideo.H264;
 using SharpVideo.Linux.Native;
 using SharpVideo.Linux.Native.C;
 using SharpVideo.Utils;
 using SharpVideo.V4L2;
 using SharpVideo.V4L2Decoding.Models;
+using SharpVideo.V4L2Decoding.NaluSources;
 using SharpVideo.V4L2Decoding.Services;
 using SharpVideo.ImGui;
+using SharpVideo.RtpPlayerDemo.Recording;
+using SharpVideo.RtpPlayerDemo.Rtp;
+using SharpVideo.RtpPlayerDemo.Rtsp;
+using SharpVideo.Srtp;
 
 namespace SharpVideo.RtpPlayerDemo;
 
@@ -41,6 +48,8 @@ internal class Program
 
     static async Task Main(string[] args)
     {
+        var options = PlayerOptions.Parse(args);
+
         Logger.LogInformation("=== SharpVideo RTP H.264 Player ===");
         Logger.LogInformation("Listening on {Address}:{Port}", BindAddress, BindPort);
         Logger.LogInformation("Press ESC or Ctrl+C to exit");
@@ -53,7 +62,7 @@ internal class Program
 
         try
         {
-            await RunPlayerAsync(shutdownHandler.Token);
+            await RunPlayerAsync(options, shutdownHandler.Token);
         }
         catch (OperationCanceledException)
         {
@@ -68,7 +77,7 @@ internal class Program
         Logger.LogInformation("RTP Player exited successfully");
     }
 
-    private static async Task RunPlayerAsync(CancellationToken cancellationToken)
+    private static async Task RunPlayerAsync(PlayerOptions options, CancellationToken cancellationToken)
     {
         // Setup DRM display
         Logger.LogDebug("Opening DRM device...");
@@ -214,17 +223,57 @@ internal class Program
             processDecodedAction: null,
             drmBufferManager: drmBufferManager);
 
-        // Setup RTP receiver
+        // Setup RTP receiver, IPv6 groups are only received on an IPv6 socket
+        var bindAddress = options.Socket.MulticastGroups.Any(g => g.AddressFamily == AddressFamily.InterNetworkV6)
+            ? IPAddress.IPv6Any
+            : IPAddress.Parse(BindAddress);
         using var rtpReceiver = new RtpReceiverService(
-            new IPEndPoint(IPAddress.Parse(BindAddress), BindPort),
-            LoggerFactory);
+            new[] { new IPEndPoint(bindAddress, BindPort) },
+            LoggerFactory,
+            options.Socket);
+
+        // Signals the reorder depth in the SPS, for players of the recording and the restream
+        var spsRewriter = options.RewriteSps ? new H264SpsRewriter(options.SpsMaxNumReorderFrames) : null;
+
+        // Pull the stream from an RTSP camera instead of waiting for pushed RTP
+        await using var rtspClient = options.RtspUrl != null
+            ? new RtspClient(options.RtspUrl, rtpReceiver.Receiver, BindPort, options.RtspTransport, LoggerFactory.CreateLogger<RtspClient>())
+            : null;
+        IReadOnlyList<byte[]> parameterSets = Array.Empty<byte[]>();
+        if (rtspClient != null)
+        {
+            await rtspClient.SetupAsync(cancellationToken);
+            parameterSets = spsRewriter != null
+                ? RewriteParameterSets(rtspClient.ParameterSets, spsRewriter)
+                : rtspClient.ParameterSets;
+
+            // The first IDR picture decodes even if the camera sends its SPS/PPS only in the SDP
+            decoder.SetParameterSets(parameterSets);
+        }
+
+        // Created before the pipeline so it is disposed after the pipeline stopped feeding it
+        await using var recorder = options.RecordDirectory != null
+            ? new Fmp4Recorder(options.RecordDirectory, options.RecordSegmentDuration, options.RecordMaxSegmentBytes,
+                LoggerFactory.CreateLogger<Fmp4Recorder>(), options.UseIoUring)
+            : null;
+        if (recorder != null && rtspClient != null)
+        {
+            recorder.SetParameterSets(parameterSets);
+        }
+
+        using var restreamer = options.RestreamDestinations.Count > 0
+            ? new H264RtpStreamer(options.RestreamDestinations, options.Send, LoggerFactory.CreateLogger<H264RtpStreamer>())
+            : null;
 
         // Create decoder pipeline - presenter now works directly with overlay
         await using var pipeline = new DecoderPipeline(
             rtpReceiver,
             decoder,
             presenter,
-            LoggerFactory);
+            LoggerFactory,
+            recorder,
+            restreamer,
+            spsRewriter);
 
         pipeline.Initialize();
 
@@ -232,11 +281,51 @@ internal class Program
         var osdRenderer = new OsdRenderer(pipeline.Statistics, rtpReceiver);
 
         // Start RTP receiver and pipeline
+        var srtpPolicy = options.Srtp ?? rtspClient?.SrtpPolicy;
+        if (srtpPolicy != null)
+        {
+            rtpReceiver.EnableSrtp(srtpPolicy);
+        }
+
+        if (options.UlpfecPayloadType != 0 || options.FlexfecPayloadType != 0)
+        {
+            rtpReceiver.EnableFec(options.UlpfecPayloadType, options.FlexfecPayloadType);
+        }
+
+        if (options.CapturePath != null)
+        {
+            rtpReceiver.StartCapture(options.CapturePath);
+        }
+
         rtpReceiver.Start();
         await pipeline.StartAsync();
+        if (rtspClient != null)
+        {
+            await rtspClient.PlayAsync(cancellationToken);
+        }
 
         Logger.LogInformation("RTP receiver started on {Address}:{Port}", BindAddress, BindPort);
 
+        using var replayCts = CancellationTokenSource.CreateLinkedTokenSource(cancellationToken);
+        Task replayTask = Task.CompletedTask;
+        if (options.ReplayPath != null)
+        {
+            var replayer = new RtpReplayer(options.ReplayPath, options.Replay, LoggerFactory.CreateLogger<RtpReplayer>());
+            replayTask = Task.Factory.StartNew(
+                () => replayer.ReplayToSocket(new IPEndPoint(IPAddress.Loopback, BindPort), replayCts.Token),
+                TaskCreationOptions.LongRunning);
+        }
+
+        // Stream a file over RTP, by default into the own receiver as a load generator
+        Task sendTask = Task.CompletedTask;
+        if (options.SendPath != null)
+        {
+            var destinations = options.SendDestinations.Count > 0
+                ? options.SendDestinations
+                : new[] { new IPEndPoint(IPAddress.Loopback, BindPort) };
+            sendTask = SendFileAsync(options.SendPath, destinations, options.Send, options.UseIoUring, replayCts.Token);
+        }
+
         // Warmup ImGui frame
         Logger.LogInformation("Rendering initial warmup frame...");
         if (imguiManager.WarmupFrame(dt => osdRenderer.Render()))
@@ -253,6 +342,10 @@ internal class Program
         await RunMainLoopAsync(imguiManager, gbmAtomicPresenter, inputManager, osdRenderer, pipeline.Statistics, cancellationToken);
 
         // Cleanup
+        replayCts.Cancel();
+        await replayTask;
+        await sendTask;
+        rtpReceiver.StopCapture();
         await pipeline.StopAsync();
         presenter.Dispose();
         gbmDevice.Dispose();
@@ -262,12 +355,57 @@ internal class Program
         Logger.LogInformation("=== Final Statistics ===");
         Logger.LogInformation("RTP Received: {Count} frames", rtpReceiver.ReceivedFramesCount);
         Logger.LogInformation("RTP Dropped: {Count} frames", rtpReceiver.DroppedFramesCount);
+        Logger.LogInformation("RTP Damaged: {Count} frames", rtpReceiver.DamagedFramesCount);
+        Logger.LogInformation("RTP Packets: {Statistics}", rtpReceiver.ReceptionStatistics);
+        foreach (var stream in rtpReceiver.Streams)
+        {
+            Logger.LogInformation("RTP Stream {Stream}: {Received} frames, {Dropped} dropped, {Statistics}",
+                stream.Stream, stream.ReceivedFramesCount, stream.DroppedFramesCount, stream.Stream.ReceptionStatistics);
+        }
+        Logger.LogInformation("RTCP: {Nacks} NACKs, {Retransmitted} retransmitted packets, {KeyFrameRequests} key frame requests",
+            rtpReceiver.NacksSentCount, rtpReceiver.RetransmittedPacketsCount, rtpReceiver.KeyFrameRequestsCount);
+        if (rtpReceiver.FecRepairPacketsCount > 0)
+        {
+            Logger.LogInformation("FEC: {Recovered} packets recovered from {Repair} repair packets",
+                rtpReceiver.FecRecoveredPacketsCount, rtpReceiver.FecRepairPacketsCount);
+        }
+        if (srtpPolicy != null)
+        {
+            Logger.LogInformation("SRTP: {Profile}, {Rejected} packets rejected", srtpPolicy.Profile, rtpReceiver.SrtpRejectedPacketsCount);
+        }
         Logger.LogInformation("Decoded: {Count} frames @ {Fps:F2} FPS",
             pipeline.Statistics.DecodedFrames, pipeline.Statistics.AverageDecodeFps);
         Logger.LogInformation("Presented: {Count} frames @ {Fps:F2} FPS",
             pipeline.Statistics.PresentedFrames, pipeline.Statistics.AveragePresentFps);
         Logger.LogInformation("Avg decode time: {Time:F2} ms/frame",
             pipeline.Statistics.AverageDecodeTimeMs);
+        if (spsRewriter != null)
+        {
+            Logger.LogInformation("SPS rewritten: {Count}", spsRewriter.RewrittenCount);
+        }
+    }
+
+    private static IReadOnlyList<byte[]> RewriteParameterSets(IReadOnlyList<byte[]> parameterSets, H264SpsRewriter spsRewriter)
+    {
+        return parameterSets
+            .Select(parameterSet => spsRewriter.TryRewrite(parameterSet, out var rewritten) ? rewritten : parameterSet)
+            .ToArray();
+    }
+
+    private static async Task SendFileAsync(string path, IReadOnlyList<IPEndPoint> destinations, RtpSendOptions sendOptions, bool useIoUring,
+        CancellationToken cancellationToken)
+    {
+        try
+        {
+            await using var source = NaluSourceFactory.CreateFromFile(path, LoggerFactory, useIoUring);
+            using var streamer = new H264RtpStreamer(destinations, sendOptions, LoggerFactory.CreateLogger<H264RtpStreamer>());
+            await source.StartAsync(cancellationToken);
+            await Task.Factory.StartNew(() => streamer.Stream(source, cancellationToken), TaskCreationOptions.LongRunning);
+        }
+        catch (Exception ex)
+        {
+            Logger.LogError(ex, "Sending {Path} failed", path);
+        }
     }
 
     private static async Task RunMainLoopAsync(
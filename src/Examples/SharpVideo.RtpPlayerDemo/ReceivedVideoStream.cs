@@ -0,0 +1,149 @@
+using System.Net;
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using SharpVideo.RtpPlayerDemo.Rtp;
+using SharpVideo.Utils;
+
+namespace SharpVideo.RtpPlayerDemo;
+
+/// <summary>
+/// Frame queue and statistics of one demultiplexed RTP stream
+/// </summary>
+[SupportedOSPlatform("linux")]
+public sealed class ReceivedVideoStream : IEncodedFrameSource, IDisposable
+{
+    private readonly ILogger _logger;
+    private readonly SpscRing<EncodedFrame> _framesQueue;
+    private int _receivedFramesCount;
+    private int _droppedFramesCount;
+    private volatile bool _hasConsumer;
+    private volatile Func<EncodedFrame, bool>? _frameConsumer;
+
+    internal ReceivedVideoStream(RtpReceiveStream stream, int queueCapacity, ILogger logger)
+    {
+        Stream = stream;
+        _logger = logger;
+        _framesQueue = new SpscRing<EncodedFrame>(queueCapacity);
+    }
+
+    /// <summary>
+    /// The underlying RTP stream
+    /// </summary>
+    public RtpReceiveStream Stream { get; }
+
+    public int Index => Stream.Index;
+
+    public uint Ssrc => Stream.Ssrc;
+
+    public int LocalPort => Stream.LocalPort;
+
+    public IPEndPoint? RemoteEndPoint => Stream.RemoteEndPoint;
+
+    /// <summary>
+    /// Total number of received frames
+    /// </summary>
+    public int ReceivedFramesCount => _receivedFramesCount;
+
+    /// <summary>
+    /// Number of frames dropped due to queue overflow
+    /// </summary>
+    public int DroppedFramesCount => _droppedFramesCount;
+
+    /// <summary>
+    /// <see cref="Environment.TickCount64"/> of the last frame received
+    /// </summary>
+    public long LastFrameTicks { get; private set; }
+
+    /// <summary>
+    /// True once the stream timed out and all queued frames were consumed
+    /// </summary>
+    public bool IsCompleted => _framesQueue.IsCompleted;
+
+    /// <summary>
+    /// Try to get next frame from queue. The caller owns the frame and must dispose it once its NAL units were consumed.
+    /// Only one thread may take frames from a stream.
+    /// </summary>
+    public bool TryGetFrame(out EncodedFrame frame, CancellationToken cancellationToken)
+    {
+        _hasConsumer = true;
+        return _framesQueue.TryPop(out frame, 100, cancellationToken);
+    }
+
+    public void RequestKeyFrame()
+    {
+        Stream.RequestKeyFrame();
+    }
+
+    /// <summary>
+    /// Hand frames to <paramref name="consumer"/> on the receive thread of the stream instead of the queue
+    /// </summary>
+    public void SetFrameConsumer(Func<EncodedFrame, bool>? consumer)
+    {
+        _frameConsumer = consumer;
+    }
+
+    /// <summary>
+    /// Passes a frame to the consumer or queues it without blocking the receive thread, dropping it if the consumer
+    /// falls behind
+    /// </summary>
+    /// <param name="frame">The frame, owned by the stream from here on</param>
+    /// <param name="consumer">Consumer to use instead of the one of the stream, e.g. the one of the service</param>
+    internal void Enqueue(EncodedFrame frame, Func<EncodedFrame, bool>? consumer = null)
+    {
+        Interlocked.Increment(ref _receivedFramesCount);
+        LastFrameTicks = Environment.TickCount64;
+
+        consumer ??= _frameConsumer;
+        bool added;
+        if (consumer != null)
+        {
+            _hasConsumer = true;
+            added = consumer(frame);
+        }
+        else
+        {
+            // Fails as well when the stream was completed while the frame was in flight
+            added = _framesQueue.TryPush(frame);
+        }
+
+        if (added)
+        {
+            if (_logger.IsEnabled(LogLevel.Trace))
+            {
+                _logger.LogTrace("Frame queued for stream {Stream}, queue size: {Size}", Index, _framesQueue.Count);
+            }
+
+            return;
+        }
+
+        frame.Dispose();
+        var dropped = Interlocked.Increment(ref _droppedFramesCount);
+
+        // Streams nobody reads from fill up by design, only warn when a consumer falls behind
+        if (_hasConsumer && _logger.IsEnabled(LogLevel.Warning))
+        {
+            _logger.LogWarning("Frame queue of stream {Stream} full, dropping frame (total dropped: {Count})", Index, dropped);
+        }
+    }
+
+    /// <summary>
+    /// Marks the stream as ended, consumers drain the remaining frames
+    /// </summary>
+    internal void Complete()
+    {
+        _framesQueue.Complete();
+    }
+
+    /// <summary>
+    /// Releases the queued frames, the consumer must have stopped taking frames
+    /// </summary>
+    public void Dispose()
+    {
+        _framesQueue.Complete();
+        while (_framesQueue.TryPop(out var frame))
+        {
+            frame.Dispose();
+        }
+        _framesQueue.Dispose();
+    }
+}
@@ -0,0 +1,817 @@
+using System.Buffers;
+using System.Buffers.Binary;
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using Microsoft.Win32.SafeHandles;
+using SharpVideo.H264;
+using SharpVideo.IoUring;
+using SharpVideo.RtpPlayerDemo.Rtp;
+using SharpVideo.Utils;
+
+namespace SharpVideo.RtpPlayerDemo.Recording;
+
+/// <summary>
+/// Records the received H.264 frames without re-encoding into fragmented MP4 segment files
+/// </summary>
+/// <remarks>
+/// Frames are taken on the receive thread, next to the decoder, so recording adds no network receive and no
+/// decoding. Every NAL unit is copied once into a pooled buffer of the current GOP with its start code overwritten
+/// by the AVCC length. A complete GOP becomes one moof/mdat fragment and goes through a single producer ring to the
+/// writer thread, which writes it with one vectored write. Segments rotate at key frames once they reach the
+/// configured duration or size, or when the SPS/PPS change. RTP only carries presentation times, decode times are
+/// derived per GOP so reordered streams (B-frames) play in order. Each segment is a complete file (ftyp, moov, fragments)
+/// and ends with an mfra index of its key frames; a segment cut off by a crash stays readable up to its last fragment.
+/// With io_uring the writer thread only copies the fragments into registered buffers and the kernel writes them in
+/// the background, a crash then also loses the last partially filled buffer.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed class Fmp4Recorder : IAsyncDisposable
+{
+    private const uint Timescale = 90000;
+    private const uint TrackId = 1;
+    private const int FragmentRingCapacity = 8;
+    private const int InitialFragmentCapacity = 1024 * 1024;
+    private const int MdatHeaderSize = 8;
+    private const uint DefaultFrameDuration = Timescale / 30;
+    private const uint NonSyncSampleFlags = 0x00010000;
+    private const uint SyncSampleFlags = 0x02000000;
+    private const uint TrunFlags = 0x000701; // data-offset, sample-duration, sample-size, sample-flags
+    private const uint TrunCompositionOffsetsFlag = 0x000800;
+
+    private readonly string _directory;
+    private readonly long _segmentDurationTicks;
+    private readonly long _maxSegmentBytes;
+    private bool _useIoUring;
+    private readonly ILogger<Fmp4Recorder> _logger;
+    private readonly SpscRing<Fragment> _fragments = new(FragmentRingCapacity);
+    private readonly Thread _writerThread;
+
+    // Receive thread state
+    private byte[]? _sps;
+    private byte[]? _pps;
+    private bool _parameterSetsChanged;
+    private bool _startSegment = true;
+    private Fragment? _fragment;
+    private long _lastTimestamp = -1;
+    private uint _lastRtpTimestamp;
+    private uint _lastDuration = DefaultFrameDuration;
+    private long _segmentStartTimestamp;
+    private long _decodeTime;
+    private readonly List<long> _presentationTimes = new();
+    private long _segmentBytes;
+    private long _framesWritten;
+    private long _droppedFrames;
+    private bool _isDisposed;
+    private volatile bool _writerFailed;
+
+    // Writer thread state
+    private readonly Mp4BoxWriter _boxWriter = new();
+    private readonly List<(ulong Time, ulong MoofOffset)> _keyFrameIndex = new();
+    private SafeFileHandle? _file;
+    private IoUringFileStream? _ioUringFile;
+    private string? _segmentPath;
+    private long _fileOffset;
+    private uint _sequenceNumber;
+    private int _segmentsWritten;
+
+    /// <param name="directory">Directory the segments are written to, created if missing</param>
+    /// <param name="segmentDuration">Media duration after which the next key frame starts a new segment</param>
+    /// <param name="maxSegmentBytes">Size after which the next key frame starts a new segment</param>
+    /// <param name="logger">Logger</param>
+    /// <param name="useIoUring">Write the segments through io_uring if the kernel supports it</param>
+    public Fmp4Recorder(string directory, TimeSpan segmentDuration, long maxSegmentBytes, ILogger<Fmp4Recorder> logger,
+        bool useIoUring = false)
+    {
+        _directory = directory;
+        _segmentDurationTicks = (long)(segmentDuration.TotalSeconds * Timescale);
+        _maxSegmentBytes = maxSegmentBytes;
+        _useIoUring = useIoUring && IoUringFileStream.IsSupported;
+        _logger = logger;
+        Directory.CreateDirectory(directory);
+
+        _writerThread = new Thread(WriterThreadProc)
+        {
+            Name = "fMP4 recorder",
+            IsBackground = true
+        };
+        _writerThread.Start();
+    }
+
+    /// <summary>
+    /// Frames recorded so far
+    /// </summary>
+    public long FramesWritten => Interlocked.Read(ref _framesWritten);
+
+    /// <summary>
+    /// Frames not recorded: before the first key frame with parameter sets, or because the writer fell behind
+    /// </summary>
+    public long DroppedFrames => Interlocked.Read(ref _droppedFrames);
+
+    /// <summary>
+    /// Segment files started so far
+    /// </summary>
+    public int SegmentsWritten => Volatile.Read(ref _segmentsWritten);
+
+    /// <summary>
+    /// Out-of-band SPS and PPS, e.g. from the SDP, for streams that do not repeat them in-band
+    /// </summary>
+    public void SetParameterSets(IReadOnlyList<byte[]> parameterSets)
+    {
+        foreach (var parameterSet in parameterSets)
+        {
+            UpdateParameterSet(parameterSet);
+        }
+    }
+
+    /// <summary>
+    /// Records a frame. Must always be called from the same thread, typically the receive thread, before the frame
+    /// is handed on; the frame is copied and not kept.
+    /// </summary>
+    public void Write(EncodedFrame frame)
+    {
+        if (_isDisposed || _writerFailed)
+        {
+            return;
+        }
+
+        long timestamp = UnwrapTimestamp(frame.Timestamp);
+
+        // Parameter sets go into the init segment, in-band copies update it
+        for (int i = 0; i < frame.NalUnitCount; i++)
+        {
+            var nalUnit = frame.GetNalUnit(i);
+            if (nalUnit.Length <= 4)
+            {
+                continue;
+            }
+
+            var type = (NalUnitType)(nalUnit[4] & 0x1F);
+            if (type is NalUnitType.SPS_NUT or NalUnitType.PPS_NUT)
+            {
+                UpdateParameterSet(nalUnit.Slice(4));
+            }
+        }
+
+        if (frame.IsKeyFrame)
+        {
+            if (_sps == null || _pps == null)
+            {
+                Interlocked.Increment(ref _droppedFrames);
+                return;
+            }
+
+            FinishFragment(timestamp);
+            StartFragment(timestamp);
+        }
+        else if (_fragment == null)
+        {
+            // Waiting for the first key frame
+            Interlocked.Increment(ref _droppedFrames);
+            return;
+        }
+
+        AppendSample(_fragment!, frame, timestamp);
+        Interlocked.Increment(ref _framesWritten);
+    }
+
+    private void UpdateParameterSet(ReadOnlySpan<byte> nalUnit)
+    {
+        if (nalUnit.IsEmpty)
+        {
+            return;
+        }
+
+        ref byte[]? current = ref (nalUnit[0] & 0x1F) == (int)NalUnitType.SPS_NUT ? ref _sps : ref _pps;
+        if (current != null && nalUnit.SequenceEqual(current))
+        {
+            return;
+        }
+
+        if (current != null)
+        {
+            _parameterSetsChanged = true;
+        }
+
+        current = nalUnit.ToArray();
+    }
+
+    /// <summary>
+    /// Extends the 32 bit RTP timestamp to 64 bits
+    /// </summary>
+    private long UnwrapTimestamp(uint rtpTimestamp)
+    {
+        if (_lastTimestamp < 0)
+        {
+            _lastTimestamp = rtpTimestamp;
+        }
+        else
+        {
+            _lastTimestamp += (int)(rtpTimestamp - _lastRtpTimestamp);
+        }
+
+        _lastRtpTimestamp = rtpTimestamp;
+        return _lastTimestamp;
+    }
+
+    private void StartFragment(long timestamp)
+    {
+        bool startsSegment = _startSegment ||
+                             timestamp - _segmentStartTimestamp >= _segmentDurationTicks ||
+                             _segmentBytes >= _maxSegmentBytes ||
+                             _parameterSetsChanged;
+        if (startsSegment)
+        {
+            _segmentStartTimestamp = timestamp;
+            _decodeTime = 0;
+            _segmentBytes = 0;
+            _parameterSetsChanged = false;
+            _startSegment = false;
+        }
+
+        _fragment = new Fragment(startsSegment ? _sps : null, startsSegment ? _pps : null);
+    }
+
+    /// <summary>
+    /// Completes the fragment of the previous GOP and hands it to the writer thread
+    /// </summary>
+    /// <param name="nextTimestamp">Timestamp of the next frame, ending the last sample, or -1 at the end</param>
+    private void FinishFragment(long nextTimestamp)
+    {
+        var fragment = _fragment;
+        if (fragment == null)
+        {
+            return;
+        }
+
+        _fragment = null;
+        if (fragment.Samples.Count == 0)
+        {
+            fragment.Dispose();
+            return;
+        }
+
+        var samples = fragment.Samples;
+        SetDecodeTimes(fragment, nextTimestamp);
+
+        if (_fragments.TryPush(fragment))
+        {
+            _segmentBytes += fragment.Length;
+            return;
+        }
+
+        if (!_writerFailed)
+        {
+            _logger.LogWarning("Recorder writer is behind, dropping a GOP of {Count} frames", samples.Count);
+        }
+
+        // The next GOP has to open the segment this one would have opened
+        _startSegment |= fragment.Sps != null;
+        Interlocked.Add(ref _droppedFrames, samples.Count);
+        fragment.Dispose();
+    }
+
+    /// <summary>
+    /// Derives the decode times of a GOP's samples, which arrive in decode order with presentation times
+    /// </summary>
+    /// <remarks>
+    /// The decode times are the GOP's presentation times in ascending order, continuing the decode timeline of the
+    /// segment: each sample lasts until the next presentation time and its composition offset is the distance of its
+    /// presentation time from its decode time. Without reordering the offsets are 0. With B-frames a reference frame
+    /// decodes before the frames it follows in presentation, its offset is positive and theirs may be negative.
+    /// Irregular timestamps, e.g. after lost frames, are absorbed by the offsets and never stall the decode times.
+    /// </remarks>
+    /// <param name="nextTimestamp">Timestamp of the next GOP's first frame, ending the last sample, or -1 at the end</param>
+    private void SetDecodeTimes(Fragment fragment, long nextTimestamp)
+    {
+        var samples = fragment.Samples;
+        _presentationTimes.Clear();
+        foreach (var sample in samples)
+        {
+            _presentationTimes.Add(sample.Timestamp);
+        }
+
+        _presentationTimes.Sort();
+
+        fragment.BaseDecodeTime = _decodeTime;
+        for (int i = 0; i < samples.Count; i++)
+        {
+            long next = i + 1 < samples.Count ? _presentationTimes[i + 1] : nextTimestamp;
+            long duration = next - _presentationTimes[i];
+            if (duration > 0 && duration <= uint.MaxValue)
+            {
+                _lastDuration = (uint)duration;
+            }
+
+            long offset = samples[i].Timestamp - _segmentStartTimestamp - _decodeTime;
+            samples[i] = samples[i] with
+            {
+                Duration = _lastDuration,
+                CompositionOffset = (int)Math.Clamp(offset, int.MinValue, int.MaxValue)
+            };
+            _decodeTime += _lastDuration;
+        }
+    }
+
+    private void AppendSample(Fragment fragment, EncodedFrame frame, long timestamp)
+    {
+        int start = fragment.Length;
+        for (int i = 0; i < frame.NalUnitCount; i++)
+        {
+            var nalUnit = frame.GetNalUnit(i);
+            if (nalUnit.Length <= 4)
+            {
+                continue;
+            }
+
+            var type = (NalUnitType)(nalUnit[4] & 0x1F);
+            if (type is NalUnitType.SPS_NUT or NalUnitType.PPS_NUT or NalUnitType.AUD_NUT)
+            {
+                continue;
+            }
+
+            // One copy, the start code becomes the length field
+            var destination = fragment.Append(nalUnit.Length);
+            nalUnit.CopyTo(destination);
+            BinaryPrimitives.WriteInt32BigEndian(destination, nalUnit.Length - 4);
+        }
+
+        fragment.Samples.Add(new Sample(timestamp, fragment.Length - start, frame.IsKeyFrame));
+    }
+
+    private void WriterThreadProc()
+    {
+        try
+        {
+            while (true)
+            {
+                if (!_fragments.TryPop(out var fragment, Timeout.Infinite))
+                {
+                    if (_fragments.IsCompleted)
+                    {
+                        break;
+                    }
+
+                    continue;
+                }
+
+                using (fragment)
+                {
+                    WriteFragment(fragment);
+                }
+            }
+        }
+        catch (Exception ex)
+        {
+            _writerFailed = true;
+            _logger.LogError(ex, "Recording stopped, writing {Path} failed", _segmentPath);
+
+            // Fragments still queued are released, pushes into the completed ring fail from now on
+            _fragments.Complete();
+            while (_fragments.TryPop(out var fragment))
+            {
+                fragment.Dispose();
+            }
+        }
+        finally
+        {
+            CloseSegment();
+        }
+    }
+
+    private void WriteFragment(Fragment fragment)
+    {
+        if (fragment.Sps != null && fragment.Pps != null)
+        {
+            CloseSegment();
+            OpenSegment(fragment.Sps, fragment.Pps);
+        }
+
+        if (_file == null && _ioUringFile == null)
+        {
+            return;
+        }
+
+        // The index has the key frame's presentation time
+        long moofOffset = _fileOffset;
+        long keyFrameTime = fragment.BaseDecodeTime + fragment.Samples[0].CompositionOffset;
+        _keyFrameIndex.Add(((ulong)Math.Max(keyFrameTime, 0), (ulong)moofOffset));
+
+        _boxWriter.Clear();
+        int dataOffsetPosition = WriteMoof(fragment);
+        int mdat = _boxWriter.BeginBox("mdat");
+        _boxWriter.EndBox(mdat);
+        _boxWriter.PatchInt32(dataOffsetPosition, _boxWriter.Length);
+
+        // The mdat header was written empty, its size covers the sample data that follows in the same write
+        _boxWriter.PatchInt32(mdat, MdatHeaderSize + fragment.Length);
+
+        if (_ioUringFile != null)
+        {
+            _ioUringFile.Write(_boxWriter.WrittenMemory.Span);
+            _ioUringFile.Write(fragment.Memory.Span);
+        }
+        else
+        {
+            var buffers = new[] { _boxWriter.WrittenMemory, fragment.Memory };
+            RandomAccess.Write(_file!, buffers, _fileOffset);
+        }
+
+        _fileOffset += _boxWriter.Length + fragment.Length;
+    }
+
+    /// <returns>Position of the trun data offset, to be patched once the moof size is known</returns>
+    private int WriteMoof(Fragment fragment)
+    {
+        var w = _boxWriter;
+        var samples = fragment.Samples;
+
+        int moof = w.BeginBox("moof");
+        int mfhd = w.BeginFullBox("mfhd", 0, 0);
+        w.WriteUInt32(++_sequenceNumber);
+        w.EndBox(mfhd);
+
+        int traf = w.BeginBox("traf");
+        int tfhd = w.BeginFullBox("tfhd", 0, 0x020000); // default-base-is-moof
+        w.WriteUInt32(TrackId);
+        w.EndBox(tfhd);
+
+        int tfdt = w.BeginFullBox("tfdt", 1, 0);
+        w.WriteUInt64((ulong)fragment.BaseDecodeTime);
+        w.EndBox(tfdt);
+
+        // Composition offsets only for reordered GOPs, version 1 makes them signed
+        bool hasCompositionOffsets = samples.Exists(sample => sample.CompositionOffset != 0);
+        int trun = hasCompositionOffsets
+            ? w.BeginFullBox("trun", 1, TrunFlags | TrunCompositionOffsetsFlag)
+            : w.BeginFullBox("trun", 0, TrunFlags);
+        w.WriteUInt32((uint)samples.Count);
+        int dataOffsetPosition = w.Length;
+        w.WriteInt32(0);
+        foreach (var sample in samples)
+        {
+            w.WriteUInt32(sample.Duration);
+            w.WriteUInt32((uint)sample.Size);
+            w.WriteUInt32(sample.IsKeyFrame ? SyncSampleFlags : NonSyncSampleFlags);
+            if (hasCompositionOffsets)
+            {
+                w.WriteInt32(sample.CompositionOffset);
+            }
+        }
+
+        w.EndBox(trun);
+        w.EndBox(traf);
+        w.EndBox(moof);
+        return dataOffsetPosition;
+    }
+
+    private void OpenSegment(byte[] sps, byte[] pps)
+    {
+        // Milliseconds keep the names unique and sorted when parameter set changes start segments in quick succession
+        _segmentPath = Path.Combine(_directory, $"{DateTime.UtcNow:yyyyMMdd'T'HHmmss.fff'Z'}.mp4");
+
+        if (_useIoUring)
+        {
+            try
+            {
+                _ioUringFile = IoUringFileStream.Create(_segmentPath);
+            }
+            catch (InvalidOperationException ex)
+            {
+                // E.g. the io_uring instance limit, the remaining segments are written with pwritev
+                _logger.LogWarning("Cannot write {Path} through io_uring, falling back to plain writes: {Message}", _segmentPath, ex.Message);
+                _useIoUring = false;
+            }
+        }
+
+        if (_ioUringFile == null)
+        {
+            _file = File.OpenHandle(_segmentPath, FileMode.Create, FileAccess.Write, FileShare.Read);
+        }
+
+        _fileOffset = 0;
+        _sequenceNumber = 0;
+        _keyFrameIndex.Clear();
+
+        _boxWriter.Clear();
+        WriteInitSegment(sps, pps);
+        WriteToSegment(_boxWriter.WrittenMemory.Span);
+
+        Interlocked.Increment(ref _segmentsWritten);
+        _logger.LogInformation("Recording to {Path}", _segmentPath);
+    }
+
+    /// <summary>
+    /// Appends the key frame index and closes the segment file
+    /// </summary>
+    private void CloseSegment()
+    {
+        if (_file == null && _ioUringFile == null)
+        {
+            return;
+        }
+
+        try
+        {
+            var w = _boxWriter;
+            w.Clear();
+            int mfra = w.BeginBox("mfra");
+            int tfra = w.BeginFullBox("tfra", 1, 0);
+            w.WriteUInt32(TrackId);
+            w.WriteUInt32(0); // 1 byte traf, trun and sample numbers
+            w.WriteUInt32((uint)_keyFrameIndex.Count);
+            foreach (var (time, moofOffset) in _keyFrameIndex)
+            {
+                w.WriteUInt64(time);
+                w.WriteUInt64(moofOffset);
+                w.WriteByte(1);
+                w.WriteByte(1);
+                w.WriteByte(1);
+            }
+
+            w.EndBox(tfra);
+            int mfro = w.BeginFullBox("mfro", 0, 0);
+            w.WriteUInt32((uint)(w.Length + 4 - mfra));
+            w.EndBox(mfro);
+            w.EndBox(mfra);
+
+            WriteToSegment(w.WrittenMemory.Span);
+
+            // Waits for the writes still in flight
+            _ioUringFile?.Flush();
+            _logger.LogInformation("Closed {Path}: {Bytes} bytes, {KeyFrames} key frames",
+                _segmentPath, _fileOffset, _keyFrameIndex.Count);
+        }
+        catch (IOException ex)
+        {
+            _logger.LogError(ex, "Writing the index of {Path} failed", _segmentPath);
+        }
+        finally
+        {
+            try
+            {
+                _ioUringFile?.Dispose();
+            }
+            catch (IOException ex)
+            {
+                _logger.LogError(ex, "Closing {Path} failed", _segmentPath);
+            }
+
+            _ioUringFile = null;
+            _file?.Dispose();
+            _file = null;
+        }
+    }
+
+    /// <summary>
+    /// Appends to the segment file
+    /// </summary>
+    private void WriteToSegment(ReadOnlySpan<byte> data)
+    {
+        if (_ioUringFile != null)
+        {
+            _ioUringFile.Write(data);
+        }
+        else
+        {
+            RandomAccess.Write(_file!, data, _fileOffset);
+        }
+
+        _fileOffset += data.Length;
+    }
+
+    private void WriteInitSegment(byte[] sps, byte[] pps)
+    {
+        var w = _boxWriter;
+        int width = 0;
+        int height = 0;
+        var spsState = H264SpsParser.ParseSps(sps.AsSpan(1));
+        spsState?.sps_data?.getResolution(out width, out height);
+
+        int ftyp = w.BeginBox("ftyp");
+        w.WriteFourCc("isom");
+        w.WriteUInt32(0x200);
+        w.WriteFourCc("isom");
+        w.WriteFourCc("iso6");
+        w.WriteFourCc("avc1");
+        w.WriteFourCc("mp41");
+        w.EndBox(ftyp);
+
+        int moov = w.BeginBox("moov");
+
+        int mvhd = w.BeginFullBox("mvhd", 0, 0);
+        w.WriteZeros(8); // creation and modification time
+        w.WriteUInt32(1000);
+        w.WriteUInt32(0); // duration, unknown for fragmented files
+        w.WriteUInt32(0x00010000); // rate 1.0
+        w.WriteUInt16(0x0100); // volume 1.0
+        w.WriteZeros(10);
+        WriteUnityMatrix(w);
+        w.WriteZeros(24);
+        w.WriteUInt32(TrackId + 1);
+        w.EndBox(mvhd);
+
+        int trak = w.BeginBox("trak");
+        int tkhd = w.BeginFullBox("tkhd", 0, 0x000003); // enabled, in movie
+        w.WriteZeros(8);
+        w.WriteUInt32(TrackId);
+        w.WriteZeros(4);
+        w.WriteUInt32(0);
+        w.WriteZeros(8);
+        w.WriteZeros(8); // layer, alternate group, volume, reserved
+        WriteUnityMatrix(w);
+        w.WriteUInt32((uint)width << 16);
+        w.WriteUInt32((uint)height << 16);
+        w.EndBox(tkhd);
+
+        int mdia = w.BeginBox("mdia");
+        int mdhd = w.BeginFullBox("mdhd", 0, 0);
+        w.WriteZeros(8);
+        w.WriteUInt32(Timescale);
+        w.WriteUInt32(0);
+        w.WriteUInt16(0x55C4); // "und"
+        w.WriteUInt16(0);
+        w.EndBox(mdhd);
+
+        int hdlr = w.BeginFullBox("hdlr", 0, 0);
+        w.WriteUInt32(0);
+        w.WriteFourCc("vide");
+        w.WriteZeros(12);
+        w.WriteBytes("SharpVideo\0"u8);
+        w.EndBox(hdlr);
+
+        int minf = w.BeginBox("minf");
+        int vmhd = w.BeginFullBox("vmhd", 0, 1);
+        w.WriteZeros(8);
+        w.EndBox(vmhd);
+
+        int dinf = w.BeginBox("dinf");
+        int dref = w.BeginFullBox("dref", 0, 0);
+        w.WriteUInt32(1);
+        int url = w.BeginFullBox("url ", 0, 1); // media data in the same file
+        w.EndBox(url);
+        w.EndBox(dref);
+        w.EndBox(dinf);
+
+        int stbl = w.BeginBox("stbl");
+        int stsd = w.BeginFullBox("stsd", 0, 0);
+        w.WriteUInt32(1);
+        int avc1 = w.BeginBox("avc1");
+        w.WriteZeros(6);
+        w.WriteUInt16(1); // data reference index
+        w.WriteZeros(16);
+        w.WriteUInt16((ushort)width);
+        w.WriteUInt16((ushort)height);
+        w.WriteUInt32(0x00480000); // 72 dpi
+        w.WriteUInt32(0x00480000);
+        w.WriteUInt32(0);
+        w.WriteUInt16(1); // frame count
+        w.WriteZeros(32); // compressor name
+        w.WriteUInt16(0x0018); // depth
+        w.WriteUInt16(0xFFFF);
+
+        int avcC = w.BeginBox("avcC");
+        w.WriteByte(1);
+        w.WriteByte(sps[1]); // profile
+        w.WriteByte(sps[2]); // constraint flags
+        w.WriteByte(sps[3]); // level
+        w.WriteByte(0xFF); // 4 byte NAL unit lengths
+        w.WriteByte(0xE1); // one SPS
+        w.WriteUInt16((ushort)sps.Length);
+        w.WriteBytes(sps);
+        w.WriteByte(1);
+        w.WriteUInt16((ushort)pps.Length);
+        w.WriteBytes(pps);
+        w.EndBox(avcC);
+        w.EndBox(avc1);
+        w.EndBox(stsd);
+
+        // Empty sample tables, the samples are in the fragments
+        foreach (var table in new[] { "stts", "stsc", "stco" })
+        {
+            int box = w.BeginFullBox(table, 0, 0);
+            w.WriteUInt32(0);
+            w.EndBox(box);
+        }
+
+        int stsz = w.BeginFullBox("stsz", 0, 0);
+        w.WriteUInt32(0);
+        w.WriteUInt32(0);
+        w.EndBox(stsz);
+        w.EndBox(stbl);
+        w.EndBox(minf);
+        w.EndBox(mdia);
+        w.EndBox(trak);
+
+        int mvex = w.BeginBox("mvex");
+        int trex = w.BeginFullBox("trex", 0, 0);
+        w.WriteUInt32(TrackId);
+        w.WriteUInt32(1); // sample description index
+        w.WriteUInt32(0);
+        w.WriteUInt32(0);
+        w.WriteUInt32(0);
+        w.EndBox(trex);
+        w.EndBox(mvex);
+
+        w.EndBox(moov);
+    }
+
+    private static void WriteUnityMatrix(Mp4BoxWriter w)
+    {
+        w.WriteUInt32(0x00010000);
+        w.WriteZeros(12);
+        w.WriteUInt32(0x00010000);
+        w.WriteZeros(12);
+        w.WriteUInt32(0x40000000);
+    }
+
+    /// <summary>
+    /// Writes the last GOP and closes the segment
+    /// </summary>
+    public ValueTask DisposeAsync()
+    {
+        if (_isDisposed)
+        {
+            return ValueTask.CompletedTask;
+        }
+
+        // The frame consumer has been removed by now, so this runs after the last Write
+        FinishFragment(-1);
+        _isDisposed = true;
+        _fragments.Complete();
+        _writerThread.Join();
+        _fragments.Dispose();
+
+        _logger.LogInformation("Recording finished: {Frames} frames in {Segments} segments, {Dropped} frames dropped",
+            FramesWritten, SegmentsWritten, DroppedFrames);
+        return ValueTask.CompletedTask;
+    }
+
+    private readonly record struct Sample(long Timestamp, int Size, bool IsKeyFrame)
+    {
+        /// <summary>
+        /// Set with the decode times once the GOP is complete
+        /// </summary>
+        public uint Duration { get; init; }
+
+        /// <summary>
+        /// Presentation time minus decode time
+        /// </summary>
+        public int CompositionOffset { get; init; }
+    }
+
+    /// <summary>
+    /// The samples of one GOP in AVCC format, in a pooled buffer
+    /// </summary>
+    private sealed class Fragment : IDisposable
+    {
+        private byte[] _buffer = ArrayPool<byte>.Shared.Rent(InitialFragmentCapacity);
+
+        public Fragment(byte[]? sps, byte[]? pps)
+        {
+            Sps = sps;
+            Pps = pps;
+        }
+
+        /// <summary>
+        /// Parameter sets of the init segment if this fragment starts a new segment, otherwise null
+        /// </summary>
+        public byte[]? Sps { get; }
+
+        public byte[]? Pps { get; }
+
+        /// <summary>
+        /// Decoding time of the first sample relative to the segment start
+        /// </summary>
+        public long BaseDecodeTime { get; set; }
+
+        public List<Sample> Samples { get; } = new();
+
+        public int Length { get; private set; }
+
+        public ReadOnlyMemory<byte> Memory => _buffer.AsMemory(0, Length);
+
+        public Span<byte> Append(int count)
+        {
+            if (Length + count > _buffer.Length)
+            {
+                var larger = ArrayPool<byte>.Shared.Rent(Math.Max(_buffer.Length * 2, Length + count));
+                _buffer.AsSpan(0, Length).CopyTo(larger);
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = larger;
+            }
+
+            var span = _buffer.AsSpan(Length, count);
+            Length += count;
+            return span;
+        }
+
+        public void Dispose()
+        {
+            if (_buffer.Length > 0)
+            {
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = Array.Empty<byte>();
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+using System.Buffers.Binary;
+using System.Text;
+
+namespace SharpVideo.RtpPlayerDemo.Recording;
+
+/// <summary>
+/// Serializes nested ISO BMFF boxes into a reusable buffer, box sizes are patched in when a box is closed
+/// </summary>
+internal sealed class Mp4BoxWriter
+{
+    private byte[] _buffer;
+    private int _length;
+
+    public Mp4BoxWriter(int initialCapacity = 4096)
+    {
+        _buffer = new byte[initialCapacity];
+    }
+
+    public int Length => _length;
+
+    public ReadOnlyMemory<byte> WrittenMemory => _buffer.AsMemory(0, _length);
+
+    public void Clear()
+    {
+        _length = 0;
+    }
+
+    /// <summary>
+    /// Starts a box, returns its offset for <see cref="EndBox"/>
+    /// </summary>
+    public int BeginBox(string type)
+    {
+        int start = _length;
+        WriteUInt32(0);
+        WriteFourCc(type);
+        return start;
+    }
+
+    /// <summary>
+    /// Starts a full box with version and flags
+    /// </summary>
+    public int BeginFullBox(string type, byte version, uint flags)
+    {
+        int start = BeginBox(type);
+        WriteUInt32((uint)version << 24 | (flags & 0xFFFFFF));
+        return start;
+    }
+
+    public void EndBox(int start)
+    {
+        BinaryPrimitives.WriteUInt32BigEndian(_buffer.AsSpan(start), (uint)(_length - start));
+    }
+
+    public void WriteByte(byte value)
+    {
+        Reserve(1)[0] = value;
+    }
+
+    public void WriteUInt16(ushort value)
+    {
+        BinaryPrimitives.WriteUInt16BigEndian(Reserve(2), value);
+    }
+
+    public void WriteUInt32(uint value)
+    {
+        BinaryPrimitives.WriteUInt32BigEndian(Reserve(4), value);
+    }
+
+    public void WriteInt32(int value)
+    {
+        BinaryPrimitives.WriteInt32BigEndian(Reserve(4), value);
+    }
+
+    public void WriteUInt64(ulong value)
+    {
+        BinaryPrimitives.WriteUInt64BigEndian(Reserve(8), value);
+    }
+
+    public void WriteBytes(ReadOnlySpan<byte> data)
+    {
+        data.CopyTo(Reserve(data.Length));
+    }
+
+    public void WriteZeros(int count)
+    {
+        Reserve(count).Clear();
+    }
+
+    public void WriteFourCc(string fourCc)
+    {
+        Encoding.ASCII.GetBytes(fourCc, Reserve(4));
+    }
+
+    /// <summary>
+    /// Overwrites a 32 bit value written earlier, e.g. an offset only known once the box is complete
+    /// </summary>
+    public void PatchInt32(int position, int value)
+    {
+        BinaryPrimitives.WriteInt32BigEndian(_buffer.AsSpan(position), value);
+    }
+
+    private Span<byte> Reserve(int count)
+    {
+        if (_length + count > _buffer.Length)
+        {
+            Array.Resize(ref _buffer, Math.Max(_buffer.Length * 2, _length + count));
+        }
+
+        var span = _buffer.AsSpan(_length, count);
+        _length += count;
+        return span;
+    }
+}
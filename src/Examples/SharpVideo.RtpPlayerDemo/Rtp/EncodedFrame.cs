@@ -0,0 +1,246 @@
+using System.Buffers;
+using System.Collections.Concurrent;
+using SharpVideo.V4L2Decoding.NaluSources;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// One encoded video frame reassembled from RTP packets.
+/// </summary>
+/// <remarks>
+/// The frame is an arena: depacketisers append start codes and payload slices straight from the received datagrams,
+/// and record where every NAL unit begins so consumers do not have to scan for start codes again. Frames and their
+/// buffers are pooled; call <see cref="Dispose"/> once the data has been consumed and do not touch the frame
+/// afterwards.
+/// </remarks>
+public sealed class EncodedFrame : INaluFrame
+{
+    private const int MAX_POOLED_FRAMES = 16;
+    private const int MIN_CAPACITY = 64 * 1024;
+
+    private static readonly ConcurrentQueue<EncodedFrame> Pool = new();
+    private static int _pooledCount;
+
+    private readonly List<(int Offset, int Length)> _nalUnits = new();
+    private byte[] _buffer;
+    private int _length;
+    private int _openNalUnitOffset = -1;
+    private bool _isDisposed;
+
+    private EncodedFrame(int capacity)
+    {
+        _buffer = ArrayPool<byte>.Shared.Rent(Math.Max(capacity, MIN_CAPACITY));
+    }
+
+    /// <summary>
+    /// RTP timestamp of the frame.
+    /// </summary>
+    public uint Timestamp { get; internal set; }
+
+    /// <summary>
+    /// True if the depacketiser classified the frame as a key frame (for H264: it contains an IDR slice).
+    /// </summary>
+    public bool IsKeyFrame { get; internal set; }
+
+    /// <summary>
+    /// True if packets of this frame were lost. Only complete NAL units are included.
+    /// </summary>
+    public bool IsDamaged { get; internal set; }
+
+    /// <summary>
+    /// Size of the frame in bytes.
+    /// </summary>
+    public int Length => _length;
+
+    /// <summary>
+    /// The whole frame. For H264 this is an Annex-B byte stream with 4 byte start codes.
+    /// </summary>
+    public ReadOnlySpan<byte> Data => _buffer.AsSpan(0, _length);
+
+    /// <summary>
+    /// Number of NAL units recorded in the frame (0 for codecs without NAL units).
+    /// </summary>
+    public int NalUnitCount => _nalUnits.Count;
+
+    /// <summary>
+    /// Returns a NAL unit including its start code.
+    /// </summary>
+    public ReadOnlySpan<byte> GetNalUnit(int index)
+    {
+        var (offset, length) = _nalUnits[index];
+        return _buffer.AsSpan(offset, length);
+    }
+
+    /// <summary>
+    /// Takes a frame from the pool or creates a new one.
+    /// </summary>
+    /// <param name="capacityHint">Expected frame size, typically the size of the previous frame.</param>
+    internal static EncodedFrame Rent(int capacityHint)
+    {
+        if (Pool.TryDequeue(out var frame))
+        {
+            Interlocked.Decrement(ref _pooledCount);
+            frame._isDisposed = false;
+            if (frame._buffer.Length < capacityHint)
+            {
+                ArrayPool<byte>.Shared.Return(frame._buffer);
+                frame._buffer = ArrayPool<byte>.Shared.Rent(capacityHint);
+            }
+
+            return frame;
+        }
+
+        return new EncodedFrame(capacityHint);
+    }
+
+    /// <summary>
+    /// Returns a writable region of <paramref name="count"/> bytes at the end of the frame, growing the arena if
+    /// required.
+    /// </summary>
+    internal Span<byte> Append(int count)
+    {
+        EnsureCapacity(_length + count);
+        var span = _buffer.AsSpan(_length, count);
+        _length += count;
+        return span;
+    }
+
+    /// <summary>
+    /// Appends data at the end of the frame.
+    /// </summary>
+    internal void Append(ReadOnlySpan<byte> data)
+    {
+        data.CopyTo(Append(data.Length));
+    }
+
+    /// <summary>
+    /// Writes a 4 byte Annex-B start code and marks the start of a new NAL unit.
+    /// </summary>
+    internal void BeginNalUnit()
+    {
+        _openNalUnitOffset = _length;
+        var startCode = Append(4);
+        startCode[0] = 0;
+        startCode[1] = 0;
+        startCode[2] = 0;
+        startCode[3] = 1;
+    }
+
+    /// <summary>
+    /// Marks the NAL unit started by <see cref="BeginNalUnit"/> as complete.
+    /// </summary>
+    internal void EndNalUnit()
+    {
+        if (_openNalUnitOffset < 0)
+        {
+            return;
+        }
+
+        _nalUnits.Add((_openNalUnitOffset, _length - _openNalUnitOffset));
+        _openNalUnitOffset = -1;
+    }
+
+    /// <summary>
+    /// True while a NAL unit has been started but not ended.
+    /// </summary>
+    internal bool HasOpenNalUnit => _openNalUnitOffset >= 0;
+
+    /// <summary>
+    /// Removes the NAL unit in progress, e.g. because one of its fragments was lost.
+    /// </summary>
+    internal void DiscardOpenNalUnit()
+    {
+        if (_openNalUnitOffset < 0)
+        {
+            return;
+        }
+
+        _length = _openNalUnitOffset;
+        _openNalUnitOffset = -1;
+    }
+
+    /// <summary>
+    /// Replaces the payload of a complete NAL unit, keeping its start code, e.g. with a rewritten parameter set. The
+    /// data behind it moves if the size changes.
+    /// </summary>
+    /// <param name="index">Index of the NAL unit.</param>
+    /// <param name="nalUnit">New NAL unit without start code.</param>
+    internal void ReplaceNalUnit(int index, ReadOnlySpan<byte> nalUnit)
+    {
+        var (offset, length) = _nalUnits[index];
+        int payloadOffset = offset + 4;
+        int oldEnd = offset + length;
+        int delta = nalUnit.Length - (length - 4);
+        if (delta > 0)
+        {
+            EnsureCapacity(_length + delta);
+        }
+
+        _buffer.AsSpan(oldEnd, _length - oldEnd).CopyTo(_buffer.AsSpan(oldEnd + delta));
+        nalUnit.CopyTo(_buffer.AsSpan(payloadOffset));
+        _length += delta;
+
+        _nalUnits[index] = (offset, nalUnit.Length + 4);
+        for (int i = index + 1; i < _nalUnits.Count; i++)
+        {
+            var (followingOffset, followingLength) = _nalUnits[i];
+            _nalUnits[i] = (followingOffset + delta, followingLength);
+        }
+
+        if (_openNalUnitOffset > offset)
+        {
+            _openNalUnitOffset += delta;
+        }
+    }
+
+    /// <summary>
+    /// Discards all data, keeping the arena for reuse.
+    /// </summary>
+    internal void Clear()
+    {
+        _length = 0;
+        _openNalUnitOffset = -1;
+        _nalUnits.Clear();
+        Timestamp = 0;
+        IsKeyFrame = false;
+        IsDamaged = false;
+    }
+
+    private void EnsureCapacity(int required)
+    {
+        if (required <= _buffer.Length)
+        {
+            return;
+        }
+
+        var larger = ArrayPool<byte>.Shared.Rent(Math.Max(required, _buffer.Length * 2));
+        _buffer.AsSpan(0, _length).CopyTo(larger);
+        ArrayPool<byte>.Shared.Return(_buffer);
+        _buffer = larger;
+    }
+
+    /// <summary>
+    /// Returns the frame and its arena to the pool.
+    /// </summary>
+    public void Dispose()
+    {
+        if (_isDisposed)
+        {
+            return;
+        }
+
+        _isDisposed = true;
+        Clear();
+
+        if (Interlocked.Increment(ref _pooledCount) <= MAX_POOLED_FRAMES)
+        {
+            Pool.Enqueue(this);
+        }
+        else
+        {
+            Interlocked.Decrement(ref _pooledCount);
+            ArrayPool<byte>.Shared.Return(_buffer);
+            _buffer = Array.Empty<byte>();
+        }
+    }
+}
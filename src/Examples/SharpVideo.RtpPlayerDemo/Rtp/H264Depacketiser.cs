@@ -1,248 +1,316 @@
+using System.Buffers.Binary;
+
 namespace SharpVideo.RtpPlayerDemo.Rtp;
 
+/// <summary>
+/// Reassembles H264 frames from RTP payloads (RFC 6184).
+/// </summary>
+/// <remarks>
+/// NAL units are written as Annex-B straight from the payload spans into a pooled <see cref="EncodedFrame"/>, so the
+/// only copy per byte is the one into the frame arena. Single NAL units, STAP-A, STAP-B, MTAP16, MTAP24, FU-A and
+/// FU-B are supported. NAL units of interleaved mode aggregation packets are emitted in transmission order, the
+/// decoding order numbers are skipped but not used for reordering.
+/// </remarks>
 internal class H264Depacketiser
 {
-    const int SPS = 7;
-    const int PPS = 8;
-    const int NON_IDR_SLICE = 5;
+    const int IDR_SLICE = 5;
+
+    const int STAP_A = 24;
+    const int STAP_B = 25;
+    const int MTAP16 = 26;
+    const int MTAP24 = 27;
+    const int FU_A = 28;
+    const int FU_B = 29;
 
     //Payload Helper Fields
-    private readonly MemoryStream _fragmentedNal = new(); // used to concatenate fragmented H264 NALs where NALs are splitted over RTP packets
-    private readonly List<KeyValuePair<int, byte[]>> _temporaryRtpPayloads = new List<KeyValuePair<int, byte[]>>(); // used to assemble the RTP packets that form one RTP Frame
-    uint _previousTimestamp = 0;
+    private EncodedFrame? _currentFrame; // arena of the RTP frame being assembled
+    private bool _isFragmentValid; // false if a packet of the fragmented NAL in progress was lost
+    private bool _isFrameDamaged; // true if a packet of the current frame was lost
+    private bool _isCurrentKeyFrame;
+    private int _lastFrameSize;
+    uint _currentTimestamp = 0;
     int norm, fu_a, fu_b, stap_a, stap_b, mtap16, mtap24 = 0; // used for diagnostics stats
 
-    public virtual MemoryStream? ProcessRTPPayload(byte[] rtpPayload, ushort seqNum, uint timestamp, int markbit, out bool isKeyFrame)
+    /// <summary>
+    /// Number of frames emitted although some of their packets were lost. Only NAL units that were received
+    /// completely are included in such frames.
+    /// </summary>
+    public int DamagedFrames { get; private set; }
+
+    /// <summary>
+    /// Number of frames completed by a timestamp change because the packet carrying the marker bit was lost.
+    /// </summary>
+    public int FramesWithoutMarker { get; private set; }
+
+    /// <summary>
+    /// Number of payloads that were truncated or otherwise malformed.
+    /// </summary>
+    public int MalformedPayloads { get; private set; }
+
+    /// <summary>
+    /// Processes the next RTP payload of the stream. Payloads must be supplied in sequence number order (the jitter
+    /// buffer takes care of that), losses must be reported with <see cref="NotifyPacketLoss"/>.
+    /// </summary>
+    /// <returns>The frame completed by the marker bit of this packet, or null. The caller owns the frame.</returns>
+    public virtual EncodedFrame? ProcessRTPPayload(ReadOnlySpan<byte> rtpPayload, uint timestamp, int markbit)
     {
-        List<byte[]> nalUnits = ProcessRTPPayloadAsNals(rtpPayload, seqNum, timestamp, markbit, out isKeyFrame);
+        if (_currentFrame != null && _currentTimestamp != timestamp)
+        {
+            // The marker of the previous frame never arrived. The caller is expected to collect it with
+            // TryCompletePendingFrame first; anything still here is discarded.
+            _currentFrame.Dispose();
+            ResetFrame();
+        }
 
-        if (nalUnits != null)
+        if (_currentFrame == null)
         {
-            //Calculate total buffer size
-            long totalBufferSize = 0;
-            for (int i = 0; i < nalUnits.Count; i++)
-            {
-                var nal = nalUnits[i];
-                long remaining = nal.Length;
-
-                if (remaining > 0)
-                {
-                    totalBufferSize += remaining + 4; //nal + 0001
-                }
-                else
-                {
-                    nalUnits.RemoveAt(i);
-                    i--;
-                }
-            }
+            _currentFrame = EncodedFrame.Rent(_lastFrameSize + _lastFrameSize / 4);
+            _currentTimestamp = timestamp;
+        }
 
-            //Merge nals in same buffer using Annex-B separator (0001)
-            MemoryStream data = new MemoryStream(new byte[totalBufferSize]);
-            foreach (var nal in nalUnits)
-            {
-                data.WriteByte(0);
-                data.WriteByte(0);
-                data.WriteByte(0);
-                data.WriteByte(1);
-                data.Write(nal, 0, nal.Length);
-            }
-            return data;
+        ProcessH264Packet(_currentFrame, rtpPayload);
+
+        if (markbit == 1)
+        {
+            return CompleteFrame();
         }
-        return null;
+
+        return null; // we don't have a frame yet. Keep accumulating RTP packets
     }
 
-    private List<byte[]>? ProcessRTPPayloadAsNals(byte[] rtpPayload, ushort seqNum, uint timestamp, int markbit, out bool isKeyFrame)
+    /// <summary>
+    /// Completes the frame in progress if the next packet belongs to a different RTP timestamp. This recovers
+    /// frames whose marker packet was lost instead of discarding or merging them.
+    /// </summary>
+    public bool TryCompletePendingFrame(uint nextTimestamp, out EncodedFrame? frame)
     {
-        List<byte[]> nal_units = ProcessH264Payload(rtpPayload, seqNum, timestamp, markbit, out isKeyFrame);
+        frame = null;
+
+        if (_currentFrame == null || _currentTimestamp == nextTimestamp)
+        {
+            return false;
+        }
 
-        return nal_units;
+        FramesWithoutMarker++;
+        _isFrameDamaged = true;
+        frame = CompleteFrame();
+        return frame != null;
     }
 
-    private List<byte[]>? ProcessH264Payload(byte[] rtp_payload, ushort seqNum, uint rtp_timestamp, int rtp_marker, out bool isKeyFrame)
+    /// <summary>
+    /// Informs the depacketiser that packets of the stream were lost. A fragmented NAL unit in progress can no
+    /// longer be completed and is dropped, NAL units already assembled for the frame are kept.
+    /// </summary>
+    public void NotifyPacketLoss()
     {
-        if (_previousTimestamp != rtp_timestamp && _previousTimestamp > 0)
+        _isFragmentValid = false;
+        if (_currentFrame != null)
         {
-            _temporaryRtpPayloads.Clear();
-            _previousTimestamp = 0;
-            _fragmentedNal.SetLength(0);
+            _currentFrame.DiscardOpenNalUnit();
+            _isFrameDamaged = true;
         }
+    }
+
+    private EncodedFrame? CompleteFrame()
+    {
+        var frame = _currentFrame!;
 
-        // Add to the list of payloads for the current Frame of video
-        _temporaryRtpPayloads.Add(new KeyValuePair<int, byte[]>(seqNum, rtp_payload)); // TODO could optimise this and go direct to Process Frame if just 1 packet in frame
-        if (rtp_marker == 1)
+        // A fragmented NAL without its end fragment is incomplete.
+        if (frame.HasOpenNalUnit)
         {
-            //Reorder to prevent UDP incorrect package order
-            if (_temporaryRtpPayloads.Count > 1)
-            {
-                _temporaryRtpPayloads.Sort((a, b) => {
-                    // Detect wraparound of sequence to sort packets correctly (Assumption that no more then 2000 packets per frame)
-                    return (Math.Abs(b.Key - a.Key) > (0xFFFF - 2000)) ? -a.Key.CompareTo(b.Key) : a.Key.CompareTo(b.Key);
-                });
-            }
+            frame.DiscardOpenNalUnit();
+            _isFrameDamaged = true;
+        }
 
-            // End Marker is set. Process the list of RTP Packets (forming 1 RTP frame) and save the NALs to a file
-            List<byte[]> nal_units = ProcessH264PayloadFrame(_temporaryRtpPayloads, out isKeyFrame);
-            _temporaryRtpPayloads.Clear();
-            _previousTimestamp = 0;
-            _fragmentedNal.SetLength(0);
+        frame.Timestamp = _currentTimestamp;
+        frame.IsKeyFrame = _isCurrentKeyFrame;
+        frame.IsDamaged = _isFrameDamaged;
+        ResetFrame();
 
-            return nal_units;
+        if (frame.NalUnitCount == 0)
+        {
+            frame.Dispose();
+            return null;
         }
-        else
+
+        if (frame.IsDamaged)
         {
-            isKeyFrame = false;
-            _previousTimestamp = rtp_timestamp;
-            return null; // we don't have a frame yet. Keep accumulating RTP packets
+            DamagedFrames++;
         }
+
+        _lastFrameSize = frame.Length;
+        return frame;
     }
 
-    // Process a RTP Frame. A RTP Frame can consist of several RTP Packets which have the same Timestamp
-    // Returns a list of NAL Units (with no 00 00 00 01 header and with no Size header)
-    protected virtual List<byte[]> ProcessH264PayloadFrame(List<KeyValuePair<int, byte[]>> rtp_payloads, out bool isKeyFrame)
+    private void ResetFrame()
     {
-        bool? isKeyFrameNullable = null;
-        List<byte[]> nalUnits = new List<byte[]>(); // Stores the NAL units for a Video Frame. May be more than one NAL unit in a video frame.
+        _currentFrame = null;
+        _isFragmentValid = false;
+        _isFrameDamaged = false;
+        _isCurrentKeyFrame = false;
+    }
 
-        for (int payload_index = 0; payload_index < rtp_payloads.Count; payload_index++)
+    // Process one RTP Packet of the current RTP Frame. A RTP Frame can consist of several RTP Packets which have the same Timestamp
+    // Complete NAL Units are appended to the frame with a 00 00 00 01 start code
+    protected virtual void ProcessH264Packet(EncodedFrame frame, ReadOnlySpan<byte> rtp_payload)
+    {
+        if (rtp_payload.Length == 0)
         {
-            // Examine the first rtp_payload and the first byte (the NAL header)
-            int nal_header_f_bit = (rtp_payloads[payload_index].Value[0] >> 7) & 0x01;
-            int nal_header_nri = (rtp_payloads[payload_index].Value[0] >> 5) & 0x03;
-            int nal_header_type = (rtp_payloads[payload_index].Value[0] >> 0) & 0x1F;
+            return;
+        }
 
-            // If the Nal Header Type is in the range 1..23 this is a normal NAL (not fragmented)
-            // So write the NAL to the file
-            if (nal_header_type >= 1 && nal_header_type <= 23)
-            {
-                norm++;
-                //Check if is Key Frame
-                CheckKeyFrame(nal_header_type, ref isKeyFrameNullable);
+        // Examine the first byte (the NAL header)
+        int nal_header_f_bit = (rtp_payload[0] >> 7) & 0x01;
+        int nal_header_nri = (rtp_payload[0] >> 5) & 0x03;
+        int nal_header_type = (rtp_payload[0] >> 0) & 0x1F;
 
-                nalUnits.Add(rtp_payloads[payload_index].Value);
-            }
-            // There are 4 types of Aggregation Packet (split over RTP payloads)
-            else if (nal_header_type == 24)
-            {
-                stap_a++;
-
-                // RTP packet contains multiple NALs, each with a 16 bit header
-                //   Read 16 byte size
-                //   Read NAL
-                try
-                {
-                    int ptr = 1; // start after the nal_header_type which was '24'
-                    // if we have at least 2 more bytes (the 16 bit size) then consume more data
-                    while (ptr + 2 < (rtp_payloads[payload_index].Value.Length - 1))
-                    {
-                        int size = (rtp_payloads[payload_index].Value[ptr] << 8) + (rtp_payloads[payload_index].Value[ptr + 1] << 0);
-                        ptr = ptr + 2;
-                        byte[] nal = new byte[size];
-                        Buffer.BlockCopy(rtp_payloads[payload_index].Value, ptr, nal, 0, size); // copy the NAL
-
-                        byte reconstructed_nal_type = (byte)((nal[0] >> 0) & 0x1F);
-                        //Check if is Key Frame
-                        CheckKeyFrame(reconstructed_nal_type, ref isKeyFrameNullable);
-
-                        nalUnits.Add(nal); // Add to list of NALs for this RTP frame. Start Codes like 00 00 00 01 get added later
-                        ptr = ptr + size;
-                    }
-                }
-                catch
-                {
-                }
-            }
-            else if (nal_header_type == 25)
+        // If the Nal Header Type is in the range 1..23 this is a normal NAL (not fragmented)
+        if (nal_header_type >= 1 && nal_header_type <= 23)
+        {
+            norm++;
+            AppendNalUnit(frame, rtp_payload);
+        }
+        // There are 4 types of Aggregation Packet (several NALs in one RTP payload)
+        else if (nal_header_type == STAP_A)
+        {
+            stap_a++;
+            // [STAP-A NAL HDR] { [16 bit size] [NAL] }*
+            ProcessAggregationUnits(frame, rtp_payload.Slice(1), donFieldSize: 0, timestampOffsetSize: 0);
+        }
+        else if (nal_header_type == STAP_B)
+        {
+            stap_b++;
+            // [STAP-B NAL HDR] [16 bit DON] { [16 bit size] [NAL] }*
+            if (rtp_payload.Length < 3)
             {
-                stap_b++;
+                MalformedPayloads++;
+                return;
             }
-            else if (nal_header_type == 26)
+
+            ProcessAggregationUnits(frame, rtp_payload.Slice(3), donFieldSize: 0, timestampOffsetSize: 0);
+        }
+        else if (nal_header_type == MTAP16 || nal_header_type == MTAP24)
+        {
+            if (nal_header_type == MTAP16)
             {
                 mtap16++;
             }
-            else if (nal_header_type == 27)
+            else
             {
                 mtap24++;
             }
-            else if (nal_header_type == 28)
+
+            // [MTAP NAL HDR] [16 bit DONB] { [16 bit size] [8 bit DOND] [16/24 bit TS offset] [NAL] }*
+            if (rtp_payload.Length < 3)
+            {
+                MalformedPayloads++;
+                return;
+            }
+
+            ProcessAggregationUnits(frame, rtp_payload.Slice(3), donFieldSize: 1, timestampOffsetSize: nal_header_type == MTAP16 ? 2 : 3);
+        }
+        else if (nal_header_type == FU_A || nal_header_type == FU_B)
+        {
+            if (nal_header_type == FU_A)
             {
                 fu_a++;
+            }
+            else
+            {
+                fu_b++;
+            }
 
-                // Parse Fragmentation Unit Header
-                int fu_indicator = rtp_payloads[payload_index].Value[0];
-                int fu_header_s = (rtp_payloads[payload_index].Value[1] >> 7) & 0x01;  // start marker
-                int fu_header_e = (rtp_payloads[payload_index].Value[1] >> 6) & 0x01;  // end marker
-                int fu_header_r = (rtp_payloads[payload_index].Value[1] >> 5) & 0x01;  // reserved. should be 0
-                int fu_header_type = (rtp_payloads[payload_index].Value[1] >> 0) & 0x1F; // Original NAL unit header
-
-                // Check Start and End flags
-                if (fu_header_s == 1 && fu_header_e == 0)
-                {
-                    // Start of Fragment.
-                    // Initialise the _fragmentedNal byte array
-                    // Build the NAL header with the original F and NRI flags but use the the Type field from the fu_header_type
-                    byte reconstructed_nal_type = (byte)((nal_header_f_bit << 7) + (nal_header_nri << 5) + fu_header_type);
-
-                    // Empty the stream
-                    _fragmentedNal.SetLength(0);
-
-                    // Add reconstructed_nal_type byte to the memory stream
-                    _fragmentedNal.WriteByte((byte)reconstructed_nal_type);
-
-                    // copy the rest of the RTP payload to the memory stream
-                    _fragmentedNal.Write(rtp_payloads[payload_index].Value, 2, rtp_payloads[payload_index].Value.Length - 2);
-                }
-
-                if (fu_header_s == 0 && fu_header_e == 0)
-                {
-                    // Middle part of Fragment
-                    // Append this payload to the _fragmentedNal
-                    // Data starts after the NAL Unit Type byte and the FU Header byte
-                    _fragmentedNal.Write(rtp_payloads[payload_index].Value, 2, rtp_payloads[payload_index].Value.Length - 2);
-                }
-
-                if (fu_header_s == 0 && fu_header_e == 1)
-                {
-                    // End part of Fragment
-                    // Append this payload to the _fragmentedNal
-                    // Data starts after the NAL Unit Type byte and the FU Header byte
-                    _fragmentedNal.Write(rtp_payloads[payload_index].Value, 2, rtp_payloads[payload_index].Value.Length - 2);
-
-                    var fragmeted_nal_array = _fragmentedNal.ToArray();
-                    byte reconstructed_nal_type = (byte)((fragmeted_nal_array[0] >> 0) & 0x1F);
-
-                    //Check if is Key Frame
-                    CheckKeyFrame(reconstructed_nal_type, ref isKeyFrameNullable);
-
-                    // Add the NAL to the array of NAL units
-                    nalUnits.Add(fragmeted_nal_array);
-                    _fragmentedNal.SetLength(0);
-                }
+            // [FU indicator] [FU header] ([16 bit DON], FU-B only) [fragment]
+            int headerLength = nal_header_type == FU_B ? 4 : 2;
+            if (rtp_payload.Length <= headerLength)
+            {
+                MalformedPayloads++;
+                return;
             }
 
-            else if (nal_header_type == 29)
+            // Parse Fragmentation Unit Header
+            int fu_header_s = (rtp_payload[1] >> 7) & 0x01;  // start marker
+            int fu_header_e = (rtp_payload[1] >> 6) & 0x01;  // end marker
+            int fu_header_type = (rtp_payload[1] >> 0) & 0x1F; // Original NAL unit header
+            var fragment = rtp_payload.Slice(headerLength);
+
+            if (fu_header_s == 1)
             {
-                fu_b++;
+                // Start of Fragment.
+                // Build the NAL header with the original F and NRI flags but use the the Type field from the fu_header_type
+                byte reconstructed_nal_header = (byte)((nal_header_f_bit << 7) + (nal_header_nri << 5) + fu_header_type);
+
+                // A previous fragmented NAL without end fragment is dropped
+                frame.DiscardOpenNalUnit();
+
+                frame.BeginNalUnit();
+                frame.Append(1)[0] = reconstructed_nal_header;
+                _isFragmentValid = true;
+                CheckKeyFrame(fu_header_type);
+            }
+            else if (!_isFragmentValid || !frame.HasOpenNalUnit)
+            {
+                // The start (or a middle part) of this NAL was lost, the remaining fragments are useless
+                return;
             }
-        }
 
-        isKeyFrame = isKeyFrameNullable ?? false;
+            // Data starts after the FU indicator and the FU header byte
+            frame.Append(fragment);
 
-        // Output all the NALs that form one RTP Frame (one frame of video)
-        return nalUnits;
+            if (fu_header_e == 1)
+            {
+                frame.EndNalUnit();
+                _isFragmentValid = false;
+            }
+        }
+        else
+        {
+            MalformedPayloads++;
+        }
     }
 
-    private void CheckKeyFrame(int nalType, ref bool? isKeyFrame)
+    /// <summary>
+    /// Appends the NAL units of an aggregation packet.
+    /// </summary>
+    /// <param name="frame">Frame arena to write to.</param>
+    /// <param name="units">Payload after the aggregation header (and DON/DONB field).</param>
+    /// <param name="donFieldSize">Size of the per unit DOND field (MTAP only).</param>
+    /// <param name="timestampOffsetSize">Size of the per unit timestamp offset field (MTAP only).</param>
+    private void ProcessAggregationUnits(EncodedFrame frame, ReadOnlySpan<byte> units, int donFieldSize, int timestampOffsetSize)
     {
-        if (isKeyFrame == null)
+        int unitHeaderSize = 2 + donFieldSize + timestampOffsetSize;
+
+        while (units.Length >= unitHeaderSize)
         {
-            isKeyFrame = nalType == SPS || nalType == PPS ? new bool?(true) :
-                (nalType == NON_IDR_SLICE ? new bool?(false) : null);
+            // The size field counts the NAL unit only, not the DOND and TS offset fields
+            int nalSize = BinaryPrimitives.ReadUInt16BigEndian(units);
+            if (nalSize == 0 || units.Length < unitHeaderSize + nalSize)
+            {
+                MalformedPayloads++;
+                return;
+            }
+
+            AppendNalUnit(frame, units.Slice(unitHeaderSize, nalSize));
+            units = units.Slice(unitHeaderSize + nalSize);
         }
-        else
+    }
+
+    private void AppendNalUnit(EncodedFrame frame, ReadOnlySpan<byte> nal)
+    {
+        //Check if is Key Frame
+        CheckKeyFrame(nal[0] & 0x1F);
+
+        frame.BeginNalUnit();
+        frame.Append(nal);
+        frame.EndNalUnit();
+    }
+
+    private void CheckKeyFrame(int nalType)
+    {
+        // A frame is a key frame if it carries an IDR slice, parameter sets alone do not make one
+        if (nalType == IDR_SLICE)
         {
-            isKeyFrame = nalType == SPS || nalType == PPS ?
-                (isKeyFrame.Value ? isKeyFrame : new bool?(false)) :
-                (nalType == NON_IDR_SLICE ? new bool?(false) : isKeyFrame);
+            _isCurrentKeyFrame = true;
         }
     }
 }
@@ -0,0 +1,259 @@
+using System.Buffers.Binary;
+using SharpVideo.H264;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Splits H264 access units into RTP packets (RFC 6184, non-interleaved mode).
+/// </summary>
+/// <remarks>
+/// Consecutive NAL units that fit into one packet, typically SPS and PPS in front of an IDR slice, are aggregated
+/// into STAP-A packets; a STAP-A that would only hold a single NAL unit is sent as a single NAL unit packet instead.
+/// NAL units larger than a packet are split into FU-A fragments of equal size (the last one may be shorter), which
+/// lets <see cref="UdpSender"/> hand them to the kernel as one UDP_SEGMENT buffer. Packets are written straight into
+/// the slots of an <see cref="RtpPacketBatch"/>, the NAL unit payload is copied once.
+/// </remarks>
+internal sealed class H264Packetiser
+{
+    /// <summary>
+    /// Packet size that fits an Ethernet MTU with IPv6, UDP and some room for tunnels.
+    /// </summary>
+    public const int DEFAULT_MAX_PACKET_SIZE = 1200;
+
+    const int STAP_A = 24;
+    const int FU_A = 28;
+    const int STAP_A_HEADER_LENGTH = 1;
+    const int NALU_SIZE_LENGTH = 2;
+    const int FU_A_HEADER_LENGTH = 2;
+
+    private readonly byte _payloadType;
+    private readonly uint _ssrc;
+    private readonly int _maxPayloadSize;
+    private ushort _sequenceNumber;
+
+    // Access unit in progress
+    private RtpPacketBatch? _batch;
+    private uint _timestamp;
+    private int _aggregationLength; // bytes written to the open STAP-A packet, 0 if none is open
+    private int _aggregatedNalUnits;
+
+    /// <param name="payloadType">Dynamic RTP payload type of the stream.</param>
+    /// <param name="ssrc">Synchronisation source of the stream.</param>
+    /// <param name="maxPacketSize">Largest RTP packet, header included.</param>
+    /// <param name="initialSequenceNumber">Sequence number of the first packet, should be random (RFC 3550).</param>
+    public H264Packetiser(byte payloadType, uint ssrc, int maxPacketSize = DEFAULT_MAX_PACKET_SIZE, ushort initialSequenceNumber = 0)
+    {
+        if (maxPacketSize < RTPHeader.MIN_HEADER_LEN + FU_A_HEADER_LENGTH + 1)
+        {
+            throw new ArgumentOutOfRangeException(nameof(maxPacketSize), $"An RTP packet size of {maxPacketSize} bytes is too small.");
+        }
+
+        _payloadType = payloadType;
+        _ssrc = ssrc;
+        _maxPayloadSize = maxPacketSize - RTPHeader.MIN_HEADER_LEN;
+        _sequenceNumber = initialSequenceNumber;
+        MaxPacketSize = maxPacketSize;
+    }
+
+    public int MaxPacketSize { get; }
+
+    public uint Ssrc => _ssrc;
+
+    /// <summary>
+    /// Sequence number of the next packet.
+    /// </summary>
+    public ushort SequenceNumber => _sequenceNumber;
+
+    public int SingleNalUnitPackets { get; private set; }
+
+    public int AggregationPackets { get; private set; }
+
+    public int FragmentationUnits { get; private set; }
+
+    /// <summary>
+    /// Packetises the NAL units of one access unit, the last packet carries the marker bit.
+    /// </summary>
+    public void Packetise(IReadOnlyList<H264Nalu> accessUnit, uint timestamp, RtpPacketBatch batch)
+    {
+        BeginAccessUnit(batch, timestamp);
+        for (int i = 0; i < accessUnit.Count; i++)
+        {
+            AddNalUnit(accessUnit[i].WithoutHeader);
+        }
+
+        EndAccessUnit();
+    }
+
+    /// <summary>
+    /// Packetises a received frame again, e.g. to forward it to other receivers.
+    /// </summary>
+    public void Packetise(EncodedFrame frame, RtpPacketBatch batch)
+    {
+        BeginAccessUnit(batch, frame.Timestamp);
+        for (int i = 0; i < frame.NalUnitCount; i++)
+        {
+            // Frames hold 4 byte start codes
+            AddNalUnit(frame.GetNalUnit(i).Slice(4));
+        }
+
+        EndAccessUnit();
+    }
+
+    public void BeginAccessUnit(RtpPacketBatch batch, uint timestamp)
+    {
+        if (batch.MaxPacketSize < MaxPacketSize)
+        {
+            throw new ArgumentException($"The batch holds packets of up to {batch.MaxPacketSize} bytes, {MaxPacketSize} are required.", nameof(batch));
+        }
+
+        _batch = batch;
+        _timestamp = timestamp;
+        _aggregationLength = 0;
+        _aggregatedNalUnits = 0;
+    }
+
+    /// <summary>
+    /// Adds a NAL unit without start code to the access unit started by <see cref="BeginAccessUnit"/>.
+    /// </summary>
+    public void AddNalUnit(ReadOnlySpan<byte> nalUnit)
+    {
+        if (_batch == null)
+        {
+            throw new InvalidOperationException("No access unit has been started.");
+        }
+
+        if (nalUnit.IsEmpty)
+        {
+            return;
+        }
+
+        int aggregatedSize = NALU_SIZE_LENGTH + nalUnit.Length;
+        if (_aggregationLength > 0 && _aggregationLength + aggregatedSize > _maxPayloadSize)
+        {
+            CloseAggregation();
+        }
+
+        if (STAP_A_HEADER_LENGTH + aggregatedSize <= _maxPayloadSize)
+        {
+            Aggregate(nalUnit);
+        }
+        else
+        {
+            Fragment(nalUnit);
+        }
+    }
+
+    /// <summary>
+    /// Completes the access unit and sets the marker bit on its last packet.
+    /// </summary>
+    public void EndAccessUnit()
+    {
+        if (_batch == null)
+        {
+            return;
+        }
+
+        CloseAggregation();
+        if (_batch.Count > 0)
+        {
+            _batch.GetWritablePacket(_batch.Count - 1)[1] |= 0x80;
+        }
+
+        _batch = null;
+    }
+
+    private void Aggregate(ReadOnlySpan<byte> nalUnit)
+    {
+        var packet = _batch!.BeginPacket();
+        var payload = packet.Slice(RTPHeader.MIN_HEADER_LEN);
+        if (_aggregationLength == 0)
+        {
+            WriteHeader(packet);
+            payload[0] = 0;
+            _aggregationLength = STAP_A_HEADER_LENGTH;
+        }
+
+        // F is the OR, NRI the maximum of the aggregated NAL units (RFC 6184 5.7.1)
+        byte f = (byte)((payload[0] | nalUnit[0]) & 0x80);
+        byte nri = (byte)Math.Max(payload[0] & 0x60, nalUnit[0] & 0x60);
+        payload[0] = (byte)(f | nri | STAP_A);
+
+        BinaryPrimitives.WriteUInt16BigEndian(payload.Slice(_aggregationLength), (ushort)nalUnit.Length);
+        nalUnit.CopyTo(payload.Slice(_aggregationLength + NALU_SIZE_LENGTH));
+        _aggregationLength += NALU_SIZE_LENGTH + nalUnit.Length;
+        _aggregatedNalUnits++;
+    }
+
+    private void CloseAggregation()
+    {
+        if (_aggregationLength == 0)
+        {
+            return;
+        }
+
+        var packet = _batch!.BeginPacket();
+        int payloadLength = _aggregationLength;
+        if (_aggregatedNalUnits == 1)
+        {
+            // Not worth a STAP-A, move the NAL unit over the aggregation headers
+            int nalLength = payloadLength - STAP_A_HEADER_LENGTH - NALU_SIZE_LENGTH;
+            packet.Slice(RTPHeader.MIN_HEADER_LEN + STAP_A_HEADER_LENGTH + NALU_SIZE_LENGTH, nalLength)
+                .CopyTo(packet.Slice(RTPHeader.MIN_HEADER_LEN));
+            payloadLength = nalLength;
+            SingleNalUnitPackets++;
+        }
+        else
+        {
+            AggregationPackets++;
+        }
+
+        _batch.EndPacket(RTPHeader.MIN_HEADER_LEN + payloadLength);
+        _aggregationLength = 0;
+        _aggregatedNalUnits = 0;
+    }
+
+    private void Fragment(ReadOnlySpan<byte> nalUnit)
+    {
+        byte indicator = (byte)((nalUnit[0] & 0xE0) | FU_A);
+        byte type = (byte)(nalUnit[0] & 0x1F);
+        var data = nalUnit.Slice(1);
+
+        // Equal fragments rather than full ones followed by a short remainder
+        int maxFragmentSize = _maxPayloadSize - FU_A_HEADER_LENGTH;
+        int fragmentCount = (data.Length + maxFragmentSize - 1) / maxFragmentSize;
+        int fragmentSize = (data.Length + fragmentCount - 1) / fragmentCount;
+
+        for (int offset = 0; offset < data.Length; offset += fragmentSize)
+        {
+            int length = Math.Min(fragmentSize, data.Length - offset);
+            var packet = _batch!.BeginPacket();
+            WriteHeader(packet);
+
+            var payload = packet.Slice(RTPHeader.MIN_HEADER_LEN);
+            payload[0] = indicator;
+            payload[1] = type;
+            if (offset == 0)
+            {
+                payload[1] |= 0x80;
+            }
+
+            if (offset + length == data.Length)
+            {
+                payload[1] |= 0x40;
+            }
+
+            data.Slice(offset, length).CopyTo(payload.Slice(FU_A_HEADER_LENGTH));
+            _batch.EndPacket(RTPHeader.MIN_HEADER_LEN + FU_A_HEADER_LENGTH + length);
+            FragmentationUnits++;
+        }
+    }
+
+    private void WriteHeader(Span<byte> packet)
+    {
+        packet[0] = RTPHeader.RTP_VERSION << 6;
+        packet[1] = _payloadType;
+        BinaryPrimitives.WriteUInt16BigEndian(packet.Slice(2), _sequenceNumber++);
+        BinaryPrimitives.WriteUInt32BigEndian(packet.Slice(4), _timestamp);
+        BinaryPrimitives.WriteUInt32BigEndian(packet.Slice(8), _ssrc);
+    }
+}
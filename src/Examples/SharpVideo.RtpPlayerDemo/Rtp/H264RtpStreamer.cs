@@ -0,0 +1,261 @@
+using System.Diagnostics;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.Versioning;
+using System.Security.Cryptography;
+using Microsoft.Extensions.Logging;
+using SharpVideo.H264;
+using SharpVideo.V4L2Decoding.NaluSources;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Settings of <see cref="H264RtpStreamer"/>.
+/// </summary>
+public sealed class RtpSendOptions
+{
+    /// <summary>
+    /// Dynamic RTP payload type announced for H264.
+    /// </summary>
+    public byte PayloadType { get; set; } = 96;
+
+    /// <summary>
+    /// Largest RTP packet, header included.
+    /// </summary>
+    public int MaxPacketSize { get; set; } = H264Packetiser.DEFAULT_MAX_PACKET_SIZE;
+
+    /// <summary>
+    /// Sending rate per destination in bits per second, 0 sends every frame as one burst.
+    /// </summary>
+    public long PacingBitrate { get; set; }
+
+    /// <summary>
+    /// Frame rate assumed for sources without timestamps, such as raw Annex-B files.
+    /// </summary>
+    public double FrameRate { get; set; } = 25;
+
+    /// <summary>
+    /// Playback rate relative to the source timing, 2 sends twice as fast. 0 sends as fast as possible.
+    /// </summary>
+    public double Speed { get; set; } = 1.0;
+
+    /// <summary>
+    /// Use UDP_SEGMENT for runs of equally sized packets.
+    /// </summary>
+    public bool EnableGso { get; set; } = true;
+}
+
+/// <summary>
+/// Result of <see cref="H264RtpStreamer.Stream"/>.
+/// </summary>
+public sealed record RtpSendResult(int FramesSent, long PacketsSent, TimeSpan Duration);
+
+/// <summary>
+/// Sends H264 as RTP to one or more receivers: NAL unit sources such as files, or received frames that are forwarded.
+/// </summary>
+/// <remarks>
+/// Every frame is packetised into a reused <see cref="RtpPacketBatch"/> and handed to <see cref="UdpSender"/> in as
+/// few sendmmsg calls as possible. Frames of a source are sent at their timestamps (the DTS if the container has one,
+/// otherwise the frame rate), scaled by <see cref="RtpSendOptions.Speed"/>. Sending to the player's own port on
+/// loopback makes it a load generator for the receive path.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed class H264RtpStreamer : IDisposable
+{
+    private const int RTP_CLOCK_RATE = 90000;
+
+    private readonly RtpSendOptions _options;
+    private readonly ILogger _logger;
+    private readonly Socket _socket;
+    private readonly UdpSender _sender;
+    private readonly H264Packetiser _packetiser;
+    private readonly RtpPacketBatch _batch;
+    private readonly List<H264Nalu> _accessUnit = new();
+
+    /// <param name="destinations">Receivers, every packet is sent to all of them.</param>
+    /// <param name="options">Packetisation, pacing and timing.</param>
+    /// <param name="logger">Logger.</param>
+    public H264RtpStreamer(IReadOnlyList<IPEndPoint> destinations, RtpSendOptions options, ILogger logger)
+    {
+        if (options.Speed < 0)
+        {
+            throw new ArgumentOutOfRangeException(nameof(options), "The send speed must not be negative.");
+        }
+
+        _options = options;
+        _logger = logger;
+
+        // One dual mode socket reaches IPv4 and IPv6 receivers
+        bool isIPv4Only = destinations.All(d => d.AddressFamily == AddressFamily.InterNetwork);
+        _socket = new Socket(isIPv4Only ? AddressFamily.InterNetwork : AddressFamily.InterNetworkV6, SocketType.Dgram, ProtocolType.Udp);
+        if (!isIPv4Only)
+        {
+            _socket.DualMode = true;
+        }
+
+        _socket.SendBufferSize = 4 * 1024 * 1024;
+        _socket.Bind(new IPEndPoint(isIPv4Only ? IPAddress.Any : IPAddress.IPv6Any, 0));
+
+        _sender = new UdpSender(_socket, destinations, logger, options.EnableGso)
+        {
+            PacingBitrate = options.PacingBitrate
+        };
+
+        uint ssrc = (uint)RandomNumberGenerator.GetInt32(int.MaxValue);
+        ushort sequenceNumber = (ushort)RandomNumberGenerator.GetInt32(ushort.MaxValue + 1);
+        _packetiser = new H264Packetiser(options.PayloadType, ssrc, options.MaxPacketSize, sequenceNumber);
+        _batch = new RtpPacketBatch(options.MaxPacketSize);
+
+        _logger.LogInformation($"Sending H264 RTP with SSRC {ssrc:X8} to {string.Join(", ", destinations)}.");
+    }
+
+    public uint Ssrc => _packetiser.Ssrc;
+
+    public long PacketsSent => _sender.PacketsSent;
+
+    public long SendCalls => _sender.SendCalls;
+
+    /// <summary>
+    /// Sends a received frame again with its RTP timestamp. Pacing, if configured, delays the calling thread.
+    /// </summary>
+    public void SendFrame(EncodedFrame frame)
+    {
+        _batch.Clear();
+        _packetiser.Packetise(frame, _batch);
+        _sender.Send(_batch);
+    }
+
+    /// <summary>
+    /// Sends the NAL units of one access unit.
+    /// </summary>
+    public void SendAccessUnit(IReadOnlyList<H264Nalu> accessUnit, uint timestamp, CancellationToken cancellationToken = default)
+    {
+        _batch.Clear();
+        _packetiser.Packetise(accessUnit, timestamp, _batch);
+        _sender.Send(_batch, cancellationToken);
+    }
+
+    /// <summary>
+    /// Sends all NAL units of a started source on the calling thread until it completes or the operation is cancelled.
+    /// </summary>
+    public RtpSendResult Stream(INaluSource source, CancellationToken cancellationToken)
+    {
+        var queue = source.NaluQueue;
+        var stopwatch = Stopwatch.StartNew();
+        long frameInterval = (long)(RTP_CLOCK_RATE / _options.FrameRate);
+        long packetsAtStart = _sender.PacketsSent;
+        long firstTime = long.MinValue;
+        long nextTime = 0;
+        long? accessUnitTime = null;
+        bool hasSlice = false;
+        int frames = 0;
+
+        void SendPending()
+        {
+            if (_accessUnit.Count == 0)
+            {
+                return;
+            }
+
+            // Send time from the DTS, RTP timestamp from the PTS (RFC 6184 5.1)
+            var first = _accessUnit[0];
+            long decodeTime = first.Dts ?? first.Pts ?? nextTime;
+            long presentationTime = first.Pts ?? decodeTime;
+            if (firstTime == long.MinValue)
+            {
+                firstTime = decodeTime;
+            }
+
+            if (_options.Speed > 0)
+            {
+                PreciseWait.Until(stopwatch, (long)((decodeTime - firstTime) * 1_000_000_000.0 / RTP_CLOCK_RATE / _options.Speed), cancellationToken);
+            }
+
+            SendAccessUnit(_accessUnit, (uint)presentationTime, cancellationToken);
+            nextTime = decodeTime + frameInterval;
+            frames++;
+            foreach (var sent in _accessUnit)
+            {
+                sent.Release();
+            }
+
+            _accessUnit.Clear();
+            hasSlice = false;
+        }
+
+        try
+        {
+            while (!cancellationToken.IsCancellationRequested && queue.TryPop(out var nalu, Timeout.Infinite, cancellationToken))
+            {
+                if (hasSlice && IsAccessUnitStart(nalu, accessUnitTime))
+                {
+                    SendPending();
+                }
+
+                if (_accessUnit.Count == 0)
+                {
+                    accessUnitTime = nalu.Pts;
+                }
+
+                _accessUnit.Add(nalu);
+                int type = nalu.WithoutHeader.IsEmpty ? 0 : nalu.WithoutHeader[0] & 0x1F;
+                hasSlice |= type is (int)NalUnitType.CODED_SLICE_OF_NON_IDR_PICTURE_NUT or (int)NalUnitType.CODED_SLICE_OF_IDR_PICTURE_NUT;
+            }
+
+            if (!cancellationToken.IsCancellationRequested)
+            {
+                SendPending();
+            }
+        }
+        finally
+        {
+            // An access unit cut short by cancellation or a send error still holds pooled buffers
+            foreach (var pending in _accessUnit)
+            {
+                pending.Release();
+            }
+
+            _accessUnit.Clear();
+        }
+
+        var result = new RtpSendResult(frames, _sender.PacketsSent - packetsAtStart, stopwatch.Elapsed);
+        _logger.LogInformation($"Sent {result.FramesSent} frames in {result.PacketsSent} packets, {_sender.SendCalls} sendmmsg calls " +
+                               $"({_sender.SegmentedMessages} segmented, GSO {(_sender.IsGsoEnabled ? "on" : "off")}) in {result.Duration.TotalSeconds:F2} s.");
+        return result;
+    }
+
+    /// <summary>
+    /// True if the NAL unit starts a new access unit after one with a slice (7.4.1.2.3): a new timestamp, an access
+    /// unit delimiter, SEI or parameter set, or the first slice of a picture.
+    /// </summary>
+    private static bool IsAccessUnitStart(H264Nalu nalu, long? accessUnitTime)
+    {
+        if (nalu.Pts.HasValue && accessUnitTime.HasValue && nalu.Pts != accessUnitTime)
+        {
+            return true;
+        }
+
+        var data = nalu.WithoutHeader;
+        if (data.IsEmpty)
+        {
+            return false;
+        }
+
+        var type = (NalUnitType)(data[0] & 0x1F);
+        return type switch
+        {
+            NalUnitType.AUD_NUT or NalUnitType.SEI_NUT or NalUnitType.SPS_NUT or NalUnitType.PPS_NUT => true,
+
+            // first_mb_in_slice is ue(v), a leading 1 bit is the value 0
+            NalUnitType.CODED_SLICE_OF_NON_IDR_PICTURE_NUT or NalUnitType.CODED_SLICE_OF_IDR_PICTURE_NUT =>
+                data.Length > 1 && (data[1] & 0x80) != 0,
+            _ => false
+        };
+    }
+
+    public void Dispose()
+    {
+        _sender.Dispose();
+        _socket.Dispose();
+    }
+}
@@ -1,8 +1,11 @@
+using System.Buffers.Binary;
 using System.Net;
+using System.Net.NetworkInformation;
 using System.Net.Sockets;
 using System.Runtime.InteropServices;
 using Microsoft.Extensions.Logging;
 using Microsoft.Extensions.Logging.Abstractions;
+using SharpVideo.Linux.Native.C;
 
 namespace SharpVideo.RtpPlayerDemo.Rtp;
 
@@ -76,8 +79,9 @@ internal class NetServices
     /// <param name="requireEvenPort">If true the method will only return successfully if it is able to bind on an
     /// even numbered port.</param>
     /// <param name="useDualMode">If true then IPv6 sockets will be created as dual mode IPv4/IPv6 on supporting systems.</param>
+    /// <param name="reusePort">If true SO_REUSEPORT is set so that other sockets with the option can bind the same port.</param>
     /// <returns>A bound socket if successful or throws an ApplicationException if unable to bind.</returns>
-    private static Socket CreateBoundSocket(int port, IPAddress bindAddress, ProtocolType protocolType, bool requireEvenPort = false, bool useDualMode = true)
+    private static Socket CreateBoundSocket(int port, IPAddress bindAddress, ProtocolType protocolType, bool requireEvenPort = false, bool useDualMode = true, bool reusePort = false)
     {
         if (requireEvenPort && port != 0 && port % 2 != 0)
         {
@@ -103,7 +107,7 @@ internal class NetServices
         {
             try
             {
-                socket = CreateSocket(addressFamily, protocolType, useDualMode);
+                socket = CreateSocket(addressFamily, protocolType, useDualMode, reusePort);
                 BindSocket(socket, bindAddress, port);
                 int boundPort = (socket.LocalEndPoint as IPEndPoint).Port;
 
@@ -120,7 +124,7 @@ internal class NetServices
 
                         // Close the socket, create a new one and try binding on the next consecutive port.
                         socket.Close();
-                        socket = CreateSocket(addressFamily, protocolType, useDualMode);
+                        socket = CreateSocket(addressFamily, protocolType, useDualMode, reusePort);
                         BindSocket(socket, bindAddress, boundPort + 1);
                     }
                     else
@@ -224,11 +228,18 @@ internal class NetServices
         socket.Bind(new IPEndPoint(bindAddress, port));
     }
 
-    private static Socket CreateSocket(AddressFamily addressFamily, ProtocolType protocol, bool useDualMode = true)
+    private static Socket CreateSocket(AddressFamily addressFamily, ProtocolType protocol, bool useDualMode = true, bool reusePort = false)
     {
         var sock = new Socket(addressFamily, protocol == ProtocolType.Tcp ? SocketType.Stream : SocketType.Dgram, protocol);
         sock.SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ExclusiveAddressUse, true);
 
+        if (reusePort)
+        {
+            // Set after ExclusiveAddressUse, which clears it. The kernel spreads the flows over all sockets bound
+            // to the port with this option.
+            SetIntSocketOption(sock, SocketConstants.SOL_SOCKET, SocketConstants.SO_REUSEPORT, 1);
+        }
+
         if (addressFamily == AddressFamily.InterNetworkV6)
         {
             if (!useDualMode)
@@ -264,6 +275,186 @@ internal class NetServices
         CreateRtpSocket(createControlSocket, ProtocolType.Udp, bindAddress, bindPort, out rtpSocket, out controlSocket);
     }
 
+    /// <summary>
+    /// Attempts to create and bind a new RTP UDP Socket, and optionally an control (RTCP), socket(s).
+    /// </summary>
+    /// <param name="createControlSocket">True if a control (RTCP) socket should be created.</param>
+    /// <param name="bindAddress">Optional. The address to bind the RTP and control sockets on.</param>
+    /// <param name="bindPort">Optional. If 0 the choice of port will be left up to the Operating System.</param>
+    /// <param name="enableUdpGro">If true UDP_GRO is requested on the RTP socket so that the kernel can hand over
+    /// several datagrams of a flow as one coalesced buffer. Failure to enable it is logged and otherwise ignored.</param>
+    /// <param name="rtpSocket">An output parameter that will contain the allocated RTP socket.</param>
+    /// <param name="controlSocket">An output parameter that will contain the allocated control (RTCP) socket.</param>
+    public static void CreateRtpSocket(bool createControlSocket, IPAddress bindAddress, int bindPort, bool enableUdpGro, out Socket? rtpSocket, out Socket controlSocket)
+    {
+        CreateRtpSocket(createControlSocket, bindAddress, bindPort, enableUdpGro, false, out rtpSocket, out controlSocket);
+    }
+
+    /// <summary>
+    /// Attempts to create and bind a new RTP UDP Socket, and optionally an control (RTCP), socket(s).
+    /// </summary>
+    /// <param name="createControlSocket">True if a control (RTCP) socket should be created.</param>
+    /// <param name="bindAddress">Optional. The address to bind the RTP and control sockets on.</param>
+    /// <param name="bindPort">Optional. If 0 the choice of port will be left up to the Operating System.</param>
+    /// <param name="enableUdpGro">If true UDP_GRO is requested on the RTP socket.</param>
+    /// <param name="reusePort">If true SO_REUSEPORT is set on both sockets. Further sockets created with it can bind
+    /// the same ports, the kernel then distributes the received flows over them by a hash of their addresses.</param>
+    /// <param name="rtpSocket">An output parameter that will contain the allocated RTP socket.</param>
+    /// <param name="controlSocket">An output parameter that will contain the allocated control (RTCP) socket.</param>
+    public static void CreateRtpSocket(bool createControlSocket, IPAddress bindAddress, int bindPort, bool enableUdpGro, bool reusePort, out Socket? rtpSocket, out Socket controlSocket)
+    {
+        CreateRtpSocket(createControlSocket, ProtocolType.Udp, bindAddress, bindPort, out rtpSocket, out controlSocket, reusePort);
+
+        if (enableUdpGro && rtpSocket != null && !TryEnableUdpGro(rtpSocket))
+        {
+            logger.LogWarning($"UDP_GRO could not be enabled on RTP socket {rtpSocket.LocalEndPoint}, datagrams will be received individually.");
+        }
+    }
+
+    /// <summary>
+    /// Enables UDP generic receive offload on a socket. Requires Linux 5.0 or later.
+    /// </summary>
+    /// <returns>True if the option was accepted by the kernel.</returns>
+    public static bool TryEnableUdpGro(Socket socket)
+    {
+        try
+        {
+            Span<byte> enable = stackalloc byte[sizeof(int)];
+            BinaryPrimitives.WriteInt32LittleEndian(enable, 1);
+            socket.SetRawSocketOption(SocketConstants.SOL_UDP, SocketConstants.UDP_GRO, enable);
+            return true;
+        }
+        catch (SocketException sockExcp)
+        {
+            logger.LogDebug($"Setting UDP_GRO failed with {sockExcp.SocketErrorCode}.");
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Joins a multicast group on a socket. With a source address the join is source specific (IGMPv3 / MLDv2, RFC
+    /// 4607): only datagrams from that source are delivered. The socket then only receives the groups joined on it,
+    /// not those joined by other sockets bound to the same port.
+    /// </summary>
+    /// <param name="socket">A bound UDP socket.</param>
+    /// <param name="group">The multicast group address.</param>
+    /// <param name="source">Optional. The only sender to receive from.</param>
+    /// <param name="interfaceIndex">Index of the interface to join on, 0 to let the kernel choose by route.</param>
+    public static void JoinMulticastGroup(Socket socket, IPAddress group, IPAddress? source, int interfaceIndex)
+    {
+        if (!group.IsMulticast())
+        {
+            throw new ArgumentException($"{group} is not a multicast address.", nameof(group));
+        }
+
+        if (source != null && source.AddressFamily != group.AddressFamily)
+        {
+            throw new ArgumentException($"The source {source} and the group {group} are of different address families.", nameof(source));
+        }
+
+        int level = group.AddressFamily == AddressFamily.InterNetwork ? SocketConstants.SOL_IP : SocketConstants.SOL_IPV6;
+
+        // struct group_req and group_source_req: the interface index, then sockaddr_storage aligned to a pointer.
+        int addressOffset = IntPtr.Size;
+        Span<byte> request = stackalloc byte[addressOffset + SocketConstants.SOCKADDR_STORAGE_SIZE * 2];
+        request.Clear();
+        MemoryMarshal.Write(request, (uint)interfaceIndex);
+        WriteSockAddr(request.Slice(addressOffset, SocketConstants.SOCKADDR_STORAGE_SIZE), group);
+
+        if (source == null)
+        {
+            socket.SetRawSocketOption(level, SocketConstants.MCAST_JOIN_GROUP,
+                request.Slice(0, addressOffset + SocketConstants.SOCKADDR_STORAGE_SIZE));
+        }
+        else
+        {
+            WriteSockAddr(request.Slice(addressOffset + SocketConstants.SOCKADDR_STORAGE_SIZE), source);
+            socket.SetRawSocketOption(level, SocketConstants.MCAST_JOIN_SOURCE_GROUP, request);
+        }
+
+        try
+        {
+            SetIntSocketOption(socket, level,
+                level == SocketConstants.SOL_IP ? SocketConstants.IP_MULTICAST_ALL : SocketConstants.IPV6_MULTICAST_ALL, 0);
+        }
+        catch (SocketException sockExcp)
+        {
+            logger.LogDebug($"Disabling multicast all on {socket.LocalEndPoint} failed with {sockExcp.SocketErrorCode}.");
+        }
+    }
+
+    /// <summary>
+    /// Looks up the index of a network interface by its name (e.g. eth0) or one of its addresses.
+    /// </summary>
+    /// <returns>The interface index, 0 if <paramref name="nameOrAddress"/> is null or empty.</returns>
+    public static int GetInterfaceIndex(string? nameOrAddress)
+    {
+        if (string.IsNullOrEmpty(nameOrAddress))
+        {
+            return 0;
+        }
+
+        IPAddress.TryParse(nameOrAddress, out var address);
+        foreach (var networkInterface in NetworkInterface.GetAllNetworkInterfaces())
+        {
+            var properties = networkInterface.GetIPProperties();
+            if (networkInterface.Name == nameOrAddress ||
+                (address != null && properties.UnicastAddresses.Any(a => a.Address.Equals(address))))
+            {
+                return networkInterface.Supports(NetworkInterfaceComponent.IPv4)
+                    ? properties.GetIPv4Properties().Index
+                    : properties.GetIPv6Properties().Index;
+            }
+        }
+
+        throw new ArgumentException($"No network interface named or with address {nameOrAddress}.", nameof(nameOrAddress));
+    }
+
+    private static void WriteSockAddr(Span<byte> sockAddr, IPAddress address)
+    {
+        // sockaddr_in and sockaddr_in6 with port 0, the family is in host byte order.
+        if (address.AddressFamily == AddressFamily.InterNetwork)
+        {
+            MemoryMarshal.Write(sockAddr, SocketConstants.AF_INET);
+            address.TryWriteBytes(sockAddr.Slice(4, 4), out _);
+        }
+        else
+        {
+            MemoryMarshal.Write(sockAddr, SocketConstants.AF_INET6);
+            address.TryWriteBytes(sockAddr.Slice(8, 16), out _);
+            MemoryMarshal.Write(sockAddr.Slice(24), (uint)address.ScopeId);
+        }
+    }
+
+    private static void SetIntSocketOption(Socket socket, int level, int name, int value)
+    {
+        Span<byte> optionValue = stackalloc byte[sizeof(int)];
+        MemoryMarshal.Write(optionValue, value);
+        socket.SetRawSocketOption(level, name, optionValue);
+    }
+
+    /// <summary>
+    /// Checks whether UDP generic receive offload is enabled on a socket.
+    /// </summary>
+    public static bool IsUdpGroEnabled(Socket socket)
+    {
+        if (socket.ProtocolType != ProtocolType.Udp)
+        {
+            return false;
+        }
+
+        try
+        {
+            Span<byte> value = stackalloc byte[sizeof(int)];
+            int length = socket.GetRawSocketOption(SocketConstants.SOL_UDP, SocketConstants.UDP_GRO, value);
+            return length == sizeof(int) && BinaryPrimitives.ReadInt32LittleEndian(value) != 0;
+        }
+        catch (SocketException)
+        {
+            return false;
+        }
+    }
+
     /// <summary>
     /// Attempts to create and bind a new RTP Socket with protocol, and optionally an control (RTCP), socket(s).
     /// The RTP and control sockets created are IPv4 and IPv6 dual mode sockets which means they can send and receive
@@ -281,7 +472,8 @@ internal class NetServices
     /// tried before giving up. The parameter bindPort is ignored.</param>
     /// <param name="rtpSocket">An output parameter that will contain the allocated RTP socket.</param>
     /// <param name="controlSocket">An output parameter that will contain the allocated control (RTCP) socket.</param>
-    private static void CreateRtpSocket(bool createControlSocket, ProtocolType protocolType, IPAddress bindAddress, int bindPort, out Socket? rtpSocket, out Socket controlSocket)
+    /// <param name="reusePort">If true SO_REUSEPORT is set on the sockets.</param>
+    private static void CreateRtpSocket(bool createControlSocket, ProtocolType protocolType, IPAddress bindAddress, int bindPort, out Socket? rtpSocket, out Socket controlSocket, bool reusePort = false)
     {
         CheckBindAddressAndThrow(bindAddress);
 
@@ -296,7 +488,7 @@ internal class NetServices
         {
             try
             {
-                rtpSocket = CreateBoundSocket(bindPort, bindAddress, protocolType, createControlSocket);
+                rtpSocket = CreateBoundSocket(bindPort, bindAddress, protocolType, createControlSocket, reusePort: reusePort);
                 rtpSocket.ReceiveBufferSize = RTP_RECEIVE_BUFFER_SIZE;
                 rtpSocket.SendBufferSize = RTP_SEND_BUFFER_SIZE;
 
@@ -312,7 +504,7 @@ internal class NetServices
                     {
                         // This bind is being attempted on a specific port and can therefore legitimately fail if the port is already in use.
                         // Certain expected failure are caught and the attempt to bind two consecutive port will be re-attempted.
-                        controlSocket = CreateBoundSocket(controlPort, bindAddress, protocolType);
+                        controlSocket = CreateBoundSocket(controlPort, bindAddress, protocolType, reusePort: reusePort);
                         controlSocket.ReceiveBufferSize = RTP_RECEIVE_BUFFER_SIZE;
                         controlSocket.SendBufferSize = RTP_SEND_BUFFER_SIZE;
                     }
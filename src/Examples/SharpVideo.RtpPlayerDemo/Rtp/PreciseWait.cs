@@ -0,0 +1,41 @@
+using System.Diagnostics;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Waits for a point on a <see cref="Stopwatch"/> timeline more precisely than a plain sleep: the thread sleeps
+/// while the deadline is further away than the spin threshold and spins for the rest, because sleeps overshoot by
+/// up to a scheduler tick.
+/// </summary>
+internal static class PreciseWait
+{
+    /// <summary>
+    /// Remaining wait below which the caller spins instead of sleeping.
+    /// </summary>
+    public const long DEFAULT_SPIN_THRESHOLD_NS = 2_000_000;
+
+    /// <summary>
+    /// Returns once <paramref name="clock"/> has reached <paramref name="deadlineNs"/> or the operation is cancelled.
+    /// </summary>
+    public static void Until(Stopwatch clock, long deadlineNs, CancellationToken cancellationToken,
+        long spinThresholdNs = DEFAULT_SPIN_THRESHOLD_NS)
+    {
+        while (!cancellationToken.IsCancellationRequested)
+        {
+            long remainingNs = deadlineNs - clock.Elapsed.Ticks * 100;
+            if (remainingNs <= 0)
+            {
+                return;
+            }
+
+            if (remainingNs > spinThresholdNs)
+            {
+                cancellationToken.WaitHandle.WaitOne(TimeSpan.FromTicks((remainingNs - spinThresholdNs / 2) / 100));
+            }
+            else
+            {
+                Thread.SpinWait(64);
+            }
+        }
+    }
+}
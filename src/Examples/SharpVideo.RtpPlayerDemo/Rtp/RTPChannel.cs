@@ -1,14 +1,30 @@
 using System.Net;
 using System.Net.Sockets;
+using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
 
 namespace SharpVideo.RtpPlayerDemo.Rtp;
 
+internal enum RTPChannelSocketsEnum
+{
+    RTP = 0,
+    Control = 1
+}
+
+internal delegate void RtpDataReceivedDelegate(int localPort, IPEndPoint remoteEndPoint, Span<byte> packet, long receivedTimestampNs);
+
+/// <summary>
+/// Sends a packet of a channel over another transport, e.g. interleaved in an RTSP TCP connection.
+/// </summary>
+/// <returns>True if the packet was sent.</returns>
+internal delegate bool InterleavedSendDelegate(RTPChannelSocketsEnum sendOn, ReadOnlySpan<byte> packet);
+
 /// <summary>
 /// A communications channel for transmitting and receiving Real-time Protocol (RTP) and
 /// Real-time Control Protocol (RTCP) packets. This class performs the socket management
 /// functions.
 /// </summary>
+[SupportedOSPlatform("linux")]
 internal class RTPChannel : IDisposable
 {
     private readonly ILogger _logger;
@@ -42,10 +58,13 @@ internal class RTPChannel : IDisposable
     /// the RTP and control sockets to. If left empty then the IPv6 any address will be used if IPv6 is supported
     /// and fallback to the IPv4 any address.</param>
     /// <param name="bindPort">Optional. The specific port to attempt to bind the RTP port on.</param>
-    public RTPChannel(bool createControlSocket, IPAddress bindAddress, int bindPort, ILogger logger)
+    /// <param name="enableUdpGro">Optional. Request UDP_GRO on the RTP socket, coalesced buffers are split by the receiver.</param>
+    /// <param name="reusePort">Optional. Set SO_REUSEPORT so that further channels can bind the same ports and share
+    /// the received flows.</param>
+    public RTPChannel(bool createControlSocket, IPAddress bindAddress, int bindPort, ILogger logger, bool enableUdpGro = false, bool reusePort = false)
     {
         _logger = logger;
-        NetServices.CreateRtpSocket(createControlSocket, bindAddress, bindPort, out var rtpSocket, out _controlSocket);
+        NetServices.CreateRtpSocket(createControlSocket, bindAddress, bindPort, enableUdpGro, reusePort, out var rtpSocket, out _controlSocket);
 
         if (rtpSocket == null)
         {
@@ -64,16 +83,63 @@ internal class RTPChannel : IDisposable
     }
 
 
-    public event Action<int, IPEndPoint, byte[]> OnRtpDataReceived;
+    public event RtpDataReceivedDelegate OnRtpDataReceived;
+
+    /// <summary>
+    /// Fires on the control receive thread for every packet received on the RTCP socket.
+    /// </summary>
+    public event RtpDataReceivedDelegate? OnControlDataReceived;
     public event Action<string> OnClosed;
 
+    /// <summary>
+    /// Fires on the RTP receive thread when no packet arrived for <see cref="RtpIdleTimeoutMs"/>.
+    /// </summary>
+    public event Action? OnRtpIdle;
+
+    /// <summary>
+    /// The local port RTP is received on.
+    /// </summary>
+    public int RtpPort => _rtpPort;
+
+    /// <summary>
+    /// The local port RTCP is received on, 0 without a control socket.
+    /// </summary>
+    public int ControlPort => _controlPort;
+
+    /// <summary>
+    /// Idle interval of the RTP receiver. Must be set before <see cref="Start"/>.
+    /// </summary>
+    public int RtpIdleTimeoutMs { get; set; } = 250;
+
+    /// <summary>
+    /// CPU the RTP receive thread is pinned to, -1 for none. Must be set before <see cref="Start"/>.
+    /// </summary>
+    public int RtpReceiveCpu { get; set; } = -1;
+
+    /// <summary>
+    /// If true the receivers use io_uring where the kernel supports it. Must be set before <see cref="Start"/>.
+    /// </summary>
+    public bool UseIoUring { get; set; }
+
+    /// <summary>
+    /// If set the channel's packets travel over another transport (RFC 2326 10.12 interleaved RTSP): packets are sent
+    /// through it and the sockets are not received on, the owner of the transport delivers the received packets.
+    /// Must be set before <see cref="Start"/>.
+    /// </summary>
+    public InterleavedSendDelegate? InterleavedSender { get; set; }
+
     /// <summary>
     /// Starts listening on the RTP and control ports.
     /// </summary>
     public void Start()
     {
+        if (InterleavedSender != null)
+        {
+            return;
+        }
+
         StartRtpReceiver();
-        //StartControlReceiver();
+        StartControlReceiver();
     }
 
     /// <summary>
@@ -90,14 +156,94 @@ internal class RTPChannel : IDisposable
             _rtpReceiver = new UdpReceiver(_rtpSocket);
             _rtpReceiver.OnPacketReceived += OnRTPPacketReceived;
             _rtpReceiver.OnClosed += Close;
+            _rtpReceiver.OnIdle += _ => OnRtpIdle?.Invoke();
+            _rtpReceiver.IdleTimeoutMs = RtpIdleTimeoutMs;
+            _rtpReceiver.Cpu = RtpReceiveCpu;
+            _rtpReceiver.UseIoUring = UseIoUring;
             _rtpReceiver.BeginReceiveFrom();
         }
     }
 
+    /// <summary>
+    /// Starts the UDP receiver that listens for RTCP (control) packets.
+    /// </summary>
+    private void StartControlReceiver()
+    {
+        if (!_controlReceiverStarted && _controlSocket != null)
+        {
+            _controlReceiverStarted = true;
+
+            _logger.LogDebug($"RTPChannel control receiver for {_controlSocket.LocalEndPoint} started.");
+
+            _controlReceiver = new UdpReceiver(_controlSocket);
+            _controlReceiver.OnPacketReceived += OnControlPacketReceived;
+            _controlReceiver.OnClosed += Close;
+            _controlReceiver.UseIoUring = UseIoUring;
+            _controlReceiver.BeginReceiveFrom();
+        }
+    }
+
+    /// <summary>
+    /// Joins a multicast group on the RTP and control sockets, see <see cref="NetServices.JoinMulticastGroup"/>.
+    /// </summary>
+    /// <param name="group">The multicast group address.</param>
+    /// <param name="source">Optional. The only sender to receive from (source specific multicast).</param>
+    /// <param name="interfaceIndex">Index of the interface to join on, 0 to let the kernel choose.</param>
+    public void JoinMulticastGroup(IPAddress group, IPAddress? source, int interfaceIndex)
+    {
+        NetServices.JoinMulticastGroup(_rtpSocket, group, source, interfaceIndex);
+        if (_controlSocket != null)
+        {
+            NetServices.JoinMulticastGroup(_controlSocket, group, source, interfaceIndex);
+        }
+
+        _logger.LogInformation($"Joined multicast group {group}{(source != null ? $" from source {source}" : "")} on port {_rtpPort}, interface {interfaceIndex}.");
+    }
+
+    /// <summary>
+    /// Sends a packet from one of the channel's sockets. Falls back to the RTP socket if there is no control
+    /// socket (RTP and RTCP multiplexed).
+    /// </summary>
+    /// <param name="sendOn">The socket to send from.</param>
+    /// <param name="dstEndPoint">The destination end point.</param>
+    /// <param name="buffer">The packet to send.</param>
+    /// <returns>True if the packet was handed to the socket.</returns>
+    public bool Send(RTPChannelSocketsEnum sendOn, IPEndPoint dstEndPoint, ReadOnlySpan<byte> buffer)
+    {
+        if (_isClosed)
+        {
+            return false;
+        }
+
+        var interleavedSender = InterleavedSender;
+        if (interleavedSender != null)
+        {
+            return interleavedSender(sendOn, buffer);
+        }
+
+        var socket = sendOn == RTPChannelSocketsEnum.Control && _controlSocket != null ? _controlSocket : _rtpSocket;
+
+        try
+        {
+            socket.SendTo(buffer, SocketFlags.None, dstEndPoint);
+            return true;
+        }
+        catch (ObjectDisposedException)
+        {
+            // Closed while sending.
+            return false;
+        }
+        catch (SocketException sockExcp)
+        {
+            _logger.LogWarning($"SocketException RTPChannel.Send to {dstEndPoint}. {sockExcp.SocketErrorCode}.");
+            return false;
+        }
+    }
+
     /// <summary>
     /// Closes the session's RTP and control ports.
     /// </summary>
-    public void Close(string reason)
+    public void Close(string? reason)
     {
         if (!_isClosed)
         {
@@ -118,6 +264,17 @@ internal class RTPChannel : IDisposable
                 _rtpReceiver?.Close(null);
                 _controlReceiver?.Close(null);
 
+                // Sockets of a channel that was never started have no receiver to close them.
+                if (_rtpReceiver == null)
+                {
+                    _rtpSocket.Close();
+                }
+
+                if (_controlReceiver == null)
+                {
+                    _controlSocket?.Close();
+                }
+
                 OnClosed?.Invoke(closeReason);
             }
             catch (Exception excp)
@@ -134,11 +291,23 @@ internal class RTPChannel : IDisposable
     /// <param name="localPort">The local port it was received on.</param>
     /// <param name="remoteEndPoint">The remote end point of the sender.</param>
     /// <param name="packet">The raw packet received (note this may not be RTP if other protocols are being multiplexed).</param>
-    protected virtual void OnRTPPacketReceived(UdpReceiver receiver, int localPort, IPEndPoint remoteEndPoint, byte[] packet)
+    /// <param name="receivedTimestampNs">Kernel receive timestamp, nanoseconds since the Unix epoch.</param>
+    protected virtual void OnRTPPacketReceived(UdpReceiver receiver, int localPort, IPEndPoint remoteEndPoint, Span<byte> packet, long receivedTimestampNs)
+    {
+        if (packet.Length > 0)
+        {
+            OnRtpDataReceived?.Invoke(localPort, remoteEndPoint, packet, receivedTimestampNs);
+        }
+    }
+
+    /// <summary>
+    /// Event handler for packets received on the control UDP socket.
+    /// </summary>
+    protected virtual void OnControlPacketReceived(UdpReceiver receiver, int localPort, IPEndPoint remoteEndPoint, Span<byte> packet, long receivedTimestampNs)
     {
-        if (packet?.Length > 0)
+        if (packet.Length > 0)
         {
-            OnRtpDataReceived?.Invoke(localPort, remoteEndPoint, packet);
+            OnControlDataReceived?.Invoke(localPort, remoteEndPoint, packet, receivedTimestampNs);
         }
     }
 
@@ -5,11 +5,10 @@ internal class RTPPacket
     public RTPHeader Header;
     public byte[] Payload;
 
-    public RTPPacket(byte[] packet)
+    public RTPPacket(ReadOnlySpan<byte> packet)
     {
         Header = new RTPHeader(packet);
-        Payload = new byte[Header.PayloadSize];
-        Array.Copy(packet, Header.Length, Payload, 0, Payload.Length);
+        Payload = packet.Slice(Header.Length, Header.PayloadSize).ToArray();
     }
 
     public byte[] GetBytes()
@@ -1,50 +1,618 @@
+using System.Collections.Concurrent;
 using System.Net;
+using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
+using SharpVideo.Srtp;
 
 namespace SharpVideo.RtpPlayerDemo.Rtp;
 
+/// <summary>
+/// Receives RTP on one or more local ports and demultiplexes the packets by port and SSRC into independent
+/// <see cref="RtpReceiveStream"/>s.
+/// </summary>
+/// <remarks>
+/// Every port has its own receive thread. Streams sharing a port are processed on that thread, but all per-stream
+/// work is non-blocking (reordering, depacketisation, handing the frame to the subscriber), so a slow consumer of
+/// one stream cannot hold up the others. With <see cref="RtpSocketOptions.ReceiveThreads"/> several SO_REUSEPORT
+/// sockets share a port and the kernel spreads the senders over their threads. Streams are created on their first
+/// packet and removed after <see cref="RtpSessionConfig.StreamTimeout"/> without packets.
+/// </remarks>
+[SupportedOSPlatform("linux")]
 public class Receiver
 {
     private static int _nextIndex;
 
-    private readonly IPEndPoint _bindEndPoint;
-    private readonly VideoStream _videoStream;
-    private readonly RTPChannel _channel;
+    /// <summary>
+    /// Per socket state, only touched by the receive thread of the channel except for the stream list.
+    /// </summary>
+    private sealed class ChannelState
+    {
+        public ChannelState(RTPChannel channel, ChannelState[] group)
+        {
+            Channel = channel;
+            Group = group;
+        }
+
+        public RTPChannel Channel { get; }
+
+        /// <summary>
+        /// The channels bound to the same port with SO_REUSEPORT, including this one.
+        /// </summary>
+        public ChannelState[] Group { get; }
+
+        /// <summary>
+        /// Streams received on this channel, replaced as a whole under the receiver lock.
+        /// </summary>
+        public volatile RtpReceiveStream[] Streams = Array.Empty<RtpReceiveStream>();
 
-    public Receiver(IPEndPoint bindEndPoint, ILogger<Receiver> logger)
+        public RtpReceiveStream? LastStream;
+        public long LastPollTimestampNs;
+
+        /// <summary>
+        /// SRTP and SRTCP state of the senders on this channel, null without SRTP.
+        /// </summary>
+        public SrtpReceiveContext? Srtp;
+        public SrtcpContext? Srtcp;
+    }
+
+    private readonly RtpSessionConfig _sessionConfig;
+    private readonly ILogger _logger;
+    private readonly List<ChannelState> _channels = new();
+    private readonly ConcurrentDictionary<(int LocalPort, uint Ssrc), RtpReceiveStream> _streams = new();
+    private readonly object _streamsLock = new();
+    private readonly Timer _streamTimeoutTimer;
+    private readonly long _pollIntervalNs;
+    private readonly IPAddress _captureAddress;
+    private volatile RtpCaptureWriter? _captureWriter;
+    private byte[] _injectBuffer = Array.Empty<byte>();
+    private int _rejectedPackets;
+    private long _lastSrtpRejectedLogTicks;
+
+    public Receiver(IPEndPoint bindEndPoint, ILogger<Receiver> logger, bool enableUdpGro = false)
+        : this(new[] { bindEndPoint }, logger, enableUdpGro)
     {
-        _bindEndPoint = bindEndPoint;
-        var sessionConfig = new RtpSessionConfig
+    }
+
+    /// <param name="bindEndPoints">Local end points to receive RTP on, one socket (and RTCP socket) each.</param>
+    /// <param name="logger">Logger.</param>
+    /// <param name="enableUdpGro">Request UDP_GRO on the RTP sockets.</param>
+    public Receiver(IReadOnlyList<IPEndPoint> bindEndPoints, ILogger<Receiver> logger, bool enableUdpGro = false)
+        : this(bindEndPoints, logger, new RtpSocketOptions { EnableUdpGro = enableUdpGro })
+    {
+    }
+
+    /// <param name="bindEndPoints">Local end points to receive RTP on, one socket (and RTCP socket) each per receive
+    /// thread.</param>
+    /// <param name="logger">Logger.</param>
+    /// <param name="socketOptions">GRO, receive threads and multicast groups.</param>
+    public Receiver(IReadOnlyList<IPEndPoint> bindEndPoints, ILogger<Receiver> logger, RtpSocketOptions socketOptions)
+    {
+        if (socketOptions.ReceiveThreads < 1)
+        {
+            throw new ArgumentOutOfRangeException(nameof(socketOptions), "At least one receive thread is required.");
+        }
+
+        _logger = logger;
+        _sessionConfig = new RtpSessionConfig
         {
-            BindAddress = _bindEndPoint.Address,
-            BindPort = _bindEndPoint.Port,
             IsMediaMultiplexed = false,
+            EnableUdpGro = socketOptions.EnableUdpGro,
         };
-        _videoStream = new VideoStream(sessionConfig, _nextIndex, logger);
-        _videoStream.OnVideoFrameReceivedByIndex += VideoStreamOnOnVideoFrameReceivedByIndex;
-        _channel = new RTPChannel(false, sessionConfig.BindAddress, sessionConfig.BindPort, logger);
-        _videoStream.AddRtpChannel(_channel);
-        _channel.OnRtpDataReceived += OnReceiveRTPPacket;
 
-        _nextIndex++;
+        _captureAddress = bindEndPoints[0].Address;
+        var pollInterval = _sessionConfig.JitterBufferGapTimeout / 2;
+        _pollIntervalNs = pollInterval.Ticks * 100;
+
+        // Multicast receivers share the port with other processes too.
+        bool reusePort = socketOptions.ReceiveThreads > 1 || socketOptions.MulticastGroups.Count > 0;
+        int interfaceIndex = NetServices.GetInterfaceIndex(socketOptions.MulticastInterface);
+        int threadIndex = 0;
+
+        foreach (var bindEndPoint in bindEndPoints)
+        {
+            var group = new ChannelState[socketOptions.ReceiveThreads];
+            int port = bindEndPoint.Port;
+            for (int i = 0; i < group.Length; i++)
+            {
+                var channel = new RTPChannel(_sessionConfig.EnableRtcp, bindEndPoint.Address, port, logger, _sessionConfig.EnableUdpGro, reusePort);
+                var state = new ChannelState(channel, group);
+                channel.OnRtpDataReceived += (localPort, remoteEndPoint, buffer, receivedTimestampNs) =>
+                    OnReceiveRTPPacket(state, localPort, remoteEndPoint, buffer, receivedTimestampNs);
+                channel.OnControlDataReceived += (localPort, remoteEndPoint, buffer, receivedTimestampNs) =>
+                    OnReceiveControlPacket(state, localPort, remoteEndPoint, buffer, receivedTimestampNs);
+                channel.OnRtpIdle += () => PollStreams(state, (DateTime.UtcNow - DateTime.UnixEpoch).Ticks * 100);
+                channel.RtpIdleTimeoutMs = Math.Max(1, (int)pollInterval.TotalMilliseconds);
+                channel.UseIoUring = socketOptions.EnableIoUring;
+                if (socketOptions.ReceiveCpus.Count > 0)
+                {
+                    channel.RtpReceiveCpu = socketOptions.ReceiveCpus[threadIndex % socketOptions.ReceiveCpus.Count];
+                }
+
+                // Further sockets bind the port the first one got.
+                port = channel.RtpPort;
+                threadIndex++;
+                group[i] = state;
+                _channels.Add(state);
+            }
+
+            // A socket only receives the groups joined on it, so the groups are spread over the threads.
+            for (int i = 0; i < socketOptions.MulticastGroups.Count; i++)
+            {
+                group[i % group.Length].Channel.JoinMulticastGroup(socketOptions.MulticastGroups[i], socketOptions.MulticastSource, interfaceIndex);
+            }
+
+            if (group.Length > 1)
+            {
+                _logger.LogInformation($"Receiving on {bindEndPoint.Address}:{port} with {group.Length} SO_REUSEPORT sockets.");
+            }
+        }
+
+        _streamTimeoutTimer = new Timer(_ => RemoveTimedOutStreams());
+    }
+
+    /// <summary>
+    /// Fires on the receive thread for every reassembled frame. The handler owns the frame and must dispose it.
+    /// </summary>
+    public event Action<RtpReceiveStream, EncodedFrame>? OnVideoFrameReceived;
+
+    /// <summary>
+    /// Fires on the receive thread when the first packet of a new stream arrives, before it is processed.
+    /// </summary>
+    public event Action<RtpReceiveStream>? OnStreamAdded;
+
+    /// <summary>
+    /// Fires on a timer thread when a stream is removed after receiving nothing for the stream timeout.
+    /// </summary>
+    public event Action<RtpReceiveStream>? OnStreamRemoved;
+
+    /// <summary>
+    /// The streams currently received.
+    /// </summary>
+    public ICollection<RtpReceiveStream> Streams => _streams.Values;
+
+    /// <summary>
+    /// Number of packets dropped because the stream limit was reached or they could not be assigned to a stream.
+    /// </summary>
+    public int RejectedPackets => _rejectedPackets;
+
+    /// <summary>
+    /// Number of SRTP and SRTCP packets dropped because they were not authentic or replayed.
+    /// </summary>
+    public int SrtpRejectedPackets => _channels.Sum(state =>
+        (state.Srtp?.AuthenticationFailures ?? 0) + (state.Srtp?.ReplayedPackets ?? 0) + (state.Srtcp?.RejectedPackets ?? 0));
+
+    /// <summary>
+    /// Assigns a codec to an RTP payload type, e.g. from an SDP rtpmap attribute. Dynamic payload types without a
+    /// mapping are treated as H264. Must be called before <see cref="Start"/>.
+    /// </summary>
+    public void MapPayloadType(int payloadType, VideoCodecsEnum codec)
+    {
+        _sessionConfig.PayloadTypeCodecs[payloadType] = codec;
     }
 
-    public event Action<int, IPEndPoint, uint, byte[]> OnVideoFrameReceivedByIndex;
+    /// <summary>
+    /// Recovers lost packets from ULPFEC and/or FlexFEC repair packets with these payload types, 0 for a scheme that
+    /// is not used. Must be called before <see cref="Start"/>.
+    /// </summary>
+    public void EnableFec(int ulpfecPayloadType, int flexfecPayloadType)
+    {
+        _sessionConfig.UlpfecPayloadType = ulpfecPayloadType;
+        _sessionConfig.FlexfecPayloadType = flexfecPayloadType;
+        _logger.LogInformation($"FEC enabled, ULPFEC payload type {ulpfecPayloadType}, FlexFEC payload type {flexfecPayloadType}.");
+    }
+
+    /// <summary>
+    /// Requires all RTP and RTCP to be protected with SRTP; unprotected or unauthentic packets are dropped. Packets
+    /// are decrypted in place in the receive buffer. Must be called before <see cref="Start"/>.
+    /// </summary>
+    /// <param name="receivePolicy">Keys of the sender, e.g. from its SDES crypto attribute.</param>
+    /// <param name="sendPolicy">Our keys for the RTCP we send. Defaults to the keys of the sender.</param>
+    public void EnableSrtp(SrtpPolicy receivePolicy, SrtpPolicy? sendPolicy = null)
+    {
+        _sessionConfig.SrtpReceivePolicy = receivePolicy;
+        _sessionConfig.SrtpSendPolicy = sendPolicy ?? receivePolicy;
+        foreach (var state in _channels)
+        {
+            state.Srtp?.Dispose();
+            state.Srtcp?.Dispose();
+            state.Srtp = new SrtpReceiveContext(receivePolicy);
+            state.Srtcp = new SrtcpContext(receivePolicy);
+        }
+
+        _logger.LogInformation($"SRTP enabled, {receivePolicy.Profile}.");
+    }
 
     public void Start()
     {
-        _channel.Start();
+        foreach (var state in _channels)
+        {
+            state.Channel.Start();
+        }
+
+        _streamTimeoutTimer.Change(TimeSpan.FromSeconds(1), TimeSpan.FromSeconds(1));
+    }
+
+    /// <summary>
+    /// Starts recording every received RTP and RTCP datagram with its kernel timestamp to a pcap file, replacing a
+    /// running capture. See <see cref="RtpReplayer"/> to play it back.
+    /// </summary>
+    public void StartCapture(string path)
+    {
+        var writer = new RtpCaptureWriter(path, _captureAddress);
+        Interlocked.Exchange(ref _captureWriter, writer)?.Dispose();
+        _logger.LogInformation($"Capturing RTP to {path}.");
     }
 
-    private void VideoStreamOnOnVideoFrameReceivedByIndex(int arg1, IPEndPoint arg2, uint arg3, byte[] arg4)
+    /// <summary>
+    /// Stops and flushes a capture started with <see cref="StartCapture"/>.
+    /// </summary>
+    public void StopCapture()
     {
-        //Console.WriteLine($"{arg1}::{arg2}::{arg3}::{arg5}");
-        OnVideoFrameReceivedByIndex?.Invoke(arg1, arg2, arg3, arg4);
+        var writer = Interlocked.Exchange(ref _captureWriter, null);
+        if (writer != null)
+        {
+            writer.Dispose();
+            _logger.LogInformation($"RTP capture stopped after {writer.PacketsWritten} packets.");
+        }
     }
 
-    private void OnReceiveRTPPacket(int localPort, IPEndPoint remoteEndPoint, byte[] buffer)
+    /// <summary>
+    /// Processes a datagram as if it was received on <paramref name="localPort"/>, e.g. from
+    /// <see cref="RtpReplayer.Replay"/>. Only call this while the receiver is not started: the packets of a port
+    /// must not be processed concurrently with its receive thread. RTCP feedback is still sent to the sender the
+    /// datagram claims to come from.
+    /// </summary>
+    /// <param name="localPort">RTP or RTCP port of one of the bind end points.</param>
+    /// <param name="remoteEndPoint">Sender of the datagram.</param>
+    /// <param name="packet">The UDP payload.</param>
+    /// <param name="receivedTimestampNs">Arrival time, nanoseconds since the Unix epoch.</param>
+    public void InjectPacket(int localPort, IPEndPoint remoteEndPoint, ReadOnlySpan<byte> packet, long receivedTimestampNs)
     {
+        // The packet is modified in place, e.g. by SRTP decryption.
+        if (_injectBuffer.Length < packet.Length)
+        {
+            _injectBuffer = new byte[Math.Max(packet.Length, 2048)];
+        }
+
+        var buffer = _injectBuffer.AsSpan(0, packet.Length);
+        packet.CopyTo(buffer);
+
+        foreach (var state in _channels)
+        {
+            if (state.Channel.RtpPort == localPort)
+            {
+                OnReceiveRTPPacket(state, localPort, remoteEndPoint, buffer, receivedTimestampNs);
+                return;
+            }
+
+            if (state.Channel.ControlPort == localPort)
+            {
+                OnReceiveControlPacket(state, localPort, remoteEndPoint, buffer, receivedTimestampNs);
+                return;
+            }
+        }
+
+        _rejectedPackets++;
+    }
+
+    /// <summary>
+    /// Carries the RTP and RTCP of a port over another transport instead of its sockets, e.g. interleaved in an RTSP
+    /// TCP connection. The owner of the transport delivers the received packets with
+    /// <see cref="ReceiveInterleavedPacket"/>. Must be called before <see cref="Start"/>.
+    /// </summary>
+    internal void SetInterleavedSender(int localPort, InterleavedSendDelegate sender)
+    {
+        GetChannelState(localPort).Channel.InterleavedSender = sender;
+    }
+
+    /// <summary>
+    /// Processes a packet received over the transport set with <see cref="SetInterleavedSender"/>. The packet is
+    /// processed in place without copying and must not be used by the caller afterwards. Packets of a port must be
+    /// delivered by a single thread.
+    /// </summary>
+    /// <param name="localPort">Port the transport was set for.</param>
+    /// <param name="receivedOn">Whether it is an RTP or RTCP packet.</param>
+    /// <param name="remoteEndPoint">Sender of the packet.</param>
+    /// <param name="packet">The RTP or RTCP packet.</param>
+    /// <param name="receivedTimestampNs">Arrival time, nanoseconds since the Unix epoch.</param>
+    internal void ReceiveInterleavedPacket(int localPort, RTPChannelSocketsEnum receivedOn, IPEndPoint remoteEndPoint,
+        Span<byte> packet, long receivedTimestampNs)
+    {
+        var state = GetChannelState(localPort);
+        if (receivedOn == RTPChannelSocketsEnum.Control)
+        {
+            OnReceiveControlPacket(state, localPort, remoteEndPoint, packet, receivedTimestampNs);
+        }
+        else
+        {
+            OnReceiveRTPPacket(state, localPort, remoteEndPoint, packet, receivedTimestampNs);
+        }
+    }
+
+    /// <summary>
+    /// Stops receiving and closes the sockets.
+    /// </summary>
+    public void Close()
+    {
+        StopCapture();
+        _streamTimeoutTimer.Dispose();
+        foreach (var state in _channels)
+        {
+            state.Channel.Close(null);
+        }
+
+        foreach (var stream in _streams.Values)
+        {
+            stream.MarkRemoved();
+        }
+
+        foreach (var state in _channels)
+        {
+            state.Srtp?.Dispose();
+            state.Srtcp?.Dispose();
+        }
+    }
+
+    private ChannelState GetChannelState(int localPort)
+    {
+        foreach (var state in _channels)
+        {
+            if (state.Channel.RtpPort == localPort)
+            {
+                return state;
+            }
+        }
+
+        throw new ArgumentException($"No RTP channel on port {localPort}.", nameof(localPort));
+    }
+
+    private void OnReceiveRTPPacket(ChannelState state, int localPort, IPEndPoint remoteEndPoint, Span<byte> buffer, long receivedTimestampNs)
+    {
+        _captureWriter?.Write(localPort, remoteEndPoint, buffer, receivedTimestampNs);
+
+        if (RtcpPacketWriter.IsRtcp(buffer))
+        {
+            // RTCP multiplexed on the RTP port.
+            DispatchControlPacket(state, remoteEndPoint, buffer, isMultiplexed: true);
+            return;
+        }
+
+        if (buffer.Length < RTPHeader.MIN_HEADER_LEN)
+        {
+            _rejectedPackets++;
+            return;
+        }
+
+        if (state.Srtp != null)
+        {
+            // Authenticated before a stream is created for the SSRC, so forged packets cannot open streams.
+            if (!state.Srtp.TryUnprotect(buffer, out int length))
+            {
+                LogSrtpRejected(remoteEndPoint);
+                return;
+            }
+
+            buffer = buffer.Slice(0, length);
+        }
+
         var hdr = new RTPHeader(buffer);
-        _videoStream.OnReceiveRTPPacket(hdr, localPort, remoteEndPoint, buffer, _videoStream);
+        var stream = GetOrAddStream(state, localPort, remoteEndPoint, hdr);
+        if (stream != null)
+        {
+            stream.LastPacketTicks = Environment.TickCount64;
+            stream.RemoteEndPoint = remoteEndPoint;
+            stream.RtcpSession?.SetRemoteRtpEndPoint(remoteEndPoint);
+
+            hdr.ReceivedTime = DateTime.UnixEpoch.AddTicks(receivedTimestampNs / 100);
+            stream.VideoStream.OnReceiveRTPPacket(hdr, localPort, remoteEndPoint, buffer, receivedTimestampNs, stream.VideoStream);
+        }
+
+        // Busy sockets never go idle, so the deadlines of streams waiting for a missing packet are checked here too.
+        // Measured on the packet timestamps, so injected packets are polled on the timeline of their capture.
+        if (receivedTimestampNs - state.LastPollTimestampNs >= _pollIntervalNs)
+        {
+            PollStreams(state, receivedTimestampNs);
+        }
+    }
+
+    private RtpReceiveStream? GetOrAddStream(ChannelState state, int localPort, IPEndPoint remoteEndPoint, RTPHeader hdr)
+    {
+        var last = state.LastStream;
+        if (last != null && last.Ssrc == hdr.SyncSource && last.LocalPort == localPort && !last.IsRemoved)
+        {
+            return last;
+        }
+
+        if (_streams.TryGetValue((localPort, hdr.SyncSource), out var stream))
+        {
+            if (stream.Channel != state.Channel)
+            {
+                // The sender moved to another socket of the SO_REUSEPORT group, e.g. after a source port change. The
+                // stream belongs to the thread of its first socket and must not be processed on this one.
+                _rejectedPackets++;
+                return null;
+            }
+
+            state.LastStream = stream;
+            return stream;
+        }
+
+        if (IsAuxiliaryPayloadType(hdr.PayloadType))
+        {
+            // RFC 4588 retransmissions and FEC repair packets use their own SSRC; they belong to the stream from the
+            // same sender.
+            foreach (var candidate in state.Streams)
+            {
+                if (candidate.LocalPort == localPort && remoteEndPoint.Equals(candidate.RemoteEndPoint))
+                {
+                    return candidate;
+                }
+            }
+
+            _rejectedPackets++;
+            return null;
+        }
+
+        lock (_streamsLock)
+        {
+            if (_streams.Count >= _sessionConfig.MaxStreams)
+            {
+                if (_rejectedPackets++ == 0)
+                {
+                    _logger.LogWarning($"Stream limit of {_sessionConfig.MaxStreams} reached, dropping SSRC {hdr.SyncSource} from {remoteEndPoint}.");
+                }
+
+                return null;
+            }
+
+            if (_streams.ContainsKey((localPort, hdr.SyncSource)))
+            {
+                // Another socket of the SO_REUSEPORT group created it meanwhile.
+                _rejectedPackets++;
+                return null;
+            }
+
+            stream = CreateStream(state.Channel, localPort, hdr.SyncSource);
+            stream.RemoteEndPoint = remoteEndPoint;
+            _streams[(localPort, hdr.SyncSource)] = stream;
+            state.Streams = [.. state.Streams, stream];
+        }
+
+        _logger.LogInformation($"New RTP stream {stream}, remote {remoteEndPoint}.");
+        state.LastStream = stream;
+        OnStreamAdded?.Invoke(stream);
+        stream.RtcpSession?.Start();
+        return stream;
+    }
+
+    private bool IsAuxiliaryPayloadType(int payloadType)
+    {
+        return payloadType != 0 &&
+               (payloadType == _sessionConfig.RtxPayloadType ||
+                payloadType == _sessionConfig.UlpfecPayloadType ||
+                payloadType == _sessionConfig.FlexfecPayloadType);
+    }
+
+    private RtpReceiveStream CreateStream(RTPChannel channel, int localPort, uint ssrc)
+    {
+        int index = Interlocked.Increment(ref _nextIndex) - 1;
+        var videoStream = new VideoStream(_sessionConfig, index, _logger);
+        videoStream.AddRtpChannel(channel);
+
+        RtcpSession? rtcpSession = null;
+        if (_sessionConfig.EnableRtcp)
+        {
+            rtcpSession = new RtcpSession(channel, _sessionConfig, () => videoStream.ReceptionStatistics, _logger);
+            if (_sessionConfig.EnableNack)
+            {
+                videoStream.OnPacketsMissing += rtcpSession.SendNack;
+            }
+
+            if (_sessionConfig.RequestKeyFrameOnLoss)
+            {
+                videoStream.OnPacketsLost += _ => rtcpSession.RequestKeyFrame();
+            }
+        }
+
+        var stream = new RtpReceiveStream(index, localPort, ssrc, channel, videoStream, rtcpSession);
+        videoStream.OnVideoFrameReceivedByIndex += (_, _, _, frame) => OnStreamFrameReceived(stream, frame);
+        return stream;
+    }
+
+    private void OnStreamFrameReceived(RtpReceiveStream stream, EncodedFrame frame)
+    {
+        if (frame.IsKeyFrame)
+        {
+            stream.RtcpSession?.OnKeyFrameReceived();
+        }
+
+        if (OnVideoFrameReceived == null || stream.IsRemoved)
+        {
+            frame.Dispose();
+            return;
+        }
+
+        OnVideoFrameReceived.Invoke(stream, frame);
+    }
+
+    /// <param name="state">Channel whose streams are polled.</param>
+    /// <param name="nowNs">Current time on the clock of the packet timestamps, nanoseconds since the Unix epoch.</param>
+    private void PollStreams(ChannelState state, long nowNs)
+    {
+        state.LastPollTimestampNs = nowNs;
+        foreach (var stream in state.Streams)
+        {
+            stream.VideoStream.OnReceiveIdle(nowNs);
+        }
+    }
+
+    private void OnReceiveControlPacket(ChannelState state, int localPort, IPEndPoint remoteEndPoint, Span<byte> buffer, long receivedTimestampNs)
+    {
+        _captureWriter?.Write(localPort, remoteEndPoint, buffer, receivedTimestampNs);
+        DispatchControlPacket(state, remoteEndPoint, buffer, isMultiplexed: false);
+    }
+
+    private void DispatchControlPacket(ChannelState state, IPEndPoint remoteEndPoint, Span<byte> buffer, bool isMultiplexed)
+    {
+        if (state.Srtcp != null)
+        {
+            if (!state.Srtcp.TryUnprotect(buffer, out int length))
+            {
+                LogSrtpRejected(remoteEndPoint);
+                return;
+            }
+
+            buffer = buffer.Slice(0, length);
+        }
+
+        // Every session picks the sender reports of its own SSRC. RTCP may arrive on another socket of the
+        // SO_REUSEPORT group than the RTP of its stream.
+        foreach (var member in state.Group)
+        {
+            foreach (var stream in member.Streams)
+            {
+                stream.RtcpSession?.OnControlPacketReceived(remoteEndPoint, buffer, isMultiplexed);
+            }
+        }
+    }
+
+    private void LogSrtpRejected(IPEndPoint remoteEndPoint)
+    {
+        // Once per second at most, a sender with the wrong key would flood the log otherwise.
+        long now = Environment.TickCount64;
+        if (now - _lastSrtpRejectedLogTicks >= 1000)
+        {
+            _lastSrtpRejectedLogTicks = now;
+            _logger.LogWarning($"Dropped SRTP packet from {remoteEndPoint} that failed authentication or was replayed, {SrtpRejectedPackets} so far.");
+        }
+    }
+
+    private void RemoveTimedOutStreams()
+    {
+        long now = Environment.TickCount64;
+        long timeoutMs = (long)_sessionConfig.StreamTimeout.TotalMilliseconds;
+
+        foreach (var (key, stream) in _streams)
+        {
+            if (now - Volatile.Read(ref stream.LastPacketTicks) < timeoutMs)
+            {
+                continue;
+            }
+
+            lock (_streamsLock)
+            {
+                if (!_streams.TryRemove(key, out _))
+                {
+                    continue;
+                }
+
+                var state = _channels.First(s => s.Channel == stream.Channel);
+                state.Streams = state.Streams.Where(s => s != stream).ToArray();
+            }
+
+            stream.MarkRemoved();
+            _logger.LogInformation($"RTP stream {stream} timed out, {stream.ReceptionStatistics}.");
+            OnStreamRemoved?.Invoke(stream);
+        }
     }
 }
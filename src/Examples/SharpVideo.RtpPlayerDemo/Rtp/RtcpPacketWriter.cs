@@ -0,0 +1,203 @@
+using System.Buffers.Binary;
+using System.Text;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Serialises the RTCP packets a receiver sends: receiver reports and SDES (RFC 3550), generic NACK and PLI
+/// (RFC 4585) and FIR (RFC 5104).
+/// </summary>
+/// <remarks>
+/// All writers take a destination span and return the number of bytes written, so compound packets are built by
+/// writing the parts back to back into one stack buffer without allocating.
+/// </remarks>
+internal static class RtcpPacketWriter
+{
+    public const int RTCP_HEADER_LENGTH = 4;
+    public const int RECEPTION_REPORT_LENGTH = 24;
+
+    public const byte PT_SR = 200;
+    public const byte PT_RR = 201;
+    public const byte PT_SDES = 202;
+    public const byte PT_BYE = 203;
+    public const byte PT_RTPFB = 205;
+    public const byte PT_PSFB = 206;
+
+    private const int FMT_GENERIC_NACK = 1;
+    private const int FMT_PLI = 1;
+    private const int FMT_FIR = 4;
+
+    private const byte SDES_CNAME = 1;
+
+    /// <summary>
+    /// Largest number of NACK FCI entries put into one packet, each covers up to 17 sequence numbers.
+    /// </summary>
+    public const int MAX_NACK_ITEMS = 64;
+
+    /// <summary>
+    /// Returns true if the packet is RTCP rather than RTP when both are multiplexed on one port (RFC 5761 4).
+    /// </summary>
+    public static bool IsRtcp(ReadOnlySpan<byte> packet)
+    {
+        return packet.Length >= RTCP_HEADER_LENGTH && packet[1] >= 192 && packet[1] <= 223;
+    }
+
+    /// <summary>
+    /// Writes a receiver report. Pass null statistics for an empty report (RC=0) as required at the head of a
+    /// compound feedback packet.
+    /// </summary>
+    /// <param name="destination">Buffer to write to, at least 32 bytes.</param>
+    /// <param name="senderSsrc">Our own SSRC.</param>
+    /// <param name="statistics">Statistics of the reported source, or null.</param>
+    /// <param name="lastSenderReport">Middle 32 bits of the NTP timestamp of the last SR received from the source.</param>
+    /// <param name="delaySinceLastSenderReport">Delay since that SR in units of 1/65536 seconds.</param>
+    public static int WriteReceiverReport(Span<byte> destination, uint senderSsrc, RtpReceptionStatistics? statistics,
+        uint lastSenderReport, uint delaySinceLastSenderReport)
+    {
+        int reportCount = statistics != null ? 1 : 0;
+        int length = RTCP_HEADER_LENGTH + 4 + reportCount * RECEPTION_REPORT_LENGTH;
+
+        WriteHeader(destination, reportCount, PT_RR, length);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(4), senderSsrc);
+
+        if (statistics != null)
+        {
+            var block = destination.Slice(8, RECEPTION_REPORT_LENGTH);
+
+            // Cumulative loss is a signed 24 bit value, clamped rather than wrapped.
+            int cumulativeLost = (int)Math.Clamp(statistics.PacketsLost, -0x800000, 0x7FFFFF);
+
+            BinaryPrimitives.WriteUInt32BigEndian(block, statistics.Ssrc);
+            BinaryPrimitives.WriteUInt32BigEndian(block.Slice(4),
+                ((uint)statistics.GetFractionLostSinceLastCall() << 24) | ((uint)cumulativeLost & 0xFFFFFF));
+            BinaryPrimitives.WriteUInt32BigEndian(block.Slice(8), unchecked((uint)statistics.HighestSequenceNumber));
+            BinaryPrimitives.WriteUInt32BigEndian(block.Slice(12), (uint)statistics.Jitter);
+            BinaryPrimitives.WriteUInt32BigEndian(block.Slice(16), lastSenderReport);
+            BinaryPrimitives.WriteUInt32BigEndian(block.Slice(20), delaySinceLastSenderReport);
+        }
+
+        return length;
+    }
+
+    /// <summary>
+    /// Writes an SDES packet with a single CNAME item.
+    /// </summary>
+    public static int WriteSdesCname(Span<byte> destination, uint senderSsrc, string cname)
+    {
+        // Chunk: SSRC, CNAME item (type, length, text), null terminator padded to 32 bits.
+        var text = destination.Slice(RTCP_HEADER_LENGTH + 6);
+        int textLength = Encoding.ASCII.GetBytes(cname.AsSpan(0, Math.Min(cname.Length, 255)), text);
+        int chunkLength = (4 + 2 + textLength + 4) & ~3;
+        int length = RTCP_HEADER_LENGTH + chunkLength;
+
+        WriteHeader(destination, 1, PT_SDES, length);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(4), senderSsrc);
+        destination[8] = SDES_CNAME;
+        destination[9] = (byte)textLength;
+        destination.Slice(RTCP_HEADER_LENGTH + 6 + textLength, chunkLength - 6 - textLength).Clear();
+
+        return length;
+    }
+
+    /// <summary>
+    /// Writes a generic NACK (RFC 4585 6.2.1) for a run of consecutive sequence numbers. Runs longer than
+    /// <see cref="MAX_NACK_ITEMS"/> × 17 packets are truncated to their start.
+    /// </summary>
+    public static int WriteGenericNack(Span<byte> destination, uint senderSsrc, uint mediaSsrc,
+        ushort firstSequenceNumber, int count)
+    {
+        int items = Math.Min((count + 16) / 17, MAX_NACK_ITEMS);
+        int length = RTCP_HEADER_LENGTH + 8 + items * 4;
+
+        WriteHeader(destination, FMT_GENERIC_NACK, PT_RTPFB, length);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(4), senderSsrc);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(8), mediaSsrc);
+
+        // Each FCI carries a packet ID and a bitmask of the 16 following sequence numbers.
+        var fci = destination.Slice(12);
+        for (int i = 0; i < items; i++)
+        {
+            int remaining = count - i * 17 - 1;
+            ushort bitmask = remaining >= 16 ? (ushort)0xFFFF : (ushort)((1 << remaining) - 1);
+            BinaryPrimitives.WriteUInt16BigEndian(fci.Slice(i * 4), (ushort)(firstSequenceNumber + i * 17));
+            BinaryPrimitives.WriteUInt16BigEndian(fci.Slice(i * 4 + 2), bitmask);
+        }
+
+        return length;
+    }
+
+    /// <summary>
+    /// Writes a picture loss indication (RFC 4585 6.3.1).
+    /// </summary>
+    public static int WritePictureLossIndication(Span<byte> destination, uint senderSsrc, uint mediaSsrc)
+    {
+        const int length = RTCP_HEADER_LENGTH + 8;
+
+        WriteHeader(destination, FMT_PLI, PT_PSFB, length);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(4), senderSsrc);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(8), mediaSsrc);
+
+        return length;
+    }
+
+    /// <summary>
+    /// Writes a full intra request (RFC 5104 4.3.1). The sequence number must be incremented for every new request
+    /// and kept for repetitions of the same one.
+    /// </summary>
+    public static int WriteFullIntraRequest(Span<byte> destination, uint senderSsrc, uint mediaSsrc, byte sequenceNumber)
+    {
+        const int length = RTCP_HEADER_LENGTH + 8 + 8;
+
+        WriteHeader(destination, FMT_FIR, PT_PSFB, length);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(4), senderSsrc);
+        // The media source field is unused for FIR, the target is named in the FCI.
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(8), 0);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(12), mediaSsrc);
+        BinaryPrimitives.WriteUInt32BigEndian(destination.Slice(16), (uint)sequenceNumber << 24);
+
+        return length;
+    }
+
+    /// <summary>
+    /// Finds a sender report of the given source in a (compound) RTCP packet.
+    /// </summary>
+    /// <param name="packet">The received RTCP packet.</param>
+    /// <param name="ssrc">Source to look for, 0 for any.</param>
+    /// <param name="senderSsrc">SSRC of the sender report found.</param>
+    /// <param name="ntpTimestamp">64 bit NTP timestamp of the sender report found.</param>
+    public static bool TryReadSenderReport(ReadOnlySpan<byte> packet, uint ssrc, out uint senderSsrc, out ulong ntpTimestamp)
+    {
+        while (packet.Length >= RTCP_HEADER_LENGTH && (packet[0] >> 6) == 2)
+        {
+            int length = (BinaryPrimitives.ReadUInt16BigEndian(packet.Slice(2)) + 1) * 4;
+            if (length > packet.Length)
+            {
+                break;
+            }
+
+            if (packet[1] == PT_SR && length >= 28)
+            {
+                senderSsrc = BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(4));
+                if (ssrc == 0 || senderSsrc == ssrc)
+                {
+                    ntpTimestamp = BinaryPrimitives.ReadUInt64BigEndian(packet.Slice(8));
+                    return true;
+                }
+            }
+
+            packet = packet.Slice(length);
+        }
+
+        senderSsrc = 0;
+        ntpTimestamp = 0;
+        return false;
+    }
+
+    private static void WriteHeader(Span<byte> destination, int countOrFormat, byte packetType, int length)
+    {
+        // V=2, P=0, RC/FMT, PT, length in 32 bit words minus one.
+        destination[0] = (byte)(0x80 | (countOrFormat & 0x1F));
+        destination[1] = packetType;
+        BinaryPrimitives.WriteUInt16BigEndian(destination.Slice(2), (ushort)(length / 4 - 1));
+    }
+}
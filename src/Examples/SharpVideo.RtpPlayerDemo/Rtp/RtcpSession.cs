@@ -0,0 +1,307 @@
+using System.Diagnostics;
+using System.Net;
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using SharpVideo.Srtp;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Receiver side RTCP: periodic receiver reports, generic NACK for sequence gaps and PLI/FIR key frame requests.
+/// </summary>
+/// <remarks>
+/// Feedback is sent as reduced compound packets (empty RR, SDES, feedback message) as soon as it is needed, so a
+/// lost packet is requested within one round trip of detecting the gap instead of waiting for the next report
+/// interval (RFC 4585 immediate feedback mode). Packets go to, in order of preference, the configured RTCP end
+/// point, the end point the sender's own RTCP came from, or the RTP source port + 1.
+///
+/// Methods may be called from the RTP receive thread, the decoder thread and the report timer concurrently.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+internal sealed class RtcpSession : IDisposable
+{
+    private const int MAX_RTCP_PACKET_SIZE = 512;
+
+    private readonly RTPChannel _channel;
+    private readonly RtpSessionConfig _config;
+    private readonly ILogger _logger;
+    private readonly Func<RtpReceptionStatistics> _getStatistics;
+    private readonly string _cname;
+    private readonly Timer _reportTimer;
+    private readonly object _keyFrameLock = new();
+    private readonly SrtcpContext? _srtcp;
+
+    private IPEndPoint? _remoteRtpEndPoint;
+    private IPEndPoint? _remoteControlEndPoint;
+    private RTPChannelSocketsEnum _controlSocket = RTPChannelSocketsEnum.Control;
+
+    private uint _lastSenderReport;
+    private long _lastSenderReportReceivedTicks;
+
+    private bool _isKeyFrameRequested;
+    private long _lastKeyFrameRequestTicks;
+    private byte _firSequenceNumber;
+    private TimeSpan _timerPeriod;
+    private long _lastReportTicks;
+    private bool _isClosed;
+
+    private int _reportsSent;
+    private int _nacksSent;
+    private int _packetsNacked;
+    private int _keyFrameRequestsSent;
+
+    /// <param name="channel">Channel whose control socket the packets are sent on.</param>
+    /// <param name="config">Session configuration.</param>
+    /// <param name="getStatistics">Returns the statistics of the stream currently received.</param>
+    /// <param name="logger">Logger.</param>
+    public RtcpSession(RTPChannel channel, RtpSessionConfig config, Func<RtpReceptionStatistics> getStatistics, ILogger logger)
+    {
+        _channel = channel;
+        _config = config;
+        _getStatistics = getStatistics;
+        _logger = logger;
+        Ssrc = Crypto.GetRandomUInt(true);
+        _cname = $"{Environment.MachineName}-{Ssrc:x8}";
+        _reportTimer = new Timer(_ => OnReportTimer());
+        if (config.SrtpSendPolicy != null)
+        {
+            _srtcp = new SrtcpContext(config.SrtpSendPolicy);
+        }
+    }
+
+    /// <summary>
+    /// Our own synchronisation source, used as the sender SSRC of all RTCP packets.
+    /// </summary>
+    public uint Ssrc { get; }
+
+    /// <summary>
+    /// Number of periodic receiver reports sent.
+    /// </summary>
+    public int ReportsSent => _reportsSent;
+
+    /// <summary>
+    /// Number of generic NACK packets sent.
+    /// </summary>
+    public int NacksSent => _nacksSent;
+
+    /// <summary>
+    /// Number of sequence numbers retransmission was requested for.
+    /// </summary>
+    public int PacketsNacked => _packetsNacked;
+
+    /// <summary>
+    /// Number of PLI or FIR packets sent, including repetitions.
+    /// </summary>
+    public int KeyFrameRequestsSent => _keyFrameRequestsSent;
+
+    /// <summary>
+    /// Starts sending periodic receiver reports.
+    /// </summary>
+    public void Start()
+    {
+        // The timer also repeats pending key frame requests, so it runs at the shorter of both intervals.
+        _timerPeriod = _config.RtcpReportInterval < _config.KeyFrameRequestInterval
+            ? _config.RtcpReportInterval
+            : _config.KeyFrameRequestInterval;
+        _reportTimer.Change(_timerPeriod, _timerPeriod);
+    }
+
+    /// <summary>
+    /// Records where the media comes from. Cheap, called for every RTP packet.
+    /// </summary>
+    public void SetRemoteRtpEndPoint(IPEndPoint remoteEndPoint)
+    {
+        _remoteRtpEndPoint = remoteEndPoint;
+    }
+
+    /// <summary>
+    /// Handles an RTCP packet from the sender.
+    /// </summary>
+    /// <param name="remoteEndPoint">Where the packet came from, used as destination for our RTCP.</param>
+    /// <param name="packet">The (compound) RTCP packet.</param>
+    /// <param name="isMultiplexed">True if it arrived on the RTP socket (RFC 5761 rtcp-mux).</param>
+    /// <remarks>
+    /// Several sessions can share a socket, so only sender reports of the session's own media source are used.
+    /// </remarks>
+    public void OnControlPacketReceived(IPEndPoint remoteEndPoint, ReadOnlySpan<byte> packet, bool isMultiplexed)
+    {
+        var mediaSsrc = _getStatistics().Ssrc;
+        if (mediaSsrc != 0 && RtcpPacketWriter.TryReadSenderReport(packet, mediaSsrc, out _, out var ntpTimestamp))
+        {
+            _remoteControlEndPoint = remoteEndPoint;
+            _controlSocket = isMultiplexed ? RTPChannelSocketsEnum.RTP : RTPChannelSocketsEnum.Control;
+
+            // LSR is the middle 32 bits of the NTP timestamp (RFC 3550 6.4.1).
+            _lastSenderReport = (uint)(ntpTimestamp >> 16);
+            Volatile.Write(ref _lastSenderReportReceivedTicks, Stopwatch.GetTimestamp());
+        }
+    }
+
+    /// <summary>
+    /// Requests retransmission of a run of missing packets.
+    /// </summary>
+    public void SendNack(ushort firstSequenceNumber, int count)
+    {
+        var statistics = _getStatistics();
+        Span<byte> buffer = stackalloc byte[MAX_RTCP_PACKET_SIZE];
+        int length = WriteFeedbackPrefix(buffer);
+        length += RtcpPacketWriter.WriteGenericNack(buffer.Slice(length), Ssrc, statistics.Ssrc, firstSequenceNumber, count);
+
+        if (Send(buffer, length))
+        {
+            Interlocked.Increment(ref _nacksSent);
+            Interlocked.Add(ref _packetsNacked, count);
+        }
+    }
+
+    /// <summary>
+    /// Asks the sender for a key frame. Requests are repeated every <see cref="RtpSessionConfig.KeyFrameRequestInterval"/>
+    /// until <see cref="OnKeyFrameReceived"/> is called.
+    /// </summary>
+    public void RequestKeyFrame()
+    {
+        lock (_keyFrameLock)
+        {
+            if (!_isKeyFrameRequested)
+            {
+                _isKeyFrameRequested = true;
+                // A new request, as opposed to a repetition, gets a new FIR sequence number (RFC 5104 4.3.1.2).
+                _firSequenceNumber++;
+                _lastKeyFrameRequestTicks = 0;
+            }
+
+            SendKeyFrameRequestIfDue();
+        }
+    }
+
+    /// <summary>
+    /// Stops repeating key frame requests.
+    /// </summary>
+    public void OnKeyFrameReceived()
+    {
+        if (!Volatile.Read(ref _isKeyFrameRequested))
+        {
+            return;
+        }
+
+        lock (_keyFrameLock)
+        {
+            _isKeyFrameRequested = false;
+        }
+    }
+
+    private void SendKeyFrameRequestIfDue()
+    {
+        long now = Stopwatch.GetTimestamp();
+        if (_lastKeyFrameRequestTicks != 0 &&
+            Stopwatch.GetElapsedTime(_lastKeyFrameRequestTicks, now) < _config.KeyFrameRequestInterval)
+        {
+            return;
+        }
+
+        var statistics = _getStatistics();
+        if (statistics.Ssrc == 0)
+        {
+            // Nothing received yet, there is no media source to address.
+            return;
+        }
+
+        Span<byte> buffer = stackalloc byte[MAX_RTCP_PACKET_SIZE];
+        int length = WriteFeedbackPrefix(buffer);
+        length += _config.UseFullIntraRequest
+            ? RtcpPacketWriter.WriteFullIntraRequest(buffer.Slice(length), Ssrc, statistics.Ssrc, _firSequenceNumber)
+            : RtcpPacketWriter.WritePictureLossIndication(buffer.Slice(length), Ssrc, statistics.Ssrc);
+
+        if (Send(buffer, length))
+        {
+            _lastKeyFrameRequestTicks = now;
+            Interlocked.Increment(ref _keyFrameRequestsSent);
+            _logger.LogDebug($"Sent {(_config.UseFullIntraRequest ? "FIR" : "PLI")} for SSRC {statistics.Ssrc}.");
+        }
+    }
+
+    private void OnReportTimer()
+    {
+        if (_isClosed)
+        {
+            return;
+        }
+
+        var statistics = _getStatistics();
+        long now = Stopwatch.GetTimestamp();
+        if (statistics.PacketsReceived > 0 &&
+            Stopwatch.GetElapsedTime(_lastReportTicks, now) >= _config.RtcpReportInterval - _timerPeriod / 2)
+        {
+            _lastReportTicks = now;
+
+            uint delaySinceLastSenderReport = 0;
+            long lastSenderReportTicks = Volatile.Read(ref _lastSenderReportReceivedTicks);
+            if (lastSenderReportTicks != 0)
+            {
+                delaySinceLastSenderReport = (uint)(Stopwatch.GetElapsedTime(lastSenderReportTicks).TotalSeconds * 65536);
+            }
+
+            Span<byte> buffer = stackalloc byte[MAX_RTCP_PACKET_SIZE];
+            int length = RtcpPacketWriter.WriteReceiverReport(buffer, Ssrc, statistics,
+                lastSenderReportTicks != 0 ? _lastSenderReport : 0, delaySinceLastSenderReport);
+            length += RtcpPacketWriter.WriteSdesCname(buffer.Slice(length), Ssrc, _cname);
+
+            if (Send(buffer, length))
+            {
+                Interlocked.Increment(ref _reportsSent);
+            }
+        }
+
+        lock (_keyFrameLock)
+        {
+            if (_isKeyFrameRequested)
+            {
+                SendKeyFrameRequestIfDue();
+            }
+        }
+    }
+
+    /// <summary>
+    /// Writes the empty receiver report and SDES every compound feedback packet has to start with.
+    /// </summary>
+    private int WriteFeedbackPrefix(Span<byte> buffer)
+    {
+        int length = RtcpPacketWriter.WriteReceiverReport(buffer, Ssrc, null, 0, 0);
+        length += RtcpPacketWriter.WriteSdesCname(buffer.Slice(length), Ssrc, _cname);
+        return length;
+    }
+
+    /// <summary>
+    /// Sends the compound packet at the start of <paramref name="buffer"/>, SRTCP protected in place if enabled.
+    /// </summary>
+    private bool Send(Span<byte> buffer, int length)
+    {
+        var destination = _config.RtcpRemoteEndPoint ?? _remoteControlEndPoint;
+        var socket = _controlSocket;
+        if (destination == null)
+        {
+            var remoteRtpEndPoint = _remoteRtpEndPoint;
+            if (remoteRtpEndPoint == null || remoteRtpEndPoint.Port == IPEndPoint.MaxPort)
+            {
+                return false;
+            }
+
+            destination = new IPEndPoint(remoteRtpEndPoint.Address, remoteRtpEndPoint.Port + 1);
+            socket = RTPChannelSocketsEnum.Control;
+        }
+
+        if (_srtcp != null && !_srtcp.TryProtect(buffer, ref length))
+        {
+            return false;
+        }
+
+        return _channel.Send(socket, destination, buffer.Slice(0, length));
+    }
+
+    public void Dispose()
+    {
+        _isClosed = true;
+        _reportTimer.Dispose();
+        _srtcp?.Dispose();
+    }
+}
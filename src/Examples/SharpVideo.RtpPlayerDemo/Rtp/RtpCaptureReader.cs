@@ -0,0 +1,270 @@
+using System.Buffers.Binary;
+using System.Net;
+using System.Net.Sockets;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// A UDP datagram read from a capture file.
+/// </summary>
+/// <param name="TimestampNs">Capture time, nanoseconds since the Unix epoch.</param>
+/// <param name="Source">Sender of the datagram.</param>
+/// <param name="DestinationPort">UDP port the datagram was sent to.</param>
+/// <param name="Payload">The UDP payload, an RTP or RTCP packet.</param>
+public sealed record RtpCapturedPacket(long TimestampNs, IPEndPoint Source, int DestinationPort, byte[] Payload);
+
+/// <summary>
+/// Reads the UDP datagrams of a pcap file, either one written by <see cref="RtpCaptureWriter"/> or by tcpdump and
+/// Wireshark.
+/// </summary>
+/// <remarks>
+/// Both microsecond and nanosecond files in either byte order are accepted, with raw IP, Ethernet (optionally
+/// VLAN tagged), Linux cooked and BSD loopback link types. Records that are not unfragmented IPv4 or IPv6 UDP are
+/// skipped, as are truncated ones. pcapng is not supported; convert with <c>editcap -F pcap</c>.
+/// </remarks>
+public sealed class RtpCaptureReader : IDisposable
+{
+    private const int ETHERNET_HEADER_LENGTH = 14;
+    private const int VLAN_TAG_LENGTH = 4;
+    private const int LINUX_SLL_HEADER_LENGTH = 16;
+    private const int NULL_HEADER_LENGTH = 4;
+    private const int UDP_HEADER_LENGTH = 8;
+    private const ushort ETHERTYPE_IPV4 = 0x0800;
+    private const ushort ETHERTYPE_IPV6 = 0x86DD;
+    private const ushort ETHERTYPE_VLAN = 0x8100;
+    private const int READ_BUFFER_SIZE = 1024 * 1024;
+
+    private readonly Stream _stream;
+    private readonly bool _isBigEndian;
+    private readonly bool _isNanosecond;
+    private readonly int _linkType;
+    private byte[] _record = new byte[65536];
+
+    public RtpCaptureReader(string path)
+        : this(new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read, READ_BUFFER_SIZE))
+    {
+    }
+
+    /// <param name="stream">Stream to read from, owned by the reader.</param>
+    public RtpCaptureReader(Stream stream)
+    {
+        _stream = stream;
+
+        Span<byte> header = stackalloc byte[RtpCaptureWriter.PCAP_FILE_HEADER_LENGTH];
+        if (!TryReadExactly(header))
+        {
+            throw new InvalidDataException("The capture file is shorter than a pcap file header.");
+        }
+
+        uint magic = BinaryPrimitives.ReadUInt32LittleEndian(header);
+        uint swappedMagic = BinaryPrimitives.ReverseEndianness(magic);
+        if (magic == RtpCaptureWriter.PCAP_MAGIC_MICROSECONDS || magic == RtpCaptureWriter.PCAP_MAGIC_NANOSECONDS)
+        {
+            _isBigEndian = false;
+            _isNanosecond = magic == RtpCaptureWriter.PCAP_MAGIC_NANOSECONDS;
+        }
+        else if (swappedMagic == RtpCaptureWriter.PCAP_MAGIC_MICROSECONDS || swappedMagic == RtpCaptureWriter.PCAP_MAGIC_NANOSECONDS)
+        {
+            _isBigEndian = true;
+            _isNanosecond = swappedMagic == RtpCaptureWriter.PCAP_MAGIC_NANOSECONDS;
+        }
+        else
+        {
+            throw new InvalidDataException($"Not a pcap file (magic 0x{magic:X8}).");
+        }
+
+        _linkType = (int)(ReadUInt32(header.Slice(20)) & 0x0FFFFFFF);
+        if (_linkType != RtpCaptureWriter.LINKTYPE_RAW && _linkType != RtpCaptureWriter.LINKTYPE_ETHERNET &&
+            _linkType != RtpCaptureWriter.LINKTYPE_LINUX_SLL && _linkType != RtpCaptureWriter.LINKTYPE_NULL)
+        {
+            throw new NotSupportedException($"Unsupported pcap link type {_linkType}.");
+        }
+    }
+
+    /// <summary>
+    /// Number of records skipped because they are not complete UDP datagrams.
+    /// </summary>
+    public int SkippedRecords { get; private set; }
+
+    /// <summary>
+    /// Reads the next UDP datagram.
+    /// </summary>
+    /// <returns>False at the end of the file.</returns>
+    public bool TryReadNext(out RtpCapturedPacket packet)
+    {
+        Span<byte> recordHeader = stackalloc byte[RtpCaptureWriter.PCAP_RECORD_HEADER_LENGTH];
+        while (TryReadExactly(recordHeader))
+        {
+            long seconds = ReadUInt32(recordHeader);
+            long fraction = ReadUInt32(recordHeader.Slice(4));
+            int capturedLength = (int)ReadUInt32(recordHeader.Slice(8));
+            int originalLength = (int)ReadUInt32(recordHeader.Slice(12));
+
+            if (capturedLength < 0 || capturedLength > 0x40000)
+            {
+                throw new InvalidDataException($"Corrupt pcap record length {capturedLength}.");
+            }
+
+            if (_record.Length < capturedLength)
+            {
+                _record = new byte[capturedLength];
+            }
+
+            var record = _record.AsSpan(0, capturedLength);
+            if (!TryReadExactly(record))
+            {
+                // Truncated last record, e.g. from a capture that was killed.
+                break;
+            }
+
+            long timestampNs = seconds * 1_000_000_000 + (_isNanosecond ? fraction : fraction * 1000);
+            if (capturedLength == originalLength && TryParseUdp(record, timestampNs, out packet))
+            {
+                return true;
+            }
+
+            SkippedRecords++;
+        }
+
+        packet = null!;
+        return false;
+    }
+
+    /// <summary>
+    /// Reads all remaining UDP datagrams.
+    /// </summary>
+    public IEnumerable<RtpCapturedPacket> ReadAll()
+    {
+        while (TryReadNext(out var packet))
+        {
+            yield return packet;
+        }
+    }
+
+    private bool TryParseUdp(ReadOnlySpan<byte> record, long timestampNs, out RtpCapturedPacket packet)
+    {
+        packet = null!;
+        int ipVersion;
+        switch (_linkType)
+        {
+            case RtpCaptureWriter.LINKTYPE_RAW:
+                if (record.IsEmpty)
+                {
+                    return false;
+                }
+                ipVersion = record[0] >> 4;
+                break;
+
+            case RtpCaptureWriter.LINKTYPE_ETHERNET:
+            {
+                if (record.Length < ETHERNET_HEADER_LENGTH)
+                {
+                    return false;
+                }
+
+                int offset = ETHERNET_HEADER_LENGTH;
+                ushort etherType = BinaryPrimitives.ReadUInt16BigEndian(record.Slice(12));
+                while (etherType == ETHERTYPE_VLAN && record.Length >= offset + VLAN_TAG_LENGTH)
+                {
+                    etherType = BinaryPrimitives.ReadUInt16BigEndian(record.Slice(offset + 2));
+                    offset += VLAN_TAG_LENGTH;
+                }
+
+                ipVersion = EtherTypeToIpVersion(etherType);
+                record = record.Slice(offset);
+                break;
+            }
+
+            case RtpCaptureWriter.LINKTYPE_LINUX_SLL:
+                if (record.Length < LINUX_SLL_HEADER_LENGTH)
+                {
+                    return false;
+                }
+                ipVersion = EtherTypeToIpVersion(BinaryPrimitives.ReadUInt16BigEndian(record.Slice(14)));
+                record = record.Slice(LINUX_SLL_HEADER_LENGTH);
+                break;
+
+            default:
+                // BSD loopback, the family is in the byte order of the capturing host; the IP header tells the version.
+                if (record.Length <= NULL_HEADER_LENGTH)
+                {
+                    return false;
+                }
+                record = record.Slice(NULL_HEADER_LENGTH);
+                ipVersion = record[0] >> 4;
+                break;
+        }
+
+        IPAddress sourceAddress;
+        ReadOnlySpan<byte> udp;
+        if (ipVersion == 4)
+        {
+            if (record.Length < 20)
+            {
+                return false;
+            }
+
+            int headerLength = (record[0] & 0x0F) * 4;
+            ushort fragment = BinaryPrimitives.ReadUInt16BigEndian(record.Slice(6));
+            if (record[9] != (byte)ProtocolType.Udp || (fragment & 0x3FFF) != 0 || headerLength < 20 || record.Length < headerLength)
+            {
+                return false;
+            }
+
+            sourceAddress = new IPAddress(record.Slice(12, 4));
+            udp = record.Slice(headerLength);
+        }
+        else if (ipVersion == 6)
+        {
+            if (record.Length < 40 || record[6] != (byte)ProtocolType.Udp)
+            {
+                return false;
+            }
+
+            sourceAddress = new IPAddress(record.Slice(8, 16));
+            udp = record.Slice(40);
+        }
+        else
+        {
+            return false;
+        }
+
+        if (udp.Length < UDP_HEADER_LENGTH)
+        {
+            return false;
+        }
+
+        int udpLength = BinaryPrimitives.ReadUInt16BigEndian(udp.Slice(4));
+        if (udpLength < UDP_HEADER_LENGTH || udpLength > udp.Length)
+        {
+            return false;
+        }
+
+        var source = new IPEndPoint(sourceAddress, BinaryPrimitives.ReadUInt16BigEndian(udp));
+        int destinationPort = BinaryPrimitives.ReadUInt16BigEndian(udp.Slice(2));
+        packet = new RtpCapturedPacket(timestampNs, source, destinationPort, udp.Slice(UDP_HEADER_LENGTH, udpLength - UDP_HEADER_LENGTH).ToArray());
+        return true;
+    }
+
+    private static int EtherTypeToIpVersion(ushort etherType) => etherType switch
+    {
+        ETHERTYPE_IPV4 => 4,
+        ETHERTYPE_IPV6 => 6,
+        _ => 0,
+    };
+
+    private uint ReadUInt32(ReadOnlySpan<byte> buffer)
+    {
+        return _isBigEndian ? BinaryPrimitives.ReadUInt32BigEndian(buffer) : BinaryPrimitives.ReadUInt32LittleEndian(buffer);
+    }
+
+    private bool TryReadExactly(Span<byte> buffer)
+    {
+        return _stream.ReadAtLeast(buffer, buffer.Length, throwOnEndOfStream: false) == buffer.Length;
+    }
+
+    public void Dispose()
+    {
+        _stream.Dispose();
+    }
+}
@@ -0,0 +1,176 @@
+using System.Buffers.Binary;
+using System.Net;
+using System.Net.Sockets;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Records received datagrams to a pcap file with nanosecond timestamps.
+/// </summary>
+/// <remarks>
+/// The file uses the raw IP link type: every record gets a synthesised IPv4 or IPv6 and UDP header carrying the
+/// sender address and the local port the datagram arrived on, so the capture opens in Wireshark ("Decode As RTP")
+/// and can be fed back through <see cref="RtpCaptureReader"/> and <see cref="RtpReplayer"/>. The timestamps are
+/// the kernel receive timestamps passed in by the receive path. Writes are buffered and may come from several
+/// receive threads.
+/// </remarks>
+public sealed class RtpCaptureWriter : IDisposable
+{
+    public const uint PCAP_MAGIC_MICROSECONDS = 0xA1B2C3D4;
+    public const uint PCAP_MAGIC_NANOSECONDS = 0xA1B23C4D;
+    public const int PCAP_FILE_HEADER_LENGTH = 24;
+    public const int PCAP_RECORD_HEADER_LENGTH = 16;
+    public const int LINKTYPE_NULL = 0;
+    public const int LINKTYPE_ETHERNET = 1;
+    public const int LINKTYPE_RAW = 101;
+    public const int LINKTYPE_LINUX_SLL = 113;
+
+    private const int SNAPLEN = 65535;
+    private const int IPV4_HEADER_LENGTH = 20;
+    private const int IPV6_HEADER_LENGTH = 40;
+    private const int UDP_HEADER_LENGTH = 8;
+    private const int WRITE_BUFFER_SIZE = 1024 * 1024;
+
+    private readonly Stream _stream;
+    private readonly IPAddress _localAddress;
+    private readonly object _lock = new();
+    private bool _isDisposed;
+
+    /// <param name="path">File to create, overwritten if it exists.</param>
+    /// <param name="localAddress">Destination address written into the records, typically the bind address.</param>
+    public RtpCaptureWriter(string path, IPAddress localAddress)
+        : this(new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.Read, WRITE_BUFFER_SIZE), localAddress)
+    {
+    }
+
+    /// <param name="stream">Stream to write to, owned by the writer.</param>
+    /// <param name="localAddress">Destination address written into the records, typically the bind address.</param>
+    public RtpCaptureWriter(Stream stream, IPAddress localAddress)
+    {
+        _stream = stream;
+        _localAddress = localAddress;
+
+        Span<byte> header = stackalloc byte[PCAP_FILE_HEADER_LENGTH];
+        BinaryPrimitives.WriteUInt32LittleEndian(header, PCAP_MAGIC_NANOSECONDS);
+        BinaryPrimitives.WriteUInt16LittleEndian(header.Slice(4), 2); // version 2.4
+        BinaryPrimitives.WriteUInt16LittleEndian(header.Slice(6), 4);
+        BinaryPrimitives.WriteInt32LittleEndian(header.Slice(8), 0); // thiszone
+        BinaryPrimitives.WriteUInt32LittleEndian(header.Slice(12), 0); // sigfigs
+        BinaryPrimitives.WriteUInt32LittleEndian(header.Slice(16), SNAPLEN);
+        BinaryPrimitives.WriteUInt32LittleEndian(header.Slice(20), LINKTYPE_RAW);
+        _stream.Write(header);
+    }
+
+    /// <summary>
+    /// Number of datagrams written.
+    /// </summary>
+    public long PacketsWritten { get; private set; }
+
+    /// <summary>
+    /// Appends a datagram.
+    /// </summary>
+    /// <param name="localPort">Local port the datagram was received on.</param>
+    /// <param name="remoteEndPoint">Sender of the datagram.</param>
+    /// <param name="packet">The UDP payload.</param>
+    /// <param name="receivedTimestampNs">Receive time, nanoseconds since the Unix epoch.</param>
+    public void Write(int localPort, IPEndPoint remoteEndPoint, ReadOnlySpan<byte> packet, long receivedTimestampNs)
+    {
+        var sourceAddress = remoteEndPoint.Address.IsIPv4MappedToIPv6 ? remoteEndPoint.Address.MapToIPv4() : remoteEndPoint.Address;
+        bool isIPv6 = sourceAddress.AddressFamily == AddressFamily.InterNetworkV6;
+        var destinationAddress = isIPv6 ? _localAddress.MapToIPv6() : _localAddress.MapToIPv4();
+        int ipHeaderLength = isIPv6 ? IPV6_HEADER_LENGTH : IPV4_HEADER_LENGTH;
+        int capturedLength = Math.Min(packet.Length, SNAPLEN - ipHeaderLength - UDP_HEADER_LENGTH);
+        int udpLength = UDP_HEADER_LENGTH + packet.Length;
+
+        Span<byte> header = stackalloc byte[PCAP_RECORD_HEADER_LENGTH + IPV6_HEADER_LENGTH + UDP_HEADER_LENGTH];
+        header.Clear();
+
+        BinaryPrimitives.WriteUInt32LittleEndian(header, (uint)(receivedTimestampNs / 1_000_000_000));
+        BinaryPrimitives.WriteUInt32LittleEndian(header.Slice(4), (uint)(receivedTimestampNs % 1_000_000_000));
+        BinaryPrimitives.WriteUInt32LittleEndian(header.Slice(8), (uint)(ipHeaderLength + UDP_HEADER_LENGTH + capturedLength));
+        BinaryPrimitives.WriteUInt32LittleEndian(header.Slice(12), (uint)(ipHeaderLength + udpLength));
+
+        var ip = header.Slice(PCAP_RECORD_HEADER_LENGTH);
+        if (isIPv6)
+        {
+            ip[0] = 0x60;
+            BinaryPrimitives.WriteUInt16BigEndian(ip.Slice(4), (ushort)udpLength);
+            ip[6] = (byte)ProtocolType.Udp;
+            ip[7] = 64;
+            sourceAddress.TryWriteBytes(ip.Slice(8, 16), out _);
+            destinationAddress.TryWriteBytes(ip.Slice(24, 16), out _);
+        }
+        else
+        {
+            ip[0] = 0x45;
+            BinaryPrimitives.WriteUInt16BigEndian(ip.Slice(2), (ushort)(IPV4_HEADER_LENGTH + udpLength));
+            ip[8] = 64;
+            ip[9] = (byte)ProtocolType.Udp;
+            sourceAddress.TryWriteBytes(ip.Slice(12, 4), out _);
+            destinationAddress.TryWriteBytes(ip.Slice(16, 4), out _);
+            BinaryPrimitives.WriteUInt16BigEndian(ip.Slice(10), Ipv4HeaderChecksum(ip.Slice(0, IPV4_HEADER_LENGTH)));
+        }
+
+        // UDP checksum 0: not computed (allowed for IPv4, tolerated by readers for IPv6).
+        var udp = ip.Slice(ipHeaderLength);
+        BinaryPrimitives.WriteUInt16BigEndian(udp, (ushort)remoteEndPoint.Port);
+        BinaryPrimitives.WriteUInt16BigEndian(udp.Slice(2), (ushort)localPort);
+        BinaryPrimitives.WriteUInt16BigEndian(udp.Slice(4), (ushort)udpLength);
+
+        lock (_lock)
+        {
+            if (_isDisposed)
+            {
+                return;
+            }
+
+            _stream.Write(header.Slice(0, PCAP_RECORD_HEADER_LENGTH + ipHeaderLength + UDP_HEADER_LENGTH));
+            _stream.Write(packet.Slice(0, capturedLength));
+            PacketsWritten++;
+        }
+    }
+
+    /// <summary>
+    /// Writes buffered records to the file.
+    /// </summary>
+    public void Flush()
+    {
+        lock (_lock)
+        {
+            if (!_isDisposed)
+            {
+                _stream.Flush();
+            }
+        }
+    }
+
+    private static ushort Ipv4HeaderChecksum(ReadOnlySpan<byte> header)
+    {
+        uint sum = 0;
+        for (int i = 0; i < header.Length; i += 2)
+        {
+            sum += BinaryPrimitives.ReadUInt16BigEndian(header.Slice(i));
+        }
+
+        while (sum > 0xFFFF)
+        {
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+
+        return (ushort)~sum;
+    }
+
+    public void Dispose()
+    {
+        lock (_lock)
+        {
+            if (_isDisposed)
+            {
+                return;
+            }
+
+            _isDisposed = true;
+            _stream.Dispose();
+        }
+    }
+}
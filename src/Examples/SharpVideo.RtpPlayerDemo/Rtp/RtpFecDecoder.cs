@@ -0,0 +1,473 @@
+using System.Buffers.Binary;
+using System.Numerics;
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+internal delegate void RtpPacketRecoveredDelegate(ReadOnlySpan<byte> packet, ushort sequenceNumber, uint rtpTimestamp);
+
+/// <summary>
+/// Recovers lost media packets from ULPFEC (RFC 5109) and FlexFEC (RFC 8627) repair packets.
+/// </summary>
+/// <remarks>
+/// A repair packet carries the XOR of a set of media packets, given as a sequence number base and a bit mask. Once
+/// all but one of the protected packets have arrived the missing one is the XOR of the repair packet and the others.
+/// The decoder keeps a copy of the most recent media packets for this and holds repair packets until they either
+/// recovered a packet or all their packets arrived. Recovered packets are handed back through
+/// <see cref="OnPacketRecovered"/> so they can take the place of the lost ones in the jitter buffer, before
+/// depacketisation.
+///
+/// Only ULPFEC level 0 and FlexFEC with a flexible mask protecting a single SSRC are supported; other repair
+/// packets are counted as unsupported and ignored. The decoder is not thread safe, it is driven from the RTP
+/// receive thread.
+/// </remarks>
+internal sealed class RtpFecDecoder
+{
+    /// <summary>
+    /// Number of recent media packets kept for recovery. Must be a power of two.
+    /// </summary>
+    public const int HISTORY_SIZE = 512;
+
+    /// <summary>
+    /// Repair packets waiting for their protected packets. The oldest is dropped beyond this.
+    /// </summary>
+    private const int MAX_REPAIR_PACKETS = 64;
+
+    /// <summary>
+    /// Repair packets protecting sequence numbers further behind the newest media packet are dropped, the history
+    /// may no longer hold their packets.
+    /// </summary>
+    private const int MAX_REPAIR_AGE = HISTORY_SIZE / 2;
+
+    private const int ULPFEC_HEADER_LENGTH = 10;
+    private const int ULPFEC_LEVEL_HEADER_LENGTH = 4;
+    private const int ULPFEC_LONG_MASK_LENGTH = 4;
+    private const int FLEXFEC_HEADER_LENGTH = 12;
+    private const int INITIAL_SLOT_SIZE = 2048;
+
+    private struct HistorySlot
+    {
+        public byte[]? Data;
+        public int Length;
+        public ushort SequenceNumber;
+        public bool IsOccupied;
+    }
+
+    private sealed class RepairPacket
+    {
+        public ushort SequenceNumberBase;
+
+        /// <summary>
+        /// Bit i protects SequenceNumberBase + i.
+        /// </summary>
+        public UInt128 Mask;
+
+        public byte FirstByteRecovery;
+        public byte SecondByteRecovery;
+        public ushort LengthRecovery;
+        public uint TimestampRecovery;
+        public byte[] Payload = Array.Empty<byte>();
+        public int PayloadLength;
+    }
+
+    private readonly int _ulpfecPayloadType;
+    private readonly int _flexfecPayloadType;
+    private readonly HistorySlot[] _history = new HistorySlot[HISTORY_SIZE];
+    private readonly List<RepairPacket> _repairPackets = new();
+    private readonly Stack<RepairPacket> _freeRepairPackets = new();
+    private byte[] _recoveryBuffer = new byte[INITIAL_SLOT_SIZE];
+    private uint _mediaSsrc;
+    private ushort _highestSequenceNumber;
+    private bool _hasMedia;
+
+    /// <param name="ulpfecPayloadType">Payload type of ULPFEC packets, 0 if not used.</param>
+    /// <param name="flexfecPayloadType">Payload type of FlexFEC packets, 0 if not used.</param>
+    public RtpFecDecoder(int ulpfecPayloadType, int flexfecPayloadType)
+    {
+        _ulpfecPayloadType = ulpfecPayloadType;
+        _flexfecPayloadType = flexfecPayloadType;
+    }
+
+    /// <summary>
+    /// Fires for every recovered media packet, on the thread that called <see cref="AddRepairPacket"/> or
+    /// <see cref="Recover"/>. The packet is only valid during the call.
+    /// </summary>
+    public event RtpPacketRecoveredDelegate? OnPacketRecovered;
+
+    public int RecoveredPackets { get; private set; }
+
+    public int RepairPacketsReceived { get; private set; }
+
+    /// <summary>
+    /// Repair packets that were truncated, used an unsupported FEC variant or recovered an invalid packet.
+    /// </summary>
+    public int UnusableRepairPackets { get; private set; }
+
+    /// <summary>
+    /// Number of repair packets waiting for their protected packets.
+    /// </summary>
+    public int PendingRepairPackets => _repairPackets.Count;
+
+    public bool IsRepairPayloadType(int payloadType)
+    {
+        return payloadType != 0 && (payloadType == _ulpfecPayloadType || payloadType == _flexfecPayloadType);
+    }
+
+    /// <summary>
+    /// Keeps a copy of a received media packet for the recovery of others.
+    /// </summary>
+    public void AddMediaPacket(ReadOnlySpan<byte> packet, ushort sequenceNumber)
+    {
+        if (packet.Length < RTPHeader.MIN_HEADER_LEN)
+        {
+            return;
+        }
+
+        _mediaSsrc = BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(8));
+        if (!_hasMedia || (short)(sequenceNumber - _highestSequenceNumber) > 0)
+        {
+            _highestSequenceNumber = sequenceNumber;
+            _hasMedia = true;
+        }
+
+        ref var slot = ref _history[sequenceNumber & (HISTORY_SIZE - 1)];
+        if (slot.Data == null || slot.Data.Length < packet.Length)
+        {
+            slot.Data = new byte[Math.Max(INITIAL_SLOT_SIZE, packet.Length)];
+        }
+
+        packet.CopyTo(slot.Data);
+        slot.Length = packet.Length;
+        slot.SequenceNumber = sequenceNumber;
+        slot.IsOccupied = true;
+    }
+
+    /// <summary>
+    /// Parses a repair packet and recovers whatever it and the held repair packets make recoverable.
+    /// </summary>
+    /// <param name="hdr">Header of the repair packet.</param>
+    /// <param name="packet">The full repair packet.</param>
+    public void AddRepairPacket(RTPHeader hdr, ReadOnlySpan<byte> packet)
+    {
+        RepairPacketsReceived++;
+
+        var repair = _freeRepairPackets.Count > 0 ? _freeRepairPackets.Pop() : new RepairPacket();
+        var fecPacket = packet.Slice(Math.Min(hdr.Length, packet.Length), Math.Max(0, hdr.PayloadSize));
+        bool isValid = hdr.PayloadType == _ulpfecPayloadType
+            ? TryParseUlpfec(fecPacket, repair)
+            : TryParseFlexfec(hdr, packet, fecPacket, repair);
+        if (!isValid)
+        {
+            UnusableRepairPackets++;
+            _freeRepairPackets.Push(repair);
+            return;
+        }
+
+        if (_repairPackets.Count == MAX_REPAIR_PACKETS)
+        {
+            _freeRepairPackets.Push(_repairPackets[0]);
+            _repairPackets.RemoveAt(0);
+        }
+
+        _repairPackets.Add(repair);
+        Recover();
+    }
+
+    /// <summary>
+    /// Recovers every packet that is the only one missing from a held repair packet. A recovered packet can complete
+    /// further repair packets, so this repeats until nothing changes.
+    /// </summary>
+    public void Recover()
+    {
+        bool progress = true;
+        while (progress && _repairPackets.Count > 0)
+        {
+            progress = false;
+            for (int i = _repairPackets.Count - 1; i >= 0; i--)
+            {
+                var repair = _repairPackets[i];
+                if (_hasMedia && (short)(_highestSequenceNumber - repair.SequenceNumberBase) > MAX_REPAIR_AGE)
+                {
+                    RemoveRepairPacket(i);
+                    continue;
+                }
+
+                int missing = CountMissing(repair, out ushort missingSequenceNumber);
+                if (missing == 1)
+                {
+                    if (TryRecover(repair, missingSequenceNumber))
+                    {
+                        progress = true;
+                    }
+                    else
+                    {
+                        UnusableRepairPackets++;
+                    }
+
+                    RemoveRepairPacket(i);
+                }
+                else if (missing == 0)
+                {
+                    RemoveRepairPacket(i);
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Forgets all media and repair packets, e.g. when the media source changed.
+    /// </summary>
+    public void Reset()
+    {
+        for (int i = 0; i < _history.Length; i++)
+        {
+            _history[i].IsOccupied = false;
+        }
+
+        foreach (var repair in _repairPackets)
+        {
+            _freeRepairPackets.Push(repair);
+        }
+
+        _repairPackets.Clear();
+        _hasMedia = false;
+    }
+
+    private bool TryParseUlpfec(ReadOnlySpan<byte> fecPacket, RepairPacket repair)
+    {
+        // |E|L|P|X| CC |M| PT recovery | SN base | TS recovery | length recovery | (RFC 5109 7.3)
+        if (fecPacket.Length < ULPFEC_HEADER_LENGTH + ULPFEC_LEVEL_HEADER_LENGTH || (fecPacket[0] & 0x80) != 0)
+        {
+            return false;
+        }
+
+        bool isLongMask = (fecPacket[0] & 0x40) != 0;
+        var level = fecPacket.Slice(ULPFEC_HEADER_LENGTH);
+        int levelHeaderLength = ULPFEC_LEVEL_HEADER_LENGTH + (isLongMask ? ULPFEC_LONG_MASK_LENGTH : 0);
+        if (level.Length < levelHeaderLength)
+        {
+            return false;
+        }
+
+        // Level 0 header: protection length, then a 16 or 48 bit mask whose most significant bit is SN base + 0
+        int protectionLength = BinaryPrimitives.ReadUInt16BigEndian(level);
+        ulong mask = BinaryPrimitives.ReadUInt16BigEndian(level.Slice(2));
+        int maskBits = 16;
+        if (isLongMask)
+        {
+            mask = (mask << 32) | BinaryPrimitives.ReadUInt32BigEndian(level.Slice(4));
+            maskBits = 48;
+        }
+
+        repair.Mask = 0;
+        for (int bit = 0; bit < maskBits; bit++)
+        {
+            if ((mask & (1UL << (maskBits - 1 - bit))) != 0)
+            {
+                repair.Mask |= UInt128.One << bit;
+            }
+        }
+
+        repair.FirstByteRecovery = fecPacket[0];
+        repair.SecondByteRecovery = fecPacket[1];
+        repair.SequenceNumberBase = BinaryPrimitives.ReadUInt16BigEndian(fecPacket.Slice(2));
+        repair.TimestampRecovery = BinaryPrimitives.ReadUInt32BigEndian(fecPacket.Slice(4));
+        repair.LengthRecovery = BinaryPrimitives.ReadUInt16BigEndian(fecPacket.Slice(8));
+        var payload = level.Slice(levelHeaderLength);
+        return repair.Mask != 0 && SetPayload(repair, payload.Slice(0, Math.Min(protectionLength, payload.Length)));
+    }
+
+    private bool TryParseFlexfec(RTPHeader hdr, ReadOnlySpan<byte> packet, ReadOnlySpan<byte> fecPacket, RepairPacket repair)
+    {
+        // |R|F|P|X| CC |M| PT recovery | length recovery | TS recovery | SN base | k | mask ... (RFC 8627 4.2.2)
+        // R is a retransmission and F a fixed L/D mask, neither is supported. The protected SSRCs are the CSRCs of
+        // the repair packet, each followed by its own SN base and mask.
+        if (fecPacket.Length < FLEXFEC_HEADER_LENGTH || (fecPacket[0] & 0xC0) != 0 || hdr.CSRCCount > 1)
+        {
+            return false;
+        }
+
+        if (hdr.CSRCCount == 1 && _hasMedia && BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(RTPHeader.MIN_HEADER_LEN)) != _mediaSsrc)
+        {
+            return false;
+        }
+
+        repair.FirstByteRecovery = fecPacket[0];
+        repair.SecondByteRecovery = fecPacket[1];
+        repair.LengthRecovery = BinaryPrimitives.ReadUInt16BigEndian(fecPacket.Slice(2));
+        repair.TimestampRecovery = BinaryPrimitives.ReadUInt32BigEndian(fecPacket.Slice(4));
+        repair.SequenceNumberBase = BinaryPrimitives.ReadUInt16BigEndian(fecPacket.Slice(8));
+
+        // Mask chunks of 15, 31 and 63 bits, each led by a k bit that marks the last one
+        ushort chunk0 = BinaryPrimitives.ReadUInt16BigEndian(fecPacket.Slice(10));
+        repair.Mask = ReverseBits(chunk0 & 0x7FFFUL, 15);
+        int offset = FLEXFEC_HEADER_LENGTH;
+        if ((chunk0 & 0x8000) == 0)
+        {
+            if (fecPacket.Length < offset + 4)
+            {
+                return false;
+            }
+
+            uint chunk1 = BinaryPrimitives.ReadUInt32BigEndian(fecPacket.Slice(offset));
+            repair.Mask |= ReverseBits(chunk1 & 0x7FFFFFFFUL, 31) << 15;
+            offset += 4;
+            if ((chunk1 & 0x80000000) == 0)
+            {
+                if (fecPacket.Length < offset + 8)
+                {
+                    return false;
+                }
+
+                ulong chunk2 = BinaryPrimitives.ReadUInt64BigEndian(fecPacket.Slice(offset));
+                repair.Mask |= ReverseBits(chunk2 & 0x7FFFFFFFFFFFFFFFUL, 63) << 46;
+                offset += 8;
+            }
+        }
+
+        return repair.Mask != 0 && SetPayload(repair, fecPacket.Slice(offset));
+    }
+
+    /// <summary>
+    /// Turns a mask whose most significant of <paramref name="bits"/> bits is the first packet into one whose bit 0 is.
+    /// </summary>
+    private static UInt128 ReverseBits(ulong mask, int bits)
+    {
+        UInt128 result = 0;
+        while (mask != 0)
+        {
+            int bit = BitOperations.TrailingZeroCount(mask);
+            result |= UInt128.One << (bits - 1 - bit);
+            mask &= mask - 1;
+        }
+
+        return result;
+    }
+
+    private static bool SetPayload(RepairPacket repair, ReadOnlySpan<byte> payload)
+    {
+        if (repair.Payload.Length < payload.Length)
+        {
+            repair.Payload = new byte[Math.Max(INITIAL_SLOT_SIZE, payload.Length)];
+        }
+
+        payload.CopyTo(repair.Payload);
+        repair.PayloadLength = payload.Length;
+        return true;
+    }
+
+    private int CountMissing(RepairPacket repair, out ushort missingSequenceNumber)
+    {
+        missingSequenceNumber = 0;
+        int missing = 0;
+        var mask = repair.Mask;
+        while (mask != 0)
+        {
+            ushort sequenceNumber = (ushort)(repair.SequenceNumberBase + (int)UInt128.TrailingZeroCount(mask));
+            mask &= mask - 1;
+            if (!IsReceived(sequenceNumber))
+            {
+                missingSequenceNumber = sequenceNumber;
+                if (++missing > 1)
+                {
+                    break;
+                }
+            }
+        }
+
+        return missing;
+    }
+
+    private bool IsReceived(ushort sequenceNumber)
+    {
+        ref var slot = ref _history[sequenceNumber & (HISTORY_SIZE - 1)];
+        return slot.IsOccupied && slot.SequenceNumber == sequenceNumber;
+    }
+
+    /// <summary>
+    /// XORs the repair packet with the received protected packets (RFC 5109 10.4, RFC 8627 6.3.2): the first two
+    /// header bytes, the length after the fixed header, the timestamp and everything after the fixed header.
+    /// </summary>
+    private bool TryRecover(RepairPacket repair, ushort missingSequenceNumber)
+    {
+        int headerLength = RTPHeader.MIN_HEADER_LEN;
+        if (_recoveryBuffer.Length < headerLength + repair.PayloadLength)
+        {
+            _recoveryBuffer = new byte[headerLength + repair.PayloadLength];
+        }
+
+        var recovered = _recoveryBuffer.AsSpan(headerLength, repair.PayloadLength);
+        repair.Payload.AsSpan(0, repair.PayloadLength).CopyTo(recovered);
+
+        byte firstByte = repair.FirstByteRecovery;
+        byte secondByte = repair.SecondByteRecovery;
+        ushort length = repair.LengthRecovery;
+        uint timestamp = repair.TimestampRecovery;
+
+        var mask = repair.Mask;
+        while (mask != 0)
+        {
+            ushort sequenceNumber = (ushort)(repair.SequenceNumberBase + (int)UInt128.TrailingZeroCount(mask));
+            mask &= mask - 1;
+            if (sequenceNumber == missingSequenceNumber)
+            {
+                continue;
+            }
+
+            ref var slot = ref _history[sequenceNumber & (HISTORY_SIZE - 1)];
+            var packet = slot.Data.AsSpan(0, slot.Length);
+            firstByte ^= packet[0];
+            secondByte ^= packet[1];
+            length ^= (ushort)(packet.Length - headerLength);
+            timestamp ^= BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(4));
+
+            var protectedBytes = packet.Slice(headerLength);
+            Xor(recovered.Slice(0, Math.Min(recovered.Length, protectedBytes.Length)), protectedBytes);
+        }
+
+        if (length > repair.PayloadLength)
+        {
+            return false;
+        }
+
+        var packetBuffer = _recoveryBuffer.AsSpan(0, headerLength + length);
+        packetBuffer[0] = (byte)((RTPHeader.RTP_VERSION << 6) | (firstByte & 0x3F));
+        packetBuffer[1] = secondByte;
+        BinaryPrimitives.WriteUInt16BigEndian(packetBuffer.Slice(2), missingSequenceNumber);
+        BinaryPrimitives.WriteUInt32BigEndian(packetBuffer.Slice(4), timestamp);
+        BinaryPrimitives.WriteUInt32BigEndian(packetBuffer.Slice(8), _mediaSsrc);
+
+        // A recovered packet may complete another repair packet.
+        AddMediaPacket(packetBuffer, missingSequenceNumber);
+        RecoveredPackets++;
+        OnPacketRecovered?.Invoke(packetBuffer, missingSequenceNumber, timestamp);
+        return true;
+    }
+
+    private void RemoveRepairPacket(int index)
+    {
+        _freeRepairPackets.Push(_repairPackets[index]);
+        _repairPackets.RemoveAt(index);
+    }
+
+    private static void Xor(Span<byte> data, ReadOnlySpan<byte> other)
+    {
+        int i = 0;
+        if (Vector.IsHardwareAccelerated && data.Length >= Vector<byte>.Count)
+        {
+            var dataVectors = MemoryMarshal.Cast<byte, Vector<byte>>(data);
+            var otherVectors = MemoryMarshal.Cast<byte, Vector<byte>>(other.Slice(0, data.Length));
+            for (int v = 0; v < dataVectors.Length; v++)
+            {
+                dataVectors[v] ^= otherVectors[v];
+            }
+
+            i = dataVectors.Length * Vector<byte>.Count;
+        }
+
+        for (; i < data.Length; i++)
+        {
+            data[i] ^= other[i];
+        }
+    }
+}
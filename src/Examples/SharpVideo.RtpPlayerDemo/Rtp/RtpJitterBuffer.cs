@@ -0,0 +1,320 @@
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+internal delegate void RtpPacketReleasedDelegate(ReadOnlySpan<byte> packet, long receivedTimestampNs);
+
+internal delegate void RtpGapDetectedDelegate(ushort firstMissingSequenceNumber, int count);
+
+/// <summary>
+/// Reorder (jitter) buffer for a single RTP stream.
+/// </summary>
+/// <remarks>
+/// Packets are kept in a power of two ring indexed by extended sequence number and are released strictly in
+/// sequence order. The next expected packet is released immediately, so an in-order stream sees no added latency.
+/// When a sequence number is missing the packets behind it are held until either the hole is filled, the hole has
+/// been open for the gap timeout, or the oldest held packet has waited for the latency budget. Only then is the
+/// hole skipped and reported through <see cref="OnPacketsLost"/>. Packets arriving after their slot has been
+/// released or skipped are counted as late and dropped.
+///
+/// The buffer is not thread safe; it is driven from the RTP receive thread via <see cref="Insert"/> and
+/// <see cref="Poll"/>.
+/// </remarks>
+internal sealed class RtpJitterBuffer
+{
+    /// <summary>
+    /// Default ring size in packets. At 20 Mbit/s with 1400 byte packets this covers about half a second.
+    /// </summary>
+    public const int DEFAULT_CAPACITY = 1024;
+
+    /// <summary>
+    /// Largest forward sequence number jump accepted without probation (RFC 3550 A.1).
+    /// </summary>
+    private const int MAX_DROPOUT = 3000;
+
+    /// <summary>
+    /// Largest backward sequence number jump still treated as a late packet (RFC 3550 A.1).
+    /// </summary>
+    private const int MAX_MISORDER = 100;
+
+    private const int INITIAL_SLOT_SIZE = 2048;
+
+    private struct Slot
+    {
+        public byte[]? Data;
+        public int Length;
+        public long SequenceNumber;
+        public long ReceivedTimestampNs;
+        public bool IsOccupied;
+    }
+
+    private readonly Slot[] _slots;
+    private readonly long _mask;
+    private readonly long _latencyNs;
+    private readonly long _gapTimeoutNs;
+
+    private bool _isInitialized;
+    private long _headSequenceNumber;
+    private long _highestSequenceNumber;
+    private int _heldCount;
+    private long _gapStartedNs;
+    private int _badSequenceNumber = -1;
+
+    /// <param name="capacity">Ring size in packets, must be a power of two.</param>
+    /// <param name="latency">Maximum time a packet is held back waiting for earlier ones.</param>
+    /// <param name="gapTimeout">Maximum time to wait for a single missing sequence number.</param>
+    /// <param name="clockRate">RTP clock rate of the stream, used for the jitter statistics.</param>
+    public RtpJitterBuffer(int capacity, TimeSpan latency, TimeSpan gapTimeout, int clockRate)
+    {
+        if (capacity <= 0 || (capacity & (capacity - 1)) != 0)
+        {
+            throw new ArgumentOutOfRangeException(nameof(capacity), capacity, "Capacity must be a power of two.");
+        }
+
+        _slots = new Slot[capacity];
+        _mask = capacity - 1;
+        _latencyNs = latency.Ticks * 100;
+        _gapTimeoutNs = gapTimeout.Ticks * 100;
+        Statistics = new RtpReceptionStatistics(clockRate);
+    }
+
+    /// <summary>
+    /// Reception statistics of the stream fed into this buffer.
+    /// </summary>
+    public RtpReceptionStatistics Statistics { get; }
+
+    /// <summary>
+    /// Number of packets currently held back.
+    /// </summary>
+    public int Count => _heldCount;
+
+    /// <summary>
+    /// Fires for every packet in sequence order. The span is only valid during the callback.
+    /// </summary>
+    public event RtpPacketReleasedDelegate? OnPacketReleased;
+
+    /// <summary>
+    /// Fires when a run of missing sequence numbers is skipped, right before the packet following it is released.
+    /// The argument is the number of sequence numbers given up on.
+    /// </summary>
+    public event Action<int>? OnPacketsLost;
+
+    /// <summary>
+    /// Fires as soon as a packet arrives ahead of the highest sequence number seen so far, leaving a hole. This is
+    /// the earliest point a retransmission can be requested; the packets are only given up on later.
+    /// </summary>
+    public event RtpGapDetectedDelegate? OnGapDetected;
+
+    /// <summary>
+    /// Adds a received packet and releases everything that became ready.
+    /// </summary>
+    /// <param name="packet">The full RTP packet. Copied if it has to be held back.</param>
+    /// <param name="sequenceNumber">Sequence number from the RTP header.</param>
+    /// <param name="rtpTimestamp">Timestamp from the RTP header.</param>
+    /// <param name="receivedTimestampNs">Arrival time, nanoseconds since the Unix epoch.</param>
+    public void Insert(ReadOnlySpan<byte> packet, ushort sequenceNumber, uint rtpTimestamp, long receivedTimestampNs)
+    {
+        if (!_isInitialized)
+        {
+            Restart(sequenceNumber);
+        }
+
+        long extendedSequenceNumber = _highestSequenceNumber + (short)(sequenceNumber - (ushort)_highestSequenceNumber);
+        long offset = extendedSequenceNumber - _headSequenceNumber;
+
+        if (offset > MAX_DROPOUT || offset < -MAX_MISORDER)
+        {
+            // A large jump is only accepted once the following packet confirms it, otherwise a single stray
+            // packet would throw away the whole window.
+            if (sequenceNumber != _badSequenceNumber)
+            {
+                _badSequenceNumber = (sequenceNumber + 1) & 0xFFFF;
+                return;
+            }
+
+            Flush();
+            Restart(sequenceNumber);
+            Statistics.Resyncs++;
+            extendedSequenceNumber = _headSequenceNumber;
+            offset = 0;
+        }
+
+        _badSequenceNumber = -1;
+
+        if (offset < 0)
+        {
+            Statistics.PacketsLate++;
+            Statistics.OnPacketReceived(extendedSequenceNumber, rtpTimestamp, receivedTimestampNs);
+            return;
+        }
+
+        if (offset >= _slots.Length)
+        {
+            // Too far ahead for the ring, give up on the oldest sequence numbers to make room.
+            AdvanceTo(extendedSequenceNumber - _slots.Length + 1);
+            offset = extendedSequenceNumber - _headSequenceNumber;
+        }
+
+        ref var slot = ref _slots[extendedSequenceNumber & _mask];
+        if (slot.IsOccupied && slot.SequenceNumber == extendedSequenceNumber)
+        {
+            Statistics.PacketsDuplicated++;
+            return;
+        }
+
+        Statistics.OnPacketReceived(extendedSequenceNumber, rtpTimestamp, receivedTimestampNs);
+        if (extendedSequenceNumber > _highestSequenceNumber)
+        {
+            long firstMissing = Math.Max(_highestSequenceNumber + 1, _headSequenceNumber);
+            _highestSequenceNumber = extendedSequenceNumber;
+            if (extendedSequenceNumber > firstMissing)
+            {
+                OnGapDetected?.Invoke((ushort)firstMissing, (int)(extendedSequenceNumber - firstMissing));
+            }
+        }
+        else
+        {
+            Statistics.PacketsReordered++;
+        }
+
+        if (offset == 0 && _heldCount == 0)
+        {
+            // Next expected packet and nothing waiting: hand it over without copying.
+            _headSequenceNumber++;
+            _gapStartedNs = 0;
+            OnPacketReleased?.Invoke(packet, receivedTimestampNs);
+            return;
+        }
+
+        if (slot.Data == null || slot.Data.Length < packet.Length)
+        {
+            slot.Data = new byte[Math.Max(INITIAL_SLOT_SIZE, packet.Length)];
+        }
+
+        packet.CopyTo(slot.Data);
+        slot.Length = packet.Length;
+        slot.SequenceNumber = extendedSequenceNumber;
+        slot.ReceivedTimestampNs = receivedTimestampNs;
+        slot.IsOccupied = true;
+        _heldCount++;
+
+        Release(receivedTimestampNs);
+    }
+
+    /// <summary>
+    /// Re-evaluates the deadlines of held packets. Call periodically when no packets arrive.
+    /// </summary>
+    /// <param name="nowNs">Current time, nanoseconds since the Unix epoch.</param>
+    public void Poll(long nowNs)
+    {
+        if (_heldCount > 0)
+        {
+            Release(nowNs);
+        }
+    }
+
+    /// <summary>
+    /// Releases all held packets in order, skipping any holes.
+    /// </summary>
+    public void Flush()
+    {
+        while (_heldCount > 0)
+        {
+            ref var slot = ref _slots[_headSequenceNumber & _mask];
+            if (slot.IsOccupied && slot.SequenceNumber == _headSequenceNumber)
+            {
+                ReleaseHead(ref slot);
+            }
+            else
+            {
+                Skip((int)(FindNextHeld() - _headSequenceNumber));
+            }
+        }
+    }
+
+    private void Release(long nowNs)
+    {
+        while (_heldCount > 0)
+        {
+            ref var slot = ref _slots[_headSequenceNumber & _mask];
+            if (slot.IsOccupied && slot.SequenceNumber == _headSequenceNumber)
+            {
+                ReleaseHead(ref slot);
+                continue;
+            }
+
+            if (_gapStartedNs == 0)
+            {
+                _gapStartedNs = nowNs;
+            }
+
+            long next = FindNextHeld();
+            long oldestReceivedNs = _slots[next & _mask].ReceivedTimestampNs;
+            if (nowNs - _gapStartedNs < _gapTimeoutNs && nowNs - oldestReceivedNs < _latencyNs)
+            {
+                break;
+            }
+
+            Skip((int)(next - _headSequenceNumber));
+        }
+    }
+
+    private void AdvanceTo(long sequenceNumber)
+    {
+        while (_headSequenceNumber < sequenceNumber)
+        {
+            ref var slot = ref _slots[_headSequenceNumber & _mask];
+            if (slot.IsOccupied && slot.SequenceNumber == _headSequenceNumber)
+            {
+                ReleaseHead(ref slot);
+                continue;
+            }
+
+            long next = _heldCount > 0 ? Math.Min(FindNextHeld(), sequenceNumber) : sequenceNumber;
+            Skip((int)(next - _headSequenceNumber));
+        }
+    }
+
+    private void ReleaseHead(ref Slot slot)
+    {
+        slot.IsOccupied = false;
+        _heldCount--;
+        _headSequenceNumber++;
+        _gapStartedNs = 0;
+        OnPacketReleased?.Invoke(new ReadOnlySpan<byte>(slot.Data, 0, slot.Length), slot.ReceivedTimestampNs);
+    }
+
+    private void Skip(int count)
+    {
+        _headSequenceNumber += count;
+        _gapStartedNs = 0;
+        Statistics.PacketsSkipped += count;
+        OnPacketsLost?.Invoke(count);
+    }
+
+    private long FindNextHeld()
+    {
+        for (long sequenceNumber = _headSequenceNumber + 1; sequenceNumber <= _highestSequenceNumber; sequenceNumber++)
+        {
+            ref var slot = ref _slots[sequenceNumber & _mask];
+            if (slot.IsOccupied && slot.SequenceNumber == sequenceNumber)
+            {
+                return sequenceNumber;
+            }
+        }
+
+        throw new InvalidOperationException("Jitter buffer bookkeeping is inconsistent: no held packet found.");
+    }
+
+    private void Restart(ushort sequenceNumber)
+    {
+        // Keep extended sequence numbers monotonic across restarts by moving to the next cycle.
+        long extendedSequenceNumber = _isInitialized
+            ? (((_highestSequenceNumber >> 16) + 1) << 16) + sequenceNumber
+            : sequenceNumber;
+
+        _headSequenceNumber = extendedSequenceNumber;
+        _highestSequenceNumber = extendedSequenceNumber - 1;
+        _gapStartedNs = 0;
+        _isInitialized = true;
+        Statistics.Resync(extendedSequenceNumber);
+    }
+}
@@ -0,0 +1,98 @@
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// A batch of outgoing RTP packets in one pinned slab, filled by a packetiser and sent by <see cref="UdpSender"/>.
+/// </summary>
+/// <remarks>
+/// Every packet owns a fixed size slot, so packets are written in place and the slab can be handed to sendmmsg
+/// without copying. The slab grows when a large frame needs more slots; it is kept for the following frames.
+/// </remarks>
+internal sealed class RtpPacketBatch
+{
+    private byte[] _slab;
+    private int[] _lengths;
+    private int _count;
+    private int _openSlot = -1;
+
+    /// <param name="maxPacketSize">Largest packet the batch has to hold.</param>
+    /// <param name="initialCapacity">Number of packet slots allocated up front.</param>
+    public RtpPacketBatch(int maxPacketSize, int initialCapacity = 64)
+    {
+        MaxPacketSize = maxPacketSize;
+        SlotSize = (maxPacketSize + 63) & ~63;
+        _slab = GC.AllocateUninitializedArray<byte>(SlotSize * initialCapacity, pinned: true);
+        _lengths = new int[initialCapacity];
+    }
+
+    public int MaxPacketSize { get; }
+
+    /// <summary>
+    /// Distance between two packets in the slab.
+    /// </summary>
+    public int SlotSize { get; }
+
+    /// <summary>
+    /// Number of complete packets.
+    /// </summary>
+    public int Count => _count;
+
+    /// <summary>
+    /// The pinned slab, packet i starts at i * <see cref="SlotSize"/>.
+    /// </summary>
+    internal byte[] Slab => _slab;
+
+    public int GetLength(int index) => _lengths[index];
+
+    public ReadOnlySpan<byte> GetPacket(int index) => _slab.AsSpan(index * SlotSize, _lengths[index]);
+
+    /// <summary>
+    /// Returns the slot of the next packet, <see cref="EndPacket"/> commits it. Until then every call returns the same
+    /// slot with its content, so a packet can be extended in several steps.
+    /// </summary>
+    public Span<byte> BeginPacket()
+    {
+        if (_count == _lengths.Length)
+        {
+            Grow();
+        }
+
+        _openSlot = _count;
+        return _slab.AsSpan(_count * SlotSize, MaxPacketSize);
+    }
+
+    /// <summary>
+    /// Commits the packet started by <see cref="BeginPacket"/>.
+    /// </summary>
+    /// <param name="length">Number of bytes written to the slot.</param>
+    public void EndPacket(int length)
+    {
+        if (_openSlot < 0 || length <= 0 || length > MaxPacketSize)
+        {
+            throw new InvalidOperationException($"Invalid RTP packet length {length}.");
+        }
+
+        _lengths[_openSlot] = length;
+        _openSlot = -1;
+        _count++;
+    }
+
+    /// <summary>
+    /// Gives write access to a committed packet, e.g. to set the marker bit of the last packet of a frame.
+    /// </summary>
+    public Span<byte> GetWritablePacket(int index) => _slab.AsSpan(index * SlotSize, _lengths[index]);
+
+    public void Clear()
+    {
+        _count = 0;
+        _openSlot = -1;
+    }
+
+    private void Grow()
+    {
+        int capacity = _lengths.Length * 2;
+        var slab = GC.AllocateUninitializedArray<byte>(SlotSize * capacity, pinned: true);
+        _slab.AsSpan(0, _count * SlotSize).CopyTo(slab);
+        _slab = slab;
+        Array.Resize(ref _lengths, capacity);
+    }
+}
@@ -0,0 +1,114 @@
+using System.Net;
+using System.Runtime.Versioning;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// One RTP media stream demultiplexed by <see cref="Receiver"/>, identified by the local port it arrives on and its
+/// SSRC. Every stream has its own jitter buffer, depacketiser, statistics and RTCP feedback.
+/// </summary>
+[SupportedOSPlatform("linux")]
+public sealed class RtpReceiveStream
+{
+    internal RtpReceiveStream(int index, int localPort, uint ssrc, RTPChannel channel, VideoStream videoStream, RtcpSession? rtcpSession)
+    {
+        Index = index;
+        LocalPort = localPort;
+        Ssrc = ssrc;
+        Channel = channel;
+        VideoStream = videoStream;
+        RtcpSession = rtcpSession;
+    }
+
+    /// <summary>
+    /// Process wide unique index of the stream.
+    /// </summary>
+    public int Index { get; }
+
+    /// <summary>
+    /// Local RTP port the stream is received on.
+    /// </summary>
+    public int LocalPort { get; }
+
+    /// <summary>
+    /// Synchronisation source of the stream.
+    /// </summary>
+    public uint Ssrc { get; }
+
+    /// <summary>
+    /// End point the most recent packet came from.
+    /// </summary>
+    public IPEndPoint? RemoteEndPoint { get; internal set; }
+
+    /// <summary>
+    /// Packet loss, reordering and jitter of the stream.
+    /// </summary>
+    public RtpReceptionStatistics ReceptionStatistics => VideoStream.ReceptionStatistics;
+
+    /// <summary>
+    /// Number of frames passed on with some of their packets missing.
+    /// </summary>
+    public int DamagedFrames => VideoStream.DamagedFrames;
+
+    /// <summary>
+    /// Number of retransmitted packets received through RTX.
+    /// </summary>
+    public int RetransmittedPackets => VideoStream.RetransmittedPackets;
+
+    /// <summary>
+    /// Number of lost packets recovered from FEC repair packets.
+    /// </summary>
+    public int FecRecoveredPackets => VideoStream.FecRecoveredPackets;
+
+    /// <summary>
+    /// Number of FEC repair packets received.
+    /// </summary>
+    public int FecRepairPackets => VideoStream.FecRepairPackets;
+
+    /// <summary>
+    /// Number of generic NACK packets sent for this stream.
+    /// </summary>
+    public int NacksSent => RtcpSession?.NacksSent ?? 0;
+
+    /// <summary>
+    /// Number of PLI/FIR packets sent for this stream.
+    /// </summary>
+    public int KeyFrameRequestsSent => RtcpSession?.KeyFrameRequestsSent ?? 0;
+
+    /// <summary>
+    /// True once the stream timed out and was removed from the receiver. No further frames are delivered.
+    /// </summary>
+    public bool IsRemoved => _isRemoved;
+
+    internal RTPChannel Channel { get; }
+
+    internal VideoStream VideoStream { get; }
+
+    internal RtcpSession? RtcpSession { get; }
+
+    /// <summary>
+    /// <see cref="Environment.TickCount64"/> of the last packet received.
+    /// </summary>
+    internal long LastPacketTicks;
+
+    private volatile bool _isRemoved;
+
+    /// <summary>
+    /// Asks the sender of this stream for a key frame. Does nothing if RTCP is disabled.
+    /// </summary>
+    public void RequestKeyFrame()
+    {
+        RtcpSession?.RequestKeyFrame();
+    }
+
+    internal void MarkRemoved()
+    {
+        _isRemoved = true;
+        RtcpSession?.Dispose();
+    }
+
+    public override string ToString()
+    {
+        return $"#{Index} SSRC {Ssrc} on port {LocalPort} from {RemoteEndPoint}";
+    }
+}
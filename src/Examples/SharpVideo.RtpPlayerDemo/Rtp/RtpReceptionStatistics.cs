@@ -0,0 +1,185 @@
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Per-stream reception statistics as defined in RFC 3550 (sections 6.4.1 and A.3, A.8).
+/// </summary>
+/// <remarks>
+/// Updated from the RTP receive thread only. Readers on other threads may observe values from different packets
+/// but every individual field is read atomically.
+/// </remarks>
+public sealed class RtpReceptionStatistics
+{
+    private readonly double _clockTicksPerNanosecond;
+
+    private bool _hasTransit;
+    private uint _lastTransit;
+    private double _jitter;
+
+    private long _expectedPrior;
+    private long _receivedPrior;
+
+    // Packets of the current sequence number space, and the packets expected in the spaces before a resync.
+    private long _spaceReceived;
+    private long _expectedBeforeResync;
+
+    public RtpReceptionStatistics(int clockRate)
+    {
+        ClockRate = clockRate;
+        _clockTicksPerNanosecond = clockRate / 1_000_000_000.0;
+    }
+
+    /// <summary>
+    /// RTP clock rate of the stream the interarrival jitter is measured in.
+    /// </summary>
+    public int ClockRate { get; }
+
+    /// <summary>
+    /// Synchronisation source the statistics belong to.
+    /// </summary>
+    public uint Ssrc { get; internal set; }
+
+    /// <summary>
+    /// Extended sequence number of the first packet received in the current sequence number space.
+    /// </summary>
+    public long BaseSequenceNumber { get; private set; }
+
+    /// <summary>
+    /// Extended highest sequence number received (cycles in the upper bits).
+    /// </summary>
+    public long HighestSequenceNumber { get; private set; }
+
+    /// <summary>
+    /// Number of packets received, including late ones but excluding duplicates. Cumulative across resyncs.
+    /// </summary>
+    public long PacketsReceived { get; private set; }
+
+    /// <summary>
+    /// Number of packets that arrived with a lower sequence number than an earlier packet.
+    /// </summary>
+    public long PacketsReordered { get; internal set; }
+
+    /// <summary>
+    /// Number of packets that arrived after their slot had already been released or skipped by the jitter buffer.
+    /// </summary>
+    public long PacketsLate { get; internal set; }
+
+    /// <summary>
+    /// Number of packets that were received more than once.
+    /// </summary>
+    public long PacketsDuplicated { get; internal set; }
+
+    /// <summary>
+    /// Number of sequence numbers the jitter buffer gave up waiting for.
+    /// </summary>
+    public long PacketsSkipped { get; internal set; }
+
+    /// <summary>
+    /// Number of times the sequence number space was restarted because of a large jump.
+    /// </summary>
+    public long Resyncs { get; internal set; }
+
+    /// <summary>
+    /// Number of packets expected from the sequence number ranges seen so far, cumulative across resyncs.
+    /// </summary>
+    public long PacketsExpected => _expectedBeforeResync +
+                                   (_spaceReceived == 0 ? 0 : HighestSequenceNumber - BaseSequenceNumber + 1);
+
+    /// <summary>
+    /// Cumulative number of packets lost (expected minus received). May be negative if duplicates slipped through.
+    /// </summary>
+    public long PacketsLost => PacketsExpected - PacketsReceived;
+
+    /// <summary>
+    /// Interarrival jitter estimate in RTP timestamp units.
+    /// </summary>
+    public double Jitter => _jitter;
+
+    /// <summary>
+    /// Interarrival jitter estimate converted to wall clock time.
+    /// </summary>
+    public TimeSpan JitterTime => TimeSpan.FromSeconds(_jitter / ClockRate);
+
+    /// <summary>
+    /// Starts a new sequence number space, for example after a source restart. The cumulative counters reported in
+    /// RTCP receiver reports carry on, the range of the previous space stays counted as expected.
+    /// </summary>
+    internal void Resync(long extendedSequenceNumber)
+    {
+        if (_spaceReceived > 0)
+        {
+            _expectedBeforeResync += HighestSequenceNumber - BaseSequenceNumber + 1;
+        }
+
+        BaseSequenceNumber = extendedSequenceNumber;
+        HighestSequenceNumber = extendedSequenceNumber - 1;
+        _spaceReceived = 0;
+        _hasTransit = false;
+    }
+
+    /// <summary>
+    /// Accounts a packet that was not a duplicate and updates the interarrival jitter.
+    /// </summary>
+    /// <param name="extendedSequenceNumber">Extended sequence number of the packet.</param>
+    /// <param name="rtpTimestamp">RTP timestamp from the packet header.</param>
+    /// <param name="receivedTimestampNs">Arrival time, nanoseconds since the Unix epoch.</param>
+    internal void OnPacketReceived(long extendedSequenceNumber, uint rtpTimestamp, long receivedTimestampNs)
+    {
+        if (_spaceReceived == 0)
+        {
+            BaseSequenceNumber = extendedSequenceNumber;
+            HighestSequenceNumber = extendedSequenceNumber;
+        }
+        else if (extendedSequenceNumber > HighestSequenceNumber)
+        {
+            HighestSequenceNumber = extendedSequenceNumber;
+        }
+        else if (extendedSequenceNumber < BaseSequenceNumber)
+        {
+            BaseSequenceNumber = extendedSequenceNumber;
+        }
+
+        PacketsReceived++;
+        _spaceReceived++;
+
+        // RFC 3550 A.8: D(i,j) = (Rj - Ri) - (Sj - Si), J += (|D| - J) / 16. The arithmetic is done modulo 2^32
+        // in timestamp units, so wrap-around of either clock is harmless.
+        uint arrival = unchecked((uint)(long)(receivedTimestampNs * _clockTicksPerNanosecond));
+        uint transit = unchecked(arrival - rtpTimestamp);
+        if (_hasTransit)
+        {
+            int d = Math.Abs(unchecked((int)(transit - _lastTransit)));
+            _jitter += (d - _jitter) / 16.0;
+        }
+
+        _lastTransit = transit;
+        _hasTransit = true;
+    }
+
+    /// <summary>
+    /// Returns the fraction of packets lost since the previous call as the 8-bit fixed point value used in RTCP
+    /// receiver reports (RFC 3550 A.3).
+    /// </summary>
+    public byte GetFractionLostSinceLastCall()
+    {
+        long expected = PacketsExpected;
+        long expectedInterval = expected - _expectedPrior;
+        long receivedInterval = PacketsReceived - _receivedPrior;
+
+        _expectedPrior = expected;
+        _receivedPrior = PacketsReceived;
+
+        long lostInterval = expectedInterval - receivedInterval;
+        if (expectedInterval == 0 || lostInterval <= 0)
+        {
+            return 0;
+        }
+
+        return (byte)Math.Min(255, (lostInterval << 8) / expectedInterval);
+    }
+
+    public override string ToString()
+    {
+        return $"received={PacketsReceived}, lost={PacketsLost}, reordered={PacketsReordered}, late={PacketsLate}, " +
+               $"duplicated={PacketsDuplicated}, skipped={PacketsSkipped}, jitter={JitterTime.TotalMilliseconds:F2}ms";
+    }
+}
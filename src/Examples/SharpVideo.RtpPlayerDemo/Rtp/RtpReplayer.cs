@@ -0,0 +1,209 @@
+using System.Diagnostics;
+using System.Net;
+using System.Net.Sockets;
+using Microsoft.Extensions.Logging;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Receives a replayed datagram, see <see cref="Receiver.InjectPacket"/>.
+/// </summary>
+/// <param name="localPort">Local port the datagram is delivered to.</param>
+/// <param name="remoteEndPoint">Original sender of the datagram.</param>
+/// <param name="packet">The UDP payload.</param>
+/// <param name="receivedTimestampNs">Arrival time, nanoseconds since the Unix epoch.</param>
+public delegate void RtpReplaySink(int localPort, IPEndPoint remoteEndPoint, ReadOnlySpan<byte> packet, long receivedTimestampNs);
+
+/// <summary>
+/// Replay settings of <see cref="RtpReplayer"/>.
+/// </summary>
+public sealed class RtpReplayOptions
+{
+    /// <summary>
+    /// Playback rate relative to the captured timing, 2 replays twice as fast. 0 sends as fast as possible.
+    /// </summary>
+    public double Speed { get; set; } = 1.0;
+
+    /// <summary>
+    /// Probability of dropping an RTP packet, 0 to 1.
+    /// </summary>
+    public double LossProbability { get; set; }
+
+    /// <summary>
+    /// Probability of delaying an RTP packet behind the following <see cref="ReorderDepth"/> packets, 0 to 1.
+    /// </summary>
+    public double ReorderProbability { get; set; }
+
+    /// <summary>
+    /// Number of packets a reordered packet is sent after.
+    /// </summary>
+    public int ReorderDepth { get; set; } = 3;
+
+    /// <summary>
+    /// Seed of the loss and reorder decisions, the same seed gives the same impairments for the same capture.
+    /// </summary>
+    public int Seed { get; set; } = 1;
+
+    /// <summary>
+    /// Local port the RTP port of the first captured packet is mapped to, other ports keep their distance to it so
+    /// the RTCP and additional stream ports follow. 0 keeps the captured ports.
+    /// </summary>
+    public int TargetBasePort { get; set; }
+}
+
+/// <summary>
+/// Result of a replay.
+/// </summary>
+public sealed record RtpReplayResult(int PacketsSent, int PacketsDropped, int PacketsReordered, TimeSpan Duration);
+
+/// <summary>
+/// Plays a capture back with its original timing, scaled, or as fast as possible, optionally dropping and
+/// reordering RTP packets. Used to reproduce field recordings and to benchmark the receive path repeatably.
+/// </summary>
+/// <remarks>
+/// The packets are either sent to a UDP socket, typically the receiver on loopback, or handed straight to a sink
+/// such as <see cref="Receiver.InjectPacket"/>. With a sink the arrival timestamps are derived from the capture
+/// instead of the clock, and the receiver also polls its jitter buffers on those timestamps, so the jitter buffer
+/// decisions and statistics do not depend on scheduling. Impairments
+/// only apply to RTP; RTCP packets are always delivered in order.
+/// </remarks>
+public sealed class RtpReplayer
+{
+    private readonly string _path;
+    private readonly RtpReplayOptions _options;
+    private readonly ILogger _logger;
+
+    public RtpReplayer(string path, RtpReplayOptions options, ILogger logger)
+    {
+        if (options.Speed < 0)
+        {
+            throw new ArgumentOutOfRangeException(nameof(options), "The replay speed must not be negative.");
+        }
+
+        _path = path;
+        _options = options;
+        _logger = logger;
+    }
+
+    /// <summary>
+    /// Sends the capture to <paramref name="destination"/> from an ephemeral port. Captured destination ports are
+    /// mapped relative to the destination port.
+    /// </summary>
+    public RtpReplayResult ReplayToSocket(IPEndPoint destination, CancellationToken cancellationToken)
+    {
+        using var socket = new Socket(destination.AddressFamily, SocketType.Dgram, ProtocolType.Udp);
+        socket.SendBufferSize = 4 * 1024 * 1024;
+        socket.Bind(new IPEndPoint(destination.AddressFamily == AddressFamily.InterNetworkV6 ? IPAddress.IPv6Any : IPAddress.Any, 0));
+
+        var target = new IPEndPoint(destination.Address, destination.Port);
+        int basePort = _options.TargetBasePort != 0 ? _options.TargetBasePort : destination.Port;
+        return Replay(basePort, (localPort, _, packet, _) =>
+        {
+            target.Port = localPort;
+            socket.SendTo(packet, SocketFlags.None, target);
+        }, useClockTimestamps: true, cancellationToken);
+    }
+
+    /// <summary>
+    /// Hands the capture to <paramref name="sink"/> on the calling thread.
+    /// </summary>
+    public RtpReplayResult Replay(RtpReplaySink sink, CancellationToken cancellationToken)
+    {
+        return Replay(_options.TargetBasePort, sink, useClockTimestamps: false, cancellationToken);
+    }
+
+    private RtpReplayResult Replay(int targetBasePort, RtpReplaySink sink, bool useClockTimestamps, CancellationToken cancellationToken)
+    {
+        using var reader = new RtpCaptureReader(_path);
+        var random = new Random(_options.Seed);
+        var delayed = new List<(RtpCapturedPacket Packet, int ReleaseAfter)>();
+        int portOffset = int.MinValue;
+        int sent = 0;
+        int dropped = 0;
+        int reordered = 0;
+        int rtpIndex = 0;
+        long firstCaptureNs = -1;
+        long arrivalOffsetNs = 0;
+        long startNs = (DateTime.UtcNow - DateTime.UnixEpoch).Ticks * 100;
+        var stopwatch = Stopwatch.StartNew();
+
+        void Send(RtpCapturedPacket packet, long offsetNs)
+        {
+            long timestampNs = useClockTimestamps ? 0 : startNs + offsetNs;
+            sink(packet.DestinationPort + portOffset, packet.Source, packet.Payload, timestampNs);
+            sent++;
+        }
+
+        while (!cancellationToken.IsCancellationRequested && reader.TryReadNext(out var packet))
+        {
+            bool isRtcp = RtcpPacketWriter.IsRtcp(packet.Payload);
+            if (firstCaptureNs < 0)
+            {
+                firstCaptureNs = packet.TimestampNs;
+            }
+
+            if (portOffset == int.MinValue)
+            {
+                // The RTCP port is the RTP port + 1 if the capture happens to start with a report.
+                int capturedBasePort = isRtcp ? packet.DestinationPort - 1 : packet.DestinationPort;
+                portOffset = targetBasePort != 0 ? targetBasePort - capturedBasePort : 0;
+            }
+
+            long captureOffsetNs = packet.TimestampNs - firstCaptureNs;
+            if (_options.Speed > 0)
+            {
+                arrivalOffsetNs = (long)(captureOffsetNs / _options.Speed);
+                PreciseWait.Until(stopwatch, arrivalOffsetNs, cancellationToken);
+            }
+            else
+            {
+                // As fast as possible: the sink still sees the captured spacing, so its timeouts behave as recorded.
+                arrivalOffsetNs = captureOffsetNs;
+            }
+
+            if (isRtcp || packet.Payload.Length < RTPHeader.MIN_HEADER_LEN)
+            {
+                Send(packet, arrivalOffsetNs);
+                continue;
+            }
+
+            rtpIndex++;
+            if (_options.LossProbability > 0 && random.NextDouble() < _options.LossProbability)
+            {
+                dropped++;
+            }
+            else if (_options.ReorderProbability > 0 && random.NextDouble() < _options.ReorderProbability)
+            {
+                delayed.Add((packet, rtpIndex + _options.ReorderDepth));
+                reordered++;
+            }
+            else
+            {
+                Send(packet, arrivalOffsetNs);
+            }
+
+            for (int i = 0; i < delayed.Count; i++)
+            {
+                if (delayed[i].ReleaseAfter <= rtpIndex)
+                {
+                    Send(delayed[i].Packet, arrivalOffsetNs);
+                    delayed.RemoveAt(i--);
+                }
+            }
+        }
+
+        foreach (var (packet, _) in delayed)
+        {
+            Send(packet, arrivalOffsetNs);
+        }
+
+        if (reader.SkippedRecords > 0)
+        {
+            _logger.LogWarning($"Skipped {reader.SkippedRecords} records of {_path} that are not complete UDP datagrams.");
+        }
+
+        var result = new RtpReplayResult(sent, dropped, reordered, stopwatch.Elapsed);
+        _logger.LogInformation($"Replayed {_path}: {result.PacketsSent} packets sent, {result.PacketsDropped} dropped, {result.PacketsReordered} reordered in {result.Duration.TotalSeconds:F2} s.");
+        return result;
+    }
+}
@@ -1,4 +1,5 @@
 using System.Net;
+using SharpVideo.Srtp;
 
 namespace SharpVideo.RtpPlayerDemo.Rtp;
 
@@ -25,4 +26,113 @@ internal sealed class RtpSessionConfig
     /// System select the port number.
     /// </summary>
     public int BindPort { get; set; }
+
+    /// <summary>
+    /// Optional. If true UDP generic receive offload is requested on the RTP socket. At high bitrates this lets the
+    /// kernel deliver a burst of datagrams as one buffer which is split again in user space.
+    /// </summary>
+    public bool EnableUdpGro { get; set; }
+
+    /// <summary>
+    /// Maximum time a received packet is held back by the jitter buffer while earlier packets are missing.
+    /// Packets arriving in order are never delayed.
+    /// </summary>
+    public TimeSpan JitterBufferLatency { get; set; } = TimeSpan.FromMilliseconds(50);
+
+    /// <summary>
+    /// Maximum time the jitter buffer waits for a single missing packet before skipping it.
+    /// </summary>
+    public TimeSpan JitterBufferGapTimeout { get; set; } = TimeSpan.FromMilliseconds(20);
+
+    /// <summary>
+    /// Size of the jitter buffer ring in packets. Must be a power of two.
+    /// </summary>
+    public int JitterBufferCapacity { get; set; } = RtpJitterBuffer.DEFAULT_CAPACITY;
+
+    /// <summary>
+    /// Codecs of RTP payload types, e.g. from SDP rtpmap attributes.
+    /// </summary>
+    public Dictionary<int, VideoCodecsEnum> PayloadTypeCodecs { get; } = new();
+
+    /// <summary>
+    /// Codec assumed for dynamic payload types (96-127) that have no entry in <see cref="PayloadTypeCodecs"/>.
+    /// </summary>
+    public VideoCodecsEnum DefaultVideoCodec { get; set; } = VideoCodecsEnum.H264;
+
+    /// <summary>
+    /// Maximum number of concurrently received streams (SSRC and port combinations). Packets of further streams
+    /// are dropped.
+    /// </summary>
+    public int MaxStreams { get; set; } = 64;
+
+    /// <summary>
+    /// A stream is removed when no packet arrived for this long.
+    /// </summary>
+    public TimeSpan StreamTimeout { get; set; } = TimeSpan.FromSeconds(10);
+
+    /// <summary>
+    /// If true RTCP receiver reports and feedback are sent on a control socket bound to the RTP port + 1.
+    /// </summary>
+    public bool EnableRtcp { get; set; } = true;
+
+    /// <summary>
+    /// Optional. Where RTCP packets are sent. If not set they go to the address the sender's RTCP came from, or
+    /// to the RTP source port + 1 until the first sender report arrives.
+    /// </summary>
+    public IPEndPoint? RtcpRemoteEndPoint { get; set; }
+
+    /// <summary>
+    /// Interval between periodic receiver reports.
+    /// </summary>
+    public TimeSpan RtcpReportInterval { get; set; } = TimeSpan.FromSeconds(1);
+
+    /// <summary>
+    /// If true a generic NACK is sent as soon as the jitter buffer sees a sequence gap. For retransmissions to be
+    /// useful <see cref="JitterBufferGapTimeout"/> has to exceed the round trip time to the sender.
+    /// </summary>
+    public bool EnableNack { get; set; } = true;
+
+    /// <summary>
+    /// Optional. Payload type of RFC 4588 retransmission packets. Retransmitted packets are unwrapped and fed into
+    /// the jitter buffer as the original packets. 0 disables RTX handling (plain retransmissions still work).
+    /// </summary>
+    public int RtxPayloadType { get; set; }
+
+    /// <summary>
+    /// Optional. Payload type of ULPFEC (RFC 5109) repair packets. Lost media packets are recovered from them before
+    /// depacketisation, <see cref="JitterBufferLatency"/> has to cover the span of a FEC block. 0 disables ULPFEC.
+    /// </summary>
+    public int UlpfecPayloadType { get; set; }
+
+    /// <summary>
+    /// Optional. Payload type of FlexFEC (RFC 8627) repair packets, see <see cref="UlpfecPayloadType"/>. 0 disables
+    /// FlexFEC.
+    /// </summary>
+    public int FlexfecPayloadType { get; set; }
+
+    /// <summary>
+    /// If true a key frame is requested whenever the jitter buffer gives up on packets, in addition to the
+    /// requests raised by the decoder on reference loss.
+    /// </summary>
+    public bool RequestKeyFrameOnLoss { get; set; } = true;
+
+    /// <summary>
+    /// If true key frames are requested with FIR (RFC 5104) instead of PLI (RFC 4585).
+    /// </summary>
+    public bool UseFullIntraRequest { get; set; }
+
+    /// <summary>
+    /// Minimum spacing of key frame requests. An unanswered request is repeated at this interval.
+    /// </summary>
+    public TimeSpan KeyFrameRequestInterval { get; set; } = TimeSpan.FromMilliseconds(500);
+
+    /// <summary>
+    /// Optional. If set all received RTP and RTCP must be SRTP protected with these keys.
+    /// </summary>
+    public SrtpPolicy? SrtpReceivePolicy { get; set; }
+
+    /// <summary>
+    /// Optional. Keys the RTCP we send is protected with. Required if <see cref="SrtpReceivePolicy"/> is set.
+    /// </summary>
+    public SrtpPolicy? SrtpSendPolicy { get; set; }
 }
@@ -0,0 +1,50 @@
+using System.Net;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Socket level settings of a <see cref="Receiver"/>.
+/// </summary>
+public sealed class RtpSocketOptions
+{
+    /// <summary>
+    /// If true UDP generic receive offload is requested on the RTP sockets.
+    /// </summary>
+    public bool EnableUdpGro { get; set; }
+
+    /// <summary>
+    /// If true the receive threads use a multishot io_uring recvmsg instead of recvmmsg and poll, falling back to
+    /// recvmmsg if the kernel does not support it.
+    /// </summary>
+    public bool EnableIoUring { get; set; }
+
+    /// <summary>
+    /// Number of sockets, each with its own receive thread, bound to every local end point with SO_REUSEPORT. The
+    /// kernel assigns every sender (by a hash of its address and port) to one of them, so when many streams share a
+    /// port their processing is spread over several cores. Every stream stays on one thread.
+    /// </summary>
+    public int ReceiveThreads { get; set; } = 1;
+
+    /// <summary>
+    /// Optional. CPUs the receive threads are pinned to, thread i runs on CPU i modulo the count. Empty leaves the
+    /// placement to the scheduler.
+    /// </summary>
+    public IReadOnlyList<int> ReceiveCpus { get; set; } = Array.Empty<int>();
+
+    /// <summary>
+    /// Optional. Multicast groups to receive, joined on every local end point. With several receive threads the
+    /// groups are spread over their sockets.
+    /// </summary>
+    public IReadOnlyList<IPAddress> MulticastGroups { get; set; } = Array.Empty<IPAddress>();
+
+    /// <summary>
+    /// Optional. If set the groups are joined source specific (IGMPv3 / MLDv2) and only this sender is received.
+    /// </summary>
+    public IPAddress? MulticastSource { get; set; }
+
+    /// <summary>
+    /// Optional. Name (e.g. eth0) or address of the interface the groups are joined on. If not set the kernel picks
+    /// the interface by route.
+    /// </summary>
+    public string? MulticastInterface { get; set; }
+}
@@ -35,7 +35,7 @@ internal class RtpVP8Header
     public RtpVP8Header()
     { }
 
-    public static RtpVP8Header GetVP8Header(byte[] rtpPayload)
+    public static RtpVP8Header GetVP8Header(ReadOnlySpan<byte> rtpPayload)
     {
         RtpVP8Header vp8Header = new RtpVP8Header();
         int payloadHeaderStartIndex = 1;
@@ -61,7 +61,7 @@ internal class RtpVP8Header
                 // The Picture ID is using two bytes.
                 vp8Header._length = 4;
                 payloadHeaderStartIndex = 4;
-                vp8Header.PictureID = BitConverter.ToUInt16(rtpPayload, 2);
+                vp8Header.PictureID = BitConverter.ToUInt16(rtpPayload.Slice(2));
             }
             else
             {
@@ -9,8 +9,8 @@ internal class RtpVideoFramer
 
     private readonly VideoCodecsEnum _codec;
     private readonly int _maxFrameSize;
-    private readonly byte[] _currentVideoFrame;
-    private int _currVideoFramePosn = 0;
+    private EncodedFrame? _currentVideoFrame;
+    private int _lastVideoFrameSize;
     private H264Depacketiser? _h264Depacketiser;
 
     public RtpVideoFramer(VideoCodecsEnum codec, int maxFrameSize)
@@ -22,7 +22,6 @@ internal class RtpVideoFramer
 
         _codec = codec;
         _maxFrameSize = maxFrameSize;
-        _currentVideoFrame = new byte[maxFrameSize];
 
         if (_codec == VideoCodecsEnum.H264)
         {
@@ -30,39 +29,63 @@ internal class RtpVideoFramer
         }
     }
 
-    public byte[]? GotRtpPacket(RTPPacket rtpPacket)
+    /// <summary>
+    /// Fires when a complete encoded frame was reconstructed. The handler takes ownership of the frame and must
+    /// dispose it once consumed.
+    /// </summary>
+    public event Action<EncodedFrame>? OnFrameReady;
+
+    /// <summary>
+    /// Number of frames emitted with some of their packets missing (H264 only).
+    /// </summary>
+    public int DamagedFrames => _h264Depacketiser?.DamagedFrames ?? 0;
+
+    /// <summary>
+    /// Processes the next packet of the stream. Packets must arrive in sequence number order.
+    /// </summary>
+    /// <param name="hdr">The parsed RTP header.</param>
+    /// <param name="payload">The RTP payload, a slice of the received datagram. Only valid during the call.</param>
+    public void GotRtpPacket(RTPHeader hdr, ReadOnlySpan<byte> payload)
     {
-        var payload = rtpPacket.Payload;
-
-        var hdr = rtpPacket.Header;
+        if (payload.Length == 0)
+        {
+            return;
+        }
 
         if (_codec == VideoCodecsEnum.VP8)
         {
             //logger.LogDebug($"rtp VP8 video, seqnum {hdr.SequenceNumber}, ts {hdr.Timestamp}, marker {hdr.MarkerBit}, payload {payload.Length}.");
 
-            if (_currVideoFramePosn + payload.Length >= _maxFrameSize)
+            if (_currentVideoFrame != null && _currentVideoFrame.Length + payload.Length >= _maxFrameSize)
             {
                 // Something has gone very wrong. Clear the buffer.
-                _currVideoFramePosn = 0;
+                DiscardVideoFrame();
             }
 
             // New frames must have the VP8 Payload Descriptor Start bit set.
             // The tracking of the current video frame position is to deal with a VP8 frame being split across multiple RTP packets
             // as per https://tools.ietf.org/html/rfc7741#section-4.4.
-            if (_currVideoFramePosn > 0 || (payload[0] & 0x10) > 0)
+            if (_currentVideoFrame != null || (payload[0] & 0x10) > 0)
             {
                 RtpVP8Header vp8Header = RtpVP8Header.GetVP8Header(payload);
 
-                Buffer.BlockCopy(payload, vp8Header.Length, _currentVideoFrame, _currVideoFramePosn, payload.Length - vp8Header.Length);
-                _currVideoFramePosn += payload.Length - vp8Header.Length;
-
-                if (rtpPacket.Header.MarkerBit > 0)
+                if (_currentVideoFrame == null)
                 {
-                    var frame = _currentVideoFrame.Take(_currVideoFramePosn).ToArray();
+                    _currentVideoFrame = EncodedFrame.Rent(_lastVideoFrameSize);
+                    // Inverse key frame flag, bit 0 of the VP8 frame tag (RFC 6386 9.1).
+                    _currentVideoFrame.IsKeyFrame = payload.Length > vp8Header.Length && (payload[vp8Header.Length] & 0x01) == 0;
+                }
+
+                _currentVideoFrame.Append(payload.Slice(vp8Header.Length));
 
-                    _currVideoFramePosn = 0;
+                if (hdr.MarkerBit > 0)
+                {
+                    var frame = _currentVideoFrame;
+                    _currentVideoFrame = null;
 
-                    return frame;
+                    frame.Timestamp = hdr.Timestamp;
+                    _lastVideoFrameSize = frame.Length;
+                    RaiseFrameReady(frame);
                 }
             }
             else
@@ -75,19 +98,53 @@ internal class RtpVideoFramer
         {
             //logger.LogDebug($"rtp H264 video, seqnum {hdr.SequenceNumber}, ts {hdr.Timestamp}, marker {hdr.MarkerBit}, payload {payload.Length}.");
 
-            //var hdr = rtpPacket.Header;
-            var frameStream = _h264Depacketiser!.ProcessRTPPayload(payload, hdr.SequenceNumber, hdr.Timestamp, hdr.MarkerBit, out bool isKeyFrame);
+            if (_h264Depacketiser!.TryCompletePendingFrame(hdr.Timestamp, out var pendingFrame))
+            {
+                RaiseFrameReady(pendingFrame!);
+            }
 
-            if (frameStream != null)
+            var frame = _h264Depacketiser.ProcessRTPPayload(payload, hdr.Timestamp, hdr.MarkerBit);
+            if (frame != null)
             {
-                return frameStream.ToArray();
+                RaiseFrameReady(frame);
             }
         }
         else
         {
             logger.LogWarning($"rtp unknown video, seqnum {hdr.SequenceNumber}, ts {hdr.Timestamp}, marker {hdr.MarkerBit}, payload {payload.Length}.");
         }
+    }
+
+    /// <summary>
+    /// Tells the framer that packets preceding the next one were lost.
+    /// </summary>
+    public void NotifyPacketLoss()
+    {
+        if (_codec == VideoCodecsEnum.VP8)
+        {
+            // A VP8 frame with a hole cannot be decoded, wait for the next start bit.
+            DiscardVideoFrame();
+        }
+        else
+        {
+            _h264Depacketiser?.NotifyPacketLoss();
+        }
+    }
+
+    private void DiscardVideoFrame()
+    {
+        _currentVideoFrame?.Dispose();
+        _currentVideoFrame = null;
+    }
+
+    private void RaiseFrameReady(EncodedFrame frame)
+    {
+        if (OnFrameReady == null)
+        {
+            frame.Dispose();
+            return;
+        }
 
-        return null;
+        OnFrameReady.Invoke(frame);
     }
 }
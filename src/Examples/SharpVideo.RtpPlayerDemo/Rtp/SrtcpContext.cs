@@ -0,0 +1,117 @@
+using System.Buffers.Binary;
+using SharpVideo.Srtp;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// SRTCP protection of one direction: decrypts received compound packets with per-SSRC replay protection, or
+/// encrypts outgoing ones with an incrementing SRTCP index.
+/// </summary>
+/// <remarks>
+/// RTCP rates are low, so the context is simply locked; it can be used from any thread.
+/// </remarks>
+internal sealed class SrtcpContext : IDisposable
+{
+    private const int MAX_SOURCES = 256;
+
+    /// <summary>
+    /// Largest SRTCP index; the master key has to be changed before it wraps (RFC 3711 9.2).
+    /// </summary>
+    private const uint MAX_INDEX = 0x7FFFFFFF;
+
+    private readonly SrtpCipher _cipher;
+    private readonly Dictionary<uint, SrtpReplayWindow> _replayWindows = new();
+    private readonly object _lock = new();
+    private uint _nextIndex;
+    private bool _isDisposed;
+    private int _rejectedPackets;
+
+    public SrtcpContext(SrtpPolicy policy)
+    {
+        _cipher = new SrtpCipher(policy, isRtcp: true);
+    }
+
+    /// <summary>
+    /// Bytes <see cref="TryProtect"/> appends to a packet.
+    /// </summary>
+    public int Overhead => SrtpCipher.SRTCP_INDEX_LENGTH + _cipher.TagLength;
+
+    /// <summary>
+    /// Number of received packets dropped because they were not authentic or replayed.
+    /// </summary>
+    public int RejectedPackets => Volatile.Read(ref _rejectedPackets);
+
+    /// <summary>
+    /// Authenticates and decrypts an SRTCP packet in place.
+    /// </summary>
+    /// <param name="packet">The SRTCP packet.</param>
+    /// <param name="length">Length of the plain compound RTCP packet at the start of <paramref name="packet"/>.</param>
+    /// <returns>False if the packet is not authentic or a replay.</returns>
+    public bool TryUnprotect(Span<byte> packet, out int length)
+    {
+        lock (_lock)
+        {
+            length = 0;
+            if (_isDisposed)
+            {
+                return false;
+            }
+
+            if (!_cipher.TryUnprotectRtcp(packet, out uint index, out length))
+            {
+                _rejectedPackets++;
+                return false;
+            }
+
+            uint ssrc = BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(4));
+            _replayWindows.TryGetValue(ssrc, out var window);
+            if (window.IsReplay(index))
+            {
+                _rejectedPackets++;
+                return false;
+            }
+
+            if (_replayWindows.Count >= MAX_SOURCES && !_replayWindows.ContainsKey(ssrc))
+            {
+                _replayWindows.Clear();
+            }
+
+            window.Update(index);
+            _replayWindows[ssrc] = window;
+            return true;
+        }
+    }
+
+    /// <summary>
+    /// Encrypts a compound RTCP packet in place.
+    /// </summary>
+    /// <param name="buffer">Buffer holding the packet, with <see cref="Overhead"/> bytes to spare.</param>
+    /// <param name="length">Length of the RTCP packet on input, of the SRTCP packet on output.</param>
+    /// <returns>False if the context is disposed or the SRTCP index is exhausted.</returns>
+    public bool TryProtect(Span<byte> buffer, ref int length)
+    {
+        lock (_lock)
+        {
+            // The master key has to be renewed before the index wraps, this demo has no rekeying.
+            if (_isDisposed || _nextIndex > MAX_INDEX)
+            {
+                return false;
+            }
+
+            length = _cipher.ProtectRtcp(buffer, length, _nextIndex++);
+            return true;
+        }
+    }
+
+    public void Dispose()
+    {
+        lock (_lock)
+        {
+            if (!_isDisposed)
+            {
+                _isDisposed = true;
+                _cipher.Dispose();
+            }
+        }
+    }
+}
@@ -27,4 +27,19 @@ internal static class TypeExtensions
 
         return false;
     }
+
+    /// <summary>
+    /// True for IPv4 (224.0.0.0/4) and IPv6 (ff00::/8) multicast addresses.
+    /// </summary>
+    public static bool IsMulticast(this IPAddress address)
+    {
+        if (address.AddressFamily == AddressFamily.InterNetwork)
+        {
+            Span<byte> bytes = stackalloc byte[4];
+            address.TryWriteBytes(bytes, out _);
+            return (bytes[0] & 0xF0) == 0xE0;
+        }
+
+        return address.IsIPv6Multicast;
+    }
 }
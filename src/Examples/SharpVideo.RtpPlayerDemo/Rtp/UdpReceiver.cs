@@ -1,40 +1,121 @@
+using System.Buffers.Binary;
 using System.Net;
 using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
 using Microsoft.Extensions.Logging.Abstractions;
+using SharpVideo.Linux.Native;
+using SharpVideo.IoUring;
+using SharpVideo.Linux.Native.C;
+using SharpVideo.Linux.Native.IoUring;
 
 namespace SharpVideo.RtpPlayerDemo.Rtp;
 
-internal delegate void PacketReceivedDelegate(UdpReceiver receiver, int localPort, IPEndPoint remoteEndPoint, byte[] packet);
+/// <summary>
+/// Callback for a received datagram. The packet span points into the receiver's slab and is only valid
+/// for the duration of the call; handlers that need the data later must copy it. Handlers may modify it in place,
+/// e.g. to decrypt SRTP.
+/// </summary>
+internal delegate void PacketReceivedDelegate(UdpReceiver receiver, int localPort, IPEndPoint remoteEndPoint, Span<byte> packet, long receivedTimestampNs);
 
 /// <summary>
 /// A basic UDP socket manager. The RTP channel may need both an RTP and Control socket. This class encapsulates
 /// the common logic for UDP socket management.
 /// </summary>
 /// <remarks>
-/// .NET Framework Socket source:
-/// https://referencesource.microsoft.com/#system/net/system/net/Sockets/Socket.cs
-/// .NET Core Socket source:
-/// https://github.com/dotnet/runtime/blob/master/src/libraries/System.Net.Sockets/src/System/Net/Sockets/Socket.cs
-/// Mono Socket source:
-/// https://github.com/mono/mono/blob/master/mcs/class/System/System.Net.Sockets/Socket.cs
+/// Datagrams are received on a dedicated thread with recvmmsg, up to <see cref="MAX_BATCH_SIZE"/> per system call,
+/// into a pinned slab that is reused for every batch. Kernel receive timestamps are requested with SO_TIMESTAMPNS.
+/// Packets are dispatched as slices of the slab, so the receive path does not allocate per packet.
+/// If UDP_GRO is enabled on the socket (see <see cref="NetServices.TryEnableUdpGro"/>) the kernel may deliver several
+/// datagrams of one flow as a single coalesced buffer; it is split by the reported segment size and every segment is
+/// dispatched as its own packet, still without copying.
+/// With <see cref="UseIoUring"/> a single multishot recvmsg request on an io_uring replaces the recvmmsg and poll
+/// calls: the kernel receives into a ring of provided buffers and one io_uring_enter both waits for and collects
+/// every datagram that arrived meanwhile.
 /// </remarks>
-internal class UdpReceiver
+[SupportedOSPlatform("linux")]
+internal unsafe class UdpReceiver
 {
     /// <summary>
-    /// MTU is 1452 bytes so this should be heaps.
-    /// TODO: What about fragmented UDP packets that are put back together by the OS?
+    /// MTU is 1452 bytes so this should be heaps. Datagrams the kernel reassembled from IP fragments can be larger,
+    /// they arrive truncated and are dropped.
     /// </summary>
     private const int RECEIVE_BUFFER_SIZE = 2048;
 
+    /// <summary>
+    /// Maximum number of datagrams pulled from the socket by one recvmmsg call.
+    /// </summary>
+    public const int MAX_BATCH_SIZE = 64;
+
+    /// <summary>
+    /// Maximum number of coalesced buffers pulled by one recvmmsg call when UDP_GRO is enabled.
+    /// Every slot then has to hold a full 64 KiB super-packet.
+    /// </summary>
+    public const int MAX_GRO_BATCH_SIZE = 16;
+
+    /// <summary>
+    /// Slot size used when UDP_GRO is enabled (maximum UDP payload rounded up).
+    /// </summary>
+    private const int GRO_BUFFER_SIZE = 65536;
+
+    /// <summary>
+    /// Space reserved for ancillary data of every message.
+    /// </summary>
+    private const int CONTROL_BUFFER_SIZE = 64;
+
+    /// <summary>
+    /// How long the receive thread waits for data before re-checking whether the receiver was closed.
+    /// </summary>
+    private const int POLL_TIMEOUT_MS = 250;
+
+    /// <summary>
+    /// Number of provided buffers of the io_uring receive path, datagrams that arrive while all of them are in use
+    /// stay in the socket receive queue.
+    /// </summary>
+    private const int IO_URING_BUFFER_COUNT = 256;
+
+    /// <summary>
+    /// Number of provided buffers when UDP_GRO is enabled and every buffer holds a 64 KiB super-packet.
+    /// </summary>
+    private const int IO_URING_GRO_BUFFER_COUNT = 64;
+
+    /// <summary>
+    /// Submission queue size of the io_uring receive path. Only the receive request and its cancellation are queued.
+    /// </summary>
+    private const uint IO_URING_QUEUE_SIZE = 8;
+
+    /// <summary>
+    /// Minimum interval between two warnings about failed receives, the errors in between are only counted.
+    /// </summary>
+    private const long RECEIVE_ERROR_LOG_INTERVAL_MS = 1000;
+
+    private const ulong IO_URING_RECV_USER_DATA = 1;
+    private const ulong IO_URING_CANCEL_USER_DATA = 2;
+
     private static ILogger logger = new NullLogger<UdpReceiver>();
 
     private readonly Socket _socket;
-    private byte[] _recvBuffer;
-    private bool _isClosed;
+    private readonly int _mtu;
+    private volatile bool _isClosed;
     private bool _isRunningReceive;
     private readonly IPEndPoint _localEndPoint;
     private readonly AddressFamily _addressFamily;
+    private Thread? _receiveThread;
+
+    // Remote end point cache: RTP streams come from a handful of senders, so the IPEndPoint of the
+    // previous datagram is reused as long as the raw socket address does not change.
+    private readonly byte[] _lastSockAddr = new byte[SocketConstants.SOCKADDR_STORAGE_SIZE];
+    private int _lastSockAddrLength;
+    private IPEndPoint? _lastRemoteEndPoint;
+
+    private long _lastReceiveErrorLogTicks;
+    private int _suppressedReceiveErrors;
+    private int _consecutiveReceiveErrors;
+
+    // Set by the receive thread when the socket is unusable. The receiver is closed once the thread released the
+    // socket handle, closing it while the handle is referenced would block.
+    private string? _receiveFailure;
 
     public virtual bool IsClosed
     {
@@ -62,6 +143,54 @@ internal class UdpReceiver
         }
     }
 
+    /// <summary>
+    /// Number of datagrams received since start.
+    /// </summary>
+    public long ReceivedPackets { get; private set; }
+
+    /// <summary>
+    /// Number of recvmmsg calls or io_uring waits that returned data.
+    /// </summary>
+    public long ReceiveBatches { get; private set; }
+
+    /// <summary>
+    /// Number of coalesced UDP_GRO buffers that were split into several datagrams.
+    /// </summary>
+    public long CoalescedBuffers { get; private set; }
+
+    /// <summary>
+    /// True if the socket had UDP_GRO enabled when the receive thread started.
+    /// </summary>
+    public bool IsGroEnabled { get; private set; }
+
+    /// <summary>
+    /// If true datagrams are received through io_uring when the kernel supports it, otherwise with recvmmsg. Must be
+    /// set before <see cref="BeginReceiveFrom"/>.
+    /// </summary>
+    public bool UseIoUring { get; set; }
+
+    /// <summary>
+    /// True if the receive thread uses io_uring.
+    /// </summary>
+    public bool IsIoUringEnabled { get; private set; }
+
+    /// <summary>
+    /// Number of system calls made by the receive loop (recvmmsg and poll, or io_uring_enter).
+    /// </summary>
+    public long SystemCalls { get; private set; }
+
+    /// <summary>
+    /// How long the receive thread waits for data before raising <see cref="OnIdle"/>. Must be set before
+    /// <see cref="BeginReceiveFrom"/>.
+    /// </summary>
+    public int IdleTimeoutMs { get; set; } = POLL_TIMEOUT_MS;
+
+    /// <summary>
+    /// CPU the receive thread is pinned to, -1 to let the scheduler move it. Must be set before
+    /// <see cref="BeginReceiveFrom"/>.
+    /// </summary>
+    public int Cpu { get; set; } = -1;
+
     /// <summary>
     /// Fires when a new packet has been received on the UDP socket.
     /// </summary>
@@ -70,158 +199,578 @@ internal class UdpReceiver
     /// <summary>
     /// Fires when there is an error attempting to receive on the UDP socket.
     /// </summary>
-    public event Action<string> OnClosed;
+    public event Action<string?> OnClosed;
+
+    /// <summary>
+    /// Fires on the receive thread when no packet arrived within <see cref="IdleTimeoutMs"/>. Lets consumers that
+    /// hold packets back (e.g. a jitter buffer) act on deadlines without a separate timer thread.
+    /// </summary>
+    public event Action<UdpReceiver>? OnIdle;
 
     public UdpReceiver(Socket socket, int mtu = RECEIVE_BUFFER_SIZE)
     {
         _socket = socket;
+        _mtu = mtu;
         _localEndPoint = _socket.LocalEndPoint as IPEndPoint;
-        _recvBuffer = new byte[mtu];
         _addressFamily = _socket.LocalEndPoint.AddressFamily;
     }
 
     /// <summary>
-    /// Starts the receive. This method returns immediately. An event will be fired in the corresponding "End" event to
-    /// return any data received.
+    /// Starts the receive thread. This method returns immediately, packets are delivered through
+    /// <see cref="OnPacketReceived"/> on the receive thread.
     /// </summary>
     public virtual void BeginReceiveFrom()
     {
-        //Prevent call BeginReceiveFrom if it is already running
-        if (_isClosed && _isRunningReceive)
-        {
-            _isRunningReceive = false;
-        }
         if (_isRunningReceive || _isClosed)
         {
             return;
         }
 
-        try
+        _isRunningReceive = true;
+        _receiveThread = new Thread(ReceiveThreadProc)
         {
-            _isRunningReceive = true;
-            EndPoint recvEndPoint = _addressFamily == AddressFamily.InterNetwork ? new IPEndPoint(IPAddress.Any, 0) : new IPEndPoint(IPAddress.IPv6Any, 0);
-            _socket.BeginReceiveFrom(_recvBuffer, 0, _recvBuffer.Length, SocketFlags.None, ref recvEndPoint, EndReceiveFrom, null);
+            Name = $"UdpReceiver:{_localEndPoint.Port}",
+            IsBackground = true,
+            Priority = ThreadPriority.AboveNormal
+        };
+        _receiveThread.Start();
+    }
+
+    private void ReceiveThreadProc()
+    {
+        // Keep the descriptor alive while it is used directly. Closing the socket from another thread
+        // then only marks it closed and the descriptor is released when this loop exits.
+        var handle = _socket.SafeHandle;
+        bool handleAdded = false;
+
+        if (Cpu >= 0)
+        {
+            SetThreadAffinity(Cpu);
         }
-        // Thrown when socket is closed. Can be safely ignored.
-        // This exception can be thrown in response to an ICMP packet. The problem is the ICMP packet can be a false positive.
-        // For example if the remote RTP socket has not yet been opened the remote host could generate an ICMP packet for the
-        // initial RTP packets. Experience has shown that it's not safe to close an RTP connection based solely on ICMP packets.
-        catch (ObjectDisposedException)
+
+        IsGroEnabled = NetServices.IsUdpGroEnabled(_socket);
+        int receiveSize = IsGroEnabled ? GRO_BUFFER_SIZE : _mtu;
+        int pollTimeoutMs = Math.Clamp(IdleTimeoutMs, 1, POLL_TIMEOUT_MS);
+
+        try
         {
-            _isRunningReceive = false;
+            handle.DangerousAddRef(ref handleAdded);
+            int fd = (int)handle.DangerousGetHandle();
+
+            int enable = 1;
+            if (Libc.setsockopt(fd, SocketConstants.SOL_SOCKET, SocketConstants.SO_TIMESTAMPNS, &enable, sizeof(int)) != 0)
+            {
+                logger.LogWarning($"UdpReceiver failed to enable SO_TIMESTAMPNS on {_localEndPoint} (errno {Marshal.GetLastPInvokeError()}), using user space timestamps.");
+            }
+
+            if (!UseIoUring || !ReceiveWithIoUring(fd, receiveSize, pollTimeoutMs))
+            {
+                ReceiveWithRecvmmsg(fd, IsGroEnabled ? MAX_GRO_BATCH_SIZE : MAX_BATCH_SIZE, receiveSize, pollTimeoutMs);
+            }
         }
+        catch (ObjectDisposedException) // Thrown when socket is closed. Can be safely ignored.
+        { }
         catch (SocketException socketException)
         {
-            _isRunningReceive = false;
-            logger.LogWarning($"Socket error {socketException.SocketErrorCode} in UdpReceiver.BeginReceiveFrom. {socketException.Message}");
-            //Close(sockExcp.Message);
+            // Socket errors do not trigger a close. The reason being that there are genuine situations that can cause them during
+            // normal RTP operation. For example:
+            // - the RTP connection may start sending before the remote socket starts listening,
+            // - an on hold, transfer, etc. operation can change the RTP end point which could result in socket errors from the old
+            //   or new socket during the transition.
+            logger.LogWarning(socketException, $"SocketException UdpReceiver.ReceiveThreadProc ({socketException.SocketErrorCode}). {socketException.Message}");
         }
-        catch (Exception exception)
+        catch (Exception excp)
         {
+            logger.LogError($"Exception UdpReceiver.ReceiveThreadProc. {excp}");
+            _receiveFailure = excp.Message;
+        }
+        finally
+        {
+            if (handleAdded)
+            {
+                handle.DangerousRelease();
+            }
+
             _isRunningReceive = false;
-            // From https://github.com/dotnet/corefx/blob/e99ec129cfd594d53f4390bf97d1d736cff6f860/src/System.Net.Sockets/src/System/Net/Sockets/Socket.cs#L3262
-            // the BeginReceiveFrom will only throw if there is an problem with the arguments or the socket has been disposed of. In that
-            // case the socket can be considered to be unusable and there's no point trying another receive.
-            logger.LogError(exception, $"Exception UdpReceiver.BeginReceiveFrom. {exception.Message}");
-            Close(exception.Message);
+        }
+
+        if (_receiveFailure != null)
+        {
+            Close(_receiveFailure);
         }
     }
 
-    /// <summary>
-    /// Handler for end of the begin receive call.
-    /// </summary>
-    /// <param name="ar">Contains the results of the receive.</param>
-    private void EndReceiveFrom(IAsyncResult ar)
+    private void ReceiveWithRecvmmsg(int fd, int batchSize, int receiveSize, int pollTimeoutMs)
     {
+        int slotSize = (receiveSize + 63) & ~63;
+        var slab = GC.AllocateUninitializedArray<byte>(slotSize * batchSize, pinned: true);
+        var messages = (MMsgHdr*)NativeMemory.AllocZeroed((nuint)(sizeof(MMsgHdr) * batchSize));
+        var iovecs = (IoVec*)NativeMemory.AllocZeroed((nuint)(sizeof(IoVec) * batchSize));
+        var names = (byte*)NativeMemory.AllocZeroed((nuint)(SocketConstants.SOCKADDR_STORAGE_SIZE * batchSize));
+        var controls = (byte*)NativeMemory.AllocZeroed((nuint)(CONTROL_BUFFER_SIZE * batchSize));
+
         try
         {
-            // When socket is closed the object will be disposed of in the middle of a receive.
-            if (!_isClosed)
+            fixed (byte* slabPtr = slab)
             {
-                EndPoint remoteEP = _addressFamily == AddressFamily.InterNetwork ? new IPEndPoint(IPAddress.Any, 0) : new IPEndPoint(IPAddress.IPv6Any, 0);
-                int bytesRead = _socket.EndReceiveFrom(ar, ref remoteEP);
+                for (int i = 0; i < batchSize; i++)
+                {
+                    iovecs[i].iov_base = (nint)(slabPtr + i * slotSize);
+                    iovecs[i].iov_len = (nuint)receiveSize;
+                }
 
-                if (bytesRead > 0)
+                var pollFd = new PollFd { fd = fd, events = PollEvents.POLLIN };
+
+                while (!_isClosed)
                 {
-                    // During experiments IPPacketInformation wasn't getting set on Linux. Without it the local IP address
-                    // cannot be determined when a listener was bound to IPAddress.Any (or IPv6 equivalent). If the caller
-                    // is relying on getting the local IP address on Linux then something may fail.
-                    //if (packetInfo != null && packetInfo.Address != null)
-                    //{
-                    //    localEndPoint = new IPEndPoint(packetInfo.Address, localEndPoint.Port);
-                    //}
-
-                    byte[] packetBuffer = new byte[bytesRead];
-                    // TODO: When .NET Framework support is dropped switch to using a slice instead of a copy.
-                    Buffer.BlockCopy(_recvBuffer, 0, packetBuffer, 0, bytesRead);
-                    CallOnPacketReceivedCallback(_localEndPoint.Port, remoteEP as IPEndPoint, packetBuffer);
+                    for (int i = 0; i < batchSize; i++)
+                    {
+                        ref var hdr = ref messages[i].msg_hdr;
+                        hdr.msg_name = (nint)(names + i * SocketConstants.SOCKADDR_STORAGE_SIZE);
+                        hdr.msg_namelen = SocketConstants.SOCKADDR_STORAGE_SIZE;
+                        hdr.msg_iov = (nint)(iovecs + i);
+                        hdr.msg_iovlen = 1;
+                        hdr.msg_control = (nint)(controls + i * CONTROL_BUFFER_SIZE);
+                        hdr.msg_controllen = CONTROL_BUFFER_SIZE;
+                        hdr.msg_flags = 0;
+                        messages[i].msg_len = 0;
+                    }
+
+                    SystemCalls++;
+                    int received = Libc.recvmmsg(fd, messages, (uint)batchSize, SocketConstants.MSG_DONTWAIT, null);
+                    if (received < 0)
+                    {
+                        int errno = Marshal.GetLastPInvokeError();
+                        if (errno == SocketConstants.EAGAIN || errno == SocketConstants.EINTR)
+                        {
+                            // Nothing queued. Sleep in poll rather than in recvmmsg so that Close is noticed promptly.
+                            pollFd.revents = 0;
+                            SystemCalls++;
+                            if (Libc.poll(ref pollFd, 1, pollTimeoutMs) == 0 && !_isClosed)
+                            {
+                                OnIdle?.Invoke(this);
+                            }
+                            continue;
+                        }
+
+                        if (IsFatalReceiveError("recvmmsg", errno))
+                        {
+                            return;
+                        }
+
+                        BackOffAfterReceiveError(ref pollFd, pollTimeoutMs);
+                        continue;
+                    }
+
+                    _consecutiveReceiveErrors = 0;
+                    ReceiveBatches++;
+
+                    for (int i = 0; i < received; i++)
+                    {
+                        ref var msg = ref messages[i];
+                        int length = (int)msg.msg_len;
+                        if (length <= 0 || (msg.msg_hdr.msg_flags & SocketConstants.MSG_TRUNC) != 0)
+                        {
+                            continue;
+                        }
+
+                        var remoteEndPoint = GetRemoteEndPoint((byte*)msg.msg_hdr.msg_name, (int)msg.msg_hdr.msg_namelen);
+                        if (remoteEndPoint == null)
+                        {
+                            continue;
+                        }
+
+                        ParseControlMessages(ref msg.msg_hdr, out long timestampNs, out int segmentSize);
+                        DispatchDatagram(remoteEndPoint, new Span<byte>(slabPtr + i * slotSize, length), timestampNs, segmentSize);
+                    }
                 }
             }
+        }
+        finally
+        {
+            NativeMemory.Free(controls);
+            NativeMemory.Free(names);
+            NativeMemory.Free(iovecs);
+            NativeMemory.Free(messages);
+        }
+    }
+
+    /// <summary>
+    /// Receives with one multishot recvmsg request on an io_uring. The kernel picks a free buffer from a provided
+    /// buffer ring for every datagram and posts a completion, and a single io_uring_enter call both waits and
+    /// collects all datagrams that arrived meanwhile.
+    /// </summary>
+    /// <returns>False if io_uring is not available, the caller falls back to recvmmsg.</returns>
+    private bool ReceiveWithIoUring(int fd, int receiveSize, int pollTimeoutMs)
+    {
+        // Every buffer starts with the recvmsg header, the source address and the ancillary data
+        int headerSize = sizeof(IoUringRecvmsgOut) + SocketConstants.SOCKADDR_STORAGE_SIZE + CONTROL_BUFFER_SIZE;
+        int bufferCount = IsGroEnabled ? IO_URING_GRO_BUFFER_COUNT : IO_URING_BUFFER_COUNT;
+
+        var flags = IoUringSetupFlags.IORING_SETUP_SINGLE_ISSUER | IoUringSetupFlags.IORING_SETUP_DEFER_TASKRUN;
+        if (!IoUringRing.TryCreate(IO_URING_QUEUE_SIZE, flags, (uint)bufferCount * 2, out var ring, out int errno))
+        {
+            logger.LogWarning($"UdpReceiver on {_localEndPoint} cannot create an io_uring (errno {errno}), using recvmmsg.");
+            return false;
+        }
 
-            // If there is still data available it should be read now. This is more efficient than calling
-            // BeginReceiveFrom which will incur the overhead of creating the callback and then immediately firing it.
-            // It also avoids the situation where if the application cannot keep up with the network then BeginReceiveFrom
-            // will be called synchronously (if data is available it calls the callback method immediately) which can
-            // create a very nasty stack.
-            if (!_isClosed && _socket.Available > 0)
+        using var _ = ring;
+        IoUringBufferRing buffers;
+        try
+        {
+            buffers = new IoUringBufferRing(ring, 0, bufferCount, headerSize + receiveSize);
+        }
+        catch (InvalidOperationException ex)
+        {
+            logger.LogWarning($"UdpReceiver on {_localEndPoint} cannot use io_uring provided buffers ({ex.Message}), using recvmmsg.");
+            return false;
+        }
+
+        var msg = (MsgHdr*)NativeMemory.AllocZeroed((nuint)sizeof(MsgHdr));
+        msg->msg_namelen = SocketConstants.SOCKADDR_STORAGE_SIZE;
+        msg->msg_controllen = CONTROL_BUFFER_SIZE;
+        var completions = new IoUringCqe[bufferCount];
+        var pollFd = new PollFd { fd = fd, events = PollEvents.POLLIN };
+        bool armed = false;
+        bool backOff = false;
+        long systemCalls = SystemCalls;
+        IsIoUringEnabled = true;
+
+        try
+        {
+            while (!_isClosed)
             {
-                while (!_isClosed && _socket.Available > 0)
+                if (backOff)
+                {
+                    BackOffAfterReceiveError(ref pollFd, pollTimeoutMs);
+                    backOff = false;
+                }
+
+                if (!armed)
+                {
+                    QueueRecvmsg(ring, fd, msg, buffers.GroupId);
+                    armed = true;
+                }
+
+                bool completed = ring.SubmitAndWait(1, pollTimeoutMs);
+                SystemCalls = systemCalls + ring.EnterCalls;
+                if (!completed)
+                {
+                    if (!_isClosed)
+                    {
+                        OnIdle?.Invoke(this);
+                    }
+                    continue;
+                }
+
+                int count = ring.ReapCompletions(completions);
+                if (count == 0)
                 {
-                    EndPoint remoteEP = _addressFamily == AddressFamily.InterNetwork ? new IPEndPoint(IPAddress.Any, 0) : new IPEndPoint(IPAddress.IPv6Any, 0);
-                    int bytesReadSync = _socket.ReceiveFrom(_recvBuffer, 0, _recvBuffer.Length, SocketFlags.None, ref remoteEP);
+                    continue;
+                }
 
-                    if (bytesReadSync > 0)
+                ReceiveBatches++;
+                for (int i = 0; i < count; i++)
+                {
+                    ref var cqe = ref completions[i];
+                    if ((cqe.flags & IoUringConstants.IORING_CQE_F_MORE) == 0)
                     {
-                        byte[] packetBufferSync = new byte[bytesReadSync];
-                        // TODO: When .NET Framework support is dropped switch to using a slice instead of a copy.
-                        Buffer.BlockCopy(_recvBuffer, 0, packetBufferSync, 0, bytesReadSync);
-                        CallOnPacketReceivedCallback(_localEndPoint.Port, remoteEP as IPEndPoint, packetBufferSync);
+                        // The request ended, e.g. with ENOBUFS after a burst used all buffers, and is queued again
+                        armed = false;
                     }
-                    else
+
+                    if (cqe.res < 0)
                     {
-                        break;
+                        if (cqe.res != -IoUringConstants.ENOBUFS)
+                        {
+                            if (IsFatalReceiveError("io_uring recvmsg", -cqe.res))
+                            {
+                                return true;
+                            }
+
+                            // Wait before the request is queued again so that an error that repeats does not spin
+                            backOff = !armed;
+                        }
+                        continue;
                     }
+
+                    _consecutiveReceiveErrors = 0;
+
+                    if ((cqe.flags & IoUringConstants.IORING_CQE_F_BUFFER) == 0)
+                    {
+                        continue;
+                    }
+
+                    ushort bufferId = cqe.BufferId;
+                    DispatchRecvmsgOut(buffers.GetBuffer(bufferId), cqe.res, headerSize);
+                    buffers.Recycle(bufferId);
                 }
+
+                buffers.Publish();
             }
         }
-        catch (SocketException resetSockExcp) when (resetSockExcp.SocketErrorCode == SocketError.ConnectionReset)
+        finally
         {
-            // Thrown when close is called on a socket from this end. Safe to ignore.
+            if (armed)
+            {
+                CancelRecvmsg(ring, completions);
+            }
+
+            buffers.Dispose();
+            NativeMemory.Free(msg);
         }
-        catch (SocketException socketException)
+
+        return true;
+    }
+
+    /// <summary>
+    /// Stops the receive loop if a receive failed because the socket is unusable, the receiver is closed after it.
+    /// Other errors, such as ECONNREFUSED in response to ICMP or ENOMEM under memory pressure, are transient (see the
+    /// note in the SocketException handler of ReceiveThreadProc): they are only logged, at most once per
+    /// <see cref="RECEIVE_ERROR_LOG_INTERVAL_MS"/>, and the loop backs off before the next attempt.
+    /// </summary>
+    /// <returns>True if the receive loop has to stop.</returns>
+    private bool IsFatalReceiveError(string call, int errno)
+    {
+        if (errno is SocketConstants.EBADF or SocketConstants.ENOTSOCK or SocketConstants.EINVAL)
         {
-            // Socket errors do not trigger a close. The reason being that there are genuine situations that can cause them during
-            // normal RTP operation. For example:
-            // - the RTP connection may start sending before the remote socket starts listening,
-            // - an on hold, transfer, etc. operation can change the RTP end point which could result in socket errors from the old
-            //   or new socket during the transition.
-            // It also seems that once a UDP socket pair have exchanged packets and the remote party closes the socket exception will occur
-            // in the BeginReceive method (very handy). Follow-up, this doesn't seem to be the case, the socket exception can occur in
-            // BeginReceive before any packets have been exchanged. This means it's not safe to close if BeginReceive gets an ICMP
-            // error since the remote party may not have initialised their socket yet.
-            logger.LogWarning(socketException, $"SocketException UdpReceiver.EndReceiveFrom ({socketException.SocketErrorCode}). {socketException.Message}");
+            logger.LogError($"{call} failed on {_localEndPoint} with errno {errno}, closing the receiver.");
+            _receiveFailure = $"{call} failed with errno {errno}";
+            return true;
         }
-        catch (ObjectDisposedException) // Thrown when socket is closed. Can be safely ignored.
-        { }
-        catch (Exception excp)
+
+        long now = Environment.TickCount64;
+        if (now - _lastReceiveErrorLogTicks < RECEIVE_ERROR_LOG_INTERVAL_MS)
         {
-            logger.LogError($"Exception UdpReceiver.EndReceiveFrom. {excp}");
-            Close(excp.Message);
+            _suppressedReceiveErrors++;
+            return false;
         }
-        finally
+
+        logger.LogWarning(_suppressedReceiveErrors > 0
+            ? $"{call} failed on {_localEndPoint} with errno {errno}, {_suppressedReceiveErrors} more failures since the last warning."
+            : $"{call} failed on {_localEndPoint} with errno {errno}.");
+        _lastReceiveErrorLogTicks = now;
+        _suppressedReceiveErrors = 0;
+        return false;
+    }
+
+    /// <summary>
+    /// Waits before a receive is retried after a transient error. The first wait ends as soon as a datagram is
+    /// readable. An error that repeats, e.g. ENOMEM while datagrams stay queued, sleeps the whole timeout instead.
+    /// </summary>
+    private void BackOffAfterReceiveError(ref PollFd pollFd, int pollTimeoutMs)
+    {
+        if (_consecutiveReceiveErrors++ == 0)
         {
-            _isRunningReceive = false;
-            if (!_isClosed)
+            pollFd.revents = 0;
+            SystemCalls++;
+            Libc.poll(ref pollFd, 1, pollTimeoutMs);
+        }
+        else
+        {
+            Thread.Sleep(pollTimeoutMs);
+        }
+    }
+
+    private static void QueueRecvmsg(IoUringRing ring, int fd, MsgHdr* msg, ushort groupId)
+    {
+        var sqe = ring.GetSqe();
+        sqe->opcode = IoUringOp.IORING_OP_RECVMSG;
+        sqe->fd = fd;
+        sqe->addr = (ulong)msg;
+        sqe->len = 1;
+        sqe->ioprio = IoUringConstants.IORING_RECV_MULTISHOT;
+        sqe->flags = IoUringConstants.IOSQE_BUFFER_SELECT;
+        sqe->buf_index = groupId;
+        sqe->user_data = IO_URING_RECV_USER_DATA;
+    }
+
+    /// <summary>
+    /// Cancels the multishot request and waits for its last completion, after that the kernel no longer writes to
+    /// the buffers.
+    /// </summary>
+    private static void CancelRecvmsg(IoUringRing ring, IoUringCqe[] completions)
+    {
+        var sqe = ring.GetSqe();
+        if (sqe == null)
+        {
+            return;
+        }
+
+        sqe->opcode = IoUringOp.IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = IO_URING_RECV_USER_DATA;
+        sqe->user_data = IO_URING_CANCEL_USER_DATA;
+
+        for (int attempt = 0; attempt < 10; attempt++)
+        {
+            ring.SubmitAndWait(1, POLL_TIMEOUT_MS);
+            int count = ring.ReapCompletions(completions);
+            for (int i = 0; i < count; i++)
             {
-                BeginReceiveFrom();
+                if (completions[i].user_data == IO_URING_RECV_USER_DATA &&
+                    (completions[i].flags & IoUringConstants.IORING_CQE_F_MORE) == 0)
+                {
+                    return;
+                }
             }
         }
     }
 
+    /// <summary>
+    /// Dispatches the datagram of a provided buffer filled by multishot recvmsg: struct io_uring_recvmsg_out, the
+    /// source address and the ancillary data at the sizes of the request, then the payload.
+    /// </summary>
+    private void DispatchRecvmsgOut(byte* buffer, int length, int headerSize)
+    {
+        var header = (IoUringRecvmsgOut*)buffer;
+        int payloadLength = (int)header->payloadlen;
+        if (payloadLength <= 0 || (header->flags & SocketConstants.MSG_TRUNC) != 0 || headerSize + payloadLength > length)
+        {
+            return;
+        }
+
+        byte* name = buffer + sizeof(IoUringRecvmsgOut);
+        var remoteEndPoint = GetRemoteEndPoint(name, (int)Math.Min(header->namelen, SocketConstants.SOCKADDR_STORAGE_SIZE));
+        if (remoteEndPoint == null)
+        {
+            return;
+        }
+
+        var hdr = new MsgHdr
+        {
+            msg_control = (nint)(name + SocketConstants.SOCKADDR_STORAGE_SIZE),
+            msg_controllen = Math.Min(header->controllen, CONTROL_BUFFER_SIZE)
+        };
+        ParseControlMessages(ref hdr, out long timestampNs, out int segmentSize);
+        DispatchDatagram(remoteEndPoint, new Span<byte>(buffer + headerSize, payloadLength), timestampNs, segmentSize);
+    }
+
+    /// <summary>
+    /// Dispatches a received buffer, split into its datagrams if UDP_GRO coalesced several.
+    /// </summary>
+    private void DispatchDatagram(IPEndPoint remoteEndPoint, Span<byte> data, long timestampNs, int segmentSize)
+    {
+        if (segmentSize <= 0 || segmentSize >= data.Length)
+        {
+            ReceivedPackets++;
+            CallOnPacketReceivedCallback(_localEndPoint.Port, remoteEndPoint, data, timestampNs);
+            return;
+        }
+
+        // Coalesced buffer: every segment except possibly the last one is exactly segmentSize long.
+        CoalescedBuffers++;
+        for (int offset = 0; offset < data.Length; offset += segmentSize)
+        {
+            ReceivedPackets++;
+            int segmentLength = Math.Min(segmentSize, data.Length - offset);
+            CallOnPacketReceivedCallback(_localEndPoint.Port, remoteEndPoint, data.Slice(offset, segmentLength), timestampNs);
+        }
+    }
+
+    /// <summary>
+    /// Pins the calling thread to a CPU, so the packets of the socket are processed with warm caches and do not
+    /// compete with the receive threads of other sockets.
+    /// </summary>
+    private void SetThreadAffinity(int cpu)
+    {
+        // cpu_set_t of the C library, 1024 CPUs.
+        const int CPU_SET_WORDS = 16;
+        if (cpu >= CPU_SET_WORDS * 64)
+        {
+            logger.LogWarning($"UdpReceiver on {_localEndPoint} cannot be pinned to CPU {cpu}.");
+            return;
+        }
+
+        ulong* mask = stackalloc ulong[CPU_SET_WORDS];
+        new Span<ulong>(mask, CPU_SET_WORDS).Clear();
+        mask[cpu / 64] = 1UL << (cpu % 64);
+        if (Libc.sched_setaffinity(0, CPU_SET_WORDS * sizeof(ulong), mask) != 0)
+        {
+            logger.LogWarning($"UdpReceiver on {_localEndPoint} failed to pin its thread to CPU {cpu} (errno {Marshal.GetLastPInvokeError()}).");
+        }
+    }
+
+    /// <summary>
+    /// Extracts the SCM_TIMESTAMPNS and UDP_GRO control messages. The timestamp falls back to the current time if the
+    /// kernel did not supply one, the segment size is 0 for buffers that were not coalesced.
+    /// </summary>
+    private static void ParseControlMessages(ref MsgHdr hdr, out long timestampNs, out int segmentSize)
+    {
+        byte* control = (byte*)hdr.msg_control;
+        int controlLength = (int)hdr.msg_controllen;
+        int offset = 0;
+
+        timestampNs = 0;
+        segmentSize = 0;
+
+        while (offset + CMsgHdr.DataOffset <= controlLength)
+        {
+            var cmsg = (CMsgHdr*)(control + offset);
+            int cmsgLength = (int)cmsg->cmsg_len;
+            if (cmsgLength < CMsgHdr.DataOffset)
+            {
+                break;
+            }
+
+            if (cmsg->cmsg_level == SocketConstants.SOL_SOCKET &&
+                cmsg->cmsg_type == SocketConstants.SCM_TIMESTAMPNS &&
+                cmsgLength >= CMsgHdr.DataOffset + sizeof(TimeSpec))
+            {
+                timestampNs = ((TimeSpec*)(control + offset + CMsgHdr.DataOffset))->TotalNanoseconds;
+            }
+            else if (cmsg->cmsg_level == SocketConstants.SOL_UDP &&
+                     cmsg->cmsg_type == SocketConstants.UDP_GRO &&
+                     cmsgLength >= CMsgHdr.DataOffset + sizeof(int))
+            {
+                segmentSize = *(int*)(control + offset + CMsgHdr.DataOffset);
+            }
+
+            offset += CMsgHdr.Align(cmsgLength);
+        }
+
+        if (timestampNs == 0)
+        {
+            timestampNs = (DateTime.UtcNow - DateTime.UnixEpoch).Ticks * 100;
+        }
+    }
+
+    private IPEndPoint? GetRemoteEndPoint(byte* sockAddr, int length)
+    {
+        var raw = new ReadOnlySpan<byte>(sockAddr, Math.Min(length, SocketConstants.SOCKADDR_STORAGE_SIZE));
+        if (_lastRemoteEndPoint != null && raw.SequenceEqual(_lastSockAddr.AsSpan(0, _lastSockAddrLength)))
+        {
+            return _lastRemoteEndPoint;
+        }
+
+        IPEndPoint? endPoint = null;
+        ushort family = MemoryMarshal.Read<ushort>(raw);
+        if (family == SocketConstants.AF_INET && raw.Length >= 8)
+        {
+            int port = BinaryPrimitives.ReadUInt16BigEndian(raw.Slice(2));
+            endPoint = new IPEndPoint(new IPAddress(raw.Slice(4, 4)), port);
+        }
+        else if (family == SocketConstants.AF_INET6 && raw.Length >= 28)
+        {
+            int port = BinaryPrimitives.ReadUInt16BigEndian(raw.Slice(2));
+            uint scopeId = MemoryMarshal.Read<uint>(raw.Slice(24));
+            endPoint = new IPEndPoint(new IPAddress(raw.Slice(8, 16), scopeId), port);
+        }
+
+        if (endPoint != null)
+        {
+            raw.CopyTo(_lastSockAddr);
+            _lastSockAddrLength = raw.Length;
+            _lastRemoteEndPoint = endPoint;
+        }
+
+        return endPoint;
+    }
+
     /// <summary>
     /// Closes the socket and stops any new receives from being initiated.
     /// </summary>
-    public virtual void Close(string reason)
+    public virtual void Close(string? reason)
     {
         if (!_isClosed)
         {
@@ -232,8 +781,8 @@ internal class UdpReceiver
         }
     }
 
-    protected virtual void CallOnPacketReceivedCallback(int localPort, IPEndPoint remoteEndPoint, byte[] packet)
+    protected virtual void CallOnPacketReceivedCallback(int localPort, IPEndPoint remoteEndPoint, Span<byte> packet, long receivedTimestampNs)
     {
-        OnPacketReceived?.Invoke(this, localPort, remoteEndPoint, packet);
+        OnPacketReceived?.Invoke(this, localPort, remoteEndPoint, packet, receivedTimestampNs);
     }
 }
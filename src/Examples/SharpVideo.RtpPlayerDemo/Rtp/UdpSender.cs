@@ -0,0 +1,384 @@
+using System.Diagnostics;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using SharpVideo.Linux.Native;
+using SharpVideo.Linux.Native.C;
+
+namespace SharpVideo.RtpPlayerDemo.Rtp;
+
+/// <summary>
+/// Sends batches of RTP packets to one or more destinations with sendmmsg, optionally paced.
+/// </summary>
+/// <remarks>
+/// Packets are sent straight from the pinned slab of an <see cref="RtpPacketBatch"/>, up to
+/// <see cref="MAX_BATCH_SIZE"/> messages per system call. With UDP_SEGMENT (generic segmentation offload, Linux 4.18)
+/// runs of equally sized packets, such as the FU-A fragments of a slice, go out as one message that the kernel splits
+/// into datagrams, so a large frame costs a handful of system calls and a single route lookup per destination.
+/// If the kernel or the device rejects segmentation the sender falls back to one message per packet.
+/// Without pacing a frame leaves as one burst. With <see cref="PacingBitrate"/> set, the packets are sent in bursts of
+/// at most <see cref="MaxBurstBytes"/> spread at that rate, which keeps the bursts of large key frames from
+/// overflowing switch and receiver buffers.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+internal sealed unsafe class UdpSender : IDisposable
+{
+    /// <summary>
+    /// Maximum number of messages passed to one sendmmsg call.
+    /// </summary>
+    public const int MAX_BATCH_SIZE = 64;
+
+    /// <summary>
+    /// Maximum number of datagrams in one UDP_SEGMENT message (UDP_MAX_SEGMENTS of the kernel).
+    /// </summary>
+    private const int MAX_GSO_SEGMENTS = 64;
+
+    /// <summary>
+    /// Maximum size of one UDP_SEGMENT message, the UDP payload limit minus some margin.
+    /// </summary>
+    private const int MAX_GSO_BYTES = 65000;
+
+    private const int DEFAULT_MAX_BURST_BYTES = 16 * 1024;
+
+    /// <summary>
+    /// Remaining wait below which the pacer spins instead of sleeping.
+    /// </summary>
+    private const long SPIN_THRESHOLD_NS = 1_000_000;
+
+    private const int SEND_POLL_TIMEOUT_MS = 250;
+
+    private readonly Socket _socket;
+    private readonly ILogger _logger;
+    private readonly int _destinationCount;
+    private readonly byte* _names;
+    private readonly uint[] _nameLengths;
+    private readonly MMsgHdr* _messages;
+    private readonly byte* _controls;
+    private readonly int _controlSize = CMsgHdr.Space(sizeof(ushort));
+    private readonly List<(int Destination, int FirstPacket, int PacketCount)> _pending = new();
+    private readonly Stopwatch _clock = Stopwatch.StartNew();
+    private IoVec* _iovecs;
+    private int _iovecCapacity;
+    private long _nextSendNs;
+    private bool _isGsoEnabled;
+    private bool _isDisposed;
+
+    /// <param name="socket">Bound UDP socket, the caller keeps ownership.</param>
+    /// <param name="destinations">Every packet is sent to all destinations.</param>
+    /// <param name="logger">Logger.</param>
+    /// <param name="enableGso">Try UDP_SEGMENT before falling back to one message per packet.</param>
+    public UdpSender(Socket socket, IReadOnlyList<IPEndPoint> destinations, ILogger logger, bool enableGso = true)
+    {
+        if (destinations.Count == 0)
+        {
+            throw new ArgumentException("At least one destination is required.", nameof(destinations));
+        }
+
+        _socket = socket;
+        _logger = logger;
+        _isGsoEnabled = enableGso;
+        _destinationCount = destinations.Count;
+
+        _names = (byte*)NativeMemory.AllocZeroed((nuint)(SocketConstants.SOCKADDR_STORAGE_SIZE * _destinationCount));
+        _nameLengths = new uint[_destinationCount];
+        for (int i = 0; i < _destinationCount; i++)
+        {
+            // Dual mode sockets need IPv4 destinations as mapped IPv6 addresses
+            var destination = socket.AddressFamily == AddressFamily.InterNetworkV6 && destinations[i].AddressFamily == AddressFamily.InterNetwork
+                ? new IPEndPoint(destinations[i].Address.MapToIPv6(), destinations[i].Port)
+                : destinations[i];
+            var address = destination.Serialize();
+            var name = new Span<byte>(_names + i * SocketConstants.SOCKADDR_STORAGE_SIZE, SocketConstants.SOCKADDR_STORAGE_SIZE);
+            for (int b = 0; b < address.Size; b++)
+            {
+                name[b] = address[b];
+            }
+
+            _nameLengths[i] = (uint)address.Size;
+        }
+
+        _messages = (MMsgHdr*)NativeMemory.AllocZeroed((nuint)(sizeof(MMsgHdr) * MAX_BATCH_SIZE));
+        _controls = (byte*)NativeMemory.AllocZeroed((nuint)(_controlSize * MAX_BATCH_SIZE));
+    }
+
+    /// <summary>
+    /// Sending rate per destination in bits per second, 0 sends every batch as one burst.
+    /// </summary>
+    public long PacingBitrate { get; set; }
+
+    /// <summary>
+    /// Largest burst when pacing.
+    /// </summary>
+    public int MaxBurstBytes { get; set; } = DEFAULT_MAX_BURST_BYTES;
+
+    /// <summary>
+    /// True while UDP_SEGMENT is used, false after the kernel rejected it.
+    /// </summary>
+    public bool IsGsoEnabled => _isGsoEnabled;
+
+    /// <summary>
+    /// Number of datagrams sent, counted once per destination.
+    /// </summary>
+    public long PacketsSent { get; private set; }
+
+    /// <summary>
+    /// Number of sendmmsg calls.
+    /// </summary>
+    public long SendCalls { get; private set; }
+
+    /// <summary>
+    /// Number of messages the kernel segmented into several datagrams.
+    /// </summary>
+    public long SegmentedMessages { get; private set; }
+
+    /// <summary>
+    /// Number of datagrams that could not be sent.
+    /// </summary>
+    public long SendErrors { get; private set; }
+
+    /// <summary>
+    /// Sends all packets of the batch to every destination, waiting for the pacer where required.
+    /// </summary>
+    public void Send(RtpPacketBatch batch, CancellationToken cancellationToken = default)
+    {
+        ObjectDisposedException.ThrowIf(_isDisposed, this);
+        if (batch.Count == 0)
+        {
+            return;
+        }
+
+        var handle = _socket.SafeHandle;
+        bool handleAdded = false;
+        try
+        {
+            handle.DangerousAddRef(ref handleAdded);
+            int fd = (int)handle.DangerousGetHandle();
+
+            fixed (byte* slab = batch.Slab)
+            {
+                PrepareIoVecs(batch, slab);
+
+                int first = 0;
+                while (first < batch.Count && !cancellationToken.IsCancellationRequested)
+                {
+                    int end = first;
+                    int burstBytes = 0;
+                    do
+                    {
+                        burstBytes += batch.GetLength(end++);
+                    }
+                    while (end < batch.Count && (PacingBitrate <= 0 || burstBytes + batch.GetLength(end) <= MaxBurstBytes));
+
+                    if (PacingBitrate > 0)
+                    {
+                        PreciseWait.Until(_clock, _nextSendNs, cancellationToken, SPIN_THRESHOLD_NS);
+                    }
+
+                    SendBurst(fd, batch, first, end);
+
+                    if (PacingBitrate > 0)
+                    {
+                        long nowNs = _clock.Elapsed.Ticks * 100;
+                        _nextSendNs = Math.Max(_nextSendNs, nowNs) + burstBytes * 8L * 1_000_000_000 / PacingBitrate;
+                    }
+
+                    first = end;
+                }
+            }
+        }
+        finally
+        {
+            if (handleAdded)
+            {
+                handle.DangerousRelease();
+            }
+        }
+    }
+
+    private void PrepareIoVecs(RtpPacketBatch batch, byte* slab)
+    {
+        if (_iovecCapacity < batch.Count)
+        {
+            NativeMemory.Free(_iovecs);
+            _iovecCapacity = Math.Max(batch.Count, _iovecCapacity * 2);
+            _iovecs = (IoVec*)NativeMemory.AllocZeroed((nuint)(sizeof(IoVec) * _iovecCapacity));
+        }
+
+        for (int i = 0; i < batch.Count; i++)
+        {
+            _iovecs[i].iov_base = (nint)(slab + i * batch.SlotSize);
+            _iovecs[i].iov_len = (nuint)batch.GetLength(i);
+        }
+    }
+
+    /// <summary>
+    /// Sends packets [first, end) to all destinations.
+    /// </summary>
+    private void SendBurst(int fd, RtpPacketBatch batch, int first, int end)
+    {
+        _pending.Clear();
+        for (int destination = 0; destination < _destinationCount; destination++)
+        {
+            int packet = first;
+            while (packet < end)
+            {
+                int count = _isGsoEnabled ? CountSegments(batch, packet, end) : 1;
+                _pending.Add((destination, packet, count));
+                packet += count;
+            }
+        }
+
+        int next = 0;
+        while (next < _pending.Count)
+        {
+            int sent = SendMessages(fd, batch, next, Math.Min(MAX_BATCH_SIZE, _pending.Count - next));
+            next += sent;
+        }
+    }
+
+    /// <summary>
+    /// Number of packets from <paramref name="first"/> that can go out as one segmented message: all of the size of
+    /// the first one, except the last one which may be shorter.
+    /// </summary>
+    private static int CountSegments(RtpPacketBatch batch, int first, int end)
+    {
+        int segmentSize = batch.GetLength(first);
+        int count = 1;
+        int bytes = segmentSize;
+        while (first + count < end && count < MAX_GSO_SEGMENTS)
+        {
+            int length = batch.GetLength(first + count);
+            if (length > segmentSize || bytes + length > MAX_GSO_BYTES)
+            {
+                break;
+            }
+
+            count++;
+            bytes += length;
+            if (length < segmentSize)
+            {
+                break;
+            }
+        }
+
+        return count;
+    }
+
+    /// <summary>
+    /// Sends up to <paramref name="count"/> pending messages starting at <paramref name="next"/>.
+    /// </summary>
+    /// <returns>Number of pending messages that are done, sent or failed.</returns>
+    private int SendMessages(int fd, RtpPacketBatch batch, int next, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            var (destination, firstPacket, packetCount) = _pending[next + i];
+            ref var hdr = ref _messages[i].msg_hdr;
+            hdr.msg_name = (nint)(_names + destination * SocketConstants.SOCKADDR_STORAGE_SIZE);
+            hdr.msg_namelen = _nameLengths[destination];
+            hdr.msg_iov = (nint)(_iovecs + firstPacket);
+            hdr.msg_iovlen = (nuint)packetCount;
+            hdr.msg_flags = 0;
+            _messages[i].msg_len = 0;
+
+            if (packetCount > 1)
+            {
+                byte* control = _controls + i * _controlSize;
+                var cmsg = (CMsgHdr*)control;
+                cmsg->cmsg_len = (nuint)(CMsgHdr.DataOffset + sizeof(ushort));
+                cmsg->cmsg_level = SocketConstants.SOL_UDP;
+                cmsg->cmsg_type = SocketConstants.UDP_SEGMENT;
+                *(ushort*)(control + CMsgHdr.DataOffset) = (ushort)batch.GetLength(firstPacket);
+                hdr.msg_control = (nint)control;
+                hdr.msg_controllen = (nuint)_controlSize;
+            }
+            else
+            {
+                hdr.msg_control = 0;
+                hdr.msg_controllen = 0;
+            }
+        }
+
+        while (true)
+        {
+            int sent = Libc.sendmmsg(fd, _messages, (uint)count, 0);
+            if (sent > 0)
+            {
+                SendCalls++;
+                for (int i = 0; i < sent; i++)
+                {
+                    int packetCount = _pending[next + i].PacketCount;
+                    PacketsSent += packetCount;
+                    if (packetCount > 1)
+                    {
+                        SegmentedMessages++;
+                    }
+                }
+
+                return sent;
+            }
+
+            int errno = Marshal.GetLastPInvokeError();
+            if (errno == SocketConstants.EINTR)
+            {
+                continue;
+            }
+
+            if (errno == SocketConstants.EAGAIN)
+            {
+                var pollFd = new PollFd { fd = fd, events = PollEvents.POLLOUT };
+                Libc.poll(ref pollFd, 1, SEND_POLL_TIMEOUT_MS);
+                continue;
+            }
+
+            var failed = _pending[next];
+            if (failed.PacketCount > 1 && (errno == SocketConstants.EIO || errno == SocketConstants.EINVAL))
+            {
+                // Segmentation is not supported on this path, send everything not yet sent packet by packet
+                _logger.LogWarning($"UDP_SEGMENT rejected with errno {errno}, sending one datagram per packet.");
+                _isGsoEnabled = false;
+                SplitPending(next);
+                return 0;
+            }
+
+            // Skip the message, e.g. an unreachable destination must not stall the others
+            _logger.LogWarning($"sendmmsg failed with errno {errno}, {failed.PacketCount} packets not sent.");
+            SendErrors += failed.PacketCount;
+            return 1;
+        }
+    }
+
+    private void SplitPending(int from)
+    {
+        for (int i = _pending.Count - 1; i >= from; i--)
+        {
+            var (destination, firstPacket, packetCount) = _pending[i];
+            if (packetCount == 1)
+            {
+                continue;
+            }
+
+            _pending.RemoveAt(i);
+            for (int p = packetCount - 1; p >= 0; p--)
+            {
+                _pending.Insert(i, (destination, firstPacket + p, 1));
+            }
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_isDisposed)
+        {
+            return;
+        }
+
+        _isDisposed = true;
+        NativeMemory.Free(_iovecs);
+        NativeMemory.Free(_controls);
+        NativeMemory.Free(_messages);
+        NativeMemory.Free(_names);
+    }
+}
@@ -1,6 +1,6 @@
 namespace SharpVideo.RtpPlayerDemo.Rtp;
 
-internal enum VideoCodecsEnum
+public enum VideoCodecsEnum
 {
     CELB,
     JPEG,
@@ -1,3 +1,4 @@
+using System.Buffers.Binary;
 using System.Net;
 using Microsoft.Extensions.Logging;
 
@@ -14,6 +15,19 @@ internal class VideoStream
     private readonly int _maxReconstructedVideoFrameSize = 1048576;
     private RtpVideoFramer? _rtpVideoFramer;
 
+    /// <summary>
+    /// RTP clock rate of video streams.
+    /// </summary>
+    private const int VIDEO_CLOCK_RATE = 90000;
+
+    private RtpJitterBuffer _jitterBuffer;
+    private IPEndPoint? _lastRemoteEndPoint;
+    private VideoStream? _frameTarget;
+    private int _lastMediaPayloadType = -1;
+    private byte[] _rtxBuffer = Array.Empty<byte>();
+    private readonly RtpFecDecoder? _fecDecoder;
+    private long _fecReceivedTimestampNs;
+
     public VideoStream(
         RtpSessionConfig config,
         int index,
@@ -22,6 +36,13 @@ internal class VideoStream
         RtpSessionConfig = config;
         this.Index = index;
         _logger = logger;
+        _jitterBuffer = CreateJitterBuffer();
+
+        if (config.UlpfecPayloadType != 0 || config.FlexfecPayloadType != 0)
+        {
+            _fecDecoder = new RtpFecDecoder(config.UlpfecPayloadType, config.FlexfecPayloadType);
+            _fecDecoder.OnPacketRecovered += OnFecPacketRecovered;
+        }
     }
 
     /// <summary>
@@ -31,12 +52,47 @@ internal class VideoStream
     /// <remarks>
     ///  - Received from end point,
     ///  - The frame timestamp,
-    ///  - The encoded video frame payload.
-    ///  - The video format of the encoded frame.
+    ///  - The encoded video frame, pooled. The handler owns it and must dispose it once consumed.
     /// </remarks>
-    public event Action<int, IPEndPoint, uint, byte[]>? OnVideoFrameReceivedByIndex;
+    public event Action<int, IPEndPoint, uint, EncodedFrame>? OnVideoFrameReceivedByIndex;
+
+    /// <summary>
+    /// Reception statistics (loss, reordering, jitter) of the current remote source.
+    /// </summary>
+    public RtpReceptionStatistics ReceptionStatistics => _jitterBuffer.Statistics;
+
+    /// <summary>
+    /// Number of frames passed on although some of their packets were lost.
+    /// </summary>
+    public int DamagedFrames => _rtpVideoFramer?.DamagedFrames ?? 0;
+
+    /// <summary>
+    /// Number of RFC 4588 retransmission packets unwrapped and fed into the jitter buffer.
+    /// </summary>
+    public int RetransmittedPackets { get; private set; }
+
+    /// <summary>
+    /// Number of lost packets recovered from ULPFEC or FlexFEC repair packets.
+    /// </summary>
+    public int FecRecoveredPackets => _fecDecoder?.RecoveredPackets ?? 0;
+
+    /// <summary>
+    /// Number of ULPFEC or FlexFEC repair packets received.
+    /// </summary>
+    public int FecRepairPackets => _fecDecoder?.RepairPacketsReceived ?? 0;
+
+    /// <summary>
+    /// Fires on the receive thread as soon as a sequence gap is seen, before the packets are given up on.
+    /// </summary>
+    public event RtpGapDetectedDelegate? OnPacketsMissing;
+
+    /// <summary>
+    /// Fires on the receive thread when the jitter buffer gave up waiting for packets. The argument is the number
+    /// of packets skipped.
+    /// </summary>
+    public event Action<int>? OnPacketsLost;
 
-    private void ProcessVideoRtpFrame(IPEndPoint endpoint, RTPPacket packet, VideoCodecsEnum codec)
+    private void ProcessVideoRtpFrame(IPEndPoint endpoint, RTPHeader header, ReadOnlySpan<byte> payload, VideoCodecsEnum codec)
     {
         if (OnVideoFrameReceivedByIndex == null)
         {
@@ -45,26 +101,19 @@ internal class VideoStream
 
         if (_rtpVideoFramer != null)
         {
-            var frame = _rtpVideoFramer.GotRtpPacket(packet);
-            if (frame != null)
-            {
-                OnVideoFrameReceivedByIndex?.Invoke(Index, endpoint, packet.Header.Timestamp, frame);
-            }
+            _rtpVideoFramer.GotRtpPacket(header, payload);
         }
         else
         {
             if (codec == VideoCodecsEnum.VP8 ||
                 codec == VideoCodecsEnum.H264)
             {
-                _logger.LogDebug("Video depacketisation codec set to {Codec} for SSRC {SyncSource}.", codec, packet.Header.SyncSource);
+                _logger.LogDebug("Video depacketisation codec set to {Codec} for SSRC {SyncSource}.", codec, header.SyncSource);
 
                 _rtpVideoFramer = new RtpVideoFramer(codec, _maxReconstructedVideoFrameSize);
+                _rtpVideoFramer.OnFrameReady += RaiseOnVideoFrameReceivedByIndex;
 
-                var frame = _rtpVideoFramer.GotRtpPacket(packet);
-                if (frame != null)
-                {
-                    OnVideoFrameReceivedByIndex?.Invoke(Index, endpoint, packet.Header.Timestamp, frame);
-                }
+                _rtpVideoFramer.GotRtpPacket(header, payload);
             }
             else
             {
@@ -180,10 +229,14 @@ internal class VideoStream
 
     #endregion PROPERTIES
 
-    public bool EnsureBufferUnprotected(byte[] buf, RTPHeader header, out RTPPacket packet)
+    /// <summary>
+    /// Parses the header of a packet. SRTP is already removed in place by <see cref="Receiver"/> before packets reach
+    /// the stream, so there is nothing left to unprotect here.
+    /// </summary>
+    public bool EnsureBufferUnprotected(ReadOnlySpan<byte> buf, DateTime receivedTime, out RTPHeader header)
     {
-        packet = new RTPPacket(buf);
-        packet.Header.ReceivedTime = header.ReceivedTime;
+        header = new RTPHeader(buf);
+        header.ReceivedTime = receivedTime;
         return true;
     }
 
@@ -192,9 +245,8 @@ internal class VideoStream
         this.rtpChannel = rtpChannel;
     }
 
-    public void OnReceiveRTPPacket(RTPHeader hdr, int localPort, IPEndPoint remoteEndPoint, byte[] buffer, VideoStream videoStream = null)
+    public void OnReceiveRTPPacket(RTPHeader hdr, int localPort, IPEndPoint remoteEndPoint, ReadOnlySpan<byte> buffer, long receivedTimestampNs, VideoStream videoStream = null)
     {
-        RTPPacket? rtpPacket = null;
         //if (RemoteRtpEventPayloadID != 0 && hdr.PayloadType == RemoteRtpEventPayloadID)
         //{
         //    if (!EnsureBufferUnprotected(buffer, hdr, out rtpPacket))
@@ -237,13 +289,148 @@ internal class VideoStream
         // For video RTP packets an attempt will be made to collate into frames. It's up to the application
         // whether it wants to subscribe to frames of RTP packets.
 
-        rtpPacket = null;
         if (RemoteTrack != null)
         {
             LogIfWrongSeqNumber($"", hdr, RemoteTrack);
             ProcessHeaderExtensions(hdr);
         }
-        if (!EnsureBufferUnprotected(buffer, hdr, out rtpPacket))
+
+        if (_fecDecoder != null && _fecDecoder.IsRepairPayloadType(hdr.PayloadType))
+        {
+            OnReceiveRepairPacket(hdr, buffer, receivedTimestampNs);
+            return;
+        }
+
+        if (RtpSessionConfig.RtxPayloadType != 0 && hdr.PayloadType == RtpSessionConfig.RtxPayloadType)
+        {
+            if (!TryUnwrapRetransmission(ref hdr, ref buffer))
+            {
+                return;
+            }
+        }
+        else
+        {
+            _lastMediaPayloadType = hdr.PayloadType;
+        }
+
+        if (_jitterBuffer.Statistics.PacketsReceived > 0 && _jitterBuffer.Statistics.Ssrc != hdr.SyncSource)
+        {
+            // New source, its sequence numbers are unrelated to the old ones.
+            _logger.LogDebug($"RTP source changed from SSRC {_jitterBuffer.Statistics.Ssrc} to {hdr.SyncSource}, resetting jitter buffer.");
+            _jitterBuffer.Flush();
+            _jitterBuffer = CreateJitterBuffer();
+            _fecDecoder?.Reset();
+        }
+
+        _jitterBuffer.Statistics.Ssrc = hdr.SyncSource;
+        _lastRemoteEndPoint = remoteEndPoint;
+        _frameTarget = videoStream;
+        _fecDecoder?.AddMediaPacket(buffer, hdr.SequenceNumber);
+        _jitterBuffer.Insert(buffer, hdr.SequenceNumber, hdr.Timestamp, receivedTimestampNs);
+
+        if (_fecDecoder != null && _jitterBuffer.Count > 0 && _fecDecoder.PendingRepairPackets > 0)
+        {
+            // Packets are held behind a gap, this packet may have completed a repair packet for it.
+            _fecReceivedTimestampNs = receivedTimestampNs;
+            _fecDecoder.Recover();
+        }
+    }
+
+    /// <summary>
+    /// Hands an ULPFEC or FlexFEC repair packet to the FEC decoder. Recovered packets go into the jitter buffer in
+    /// place of the lost ones, so recovery has to happen within <see cref="RtpSessionConfig.JitterBufferLatency"/>.
+    /// </summary>
+    private void OnReceiveRepairPacket(RTPHeader hdr, ReadOnlySpan<byte> buffer, long receivedTimestampNs)
+    {
+        _fecReceivedTimestampNs = receivedTimestampNs;
+        _fecDecoder!.AddRepairPacket(hdr, buffer);
+
+        if (_jitterBuffer.Statistics.PacketsReceived > 0 && hdr.SyncSource == _jitterBuffer.Statistics.Ssrc)
+        {
+            // Repair packets sent in the media's own sequence number space fill their slot so the jitter buffer sees
+            // no gap. They are dropped on release as their payload type has no codec.
+            _jitterBuffer.Insert(buffer, hdr.SequenceNumber, hdr.Timestamp, receivedTimestampNs);
+        }
+    }
+
+    private void OnFecPacketRecovered(ReadOnlySpan<byte> packet, ushort sequenceNumber, uint rtpTimestamp)
+    {
+        _jitterBuffer.Insert(packet, sequenceNumber, rtpTimestamp, _fecReceivedTimestampNs);
+    }
+
+    /// <summary>
+    /// Restores the original packet from an RFC 4588 retransmission: the original sequence number is taken from the
+    /// first two payload bytes, payload type and SSRC from the media stream.
+    /// </summary>
+    private bool TryUnwrapRetransmission(ref RTPHeader hdr, ref ReadOnlySpan<byte> buffer)
+    {
+        // A zero length RTX payload is padding sent for bandwidth probing.
+        if (hdr.PayloadSize < 2 || _lastMediaPayloadType < 0)
+        {
+            return false;
+        }
+
+        int headerLength = hdr.Length;
+        int payloadLength = hdr.PayloadSize - 2;
+        if (_rtxBuffer.Length < headerLength + payloadLength)
+        {
+            _rtxBuffer = new byte[headerLength + payloadLength];
+        }
+
+        ushort originalSequenceNumber = BinaryPrimitives.ReadUInt16BigEndian(buffer.Slice(headerLength));
+        buffer.Slice(0, headerLength).CopyTo(_rtxBuffer);
+        buffer.Slice(headerLength + 2, payloadLength).CopyTo(_rtxBuffer.AsSpan(headerLength));
+
+        _rtxBuffer[0] &= 0xDF; // the padding was dropped
+        _rtxBuffer[1] = (byte)((_rtxBuffer[1] & 0x80) | _lastMediaPayloadType);
+        BinaryPrimitives.WriteUInt16BigEndian(_rtxBuffer.AsSpan(2), originalSequenceNumber);
+        BinaryPrimitives.WriteUInt32BigEndian(_rtxBuffer.AsSpan(8), _jitterBuffer.Statistics.Ssrc);
+
+        var receivedTime = hdr.ReceivedTime;
+        buffer = _rtxBuffer.AsSpan(0, headerLength + payloadLength);
+        hdr = new RTPHeader(buffer);
+        hdr.ReceivedTime = receivedTime;
+        RetransmittedPackets++;
+        return true;
+    }
+
+    /// <summary>
+    /// Gives the jitter buffer a chance to release held packets whose deadline passed while nothing was received.
+    /// </summary>
+    /// <param name="nowNs">Current time on the clock of the packet timestamps, nanoseconds since the Unix epoch.</param>
+    public void OnReceiveIdle(long nowNs)
+    {
+        _jitterBuffer.Poll(nowNs);
+    }
+
+    private RtpJitterBuffer CreateJitterBuffer()
+    {
+        var jitterBuffer = new RtpJitterBuffer(
+            RtpSessionConfig.JitterBufferCapacity,
+            RtpSessionConfig.JitterBufferLatency,
+            RtpSessionConfig.JitterBufferGapTimeout,
+            VIDEO_CLOCK_RATE);
+        jitterBuffer.OnPacketReleased += OnJitterBufferPacketReleased;
+        jitterBuffer.OnPacketsLost += OnJitterBufferPacketsLost;
+        jitterBuffer.OnGapDetected += OnJitterBufferGapDetected;
+        return jitterBuffer;
+    }
+
+    private void OnJitterBufferPacketsLost(int count)
+    {
+        _logger.LogDebug($"Gave up waiting for {count} RTP packet(s), {_jitterBuffer.Statistics}.");
+        _rtpVideoFramer?.NotifyPacketLoss();
+        OnPacketsLost?.Invoke(count);
+    }
+
+    private void OnJitterBufferGapDetected(ushort firstMissingSequenceNumber, int count)
+    {
+        OnPacketsMissing?.Invoke(firstMissingSequenceNumber, count);
+    }
+
+    private void OnJitterBufferPacketReleased(ReadOnlySpan<byte> buffer, long receivedTimestampNs)
+    {
+        if (!EnsureBufferUnprotected(buffer, DateTime.UnixEpoch.AddTicks(receivedTimestampNs / 100), out var header))
         {
             return;
         }
@@ -251,23 +438,45 @@ internal class VideoStream
         // When receiving an Payload from other peer, it will be related to our LocalDescription,
         // not to RemoteDescription (as proved by Azure WebRTC Implementation)
         // TODO: Buldo
-        var codec = GetFormatForPayloadID(hdr.PayloadType);
-        if (rtpPacket != null && codec != null)
+        var codec = GetFormatForPayloadID(header.PayloadType);
+        if (codec != null)
         {
-            videoStream?.ProcessVideoRtpFrame(remoteEndPoint, rtpPacket, codec.Value);
-            RaiseOnRtpPacketReceivedByIndex(remoteEndPoint, rtpPacket);
+            // The payload is handed on as a slice of the datagram, the framer copies it once into the frame arena.
+            _frameTarget?.ProcessVideoRtpFrame(_lastRemoteEndPoint!, header, buffer.Slice(header.Length, header.PayloadSize), codec.Value);
+
+            if (OnRtpPacketReceivedByIndex != null)
+            {
+                RaiseOnRtpPacketReceivedByIndex(_lastRemoteEndPoint!, new RTPPacket(buffer) { Header = { ReceivedTime = header.ReceivedTime } });
+            }
         }
     }
     private VideoCodecsEnum? GetFormatForPayloadID(int hdrPayloadType)
     {
-        if (hdrPayloadType == 97 || hdrPayloadType == 96)
+        if (RtpSessionConfig.PayloadTypeCodecs.TryGetValue(hdrPayloadType, out var codec))
         {
-            return VideoCodecsEnum.H264;
+            return codec;
+        }
+
+        if (hdrPayloadType >= 96 && hdrPayloadType <= 127 && hdrPayloadType != RtpSessionConfig.RtxPayloadType &&
+            hdrPayloadType != RtpSessionConfig.UlpfecPayloadType && hdrPayloadType != RtpSessionConfig.FlexfecPayloadType)
+        {
+            return RtpSessionConfig.DefaultVideoCodec;
         }
 
         return null;
     }
 
+    private void RaiseOnVideoFrameReceivedByIndex(EncodedFrame frame)
+    {
+        if (OnVideoFrameReceivedByIndex == null)
+        {
+            frame.Dispose();
+            return;
+        }
+
+        OnVideoFrameReceivedByIndex.Invoke(Index, _lastRemoteEndPoint!, frame.Timestamp, frame);
+    }
+
     private void RaiseOnRtpPacketReceivedByIndex(IPEndPoint ipEndPoint, RTPPacket rtpPacket)
     {
         OnRtpPacketReceivedByIndex?.Invoke(Index, ipEndPoint, rtpPacket);
@@ -295,7 +504,8 @@ internal class VideoStream
             {
                 if (pendingPackage != null)
                 {
-                    OnReceiveRTPPacket(pendingPackage.hdr, pendingPackage.localPort, pendingPackage.remoteEndPoint, pendingPackage.buffer, pendingPackage.videoStream);
+                    long receivedTimestampNs = (pendingPackage.hdr.ReceivedTime - DateTime.UnixEpoch).Ticks * 100;
+                    OnReceiveRTPPacket(pendingPackage.hdr, pendingPackage.localPort, pendingPackage.remoteEndPoint, pendingPackage.buffer, receivedTimestampNs, pendingPackage.videoStream);
                 }
             }
         }
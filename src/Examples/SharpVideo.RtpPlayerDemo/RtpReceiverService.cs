@@ -3,40 +3,173 @@ using System.Net;
 using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
 using SharpVideo.RtpPlayerDemo.Rtp;
+using SharpVideo.Srtp;
 
 namespace SharpVideo.RtpPlayerDemo;
 
 /// <summary>
-/// Service wrapper for RTP receiver that provides H.264 NAL units to decoder
+/// Service wrapper for RTP receiver that provides reassembled H.264 frames to decoders.
+/// Every RTP stream (port and SSRC) gets its own frame queue, see <see cref="Streams"/>.
+/// The service itself is a frame source for the primary stream, for single stream players.
 /// </summary>
 [SupportedOSPlatform("linux")]
-public class RtpReceiverService : IDisposable
+public class RtpReceiverService : IEncodedFrameSource, IDisposable
 {
+    /// <summary>
+    /// The primary stream is replaced by another stream once it delivered no frame for this long
+    /// </summary>
+    private const int PRIMARY_STREAM_SWITCH_TIMEOUT_MS = 1000;
+
     private readonly Receiver _receiver;
     private readonly ILogger<RtpReceiverService> _logger;
-    private readonly BlockingCollection<byte[]> _nalUnitsQueue = new(boundedCapacity: 30);
+    private readonly ConcurrentDictionary<int, ReceivedVideoStream> _streams = new();
+    private readonly int _queueCapacity;
+    private readonly RtpReceptionStatistics _emptyStatistics = new(90000);
     private readonly CancellationTokenSource _cts = new();
+    private volatile ReceivedVideoStream? _primaryStream;
+    private volatile Func<EncodedFrame, bool>? _frameConsumer;
+    private readonly object _frameConsumerLock = new();
+    private int _removedStreamsReceivedFrames;
+    private int _removedStreamsDroppedFrames;
     private bool _disposed;
 
-    public RtpReceiverService(IPEndPoint bindEndPoint, ILoggerFactory loggerFactory)
+    public RtpReceiverService(IPEndPoint bindEndPoint, ILoggerFactory loggerFactory, bool enableUdpGro = false)
+        : this(new[] { bindEndPoint }, loggerFactory, enableUdpGro)
+    {
+    }
+
+    /// <param name="bindEndPoints">Local end points to receive on, streams are demultiplexed by port and SSRC</param>
+    /// <param name="loggerFactory">Logger factory</param>
+    /// <param name="enableUdpGro">Request UDP_GRO on the RTP sockets</param>
+    /// <param name="queueCapacity">Frame queue capacity of every stream</param>
+    public RtpReceiverService(IReadOnlyList<IPEndPoint> bindEndPoints, ILoggerFactory loggerFactory, bool enableUdpGro = false, int queueCapacity = 30)
+        : this(bindEndPoints, loggerFactory, new RtpSocketOptions { EnableUdpGro = enableUdpGro }, queueCapacity)
+    {
+    }
+
+    /// <param name="bindEndPoints">Local end points to receive on, streams are demultiplexed by port and SSRC</param>
+    /// <param name="loggerFactory">Logger factory</param>
+    /// <param name="socketOptions">GRO, receive threads and multicast groups</param>
+    /// <param name="queueCapacity">Frame queue capacity of every stream</param>
+    public RtpReceiverService(IReadOnlyList<IPEndPoint> bindEndPoints, ILoggerFactory loggerFactory, RtpSocketOptions socketOptions, int queueCapacity = 30)
     {
         _logger = loggerFactory.CreateLogger<RtpReceiverService>();
+        _queueCapacity = queueCapacity;
         var receiverLogger = loggerFactory.CreateLogger<Receiver>();
-        _receiver = new Receiver(bindEndPoint, receiverLogger);
-        _receiver.OnVideoFrameReceivedByIndex += OnVideoFrameReceived;
+        _receiver = new Receiver(bindEndPoints, receiverLogger, socketOptions);
+        _receiver.OnStreamAdded += OnStreamAdded;
+        _receiver.OnStreamRemoved += OnStreamRemoved;
+        _receiver.OnVideoFrameReceived += OnVideoFrameReceived;
+
+        _logger.LogInformation("RTP receiver initialized on {EndPoints}", string.Join(", ", bindEndPoints));
+    }
+
+    /// <summary>
+    /// Raised on the receive thread when a new stream appears, before its first frame is queued
+    /// </summary>
+    public event Action<ReceivedVideoStream>? StreamAdded;
+
+    /// <summary>
+    /// Raised when a stream timed out. Its queue is completed, consumers drain it and stop
+    /// </summary>
+    public event Action<ReceivedVideoStream>? StreamRemoved;
+
+    /// <summary>
+    /// Streams currently received
+    /// </summary>
+    public ICollection<ReceivedVideoStream> Streams => _streams.Values;
+
+    /// <summary>
+    /// Stream read by <see cref="TryGetFrame"/>: the first stream, replaced when it stalls
+    /// </summary>
+    public ReceivedVideoStream? PrimaryStream => _primaryStream;
+
+    /// <summary>
+    /// Total number of received frames over all streams
+    /// </summary>
+    public int ReceivedFramesCount => _removedStreamsReceivedFrames + _streams.Values.Sum(s => s.ReceivedFramesCount);
+
+    /// <summary>
+    /// Number of frames dropped due to queue overflow over all streams
+    /// </summary>
+    public int DroppedFramesCount => _removedStreamsDroppedFrames + _streams.Values.Sum(s => s.DroppedFramesCount);
+
+    /// <summary>
+    /// Number of packets that could not be assigned to a stream
+    /// </summary>
+    public int RejectedPacketsCount => _receiver.RejectedPackets;
+
+    /// <summary>
+    /// Number of SRTP/SRTCP packets dropped because they failed authentication or were replayed
+    /// </summary>
+    public int SrtpRejectedPacketsCount => _receiver.SrtpRejectedPackets;
+
+    /// <summary>
+    /// The underlying receiver, e.g. for an RTSP client that delivers interleaved packets
+    /// </summary>
+    internal Receiver Receiver => _receiver;
+
+    /// <summary>
+    /// Number of frames of the primary stream passed on with some of their RTP packets missing
+    /// </summary>
+    public int DamagedFramesCount => _primaryStream?.Stream.DamagedFrames ?? 0;
+
+    /// <summary>
+    /// RTP packet loss, reordering and jitter statistics of the primary stream
+    /// </summary>
+    public RtpReceptionStatistics ReceptionStatistics => _primaryStream?.Stream.ReceptionStatistics ?? _emptyStatistics;
+
+    /// <summary>
+    /// Number of RTCP NACK packets sent for the primary stream
+    /// </summary>
+    public int NacksSentCount => _primaryStream?.Stream.NacksSent ?? 0;
+
+    /// <summary>
+    /// Number of retransmitted packets received on the primary stream
+    /// </summary>
+    public int RetransmittedPacketsCount => _primaryStream?.Stream.RetransmittedPackets ?? 0;
+
+    /// <summary>
+    /// Number of lost packets of the primary stream recovered from FEC repair packets
+    /// </summary>
+    public int FecRecoveredPacketsCount => _primaryStream?.Stream.FecRecoveredPackets ?? 0;
+
+    /// <summary>
+    /// Number of FEC repair packets received for the primary stream
+    /// </summary>
+    public int FecRepairPacketsCount => _primaryStream?.Stream.FecRepairPackets ?? 0;
+
+    /// <summary>
+    /// Number of RTCP PLI/FIR key frame requests sent for the primary stream
+    /// </summary>
+    public int KeyFrameRequestsCount => _primaryStream?.Stream.KeyFrameRequestsSent ?? 0;
 
-        _logger.LogInformation("RTP receiver initialized on {EndPoint}", bindEndPoint);
+    /// <summary>
+    /// Assign a codec to an RTP payload type. Must be called before <see cref="Start"/>
+    /// </summary>
+    public void MapPayloadType(int payloadType, VideoCodecsEnum codec)
+    {
+        _receiver.MapPayloadType(payloadType, codec);
     }
 
     /// <summary>
-    /// Total number of received frames
+    /// Recover lost packets from ULPFEC and/or FlexFEC repair packets, 0 for a scheme that is not used. Must be called
+    /// before <see cref="Start"/>
     /// </summary>
-    public int ReceivedFramesCount { get; private set; }
+    public void EnableFec(int ulpfecPayloadType, int flexfecPayloadType)
+    {
+        _receiver.EnableFec(ulpfecPayloadType, flexfecPayloadType);
+    }
 
     /// <summary>
-    /// Number of frames dropped due to queue overflow
+    /// Require SRTP protected RTP and RTCP. Must be called before <see cref="Start"/>
     /// </summary>
-    public int DroppedFramesCount { get; private set; }
+    /// <param name="receivePolicy">Keys of the sender</param>
+    /// <param name="sendPolicy">Keys for the RTCP we send, defaults to the keys of the sender</param>
+    public void EnableSrtp(SrtpPolicy receivePolicy, SrtpPolicy? sendPolicy = null)
+    {
+        _receiver.EnableSrtp(receivePolicy, sendPolicy);
+    }
 
     /// <summary>
     /// Start receiving RTP packets
@@ -48,47 +181,112 @@ public class RtpReceiverService : IDisposable
     }
 
     /// <summary>
-    /// Try to get next NAL unit from queue
+    /// Record all received RTP and RTCP datagrams with their kernel timestamps to a pcap file
     /// </summary>
-    public bool TryGetNalUnit(out byte[] nalUnit, CancellationToken cancellationToken)
+    public void StartCapture(string path)
     {
-        nalUnit = null!;
-        try
-        {
-            return _nalUnitsQueue.TryTake(out nalUnit!, 100, cancellationToken);
-        }
-        catch (OperationCanceledException)
+        _receiver.StartCapture(path);
+    }
+
+    /// <summary>
+    /// Stop a capture started with <see cref="StartCapture"/>
+    /// </summary>
+    public void StopCapture()
+    {
+        _receiver.StopCapture();
+    }
+
+    /// <summary>
+    /// Ask the sender of the primary stream for a key frame, e.g. after the decoder lost a reference picture
+    /// </summary>
+    public void RequestKeyFrame()
+    {
+        _primaryStream?.RequestKeyFrame();
+    }
+
+    /// <summary>
+    /// Try to get next frame of the primary stream. The caller owns the frame and must dispose it once its NAL units were consumed.
+    /// </summary>
+    public bool TryGetFrame(out EncodedFrame frame, CancellationToken cancellationToken)
+    {
+        var primary = _primaryStream;
+        if (primary != null)
         {
-            return false;
+            return primary.TryGetFrame(out frame, cancellationToken);
         }
+
+        // Nothing received yet
+        frame = null!;
+        cancellationToken.WaitHandle.WaitOne(100);
+        return false;
+    }
+
+    /// <summary>
+    /// Hand the frames of the primary stream to <paramref name="consumer"/> on the receive thread, bypassing the queue.
+    /// Streams on different ports are received on different threads, so calls are serialised for the consumer
+    /// </summary>
+    public void SetFrameConsumer(Func<EncodedFrame, bool>? consumer)
+    {
+        _frameConsumer = consumer;
+    }
+
+    private void OnStreamAdded(RtpReceiveStream stream)
+    {
+        var receivedStream = new ReceivedVideoStream(stream, _queueCapacity, _logger);
+        _streams[stream.Index] = receivedStream;
+
+        _logger.LogInformation("RTP stream added: {Stream}", stream);
+        StreamAdded?.Invoke(receivedStream);
     }
 
-    private void OnVideoFrameReceived(int streamIndex, IPEndPoint remoteEndPoint, uint timestamp, byte[] nalUnit)
+    private void OnStreamRemoved(RtpReceiveStream stream)
     {
-        ReceivedFramesCount++;
+        if (!_streams.TryRemove(stream.Index, out var receivedStream))
+            return;
+
+        Interlocked.Add(ref _removedStreamsReceivedFrames, receivedStream.ReceivedFramesCount);
+        Interlocked.Add(ref _removedStreamsDroppedFrames, receivedStream.DroppedFramesCount);
+        receivedStream.Complete();
+
+        _logger.LogInformation("RTP stream removed: {Stream}", stream);
+        StreamRemoved?.Invoke(receivedStream);
+    }
+
+    private void OnVideoFrameReceived(RtpReceiveStream stream, EncodedFrame frame)
+    {
+        if (_disposed || !_streams.TryGetValue(stream.Index, out var receivedStream))
+        {
+            frame.Dispose();
+            return;
+        }
 
         if (_logger.IsEnabled(LogLevel.Debug))
         {
-            _logger.LogDebug("Received RTP frame: stream={Stream}, remote={Remote}, timestamp={Timestamp}, size={Size}",
-                streamIndex, remoteEndPoint, timestamp, nalUnit.Length);
+            _logger.LogDebug("Received RTP frame: stream={Stream}, remote={Remote}, timestamp={Timestamp}, size={Size}, nalus={NaluCount}",
+                stream.Index, stream.RemoteEndPoint, frame.Timestamp, frame.Length, frame.NalUnitCount);
         }
 
-        // Try to add to queue without blocking
-        if (!_nalUnitsQueue.TryAdd(nalUnit, 0))
+        var primary = _primaryStream;
+        if (primary != receivedStream &&
+            (primary == null || primary.IsCompleted || Environment.TickCount64 - primary.LastFrameTicks > PRIMARY_STREAM_SWITCH_TIMEOUT_MS))
         {
-            DroppedFramesCount++;
-            if (_logger.IsEnabled(LogLevel.Warning))
-            {
-                _logger.LogWarning("NAL unit queue full, dropping frame (total dropped: {Count})", DroppedFramesCount);
-            }
+            _logger.LogInformation("Primary RTP stream is now {Stream}", stream);
+            _primaryStream = receivedStream;
         }
-        else
+
+        var consumer = _frameConsumer;
+        if (consumer != null && receivedStream == _primaryStream)
         {
-            if (_logger.IsEnabled(LogLevel.Trace))
+            // Uncontended except for the moment the primary stream moves to another port
+            lock (_frameConsumerLock)
             {
-                _logger.LogTrace("Frame queued successfully, queue size: {Size}", _nalUnitsQueue.Count);
+                receivedStream.Enqueue(frame, consumer);
             }
+
+            return;
         }
+
+        receivedStream.Enqueue(frame);
     }
 
     public void Dispose()
@@ -98,8 +296,11 @@ public class RtpReceiverService : IDisposable
 
         _disposed = true;
         _cts.Cancel();
-        _nalUnitsQueue.CompleteAdding();
-        _nalUnitsQueue.Dispose();
+        _receiver.Close();
+        foreach (var stream in _streams.Values)
+        {
+            stream.Dispose();
+        }
         _cts.Dispose();
 
         _logger.LogInformation("RTP receiver service disposed");
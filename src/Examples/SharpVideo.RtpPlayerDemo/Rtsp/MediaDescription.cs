@@ -0,0 +1,201 @@
+using System.Globalization;
+using SharpVideo.RtpPlayerDemo.Rtp;
+
+namespace SharpVideo.RtpPlayerDemo.Rtsp;
+
+/// <summary>
+/// One m= section of a session description.
+/// </summary>
+internal sealed class MediaDescription
+{
+    public const string CONTROL_ATTRIBUTE = "control:";
+    private const string RTPMAP_ATTRIBUTE = "rtpmap:";
+    private const string FMTP_ATTRIBUTE = "fmtp:";
+    private const string CRYPTO_ATTRIBUTE = "crypto:";
+
+    private readonly Dictionary<int, (string EncodingName, int ClockRate)> _rtpMaps = new();
+    private readonly Dictionary<int, Dictionary<string, string>> _formatParameters = new();
+    private readonly List<string> _cryptoAttributes = new();
+
+    private MediaDescription(string media, int port, string protocol, IReadOnlyList<int> payloadTypes)
+    {
+        Media = media;
+        Port = port;
+        Protocol = protocol;
+        PayloadTypes = payloadTypes;
+    }
+
+    /// <summary>
+    /// Media type, e.g. video or audio.
+    /// </summary>
+    public string Media { get; }
+
+    public int Port { get; }
+
+    /// <summary>
+    /// Transport protocol, e.g. RTP/AVP or RTP/SAVP.
+    /// </summary>
+    public string Protocol { get; }
+
+    public IReadOnlyList<int> PayloadTypes { get; }
+
+    /// <summary>
+    /// Control URL of the media, absolute or relative to the session base URL.
+    /// </summary>
+    public string? Control { get; private set; }
+
+    /// <summary>
+    /// SDES crypto attributes (RFC 4568) of an RTP/SAVP media, without the a=crypto: prefix.
+    /// </summary>
+    public IReadOnlyList<string> CryptoAttributes => _cryptoAttributes;
+
+    internal static MediaDescription Parse(string value)
+    {
+        // <media> <port>[/<number of ports>] <proto> <fmt> ...
+        var parts = value.Split(' ', StringSplitOptions.RemoveEmptyEntries);
+        if (parts.Length < 3)
+        {
+            throw new FormatException($"Invalid SDP media line: m={value}");
+        }
+
+        int.TryParse(parts[1].Split('/')[0], NumberStyles.None, CultureInfo.InvariantCulture, out int port);
+        var payloadTypes = new List<int>();
+        for (int i = 3; i < parts.Length; i++)
+        {
+            if (int.TryParse(parts[i], NumberStyles.None, CultureInfo.InvariantCulture, out int payloadType))
+            {
+                payloadTypes.Add(payloadType);
+            }
+        }
+
+        return new MediaDescription(parts[0], port, parts[2], payloadTypes);
+    }
+
+    internal void AddAttribute(string attribute)
+    {
+        if (attribute.StartsWith(CONTROL_ATTRIBUTE, StringComparison.Ordinal))
+        {
+            Control = attribute.Substring(CONTROL_ATTRIBUTE.Length);
+        }
+        else if (attribute.StartsWith(RTPMAP_ATTRIBUTE, StringComparison.Ordinal))
+        {
+            // rtpmap:<payload type> <encoding name>/<clock rate>[/<encoding parameters>]
+            var (payloadType, rest) = SplitPayloadType(attribute.Substring(RTPMAP_ATTRIBUTE.Length));
+            var encoding = rest.Split('/');
+            int.TryParse(encoding.ElementAtOrDefault(1), NumberStyles.None, CultureInfo.InvariantCulture, out int clockRate);
+            if (payloadType >= 0)
+            {
+                _rtpMaps[payloadType] = (encoding[0], clockRate);
+            }
+        }
+        else if (attribute.StartsWith(FMTP_ATTRIBUTE, StringComparison.Ordinal))
+        {
+            // fmtp:<payload type> <name>=<value>;<name>=<value>
+            var (payloadType, rest) = SplitPayloadType(attribute.Substring(FMTP_ATTRIBUTE.Length));
+            if (payloadType < 0)
+            {
+                return;
+            }
+
+            var parameters = new Dictionary<string, string>(StringComparer.OrdinalIgnoreCase);
+            foreach (var parameter in rest.Split(';', StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries))
+            {
+                int equals = parameter.IndexOf('=');
+                if (equals > 0)
+                {
+                    parameters[parameter.Substring(0, equals).Trim()] = parameter.Substring(equals + 1).Trim();
+                }
+            }
+
+            _formatParameters[payloadType] = parameters;
+        }
+        else if (attribute.StartsWith(CRYPTO_ATTRIBUTE, StringComparison.Ordinal))
+        {
+            _cryptoAttributes.Add(attribute.Substring(CRYPTO_ATTRIBUTE.Length));
+        }
+    }
+
+    /// <summary>
+    /// Codec of a payload type from its rtpmap, or from the static payload types of RFC 3551.
+    /// </summary>
+    public VideoCodecsEnum GetCodec(int payloadType)
+    {
+        if (!_rtpMaps.TryGetValue(payloadType, out var rtpMap))
+        {
+            return payloadType switch
+            {
+                26 => VideoCodecsEnum.JPEG,
+                31 => VideoCodecsEnum.H261,
+                32 => VideoCodecsEnum.MPV,
+                33 => VideoCodecsEnum.MP2T,
+                34 => VideoCodecsEnum.H263,
+                _ => VideoCodecsEnum.Unknown,
+            };
+        }
+
+        return rtpMap.EncodingName.ToUpperInvariant() switch
+        {
+            "H264" => VideoCodecsEnum.H264,
+            "H265" => VideoCodecsEnum.H265,
+            "VP8" => VideoCodecsEnum.VP8,
+            "VP9" => VideoCodecsEnum.VP9,
+            "JPEG" => VideoCodecsEnum.JPEG,
+            "MP2T" => VideoCodecsEnum.MP2T,
+            _ => VideoCodecsEnum.Unknown,
+        };
+    }
+
+    /// <summary>
+    /// Encoding name of a payload type from its rtpmap, e.g. ulpfec, or null.
+    /// </summary>
+    public string? GetEncodingName(int payloadType)
+    {
+        return _rtpMaps.TryGetValue(payloadType, out var rtpMap) ? rtpMap.EncodingName : null;
+    }
+
+    /// <summary>
+    /// Value of a format parameter (fmtp) of a payload type, or null.
+    /// </summary>
+    public string? GetFormatParameter(int payloadType, string name)
+    {
+        return _formatParameters.TryGetValue(payloadType, out var parameters) ? parameters.GetValueOrDefault(name) : null;
+    }
+
+    /// <summary>
+    /// H.264 SPS and PPS NAL units from the sprop-parameter-sets of a payload type (RFC 6184 8.1), without start codes.
+    /// </summary>
+    public IReadOnlyList<byte[]> GetH264ParameterSets(int payloadType)
+    {
+        var value = GetFormatParameter(payloadType, "sprop-parameter-sets");
+        if (string.IsNullOrEmpty(value))
+        {
+            return Array.Empty<byte[]>();
+        }
+
+        var parameterSets = new List<byte[]>();
+        foreach (var parameterSet in value.Split(',', StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries))
+        {
+            parameterSets.Add(Convert.FromBase64String(parameterSet));
+        }
+
+        return parameterSets;
+    }
+
+    /// <summary>
+    /// H.264 packetization-mode of a payload type (RFC 6184 8.1): 0 single NAL unit, 1 non-interleaved,
+    /// 2 interleaved. Defaults to 0.
+    /// </summary>
+    public int GetH264PacketizationMode(int payloadType)
+    {
+        var value = GetFormatParameter(payloadType, "packetization-mode");
+        return int.TryParse(value, NumberStyles.None, CultureInfo.InvariantCulture, out int mode) ? mode : 0;
+    }
+
+    private static (int PayloadType, string Value) SplitPayloadType(string value)
+    {
+        int space = value.IndexOf(' ');
+        var payloadType = space < 0 ? value : value.Substring(0, space);
+        var rest = space < 0 ? string.Empty : value.Substring(space + 1).Trim();
+        return int.TryParse(payloadType, NumberStyles.None, CultureInfo.InvariantCulture, out int parsed) ? (parsed, rest) : (-1, rest);
+    }
+}
@@ -0,0 +1,771 @@
+using System.Buffers.Binary;
+using System.Globalization;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.Versioning;
+using System.Security.Cryptography;
+using System.Text;
+using Microsoft.Extensions.Logging;
+using SharpVideo.RtpPlayerDemo.Rtp;
+using SharpVideo.Srtp;
+
+namespace SharpVideo.RtpPlayerDemo.Rtsp;
+
+/// <summary>
+/// Minimal RTSP 1.0 client (RFC 2326) that pulls the H.264 video of a camera into a <see cref="Receiver"/>:
+/// OPTIONS, DESCRIBE, SETUP and PLAY with Basic or Digest authentication, keep-alive and TEARDOWN.
+/// </summary>
+/// <remarks>
+/// RTP is either sent by the server to the UDP ports of the receiver, or interleaved in the RTSP connection. A single
+/// thread reads the connection: interleaved packets are framed in place in its receive buffer and handed to the
+/// receiver as slices of it, so they reach the depacketiser without a copy just like datagrams from the UDP receive
+/// slab. Responses arriving between them complete the pending request. RTCP from the receiver goes back on the
+/// interleaved RTCP channel.
+///
+/// Call <see cref="SetupAsync"/> before the receiver is started and <see cref="PlayAsync"/> once the consumers of
+/// the stream are ready. The SPS/PPS of the SDP are available in <see cref="ParameterSets"/> after setup.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+internal sealed class RtspClient : IAsyncDisposable
+{
+    private const int DEFAULT_PORT = 554;
+    private const int RECEIVE_BUFFER_SIZE = 256 * 1024;
+    private const int SOCKET_RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+    private const int MAX_HEADER_LENGTH = 16 * 1024;
+    private const int INTERLEAVED_HEADER_LENGTH = 4;
+    private const int MAX_INTERLEAVED_SEND_LENGTH = 2048;
+    private const byte INTERLEAVED_MAGIC = (byte)'$';
+    private const int DEFAULT_SESSION_TIMEOUT_S = 60;
+    private const string USER_AGENT = "SharpVideo";
+    private static readonly TimeSpan REQUEST_TIMEOUT = TimeSpan.FromSeconds(10);
+    private static readonly TimeSpan TEARDOWN_TIMEOUT = TimeSpan.FromSeconds(1);
+
+    private readonly Uri _url;
+    private readonly NetworkCredential? _credential;
+    private readonly Receiver _receiver;
+    private readonly int _localPort;
+    private readonly RtspTransport _transport;
+    private readonly ILogger _logger;
+    private readonly Socket _socket;
+    private readonly object _sendLock = new();
+    private readonly SemaphoreSlim _requestLock = new(1, 1);
+
+    private Thread? _readThread;
+    private IPEndPoint? _remoteEndPoint;
+    private volatile TaskCompletionSource<RtspMessage>? _pendingResponse;
+    private int _pendingCSeq;
+    private int _cseq;
+    private string? _authenticationScheme;
+    private Dictionary<string, string>? _authenticationParameters;
+    private int _nonceCount;
+    private Uri _baseUrl;
+    private Uri? _aggregateUrl;
+    private string? _session;
+    private int _sessionTimeoutS = DEFAULT_SESSION_TIMEOUT_S;
+    private bool _supportsGetParameter;
+    private Timer? _keepAliveTimer;
+    private volatile bool _isInterleaved;
+    private byte _rtpChannel;
+    private byte _rtcpChannel = 1;
+    private volatile bool _isClosed;
+    private volatile bool _isTearingDown;
+    private int _interleavedPackets;
+    private int _discardedBytes;
+
+    /// <param name="url">rtsp://[user:password@]host[:port]/path of the camera.</param>
+    /// <param name="receiver">Receiver the RTP is delivered to.</param>
+    /// <param name="localPort">RTP port of the receiver the stream is received on; RTCP uses the next port.</param>
+    /// <param name="transport">UDP or interleaved TCP transport.</param>
+    /// <param name="logger">Logger.</param>
+    public RtspClient(Uri url, Receiver receiver, int localPort, RtspTransport transport, ILogger logger)
+    {
+        if (url.Scheme != "rtsp")
+        {
+            throw new ArgumentException($"Not an rtsp:// URL: {url}", nameof(url));
+        }
+
+        if (!string.IsNullOrEmpty(url.UserInfo))
+        {
+            var userInfo = url.UserInfo.Split(':', 2);
+            _credential = new NetworkCredential(Uri.UnescapeDataString(userInfo[0]),
+                userInfo.Length > 1 ? Uri.UnescapeDataString(userInfo[1]) : string.Empty);
+        }
+
+        // The credentials must not appear in the request lines.
+        _url = new UriBuilder(url) { UserName = string.Empty, Password = string.Empty, Port = url.IsDefaultPort ? DEFAULT_PORT : url.Port }.Uri;
+        _baseUrl = _url;
+        _receiver = receiver;
+        _localPort = localPort;
+        _transport = transport;
+        _logger = logger;
+        _socket = new Socket(SocketType.Stream, ProtocolType.Tcp)
+        {
+            NoDelay = true,
+            ReceiveBufferSize = SOCKET_RECEIVE_BUFFER_SIZE,
+        };
+    }
+
+    /// <summary>
+    /// The session description returned by DESCRIBE.
+    /// </summary>
+    public SessionDescription? SessionDescription { get; private set; }
+
+    /// <summary>
+    /// The media that was set up.
+    /// </summary>
+    public MediaDescription? VideoMedia { get; private set; }
+
+    /// <summary>
+    /// RTP payload type of the H.264 video.
+    /// </summary>
+    public int PayloadType { get; private set; }
+
+    /// <summary>
+    /// SPS and PPS NAL units from the sprop-parameter-sets of the SDP, without start codes.
+    /// </summary>
+    public IReadOnlyList<byte[]> ParameterSets { get; private set; } = Array.Empty<byte[]>();
+
+    /// <summary>
+    /// Keys of the server from the SDES crypto attribute of an RTP/SAVP media, null for plain RTP.
+    /// </summary>
+    public SrtpPolicy? SrtpPolicy { get; private set; }
+
+    /// <summary>
+    /// Number of RTP and RTCP packets received interleaved in the RTSP connection.
+    /// </summary>
+    public int InterleavedPacketsReceived => Volatile.Read(ref _interleavedPackets);
+
+    /// <summary>
+    /// Connects, describes the session and sets up its H.264 video. With TCP transport the receiver is switched to
+    /// the interleaved channels, so this must be called before the receiver is started.
+    /// </summary>
+    public async Task SetupAsync(CancellationToken cancellationToken)
+    {
+        await _socket.ConnectAsync(_url.Host, _url.Port, cancellationToken);
+        _remoteEndPoint = (IPEndPoint)_socket.RemoteEndPoint!;
+        _readThread = new Thread(ReadThreadProc) { Name = "RtspReadThread", IsBackground = true };
+        _readThread.Start();
+        _logger.LogInformation($"RTSP connected to {_remoteEndPoint}.");
+
+        var options = await SendRequestAsync("OPTIONS", _url, null, cancellationToken);
+        _supportsGetParameter = options.GetHeader("Public")?.Contains("GET_PARAMETER", StringComparison.OrdinalIgnoreCase) == true;
+
+        var describe = EnsureSuccess(await SendRequestAsync("DESCRIBE", _url, "Accept: application/sdp", cancellationToken), "DESCRIBE");
+        var contentBase = describe.GetHeader("Content-Base") ?? describe.GetHeader("Content-Location");
+        if (contentBase != null && Uri.TryCreate(contentBase, UriKind.Absolute, out var baseUrl))
+        {
+            _baseUrl = baseUrl;
+        }
+
+        SessionDescription = SessionDescription.Parse(describe.Body);
+        SelectVideoMedia(SessionDescription);
+        var media = VideoMedia!;
+
+        bool isSecure = media.Protocol.Contains("SAVP", StringComparison.Ordinal);
+        string profile = isSecure ? "RTP/SAVP" : "RTP/AVP";
+        string transport = _transport == RtspTransport.Tcp
+            ? $"{profile}/TCP;unicast;interleaved={_rtpChannel}-{_rtcpChannel}"
+            : $"{profile};unicast;client_port={_localPort}-{_localPort + 1}";
+
+        var setup = EnsureSuccess(await SendRequestAsync("SETUP", ResolveUrl(media.Control), $"Transport: {transport}", cancellationToken), "SETUP");
+        ParseSession(setup.GetHeader("Session"));
+        ParseTransport(setup.GetHeader("Transport"));
+
+        if (_transport == RtspTransport.Tcp)
+        {
+            _receiver.SetInterleavedSender(_localPort, SendInterleaved);
+            _isInterleaved = true;
+        }
+
+        var control = SessionDescription.Control;
+        _aggregateUrl = control == null || control == "*" ? _baseUrl : ResolveUrl(control);
+        _logger.LogInformation($"RTSP session {_session} set up, {_transport} transport, payload type {PayloadType}, " +
+                               $"packetization-mode {media.GetH264PacketizationMode(PayloadType)}, {ParameterSets.Count} parameter sets in SDP.");
+    }
+
+    /// <summary>
+    /// Starts the stream and keeps the session alive until the client is disposed.
+    /// </summary>
+    public async Task PlayAsync(CancellationToken cancellationToken)
+    {
+        if (_session == null)
+        {
+            throw new InvalidOperationException("The session has not been set up.");
+        }
+
+        EnsureSuccess(await SendRequestAsync("PLAY", _aggregateUrl!, "Range: npt=0.000-", cancellationToken), "PLAY");
+
+        // Refresh well before the server's session timeout.
+        var keepAliveInterval = TimeSpan.FromSeconds(Math.Max(_sessionTimeoutS / 2, 1));
+        _keepAliveTimer = new Timer(_ => _ = KeepAliveAsync(), null, keepAliveInterval, keepAliveInterval);
+        _logger.LogInformation($"RTSP playing {_url}.");
+    }
+
+    public async ValueTask DisposeAsync()
+    {
+        if (_keepAliveTimer != null)
+        {
+            await _keepAliveTimer.DisposeAsync();
+        }
+
+        if (_session != null && !_isClosed)
+        {
+            // Servers commonly close the connection right after answering TEARDOWN.
+            _isTearingDown = true;
+            try
+            {
+                using var cts = new CancellationTokenSource(TEARDOWN_TIMEOUT);
+                await SendRequestAsync("TEARDOWN", _aggregateUrl ?? _baseUrl, null, cts.Token);
+            }
+            catch (Exception excp) when (excp is OperationCanceledException or TimeoutException or IOException or SocketException)
+            {
+                _logger.LogDebug($"RTSP TEARDOWN failed. {excp.Message}");
+            }
+        }
+
+        _isClosed = true;
+        try
+        {
+            // Wakes the read thread blocked in Receive.
+            _socket.Shutdown(SocketShutdown.Both);
+        }
+        catch (SocketException)
+        {
+        }
+
+        _socket.Dispose();
+        _readThread?.Join();
+        _requestLock.Dispose();
+    }
+
+    /// <summary>
+    /// Enables recovery from ULPFEC or FlexFEC repair packets announced in the same media section.
+    /// </summary>
+    private void SelectFecPayloadTypes(MediaDescription media)
+    {
+        int ulpfecPayloadType = 0;
+        int flexfecPayloadType = 0;
+        foreach (var payloadType in media.PayloadTypes)
+        {
+            var encodingName = media.GetEncodingName(payloadType);
+            if (string.Equals(encodingName, "ulpfec", StringComparison.OrdinalIgnoreCase))
+            {
+                ulpfecPayloadType = payloadType;
+            }
+            else if (encodingName != null && encodingName.StartsWith("flexfec", StringComparison.OrdinalIgnoreCase))
+            {
+                flexfecPayloadType = payloadType;
+            }
+        }
+
+        if (ulpfecPayloadType != 0 || flexfecPayloadType != 0)
+        {
+            _receiver.EnableFec(ulpfecPayloadType, flexfecPayloadType);
+        }
+    }
+
+    private void SelectVideoMedia(SessionDescription sessionDescription)
+    {
+        foreach (var media in sessionDescription.Media)
+        {
+            if (media.Media != "video")
+            {
+                continue;
+            }
+
+            foreach (var payloadType in media.PayloadTypes)
+            {
+                if (media.GetCodec(payloadType) != VideoCodecsEnum.H264)
+                {
+                    continue;
+                }
+
+                VideoMedia = media;
+                PayloadType = payloadType;
+                ParameterSets = media.GetH264ParameterSets(payloadType);
+                _receiver.MapPayloadType(payloadType, VideoCodecsEnum.H264);
+                SelectFecPayloadTypes(media);
+
+                if (media.CryptoAttributes.Count > 0)
+                {
+                    SrtpPolicy = SrtpPolicy.Parse(media.CryptoAttributes[0]);
+                }
+
+                return;
+            }
+        }
+
+        throw new NotSupportedException("The RTSP session has no H.264 video media.");
+    }
+
+    private async Task KeepAliveAsync()
+    {
+        try
+        {
+            using var cts = new CancellationTokenSource(REQUEST_TIMEOUT);
+            var response = await SendRequestAsync(_supportsGetParameter ? "GET_PARAMETER" : "OPTIONS", _aggregateUrl ?? _baseUrl, null, cts.Token);
+            if (!response.IsSuccess)
+            {
+                _logger.LogWarning($"RTSP keep-alive failed: {response}.");
+            }
+        }
+        catch (Exception excp) when (!_isClosed)
+        {
+            _logger.LogWarning($"RTSP keep-alive failed. {excp.Message}");
+        }
+        catch
+        {
+            // Closed while sending.
+        }
+    }
+
+    private async Task<RtspMessage> SendRequestAsync(string method, Uri url, string? headers, CancellationToken cancellationToken)
+    {
+        await _requestLock.WaitAsync(cancellationToken);
+        try
+        {
+            var response = await SendRequestOnceAsync(method, url, headers, cancellationToken);
+
+            // Not only the first request is challenged: servers expire digest nonces (stale=true) during the session,
+            // e.g. on a keep-alive or PLAY. Each request is retried once with the new challenge.
+            if (response.StatusCode == 401 && _credential != null && TrySetChallenge(response))
+            {
+                response = await SendRequestOnceAsync(method, url, headers, cancellationToken);
+            }
+
+            return response;
+        }
+        finally
+        {
+            _requestLock.Release();
+        }
+    }
+
+    private async Task<RtspMessage> SendRequestOnceAsync(string method, Uri url, string? headers, CancellationToken cancellationToken)
+    {
+        int cseq = ++_cseq;
+        var request = new StringBuilder();
+        request.Append(CultureInfo.InvariantCulture, $"{method} {url} RTSP/1.0\r\n");
+        request.Append(CultureInfo.InvariantCulture, $"CSeq: {cseq}\r\n");
+        request.Append($"User-Agent: {USER_AGENT}\r\n");
+        if (_session != null)
+        {
+            request.Append($"Session: {_session}\r\n");
+        }
+
+        var authorization = GetAuthorization(method, url);
+        if (authorization != null)
+        {
+            request.Append($"Authorization: {authorization}\r\n");
+        }
+
+        if (headers != null)
+        {
+            request.Append(headers).Append("\r\n");
+        }
+
+        request.Append("\r\n");
+
+        var response = new TaskCompletionSource<RtspMessage>(TaskCreationOptions.RunContinuationsAsynchronously);
+        Volatile.Write(ref _pendingCSeq, cseq);
+        _pendingResponse = response;
+
+        if (!Send(Encoding.UTF8.GetBytes(request.ToString())))
+        {
+            throw new IOException($"Sending RTSP {method} failed, the connection is closed.");
+        }
+
+        try
+        {
+            return await response.Task.WaitAsync(REQUEST_TIMEOUT, cancellationToken);
+        }
+        finally
+        {
+            _pendingResponse = null;
+        }
+    }
+
+    private static RtspMessage EnsureSuccess(RtspMessage response, string method)
+    {
+        if (!response.IsSuccess)
+        {
+            throw new IOException($"RTSP {method} failed: {response}.");
+        }
+
+        return response;
+    }
+
+    /// <summary>
+    /// Resolves a control attribute against the base URL (RFC 2326 C.1.1).
+    /// </summary>
+    private Uri ResolveUrl(string? control)
+    {
+        if (string.IsNullOrEmpty(control) || control == "*")
+        {
+            return _baseUrl;
+        }
+
+        if (Uri.TryCreate(control, UriKind.Absolute, out var absolute) && absolute.Scheme == "rtsp")
+        {
+            return absolute;
+        }
+
+        var baseUrl = _baseUrl.ToString();
+        return new Uri(baseUrl.EndsWith('/') ? baseUrl + control : baseUrl + "/" + control);
+    }
+
+    private void ParseSession(string? session)
+    {
+        if (session == null)
+        {
+            throw new IOException("RTSP SETUP response has no Session header.");
+        }
+
+        // <session id>[;timeout=<seconds>]
+        var parts = session.Split(';', StringSplitOptions.TrimEntries);
+        _session = parts[0];
+        foreach (var part in parts.Skip(1))
+        {
+            if (part.StartsWith("timeout=", StringComparison.OrdinalIgnoreCase) &&
+                int.TryParse(part.AsSpan("timeout=".Length), NumberStyles.None, CultureInfo.InvariantCulture, out int timeout) && timeout > 0)
+            {
+                _sessionTimeoutS = timeout;
+            }
+        }
+    }
+
+    private void ParseTransport(string? transport)
+    {
+        if (transport == null)
+        {
+            return;
+        }
+
+        foreach (var parameter in transport.Split(';', StringSplitOptions.TrimEntries))
+        {
+            // The server may choose other channels than requested.
+            if (parameter.StartsWith("interleaved=", StringComparison.OrdinalIgnoreCase))
+            {
+                var channels = parameter.Substring("interleaved=".Length).Split('-');
+                _rtpChannel = byte.Parse(channels[0], CultureInfo.InvariantCulture);
+                _rtcpChannel = channels.Length > 1 ? byte.Parse(channels[1], CultureInfo.InvariantCulture) : (byte)(_rtpChannel + 1);
+            }
+            else if (parameter.StartsWith("server_port=", StringComparison.OrdinalIgnoreCase))
+            {
+                _logger.LogDebug($"RTSP server sends from port {parameter.Substring("server_port=".Length)}.");
+            }
+        }
+    }
+
+    private bool TrySetChallenge(RtspMessage response)
+    {
+        string? basic = null;
+        foreach (var challenge in response.GetHeaders("WWW-Authenticate"))
+        {
+            if (challenge.StartsWith("Digest ", StringComparison.OrdinalIgnoreCase))
+            {
+                _authenticationScheme = "Digest";
+                _authenticationParameters = ParseChallengeParameters(challenge.Substring("Digest ".Length));
+                _nonceCount = 0;
+                if (_authenticationParameters.TryGetValue("stale", out var stale) && stale.Equals("true", StringComparison.OrdinalIgnoreCase))
+                {
+                    _logger.LogDebug("RTSP digest nonce is stale, retrying with the new nonce.");
+                }
+
+                return true;
+            }
+
+            if (challenge.StartsWith("Basic", StringComparison.OrdinalIgnoreCase))
+            {
+                basic = challenge;
+            }
+        }
+
+        if (basic != null)
+        {
+            _authenticationScheme = "Basic";
+            return true;
+        }
+
+        return false;
+    }
+
+    private string? GetAuthorization(string method, Uri url)
+    {
+        if (_credential == null || _authenticationScheme == null)
+        {
+            return null;
+        }
+
+        if (_authenticationScheme == "Basic")
+        {
+            return "Basic " + Convert.ToBase64String(Encoding.UTF8.GetBytes($"{_credential.UserName}:{_credential.Password}"));
+        }
+
+        // RFC 2617 digest, with qop=auth if the server offers it.
+        var parameters = _authenticationParameters!;
+        var realm = parameters.GetValueOrDefault("realm", string.Empty);
+        var nonce = parameters.GetValueOrDefault("nonce", string.Empty);
+        var uri = url.ToString();
+        var ha1 = Md5Hex($"{_credential.UserName}:{realm}:{_credential.Password}");
+        var ha2 = Md5Hex($"{method}:{uri}");
+
+        var authorization = new StringBuilder();
+        authorization.Append($"Digest username=\"{_credential.UserName}\", realm=\"{realm}\", nonce=\"{nonce}\", uri=\"{uri}\"");
+        if (parameters.TryGetValue("qop", out var qop) && qop.Split(',', StringSplitOptions.TrimEntries).Contains("auth"))
+        {
+            var cnonce = Convert.ToHexString(RandomNumberGenerator.GetBytes(8)).ToLowerInvariant();
+            var nc = (++_nonceCount).ToString("x8", CultureInfo.InvariantCulture);
+            authorization.Append($", qop=auth, nc={nc}, cnonce=\"{cnonce}\", response=\"{Md5Hex($"{ha1}:{nonce}:{nc}:{cnonce}:auth:{ha2}")}\"");
+        }
+        else
+        {
+            authorization.Append($", response=\"{Md5Hex($"{ha1}:{nonce}:{ha2}")}\"");
+        }
+
+        if (parameters.TryGetValue("opaque", out var opaque))
+        {
+            authorization.Append($", opaque=\"{opaque}\"");
+        }
+
+        return authorization.ToString();
+    }
+
+    private static Dictionary<string, string> ParseChallengeParameters(string challenge)
+    {
+        // name="quoted value", name=token, ...
+        var parameters = new Dictionary<string, string>(StringComparer.OrdinalIgnoreCase);
+        int position = 0;
+        while (position < challenge.Length)
+        {
+            int equals = challenge.IndexOf('=', position);
+            if (equals < 0)
+            {
+                break;
+            }
+
+            var name = challenge.Substring(position, equals - position).Trim(' ', ',');
+            string value;
+            if (equals + 1 < challenge.Length && challenge[equals + 1] == '"')
+            {
+                int end = challenge.IndexOf('"', equals + 2);
+                end = end < 0 ? challenge.Length : end;
+                value = challenge.Substring(equals + 2, end - equals - 2);
+                position = end + 1;
+            }
+            else
+            {
+                int end = challenge.IndexOf(',', equals + 1);
+                end = end < 0 ? challenge.Length : end;
+                value = challenge.Substring(equals + 1, end - equals - 1).Trim();
+                position = end;
+            }
+
+            parameters[name] = value;
+        }
+
+        return parameters;
+    }
+
+    private static string Md5Hex(string value)
+    {
+        return Convert.ToHexString(MD5.HashData(Encoding.UTF8.GetBytes(value))).ToLowerInvariant();
+    }
+
+    private bool SendInterleaved(RTPChannelSocketsEnum sendOn, ReadOnlySpan<byte> packet)
+    {
+        if (packet.Length > MAX_INTERLEAVED_SEND_LENGTH)
+        {
+            return false;
+        }
+
+        // $ <channel> <16 bit length> <packet>
+        Span<byte> frame = stackalloc byte[INTERLEAVED_HEADER_LENGTH + packet.Length];
+        frame[0] = INTERLEAVED_MAGIC;
+        frame[1] = sendOn == RTPChannelSocketsEnum.Control ? _rtcpChannel : _rtpChannel;
+        BinaryPrimitives.WriteUInt16BigEndian(frame.Slice(2), (ushort)packet.Length);
+        packet.CopyTo(frame.Slice(INTERLEAVED_HEADER_LENGTH));
+        return Send(frame);
+    }
+
+    private bool Send(ReadOnlySpan<byte> data)
+    {
+        if (_isClosed)
+        {
+            return false;
+        }
+
+        try
+        {
+            lock (_sendLock)
+            {
+                while (!data.IsEmpty)
+                {
+                    data = data.Slice(_socket.Send(data, SocketFlags.None));
+                }
+            }
+
+            return true;
+        }
+        catch (Exception excp) when (excp is SocketException or ObjectDisposedException)
+        {
+            if (!_isClosed)
+            {
+                _logger.LogWarning($"RTSP send failed. {excp.Message}");
+            }
+
+            return false;
+        }
+    }
+
+    private void ReadThreadProc()
+    {
+        var buffer = new byte[RECEIVE_BUFFER_SIZE];
+        int filled = 0;
+        try
+        {
+            while (!_isClosed)
+            {
+                int read = _socket.Receive(buffer, filled, buffer.Length - filled, SocketFlags.None);
+                if (read == 0)
+                {
+                    if (!_isTearingDown)
+                    {
+                        _logger.LogWarning("RTSP server closed the connection.");
+                    }
+
+                    break;
+                }
+
+                filled += read;
+                long receivedTimestampNs = (DateTime.UtcNow - DateTime.UnixEpoch).Ticks * 100;
+                int consumed = ProcessReceived(buffer.AsSpan(0, filled), receivedTimestampNs);
+
+                // Complete packets were processed in place, only an incomplete tail is moved to the front.
+                filled -= consumed;
+                if (filled > 0 && consumed > 0)
+                {
+                    buffer.AsSpan(consumed, filled).CopyTo(buffer);
+                }
+            }
+        }
+        catch (Exception excp) when (excp is SocketException or ObjectDisposedException && _isClosed)
+        {
+        }
+        catch (Exception excp)
+        {
+            _logger.LogError($"Exception RtspClient.ReadThreadProc. {excp}");
+        }
+        finally
+        {
+            _isClosed = true;
+            _pendingResponse?.TrySetException(new IOException("The RTSP connection is closed."));
+        }
+    }
+
+    /// <summary>
+    /// Processes all complete interleaved packets and RTSP messages at the start of <paramref name="data"/>.
+    /// </summary>
+    /// <returns>Number of bytes consumed.</returns>
+    private int ProcessReceived(Span<byte> data, long receivedTimestampNs)
+    {
+        int offset = 0;
+        while (offset < data.Length)
+        {
+            var remaining = data.Slice(offset);
+            if (remaining[0] == INTERLEAVED_MAGIC)
+            {
+                if (remaining.Length < INTERLEAVED_HEADER_LENGTH)
+                {
+                    break;
+                }
+
+                int length = BinaryPrimitives.ReadUInt16BigEndian(remaining.Slice(2));
+                if (remaining.Length < INTERLEAVED_HEADER_LENGTH + length)
+                {
+                    break;
+                }
+
+                OnInterleavedPacket(remaining[1], remaining.Slice(INTERLEAVED_HEADER_LENGTH, length), receivedTimestampNs);
+                offset += INTERLEAVED_HEADER_LENGTH + length;
+                continue;
+            }
+
+            if (!char.IsAsciiLetterUpper((char)remaining[0]))
+            {
+                // Out of sync, e.g. after a malformed message: skip to the next interleaved packet.
+                int next = remaining.IndexOf(INTERLEAVED_MAGIC);
+                int skipped = next < 0 ? remaining.Length : next;
+                if (_discardedBytes == 0)
+                {
+                    _logger.LogWarning($"RTSP stream out of sync, skipping {skipped} bytes.");
+                }
+
+                _discardedBytes += skipped;
+                offset += skipped;
+                continue;
+            }
+
+            int headerLength = RtspMessage.FindHeaderLength(remaining);
+            if (headerLength < 0)
+            {
+                if (remaining.Length > MAX_HEADER_LENGTH)
+                {
+                    throw new InvalidDataException("RTSP message header too long.");
+                }
+
+                break;
+            }
+
+            int contentLength = RtspMessage.GetContentLength(remaining.Slice(0, headerLength));
+            if (contentLength > RECEIVE_BUFFER_SIZE - MAX_HEADER_LENGTH)
+            {
+                throw new InvalidDataException($"RTSP message body of {contentLength} bytes is too long.");
+            }
+
+            if (remaining.Length < headerLength + contentLength)
+            {
+                break;
+            }
+
+            OnMessage(RtspMessage.Parse(remaining.Slice(0, headerLength), remaining.Slice(headerLength, contentLength)));
+            offset += headerLength + contentLength;
+        }
+
+        return offset;
+    }
+
+    private void OnInterleavedPacket(byte channel, Span<byte> packet, long receivedTimestampNs)
+    {
+        if (!_isInterleaved || (channel != _rtpChannel && channel != _rtcpChannel))
+        {
+            return;
+        }
+
+        _interleavedPackets++;
+        _receiver.ReceiveInterleavedPacket(_localPort,
+            channel == _rtpChannel ? RTPChannelSocketsEnum.RTP : RTPChannelSocketsEnum.Control,
+            _remoteEndPoint!, packet, receivedTimestampNs);
+    }
+
+    private void OnMessage(RtspMessage message)
+    {
+        if (message.Method != null)
+        {
+            // Servers may probe the client, e.g. with OPTIONS as keep-alive; everything else is not implemented.
+            var status = message.Method is "OPTIONS" or "GET_PARAMETER" ? "200 OK" : "501 Not Implemented";
+            Send(Encoding.UTF8.GetBytes($"RTSP/1.0 {status}\r\nCSeq: {message.CSeq}\r\n\r\n"));
+            return;
+        }
+
+        var pending = _pendingResponse;
+        if (pending != null && message.CSeq == Volatile.Read(ref _pendingCSeq))
+        {
+            pending.TrySetResult(message);
+        }
+        else
+        {
+            _logger.LogDebug($"Unexpected RTSP response {message}, CSeq {message.CSeq}.");
+        }
+    }
+}
@@ -0,0 +1,133 @@
+using System.Globalization;
+using System.Text;
+
+namespace SharpVideo.RtpPlayerDemo.Rtsp;
+
+/// <summary>
+/// A message read from an RTSP connection: the response to a request, or a request from the server.
+/// </summary>
+internal sealed class RtspMessage
+{
+    private const string RTSP_VERSION_PREFIX = "RTSP/";
+
+    private readonly List<(string Name, string Value)> _headers;
+
+    private RtspMessage(string? method, int statusCode, string reasonPhrase, List<(string Name, string Value)> headers, string body)
+    {
+        Method = method;
+        StatusCode = statusCode;
+        ReasonPhrase = reasonPhrase;
+        _headers = headers;
+        Body = body;
+    }
+
+    /// <summary>
+    /// Method of a request from the server, null for responses.
+    /// </summary>
+    public string? Method { get; }
+
+    /// <summary>
+    /// Status code of a response, 0 for requests.
+    /// </summary>
+    public int StatusCode { get; }
+
+    public string ReasonPhrase { get; }
+
+    public string Body { get; }
+
+    public bool IsSuccess => StatusCode >= 200 && StatusCode < 300;
+
+    public int CSeq => int.TryParse(GetHeader("CSeq"), NumberStyles.None, CultureInfo.InvariantCulture, out int cseq) ? cseq : -1;
+
+    /// <summary>
+    /// First header with the name, or null.
+    /// </summary>
+    public string? GetHeader(string name)
+    {
+        foreach (var header in _headers)
+        {
+            if (header.Name.Equals(name, StringComparison.OrdinalIgnoreCase))
+            {
+                return header.Value;
+            }
+        }
+
+        return null;
+    }
+
+    /// <summary>
+    /// All headers with the name, e.g. several WWW-Authenticate challenges.
+    /// </summary>
+    public IEnumerable<string> GetHeaders(string name)
+    {
+        return _headers.Where(header => header.Name.Equals(name, StringComparison.OrdinalIgnoreCase)).Select(header => header.Value);
+    }
+
+    /// <summary>
+    /// Length of the header block including the empty line, or -1 if it is not complete yet.
+    /// </summary>
+    public static int FindHeaderLength(ReadOnlySpan<byte> data)
+    {
+        int end = data.IndexOf("\r\n\r\n"u8);
+        return end < 0 ? -1 : end + 4;
+    }
+
+    /// <summary>
+    /// Parses the header block; the body of <see cref="GetContentLength"/> bytes follows it.
+    /// </summary>
+    public static RtspMessage Parse(ReadOnlySpan<byte> headerBlock, ReadOnlySpan<byte> body)
+    {
+        var lines = Encoding.UTF8.GetString(headerBlock).Split("\r\n");
+        var statusLine = lines[0].Split(' ', 3);
+
+        string? method = null;
+        int statusCode = 0;
+        string reasonPhrase = string.Empty;
+        if (statusLine[0].StartsWith(RTSP_VERSION_PREFIX, StringComparison.Ordinal))
+        {
+            if (statusLine.Length < 2 || !int.TryParse(statusLine[1], NumberStyles.None, CultureInfo.InvariantCulture, out statusCode))
+            {
+                throw new FormatException($"Invalid RTSP status line: {lines[0]}");
+            }
+
+            reasonPhrase = statusLine.Length > 2 ? statusLine[2] : string.Empty;
+        }
+        else
+        {
+            // Request line: <method> <url> RTSP/1.0
+            method = statusLine[0];
+        }
+
+        var headers = new List<(string Name, string Value)>();
+        for (int i = 1; i < lines.Length; i++)
+        {
+            int colon = lines[i].IndexOf(':');
+            if (colon > 0)
+            {
+                headers.Add((lines[i].Substring(0, colon).Trim(), lines[i].Substring(colon + 1).Trim()));
+            }
+        }
+
+        return new RtspMessage(method, statusCode, reasonPhrase, headers, Encoding.UTF8.GetString(body));
+    }
+
+    /// <summary>
+    /// Content-Length of a header block, 0 without body.
+    /// </summary>
+    public static int GetContentLength(ReadOnlySpan<byte> headerBlock)
+    {
+        var text = Encoding.ASCII.GetString(headerBlock);
+        foreach (var line in text.Split("\r\n"))
+        {
+            if (line.StartsWith("Content-Length:", StringComparison.OrdinalIgnoreCase) &&
+                int.TryParse(line.AsSpan("Content-Length:".Length).Trim(), NumberStyles.None, CultureInfo.InvariantCulture, out int length))
+            {
+                return length;
+            }
+        }
+
+        return 0;
+    }
+
+    public override string ToString() => Method ?? $"{StatusCode} {ReasonPhrase}";
+}
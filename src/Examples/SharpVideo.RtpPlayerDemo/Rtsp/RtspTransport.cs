@@ -0,0 +1,17 @@
+namespace SharpVideo.RtpPlayerDemo.Rtsp;
+
+/// <summary>
+/// How RTP is carried in an RTSP session.
+/// </summary>
+public enum RtspTransport
+{
+    /// <summary>
+    /// RTP and RTCP on UDP ports of the receiver (RTP/AVP).
+    /// </summary>
+    Udp,
+
+    /// <summary>
+    /// RTP and RTCP interleaved in the RTSP TCP connection (RTP/AVP/TCP, RFC 2326 10.12).
+    /// </summary>
+    Tcp
+}
@@ -0,0 +1,57 @@
+namespace SharpVideo.RtpPlayerDemo.Rtsp;
+
+/// <summary>
+/// The parts of an SDP session description (RFC 8866) an RTSP client needs: the media sections with their payload
+/// types, control URLs and format parameters. Everything else is skipped.
+/// </summary>
+internal sealed class SessionDescription
+{
+    private SessionDescription(string? control, IReadOnlyList<MediaDescription> media)
+    {
+        Control = control;
+        Media = media;
+    }
+
+    /// <summary>
+    /// Session level control URL, null if the media sections are controlled individually.
+    /// </summary>
+    public string? Control { get; }
+
+    public IReadOnlyList<MediaDescription> Media { get; }
+
+    public static SessionDescription Parse(string sdp)
+    {
+        string? sessionControl = null;
+        var media = new List<MediaDescription>();
+        MediaDescription? current = null;
+
+        foreach (var rawLine in sdp.Split('\n'))
+        {
+            var line = rawLine.TrimEnd('\r');
+            if (line.Length < 2 || line[1] != '=')
+            {
+                continue;
+            }
+
+            var value = line.Substring(2);
+            switch (line[0])
+            {
+                case 'm':
+                    current = MediaDescription.Parse(value);
+                    media.Add(current);
+                    break;
+                case 'a' when current == null:
+                    if (value.StartsWith(MediaDescription.CONTROL_ATTRIBUTE, StringComparison.Ordinal))
+                    {
+                        sessionControl = value.Substring(MediaDescription.CONTROL_ATTRIBUTE.Length);
+                    }
+                    break;
+                case 'a':
+                    current.AddAttribute(value);
+                    break;
+            }
+        }
+
+        return new SessionDescription(sessionControl, media);
+    }
+}
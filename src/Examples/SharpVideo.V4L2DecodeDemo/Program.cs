@@ -1,6 +1,7 @@
 using System.Diagnostics;
 using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
+using SharpVideo.Utils;
 using SharpVideo.V4L2;
 using SharpVideo.V4L2Decoding.Models;
 using SharpVideo.V4L2Decoding.Services;
@@ -20,7 +21,8 @@ internal class Program
 
         logger.LogInformation("SharpVideo H.264 V4L2 Decoder Demo");
 
-        var testVideoName = "test_video.h264";
+        // An Annex-B stream, an MPEG transport stream (.ts) or an MP4 file can be passed, the test video is the default
+        var testVideoName = args.Length > 0 ? args[0] : "test_video.h264";
         var filePath = File.Exists(testVideoName) ? testVideoName : Path.Combine(AppContext.BaseDirectory, testVideoName);
         if (!File.Exists(filePath))
         {
@@ -58,9 +60,23 @@ internal class Program
             RequestPoolSize = 32
         };
 
-        var saver = new FrameSaver("frames", loggerFactory.CreateLogger<FrameSaver>());
+        using var snapshots = new SnapshotService(
+            new SnapshotOptions { OutputDirectory = "frames", Width = 640, Height = 360 },
+            loggerFactory.CreateLogger<SnapshotService>());
+
+        // Optional bit exact dump for conformance checks: .y4m or raw NV12, with per frame MD5s next to it
+        using var frameDump = args.Length > 1
+            ? new RawFrameSink(
+                args[1],
+                Path.GetExtension(args[1]).Equals(".y4m", StringComparison.OrdinalIgnoreCase)
+                    ? RawFrameFormat.Y4m
+                    : RawFrameFormat.Nv12,
+                computeHashes: true,
+                logger: logger)
+            : null;
 
         int decodedFrames = 0;
+        H264V4L2StatelessDecoder? frameSource = null;
         await using var decoder = new H264V4L2StatelessDecoder(
             v4L2Device,
             mediaDevice,
@@ -69,14 +85,26 @@ internal class Program
             span =>
             {
                 decodedFrames++;
-                //saver.TryEnqueueFrame(span, 1920, 1080);
+                // The layout the driver confirmed for the capture queue, with the visible size from the SPS
+                var frameParams = frameSource?.CaptureFrameParams;
+                if (frameParams == null)
+                {
+                    return;
+                }
+
+                frameDump?.Write(span, frameParams);
+                //snapshots.Offer(span, frameParams);
             }, null!);
+        frameSource = decoder;
 
-        await using var fileStream = File.OpenRead(filePath);
         var decodeStopWatch = Stopwatch.StartNew();
         decoder.InitializeDecoder(null!);
+        if (frameDump != null && decoder.CaptureFrameParams == null)
+        {
+            logger.LogWarning("The capture format has no NV12 layout, no frames are dumped");
+        }
 
-        await using var naluSource = new StreamNaluSource(fileStream, loggerFactory.CreateLogger<StreamNaluSource>());
+        await using var naluSource = NaluSourceFactory.CreateFromFile(filePath, loggerFactory);
         await naluSource.StartAsync();
         decoder.StartDecoding(naluSource);
 
@@ -86,5 +114,4 @@ internal class Program
         await decoder.StopDecodingAsync();        logger.LogInformation("Decoding completed successfully in {ElapsedTime:F2} seconds!", decodeStopWatch.Elapsed.TotalSeconds);
         logger.LogInformation("Amount of decoded frames: {DecodedFrames}", decodedFrames);
     }
-
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+namespace SharpVideo.V4L2DecodeDemo;
+
+/// <summary>
+/// Settings of <see cref="SnapshotService"/>
+/// </summary>
+public class SnapshotOptions
+{
+    public required string OutputDirectory { get; init; }
+
+    public SnapshotPolicy Policy { get; init; } = SnapshotPolicy.EveryNthFrame;
+
+    /// <summary>
+    /// Frame interval of <see cref="SnapshotPolicy.EveryNthFrame"/>
+    /// </summary>
+    public int Interval { get; init; } = 30;
+
+    /// <summary>
+    /// Size of the saved images, 0 to keep the size of the frame
+    /// </summary>
+    public int Width { get; init; }
+
+    public int Height { get; init; }
+
+    public int JpegQuality { get; init; } = 75;
+
+    /// <summary>
+    /// Snapshots taken but not yet saved; further frames are skipped until one is done, which bounds the memory
+    /// </summary>
+    public int MaxPendingSnapshots { get; init; } = 4;
+
+    /// <summary>
+    /// Number of encoder workers, 0 for one per core
+    /// </summary>
+    public int WorkerCount { get; init; }
+}
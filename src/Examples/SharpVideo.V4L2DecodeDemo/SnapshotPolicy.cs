@@ -0,0 +1,22 @@
+namespace SharpVideo.V4L2DecodeDemo;
+
+/// <summary>
+/// Which decoded frames <see cref="SnapshotService"/> saves
+/// </summary>
+public enum SnapshotPolicy
+{
+    /// <summary>
+    /// Every <see cref="SnapshotOptions.Interval"/>th frame
+    /// </summary>
+    EveryNthFrame,
+
+    /// <summary>
+    /// Frames offered as key frames
+    /// </summary>
+    KeyFramesOnly,
+
+    /// <summary>
+    /// Only the frame after each <see cref="SnapshotService.RequestSnapshot"/>
+    /// </summary>
+    OnRequest
+}
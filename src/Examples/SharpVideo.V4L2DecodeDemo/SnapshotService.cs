@@ -0,0 +1,273 @@
+using System.Buffers;
+using System.Runtime.Versioning;
+using System.Threading.Channels;
+
+using Microsoft.Extensions.Logging;
+
+using SharpVideo.Drm;
+using SharpVideo.Utils;
+
+using SixLabors.ImageSharp;
+using SixLabors.ImageSharp.Formats.Jpeg;
+using SixLabors.ImageSharp.PixelFormats;
+
+namespace SharpVideo.V4L2DecodeDemo;
+
+/// <summary>
+/// Saves sampled decoded NV12 frames as JPEG images
+/// </summary>
+/// <remarks>
+/// <see cref="Offer(ReadOnlySpan{byte}, BufferParams, bool)"/> runs on the decoder thread: it applies the
+/// <see cref="SnapshotPolicy"/>, and only for frames that are taken scales the frame straight from the decoder's
+/// buffer into a pooled buffer of the snapshot size. Conversion to RGB and JPEG encoding run on a pool of workers.
+/// At most <see cref="SnapshotOptions.MaxPendingSnapshots"/> snapshots are in flight, frames beyond that are skipped
+/// instead of queued, so memory stays at a few snapshot sized buffers whatever the decoder's frame rate.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed class SnapshotService : IDisposable
+{
+    private readonly SnapshotOptions _options;
+    private readonly ILogger _logger;
+    private readonly Channel<Snapshot> _snapshots;
+    private readonly Task[] _workers;
+    private readonly JpegEncoder _encoder;
+    private long _frameIndex;
+    private int _pending;
+    private int _requested;
+    private bool _disposed;
+
+    private long _taken;
+    private long _skipped;
+    private long _saved;
+
+    public SnapshotService(SnapshotOptions options, ILogger logger)
+    {
+        ArgumentOutOfRangeException.ThrowIfLessThan(options.Interval, 1);
+        ArgumentOutOfRangeException.ThrowIfLessThan(options.MaxPendingSnapshots, 1);
+
+        _options = options;
+        _logger = logger;
+        _encoder = new JpegEncoder { Quality = options.JpegQuality };
+        _snapshots = Channel.CreateBounded<Snapshot>(new BoundedChannelOptions(options.MaxPendingSnapshots)
+        {
+            SingleWriter = true,
+            SingleReader = false
+        });
+
+        Directory.CreateDirectory(options.OutputDirectory);
+
+        int workerCount = options.WorkerCount > 0 ? options.WorkerCount : Environment.ProcessorCount;
+        _workers = new Task[workerCount];
+        for (int i = 0; i < workerCount; i++)
+        {
+            _workers[i] = Task.Run(ProcessSnapshotsAsync);
+        }
+
+        _logger.LogInformation("SnapshotService started with {Workers} workers, saving to: {OutputDir}",
+            workerCount, options.OutputDirectory);
+    }
+
+    /// <summary>
+    /// Snapshots that were taken
+    /// </summary>
+    public long Taken => Interlocked.Read(ref _taken);
+
+    /// <summary>
+    /// Frames the policy selected but that were skipped because <see cref="SnapshotOptions.MaxPendingSnapshots"/>
+    /// snapshots were in flight
+    /// </summary>
+    public long Skipped => Interlocked.Read(ref _skipped);
+
+    /// <summary>
+    /// Snapshots written to disk
+    /// </summary>
+    public long Saved => Interlocked.Read(ref _saved);
+
+    /// <summary>
+    /// Takes a snapshot of the next offered frame, whatever the policy
+    /// </summary>
+    public void RequestSnapshot()
+    {
+        Volatile.Write(ref _requested, 1);
+    }
+
+    /// <summary>
+    /// Offers a mapped capture buffer, see <see cref="Offer(ReadOnlySpan{byte}, BufferParams, bool)"/>
+    /// </summary>
+    public bool Offer(SharedDmaBuffer buffer, bool isKeyFrame = false)
+    {
+        if (!TryTake(isKeyFrame, buffer.Width, buffer.Height, out var snapshot))
+        {
+            return false;
+        }
+
+        try
+        {
+            Nv12Scaler.Scale(buffer, snapshot.Nv12, snapshot.Params);
+        }
+        catch
+        {
+            Release(snapshot.Nv12);
+            throw;
+        }
+
+        Enqueue(snapshot);
+        return true;
+    }
+
+    /// <summary>
+    /// Offers a decoded NV12 frame. Returns true if a snapshot was taken; the frame is not referenced afterwards.
+    /// </summary>
+    /// <param name="frame">The frame, e.g. the mapped capture buffer before it is queued again.</param>
+    /// <param name="frameParams">Size, stride and plane offsets of the frame.</param>
+    /// <param name="isKeyFrame">True for key frames, used by <see cref="SnapshotPolicy.KeyFramesOnly"/>.</param>
+    public bool Offer(ReadOnlySpan<byte> frame, BufferParams frameParams, bool isKeyFrame = false)
+    {
+        if (!TryTake(isKeyFrame, frameParams.Width, frameParams.Height, out var snapshot))
+        {
+            return false;
+        }
+
+        try
+        {
+            Nv12Scaler.Scale(frame, frameParams, snapshot.Nv12, snapshot.Params);
+        }
+        catch
+        {
+            Release(snapshot.Nv12);
+            throw;
+        }
+
+        Enqueue(snapshot);
+        return true;
+    }
+
+    /// <summary>
+    /// Applies the policy to the next frame and, if it is taken and there is room, rents the buffer of its snapshot
+    /// </summary>
+    private bool TryTake(bool isKeyFrame, uint frameWidth, uint frameHeight, out Snapshot snapshot)
+    {
+        snapshot = null!;
+        long frameIndex = _frameIndex++;
+        if (_disposed)
+        {
+            return false;
+        }
+
+        bool requested = Interlocked.Exchange(ref _requested, 0) == 1;
+        bool selected = requested || _options.Policy switch
+        {
+            SnapshotPolicy.EveryNthFrame => frameIndex % _options.Interval == 0,
+            SnapshotPolicy.KeyFramesOnly => isKeyFrame,
+            _ => false
+        };
+
+        if (!selected || !TryReserve(requested))
+        {
+            return false;
+        }
+
+        uint width = _options.Width > 0 ? (uint)_options.Width : frameWidth;
+        uint height = _options.Height > 0 ? (uint)_options.Height : frameHeight;
+        var snapshotParams = BuffersInfoProvider.GetBufferParams(width, height, KnownPixelFormats.DRM_FORMAT_NV12);
+        snapshot = new Snapshot(frameIndex, ArrayPool<byte>.Shared.Rent((int)snapshotParams.FullSize), snapshotParams);
+        return true;
+    }
+
+    private bool TryReserve(bool requested)
+    {
+        if (Interlocked.Increment(ref _pending) > _options.MaxPendingSnapshots)
+        {
+            Interlocked.Decrement(ref _pending);
+            Interlocked.Increment(ref _skipped);
+            if (requested)
+            {
+                // Keep the request for the next frame
+                Volatile.Write(ref _requested, 1);
+            }
+
+            return false;
+        }
+
+        Interlocked.Increment(ref _taken);
+        return true;
+    }
+
+    private void Enqueue(Snapshot snapshot)
+    {
+        // Cannot fail while the service runs: the channel holds as many snapshots as may be pending
+        if (!_snapshots.Writer.TryWrite(snapshot))
+        {
+            Release(snapshot.Nv12);
+        }
+    }
+
+    private void Release(byte[] nv12)
+    {
+        ArrayPool<byte>.Shared.Return(nv12);
+        Interlocked.Decrement(ref _pending);
+    }
+
+    private async Task ProcessSnapshotsAsync()
+    {
+        await foreach (var snapshot in _snapshots.Reader.ReadAllAsync())
+        {
+            try
+            {
+                Save(snapshot);
+                Interlocked.Increment(ref _saved);
+            }
+            catch (Exception ex)
+            {
+                _logger.LogWarning(ex, "Failed to save snapshot of frame {FrameIndex}", snapshot.FrameIndex);
+            }
+            finally
+            {
+                Release(snapshot.Nv12);
+            }
+        }
+    }
+
+    private void Save(Snapshot snapshot)
+    {
+        int width = (int)snapshot.Params.Width;
+        int height = (int)snapshot.Params.Height;
+        int rgbSize = width * height * 3;
+        var rgb = ArrayPool<byte>.Shared.Rent(rgbSize);
+        try
+        {
+            // The workers already use all cores, convert on this one
+            YuvToRgbConverter.Convert(snapshot.Nv12, snapshot.Params, KnownPixelFormats.DRM_FORMAT_NV12,
+                rgb, width * 3, KnownPixelFormats.DRM_FORMAT_BGR888, maxDegreeOfParallelism: 1);
+
+            var outputPath = Path.Combine(_options.OutputDirectory, $"snapshot_{snapshot.FrameIndex:D6}.jpg");
+            using var image = Image.WrapMemory<Rgb24>(rgb.AsMemory(0, rgbSize), width, height);
+            image.SaveAsJpeg(outputPath, _encoder);
+            _logger.LogDebug("Saved snapshot of frame {FrameIndex} to {Path}", snapshot.FrameIndex, outputPath);
+        }
+        finally
+        {
+            ArrayPool<byte>.Shared.Return(rgb);
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_disposed)
+            return;
+
+        _disposed = true;
+
+        // Let the workers save what was taken, then stop
+        _snapshots.Writer.TryComplete();
+        if (!Task.WaitAll(_workers, TimeSpan.FromSeconds(10)))
+        {
+            _logger.LogWarning("Snapshot workers did not complete in time");
+        }
+
+        _logger.LogInformation("SnapshotService disposed: {Taken} taken, {Saved} saved, {Skipped} skipped",
+            Taken, Saved, Skipped);
+    }
+
+    private sealed record Snapshot(long FrameIndex, byte[] Nv12, BufferParams Params);
+}
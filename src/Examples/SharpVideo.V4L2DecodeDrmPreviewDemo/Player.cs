@@ -1,4 +1,3 @@
-using System.Collections.Concurrent;
 using System.Diagnostics;
 using System.Runtime.Versioning;
 using System.Text;
@@ -19,8 +18,8 @@ public class Player
     private readonly H264V4L2StatelessDecoder _decoder;
     private readonly ILogger<Player> _logger;
     private readonly ILoggerFactory _loggerFactory;
-    // Use bounded capacity to limit latency - max 3 frames in display queue
-    private readonly BlockingCollection<SharedDmaBuffer> _buffersToPresent = new(boundedCapacity: 3);
+    // Use bounded capacity to limit latency - max 4 frames in display queue
+    private readonly SpscRing<SharedDmaBuffer> _buffersToPresent = new(capacity: 4);
     private readonly CancellationTokenSource displayCts = new CancellationTokenSource();
 
     private Task _decodeTask;
@@ -64,14 +63,14 @@ public class Player
     {
         Statistics.IncrementDecodedFrames();
 
-        // Try to add without blocking - if queue is full, drop the oldest frame to reduce latency
-        if (!_buffersToPresent.TryAdd(buffer, 0))
+        // Try to add without blocking - if queue is full, wait for the display thread
+        if (!_buffersToPresent.TryPush(buffer))
         {
             if (_logger.IsEnabled(LogLevel.Debug))
             {
                 _logger.LogDebug("Display queue full, frame may be delayed");
             }
-            _buffersToPresent.Add(buffer); // Block until space available
+            _buffersToPresent.TryPush(buffer, Timeout.Infinite, displayCts.Token); // Block until space available
         }
 
         if (_logger.IsEnabled(LogLevel.Trace))
@@ -97,12 +96,7 @@ public class Player
         var displayStopwatch = Stopwatch.StartNew();
         while(!(cancellationToken.IsCancellationRequested && Statistics.DecodedFrames == Statistics.PresentedFrames))
         {
-            SharedDmaBuffer buffer;
-            try
-            {
-                buffer = _buffersToPresent.Take(cancellationToken);
-            }
-            catch (OperationCanceledException)
+            if (!_buffersToPresent.TryPop(out var buffer, Timeout.Infinite, cancellationToken))
             {
                 break;
             }
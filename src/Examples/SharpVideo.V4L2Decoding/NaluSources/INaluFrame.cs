@@ -0,0 +1,18 @@
+namespace SharpVideo.V4L2Decoding.NaluSources;
+
+/// <summary>
+/// The NAL units of one access unit, handed to the decoder as a whole instead of NAL unit by NAL unit.
+/// The decoder disposes the frame once all NAL units were submitted, so the producer can pool its memory.
+/// </summary>
+public interface INaluFrame : IDisposable
+{
+    /// <summary>
+    /// Number of NAL units in the frame.
+    /// </summary>
+    int NalUnitCount { get; }
+
+    /// <summary>
+    /// Returns a NAL unit including its Annex-B start code.
+    /// </summary>
+    ReadOnlySpan<byte> GetNalUnit(int index);
+}
@@ -1,19 +1,23 @@
-using System.Collections.Concurrent;
+using System.Runtime.Versioning;
 using SharpVideo.H264;
+using SharpVideo.Utils;
 
 namespace SharpVideo.V4L2Decoding.NaluSources;
 
 /// <summary>
 /// Abstraction for providing H.264 NAL units to the decoder.
-/// Designed for minimal latency using BlockingCollection for synchronous consumption.
+/// Designed for minimal latency using a single producer ring for synchronous consumption.
 /// </summary>
+[SupportedOSPlatform("linux")]
 public interface INaluSource : IAsyncDisposable
 {
     /// <summary>
-    /// Blocking collection for consuming NAL units as they become available.
-    /// Optimized for minimal latency with synchronous Take() operations.
+    /// Ring for consuming NAL units as they become available, by exactly one consumer thread.
+    /// Optimized for minimal latency with synchronous blocking TryPop()/TryPopBatch() operations.
+    /// The consumer calls <see cref="H264Nalu.Release"/> on every NAL unit it is done with, sources may pool their
+    /// buffers.
     /// </summary>
-    BlockingCollection<H264Nalu> NaluQueue { get; }
+    SpscRing<H264Nalu> NaluQueue { get; }
 
     /// <summary>
     /// Starts providing NAL units to the queue.
@@ -0,0 +1,323 @@
+using System.Buffers.Binary;
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using Microsoft.Win32.SafeHandles;
+using SharpVideo.H264;
+using SharpVideo.IoUring;
+using SharpVideo.Utils;
+
+namespace SharpVideo.V4L2Decoding.NaluSources;
+
+/// <summary>
+/// Provides the H.264 NAL units of an MP4 or fragmented MP4 file.
+/// Every sample is read once into a pooled <see cref="H264NaluBuffer"/> and converted from length prefixed (AVCC) to
+/// Annex-B in place by overwriting the length fields with start codes; its NAL units are views into that buffer, which
+/// goes back to the pool once the consumer released all of them.
+/// </summary>
+[SupportedOSPlatform("linux")]
+public class Mp4NaluSource : INaluSource
+{
+    private const int StartCodeLength = 4;
+    private const long OutputTimescale = 90000;
+
+    private readonly SafeFileHandle _file;
+    private readonly IoUringFileStream? _samples;
+    private readonly ILogger<Mp4NaluSource>? _logger;
+    private readonly SpscRing<H264Nalu> _naluQueue;
+    private readonly Mp4SampleIndex _index;
+    private readonly List<(int Offset, int Length)> _nalUnits = new();
+    private Task? _readTask;
+    private CancellationTokenSource? _cts;
+    private int _seekSample = -1;
+    private bool _disposed;
+
+    /// <param name="path">MP4 file</param>
+    /// <param name="logger">Optional logger</param>
+    /// <param name="queueCapacity">Capacity of the NAL unit ring, the reader blocks while the decoder is behind</param>
+    /// <param name="useIoUring">Read the samples through io_uring with read-ahead instead of one pread per sample,
+    /// ignored if the kernel does not support it</param>
+    /// <exception cref="InvalidDataException">The file has no H.264 track</exception>
+    public Mp4NaluSource(string path, ILogger<Mp4NaluSource>? logger = null, int queueCapacity = 100, bool useIoUring = false)
+    {
+        _logger = logger;
+        _file = File.OpenHandle(path, FileMode.Open, FileAccess.Read, FileShare.Read, FileOptions.RandomAccess);
+        try
+        {
+            _index = Mp4SampleIndex.Load(_file, logger);
+            if (useIoUring && IoUringFileStream.IsSupported)
+            {
+                // Samples are mostly stored in decoding order, interleaved audio is skipped within the read-ahead
+                _samples = IoUringFileStream.OpenRead(path);
+            }
+        }
+        catch
+        {
+            _file.Dispose();
+            throw;
+        }
+
+        _naluQueue = new SpscRing<H264Nalu>(queueCapacity);
+    }
+
+    public SpscRing<H264Nalu> NaluQueue => _naluQueue;
+
+    /// <summary>
+    /// Number of video samples (access units) in the file
+    /// </summary>
+    public int SampleCount => _index.Samples.Count;
+
+    /// <summary>
+    /// Decoding time of the last sample
+    /// </summary>
+    public TimeSpan Duration => _index.Samples.Count == 0
+        ? TimeSpan.Zero
+        : TimeSpan.FromSeconds((double)_index.Samples[^1].DecodeTime / _index.Timescale);
+
+    public Task StartAsync(CancellationToken cancellationToken = default)
+    {
+        if (_readTask != null)
+        {
+            throw new InvalidOperationException("Mp4NaluSource already started");
+        }
+
+        _cts = CancellationTokenSource.CreateLinkedTokenSource(cancellationToken);
+        _readTask = Task.Run(() => ReadSamples(_cts.Token));
+
+        _logger?.LogInformation("MP4 NALU source started");
+        return Task.CompletedTask;
+    }
+
+    public async Task StopAsync()
+    {
+        if (_cts == null || _readTask == null)
+        {
+            return;
+        }
+
+        _logger?.LogInformation("Stopping MP4 NALU source");
+        _cts.Cancel();
+        await _readTask;
+        _logger?.LogInformation("MP4 NALU source stopped");
+    }
+
+    /// <summary>
+    /// Continues reading at the last sync sample at or before a position, so decoding restarts cleanly.
+    /// NAL units already queued are still decoded.
+    /// </summary>
+    /// <param name="position">Decoding time to seek to</param>
+    public void Seek(TimeSpan position)
+    {
+        long decodeTime = (long)(position.TotalSeconds * _index.Timescale);
+        var samples = _index.Samples;
+
+        int low = 0;
+        int high = samples.Count - 1;
+        while (low < high)
+        {
+            int middle = (low + high + 1) / 2;
+            if (samples[middle].DecodeTime <= decodeTime)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle - 1;
+            }
+        }
+
+        while (low > 0 && !samples[low].IsSync)
+        {
+            low--;
+        }
+
+        Volatile.Write(ref _seekSample, low);
+    }
+
+    private void ReadSamples(CancellationToken cancellationToken)
+    {
+        var samples = _index.Samples;
+        int sampleIndex = 0;
+        int naluCount = 0;
+
+        try
+        {
+            // Parameter sets from avcC come first, as a stream with out-of-band SPS/PPS has none in its samples
+            PushParameterSets(cancellationToken);
+
+            while (sampleIndex < samples.Count)
+            {
+                int seekSample = Interlocked.Exchange(ref _seekSample, -1);
+                if (seekSample >= 0)
+                {
+                    _logger?.LogInformation("Seeking to sample {Sample}", seekSample);
+                    sampleIndex = seekSample;
+                    PushParameterSets(cancellationToken);
+                }
+
+                var sample = samples[sampleIndex++];
+                naluCount += PushSample(sample, cancellationToken);
+            }
+
+            _logger?.LogInformation("Completed reading MP4: {Samples} samples, {Count} NALUs", samples.Count, naluCount);
+        }
+        catch (OperationCanceledException)
+        {
+            _logger?.LogDebug("MP4 reading cancelled after {Count} NALUs", naluCount);
+        }
+        catch (Exception ex)
+        {
+            _logger?.LogError(ex, "Error reading MP4 samples");
+            throw;
+        }
+        finally
+        {
+            _naluQueue.Complete();
+        }
+    }
+
+    private void PushParameterSets(CancellationToken cancellationToken)
+    {
+        foreach (var parameterSet in _index.ParameterSets)
+        {
+            var data = new byte[StartCodeLength + parameterSet.Length];
+            WriteStartCode(data);
+            parameterSet.CopyTo(data, StartCodeLength);
+            Push(new H264Nalu(data, StartCodeLength), cancellationToken);
+        }
+    }
+
+    /// <summary>
+    /// Reads a sample and queues its NAL units
+    /// </summary>
+    /// <returns>Number of NAL units queued</returns>
+    private int PushSample(Mp4Sample sample, CancellationToken cancellationToken)
+    {
+        var buffer = new H264NaluBuffer(sample.Size);
+        try
+        {
+            if (ReadSample(buffer.Array.AsSpan(0, sample.Size), sample.Offset) != sample.Size)
+            {
+                throw new InvalidDataException($"MP4 sample at {sample.Offset} extends past the end of the file");
+            }
+
+            ConvertToAnnexB(buffer, sample);
+
+            long dts = ToOutputTime(sample.DecodeTime);
+            long pts = ToOutputTime(sample.DecodeTime + sample.CompositionOffset);
+            foreach (var (offset, length) in _nalUnits)
+            {
+                Push(new H264Nalu(buffer, offset, length, StartCodeLength, pts, dts), cancellationToken);
+            }
+
+            return _nalUnits.Count;
+        }
+        finally
+        {
+            buffer.Release();
+        }
+    }
+
+    /// <summary>
+    /// Replaces the length fields of a sample by 4 byte start codes and records where its NAL units are.
+    /// With 4 byte length fields nothing moves. Shorter ones leave no room for a start code, the NAL units are then
+    /// moved back in the buffer, last one first so that none is overwritten before it was moved.
+    /// </summary>
+    private void ConvertToAnnexB(H264NaluBuffer buffer, Mp4Sample sample)
+    {
+        int lengthSize = _index.NaluLengthSize;
+        var data = buffer.Array.AsSpan(0, sample.Size);
+        int position = 0;
+
+        _nalUnits.Clear();
+        while (position + lengthSize <= data.Length)
+        {
+            int length = ReadLength(data.Slice(position, lengthSize));
+            if (length <= 0 || length > data.Length - position - lengthSize)
+            {
+                _logger?.LogWarning("Malformed NAL unit length {Length} in MP4 sample at {Offset}", length, sample.Offset);
+                break;
+            }
+
+            _nalUnits.Add((position, length));
+            position += lengthSize + length;
+        }
+
+        int growth = (StartCodeLength - lengthSize) * _nalUnits.Count;
+        if (sample.Size + growth > buffer.Array.Length)
+        {
+            buffer.Grow(sample.Size + growth, sample.Size);
+        }
+
+        var array = buffer.Array;
+        for (int i = _nalUnits.Count - 1; i >= 0; i--)
+        {
+            var (source, length) = _nalUnits[i];
+            int destination = source + (StartCodeLength - lengthSize) * i;
+            array.AsSpan(source + lengthSize, length).CopyTo(array.AsSpan(destination + StartCodeLength));
+            WriteStartCode(array.AsSpan(destination));
+            _nalUnits[i] = (destination, StartCodeLength + length);
+        }
+    }
+
+    private int ReadSample(Span<byte> data, long offset)
+    {
+        if (_samples == null)
+        {
+            return RandomAccess.Read(_file, data, offset);
+        }
+
+        _samples.Position = offset;
+        return _samples.ReadAtLeast(data, data.Length, throwOnEndOfStream: false);
+    }
+
+    private void Push(H264Nalu nalu, CancellationToken cancellationToken)
+    {
+        if (!_naluQueue.TryPush(nalu, Timeout.Infinite, cancellationToken))
+        {
+            cancellationToken.ThrowIfCancellationRequested();
+            throw new OperationCanceledException("NALU queue was completed");
+        }
+    }
+
+    private long ToOutputTime(long time)
+    {
+        long timescale = _index.Timescale;
+        return time / timescale * OutputTimescale + time % timescale * OutputTimescale / timescale;
+    }
+
+    private static int ReadLength(ReadOnlySpan<byte> field)
+    {
+        return field.Length switch
+        {
+            1 => field[0],
+            2 => BinaryPrimitives.ReadUInt16BigEndian(field),
+            3 => field[0] << 16 | field[1] << 8 | field[2],
+            _ => (int)Math.Min(BinaryPrimitives.ReadUInt32BigEndian(field), int.MaxValue)
+        };
+    }
+
+    private static void WriteStartCode(Span<byte> destination)
+    {
+        destination[0] = 0;
+        destination[1] = 0;
+        destination[2] = 0;
+        destination[3] = 1;
+    }
+
+    public async ValueTask DisposeAsync()
+    {
+        if (_disposed)
+        {
+            return;
+        }
+
+        _disposed = true;
+
+        await StopAsync();
+
+        _cts?.Dispose();
+        _naluQueue.Dispose();
+        _samples?.Dispose();
+        _file.Dispose();
+    }
+}
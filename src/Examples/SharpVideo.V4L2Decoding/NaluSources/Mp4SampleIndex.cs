@@ -0,0 +1,694 @@
+using System.Buffers.Binary;
+using Microsoft.Extensions.Logging;
+using Microsoft.Win32.SafeHandles;
+
+namespace SharpVideo.V4L2Decoding.NaluSources;
+
+/// <summary>
+/// A sample (access unit) of the video track of an MP4 file
+/// </summary>
+/// <param name="Offset">File offset of the sample data</param>
+/// <param name="Size">Size of the sample data</param>
+/// <param name="DecodeTime">Decoding time in track timescale units</param>
+/// <param name="CompositionOffset">Presentation time minus decoding time in track timescale units</param>
+/// <param name="IsSync">Whether decoding can start at this sample</param>
+internal readonly record struct Mp4Sample(long Offset, int Size, long DecodeTime, int CompositionOffset, bool IsSync);
+
+/// <summary>
+/// Index of the samples of the first H.264 track of an MP4 file (ISO/IEC 14496-12 and -15), both progressive
+/// (sample tables in moov) and fragmented (moof/traf/trun). Only box headers and metadata boxes are read, mdat
+/// is skipped.
+/// </summary>
+internal sealed class Mp4SampleIndex
+{
+    private const int BoxHeaderSize = 8;
+    private const int MaxMetadataBoxSize = 256 * 1024 * 1024;
+    private const int MaxSampleSize = 64 * 1024 * 1024;
+
+    private static readonly uint Moov = FourCc("moov");
+    private static readonly uint Moof = FourCc("moof");
+    private static readonly uint Trak = FourCc("trak");
+    private static readonly uint Tkhd = FourCc("tkhd");
+    private static readonly uint Mdia = FourCc("mdia");
+    private static readonly uint Mdhd = FourCc("mdhd");
+    private static readonly uint Hdlr = FourCc("hdlr");
+    private static readonly uint Minf = FourCc("minf");
+    private static readonly uint Stbl = FourCc("stbl");
+    private static readonly uint Stsd = FourCc("stsd");
+    private static readonly uint Stts = FourCc("stts");
+    private static readonly uint Ctts = FourCc("ctts");
+    private static readonly uint Stsc = FourCc("stsc");
+    private static readonly uint Stsz = FourCc("stsz");
+    private static readonly uint Stco = FourCc("stco");
+    private static readonly uint Co64 = FourCc("co64");
+    private static readonly uint Stss = FourCc("stss");
+    private static readonly uint Mvex = FourCc("mvex");
+    private static readonly uint Trex = FourCc("trex");
+    private static readonly uint Traf = FourCc("traf");
+    private static readonly uint Tfhd = FourCc("tfhd");
+    private static readonly uint Tfdt = FourCc("tfdt");
+    private static readonly uint Trun = FourCc("trun");
+    private static readonly uint Avc1 = FourCc("avc1");
+    private static readonly uint Avc3 = FourCc("avc3");
+    private static readonly uint AvcC = FourCc("avcC");
+    private static readonly uint Vide = FourCc("vide");
+
+    private readonly List<Mp4Sample> _samples = new();
+    private readonly List<byte[]> _parameterSets = new();
+    private readonly ILogger? _logger;
+    private uint _trackId;
+    private uint _defaultSampleDuration;
+    private uint _defaultSampleSize;
+    private uint _defaultSampleFlags;
+    private long _nextFragmentDecodeTime;
+
+    private Mp4SampleIndex(ILogger? logger)
+    {
+        _logger = logger;
+    }
+
+    /// <summary>
+    /// Samples in decoding order
+    /// </summary>
+    public IReadOnlyList<Mp4Sample> Samples => _samples;
+
+    /// <summary>
+    /// SPS and PPS from the avcC box, without start codes
+    /// </summary>
+    public IReadOnlyList<byte[]> ParameterSets => _parameterSets;
+
+    /// <summary>
+    /// Size of the length field in front of every NAL unit of a sample, 4 in practically all files
+    /// </summary>
+    public int NaluLengthSize { get; private set; }
+
+    /// <summary>
+    /// Ticks per second of the sample times
+    /// </summary>
+    public uint Timescale { get; private set; }
+
+    /// <summary>
+    /// Reads the metadata of a file and indexes its video samples
+    /// </summary>
+    /// <exception cref="InvalidDataException">The file has no H.264 track</exception>
+    public static Mp4SampleIndex Load(SafeFileHandle file, ILogger? logger = null)
+    {
+        var index = new Mp4SampleIndex(logger);
+        long fileLength = RandomAccess.GetLength(file);
+        bool fragmented = false;
+
+        // Top level boxes are visited by their headers, only moov and moof are read
+        Span<byte> header = stackalloc byte[16];
+        long offset = 0;
+        while (offset + BoxHeaderSize <= fileLength)
+        {
+            int read = RandomAccess.Read(file, header, offset);
+            if (read < BoxHeaderSize)
+            {
+                break;
+            }
+
+            long size = BinaryPrimitives.ReadUInt32BigEndian(header);
+            uint type = BinaryPrimitives.ReadUInt32BigEndian(header.Slice(4));
+            int headerSize = BoxHeaderSize;
+            if (size == 1 && read >= 16)
+            {
+                size = BinaryPrimitives.ReadInt64BigEndian(header.Slice(8));
+                headerSize = 16;
+            }
+            else if (size == 0)
+            {
+                size = fileLength - offset;
+            }
+
+            if (size < headerSize || offset + size > fileLength)
+            {
+                // A recording that was cut off still has its complete fragments
+                logger?.LogWarning("MP4 box {Type} at {Offset} is truncated, ignoring the rest of the file",
+                    FourCcToString(type), offset);
+                break;
+            }
+
+            try
+            {
+                if (type == Moov)
+                {
+                    index.ParseMoov(ReadBox(file, offset + headerSize, size - headerSize));
+                }
+                else if (type == Moof && index._trackId != 0)
+                {
+                    fragmented = true;
+                    index.ParseMoof(ReadBox(file, offset + headerSize, size - headerSize), offset);
+                }
+            }
+            catch (ArgumentOutOfRangeException ex)
+            {
+                // Tables that claim more entries than their box holds end up slicing past it
+                throw new InvalidDataException($"MP4 box {FourCcToString(type)} at {offset} is malformed", ex);
+            }
+
+            offset += size;
+        }
+
+        if (index._trackId == 0)
+        {
+            throw new InvalidDataException("MP4 file has no H.264 video track");
+        }
+
+        // The mdat of the last fragment of an interrupted recording is incomplete
+        int incomplete = index._samples.RemoveAll(sample => sample.Offset + sample.Size > fileLength);
+        if (incomplete > 0)
+        {
+            logger?.LogWarning("Skipping {Count} MP4 samples past the end of the file", incomplete);
+        }
+
+        logger?.LogInformation(
+            "MP4 {Kind} file: H.264 track {Track}, {Samples} samples, timescale {Timescale}, {ParameterSets} parameter sets",
+            fragmented ? "fragmented" : "progressive", index._trackId, index._samples.Count, index.Timescale,
+            index._parameterSets.Count);
+
+        return index;
+    }
+
+    private static byte[] ReadBox(SafeFileHandle file, long offset, long length)
+    {
+        if (length > MaxMetadataBoxSize)
+        {
+            throw new InvalidDataException($"MP4 metadata box of {length} bytes is too large");
+        }
+
+        var data = new byte[length];
+        if (RandomAccess.Read(file, data, offset) != length)
+        {
+            throw new InvalidDataException("MP4 file ended inside a box");
+        }
+
+        return data;
+    }
+
+    private void ParseMoov(ReadOnlySpan<byte> moov)
+    {
+        foreach (var (type, payload) in new BoxEnumerator(moov))
+        {
+            if (type == Trak && _trackId == 0)
+            {
+                ParseTrak(payload);
+            }
+        }
+
+        // Fragment defaults need the track id, so mvex is looked at once the track is known
+        foreach (var (type, payload) in new BoxEnumerator(moov))
+        {
+            if (type == Mvex && _trackId != 0)
+            {
+                ParseMvex(payload);
+            }
+        }
+    }
+
+    private void ParseTrak(ReadOnlySpan<byte> trak)
+    {
+        var mdia = FindBox(trak, Mdia);
+        var hdlr = FindBox(mdia, Hdlr);
+        if (hdlr.Length < 12 || BinaryPrimitives.ReadUInt32BigEndian(hdlr.Slice(8)) != Vide)
+        {
+            return;
+        }
+
+        var stbl = FindBox(FindBox(mdia, Minf), Stbl);
+        if (!ParseStsd(FindBox(stbl, Stsd)))
+        {
+            return;
+        }
+
+        var tkhd = FindBox(trak, Tkhd);
+        var mdhd = FindBox(mdia, Mdhd);
+        if (tkhd.Length < 24 || mdhd.Length < 24)
+        {
+            throw new InvalidDataException("MP4 video track without tkhd or mdhd");
+        }
+
+        // Full box version decides between 32 and 64 bit creation and modification times
+        bool tkhdV1 = tkhd[0] == 1;
+        _trackId = BinaryPrimitives.ReadUInt32BigEndian(tkhd.Slice(tkhdV1 ? 20 : 12));
+        bool mdhdV1 = mdhd[0] == 1;
+        Timescale = BinaryPrimitives.ReadUInt32BigEndian(mdhd.Slice(mdhdV1 ? 20 : 12));
+        if (Timescale == 0)
+        {
+            throw new InvalidDataException("MP4 video track has a timescale of 0");
+        }
+
+        ParseSampleTable(stbl);
+    }
+
+    /// <summary>
+    /// Finds the avc1/avc3 sample entry and reads its avcC configuration
+    /// </summary>
+    private bool ParseStsd(ReadOnlySpan<byte> stsd)
+    {
+        if (stsd.Length < 8)
+        {
+            return false;
+        }
+
+        foreach (var (type, entry) in new BoxEnumerator(stsd.Slice(8)))
+        {
+            // Visual sample entry fields come before the child boxes
+            const int visualSampleEntrySize = 78;
+            if ((type != Avc1 && type != Avc3) || entry.Length < visualSampleEntrySize)
+            {
+                continue;
+            }
+
+            var avcC = FindBox(entry.Slice(visualSampleEntrySize), AvcC);
+            if (avcC.Length < 7)
+            {
+                continue;
+            }
+
+            NaluLengthSize = (avcC[4] & 0x03) + 1;
+            int position = 5;
+            for (int list = 0; list < 2; list++)
+            {
+                // SPS count is 5 bits, PPS count 8 bits
+                int count = list == 0 ? avcC[position] & 0x1F : avcC[position];
+                position++;
+                for (int i = 0; i < count && position + 2 <= avcC.Length; i++)
+                {
+                    int length = BinaryPrimitives.ReadUInt16BigEndian(avcC.Slice(position));
+                    position += 2;
+                    if (position + length > avcC.Length)
+                    {
+                        break;
+                    }
+
+                    _parameterSets.Add(avcC.Slice(position, length).ToArray());
+                    position += length;
+                }
+
+                if (position >= avcC.Length)
+                {
+                    break;
+                }
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    private void ParseSampleTable(ReadOnlySpan<byte> stbl)
+    {
+        var stsz = FindBox(stbl, Stsz);
+        if (stsz.Length < 12)
+        {
+            // Fragmented files have empty sample tables
+            return;
+        }
+
+        int sampleCount = (int)BinaryPrimitives.ReadUInt32BigEndian(stsz.Slice(8));
+        uint constantSize = BinaryPrimitives.ReadUInt32BigEndian(stsz.Slice(4));
+        if (sampleCount == 0)
+        {
+            return;
+        }
+
+        var offsets = GetChunkOffsets(stbl);
+        var stsc = FindBox(stbl, Stsc);
+        var stts = FindBox(stbl, Stts);
+        var ctts = FindBox(stbl, Ctts);
+        var stss = FindBox(stbl, Stss);
+
+        var entries = new Mp4Sample[sampleCount];
+
+        // Sample sizes and file offsets: stsc maps chunks to sample counts, samples of a chunk are contiguous
+        int sample = 0;
+        int stscEntries = stsc.Length >= 8 ? (int)BinaryPrimitives.ReadUInt32BigEndian(stsc.Slice(4)) : 0;
+        for (int e = 0; e < stscEntries && sample < sampleCount; e++)
+        {
+            var entry = stsc.Slice(8 + e * 12);
+            int firstChunk = (int)BinaryPrimitives.ReadUInt32BigEndian(entry) - 1;
+            int samplesPerChunk = (int)BinaryPrimitives.ReadUInt32BigEndian(entry.Slice(4));
+            int lastChunk = e + 1 < stscEntries
+                ? (int)BinaryPrimitives.ReadUInt32BigEndian(stsc.Slice(8 + (e + 1) * 12)) - 1
+                : offsets.Length;
+
+            for (int chunk = firstChunk; chunk < lastChunk && chunk < offsets.Length && sample < sampleCount; chunk++)
+            {
+                long offset = offsets[chunk];
+                for (int i = 0; i < samplesPerChunk && sample < sampleCount; i++, sample++)
+                {
+                    int size = CheckSampleSize(constantSize != 0
+                        ? constantSize
+                        : BinaryPrimitives.ReadUInt32BigEndian(stsz.Slice(12 + sample * 4)));
+                    entries[sample] = new Mp4Sample(offset, size, 0, 0, stss.Length == 0);
+                    offset += size;
+                }
+            }
+        }
+
+        if (sample < sampleCount)
+        {
+            _logger?.LogWarning("MP4 sample table maps only {Mapped} of {Count} samples to chunks", sample, sampleCount);
+            sampleCount = sample;
+        }
+
+        // Decoding times are run length coded durations
+        long decodeTime = 0;
+        sample = 0;
+        int sttsEntries = stts.Length >= 8 ? (int)BinaryPrimitives.ReadUInt32BigEndian(stts.Slice(4)) : 0;
+        for (int e = 0; e < sttsEntries && sample < sampleCount; e++)
+        {
+            uint count = BinaryPrimitives.ReadUInt32BigEndian(stts.Slice(8 + e * 8));
+            uint delta = BinaryPrimitives.ReadUInt32BigEndian(stts.Slice(12 + e * 8));
+            for (uint i = 0; i < count && sample < sampleCount; i++, sample++)
+            {
+                entries[sample] = entries[sample] with { DecodeTime = decodeTime };
+                decodeTime += delta;
+            }
+        }
+
+        // Composition offsets are signed in version 1, and in practice in version 0 as well
+        sample = 0;
+        int cttsEntries = ctts.Length >= 8 ? (int)BinaryPrimitives.ReadUInt32BigEndian(ctts.Slice(4)) : 0;
+        for (int e = 0; e < cttsEntries && sample < sampleCount; e++)
+        {
+            uint count = BinaryPrimitives.ReadUInt32BigEndian(ctts.Slice(8 + e * 8));
+            int compositionOffset = BinaryPrimitives.ReadInt32BigEndian(ctts.Slice(12 + e * 8));
+            for (uint i = 0; i < count && sample < sampleCount; i++, sample++)
+            {
+                entries[sample] = entries[sample] with { CompositionOffset = compositionOffset };
+            }
+        }
+
+        int stssEntries = stss.Length >= 8 ? (int)BinaryPrimitives.ReadUInt32BigEndian(stss.Slice(4)) : 0;
+        for (int e = 0; e < stssEntries; e++)
+        {
+            int syncSample = (int)BinaryPrimitives.ReadUInt32BigEndian(stss.Slice(8 + e * 4)) - 1;
+            if ((uint)syncSample < (uint)sampleCount)
+            {
+                entries[syncSample] = entries[syncSample] with { IsSync = true };
+            }
+        }
+
+        _samples.AddRange(entries.AsSpan(0, sampleCount));
+        _nextFragmentDecodeTime = decodeTime;
+    }
+
+    private static long[] GetChunkOffsets(ReadOnlySpan<byte> stbl)
+    {
+        var stco = FindBox(stbl, Stco);
+        if (stco.Length >= 8)
+        {
+            var offsets = new long[BinaryPrimitives.ReadUInt32BigEndian(stco.Slice(4))];
+            for (int i = 0; i < offsets.Length; i++)
+            {
+                offsets[i] = BinaryPrimitives.ReadUInt32BigEndian(stco.Slice(8 + i * 4));
+            }
+
+            return offsets;
+        }
+
+        var co64 = FindBox(stbl, Co64);
+        if (co64.Length >= 8)
+        {
+            var offsets = new long[BinaryPrimitives.ReadUInt32BigEndian(co64.Slice(4))];
+            for (int i = 0; i < offsets.Length; i++)
+            {
+                offsets[i] = BinaryPrimitives.ReadInt64BigEndian(co64.Slice(8 + i * 8));
+            }
+
+            return offsets;
+        }
+
+        throw new InvalidDataException("MP4 sample table without chunk offsets");
+    }
+
+    private void ParseMvex(ReadOnlySpan<byte> mvex)
+    {
+        foreach (var (type, trex) in new BoxEnumerator(mvex))
+        {
+            if (type == Trex && trex.Length >= 24 && BinaryPrimitives.ReadUInt32BigEndian(trex.Slice(4)) == _trackId)
+            {
+                _defaultSampleDuration = BinaryPrimitives.ReadUInt32BigEndian(trex.Slice(12));
+                _defaultSampleSize = BinaryPrimitives.ReadUInt32BigEndian(trex.Slice(16));
+                _defaultSampleFlags = BinaryPrimitives.ReadUInt32BigEndian(trex.Slice(20));
+            }
+        }
+    }
+
+    private void ParseMoof(ReadOnlySpan<byte> moof, long moofOffset)
+    {
+        foreach (var (type, traf) in new BoxEnumerator(moof))
+        {
+            if (type == Traf)
+            {
+                ParseTraf(traf, moofOffset);
+            }
+        }
+    }
+
+    private void ParseTraf(ReadOnlySpan<byte> traf, long moofOffset)
+    {
+        var tfhd = FindBox(traf, Tfhd);
+        if (tfhd.Length < 8 || BinaryPrimitives.ReadUInt32BigEndian(tfhd.Slice(4)) != _trackId)
+        {
+            return;
+        }
+
+        uint tfhdFlags = BinaryPrimitives.ReadUInt32BigEndian(tfhd) & 0xFFFFFF;
+        int position = 8;
+
+        // Without an explicit base offset sample data is relative to the moof, as default-base-is-moof files have it
+        long baseDataOffset = moofOffset;
+        if ((tfhdFlags & 0x01) != 0)
+        {
+            baseDataOffset = BinaryPrimitives.ReadInt64BigEndian(tfhd.Slice(position));
+            position += 8;
+        }
+
+        if ((tfhdFlags & 0x02) != 0)
+        {
+            position += 4;
+        }
+
+        uint defaultDuration = _defaultSampleDuration;
+        uint defaultSize = _defaultSampleSize;
+        uint defaultFlags = _defaultSampleFlags;
+        if ((tfhdFlags & 0x08) != 0)
+        {
+            defaultDuration = BinaryPrimitives.ReadUInt32BigEndian(tfhd.Slice(position));
+            position += 4;
+        }
+
+        if ((tfhdFlags & 0x10) != 0)
+        {
+            defaultSize = BinaryPrimitives.ReadUInt32BigEndian(tfhd.Slice(position));
+            position += 4;
+        }
+
+        if ((tfhdFlags & 0x20) != 0)
+        {
+            defaultFlags = BinaryPrimitives.ReadUInt32BigEndian(tfhd.Slice(position));
+        }
+
+        var tfdt = FindBox(traf, Tfdt);
+        if (tfdt.Length >= 8)
+        {
+            _nextFragmentDecodeTime = tfdt[0] == 1
+                ? BinaryPrimitives.ReadInt64BigEndian(tfdt.Slice(4))
+                : BinaryPrimitives.ReadUInt32BigEndian(tfdt.Slice(4));
+        }
+
+        long dataOffset = baseDataOffset;
+        foreach (var (type, trun) in new BoxEnumerator(traf))
+        {
+            if (type == Trun)
+            {
+                dataOffset = ParseTrun(trun, baseDataOffset, dataOffset, defaultDuration, defaultSize, defaultFlags);
+            }
+        }
+    }
+
+    /// <returns>File offset following the samples of the run</returns>
+    private long ParseTrun(ReadOnlySpan<byte> trun, long baseDataOffset, long dataOffset, uint defaultDuration,
+        uint defaultSize, uint defaultFlags)
+    {
+        uint flags = BinaryPrimitives.ReadUInt32BigEndian(trun) & 0xFFFFFF;
+        int sampleCount = (int)BinaryPrimitives.ReadUInt32BigEndian(trun.Slice(4));
+        int position = 8;
+
+        if ((flags & 0x001) != 0)
+        {
+            dataOffset = baseDataOffset + BinaryPrimitives.ReadInt32BigEndian(trun.Slice(position));
+            position += 4;
+        }
+
+        uint? firstSampleFlags = null;
+        if ((flags & 0x004) != 0)
+        {
+            firstSampleFlags = BinaryPrimitives.ReadUInt32BigEndian(trun.Slice(position));
+            position += 4;
+        }
+
+        int fieldSize = 4 * System.Numerics.BitOperations.PopCount(flags & 0xF00);
+        for (int i = 0; i < sampleCount && position + fieldSize <= trun.Length; i++)
+        {
+            uint duration = defaultDuration;
+            uint size = defaultSize;
+            uint sampleFlags = i == 0 && firstSampleFlags.HasValue ? firstSampleFlags.Value : defaultFlags;
+            int compositionOffset = 0;
+
+            if ((flags & 0x100) != 0)
+            {
+                duration = BinaryPrimitives.ReadUInt32BigEndian(trun.Slice(position));
+                position += 4;
+            }
+
+            if ((flags & 0x200) != 0)
+            {
+                size = BinaryPrimitives.ReadUInt32BigEndian(trun.Slice(position));
+                position += 4;
+            }
+
+            if ((flags & 0x400) != 0)
+            {
+                uint explicitFlags = BinaryPrimitives.ReadUInt32BigEndian(trun.Slice(position));
+                sampleFlags = i == 0 && firstSampleFlags.HasValue ? firstSampleFlags.Value : explicitFlags;
+                position += 4;
+            }
+
+            if ((flags & 0x800) != 0)
+            {
+                compositionOffset = BinaryPrimitives.ReadInt32BigEndian(trun.Slice(position));
+                position += 4;
+            }
+
+            // sample_is_non_sync_sample
+            bool isSync = (sampleFlags & 0x00010000) == 0;
+            _samples.Add(new Mp4Sample(dataOffset, CheckSampleSize(size), _nextFragmentDecodeTime, compositionOffset, isSync));
+            dataOffset += size;
+            _nextFragmentDecodeTime += duration;
+        }
+
+        return dataOffset;
+    }
+
+    /// <summary>
+    /// Sample sizes are unsigned 32 bit values, a corrupt one must neither turn negative nor make the reader allocate
+    /// gigabytes
+    /// </summary>
+    private static int CheckSampleSize(uint size)
+    {
+        if (size > MaxSampleSize)
+        {
+            throw new InvalidDataException($"MP4 sample of {size} bytes is too large");
+        }
+
+        return (int)size;
+    }
+
+    /// <summary>
+    /// Payload of the first child box of a type, empty if there is none
+    /// </summary>
+    private static ReadOnlySpan<byte> FindBox(ReadOnlySpan<byte> container, uint boxType)
+    {
+        foreach (var (type, payload) in new BoxEnumerator(container))
+        {
+            if (type == boxType)
+            {
+                return payload;
+            }
+        }
+
+        return ReadOnlySpan<byte>.Empty;
+    }
+
+    private static uint FourCc(string fourCc)
+    {
+        return (uint)(fourCc[0] << 24 | fourCc[1] << 16 | fourCc[2] << 8 | fourCc[3]);
+    }
+
+    private static string FourCcToString(uint fourCc)
+    {
+        Span<char> chars = stackalloc char[4];
+        for (int i = 0; i < 4; i++)
+        {
+            chars[i] = (char)(byte)(fourCc >> (24 - 8 * i));
+        }
+
+        return new string(chars);
+    }
+
+    /// <summary>
+    /// Enumerates the child boxes of a container held in memory
+    /// </summary>
+    private ref struct BoxEnumerator
+    {
+        private ReadOnlySpan<byte> _remaining;
+
+        public BoxEnumerator(ReadOnlySpan<byte> container)
+        {
+            _remaining = container;
+            Current = default;
+        }
+
+        public Box Current { get; private set; }
+
+        public BoxEnumerator GetEnumerator() => this;
+
+        public bool MoveNext()
+        {
+            if (_remaining.Length < BoxHeaderSize)
+            {
+                return false;
+            }
+
+            long size = BinaryPrimitives.ReadUInt32BigEndian(_remaining);
+            uint type = BinaryPrimitives.ReadUInt32BigEndian(_remaining.Slice(4));
+            int headerSize = BoxHeaderSize;
+            if (size == 1)
+            {
+                if (_remaining.Length < 16)
+                {
+                    return false;
+                }
+
+                size = BinaryPrimitives.ReadInt64BigEndian(_remaining.Slice(8));
+                headerSize = 16;
+            }
+            else if (size == 0)
+            {
+                size = _remaining.Length;
+            }
+
+            if (size < headerSize || size > _remaining.Length)
+            {
+                return false;
+            }
+
+            Current = new Box(type, _remaining.Slice(headerSize, (int)size - headerSize));
+            _remaining = _remaining.Slice((int)size);
+            return true;
+        }
+    }
+
+    private readonly ref struct Box
+    {
+        private readonly uint _type;
+        private readonly ReadOnlySpan<byte> _payload;
+
+        public Box(uint type, ReadOnlySpan<byte> payload)
+        {
+            _type = type;
+            _payload = payload;
+        }
+
+        public void Deconstruct(out uint type, out ReadOnlySpan<byte> payload)
+        {
+            type = _type;
+            payload = _payload;
+        }
+    }
+}
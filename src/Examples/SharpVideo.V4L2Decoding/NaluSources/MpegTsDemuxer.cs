@@ -0,0 +1,621 @@
+using System.Buffers.Binary;
+using Microsoft.Extensions.Logging;
+using SharpVideo.H264;
+
+namespace SharpVideo.V4L2Decoding.NaluSources;
+
+/// <summary>
+/// Extracts the H.264 NAL units of the first program of an MPEG transport stream (ISO/IEC 13818-1).
+/// Finds the video PID through PAT and PMT, reassembles every PES packet in a pooled <see cref="H264NaluBuffer"/> and
+/// emits its Annex-B NAL units as views into that buffer, carrying the PES time stamps. The buffer goes back to the
+/// pool once the consumer released all of them. The PCR of the program is tracked for pacing.
+/// </summary>
+/// <remarks>
+/// Not thread safe, all methods have to be called from the same thread.
+/// </remarks>
+internal sealed class MpegTsDemuxer
+{
+    public const int PacketSize = 188;
+    private const byte SyncByte = 0x47;
+    private const int PatPid = 0x0000;
+    private const int NullPid = 0x1FFF;
+    private const byte PatTableId = 0x00;
+    private const byte PmtTableId = 0x02;
+    private const byte H264StreamType = 0x1B;
+    private const int MaxSectionLength = 1024;
+    private const int MinPesBufferSize = 64 * 1024;
+    private const int MaxPesSize = 16 * 1024 * 1024;
+
+    /// <summary>
+    /// PCR values wrap at 2^33 * 300 ticks of the 27 MHz system clock
+    /// </summary>
+    public const long PcrModulus = (1L << 33) * 300;
+
+    private static readonly uint[] Crc32Table = CreateCrc32Table();
+    private static ReadOnlySpan<byte> StartCode => [0, 0, 1];
+
+    private readonly Func<H264Nalu, bool> _output;
+    private readonly ILogger? _logger;
+    private readonly sbyte[] _continuityCounters = new sbyte[NullPid + 1];
+    private readonly SectionAssembler _patAssembler = new();
+    private readonly SectionAssembler _pmtAssembler = new();
+
+    private int _pmtPid = -1;
+    private int _videoPid = -1;
+    private int _pcrPid = -1;
+    private int _patVersion = -1;
+    private int _pmtVersion = -1;
+
+    private H264NaluBuffer? _pesBuffer;
+    private int _pesLength;
+    private int _pesCapacityHint = MinPesBufferSize;
+    private int _pesExpectedLength;
+    private bool _pesActive;
+    private long? _pesPts;
+    private long? _pesDts;
+
+    private bool _inSync = true;
+
+    /// <param name="output">Receives every NAL unit and has to <see cref="H264Nalu.Release"/> it once consumed,
+    /// returns false if it had to be dropped</param>
+    /// <param name="logger">Optional logger</param>
+    public MpegTsDemuxer(Func<H264Nalu, bool> output, ILogger? logger = null)
+    {
+        _output = output;
+        _logger = logger;
+        _continuityCounters.AsSpan().Fill(-1);
+    }
+
+    /// <summary>
+    /// Last program clock reference in 27 MHz ticks, -1 until the first one was received
+    /// </summary>
+    public long Pcr { get; private set; } = -1;
+
+    /// <summary>
+    /// Number of packets lost on the video and PSI PIDs, detected by their continuity counters
+    /// </summary>
+    public int ContinuityErrors { get; private set; }
+
+    /// <summary>
+    /// Number of times the packet sync was lost and searched for again
+    /// </summary>
+    public int SyncLosses { get; private set; }
+
+    /// <summary>
+    /// Number of NAL units the output did not accept
+    /// </summary>
+    public int DroppedNalus { get; private set; }
+
+    /// <summary>
+    /// Demultiplexes all complete packets of a buffer, e.g. the 7 packets of a UDP datagram or a chunk of a file
+    /// </summary>
+    /// <returns>Number of bytes consumed, the rest is an incomplete packet to be passed again with more data</returns>
+    public int Demux(ReadOnlySpan<byte> data)
+    {
+        int offset = 0;
+        while (data.Length - offset >= PacketSize)
+        {
+            if (data[offset] != SyncByte || !IsSyncConfirmed(data, offset))
+            {
+                if (_inSync)
+                {
+                    _inSync = false;
+                    SyncLosses++;
+                    _logger?.LogWarning("MPEG-TS sync lost at byte {Offset} of the buffer, resynchronizing", offset);
+                }
+
+                int next = data.Slice(offset + 1).IndexOf(SyncByte);
+                if (next < 0)
+                {
+                    return data.Length;
+                }
+
+                offset += 1 + next;
+                continue;
+            }
+
+            _inSync = true;
+            ProcessPacket(data.Slice(offset, PacketSize));
+            offset += PacketSize;
+        }
+
+        return offset;
+    }
+
+    /// <summary>
+    /// Emits the PES packet still being assembled, at the end of the stream
+    /// </summary>
+    public void Flush()
+    {
+        FlushPes();
+    }
+
+    /// <summary>
+    /// A sync byte only counts if the next packet in the buffer starts with one as well, 0x47 is common in payloads
+    /// </summary>
+    private static bool IsSyncConfirmed(ReadOnlySpan<byte> data, int offset)
+    {
+        return offset + PacketSize >= data.Length || data[offset + PacketSize] == SyncByte;
+    }
+
+    private void ProcessPacket(ReadOnlySpan<byte> packet)
+    {
+        // Packets the demodulator flagged as corrupt, and scrambled ones, are useless
+        if ((packet[1] & 0x80) != 0 || (packet[3] & 0xC0) != 0)
+        {
+            return;
+        }
+
+        int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+
+        // Audio, data and null packets are the majority, they are skipped before anything else is looked at
+        if (pid != _videoPid && pid != PatPid && pid != _pmtPid && pid != _pcrPid)
+        {
+            return;
+        }
+
+        bool payloadUnitStart = (packet[1] & 0x40) != 0;
+        int adaptationFieldControl = (packet[3] >> 4) & 0x03;
+        int continuityCounter = packet[3] & 0x0F;
+        int offset = 4;
+        bool discontinuity = false;
+
+        if ((adaptationFieldControl & 0x02) != 0)
+        {
+            int adaptationFieldLength = packet[4];
+            if (adaptationFieldLength > 0)
+            {
+                byte flags = packet[5];
+                discontinuity = (flags & 0x80) != 0;
+                if (pid == _pcrPid && (flags & 0x10) != 0 && adaptationFieldLength >= 7)
+                {
+                    Pcr = ReadPcr(packet.Slice(6));
+                }
+            }
+
+            offset = 5 + adaptationFieldLength;
+        }
+
+        // A PID that only carries the PCR is done here
+        if ((adaptationFieldControl & 0x01) == 0 || offset >= PacketSize || (pid != _videoPid && pid != PatPid && pid != _pmtPid))
+        {
+            return;
+        }
+
+        if (!CheckContinuity(pid, continuityCounter, discontinuity, out bool lost))
+        {
+            // Duplicate packet, allowed once by the standard
+            return;
+        }
+
+        var payload = packet.Slice(offset);
+        if (pid == _videoPid)
+        {
+            if (lost)
+            {
+                DropPes();
+            }
+
+            ProcessPes(payload, payloadUnitStart);
+        }
+        else
+        {
+            var assembler = pid == PatPid ? _patAssembler : _pmtAssembler;
+            if (lost)
+            {
+                assembler.Reset();
+            }
+
+            ProcessPsi(pid, assembler, payload, payloadUnitStart);
+        }
+    }
+
+    /// <summary>
+    /// Checks the continuity counter of a packet with payload
+    /// </summary>
+    /// <returns>False for a duplicate of the previous packet</returns>
+    private bool CheckContinuity(int pid, int continuityCounter, bool discontinuity, out bool lost)
+    {
+        lost = false;
+        int last = _continuityCounters[pid];
+        _continuityCounters[pid] = (sbyte)continuityCounter;
+        if (last < 0 || discontinuity)
+        {
+            return true;
+        }
+
+        if (continuityCounter == last)
+        {
+            return false;
+        }
+
+        if (continuityCounter != ((last + 1) & 0x0F))
+        {
+            lost = true;
+            ContinuityErrors++;
+            if (_logger != null && _logger.IsEnabled(LogLevel.Debug))
+            {
+                _logger.LogDebug("MPEG-TS continuity error on PID {Pid}: expected {Expected}, got {Actual}",
+                    pid, (last + 1) & 0x0F, continuityCounter);
+            }
+        }
+
+        return true;
+    }
+
+    private void ProcessPsi(int pid, SectionAssembler assembler, ReadOnlySpan<byte> payload, bool payloadUnitStart)
+    {
+        if (payloadUnitStart)
+        {
+            int pointer = payload[0];
+            payload = payload.Slice(1);
+            if (pointer > payload.Length)
+            {
+                assembler.Reset();
+                return;
+            }
+
+            // The bytes before the pointer finish the section started in an earlier packet
+            if (assembler.IsActive && assembler.Append(payload.Slice(0, pointer), out _))
+            {
+                ProcessSection(pid, assembler.Section);
+            }
+
+            assembler.Reset();
+            payload = payload.Slice(pointer);
+
+            // Several sections may follow each other, the rest of the packet is stuffed with 0xFF
+            while (payload.Length > 0 && payload[0] != 0xFF)
+            {
+                assembler.Start();
+                if (!assembler.Append(payload, out int consumed))
+                {
+                    return;
+                }
+
+                ProcessSection(pid, assembler.Section);
+                payload = payload.Slice(consumed);
+            }
+        }
+        else if (assembler.IsActive && assembler.Append(payload, out _))
+        {
+            ProcessSection(pid, assembler.Section);
+        }
+    }
+
+    private void ProcessSection(int pid, ReadOnlySpan<byte> section)
+    {
+        // Table id, lengths, versions, and the CRC at the end
+        if (section.Length < 12 || (section[1] & 0x80) == 0 || ComputeCrc32(section) != 0)
+        {
+            return;
+        }
+
+        bool currentNext = (section[5] & 0x01) != 0;
+        int version = (section[5] >> 1) & 0x1F;
+        if (!currentNext)
+        {
+            return;
+        }
+
+        var body = section.Slice(8, section.Length - 12);
+        if (pid == PatPid && section[0] == PatTableId && version != _patVersion)
+        {
+            _patVersion = version;
+            ProcessPat(body);
+        }
+        else if (pid == _pmtPid && section[0] == PmtTableId && version != _pmtVersion)
+        {
+            _pmtVersion = version;
+            ProcessPmt(BinaryPrimitives.ReadUInt16BigEndian(section.Slice(3)), body);
+        }
+    }
+
+    private void ProcessPat(ReadOnlySpan<byte> programs)
+    {
+        for (int i = 0; i + 4 <= programs.Length; i += 4)
+        {
+            int programNumber = BinaryPrimitives.ReadUInt16BigEndian(programs.Slice(i));
+            int pid = BinaryPrimitives.ReadUInt16BigEndian(programs.Slice(i + 2)) & 0x1FFF;
+
+            // Program 0 points to the network information table
+            if (programNumber == 0)
+            {
+                continue;
+            }
+
+            if (pid != _pmtPid)
+            {
+                _logger?.LogInformation("MPEG-TS program {Program} has its PMT on PID {Pid}", programNumber, pid);
+                _pmtPid = pid;
+                _pmtVersion = -1;
+                _pmtAssembler.Reset();
+            }
+
+            return;
+        }
+    }
+
+    private void ProcessPmt(int programNumber, ReadOnlySpan<byte> body)
+    {
+        if (body.Length < 4)
+        {
+            return;
+        }
+
+        int pcrPid = BinaryPrimitives.ReadUInt16BigEndian(body) & 0x1FFF;
+        int programInfoLength = BinaryPrimitives.ReadUInt16BigEndian(body.Slice(2)) & 0x0FFF;
+        var streams = body.Slice(Math.Min(4 + programInfoLength, body.Length));
+
+        while (streams.Length >= 5)
+        {
+            byte streamType = streams[0];
+            int pid = BinaryPrimitives.ReadUInt16BigEndian(streams.Slice(1)) & 0x1FFF;
+            int esInfoLength = BinaryPrimitives.ReadUInt16BigEndian(streams.Slice(3)) & 0x0FFF;
+
+            if (streamType == H264StreamType)
+            {
+                if (pid != _videoPid)
+                {
+                    _logger?.LogInformation(
+                        "MPEG-TS program {Program}: H.264 video on PID {Pid}, PCR on PID {PcrPid}",
+                        programNumber, pid, pcrPid);
+                    DropPes();
+                    _videoPid = pid;
+                }
+
+                _pcrPid = pcrPid == NullPid ? -1 : pcrPid;
+                return;
+            }
+
+            streams = streams.Slice(Math.Min(5 + esInfoLength, streams.Length));
+        }
+
+        _logger?.LogWarning("MPEG-TS program {Program} has no H.264 video stream", programNumber);
+    }
+
+    private void ProcessPes(ReadOnlySpan<byte> payload, bool payloadUnitStart)
+    {
+        if (payloadUnitStart)
+        {
+            FlushPes();
+            StartPes(payload);
+        }
+        else if (_pesActive)
+        {
+            AppendPes(payload);
+        }
+    }
+
+    private void StartPes(ReadOnlySpan<byte> payload)
+    {
+        // Start code prefix, stream id, length, two flag bytes and the header data length
+        if (payload.Length < 9 || !payload.StartsWith(StartCode))
+        {
+            return;
+        }
+
+        int pesPacketLength = BinaryPrimitives.ReadUInt16BigEndian(payload.Slice(4));
+        int ptsDtsFlags = payload[7] >> 6;
+        int headerDataLength = payload[8];
+        int headerLength = 9 + headerDataLength;
+        if (headerLength > payload.Length)
+        {
+            return;
+        }
+
+        _pesPts = ptsDtsFlags >= 2 && headerDataLength >= 5 ? ReadTimestamp(payload.Slice(9)) : null;
+        _pesDts = ptsDtsFlags == 3 && headerDataLength >= 10 ? ReadTimestamp(payload.Slice(14)) : _pesPts;
+
+        // Video PES packets are usually unbounded (length 0) and end where the next one starts
+        _pesExpectedLength = pesPacketLength == 0 ? 0 : pesPacketLength - 3 - headerDataLength;
+        _pesLength = 0;
+        _pesActive = true;
+
+        // Sized like the previous PES packet, the buffer of a dropped one is reused
+        _pesBuffer ??= new H264NaluBuffer(_pesCapacityHint);
+        AppendPes(payload.Slice(headerLength));
+    }
+
+    private void AppendPes(ReadOnlySpan<byte> data)
+    {
+        var pesBuffer = _pesBuffer!;
+        if (_pesLength + data.Length > pesBuffer.Array.Length)
+        {
+            if (_pesLength + data.Length > MaxPesSize)
+            {
+                _logger?.LogWarning("MPEG-TS PES packet exceeds {Size} bytes, dropped", MaxPesSize);
+                DropPes();
+                return;
+            }
+
+            pesBuffer.Grow(Math.Min(Math.Max(pesBuffer.Array.Length * 2, _pesLength + data.Length), MaxPesSize), _pesLength);
+        }
+
+        data.CopyTo(pesBuffer.Array.AsSpan(_pesLength));
+        _pesLength += data.Length;
+
+        // A bounded PES is complete without waiting for the next one
+        if (_pesExpectedLength > 0 && _pesLength >= _pesExpectedLength)
+        {
+            _pesLength = _pesExpectedLength;
+            FlushPes();
+        }
+    }
+
+    private void DropPes()
+    {
+        _pesActive = false;
+        _pesLength = 0;
+    }
+
+    /// <summary>
+    /// Splits the assembled PES payload into NAL units at the Annex-B start codes, the NAL units take over its buffer
+    /// </summary>
+    private void FlushPes()
+    {
+        if (!_pesActive)
+        {
+            return;
+        }
+
+        var pesBuffer = _pesBuffer!;
+        var pes = pesBuffer.Array.AsSpan(0, _pesLength);
+        _pesBuffer = null;
+        _pesCapacityHint = Math.Max(_pesLength, MinPesBufferSize);
+        DropPes();
+
+        int position = pes.IndexOf(StartCode);
+        while (position >= 0)
+        {
+            int startCodeLength = position > 0 && pes[position - 1] == 0 ? 4 : 3;
+            int naluStart = position + 3 - startCodeLength;
+
+            int next = pes.Slice(position + 3).IndexOf(StartCode);
+            int naluEnd = next < 0 ? pes.Length : position + 3 + next;
+
+            // The leading zero of a 4 byte start code belongs to the next NAL unit
+            if (next >= 0 && pes[naluEnd - 1] == 0)
+            {
+                naluEnd--;
+            }
+
+            if (naluEnd - naluStart > startCodeLength)
+            {
+                var nalu = new H264Nalu(pesBuffer, naluStart, naluEnd - naluStart, startCodeLength, _pesPts, _pesDts);
+                if (!_output(nalu))
+                {
+                    nalu.Release();
+                    DroppedNalus++;
+                }
+            }
+
+            position = next < 0 ? -1 : position + 3 + next;
+        }
+
+        pesBuffer.Release();
+    }
+
+    /// <summary>
+    /// Reads a 33 bit PTS or DTS in 90 kHz units
+    /// </summary>
+    private static long ReadTimestamp(ReadOnlySpan<byte> data)
+    {
+        return ((long)(data[0] & 0x0E) << 29) |
+               ((long)data[1] << 22) |
+               ((long)(data[2] & 0xFE) << 14) |
+               ((long)data[3] << 7) |
+               ((long)data[4] >> 1);
+    }
+
+    /// <summary>
+    /// Reads a program clock reference in 27 MHz ticks: a 33 bit base in 90 kHz units and a 9 bit extension
+    /// </summary>
+    private static long ReadPcr(ReadOnlySpan<byte> data)
+    {
+        long pcrBase = ((long)BinaryPrimitives.ReadUInt32BigEndian(data) << 1) | ((long)data[4] >> 7);
+        int pcrExtension = ((data[4] & 0x01) << 8) | data[5];
+        return pcrBase * 300 + pcrExtension;
+    }
+
+    /// <summary>
+    /// CRC-32/MPEG-2 over a section including its CRC field, 0 if the section is intact
+    /// </summary>
+    private static uint ComputeCrc32(ReadOnlySpan<byte> data)
+    {
+        uint crc = 0xFFFFFFFF;
+        foreach (byte b in data)
+        {
+            crc = (crc << 8) ^ Crc32Table[(crc >> 24) ^ b];
+        }
+
+        return crc;
+    }
+
+    private static uint[] CreateCrc32Table()
+    {
+        var table = new uint[256];
+        for (uint i = 0; i < table.Length; i++)
+        {
+            uint crc = i << 24;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 0x80000000) != 0 ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+            }
+
+            table[i] = crc;
+        }
+
+        return table;
+    }
+
+    /// <summary>
+    /// Collects a PSI section that may span several packets
+    /// </summary>
+    private sealed class SectionAssembler
+    {
+        private readonly byte[] _buffer = new byte[MaxSectionLength + 3];
+        private int _length;
+
+        public bool IsActive { get; private set; }
+
+        public ReadOnlySpan<byte> Section => _buffer.AsSpan(0, _length);
+
+        public void Start()
+        {
+            IsActive = true;
+            _length = 0;
+        }
+
+        public void Reset()
+        {
+            IsActive = false;
+            _length = 0;
+        }
+
+        /// <summary>
+        /// Appends data until the section is complete
+        /// </summary>
+        /// <param name="data">Data following the part of the section collected so far</param>
+        /// <param name="consumed">Number of bytes of <paramref name="data"/> that belong to the section</param>
+        /// <returns>True once the section is complete</returns>
+        public bool Append(ReadOnlySpan<byte> data, out int consumed)
+        {
+            consumed = 0;
+            while (true)
+            {
+                // The first 3 bytes hold the table id and the section length
+                int needed = _length < 3
+                    ? 3 - _length
+                    : 3 + (((_buffer[1] & 0x0F) << 8) | _buffer[2]) - _length;
+                int count = Math.Min(needed, data.Length - consumed);
+                data.Slice(consumed, count).CopyTo(_buffer.AsSpan(_length));
+                _length += count;
+                consumed += count;
+
+                if (count < needed)
+                {
+                    return false;
+                }
+
+                if (_length == 3)
+                {
+                    int sectionLength = ((_buffer[1] & 0x0F) << 8) | _buffer[2];
+                    if (sectionLength > MaxSectionLength)
+                    {
+                        Reset();
+                        return false;
+                    }
+
+                    if (sectionLength > 0)
+                    {
+                        continue;
+                    }
+                }
+
+                IsActive = false;
+                return true;
+            }
+        }
+    }
+}
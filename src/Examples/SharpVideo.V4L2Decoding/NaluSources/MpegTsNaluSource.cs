@@ -0,0 +1,245 @@
+using System.Diagnostics;
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using SharpVideo.H264;
+using SharpVideo.Utils;
+
+namespace SharpVideo.V4L2Decoding.NaluSources;
+
+/// <summary>
+/// Provides the H.264 NAL units of an MPEG transport stream, read from a stream (file, pipe) or pushed as UDP
+/// datagrams. NAL units carry the PTS and DTS of their PES packet.
+/// </summary>
+[SupportedOSPlatform("linux")]
+public class MpegTsNaluSource : INaluSource
+{
+    /// <summary>
+    /// Reads are a multiple of the usual 7 packet datagram
+    /// </summary>
+    private const int ReadBufferSize = MpegTsDemuxer.PacketSize * 7 * 32;
+
+    /// <summary>
+    /// A larger jump between PCR and wall clock is a discontinuity (loop, splice) and restarts pacing
+    /// </summary>
+    private static readonly TimeSpan MaxPcrDrift = TimeSpan.FromSeconds(2);
+
+    private readonly Stream? _stream;
+    private readonly bool _paceByPcr;
+    private readonly ILogger<MpegTsNaluSource>? _logger;
+    private readonly SpscRing<H264Nalu> _naluQueue;
+    private readonly MpegTsDemuxer _demuxer;
+    private Task? _readTask;
+    private CancellationTokenSource? _cts;
+    private bool _started;
+    private bool _disposed;
+    private long _pcrAnchor = -1;
+    private long _pcrAnchorTimestamp;
+
+    /// <summary>
+    /// Creates a source reading the transport stream from a stream until its end
+    /// </summary>
+    /// <param name="stream">Transport stream, e.g. a .ts file</param>
+    /// <param name="logger">Optional logger</param>
+    /// <param name="queueCapacity">Capacity of the NAL unit ring, the reader blocks while the decoder is behind</param>
+    /// <param name="paceByPcr">Reads no faster than the program clock advances, to play a file in real time</param>
+    public MpegTsNaluSource(Stream stream, ILogger<MpegTsNaluSource>? logger = null, int queueCapacity = 100, bool paceByPcr = false)
+        : this(stream ?? throw new ArgumentNullException(nameof(stream)), paceByPcr, logger, queueCapacity)
+    {
+    }
+
+    /// <summary>
+    /// Creates a source fed through <see cref="PushPackets"/>, e.g. with the datagrams of a UDP multicast
+    /// </summary>
+    /// <param name="logger">Optional logger</param>
+    /// <param name="queueCapacity">Capacity of the NAL unit ring, NAL units are dropped while it is full</param>
+    public MpegTsNaluSource(ILogger<MpegTsNaluSource>? logger = null, int queueCapacity = 100)
+        : this(null, false, logger, queueCapacity)
+    {
+    }
+
+    private MpegTsNaluSource(Stream? stream, bool paceByPcr, ILogger<MpegTsNaluSource>? logger, int queueCapacity)
+    {
+        _stream = stream;
+        _paceByPcr = paceByPcr;
+        _logger = logger;
+        _naluQueue = new SpscRing<H264Nalu>(queueCapacity);
+
+        // A file reader waits for the decoder, a live feed cannot and drops instead
+        _demuxer = stream != null
+            ? new MpegTsDemuxer(PushNaluBlocking, logger)
+            : new MpegTsDemuxer(_naluQueue.TryPush, logger);
+    }
+
+    public SpscRing<H264Nalu> NaluQueue => _naluQueue;
+
+    /// <summary>
+    /// Number of packets lost on the video and PSI PIDs
+    /// </summary>
+    public int ContinuityErrors => _demuxer.ContinuityErrors;
+
+    /// <summary>
+    /// Number of NAL units dropped because the queue was full
+    /// </summary>
+    public int DroppedNalus => _demuxer.DroppedNalus;
+
+    public Task StartAsync(CancellationToken cancellationToken = default)
+    {
+        if (_started)
+        {
+            throw new InvalidOperationException("MpegTsNaluSource already started");
+        }
+
+        _started = true;
+        if (_stream != null)
+        {
+            _cts = CancellationTokenSource.CreateLinkedTokenSource(cancellationToken);
+            _readTask = Task.Run(() => ReadStreamAsync(_cts.Token));
+        }
+
+        _logger?.LogInformation("MPEG-TS NALU source started");
+        return Task.CompletedTask;
+    }
+
+    public async Task StopAsync()
+    {
+        if (!_started)
+        {
+            return;
+        }
+
+        _logger?.LogInformation("Stopping MPEG-TS NALU source");
+        _started = false;
+
+        if (_readTask != null)
+        {
+            _cts!.Cancel();
+            await _readTask;
+        }
+        else
+        {
+            _naluQueue.Complete();
+        }
+
+        _logger?.LogInformation("MPEG-TS NALU source stopped, {Errors} continuity errors", _demuxer.ContinuityErrors);
+    }
+
+    /// <summary>
+    /// Demultiplexes whole transport stream packets, typically the 7 packets of one UDP datagram.
+    /// Must always be called from the same thread, typically the network receive thread.
+    /// </summary>
+    /// <param name="packets">One or more 188 byte packets</param>
+    /// <returns>False if the source is not started or was created to read a stream</returns>
+    public bool PushPackets(ReadOnlySpan<byte> packets)
+    {
+        if (!_started || _disposed || _stream != null)
+        {
+            return false;
+        }
+
+        // A datagram never splits a packet, an incomplete tail is garbage
+        _demuxer.Demux(packets);
+        return true;
+    }
+
+    private bool PushNaluBlocking(H264Nalu nalu)
+    {
+        return _naluQueue.TryPush(nalu, Timeout.Infinite, _cts!.Token);
+    }
+
+    private async Task ReadStreamAsync(CancellationToken cancellationToken)
+    {
+        var buffer = new byte[ReadBufferSize];
+        int filled = 0;
+        long totalBytesRead = 0;
+
+        try
+        {
+            int bytesRead;
+            while ((bytesRead = await _stream!.ReadAsync(buffer.AsMemory(filled), cancellationToken)) > 0)
+            {
+                filled += bytesRead;
+                totalBytesRead += bytesRead;
+
+                int consumed = _demuxer.Demux(buffer.AsSpan(0, filled));
+                filled -= consumed;
+                buffer.AsSpan(consumed, filled).CopyTo(buffer);
+
+                if (_paceByPcr)
+                {
+                    await PaceAsync(cancellationToken);
+                }
+            }
+
+            _demuxer.Flush();
+            _logger?.LogInformation("Completed reading transport stream: {Bytes} bytes total", totalBytesRead);
+        }
+        catch (OperationCanceledException)
+        {
+            _logger?.LogDebug("Transport stream reading cancelled");
+        }
+        catch (Exception ex)
+        {
+            _logger?.LogError(ex, "Error reading transport stream");
+            throw;
+        }
+        finally
+        {
+            _naluQueue.Complete();
+        }
+    }
+
+    /// <summary>
+    /// Waits until the wall clock caught up with the last PCR
+    /// </summary>
+    private async Task PaceAsync(CancellationToken cancellationToken)
+    {
+        long pcr = _demuxer.Pcr;
+        if (pcr < 0)
+        {
+            return;
+        }
+
+        if (_pcrAnchor < 0)
+        {
+            _pcrAnchor = pcr;
+            _pcrAnchorTimestamp = Stopwatch.GetTimestamp();
+            return;
+        }
+
+        // 27 MHz ticks to 100 ns ticks
+        long pcrElapsed = (pcr - _pcrAnchor + MpegTsDemuxer.PcrModulus) % MpegTsDemuxer.PcrModulus;
+        var ahead = TimeSpan.FromTicks(pcrElapsed * 10 / 27) - Stopwatch.GetElapsedTime(_pcrAnchorTimestamp);
+        if (ahead > MaxPcrDrift || ahead < -MaxPcrDrift)
+        {
+            _logger?.LogDebug("PCR discontinuity of {Drift}, restarting pacing", ahead);
+            _pcrAnchor = pcr;
+            _pcrAnchorTimestamp = Stopwatch.GetTimestamp();
+            return;
+        }
+
+        if (ahead > TimeSpan.FromMilliseconds(1))
+        {
+            await Task.Delay(ahead, cancellationToken);
+        }
+    }
+
+    public async ValueTask DisposeAsync()
+    {
+        if (_disposed)
+        {
+            return;
+        }
+
+        _disposed = true;
+
+        await StopAsync();
+
+        _cts?.Dispose();
+        _naluQueue.Dispose();
+
+        if (_stream != null)
+        {
+            await _stream.DisposeAsync();
+        }
+    }
+}
@@ -0,0 +1,35 @@
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using SharpVideo.IoUring;
+
+namespace SharpVideo.V4L2Decoding.NaluSources;
+
+/// <summary>
+/// Creates the NALU source matching a file
+/// </summary>
+[SupportedOSPlatform("linux")]
+public static class NaluSourceFactory
+{
+    /// <summary>
+    /// Picks the NALU source by file extension, anything that is not a container is read as an Annex-B stream
+    /// </summary>
+    /// <param name="filePath">File to read</param>
+    /// <param name="loggerFactory">Logger factory</param>
+    /// <param name="useIoUring">Read the file through io_uring with read-ahead if the kernel supports it</param>
+    public static INaluSource CreateFromFile(string filePath, ILoggerFactory loggerFactory, bool useIoUring = false)
+    {
+        return Path.GetExtension(filePath).ToLowerInvariant() switch
+        {
+            ".ts" => new MpegTsNaluSource(OpenRead(filePath, useIoUring), loggerFactory.CreateLogger<MpegTsNaluSource>()),
+            ".mp4" or ".m4v" or ".mov" => new Mp4NaluSource(filePath, loggerFactory.CreateLogger<Mp4NaluSource>(), useIoUring: useIoUring),
+            _ => new StreamNaluSource(OpenRead(filePath, useIoUring), loggerFactory.CreateLogger<StreamNaluSource>())
+        };
+    }
+
+    private static Stream OpenRead(string filePath, bool useIoUring)
+    {
+        return useIoUring && IoUringFileStream.IsSupported
+            ? IoUringFileStream.OpenRead(filePath)
+            : File.OpenRead(filePath);
+    }
+}
@@ -1,6 +1,7 @@
-using System.Collections.Concurrent;
+using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
 using SharpVideo.H264;
+using SharpVideo.Utils;
 
 namespace SharpVideo.V4L2Decoding.NaluSources;
 
@@ -8,10 +9,11 @@ namespace SharpVideo.V4L2Decoding.NaluSources;
 /// Provides H.264 NAL units received from RTP depacketizer.
 /// Designed for minimal latency - NAL units are pushed directly to queue as they arrive.
 /// </summary>
+[SupportedOSPlatform("linux")]
 public class RtpNaluSource : INaluSource
 {
     private readonly ILogger<RtpNaluSource>? _logger;
-    private readonly BlockingCollection<H264Nalu> _naluQueue;
+    private readonly SpscRing<H264Nalu> _naluQueue;
     private bool _disposed;
     private bool _started;
 
@@ -20,10 +22,10 @@ public class RtpNaluSource : INaluSource
         _logger = logger;
 
         // Bounded collection to prevent memory overflow if decoder can't keep up
-        _naluQueue = new BlockingCollection<H264Nalu>(queueCapacity);
+        _naluQueue = new SpscRing<H264Nalu>(queueCapacity);
     }
 
-    public BlockingCollection<H264Nalu> NaluQueue => _naluQueue;
+    public SpscRing<H264Nalu> NaluQueue => _naluQueue;
 
     public Task StartAsync(CancellationToken cancellationToken = default)
     {
@@ -45,7 +47,7 @@ public class RtpNaluSource : INaluSource
         }
 
         _logger?.LogInformation("Stopping RTP NALU source");
-        _naluQueue.CompleteAdding();
+        _naluQueue.Complete();
         _started = false;
 
         return Task.CompletedTask;
@@ -53,7 +55,7 @@ public class RtpNaluSource : INaluSource
 
     /// <summary>
     /// Push a NAL unit received from RTP to the decoder.
-    /// This method is thread-safe and can be called from network receive thread.
+    /// Must always be called from the same thread, typically the network receive thread.
     /// </summary>
     /// <param name="naluData">Complete NAL unit data (with or without Annex-B start code)</param>
     /// <param name="ensureStartCode">If true, adds Annex-B start code if not present</param>
@@ -104,8 +106,8 @@ public class RtpNaluSource : INaluSource
 
         var nalu = new H264Nalu(data, startCodeLength);
 
-        // TryAdd is non-blocking and thread-safe
-        bool added = _naluQueue.TryAdd(nalu, 0);
+        // Non-blocking, a full queue drops the NAL unit
+        bool added = _naluQueue.TryPush(nalu);
 
         if (!added && _logger != null && _logger.IsEnabled(LogLevel.Warning))
         {
@@ -129,5 +131,6 @@ public class RtpNaluSource : INaluSource
 
         _disposed = true;
         await StopAsync();
+        _naluQueue.Dispose();
     }
 }
@@ -1,6 +1,7 @@
-using System.Collections.Concurrent;
+using System.Runtime.Versioning;
 using Microsoft.Extensions.Logging;
 using SharpVideo.H264;
+using SharpVideo.Utils;
 
 namespace SharpVideo.V4L2Decoding.NaluSources;
 
@@ -8,11 +9,12 @@ namespace SharpVideo.V4L2Decoding.NaluSources;
 /// Provides H.264 NAL units by reading from a stream (file or network stream).
 /// Uses H264AnnexBNaluProvider internally to parse Annex-B format.
 /// </summary>
+[SupportedOSPlatform("linux")]
 public class StreamNaluSource : INaluSource
 {
     private readonly Stream _stream;
     private readonly ILogger<StreamNaluSource>? _logger;
-    private readonly BlockingCollection<H264Nalu> _naluQueue;
+    private readonly SpscRing<H264Nalu> _naluQueue;
     private H264AnnexBNaluProvider? _naluProvider;
     private Task? _feedTask;
     private Task? _readTask;
@@ -24,11 +26,11 @@ public class StreamNaluSource : INaluSource
         _stream = stream ?? throw new ArgumentNullException(nameof(stream));
         _logger = logger;
 
-        // Bounded collection for flow control
-        _naluQueue = new BlockingCollection<H264Nalu>(queueCapacity);
+        // Bounded ring for flow control, the reader blocks while the decoder is behind
+        _naluQueue = new SpscRing<H264Nalu>(queueCapacity);
     }
 
-    public BlockingCollection<H264Nalu> NaluQueue => _naluQueue;
+    public SpscRing<H264Nalu> NaluQueue => _naluQueue;
 
     public Task StartAsync(CancellationToken cancellationToken = default)
     {
@@ -123,9 +125,16 @@ public class StreamNaluSource : INaluSource
 
         try
         {
+            // The continuations may run on different pool threads, but never concurrently, so the ring still sees
+            // a single producer
             await foreach (var nalu in _naluProvider!.NaluReader.ReadAllAsync(cancellationToken))
             {
-                _naluQueue.Add(nalu, cancellationToken);
+                if (!_naluQueue.TryPush(nalu, Timeout.Infinite, cancellationToken))
+                {
+                    cancellationToken.ThrowIfCancellationRequested();
+                    break;
+                }
+
                 naluCount++;
 
                 if (_logger != null && _logger.IsEnabled(LogLevel.Trace))
@@ -148,7 +157,7 @@ public class StreamNaluSource : INaluSource
         finally
         {
             // Signal that no more NALUs will be added
-            _naluQueue.CompleteAdding();
+            _naluQueue.Complete();
             _logger?.LogDebug("Queue completed after reading {Count} NALUs", naluCount);
         }
     }
@@ -16,6 +16,11 @@ namespace SharpVideo.V4L2Decoding.Services;
 [SupportedOSPlatform("linux")]
 public class H264V4L2StatelessDecoder
 {
+    /// <summary>
+    /// Maximum number of NALUs taken from a source queue per wake-up
+    /// </summary>
+    private const int NaluBatchSize = 16;
+
     private readonly V4L2Device _device;
     private readonly MediaDevice? _mediaDevice;
     private readonly ILogger<H264V4L2StatelessDecoder> _logger;
@@ -29,6 +34,11 @@ public class H264V4L2StatelessDecoder
     private bool _disposed;
     private int _framesDecoded;
 
+    // Layout of the frames passed to _processDecodedAction, replaced as a whole when an SPS changes the visible size
+    private volatile BufferParams? _captureFrameParams;
+    private V4L2PixFormatMplane _captureFormat;
+    private bool _isCropOffsetWarned;
+
     private readonly bool _supportsSliceParamsControl;
 
     // Threads for parallel processing
@@ -39,6 +49,19 @@ public class H264V4L2StatelessDecoder
     // DPB (Decoded Picture Buffer) tracking - using Queue for O(1) operations
     private readonly Queue<DpbEntry> _dpb = new();
 
+    // Reference chain tracking (7.4.3): PrevRefFrameNum of the last reference picture and whether the chain since
+    // the last IDR is known to be broken
+    private uint _prevRefFrameNum;
+    private bool _hasReferenceChain;
+    private bool _isReferenceLost;
+
+    // A recovery point SEI precedes the next picture: decoding may (re)start there without an IDR, e.g. with
+    // intra refresh
+    private bool _isRecoveryPoint;
+
+    // Out-of-band SPS/PPS, e.g. from SDP sprop-parameter-sets, parsed into the stream state before the first NALU
+    private IReadOnlyList<byte[]> _parameterSets = Array.Empty<byte[]>();
+
     public H264V4L2StatelessDecoder(
         V4L2Device device,
         MediaDevice? mediaDevice,
@@ -64,6 +87,37 @@ public class H264V4L2StatelessDecoder
 
     public H264V4L2StatelessDecoderStatistics Statistics { get; } = new();
 
+    /// <summary>
+    /// Raised on the decoding thread when a picture cannot be decoded correctly because a reference picture or
+    /// parameter set is missing, e.g. after network loss. Raised once per broken period; the next IDR picture
+    /// re-arms it. Receivers typically answer with a key frame request (RTCP PLI/FIR).
+    /// </summary>
+    public event Action? ReferenceLost;
+
+    /// <summary>
+    /// Layout of the frames passed to the decoded frame callback: the visible size from the SPS cropping, with the
+    /// stride and plane offsets of the capture format the driver confirmed, which may be padded beyond the visible
+    /// size. Null before <see cref="InitializeDecoder"/> and for capture formats other than NV12 in a single plane
+    /// buffer, e.g. NV12M, where the callback only sees the first plane.
+    /// </summary>
+    public BufferParams? CaptureFrameParams => _captureFrameParams;
+
+    /// <summary>
+    /// Sets SPS and PPS NAL units (without start code) known before the stream starts, e.g. from the
+    /// sprop-parameter-sets of an SDP. They are parsed into the stream state before the first NALU, so the first
+    /// IDR picture decodes even if the sender does not repeat its parameter sets in band. Must be called before
+    /// decoding starts; in-band parameter sets with the same id replace them.
+    /// </summary>
+    public void SetParameterSets(IReadOnlyList<byte[]> parameterSets)
+    {
+        if (_decodingThread != null)
+        {
+            throw new InvalidOperationException("Decoding already started");
+        }
+
+        _parameterSets = parameterSets;
+    }
+
     /// <summary>
     /// Starts decoding H.264 NAL units from the provided source.
     /// Runs in separate thread for minimal latency.
@@ -92,6 +146,34 @@ public class H264V4L2StatelessDecoder
         _logger.LogInformation("Decoder thread started (Thread ID: {ThreadId})", _decodingThread.ManagedThreadId);
     }
 
+    /// <summary>
+    /// Starts decoding whole frames pushed by a single producer, e.g. straight from an RTP depacketiser.
+    /// The decoding thread takes the frames from the ring without any intermediate queue or thread, and disposes
+    /// each frame once its NAL units were submitted. Decoding ends when the ring is completed or on stop.
+    /// </summary>
+    /// <param name="frames">Ring the producer pushes frames to</param>
+    public void StartDecoding(SpscRing<INaluFrame> frames)
+    {
+        if (_decodingThread != null)
+        {
+            throw new InvalidOperationException("Decoding already started");
+        }
+
+        _logger.LogInformation("Starting H.264 stateless decoder with frame ring");
+
+        _cts = new CancellationTokenSource();
+
+        _decodingThread = new Thread(() => ProcessFramesThreadProc(frames, _cts.Token))
+        {
+            Name = "H264DecoderThread",
+            IsBackground = true,
+            Priority = ThreadPriority.Highest
+        };
+        _decodingThread.Start();
+
+        _logger.LogInformation("Decoder thread started (Thread ID: {ThreadId})", _decodingThread.ManagedThreadId);
+    }
+
     /// <summary>
     /// Stops decoding and waits for graceful shutdown.
     /// </summary>
@@ -158,11 +240,11 @@ public class H264V4L2StatelessDecoder
     /// </summary>
     private void ProcessNalusThreadProc(INaluSource naluSource, CancellationToken cancellationToken)
     {
-        var streamState = new H264BitstreamParserState();
         var parsingOptions = new ParsingOptions
         {
             add_checksum = false // Disable checksum for performance
         };
+        var streamState = CreateStreamState(parsingOptions);
 
         var decodingStopwatch = Stopwatch.StartNew();
         int naluCount = 0;
@@ -172,41 +254,21 @@ public class H264V4L2StatelessDecoder
             _logger.LogInformation("NALU processing thread started");
 
             var queue = naluSource.NaluQueue;
+            var batch = new H264Nalu[NaluBatchSize];
 
             // Synchronous blocking read - minimal latency!
-            // GetConsumingEnumerable blocks until item available or CompleteAdding called
+            // TryPopBatch blocks until items are available and returns 0 only once the source completed the queue
             // Don't pass cancellationToken - we want to process all remaining NALUs even if cancelled
-            foreach (var naluData in queue.GetConsumingEnumerable())
+            int count;
+            while ((count = queue.TryPopBatch(batch, Timeout.Infinite)) > 0)
             {
-                // Check cancellation manually only before heavy processing
-                if (cancellationToken.IsCancellationRequested && queue.IsCompleted)
-                {
-                    _logger.LogInformation("Cancellation requested and queue completed");
-                    break;
-                }
-
-                if (naluData.Data.Length < 1)
-                {
-                    continue;
-                }
-
-                if (_logger.IsEnabled(LogLevel.Trace))
+                for (int i = 0; i < count; i++)
                 {
-                    _logger.LogTrace("Processing NALU #{Index} (size: {Size} bytes)", naluCount + 1,
-                        naluData.Data.Length);
+                    var naluData = batch[i];
+                    batch[i] = null!;
+                    ProcessNalu(naluData.Data, naluData.Data.Length - naluData.WithoutHeader.Length, streamState, parsingOptions, ref naluCount);
+                    naluData.Release();
                 }
-
-                var naluState = H264NalUnitParser.ParseNalUnit(naluData.WithoutHeader, streamState, parsingOptions);
-
-                if (naluState == null)
-                {
-                    _logger.LogWarning("Parser returned null for NALU #{Index}; skipping", naluCount + 1);
-                    continue;
-                }
-
-                naluCount++;
-
-                ProcessNaluByType(naluData, naluState, streamState);
             }
 
             _logger.LogInformation("Queue completed, all NALUs processed");
@@ -227,10 +289,127 @@ public class H264V4L2StatelessDecoder
         }
     }
 
+    /// <summary>
+    /// Thread procedure for decoding whole frames taken from a single producer ring
+    /// </summary>
+    private void ProcessFramesThreadProc(SpscRing<INaluFrame> frames, CancellationToken cancellationToken)
+    {
+        var parsingOptions = new ParsingOptions
+        {
+            add_checksum = false // Disable checksum for performance
+        };
+        var streamState = CreateStreamState(parsingOptions);
+
+        var decodingStopwatch = Stopwatch.StartNew();
+        int naluCount = 0;
+
+        try
+        {
+            _logger.LogInformation("Frame processing thread started");
+
+            while (!cancellationToken.IsCancellationRequested)
+            {
+                if (!frames.TryPop(out var frame, Timeout.Infinite, cancellationToken))
+                {
+                    if (frames.IsCompleted)
+                    {
+                        _logger.LogInformation("Frame ring completed, all frames processed");
+                        break;
+                    }
+
+                    continue;
+                }
+
+                using (frame)
+                {
+                    for (int i = 0; i < frame.NalUnitCount; i++)
+                    {
+                        var nalu = frame.GetNalUnit(i);
+                        int startCodeLength = nalu.Length > 3 && nalu[2] == 1 ? 3 : 4;
+                        ProcessNalu(nalu, startCodeLength, streamState, parsingOptions, ref naluCount);
+                    }
+                }
+            }
+        }
+        catch (Exception ex)
+        {
+            _logger.LogError(ex, "Error in frame processing thread");
+        }
+        finally
+        {
+            // Frames still queued when stopping are returned to their producer
+            while (frames.TryPop(out var frame))
+            {
+                frame.Dispose();
+            }
+
+            decodingStopwatch.Stop();
+            Statistics.DecodeElapsed = decodingStopwatch.Elapsed;
+            _logger.LogInformation("Frame processing thread stopped. Processed {Count} NALUs", naluCount);
+        }
+    }
+
+    /// <summary>
+    /// Creates the parser state of a new stream, seeded with the out-of-band parameter sets
+    /// </summary>
+    private H264BitstreamParserState CreateStreamState(ParsingOptions parsingOptions)
+    {
+        var streamState = new H264BitstreamParserState();
+        foreach (var parameterSet in _parameterSets)
+        {
+            var naluState = H264NalUnitParser.ParseNalUnit(parameterSet, streamState, parsingOptions);
+            var naluType = naluState == null ? (NalUnitType?)null : (NalUnitType)naluState.nal_unit_header.nal_unit_type;
+            if (naluType is not (NalUnitType.SPS_NUT or NalUnitType.PPS_NUT))
+            {
+                _logger.LogWarning("Ignoring out-of-band parameter set of {Size} bytes: not an SPS or PPS", parameterSet.Length);
+                continue;
+            }
+
+            _logger.LogInformation("Seeded {NaluType} from out-of-band parameter sets", naluType);
+        }
+
+        return streamState;
+    }
+
+    /// <summary>
+    /// Parses a NALU and hands it to the handler of its type
+    /// </summary>
+    /// <param name="nalu">NALU including its start code</param>
+    /// <param name="payloadStart">Length of the start code</param>
+    private void ProcessNalu(
+        ReadOnlySpan<byte> nalu,
+        int payloadStart,
+        H264BitstreamParserState streamState,
+        ParsingOptions parsingOptions,
+        ref int naluCount)
+    {
+        if (nalu.Length <= payloadStart)
+        {
+            return;
+        }
+
+        if (_logger.IsEnabled(LogLevel.Trace))
+        {
+            _logger.LogTrace("Processing NALU #{Index} (size: {Size} bytes)", naluCount + 1, nalu.Length);
+        }
+
+        var naluState = H264NalUnitParser.ParseNalUnit(nalu.Slice(payloadStart), streamState, parsingOptions);
+
+        if (naluState == null)
+        {
+            _logger.LogWarning("Parser returned null for NALU #{Index}; skipping", naluCount + 1);
+            return;
+        }
+
+        naluCount++;
+
+        ProcessNaluByType(nalu, naluState, streamState);
+    }
+
     /// <summary>
     /// Processes individual NALU based on its type
     /// </summary>
-    private void ProcessNaluByType(H264Nalu naluData, NalUnitState naluState, H264BitstreamParserState streamState)
+    private void ProcessNaluByType(ReadOnlySpan<byte> naluData, NalUnitState naluState, H264BitstreamParserState streamState)
     {
         var naluType = (NalUnitType)naluState.nal_unit_header.nal_unit_type;
 
@@ -246,6 +425,7 @@ public class H264V4L2StatelessDecoder
                         spsData.level_idc,
                         (spsData.pic_width_in_mbs_minus1 + 1) * 16,
                         (spsData.pic_height_in_map_units_minus1 + 1) * 16);
+                    UpdateVisibleSize(spsData);
                 }
                 break;
             case NalUnitType.PPS_NUT:
@@ -258,6 +438,14 @@ public class H264V4L2StatelessDecoder
                 }
                 break;
 
+            case NalUnitType.SEI_NUT:
+                var sei = naluState.nal_unit_payload.sei;
+                if (sei != null)
+                {
+                    HandleSei(sei);
+                }
+                break;
+
             case NalUnitType.CODED_SLICE_OF_NON_IDR_PICTURE_NUT: // Non-IDR slice
             case NalUnitType.CODED_SLICE_OF_IDR_PICTURE_NUT: // IDR slice
                 _logger.LogTrace("Processing slice NALU type {NaluType}", naluType);
@@ -276,11 +464,36 @@ public class H264V4L2StatelessDecoder
         }
     }
 
+    /// <summary>
+    /// Takes the recovery point and the capture time from SEI messages, other payloads are not parsed
+    /// </summary>
+    private void HandleSei(SeiState sei)
+    {
+        foreach (var message in sei.sei_message)
+        {
+            switch ((SeiPayloadType)message.payload_type)
+            {
+                case SeiPayloadType.RECOVERY_POINT:
+                    _isRecoveryPoint = true;
+                    break;
+
+                case SeiPayloadType.USER_DATA_UNREGISTERED:
+                    var userData = message.GetUserDataUnregistered();
+                    if (userData != null && userData.TryGetMispTimestamp(out var captureMicroseconds))
+                    {
+                        var captureTime = DateTime.UnixEpoch.AddTicks((long)captureMicroseconds * 10);
+                        Statistics.CaptureLatency = DateTime.UtcNow - captureTime;
+                    }
+                    break;
+            }
+        }
+    }
+
     /// <summary>
     /// Handles slice NALUs (actual video data)
     /// </summary>
     private void HandleSliceNalu(
-        H264Nalu nalu,
+        ReadOnlySpan<byte> nalu,
         SliceLayerWithoutPartitioningRbspState sliceLayerWithoutPartitioningRbsp,
         NalUnitType naluType,
         H264BitstreamParserState streamState)
@@ -303,6 +516,7 @@ public class H264V4L2StatelessDecoder
         {
             _logger.LogWarning("Cannot decode slice: PPS {PpsId} not received yet, skipping frame {FrameNum}",
                 header.pic_parameter_set_id, header.frame_num);
+            ReportReferenceLoss();
             return;
         }
 
@@ -311,6 +525,7 @@ public class H264V4L2StatelessDecoder
         {
             _logger.LogWarning("Cannot decode slice: SPS {SpsId} (referenced by PPS {PpsId}) not received yet, skipping frame {FrameNum}",
                 pps.seq_parameter_set_id, header.pic_parameter_set_id, header.frame_num);
+            ReportReferenceLoss();
             return;
         }
 
@@ -319,7 +534,71 @@ public class H264V4L2StatelessDecoder
 
         var isKeyFrame = naluType == NalUnitType.CODED_SLICE_OF_IDR_PICTURE_NUT;
 
-        SubmitFrameToDevice(nalu.Data, header, isKeyFrame, streamState);
+        CheckReferenceContinuity(header, isKeyFrame, sps);
+
+        SubmitFrameToDevice(nalu, header, isKeyFrame, streamState);
+    }
+
+    /// <summary>
+    /// Detects pictures whose reference pictures were never decoded: a non-IDR picture before the first IDR, or a
+    /// frame_num that is neither PrevRefFrameNum nor PrevRefFrameNum + 1 when gaps are not allowed (7.4.3).
+    /// </summary>
+    private void CheckReferenceContinuity(SliceHeaderState header, bool isIdr, SpsState sps)
+    {
+        bool isRecoveryPoint = _isRecoveryPoint;
+        _isRecoveryPoint = false;
+        if (isIdr)
+        {
+            _prevRefFrameNum = 0;
+            _hasReferenceChain = true;
+            _isReferenceLost = false;
+            return;
+        }
+
+        var maxFrameNum = 1u << (int)(sps.sps_data.log2_max_frame_num_minus4 + 4);
+        if (isRecoveryPoint && (!_hasReferenceChain || _isReferenceLost))
+        {
+            // The pictures are correct again after recovery_frame_cnt frames, without waiting for an IDR
+            _logger.LogInformation("Decoding recovers at recovery point, frame_num={FrameNum}", header.frame_num);
+            _prevRefFrameNum = header.nal_ref_idc != 0 ? header.frame_num : (header.frame_num + maxFrameNum - 1) % maxFrameNum;
+            _hasReferenceChain = true;
+            _isReferenceLost = false;
+            Statistics.RecoveryPoints++;
+            return;
+        }
+
+        if (!_hasReferenceChain)
+        {
+            ReportReferenceLoss();
+            return;
+        }
+
+        var expectedFrameNum = (_prevRefFrameNum + 1) % maxFrameNum;
+        if (sps.sps_data.gaps_in_frame_num_value_allowed_flag == 0 &&
+            header.frame_num != _prevRefFrameNum &&
+            header.frame_num != expectedFrameNum)
+        {
+            _logger.LogWarning("Gap in frame_num: expected {Expected}, got {FrameNum}, reference pictures were lost",
+                expectedFrameNum, header.frame_num);
+            ReportReferenceLoss();
+        }
+
+        if (header.nal_ref_idc != 0)
+        {
+            _prevRefFrameNum = header.frame_num;
+        }
+    }
+
+    private void ReportReferenceLoss()
+    {
+        if (_isReferenceLost)
+        {
+            return;
+        }
+
+        _isReferenceLost = true;
+        Statistics.ReferenceLosses++;
+        ReferenceLost?.Invoke();
     }
 
     private void SubmitFrameToDevice(
@@ -629,6 +908,77 @@ public class H264V4L2StatelessDecoder
         };
 
         _device.SetCaptureFormatMPlane(captureFormat);
+
+        // The driver may align the size and pick the plane layout, the frames have the confirmed one
+        _captureFormat = _device.GetCaptureFormatMPlane();
+        _logger.LogInformation(
+            "Set capture format: {Width}x{Height} {Format:X8} ({Planes} plane(s), {Stride} bytes per line)",
+            _captureFormat.Width,
+            _captureFormat.Height,
+            _captureFormat.PixelFormat,
+            _captureFormat.NumPlanes,
+            _captureFormat.PlaneFormats[0].BytesPerLine);
+
+        if (_captureFormat.NumPlanes != 1 ||
+            new PixelFormat(_captureFormat.PixelFormat) != KnownPixelFormats.DRM_FORMAT_NV12)
+        {
+            _logger.LogWarning("Capture format is not NV12 in a single plane buffer, decoded frames have no layout");
+            return;
+        }
+
+        _captureFrameParams = CreateCaptureFrameParams(
+            Math.Min(_configuration.InitialWidth, _captureFormat.Width),
+            Math.Min(_configuration.InitialHeight, _captureFormat.Height));
+    }
+
+    /// <summary>
+    /// Sets the visible size of the decoded frames from the SPS cropping window
+    /// </summary>
+    private void UpdateVisibleSize(SpsDataState spsData)
+    {
+        var current = _captureFrameParams;
+        if (current == null)
+        {
+            return;
+        }
+
+        spsData.getResolution(out int width, out int height);
+        if (width <= 0 || height <= 0)
+        {
+            return;
+        }
+
+        if ((spsData.frame_crop_left_offset != 0 || spsData.frame_crop_top_offset != 0) && !_isCropOffsetWarned)
+        {
+            // Frames are passed from their first line and column, only the right and bottom crop can be applied
+            _logger.LogWarning("SPS crops {Left} columns from the left and {Top} lines from the top, frames keep them",
+                spsData.frame_crop_left_offset, spsData.frame_crop_top_offset);
+            _isCropOffsetWarned = true;
+        }
+
+        uint visibleWidth = Math.Min((uint)width, _captureFormat.Width);
+        uint visibleHeight = Math.Min((uint)height, _captureFormat.Height);
+        if (visibleWidth != current.Width || visibleHeight != current.Height)
+        {
+            _captureFrameParams = CreateCaptureFrameParams(visibleWidth, visibleHeight);
+        }
+    }
+
+    /// <summary>
+    /// NV12 layout of a single plane capture buffer: the chroma plane follows the luma plane's padded height
+    /// </summary>
+    private BufferParams CreateCaptureFrameParams(uint visibleWidth, uint visibleHeight)
+    {
+        var plane = _captureFormat.PlaneFormats[0];
+        return new BufferParams
+        {
+            Width = visibleWidth,
+            Height = visibleHeight,
+            FullSize = plane.SizeImage,
+            PlanesCount = 2,
+            PlaneOffsets = [0, (ulong)plane.BytesPerLine * _captureFormat.Height],
+            Stride = plane.BytesPerLine
+        };
     }
 
     private void SetupAndMapBuffers()
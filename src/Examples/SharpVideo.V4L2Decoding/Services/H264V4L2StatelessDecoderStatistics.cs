@@ -3,4 +3,20 @@
 public class H264V4L2StatelessDecoderStatistics
 {
     public TimeSpan DecodeElapsed { get; set; }
+
+    /// <summary>
+    /// Number of times decoding continued with missing reference pictures or parameter sets.
+    /// </summary>
+    public int ReferenceLosses { get; set; }
+
+    /// <summary>
+    /// Number of times decoding restarted at a recovery point SEI instead of an IDR picture.
+    /// </summary>
+    public int RecoveryPoints { get; set; }
+
+    /// <summary>
+    /// Time from capture to the decoder of the latest picture with a capture timestamp SEI (MISP microsecond time),
+    /// measured against the local clock, so sender and receiver clocks must be synchronised.
+    /// </summary>
+    public TimeSpan CaptureLatency { get; set; }
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+using System.Diagnostics;
+using SharpVideo.Drm;
+using SharpVideo.Utils;
+
+namespace SharpVideo.Benchmarks;
+
+/// <summary>
+/// Measures <see cref="YuvToRgbConverter"/> per resolution and format, on one thread and on all cores, against the
+/// per pixel NV12 loop FrameSaver used before, <see cref="Nv12Scaler"/> from each resolution to analytics size, and
+/// <see cref="TestPattern.FillAnimated"/> per format.
+/// </summary>
+internal static class PixelConversionBenchmarks
+{
+    private const int ScaledWidth = 320;
+    private const int ScaledHeight = 180;
+
+    private static readonly (string Name, int Width, int Height)[] Resolutions =
+    [
+        ("360p", 640, 360),
+        ("720p", 1280, 720),
+        ("1080p", 1920, 1080),
+        ("2160p", 3840, 2160),
+    ];
+
+    private static readonly (string Name, PixelFormat Source, PixelFormat Destination)[] Conversions =
+    [
+        ("NV12 -> RGB24", KnownPixelFormats.DRM_FORMAT_NV12, KnownPixelFormats.DRM_FORMAT_BGR888),
+        ("NV12 -> XR24", KnownPixelFormats.DRM_FORMAT_NV12, KnownPixelFormats.DRM_FORMAT_XRGB8888),
+        ("NV16 -> XR24", KnownPixelFormats.DRM_FORMAT_NV16, KnownPixelFormats.DRM_FORMAT_XRGB8888),
+        ("YUYV -> BGRA", KnownPixelFormats.DRM_FORMAT_YUYV, KnownPixelFormats.DRM_FORMAT_ARGB8888),
+    ];
+
+    public static void Run(int runs)
+    {
+        Console.WriteLine();
+        Console.WriteLine($"YUV to RGB, BT.601 limited range, median of {runs} runs, ms per frame (frames/s)");
+        Console.WriteLine($"{"Conversion",-16}{"Size",-8}{"Scalar",18}{"1 thread",18}{$"{Environment.ProcessorCount} threads",18}");
+        foreach (var (resolutionName, width, height) in Resolutions)
+        {
+            foreach (var (conversionName, sourceFormat, destinationFormat) in Conversions)
+            {
+                var bufferParams = BuffersInfoProvider.GetBufferParams((uint)width, (uint)height, sourceFormat);
+                var source = new byte[bufferParams.FullSize];
+                new Random(1).NextBytes(source);
+                int destinationStride = width * YuvToRgbConverter.GetBytesPerPixel(destinationFormat);
+                var destination = new byte[destinationStride * height];
+
+                string scalar = sourceFormat == KnownPixelFormats.DRM_FORMAT_NV12 &&
+                                destinationFormat == KnownPixelFormats.DRM_FORMAT_BGR888
+                    ? Format(Measure(runs, () => ConvertPerPixel(source, destination, width, height)))
+                    : "";
+                string singleThread = Format(Measure(runs, () => YuvToRgbConverter.Convert(source, bufferParams,
+                    sourceFormat, destination, destinationStride, destinationFormat, maxDegreeOfParallelism: 1)));
+                string allThreads = Format(Measure(runs, () => YuvToRgbConverter.Convert(source, bufferParams,
+                    sourceFormat, destination, destinationStride, destinationFormat)));
+
+                Console.WriteLine($"{conversionName,-16}{resolutionName,-8}{scalar,18}{singleThread,18}{allThreads,18}");
+            }
+        }
+
+        Console.WriteLine();
+        Console.WriteLine($"NV12 scaling to {ScaledWidth}x{ScaledHeight}, median of {runs} runs, ms per frame (frames/s)");
+        Console.WriteLine($"{"Filter",-16}{"Size",-8}{"NV12",18}{"Planar RGB",18}");
+        foreach (var (resolutionName, width, height) in Resolutions)
+        {
+            var sourceParams = BuffersInfoProvider.GetBufferParams((uint)width, (uint)height, KnownPixelFormats.DRM_FORMAT_NV12);
+            var source = new byte[sourceParams.FullSize];
+            new Random(1).NextBytes(source);
+            var scaledParams = BuffersInfoProvider.GetBufferParams(ScaledWidth, ScaledHeight, KnownPixelFormats.DRM_FORMAT_NV12);
+            var scaled = new byte[scaledParams.FullSize];
+            var planes = new byte[3 * ScaledWidth * ScaledHeight];
+
+            foreach (var filter in Enum.GetValues<ScaleFilter>())
+            {
+                string nv12 = Format(Measure(runs, () => Nv12Scaler.Scale(source, sourceParams, scaled, scaledParams, filter)));
+                string rgb = Format(Measure(runs, () => Nv12Scaler.ScaleToPlanarRgb(source, sourceParams, planes,
+                    ScaledWidth, ScaledHeight, filter: filter)));
+                Console.WriteLine($"{filter,-16}{resolutionName,-8}{nv12,18}{rgb,18}");
+            }
+        }
+
+        var patternFormats = new[]
+        {
+            KnownPixelFormats.DRM_FORMAT_NV12, KnownPixelFormats.DRM_FORMAT_YUYV, KnownPixelFormats.DRM_FORMAT_XRGB8888,
+            KnownPixelFormats.DRM_FORMAT_RGB888
+        };
+
+        Console.WriteLine();
+        Console.WriteLine($"Animated test pattern, median of {runs} runs, ms per frame (frames/s)");
+        Console.WriteLine($"{"Size",-8}{string.Concat(patternFormats.Select(f => $"{f.GetName()["DRM_FORMAT_".Length..],18}"))}");
+        foreach (var (resolutionName, width, height) in Resolutions)
+        {
+            var line = $"{resolutionName,-8}";
+            foreach (var format in patternFormats)
+            {
+                var bufferParams = BuffersInfoProvider.GetBufferParams((uint)width, (uint)height, format);
+                var frame = new byte[bufferParams.FullSize];
+                long frameIndex = 0;
+                line += $"{Format(Measure(runs, () => TestPattern.FillAnimated(frame, bufferParams, format, frameIndex++,
+                    TimeSpan.FromSeconds(frameIndex / 60.0)))),18}";
+            }
+
+            Console.WriteLine(line);
+        }
+    }
+
+    private static double Measure(int runs, Action convert)
+    {
+        // Warm-up so the measured runs see tiered-up code, tiering needs a few hundred milliseconds of calls
+        var warmUp = Stopwatch.StartNew();
+        while (warmUp.ElapsedMilliseconds < 500)
+        {
+            convert();
+        }
+
+        var seconds = new double[runs];
+        for (int run = 0; run < runs; run++)
+        {
+            var stopwatch = Stopwatch.StartNew();
+            convert();
+            seconds[run] = stopwatch.Elapsed.TotalSeconds;
+        }
+
+        Array.Sort(seconds);
+        return seconds[runs / 2];
+    }
+
+    private static string Format(double seconds) => $"{seconds * 1e3:F2} ({1 / seconds:F0})";
+
+    /// <summary>
+    /// The conversion FrameSaver did before, BT.601 limited range with 8 bit coefficients.
+    /// </summary>
+    private static void ConvertPerPixel(byte[] frame, byte[] rgb, int width, int height)
+    {
+        int yPlaneSize = width * height;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int uvIndex = yPlaneSize + y / 2 * width + x / 2 * 2;
+                int c = frame[y * width + x] - 16;
+                int d = (uvIndex < frame.Length ? frame[uvIndex] : 128) - 128;
+                int e = (uvIndex + 1 < frame.Length ? frame[uvIndex + 1] : 128) - 128;
+
+                int pixel = (y * width + x) * 3;
+                rgb[pixel] = (byte)Math.Clamp((298 * c + 409 * e + 128) >> 8, 0, 255);
+                rgb[pixel + 1] = (byte)Math.Clamp((298 * c - 100 * d - 208 * e + 128) >> 8, 0, 255);
+                rgb[pixel + 2] = (byte)Math.Clamp((298 * c + 516 * d + 128) >> 8, 0, 255);
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+using System.Globalization;
+using System.Runtime.Versioning;
+
+namespace SharpVideo.Benchmarks;
+
+/// <summary>
+/// Microbenchmarks of the building blocks of the decode pipelines. Run in Release:
+/// <c>dotnet run -c Release -- [queues] [pixels] [--items &lt;n&gt;] [--runs &lt;n&gt;]</c>
+/// </summary>
+[SupportedOSPlatform("linux")]
+internal static class Program
+{
+    private static readonly string[] Suites = ["queues", "pixels"];
+
+    private static int Main(string[] args)
+    {
+        var suites = new List<string>();
+        int items = 2_000_000;
+        int runs = 5;
+        for (int i = 0; i < args.Length; i++)
+        {
+            switch (args[i])
+            {
+                case "--items" when i + 1 < args.Length:
+                    items = int.Parse(args[++i], CultureInfo.InvariantCulture);
+                    break;
+                case "--runs" when i + 1 < args.Length:
+                    runs = int.Parse(args[++i], CultureInfo.InvariantCulture);
+                    break;
+                default:
+                    suites.Add(args[i]);
+                    break;
+            }
+        }
+
+        foreach (var suite in suites.Where(suite => !Suites.Contains(suite)))
+        {
+            Console.Error.WriteLine($"Unknown benchmark '{suite}', available: {string.Join(", ", Suites)}");
+            return 1;
+        }
+
+        Console.WriteLine($"{Environment.ProcessorCount} CPUs, {System.Runtime.InteropServices.RuntimeInformation.FrameworkDescription}");
+
+        bool runAll = suites.Count == 0;
+        if (runAll || suites.Contains("queues"))
+        {
+            QueueBenchmarks.Run(items, runs);
+        }
+
+        if (runAll || suites.Contains("pixels"))
+        {
+            PixelConversionBenchmarks.Run(runs);
+        }
+
+        return 0;
+    }
+}
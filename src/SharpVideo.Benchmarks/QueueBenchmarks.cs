@@ -0,0 +1,355 @@
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Runtime.Versioning;
+using System.Threading.Channels;
+using SharpVideo.Utils;
+
+namespace SharpVideo.Benchmarks;
+
+/// <summary>
+/// Compares <see cref="SpscRing{T}"/> with the collections the pipelines used before, between one producer and one
+/// consumer thread: throughput with a bounded queue, and the round trip latency of a single item.
+/// </summary>
+[SupportedOSPlatform("linux")]
+internal static class QueueBenchmarks
+{
+    private const int Capacity = 1024;
+    private const int BatchSize = 32;
+    private const int LatencyCapacity = 16;
+    private const int LatencyRoundTrips = 20_000;
+
+    private static readonly (string Name, Func<int, BenchQueue> Create)[] Queues =
+    [
+        ("SpscRing", capacity => new SpscRingQueue(capacity, batchSize: 1)),
+        ($"SpscRing, batches of {BatchSize}", capacity => new SpscRingQueue(capacity, BatchSize)),
+        ("BlockingCollection", capacity => new BlockingCollectionQueue(capacity)),
+        ("Channel, bounded single reader/writer", capacity => new ChannelQueue(capacity)),
+        ("ConcurrentQueue + SpinWait, unbounded", _ => new ConcurrentQueueQueue()),
+    ];
+
+    public static void Run(int items, int runs)
+    {
+        var payload = new object[Capacity];
+        for (int i = 0; i < payload.Length; i++)
+        {
+            payload[i] = new object();
+        }
+
+        Console.WriteLine();
+        Console.WriteLine($"Throughput: {items} items through a queue of {Capacity}, median of {runs} runs");
+        Console.WriteLine($"{"Queue",-40}{"Mitems/s",12}{"ns/item",12}");
+        foreach (var (name, create) in Queues)
+        {
+            // Warm-up so the measured runs see tiered-up code
+            MeasureThroughput(create, payload, Math.Max(items / 10, 1));
+
+            var seconds = new double[runs];
+            for (int run = 0; run < runs; run++)
+            {
+                seconds[run] = MeasureThroughput(create, payload, items);
+            }
+
+            double median = Median(seconds);
+            Console.WriteLine($"{name,-40}{items / median / 1e6,12:F2}{median * 1e9 / items,12:F1}");
+        }
+
+        Console.WriteLine();
+        Console.WriteLine($"Latency: {LatencyRoundTrips} round trips through two queues of {LatencyCapacity}, microseconds");
+        Console.WriteLine($"{"Queue",-40}{"p50",10}{"p99",10}{"max",10}");
+        foreach (var (name, create) in Queues)
+        {
+            MeasureLatency(create, LatencyRoundTrips / 10);
+            var samples = MeasureLatency(create, LatencyRoundTrips);
+            Array.Sort(samples);
+            Console.WriteLine($"{name,-40}{ToMicroseconds(samples[samples.Length / 2]),10:F1}" +
+                              $"{ToMicroseconds(samples[samples.Length * 99 / 100]),10:F1}{ToMicroseconds(samples[^1]),10:F1}");
+        }
+    }
+
+    private static double MeasureThroughput(Func<int, BenchQueue> create, object[] payload, int items)
+    {
+        using var queue = create(Capacity);
+        long consumed = 0;
+        var consumer = new Thread(() => consumed = queue.Consume()) { Name = "BenchConsumer" };
+
+        var stopwatch = Stopwatch.StartNew();
+        consumer.Start();
+        queue.Produce(payload, items);
+        consumer.Join();
+        stopwatch.Stop();
+
+        if (consumed != items)
+        {
+            throw new InvalidOperationException($"Consumed {consumed} of {items} items");
+        }
+
+        return stopwatch.Elapsed.TotalSeconds;
+    }
+
+    private static long[] MeasureLatency(Func<int, BenchQueue> create, int roundTrips)
+    {
+        using var ping = create(LatencyCapacity);
+        using var pong = create(LatencyCapacity);
+        var echo = new Thread(() =>
+        {
+            while (ping.Pop() is { } item)
+            {
+                pong.Push(item);
+            }
+        }) { Name = "BenchEcho" };
+        echo.Start();
+
+        var item = new object();
+        var samples = new long[roundTrips];
+        for (int i = 0; i < roundTrips; i++)
+        {
+            long start = Stopwatch.GetTimestamp();
+            ping.Push(item);
+            pong.Pop();
+            samples[i] = Stopwatch.GetTimestamp() - start;
+        }
+
+        ping.Complete();
+        echo.Join();
+        return samples;
+    }
+
+    private static double Median(double[] values)
+    {
+        var sorted = values.Order().ToArray();
+        return sorted[sorted.Length / 2];
+    }
+
+    private static double ToMicroseconds(long ticks) => ticks * 1e6 / Stopwatch.Frequency;
+
+    /// <summary>
+    /// A queue under test. Push blocks while the queue is full, Pop blocks while it is empty and returns null once
+    /// it is completed and drained. Produce and Consume run the whole transfer so the per-item loops are not virtual.
+    /// </summary>
+    private abstract class BenchQueue : IDisposable
+    {
+        public abstract void Push(object item);
+
+        public abstract object? Pop();
+
+        public abstract void Complete();
+
+        public abstract void Produce(object[] payload, int count);
+
+        public abstract long Consume();
+
+        public virtual void Dispose()
+        {
+        }
+    }
+
+    private sealed class SpscRingQueue(int capacity, int batchSize) : BenchQueue
+    {
+        private readonly SpscRing<object> _ring = new(capacity);
+
+        public override void Push(object item) => _ring.TryPush(item, Timeout.Infinite);
+
+        public override object? Pop() => _ring.TryPop(out var item, Timeout.Infinite) ? item : null;
+
+        public override void Complete() => _ring.Complete();
+
+        public override void Produce(object[] payload, int count)
+        {
+            int mask = payload.Length - 1;
+            int sent = 0;
+            while (sent < count)
+            {
+                if (batchSize == 1)
+                {
+                    _ring.TryPush(payload[sent & mask], Timeout.Infinite);
+                    sent++;
+                    continue;
+                }
+
+                int start = sent & mask;
+                var batch = payload.AsSpan(start, Math.Min(batchSize, Math.Min(payload.Length - start, count - sent)));
+                int pushed = _ring.TryPushBatch(batch);
+                if (pushed == 0)
+                {
+                    // Full: wait for room with a single blocking push
+                    _ring.TryPush(batch[0], Timeout.Infinite);
+                    pushed = 1;
+                }
+
+                sent += pushed;
+            }
+
+            _ring.Complete();
+        }
+
+        public override long Consume()
+        {
+            long count = 0;
+            if (batchSize == 1)
+            {
+                while (_ring.TryPop(out _, Timeout.Infinite))
+                {
+                    count++;
+                }
+
+                return count;
+            }
+
+            var batch = new object[batchSize];
+            int popped;
+            while ((popped = _ring.TryPopBatch(batch, Timeout.Infinite)) > 0)
+            {
+                count += popped;
+            }
+
+            return count;
+        }
+
+        public override void Dispose() => _ring.Dispose();
+    }
+
+    private sealed class BlockingCollectionQueue(int capacity) : BenchQueue
+    {
+        private readonly BlockingCollection<object> _collection = new(capacity);
+
+        public override void Push(object item) => _collection.Add(item);
+
+        public override object? Pop() => _collection.TryTake(out var item, Timeout.Infinite) ? item : null;
+
+        public override void Complete() => _collection.CompleteAdding();
+
+        public override void Produce(object[] payload, int count)
+        {
+            int mask = payload.Length - 1;
+            for (int i = 0; i < count; i++)
+            {
+                _collection.Add(payload[i & mask]);
+            }
+
+            _collection.CompleteAdding();
+        }
+
+        public override long Consume()
+        {
+            long count = 0;
+            foreach (var _ in _collection.GetConsumingEnumerable())
+            {
+                count++;
+            }
+
+            return count;
+        }
+
+        public override void Dispose() => _collection.Dispose();
+    }
+
+    private sealed class ChannelQueue(int capacity) : BenchQueue
+    {
+        private readonly Channel<object> _channel = Channel.CreateBounded<object>(new BoundedChannelOptions(capacity)
+        {
+            SingleReader = true,
+            SingleWriter = true,
+            FullMode = BoundedChannelFullMode.Wait
+        });
+
+        public override void Push(object item)
+        {
+            if (!_channel.Writer.TryWrite(item))
+            {
+                _channel.Writer.WriteAsync(item).AsTask().GetAwaiter().GetResult();
+            }
+        }
+
+        public override object? Pop()
+        {
+            var reader = _channel.Reader;
+            while (true)
+            {
+                if (reader.TryRead(out var item))
+                {
+                    return item;
+                }
+
+                if (!reader.WaitToReadAsync().AsTask().GetAwaiter().GetResult())
+                {
+                    return null;
+                }
+            }
+        }
+
+        public override void Complete() => _channel.Writer.Complete();
+
+        public override void Produce(object[] payload, int count)
+        {
+            int mask = payload.Length - 1;
+            for (int i = 0; i < count; i++)
+            {
+                Push(payload[i & mask]);
+            }
+
+            Complete();
+        }
+
+        public override long Consume()
+        {
+            long count = 0;
+            while (Pop() != null)
+            {
+                count++;
+            }
+
+            return count;
+        }
+    }
+
+    private sealed class ConcurrentQueueQueue : BenchQueue
+    {
+        private readonly ConcurrentQueue<object> _queue = new();
+        private volatile bool _completed;
+
+        public override void Push(object item) => _queue.Enqueue(item);
+
+        public override object? Pop()
+        {
+            var spinner = new SpinWait();
+            while (true)
+            {
+                if (_queue.TryDequeue(out var item))
+                {
+                    return item;
+                }
+
+                if (_completed && _queue.IsEmpty)
+                {
+                    return null;
+                }
+
+                spinner.SpinOnce();
+            }
+        }
+
+        public override void Complete() => _completed = true;
+
+        public override void Produce(object[] payload, int count)
+        {
+            int mask = payload.Length - 1;
+            for (int i = 0; i < count; i++)
+            {
+                _queue.Enqueue(payload[i & mask]);
+            }
+
+            _completed = true;
+        }
+
+        public override long Consume()
+        {
+            long count = 0;
+            while (Pop() != null)
+            {
+                count++;
+            }
+
+            return count;
+        }
+    }
+}
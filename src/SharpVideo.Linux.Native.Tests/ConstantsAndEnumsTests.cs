@@ -1,4 +1,5 @@
 using System;
+using System.Runtime.InteropServices;
 using System.Runtime.Versioning;
 using SharpVideo.Linux.Native.C;
 using SharpVideo.Linux.Native.Drm;
@@ -158,6 +159,18 @@ public class ConstantsAndEnumsTests
         Assert.Equal(0x80000, (int)OpenFlags.O_CLOEXEC);
     }
 
+    [Fact]
+    public void TestArchOpenFlags_DirectDependsOnArchitecture()
+    {
+        // 0x4000 is O_DIRECTORY on ARM, O_DIRECT moved there
+        Assert.Equal(0x4000, (int)ArchOpenFlags.GetDirect(Architecture.X64));
+        Assert.Equal(0x4000, (int)ArchOpenFlags.GetDirect(Architecture.S390x));
+        Assert.Equal(0x10000, (int)ArchOpenFlags.GetDirect(Architecture.Arm));
+        Assert.Equal(0x10000, (int)ArchOpenFlags.GetDirect(Architecture.Arm64));
+        Assert.Equal(0x20000, (int)ArchOpenFlags.GetDirect(Architecture.Ppc64le));
+        Assert.Equal(ArchOpenFlags.GetDirect(RuntimeInformation.ProcessArchitecture), ArchOpenFlags.O_DIRECT);
+    }
+
     [Fact]
     public void TestProtFlags_HasExpectedValues()
     {
@@ -186,6 +199,15 @@ public class ConstantsAndEnumsTests
         Assert.Equal(2, (int)MsyncFlags.MS_INVALIDATE);
     }
 
+    [Fact]
+    public void TestEventFdFlags_HasExpectedValues()
+    {
+        // Test that eventfd flags match the generic Linux ABI (O_NONBLOCK and O_CLOEXEC)
+        Assert.Equal(0x1, (int)EventFdFlags.EFD_SEMAPHORE);
+        Assert.Equal(0x800, (int)EventFdFlags.EFD_NONBLOCK);
+        Assert.Equal(0x80000, (int)EventFdFlags.EFD_CLOEXEC);
+    }
+
     #endregion
 
     #region V4L2BufferFlags Tests
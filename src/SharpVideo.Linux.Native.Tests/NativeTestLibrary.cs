@@ -1,6 +1,8 @@
 using System.Runtime.InteropServices;
 
+using SharpVideo.Linux.Native.C;
 using SharpVideo.Linux.Native.Dma;
+using SharpVideo.Linux.Native.IoUring;
 using SharpVideo.Linux.Native.V4L2;
 
 namespace SharpVideo.Linux.Native.Tests;
@@ -231,4 +233,56 @@ public static unsafe partial class NativeTestLibrary
 
     [LibraryImport(LibraryName, EntryPoint = "get_native_v4l2_cid_stateless_h264_decode_params")]
     public static partial uint GetNativeV4L2CidStatelessH264DecodeParams();
+
+    // Socket structures
+
+    [LibraryImport(LibraryName, EntryPoint = "fill_native_mmsghdr")]
+    public static partial void FillNativeMMsgHdr(MMsgHdr* structure);
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_mmsghdr_size")]
+    public static partial int GetNativeMMsgHdrSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_msghdr_size")]
+    public static partial int GetNativeMsgHdrSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_iovec_size")]
+    public static partial int GetNativeIoVecSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_cmsghdr_size")]
+    public static partial int GetNativeCMsgHdrSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_cmsg_data_offset")]
+    public static partial int GetNativeCMsgDataOffset();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_timespec_size")]
+    public static partial int GetNativeTimeSpecSize();
+
+    // io_uring structures
+
+    [LibraryImport(LibraryName, EntryPoint = "fill_native_io_uring_sqe")]
+    public static partial void FillNativeIoUringSqe(IoUringSqe* structure);
+
+    [LibraryImport(LibraryName, EntryPoint = "fill_native_io_uring_params")]
+    public static partial void FillNativeIoUringParams(IoUringParams* structure);
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_io_uring_sqe_size")]
+    public static partial int GetNativeIoUringSqeSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_io_uring_cqe_size")]
+    public static partial int GetNativeIoUringCqeSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_io_uring_params_size")]
+    public static partial int GetNativeIoUringParamsSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_io_uring_buf_size")]
+    public static partial int GetNativeIoUringBufSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_io_uring_buf_reg_size")]
+    public static partial int GetNativeIoUringBufRegSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_io_uring_recvmsg_out_size")]
+    public static partial int GetNativeIoUringRecvmsgOutSize();
+
+    [LibraryImport(LibraryName, EntryPoint = "get_native_io_uring_getevents_arg_size")]
+    public static partial int GetNativeIoUringGeteventsArgSize();
 }
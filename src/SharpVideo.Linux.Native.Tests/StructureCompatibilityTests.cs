@@ -1,8 +1,10 @@
 using System.Runtime.InteropServices;
 using Xunit;
 using System.Linq;
+using SharpVideo.Linux.Native.C;
 using SharpVideo.Linux.Native.Dma;
 using SharpVideo.Linux.Native.Drm;
+using SharpVideo.Linux.Native.IoUring;
 using SharpVideo.Linux.Native.V4L2;
 
 namespace SharpVideo.Linux.Native.Tests;
@@ -657,5 +659,89 @@ public unsafe class StructureCompatibilityTests
             Marshal.FreeHGlobal(ptr);
         }
     }
-}
 
+    // Socket Structure Compatibility Tests
+
+    [Fact]
+    public void TestMMsgHdr_NativeSizeCompatibility()
+    {
+        Assert.Equal(NativeTestLibrary.GetNativeMMsgHdrSize(), Marshal.SizeOf<MMsgHdr>());
+        Assert.Equal(NativeTestLibrary.GetNativeMsgHdrSize(), Marshal.SizeOf<MsgHdr>());
+        Assert.Equal(NativeTestLibrary.GetNativeIoVecSize(), Marshal.SizeOf<IoVec>());
+        Assert.Equal(NativeTestLibrary.GetNativeTimeSpecSize(), Marshal.SizeOf<TimeSpec>());
+    }
+
+    [Fact]
+    public void TestMMsgHdr_NativeMemoryLayoutCompatibility()
+    {
+        var nativeFilledStruct = new MMsgHdr();
+
+        NativeTestLibrary.FillNativeMMsgHdr(&nativeFilledStruct);
+
+        Assert.Equal(unchecked((nint)0x1111111111111111L), nativeFilledStruct.msg_hdr.msg_name);
+        Assert.Equal(0x22222222u, nativeFilledStruct.msg_hdr.msg_namelen);
+        Assert.Equal(unchecked((nint)0x3333333333333333L), nativeFilledStruct.msg_hdr.msg_iov);
+        Assert.Equal((nuint)0x4444444444444444UL, nativeFilledStruct.msg_hdr.msg_iovlen);
+        Assert.Equal(unchecked((nint)0x5555555555555555L), nativeFilledStruct.msg_hdr.msg_control);
+        Assert.Equal((nuint)0x6666666666666666UL, nativeFilledStruct.msg_hdr.msg_controllen);
+        Assert.Equal(0x77777777, nativeFilledStruct.msg_hdr.msg_flags);
+        Assert.Equal(0x88888888u, nativeFilledStruct.msg_len);
+    }
+
+    [Fact]
+    public void TestCMsgHdr_NativeLayoutCompatibility()
+    {
+        Assert.Equal(NativeTestLibrary.GetNativeCMsgHdrSize(), Marshal.SizeOf<CMsgHdr>());
+        Assert.Equal(NativeTestLibrary.GetNativeCMsgDataOffset(), CMsgHdr.DataOffset);
+    }
+
+    [Fact]
+    public void TestIoUring_NativeSizeCompatibility()
+    {
+        Assert.Equal(NativeTestLibrary.GetNativeIoUringSqeSize(), Marshal.SizeOf<IoUringSqe>());
+        Assert.Equal(NativeTestLibrary.GetNativeIoUringCqeSize(), Marshal.SizeOf<IoUringCqe>());
+        Assert.Equal(NativeTestLibrary.GetNativeIoUringParamsSize(), Marshal.SizeOf<IoUringParams>());
+        Assert.Equal(NativeTestLibrary.GetNativeIoUringBufSize(), Marshal.SizeOf<IoUringBuf>());
+        Assert.Equal(NativeTestLibrary.GetNativeIoUringBufRegSize(), Marshal.SizeOf<IoUringBufReg>());
+        Assert.Equal(NativeTestLibrary.GetNativeIoUringRecvmsgOutSize(), Marshal.SizeOf<IoUringRecvmsgOut>());
+        Assert.Equal(NativeTestLibrary.GetNativeIoUringGeteventsArgSize(), Marshal.SizeOf<IoUringGeteventsArg>());
+    }
+
+    [Fact]
+    public void TestIoUringSqe_NativeMemoryLayoutCompatibility()
+    {
+        var nativeFilledStruct = new IoUringSqe();
+
+        NativeTestLibrary.FillNativeIoUringSqe(&nativeFilledStruct);
+
+        Assert.Equal((IoUringOp)0x11, nativeFilledStruct.opcode);
+        Assert.Equal(0x22, nativeFilledStruct.flags);
+        Assert.Equal(0x3333, nativeFilledStruct.ioprio);
+        Assert.Equal(0x44444444, nativeFilledStruct.fd);
+        Assert.Equal(0x5555555555555555UL, nativeFilledStruct.off);
+        Assert.Equal(0x6666666666666666UL, nativeFilledStruct.addr);
+        Assert.Equal(0x77777777u, nativeFilledStruct.len);
+        Assert.Equal(0x88888888u, nativeFilledStruct.op_flags);
+        Assert.Equal(0x9999999999999999UL, nativeFilledStruct.user_data);
+        Assert.Equal(0xAAAA, nativeFilledStruct.buf_index);
+        Assert.Equal(0xBBBB, nativeFilledStruct.personality);
+        Assert.Equal(unchecked((int)0xCCCCCCCC), nativeFilledStruct.file_index);
+        Assert.Equal(0xDDDDDDDDDDDDDDDDUL, nativeFilledStruct.addr3);
+    }
+
+    [Fact]
+    public void TestIoUringParams_NativeMemoryLayoutCompatibility()
+    {
+        var nativeFilledStruct = new IoUringParams();
+
+        NativeTestLibrary.FillNativeIoUringParams(&nativeFilledStruct);
+
+        Assert.Equal(0x11111111u, nativeFilledStruct.sq_entries);
+        Assert.Equal((IoUringSetupFlags)0x22222222, nativeFilledStruct.flags);
+        Assert.Equal(0x33333333u, nativeFilledStruct.features);
+        Assert.Equal(0x44444444u, nativeFilledStruct.sq_off.tail);
+        Assert.Equal(0x55555555u, nativeFilledStruct.sq_off.array);
+        Assert.Equal(0x66666666u, nativeFilledStruct.cq_off.cqes);
+        Assert.Equal(0x77777777u, nativeFilledStruct.cq_off.flags);
+    }
+}
@@ -1,9 +1,14 @@
+#define _GNU_SOURCE
 #include <stdint.h>
 #include <string.h>
 #include <fcntl.h>
 #include <xf86drmMode.h>
 #include <linux/dma-heap.h>
 #include <linux/videodev2.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <time.h>
 
 // We use the real DRM structures from libdrm headers
 
@@ -436,4 +441,105 @@ void fill_native_v4l2_ctrl_h264_sps(struct v4l2_ctrl_h264_sps* s) {
 // Function to get v4l2_ctrl_h264_sps structure size for verification
 int get_native_v4l2_ctrl_h264_sps_size(void) {
     return sizeof(struct v4l2_ctrl_h264_sps);
-}
\ No newline at end of file
+}
+
+// Socket structures used by the batched UDP receive path
+
+void fill_native_mmsghdr(struct mmsghdr* s) {
+    if (!s) return;
+
+    s->msg_hdr.msg_name = (void*)0x1111111111111111ULL;
+    s->msg_hdr.msg_namelen = 0x22222222;
+    s->msg_hdr.msg_iov = (struct iovec*)0x3333333333333333ULL;
+    s->msg_hdr.msg_iovlen = 0x4444444444444444ULL;
+    s->msg_hdr.msg_control = (void*)0x5555555555555555ULL;
+    s->msg_hdr.msg_controllen = 0x6666666666666666ULL;
+    s->msg_hdr.msg_flags = 0x77777777;
+    s->msg_len = 0x88888888;
+}
+
+int get_native_mmsghdr_size(void) {
+    return sizeof(struct mmsghdr);
+}
+
+int get_native_msghdr_size(void) {
+    return sizeof(struct msghdr);
+}
+
+int get_native_iovec_size(void) {
+    return sizeof(struct iovec);
+}
+
+int get_native_cmsghdr_size(void) {
+    return sizeof(struct cmsghdr);
+}
+
+int get_native_cmsg_data_offset(void) {
+    return (int)CMSG_LEN(0);
+}
+
+int get_native_timespec_size(void) {
+    return sizeof(struct timespec);
+}
+
+// io_uring structures used by the io_uring network and file I/O backend
+
+void fill_native_io_uring_sqe(struct io_uring_sqe* s) {
+    if (!s) return;
+
+    memset(s, 0, sizeof(*s));
+    s->opcode = 0x11;
+    s->flags = 0x22;
+    s->ioprio = 0x3333;
+    s->fd = 0x44444444;
+    s->off = 0x5555555555555555ULL;
+    s->addr = 0x6666666666666666ULL;
+    s->len = 0x77777777;
+    s->msg_flags = 0x88888888;
+    s->user_data = 0x9999999999999999ULL;
+    s->buf_index = 0xAAAA;
+    s->personality = 0xBBBB;
+    s->file_index = 0xCCCCCCCC;
+    s->addr3 = 0xDDDDDDDDDDDDDDDDULL;
+}
+
+void fill_native_io_uring_params(struct io_uring_params* s) {
+    if (!s) return;
+
+    memset(s, 0, sizeof(*s));
+    s->sq_entries = 0x11111111;
+    s->flags = 0x22222222;
+    s->features = 0x33333333;
+    s->sq_off.tail = 0x44444444;
+    s->sq_off.array = 0x55555555;
+    s->cq_off.cqes = 0x66666666;
+    s->cq_off.flags = 0x77777777;
+}
+
+int get_native_io_uring_sqe_size(void) {
+    return sizeof(struct io_uring_sqe);
+}
+
+int get_native_io_uring_cqe_size(void) {
+    return sizeof(struct io_uring_cqe);
+}
+
+int get_native_io_uring_params_size(void) {
+    return sizeof(struct io_uring_params);
+}
+
+int get_native_io_uring_buf_size(void) {
+    return sizeof(struct io_uring_buf);
+}
+
+int get_native_io_uring_buf_reg_size(void) {
+    return sizeof(struct io_uring_buf_reg);
+}
+
+int get_native_io_uring_recvmsg_out_size(void) {
+    return sizeof(struct io_uring_recvmsg_out);
+}
+
+int get_native_io_uring_getevents_arg_size(void) {
+    return sizeof(struct io_uring_getevents_arg);
+}
@@ -0,0 +1,20 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Offsets of the completion ring fields in its mapping (equivalent to struct io_cqring_offsets in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct IoCqringOffsets
+{
+    public uint head;
+    public uint tail;
+    public uint ring_mask;
+    public uint ring_entries;
+    public uint overflow;
+    public uint cqes;
+    public uint flags;
+    public uint resv1;
+    public ulong user_addr;
+}
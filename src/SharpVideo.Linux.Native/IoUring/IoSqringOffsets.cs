@@ -0,0 +1,20 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Offsets of the submission ring fields in its mapping (equivalent to struct io_sqring_offsets in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct IoSqringOffsets
+{
+    public uint head;
+    public uint tail;
+    public uint ring_mask;
+    public uint ring_entries;
+    public uint flags;
+    public uint dropped;
+    public uint array;
+    public uint resv1;
+    public ulong user_addr;
+}
@@ -0,0 +1,28 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Entry of a provided buffer ring (equivalent to struct io_uring_buf in C). The tail of the ring overlays
+/// <see cref="resv"/> of the first entry.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct IoUringBuf
+{
+    /// <summary>
+    /// Start of the buffer.
+    /// </summary>
+    public ulong addr;
+
+    /// <summary>
+    /// Size of the buffer.
+    /// </summary>
+    public uint len;
+
+    /// <summary>
+    /// Buffer id, reported back in the completion.
+    /// </summary>
+    public ushort bid;
+
+    public ushort resv;
+}
@@ -0,0 +1,28 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Argument of IORING_REGISTER_PBUF_RING (equivalent to struct io_uring_buf_reg in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct IoUringBufReg
+{
+    /// <summary>
+    /// Page aligned array of <see cref="IoUringBuf"/>.
+    /// </summary>
+    public ulong ring_addr;
+
+    /// <summary>
+    /// Number of entries, a power of two.
+    /// </summary>
+    public uint ring_entries;
+
+    /// <summary>
+    /// Buffer group id selected by <see cref="IoUringSqe.buf_index"/>.
+    /// </summary>
+    public ushort bgid;
+
+    public ushort flags;
+    public fixed ulong resv[3];
+}
@@ -0,0 +1,66 @@
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// io_uring flags, mmap offsets and io_uring_register opcodes.
+/// </summary>
+public static class IoUringConstants
+{
+    // Submission queue entry flags (sqe->flags)
+    public const byte IOSQE_FIXED_FILE = 1 << 0;
+    public const byte IOSQE_IO_DRAIN = 1 << 1;
+    public const byte IOSQE_IO_LINK = 1 << 2;
+    public const byte IOSQE_ASYNC = 1 << 4;
+    public const byte IOSQE_BUFFER_SELECT = 1 << 5;
+    public const byte IOSQE_CQE_SKIP_SUCCESS = 1 << 6;
+
+    // Send/receive flags (sqe->ioprio)
+    public const ushort IORING_RECVSEND_POLL_FIRST = 1 << 0;
+    public const ushort IORING_RECV_MULTISHOT = 1 << 1;
+
+    // Cancel flags (sqe->cancel_flags)
+    public const uint IORING_ASYNC_CANCEL_ALL = 1U << 0;
+    public const uint IORING_ASYNC_CANCEL_FD = 1U << 1;
+    public const uint IORING_ASYNC_CANCEL_ANY = 1U << 2;
+
+    // Completion flags (cqe->flags)
+    public const uint IORING_CQE_F_BUFFER = 1U << 0;
+    public const uint IORING_CQE_F_MORE = 1U << 1;
+    public const uint IORING_CQE_F_SOCK_NONEMPTY = 1U << 2;
+    public const int IORING_CQE_BUFFER_SHIFT = 16;
+
+    // Magic offsets to mmap the rings
+    public const long IORING_OFF_SQ_RING = 0;
+    public const long IORING_OFF_CQ_RING = 0x8000000;
+    public const long IORING_OFF_SQES = 0x10000000;
+
+    // Submission ring flags (sq_ring->flags)
+    public const uint IORING_SQ_NEED_WAKEUP = 1U << 0;
+    public const uint IORING_SQ_CQ_OVERFLOW = 1U << 1;
+    public const uint IORING_SQ_TASKRUN = 1U << 2;
+
+    // io_uring_enter flags
+    public const uint IORING_ENTER_GETEVENTS = 1U << 0;
+    public const uint IORING_ENTER_SQ_WAKEUP = 1U << 1;
+    public const uint IORING_ENTER_EXT_ARG = 1U << 3;
+
+    // Features reported by io_uring_setup (params->features)
+    public const uint IORING_FEAT_SINGLE_MMAP = 1U << 0;
+    public const uint IORING_FEAT_NODROP = 1U << 1;
+    public const uint IORING_FEAT_EXT_ARG = 1U << 8;
+
+    // io_uring_register opcodes
+    public const uint IORING_REGISTER_BUFFERS = 0;
+    public const uint IORING_UNREGISTER_BUFFERS = 1;
+    public const uint IORING_REGISTER_FILES = 2;
+    public const uint IORING_UNREGISTER_FILES = 3;
+    public const uint IORING_REGISTER_PBUF_RING = 22;
+    public const uint IORING_UNREGISTER_PBUF_RING = 23;
+
+    // Errors reported by io_uring_enter and in cqe->res (as negative values)
+    public const int ENOENT = 2;
+    public const int EBUSY = 16;
+    public const int EINVAL = 22;
+    public const int ETIME = 62;
+    public const int ENOBUFS = 105;
+    public const int ECANCELED = 125;
+}
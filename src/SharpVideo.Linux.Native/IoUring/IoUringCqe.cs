@@ -0,0 +1,30 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Completion queue entry (equivalent to struct io_uring_cqe in C without IORING_SETUP_CQE32).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct IoUringCqe
+{
+    /// <summary>
+    /// <see cref="IoUringSqe.user_data"/> of the request.
+    /// </summary>
+    public ulong user_data;
+
+    /// <summary>
+    /// Result of the operation, a negative errno on failure.
+    /// </summary>
+    public int res;
+
+    /// <summary>
+    /// IORING_CQE_F_* flags, the upper 16 bits hold the buffer id with IORING_CQE_F_BUFFER.
+    /// </summary>
+    public uint flags;
+
+    /// <summary>
+    /// Id of the provided buffer the data was received into.
+    /// </summary>
+    public readonly ushort BufferId => (ushort)(flags >> IoUringConstants.IORING_CQE_BUFFER_SHIFT);
+}
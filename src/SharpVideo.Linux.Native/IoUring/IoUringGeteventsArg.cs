@@ -0,0 +1,19 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Extended argument of io_uring_enter with IORING_ENTER_EXT_ARG (equivalent to struct io_uring_getevents_arg in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct IoUringGeteventsArg
+{
+    public ulong sigmask;
+    public uint sigmask_sz;
+    public uint pad;
+
+    /// <summary>
+    /// Pointer to a struct __kernel_timespec bounding the wait.
+    /// </summary>
+    public ulong ts;
+}
@@ -0,0 +1,22 @@
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Operations of a submission queue entry (enum io_uring_op in C). Only the operations used are listed.
+/// </summary>
+public enum IoUringOp : byte
+{
+    IORING_OP_NOP = 0,
+    IORING_OP_READV = 1,
+    IORING_OP_WRITEV = 2,
+    IORING_OP_FSYNC = 3,
+    IORING_OP_READ_FIXED = 4,
+    IORING_OP_WRITE_FIXED = 5,
+    IORING_OP_SENDMSG = 9,
+    IORING_OP_RECVMSG = 10,
+    IORING_OP_TIMEOUT = 11,
+    IORING_OP_ASYNC_CANCEL = 14,
+    IORING_OP_READ = 22,
+    IORING_OP_WRITE = 23,
+    IORING_OP_SEND = 26,
+    IORING_OP_RECV = 27
+}
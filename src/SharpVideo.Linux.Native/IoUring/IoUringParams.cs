@@ -0,0 +1,32 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Parameters of io_uring_setup, filled in by the kernel with the ring sizes and mapping offsets (equivalent to
+/// struct io_uring_params in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public unsafe struct IoUringParams
+{
+    public uint sq_entries;
+    public uint cq_entries;
+
+    /// <summary>
+    /// Setup flags.
+    /// </summary>
+    public IoUringSetupFlags flags;
+
+    public uint sq_thread_cpu;
+    public uint sq_thread_idle;
+
+    /// <summary>
+    /// IORING_FEAT_* flags supported by the kernel.
+    /// </summary>
+    public uint features;
+
+    public uint wq_fd;
+    public fixed uint resv[3];
+    public IoSqringOffsets sq_off;
+    public IoCqringOffsets cq_off;
+}
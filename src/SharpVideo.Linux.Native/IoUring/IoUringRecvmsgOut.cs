@@ -0,0 +1,31 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Header a multishot recvmsg writes at the start of every provided buffer, followed by the source address, the
+/// ancillary data and the payload (equivalent to struct io_uring_recvmsg_out in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct IoUringRecvmsgOut
+{
+    /// <summary>
+    /// Full length of the source address, it is truncated to the msg_namelen of the request.
+    /// </summary>
+    public uint namelen;
+
+    /// <summary>
+    /// Length of the ancillary data, truncated to the msg_controllen of the request.
+    /// </summary>
+    public uint controllen;
+
+    /// <summary>
+    /// Length of the datagram, larger than the space left in the buffer if it was truncated.
+    /// </summary>
+    public uint payloadlen;
+
+    /// <summary>
+    /// Flags of the received message (MSG_TRUNC, MSG_CTRUNC, ...).
+    /// </summary>
+    public int flags;
+}
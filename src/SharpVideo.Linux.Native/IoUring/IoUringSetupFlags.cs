@@ -0,0 +1,46 @@
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Flags of io_uring_setup.
+/// </summary>
+[Flags]
+public enum IoUringSetupFlags : uint
+{
+    None = 0,
+
+    /// <summary>
+    /// Busy poll for completions, only for O_DIRECT files on polling capable devices.
+    /// </summary>
+    IORING_SETUP_IOPOLL = 1U << 0,
+
+    /// <summary>
+    /// A kernel thread polls the submission queue.
+    /// </summary>
+    IORING_SETUP_SQPOLL = 1U << 1,
+
+    /// <summary>
+    /// The completion queue size is taken from <see cref="IoUringParams.cq_entries"/>.
+    /// </summary>
+    IORING_SETUP_CQSIZE = 1U << 3,
+
+    /// <summary>
+    /// Clamp the ring sizes to the maximum instead of failing.
+    /// </summary>
+    IORING_SETUP_CLAMP = 1U << 4,
+
+    /// <summary>
+    /// Run completion work when the task enters the kernel anyway, instead of interrupting it.
+    /// </summary>
+    IORING_SETUP_COOP_TASKRUN = 1U << 8,
+
+    /// <summary>
+    /// Only one thread submits requests (kernel 6.0).
+    /// </summary>
+    IORING_SETUP_SINGLE_ISSUER = 1U << 12,
+
+    /// <summary>
+    /// Defer completion work until the submitting thread waits for completions (kernel 6.1, needs
+    /// <see cref="IORING_SETUP_SINGLE_ISSUER"/>).
+    /// </summary>
+    IORING_SETUP_DEFER_TASKRUN = 1U << 13
+}
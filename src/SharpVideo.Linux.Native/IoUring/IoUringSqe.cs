@@ -0,0 +1,89 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.IoUring;
+
+/// <summary>
+/// Submission queue entry (equivalent to struct io_uring_sqe in C). The unions of the C structure are exposed by
+/// their most common member.
+/// </summary>
+[StructLayout(LayoutKind.Explicit, Size = 64)]
+public struct IoUringSqe
+{
+    /// <summary>
+    /// Operation, see <see cref="IoUringOp"/>.
+    /// </summary>
+    [FieldOffset(0)]
+    public IoUringOp opcode;
+
+    /// <summary>
+    /// IOSQE_* flags.
+    /// </summary>
+    [FieldOffset(1)]
+    public byte flags;
+
+    /// <summary>
+    /// I/O priority, or the send/receive flags (IORING_RECV_MULTISHOT, ...) of socket operations.
+    /// </summary>
+    [FieldOffset(2)]
+    public ushort ioprio;
+
+    /// <summary>
+    /// File descriptor to do I/O on.
+    /// </summary>
+    [FieldOffset(4)]
+    public int fd;
+
+    /// <summary>
+    /// Offset into the file.
+    /// </summary>
+    [FieldOffset(8)]
+    public ulong off;
+
+    /// <summary>
+    /// Pointer to the buffer, iovecs or msghdr.
+    /// </summary>
+    [FieldOffset(16)]
+    public ulong addr;
+
+    /// <summary>
+    /// Buffer size or number of iovecs.
+    /// </summary>
+    [FieldOffset(24)]
+    public uint len;
+
+    /// <summary>
+    /// Operation specific flags (rw_flags, msg_flags, cancel_flags, ...).
+    /// </summary>
+    [FieldOffset(28)]
+    public uint op_flags;
+
+    /// <summary>
+    /// Passed back unchanged in the completion.
+    /// </summary>
+    [FieldOffset(32)]
+    public ulong user_data;
+
+    /// <summary>
+    /// Index into the registered buffers, or the provided buffer group with IOSQE_BUFFER_SELECT.
+    /// </summary>
+    [FieldOffset(40)]
+    public ushort buf_index;
+
+    /// <summary>
+    /// Personality (credentials) to issue the request with.
+    /// </summary>
+    [FieldOffset(42)]
+    public ushort personality;
+
+    /// <summary>
+    /// Splice input descriptor or direct descriptor index.
+    /// </summary>
+    [FieldOffset(44)]
+    public int file_index;
+
+    /// <summary>
+    /// Extra operation argument.
+    /// </summary>
+    [FieldOffset(48)]
+    public ulong addr3;
+}
@@ -1,6 +1,7 @@
 ﻿using System.Runtime.InteropServices;
 using System.Runtime.Versioning;
 using SharpVideo.Linux.Native.C;
+using SharpVideo.Linux.Native.IoUring;
 
 namespace SharpVideo.Linux.Native;
 
@@ -163,4 +164,153 @@ public static partial class Libc
         EntryPoint = "poll",
         SetLastError = true)]
     public static unsafe partial int poll(ref PollFd fds, nuint nfds, int timeout);
+
+    /// <summary>
+    /// Creates an event counter file descriptor for signalling between threads.
+    /// </summary>
+    /// <param name="initval">Initial value of the counter.</param>
+    /// <param name="flags">EFD_* flags.</param>
+    /// <returns>A file descriptor on success, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "eventfd",
+        SetLastError = true)]
+    public static partial int eventfd(uint initval, EventFdFlags flags);
+
+    /// <summary>
+    /// Reads up to count bytes from a file descriptor.
+    /// </summary>
+    /// <param name="fd">The file descriptor.</param>
+    /// <param name="buf">Buffer to read into.</param>
+    /// <param name="count">Size of the buffer.</param>
+    /// <returns>Number of bytes read, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "read",
+        SetLastError = true)]
+    public static unsafe partial nint read(int fd, void* buf, nuint count);
+
+    /// <summary>
+    /// Writes up to count bytes to a file descriptor.
+    /// </summary>
+    /// <param name="fd">The file descriptor.</param>
+    /// <param name="buf">Data to write.</param>
+    /// <param name="count">Number of bytes to write.</param>
+    /// <returns>Number of bytes written, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "write",
+        SetLastError = true)]
+    public static unsafe partial nint write(int fd, void* buf, nuint count);
+
+    /// <summary>
+    /// Receives multiple messages from a socket using a single system call.
+    /// </summary>
+    /// <param name="sockfd">The socket file descriptor.</param>
+    /// <param name="msgvec">Pointer to an array of mmsghdr structures.</param>
+    /// <param name="vlen">Number of elements in msgvec.</param>
+    /// <param name="flags">Receive flags (MSG_DONTWAIT, MSG_WAITFORONE, ...).</param>
+    /// <param name="timeout">Optional timeout, may be null.</param>
+    /// <returns>Number of messages received, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "recvmmsg",
+        SetLastError = true)]
+    public static unsafe partial int recvmmsg(int sockfd, MMsgHdr* msgvec, uint vlen, int flags, TimeSpec* timeout);
+
+    /// <summary>
+    /// Sends multiple messages on a socket using a single system call.
+    /// </summary>
+    /// <param name="sockfd">The socket file descriptor.</param>
+    /// <param name="msgvec">Pointer to an array of mmsghdr structures, msg_len is set to the bytes sent.</param>
+    /// <param name="vlen">Number of elements in msgvec.</param>
+    /// <param name="flags">Send flags (MSG_DONTWAIT, ...).</param>
+    /// <returns>Number of messages sent, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "sendmmsg",
+        SetLastError = true)]
+    public static unsafe partial int sendmmsg(int sockfd, MMsgHdr* msgvec, uint vlen, int flags);
+
+    /// <summary>
+    /// Sets an option on a socket.
+    /// </summary>
+    /// <param name="sockfd">The socket file descriptor.</param>
+    /// <param name="level">Protocol level (SOL_SOCKET, SOL_UDP, ...).</param>
+    /// <param name="optname">Option name.</param>
+    /// <param name="optval">Pointer to the option value.</param>
+    /// <param name="optlen">Size of the option value.</param>
+    /// <returns>0 on success, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "setsockopt",
+        SetLastError = true)]
+    public static unsafe partial int setsockopt(int sockfd, int level, int optname, void* optval, uint optlen);
+
+    /// <summary>
+    /// Restricts a thread to a set of CPUs.
+    /// </summary>
+    /// <param name="pid">Thread id, 0 for the calling thread.</param>
+    /// <param name="cpusetsize">Size of the CPU mask in bytes.</param>
+    /// <param name="mask">CPU mask (cpu_set_t), bit n allows CPU n.</param>
+    /// <returns>0 on success, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "sched_setaffinity",
+        SetLastError = true)]
+    public static unsafe partial int sched_setaffinity(int pid, nuint cpusetsize, ulong* mask);
+
+    // io_uring system call numbers, the same on all architectures
+    private const long SYS_io_uring_setup = 425;
+    private const long SYS_io_uring_enter = 426;
+    private const long SYS_io_uring_register = 427;
+
+    /// <summary>
+    /// Invokes a system call that has no C library wrapper.
+    /// </summary>
+    /// <returns>The result of the system call, or -1 on error.</returns>
+    [LibraryImport(
+        LibraryName,
+        EntryPoint = "syscall",
+        SetLastError = true)]
+    private static partial long syscall(long number, long arg1, long arg2, long arg3, long arg4, long arg5, long arg6);
+
+    /// <summary>
+    /// Creates an io_uring instance.
+    /// </summary>
+    /// <param name="entries">Requested number of submission queue entries.</param>
+    /// <param name="p">Setup parameters, filled in with the ring sizes and mmap offsets.</param>
+    /// <returns>The ring file descriptor, or -1 on error.</returns>
+    public static unsafe int io_uring_setup(uint entries, IoUringParams* p)
+    {
+        return (int)syscall(SYS_io_uring_setup, entries, (long)p, 0, 0, 0, 0);
+    }
+
+    /// <summary>
+    /// Submits queued entries and optionally waits for completions.
+    /// </summary>
+    /// <param name="fd">The ring file descriptor.</param>
+    /// <param name="toSubmit">Number of entries to submit.</param>
+    /// <param name="minComplete">Number of completions to wait for with IORING_ENTER_GETEVENTS.</param>
+    /// <param name="flags">IORING_ENTER_* flags.</param>
+    /// <param name="arg">Signal mask, or <see cref="IoUringGeteventsArg"/> with IORING_ENTER_EXT_ARG.</param>
+    /// <param name="argSize">Size of the argument.</param>
+    /// <returns>Number of entries submitted, or -1 on error.</returns>
+    public static unsafe int io_uring_enter(int fd, uint toSubmit, uint minComplete, uint flags, void* arg, nuint argSize)
+    {
+        return (int)syscall(SYS_io_uring_enter, fd, toSubmit, minComplete, flags, (long)arg, (long)argSize);
+    }
+
+    /// <summary>
+    /// Registers buffers, files or provided buffer rings with an io_uring instance.
+    /// </summary>
+    /// <param name="fd">The ring file descriptor.</param>
+    /// <param name="opcode">IORING_REGISTER_* opcode.</param>
+    /// <param name="arg">Opcode specific argument.</param>
+    /// <param name="nrArgs">Number of elements in the argument.</param>
+    /// <returns>0 or a positive value on success, or -1 on error.</returns>
+    public static unsafe int io_uring_register(int fd, uint opcode, void* arg, uint nrArgs)
+    {
+        return (int)syscall(SYS_io_uring_register, fd, opcode, (long)arg, nrArgs, 0, 0);
+    }
 }
\ No newline at end of file
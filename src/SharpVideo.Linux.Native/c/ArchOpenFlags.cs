@@ -0,0 +1,28 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Open flags whose values depend on the architecture, so they cannot be members of <see cref="OpenFlags"/>.
+/// </summary>
+public static class ArchOpenFlags
+{
+    /// <summary>
+    /// O_DIRECT of the running process's architecture.
+    /// </summary>
+    public static OpenFlags O_DIRECT { get; } = GetDirect(RuntimeInformation.ProcessArchitecture);
+
+    /// <summary>
+    /// O_DIRECT of an architecture: 0x4000 in the generic ABI (x86, x86_64, RISC-V, LoongArch, s390x), 0x10000 on ARM
+    /// and ARM64, where 0x4000 is O_DIRECTORY, and 0x20000 on PowerPC.
+    /// </summary>
+    public static OpenFlags GetDirect(Architecture architecture)
+    {
+        return architecture switch
+        {
+            Architecture.Arm or Architecture.Armv6 or Architecture.Arm64 => (OpenFlags)0x10000,
+            Architecture.Ppc64le => (OpenFlags)0x20000,
+            _ => (OpenFlags)0x4000
+        };
+    }
+}
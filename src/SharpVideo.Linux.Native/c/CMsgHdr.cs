@@ -0,0 +1,47 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Ancillary data object header (equivalent to struct cmsghdr in C).
+/// The data follows the header at <see cref="DataOffset"/>.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct CMsgHdr
+{
+    /// <summary>
+    /// Offset of the data from the start of the header (CMSG_DATA).
+    /// </summary>
+    public static readonly int DataOffset = Align(Marshal.SizeOf<CMsgHdr>());
+
+    /// <summary>
+    /// Data byte count, including the header.
+    /// </summary>
+    public nuint cmsg_len;
+
+    /// <summary>
+    /// Originating protocol.
+    /// </summary>
+    public int cmsg_level;
+
+    /// <summary>
+    /// Protocol-specific type.
+    /// </summary>
+    public int cmsg_type;
+
+    /// <summary>
+    /// Rounds length up to the ancillary data alignment (CMSG_ALIGN).
+    /// </summary>
+    public static int Align(int length)
+    {
+        return (length + nint.Size - 1) & ~(nint.Size - 1);
+    }
+
+    /// <summary>
+    /// Number of bytes an ancillary element with a payload of given size occupies (CMSG_SPACE).
+    /// </summary>
+    public static int Space(int dataLength)
+    {
+        return DataOffset + Align(dataLength);
+    }
+}
@@ -0,0 +1,28 @@
+﻿namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Flags of eventfd().
+/// </summary>
+[Flags]
+public enum EventFdFlags : int
+{
+    /// <summary>
+    /// No flags: read() returns and clears the counter.
+    /// </summary>
+    None = 0,
+
+    /// <summary>
+    /// read() returns 1 and decrements the counter by one.
+    /// </summary>
+    EFD_SEMAPHORE = 0x1,
+
+    /// <summary>
+    /// Non-blocking read() and write(), failing with EAGAIN instead.
+    /// </summary>
+    EFD_NONBLOCK = 0x800,
+
+    /// <summary>
+    /// Close the descriptor on exec.
+    /// </summary>
+    EFD_CLOEXEC = 0x80000
+}
@@ -0,0 +1,20 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Scatter/gather element (equivalent to struct iovec in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct IoVec
+{
+    /// <summary>
+    /// Starting address of the buffer.
+    /// </summary>
+    public nint iov_base;
+
+    /// <summary>
+    /// Number of bytes in the buffer.
+    /// </summary>
+    public nuint iov_len;
+}
@@ -0,0 +1,20 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Element of the vector passed to recvmmsg/sendmmsg (equivalent to struct mmsghdr in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct MMsgHdr
+{
+    /// <summary>
+    /// Message header.
+    /// </summary>
+    public MsgHdr msg_hdr;
+
+    /// <summary>
+    /// Number of bytes transmitted for this message.
+    /// </summary>
+    public uint msg_len;
+}
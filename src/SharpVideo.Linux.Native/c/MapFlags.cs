@@ -5,5 +5,6 @@ public enum MapFlags : int
 {
     MAP_SHARED = 0x01,
     MAP_PRIVATE = 0x02,
-    MAP_FIXED = 0x10
+    MAP_FIXED = 0x10,
+    MAP_POPULATE = 0x8000
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Message header used by sendmsg/recvmsg (equivalent to struct msghdr in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct MsgHdr
+{
+    /// <summary>
+    /// Optional address buffer (struct sockaddr_storage for received datagrams).
+    /// </summary>
+    public nint msg_name;
+
+    /// <summary>
+    /// Size of the address buffer. Updated by the kernel with the actual address length.
+    /// </summary>
+    public uint msg_namelen;
+
+    /// <summary>
+    /// Scatter/gather array of <see cref="IoVec"/>.
+    /// </summary>
+    public nint msg_iov;
+
+    /// <summary>
+    /// Number of elements in <see cref="msg_iov"/>.
+    /// </summary>
+    public nuint msg_iovlen;
+
+    /// <summary>
+    /// Ancillary (control) data buffer.
+    /// </summary>
+    public nint msg_control;
+
+    /// <summary>
+    /// Size of the ancillary data buffer. Updated by the kernel with the used length.
+    /// </summary>
+    public nuint msg_controllen;
+
+    /// <summary>
+    /// Flags on the received message (MSG_TRUNC, MSG_CTRUNC, ...).
+    /// </summary>
+    public int msg_flags;
+}
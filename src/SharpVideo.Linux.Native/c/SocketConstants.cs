@@ -0,0 +1,51 @@
+namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Socket option levels, option names and message flags that are not exposed by System.Net.Sockets.
+/// Values are those of the generic Linux ABI (x86_64, arm64).
+/// </summary>
+public static class SocketConstants
+{
+    // Option levels
+    public const int SOL_IP = 0;
+    public const int SOL_SOCKET = 1;
+    public const int SOL_UDP = 17;
+    public const int SOL_IPV6 = 41;
+
+    // SOL_SOCKET options
+    public const int SO_REUSEPORT = 15;
+    public const int SO_TIMESTAMPNS = 35;
+    public const int SCM_TIMESTAMPNS = SO_TIMESTAMPNS;
+
+    // SOL_IP and SOL_IPV6 multicast options
+    public const int IPV6_MULTICAST_ALL = 29;
+    public const int MCAST_JOIN_GROUP = 42;
+    public const int MCAST_JOIN_SOURCE_GROUP = 46;
+    public const int IP_MULTICAST_ALL = 49;
+
+    // SOL_UDP options
+    public const int UDP_SEGMENT = 103;
+    public const int UDP_GRO = 104;
+
+    // recvmsg/recvmmsg and sendmsg/sendmmsg flags
+    public const int MSG_TRUNC = 0x20;
+    public const int MSG_DONTWAIT = 0x40;
+    public const int MSG_WAITFORONE = 0x10000;
+
+    // Address families as found in sockaddr.sa_family
+    public const ushort AF_INET = 2;
+    public const ushort AF_INET6 = 10;
+
+    /// <summary>
+    /// Size of struct sockaddr_storage.
+    /// </summary>
+    public const int SOCKADDR_STORAGE_SIZE = 128;
+
+    // errno values returned by socket calls
+    public const int EINTR = 4;
+    public const int EIO = 5;
+    public const int EBADF = 9;
+    public const int EAGAIN = 11;
+    public const int EINVAL = 22;
+    public const int ENOTSOCK = 88;
+}
@@ -0,0 +1,25 @@
+using System.Runtime.InteropServices;
+
+namespace SharpVideo.Linux.Native.C;
+
+/// <summary>
+/// Time value with nanosecond resolution (equivalent to struct timespec in C).
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct TimeSpec
+{
+    /// <summary>
+    /// Seconds
+    /// </summary>
+    public long tv_sec;
+
+    /// <summary>
+    /// Nanoseconds
+    /// </summary>
+    public long tv_nsec;
+
+    /// <summary>
+    /// Total nanoseconds represented by this value.
+    /// </summary>
+    public readonly long TotalNanoseconds => tv_sec * 1_000_000_000L + tv_nsec;
+}
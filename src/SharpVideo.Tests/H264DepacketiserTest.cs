@@ -0,0 +1,170 @@
+using SharpVideo.RtpPlayerDemo.Rtp;
+
+namespace SharpVideo.Tests;
+
+public class H264DepacketiserTest
+{
+    private const uint Timestamp = 90000;
+
+    private static readonly byte[] StartCode = { 0x00, 0x00, 0x00, 0x01 };
+    private static readonly byte[] Sps = { 0x67, 0x42, 0xC0, 0x1F };
+    private static readonly byte[] Pps = { 0x68, 0xCE, 0x3C, 0x80 };
+    private static readonly byte[] IdrSlice = { 0x65, 0x88, 0x84, 0x21, 0xA0 };
+
+    private readonly H264Depacketiser _depacketiser = new();
+
+    [Fact]
+    public void TestSingleNalUnit()
+    {
+        using var frame = _depacketiser.ProcessRTPPayload(IdrSlice, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(IdrSlice), frame.Data.ToArray());
+        Assert.Equal(1, frame.NalUnitCount);
+        Assert.Equal(Timestamp, frame.Timestamp);
+        Assert.True(frame.IsKeyFrame);
+        Assert.False(frame.IsDamaged);
+    }
+
+    [Fact]
+    public void TestStapA()
+    {
+        var payload = Concat(new byte[] { 0x78 }, Unit(Sps), Unit(Pps), Unit(IdrSlice));
+
+        using var frame = _depacketiser.ProcessRTPPayload(payload, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(Sps, Pps, IdrSlice), frame.Data.ToArray());
+        Assert.Equal(3, frame.NalUnitCount);
+        Assert.Equal(AnnexB(Pps), frame.GetNalUnit(1).ToArray());
+    }
+
+    [Fact]
+    public void TestStapBSkipsDecodingOrderNumber()
+    {
+        var payload = Concat(new byte[] { 0x79, 0x12, 0x34 }, Unit(Sps), Unit(Pps));
+
+        using var frame = _depacketiser.ProcessRTPPayload(payload, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(Sps, Pps), frame.Data.ToArray());
+    }
+
+    [Fact]
+    public void TestMtap16SkipsTimestampOffsets()
+    {
+        // DONB, then per unit: size, DOND, 16 bit timestamp offset
+        var payload = Concat(
+            new byte[] { 0x7A, 0x00, 0x10 },
+            new byte[] { 0x00, (byte)Sps.Length, 0x00, 0xAB, 0xCD }, Sps,
+            new byte[] { 0x00, (byte)IdrSlice.Length, 0x01, 0xEF, 0x01 }, IdrSlice);
+
+        using var frame = _depacketiser.ProcessRTPPayload(payload, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(Sps, IdrSlice), frame.Data.ToArray());
+        Assert.True(frame.IsKeyFrame);
+        Assert.Equal(0, _depacketiser.MalformedPayloads);
+    }
+
+    [Fact]
+    public void TestMtap24SkipsTimestampOffsets()
+    {
+        // DONB, then per unit: size, DOND, 24 bit timestamp offset
+        var payload = Concat(
+            new byte[] { 0x7B, 0x00, 0x10 },
+            new byte[] { 0x00, (byte)Pps.Length, 0x00, 0xAB, 0xCD, 0xEF }, Pps,
+            new byte[] { 0x00, (byte)IdrSlice.Length, 0x01, 0x01, 0x02, 0x03 }, IdrSlice);
+
+        using var frame = _depacketiser.ProcessRTPPayload(payload, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(Pps, IdrSlice), frame.Data.ToArray());
+        Assert.Equal(0, _depacketiser.MalformedPayloads);
+    }
+
+    [Fact]
+    public void TestTruncatedAggregationUnitIsMalformed()
+    {
+        // The second unit claims more bytes than are left
+        var payload = Concat(new byte[] { 0x78 }, Unit(Sps), new byte[] { 0x00, 0x20, 0x68 });
+
+        using var frame = _depacketiser.ProcessRTPPayload(payload, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(Sps), frame.Data.ToArray());
+        Assert.Equal(1, _depacketiser.MalformedPayloads);
+    }
+
+    [Fact]
+    public void TestFuAReassemblesNalUnit()
+    {
+        // FU indicator keeps F and NRI (0x60) of the original header, the FU header carries its type
+        Assert.Null(_depacketiser.ProcessRTPPayload(new byte[] { 0x7C, 0x85, 0x01, 0x02 }, Timestamp, 0));
+        Assert.Null(_depacketiser.ProcessRTPPayload(new byte[] { 0x7C, 0x05, 0x03 }, Timestamp, 0));
+        using var frame = _depacketiser.ProcessRTPPayload(new byte[] { 0x7C, 0x45, 0x04, 0x05 }, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(new byte[] { 0x65, 0x01, 0x02, 0x03, 0x04, 0x05 }), frame.Data.ToArray());
+        Assert.True(frame.IsKeyFrame);
+    }
+
+    [Fact]
+    public void TestFuBSkipsDecodingOrderNumber()
+    {
+        // The first fragment is an FU-B with a DON, the others are FU-A (RFC 6184 5.8)
+        Assert.Null(_depacketiser.ProcessRTPPayload(new byte[] { 0x5D, 0x81, 0x12, 0x34, 0x9A, 0x01 }, Timestamp, 0));
+        using var frame = _depacketiser.ProcessRTPPayload(new byte[] { 0x5C, 0x41, 0x02, 0x03 }, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(new byte[] { 0x41, 0x9A, 0x01, 0x02, 0x03 }), frame.Data.ToArray());
+        Assert.False(frame.IsKeyFrame);
+    }
+
+    [Fact]
+    public void TestLostFragmentDropsOnlyThatNalUnit()
+    {
+        Assert.Null(_depacketiser.ProcessRTPPayload(Sps, Timestamp, 0));
+        Assert.Null(_depacketiser.ProcessRTPPayload(new byte[] { 0x7C, 0x85, 0x01 }, Timestamp, 0));
+        _depacketiser.NotifyPacketLoss();
+        using var frame = _depacketiser.ProcessRTPPayload(new byte[] { 0x7C, 0x45, 0x03 }, Timestamp, 1);
+
+        Assert.NotNull(frame);
+        Assert.Equal(AnnexB(Sps), frame.Data.ToArray());
+        Assert.True(frame.IsDamaged);
+        Assert.Equal(1, _depacketiser.DamagedFrames);
+    }
+
+    [Fact]
+    public void TestFrameWithoutMarkerIsCompletedByNextTimestamp()
+    {
+        Assert.Null(_depacketiser.ProcessRTPPayload(IdrSlice, Timestamp, 0));
+
+        Assert.False(_depacketiser.TryCompletePendingFrame(Timestamp, out _));
+        Assert.True(_depacketiser.TryCompletePendingFrame(Timestamp + 3000, out var frame));
+
+        using (frame)
+        {
+            Assert.Equal(AnnexB(IdrSlice), frame!.Data.ToArray());
+            Assert.Equal(Timestamp, frame.Timestamp);
+            Assert.True(frame.IsDamaged);
+        }
+
+        Assert.Equal(1, _depacketiser.FramesWithoutMarker);
+    }
+
+    private static byte[] Unit(byte[] nalUnit)
+    {
+        return Concat(new byte[] { (byte)(nalUnit.Length >> 8), (byte)nalUnit.Length }, nalUnit);
+    }
+
+    private static byte[] AnnexB(params byte[][] nalUnits)
+    {
+        return nalUnits.SelectMany(nalUnit => StartCode.Concat(nalUnit)).ToArray();
+    }
+
+    private static byte[] Concat(params byte[][] parts)
+    {
+        return parts.SelectMany(part => part).ToArray();
+    }
+}
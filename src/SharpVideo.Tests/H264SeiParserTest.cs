@@ -0,0 +1,143 @@
+﻿using SharpVideo.H264;
+
+namespace SharpVideo.Tests;
+
+public class H264SeiParserTest
+{
+    [Fact]
+    public void TestSampleUserDataUnregisteredMisp()
+    {
+        // SEI, user_data_unregistered() with a MISP microsecond timestamp
+        byte[] buffer =
+        {
+            0x05, 0x1c,
+            0x4d, 0x49, 0x53, 0x50, 0x6d, 0x69, 0x63, 0x72,
+            0x6f, 0x73, 0x65, 0x63, 0x74, 0x69, 0x6d, 0x65,
+            0x1f, 0x00, 0x05, 0xff, 0xf1, 0x4b, 0xff, 0x20,
+            0x3c, 0xff, 0x7a, 0x40,
+            0x80
+        };
+        var sei = H264SeiParser.ParseSei(buffer);
+
+        Assert.NotNull(sei);
+        Assert.Single(sei.sei_message);
+        var sei_message = sei.sei_message[0];
+        Assert.Equal((uint)SeiPayloadType.USER_DATA_UNREGISTERED, sei_message.payload_type);
+        Assert.Equal(28u, sei_message.payload_size);
+        Assert.Null(sei_message.GetRecoveryPoint());
+
+        var user_data_unregistered = sei_message.GetUserDataUnregistered();
+        Assert.NotNull(user_data_unregistered);
+        Assert.True(user_data_unregistered.HasUuid(SeiUserDataUnregisteredState.kMispMicrosecTimeUuid));
+        Assert.Equal(12, user_data_unregistered.user_data_payload_byte.Length);
+        Assert.True(user_data_unregistered.TryGetMispTimestamp(out var microseconds));
+        Assert.Equal(0x0005f14b203c7a40ul, microseconds);
+    }
+
+    [Fact]
+    public void TestSampleRecoveryPointAndUserData()
+    {
+        // SEI, recovery_point() followed by a user_data_unregistered() of
+        // another UUID
+        byte[] buffer =
+        {
+            0x06, 0x01, 0xc4,
+            0x05, 0x12,
+            0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+            0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+            0x41, 0x42,
+            0x80
+        };
+        var sei = H264SeiParser.ParseSei(buffer);
+
+        Assert.NotNull(sei);
+        Assert.Equal(2, sei.sei_message.Count);
+
+        var recovery_point = sei.GetMessage(SeiPayloadType.RECOVERY_POINT)?.GetRecoveryPoint();
+        Assert.NotNull(recovery_point);
+        Assert.Equal(0u, recovery_point.recovery_frame_cnt);
+        Assert.Equal(1u, recovery_point.exact_match_flag);
+        Assert.Equal(0u, recovery_point.broken_link_flag);
+        Assert.Equal(0u, recovery_point.changing_slice_group_idc);
+
+        var user_data_unregistered = sei.GetMessage(SeiPayloadType.USER_DATA_UNREGISTERED)?.GetUserDataUnregistered();
+        Assert.NotNull(user_data_unregistered);
+        Assert.False(user_data_unregistered.TryGetMispTimestamp(out _));
+        Assert.Equal(new byte[] { 0x41, 0x42 }, user_data_unregistered.user_data_payload_byte.ToArray());
+    }
+
+    [Fact]
+    public void TestPayloadSizeBeyondNalu()
+    {
+        byte[] buffer = { 0x05, 0x20, 0x00, 0x01, 0x80 };
+        Assert.Null(H264SeiParser.ParseSei(buffer));
+    }
+
+    [Fact]
+    public void TestPicTiming()
+    {
+        var sps_data = new SpsDataState();
+        sps_data.vui_parameters_present_flag = 1;
+        sps_data.vui_parameters = new VuiParametersState
+        {
+            nal_hrd_parameters_present_flag = 1,
+            nal_hrd_parameters = new HrdParametersState
+            {
+                cpb_removal_delay_length_minus1 = 23,
+                dpb_output_delay_length_minus1 = 15,
+                time_offset_length = 8,
+            },
+            pic_struct_present_flag = 1,
+        };
+
+        var payload = new byte[16];
+        var bit_buffer_writer = new BitBufferWriter(payload);
+        Assert.True(bit_buffer_writer.WriteBits(2, 24));  // cpb_removal_delay
+        Assert.True(bit_buffer_writer.WriteBits(4, 16));  // dpb_output_delay
+        Assert.True(bit_buffer_writer.WriteBits(0, 4));  // pic_struct
+        Assert.True(bit_buffer_writer.WriteBits(1, 1));  // clock_timestamp_flag
+        Assert.True(bit_buffer_writer.WriteBits(0, 2));  // ct_type
+        Assert.True(bit_buffer_writer.WriteBits(0, 1));  // nuit_field_based_flag
+        Assert.True(bit_buffer_writer.WriteBits(0, 5));  // counting_type
+        Assert.True(bit_buffer_writer.WriteBits(1, 1));  // full_timestamp_flag
+        Assert.True(bit_buffer_writer.WriteBits(0, 1));  // discontinuity_flag
+        Assert.True(bit_buffer_writer.WriteBits(0, 1));  // cnt_dropped_flag
+        Assert.True(bit_buffer_writer.WriteBits(5, 8));  // n_frames
+        Assert.True(bit_buffer_writer.WriteBits(30, 6));  // seconds_value
+        Assert.True(bit_buffer_writer.WriteBits(15, 6));  // minutes_value
+        Assert.True(bit_buffer_writer.WriteBits(10, 5));  // hours_value
+        Assert.True(bit_buffer_writer.WriteBits(0xfe, 8));  // time_offset
+        Assert.True(H264Common.rbsp_trailing_bits(bit_buffer_writer));
+        int payload_size = bit_buffer_writer.WrittenByteCount();
+
+        var buffer = new List<byte> { 0x01, (byte)payload_size };
+        buffer.AddRange(payload.Take(payload_size));
+        buffer.Add(0x80);
+        var sei = H264SeiParser.ParseSei(buffer.ToArray());
+        Assert.NotNull(sei);
+
+        var pic_timing = sei.sei_message[0].GetPicTiming(sps_data);
+        Assert.NotNull(pic_timing);
+        Assert.Equal(2u, pic_timing.cpb_removal_delay);
+        Assert.Equal(4u, pic_timing.dpb_output_delay);
+        Assert.Equal(0u, pic_timing.pic_struct);
+        Assert.Equal(new uint[] { 1 }, pic_timing.clock_timestamp_flag);
+        Assert.Equal(new uint[] { 5 }, pic_timing.n_frames);
+        Assert.Equal(new uint[] { 30 }, pic_timing.seconds_value);
+        Assert.Equal(new uint[] { 15 }, pic_timing.minutes_value);
+        Assert.Equal(new uint[] { 10 }, pic_timing.hours_value);
+        Assert.Equal(new int[] { -2 }, pic_timing.time_offset);
+    }
+
+    [Fact]
+    public void TestSeiNalUnit()
+    {
+        // SEI NALU with a recovery_point()
+        byte[] buffer = { 0x06, 0x06, 0x01, 0xc4, 0x80 };
+        var nal_unit = H264NalUnitParser.ParseNalUnit(buffer, new H264BitstreamParserState(), new ParsingOptions());
+
+        Assert.NotNull(nal_unit);
+        Assert.NotNull(nal_unit.nal_unit_payload.sei);
+        Assert.Equal((uint)SeiPayloadType.RECOVERY_POINT, nal_unit.nal_unit_payload.sei.sei_message[0].payload_type);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+﻿using SharpVideo.H264;
+
+namespace SharpVideo.Tests;
+
+public class H264SpsSerializerTest
+{
+    // SPS (601.264), without the trailing zero byte
+    private static readonly byte[] Sps601 =
+    {
+        0x42, 0xc0, 0x16, 0xa6, 0x11, 0x05, 0x07, 0xe9,
+        0xb2, 0x00, 0x00, 0x03, 0x00, 0x02, 0x00, 0x00,
+        0x03, 0x00, 0x64, 0x1e, 0x2c, 0x5c, 0x23
+    };
+
+    // SPS (2012 source)
+    private static readonly byte[] Sps2012 =
+    {
+        0x64, 0x00, 0x33, 0xac, 0x72, 0x84, 0x40, 0x78,
+        0x02, 0x27, 0xe5, 0xc0, 0x44, 0x00, 0x00, 0x03,
+        0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xf0, 0x3c,
+        0x60, 0xc6, 0x11, 0x80
+    };
+
+    [Fact]
+    public void TestWriteExponentialGolomb()
+    {
+        var buffer = new byte[64];
+        var bit_buffer_writer = new BitBufferWriter(buffer);
+        UInt32[] values = { 0, 1, 2, 3, 7, 8, 255, 65535, 1u << 20 };
+        Int32[] signed_values = { 0, 1, -1, 2, -2, 127, -128, -8 };
+        foreach (var value in values)
+        {
+            Assert.True(bit_buffer_writer.WriteExponentialGolomb(value));
+        }
+        foreach (var value in signed_values)
+        {
+            Assert.True(bit_buffer_writer.WriteSignedExponentialGolomb(value));
+        }
+        Assert.True(bit_buffer_writer.WriteBits(0x5, 3));
+
+        var bit_buffer = new BitBuffer(buffer);
+        foreach (var value in values)
+        {
+            Assert.True(bit_buffer.ReadExponentialGolomb(out UInt32 read_value));
+            Assert.Equal(value, read_value);
+        }
+        foreach (var value in signed_values)
+        {
+            Assert.True(bit_buffer.ReadSignedExponentialGolomb(out Int32 read_value));
+            Assert.Equal(value, read_value);
+        }
+        Assert.True(bit_buffer.ReadBits(3, out UInt32 bits));
+        Assert.Equal(0x5u, bits);
+    }
+
+    [Fact]
+    public void TestWriteBeyondCapacity()
+    {
+        var bit_buffer_writer = new BitBufferWriter(new byte[2]);
+        Assert.True(bit_buffer_writer.WriteBits(0x3ff, 10));
+        Assert.False(bit_buffer_writer.WriteBits(0x7f, 7));
+        Assert.True(bit_buffer_writer.WriteBits(0x3f, 6));
+        Assert.Equal(2, bit_buffer_writer.WrittenByteCount());
+    }
+
+    [Fact]
+    public void TestEscapeRbsp()
+    {
+        byte[] rbsp = { 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x03 };
+        var escaped = H264Common.EscapeRbsp(rbsp);
+
+        Assert.Equal(new byte[]
+        {
+            0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x04, 0x00, 0x00, 0x03, 0x03
+        }, escaped);
+        Assert.Equal(rbsp, H264Common.UnescapeRbsp(escaped).ToArray());
+    }
+
+    [Fact]
+    public void TestRoundTripSampleSPS601()
+    {
+        var sps = H264SpsParser.ParseSps(Sps601);
+        Assert.NotNull(sps);
+
+        Assert.Equal(Sps601, H264SpsSerializer.SerializeSps(sps));
+    }
+
+    [Fact]
+    public void TestRoundTripSampleSPS2012()
+    {
+        var sps = H264SpsParser.ParseSps(Sps2012);
+        Assert.NotNull(sps);
+
+        Assert.Equal(Sps2012, H264SpsSerializer.SerializeSps(sps));
+    }
+
+    [Fact]
+    public void TestRoundTripScalingMatrix()
+    {
+        var sps = H264SpsParser.ParseSps(Sps2012);
+        Assert.NotNull(sps);
+
+        // list 0 explicit, list 1 default, list 6 ends in a repeated value
+        var sps_data = sps.sps_data;
+        sps_data.seq_scaling_matrix_present_flag = 1;
+        sps_data.seq_scaling_list_present_flag.AddRange(new UInt32[] { 1, 1, 0, 0, 0, 0, 1, 0 });
+        for (UInt32 j = 0; j < 16; j++)
+        {
+            sps_data.ScalingList4x4.Add(6 + j * 3);
+        }
+        sps_data.UseDefaultScalingMatrix4x4Flag.Add(0);
+        sps_data.ScalingList4x4.AddRange(Enumerable.Repeat(8u, 16));
+        sps_data.UseDefaultScalingMatrix4x4Flag.Add(1);
+        for (UInt32 j = 0; j < 64; j++)
+        {
+            sps_data.ScalingList8x8.Add(Math.Min(200u, 10 + j * 7));
+        }
+        sps_data.UseDefaultScalingMatrix8x8Flag.Add(0);
+
+        var payload = H264SpsSerializer.SerializeSps(sps);
+        Assert.NotNull(payload);
+
+        var parsed = H264SpsParser.ParseSps(payload);
+        Assert.NotNull(parsed);
+        var parsed_data = parsed.sps_data;
+        Assert.Equal(sps_data.seq_scaling_list_present_flag, parsed_data.seq_scaling_list_present_flag);
+        Assert.Equal(sps_data.ScalingList4x4, parsed_data.ScalingList4x4);
+        Assert.Equal(sps_data.UseDefaultScalingMatrix4x4Flag, parsed_data.UseDefaultScalingMatrix4x4Flag);
+        Assert.Equal(sps_data.ScalingList8x8, parsed_data.ScalingList8x8);
+        Assert.Equal(sps_data.UseDefaultScalingMatrix8x8Flag, parsed_data.UseDefaultScalingMatrix8x8Flag);
+        Assert.Equal(sps_data.pic_width_in_mbs_minus1, parsed_data.pic_width_in_mbs_minus1);
+        Assert.Equal(sps_data.vui_parameters.time_scale, parsed_data.vui_parameters.time_scale);
+    }
+
+    [Fact]
+    public void TestRewriteConfiguredReorderFrames()
+    {
+        var rewriter = new H264SpsRewriter(0);
+        var nal_unit = NalUnit(0x67, Sps2012);
+
+        Assert.True(rewriter.TryRewrite(nal_unit, out var rewritten));
+        Assert.Equal(0x67, rewritten[0]);
+
+        var sps = H264SpsParser.ParseSps(rewritten.AsSpan(1));
+        Assert.NotNull(sps);
+        var vui_parameters = sps.sps_data.vui_parameters;
+        Assert.Equal(1u, vui_parameters.bitstream_restriction_flag);
+        Assert.Equal(0u, vui_parameters.max_num_reorder_frames);
+        Assert.True(vui_parameters.max_dec_frame_buffering >= sps.sps_data.max_num_ref_frames);
+        Assert.Equal(60u, vui_parameters.time_scale);
+
+        // The rewritten SPS already signals the value
+        Assert.False(rewriter.TryRewrite(rewritten, out _));
+        Assert.Equal(1, rewriter.RewrittenCount);
+    }
+
+    [Fact]
+    public void TestRewriteInfersReorderFrames()
+    {
+        var rewriter = new H264SpsRewriter();
+        var nal_unit = NalUnit(0x67, Sps2012);
+
+        // High profile, nothing known about the slices yet
+        Assert.False(rewriter.TryRewrite(nal_unit, out _));
+
+        rewriter.ObserveNalUnit(Slice(0x65, 7));
+        rewriter.ObserveNalUnit(Slice(0x41, 5));
+        rewriter.ObserveNalUnit(Slice(0x41, 0));
+        Assert.False(rewriter.TryRewrite(nal_unit, out _));
+
+        // A whole IDR period without B slices
+        rewriter.ObserveNalUnit(Slice(0x65, 7));
+        Assert.True(rewriter.TryRewrite(nal_unit, out var rewritten));
+        Assert.Equal(0u, H264SpsParser.ParseSps(rewritten.AsSpan(1))!.sps_data.vui_parameters.max_num_reorder_frames);
+
+        rewriter.ObserveNalUnit(Slice(0x01, 6));
+        Assert.False(rewriter.IsActive);
+        Assert.False(rewriter.TryRewrite(nal_unit, out _));
+    }
+
+    private static byte[] NalUnit(byte header, byte[] payload)
+    {
+        var nal_unit = new byte[payload.Length + 1];
+        nal_unit[0] = header;
+        payload.CopyTo(nal_unit, 1);
+        return nal_unit;
+    }
+
+    private static byte[] Slice(byte header, UInt32 slice_type)
+    {
+        var buffer = new byte[8];
+        buffer[0] = header;
+        var bit_buffer_writer = new BitBufferWriter(buffer.AsMemory(1));
+        // first_mb_in_slice  ue(v)
+        Assert.True(bit_buffer_writer.WriteExponentialGolomb(0));
+        // slice_type  ue(v)
+        Assert.True(bit_buffer_writer.WriteExponentialGolomb(slice_type));
+        // pic_parameter_set_id  ue(v)
+        Assert.True(bit_buffer_writer.WriteExponentialGolomb(0));
+        Assert.True(bit_buffer_writer.WriteBits(0xff, 8));
+        return buffer;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+using System.Drawing;
+using SharpVideo.Drm;
+using SharpVideo.Utils;
+
+namespace SharpVideo.Tests;
+
+public class Nv12ScalerTest
+{
+    private const byte Sentinel = 0xA5;
+
+    [Theory]
+    [InlineData(false)]
+    [InlineData(true)]
+    public void TestBoxMatchesReference(bool cropped)
+    {
+        // Rows of 150 bytes are summed in a Vector256 block, a Vector128 block and a scalar tail
+        var source = new Nv12Frame(203, 97, 224, 5);
+        var area = cropped ? new Rectangle(10, 6, 150, 80) : new Rectangle(0, 0, 203, 97);
+        var destination = new Nv12Frame(37, 21, 40, 3, Sentinel);
+
+        Nv12Scaler.Scale(source.Data, source.Params, destination.Data, destination.Params, ScaleFilter.Box,
+            cropped ? area : null);
+
+        AssertPlaneMatchesBox(
+            source.Data.AsSpan(area.Y * source.Stride + area.X), source.Stride, area.Width, area.Height, 1,
+            destination.Data, destination.Stride, destination.Width, destination.Height);
+        AssertPlaneMatchesBox(
+            source.Data.AsSpan(source.ChromaOffset + area.Y / 2 * source.Stride + area.X), source.Stride,
+            (area.Width + 1) / 2, (area.Height + 1) / 2, 2,
+            destination.Data.AsSpan(destination.ChromaOffset), destination.Stride,
+            (destination.Width + 1) / 2, (destination.Height + 1) / 2);
+        AssertPaddingUntouched(destination);
+    }
+
+    [Theory]
+    [InlineData(ScaleFilter.Box)]
+    [InlineData(ScaleFilter.Bilinear)]
+    public void TestConstantFrameStaysConstant(ScaleFilter filter)
+    {
+        var source = new Nv12Frame(203, 97, 224, 5);
+        source.Fill(77, 140, 90);
+        var destination = new Nv12Frame(41, 30, 48, 0, Sentinel);
+
+        Nv12Scaler.Scale(source.Data, source.Params, destination.Data, destination.Params, filter);
+
+        for (int y = 0; y < destination.Height; y++)
+        {
+            Assert.True(destination.Data.AsSpan(y * destination.Stride, destination.Width).IndexOfAnyExcept((byte)77) < 0);
+        }
+
+        for (int y = 0; y < (destination.Height + 1) / 2; y++)
+        {
+            var chroma = destination.Data.AsSpan(destination.ChromaOffset + y * destination.Stride, (destination.Width + 1) & ~1);
+            for (int x = 0; x < chroma.Length; x += 2)
+            {
+                Assert.Equal(140, chroma[x]);
+                Assert.Equal(90, chroma[x + 1]);
+            }
+        }
+
+        AssertPaddingUntouched(destination);
+    }
+
+    [Fact]
+    public void TestBilinearHalvingAveragesPixelPairs()
+    {
+        // At exactly half size every destination pixel lies in the middle of a 2x2 block
+        var source = new Nv12Frame(96, 64, 96, 0);
+        var bilinear = new Nv12Frame(48, 32, 48, 0);
+        var box = new Nv12Frame(48, 32, 48, 0);
+
+        Nv12Scaler.Scale(source.Data, source.Params, bilinear.Data, bilinear.Params, ScaleFilter.Bilinear);
+        Nv12Scaler.Scale(source.Data, source.Params, box.Data, box.Params, ScaleFilter.Box);
+
+        for (int i = 0; i < box.Data.Length; i++)
+        {
+            Assert.InRange(bilinear.Data[i], box.Data[i] - 1, box.Data[i] + 1);
+        }
+    }
+
+    [Theory]
+    [InlineData(ScaleFilter.Box)]
+    [InlineData(ScaleFilter.Bilinear)]
+    public void TestCropMatchesCroppedCopy(ScaleFilter filter)
+    {
+        var source = new Nv12Frame(203, 97, 224, 5);
+        var area = new Rectangle(24, 10, 121, 63);
+        var copy = new Nv12Frame(area.Width, area.Height, 128, 0);
+        for (int y = 0; y < area.Height; y++)
+        {
+            source.Data.AsSpan((area.Y + y) * source.Stride + area.X, area.Width).CopyTo(copy.Data.AsSpan(y * copy.Stride));
+        }
+
+        for (int y = 0; y < (area.Height + 1) / 2; y++)
+        {
+            source.Data.AsSpan(source.ChromaOffset + (area.Y / 2 + y) * source.Stride + area.X, area.Width + 1)
+                .CopyTo(copy.Data.AsSpan(copy.ChromaOffset + y * copy.Stride));
+        }
+
+        var fromCrop = new Nv12Frame(30, 17, 32, 0);
+        var fromCopy = new Nv12Frame(30, 17, 32, 0);
+        Nv12Scaler.Scale(source.Data, source.Params, fromCrop.Data, fromCrop.Params, filter, area);
+        Nv12Scaler.Scale(copy.Data, copy.Params, fromCopy.Data, fromCopy.Params, filter);
+
+        Assert.Equal(fromCopy.Data, fromCrop.Data);
+    }
+
+    [Fact]
+    public void TestPlanarRgbOfConstantFrame()
+    {
+        var source = new Nv12Frame(64, 48, 64, 0);
+        source.Fill(120, 100, 170);
+        var pixel = new Nv12Frame(2, 2, 2, 0);
+        pixel.Fill(120, 100, 170);
+        var bgrx = new byte[16];
+        YuvToRgbConverter.Convert(pixel.Data, pixel.Params, KnownPixelFormats.DRM_FORMAT_NV12, bgrx, 8,
+            KnownPixelFormats.DRM_FORMAT_XRGB8888);
+
+        var planes = new byte[3 * 21 * 13];
+        Nv12Scaler.ScaleToPlanarRgb(source.Data, source.Params, planes, 21, 13);
+
+        int planeSize = 21 * 13;
+        Assert.True(planes.AsSpan(0, planeSize).IndexOfAnyExcept(bgrx[2]) < 0);
+        Assert.True(planes.AsSpan(planeSize, planeSize).IndexOfAnyExcept(bgrx[1]) < 0);
+        Assert.True(planes.AsSpan(2 * planeSize, planeSize).IndexOfAnyExcept(bgrx[0]) < 0);
+    }
+
+    [Fact]
+    public void TestRejectsBoxFactorAboveMaximum()
+    {
+        int limit = 2 * Nv12Scaler.MaxBoxFactor;
+        var source = new Nv12Frame(limit + 2, 2, limit + 2, 0);
+        var destination = new Nv12Frame(2, 2, 2, 0);
+
+        Assert.Throws<ArgumentOutOfRangeException>(() =>
+            Nv12Scaler.Scale(source.Data, source.Params, destination.Data, destination.Params, ScaleFilter.Box));
+
+        // Bilinear only reads two rows, it has no limit; the box filter is fine up to the factor
+        Nv12Scaler.Scale(source.Data, source.Params, destination.Data, destination.Params, ScaleFilter.Bilinear);
+        Nv12Scaler.Scale(source.Data, source.Params, destination.Data, destination.Params, ScaleFilter.Box,
+            new Rectangle(0, 0, limit, 2));
+    }
+
+    [Fact]
+    public void TestRejectsInvalidCrop()
+    {
+        var source = new Nv12Frame(64, 48, 64, 0);
+        var destination = new Nv12Frame(16, 16, 16, 0);
+
+        Assert.Throws<ArgumentOutOfRangeException>(() => Nv12Scaler.Scale(source.Data, source.Params,
+            destination.Data, destination.Params, crop: new Rectangle(1, 0, 32, 32)));
+        Assert.Throws<ArgumentOutOfRangeException>(() => Nv12Scaler.Scale(source.Data, source.Params,
+            destination.Data, destination.Params, crop: new Rectangle(40, 0, 32, 32)));
+        Assert.Throws<ArgumentOutOfRangeException>(() => Nv12Scaler.Scale(source.Data, source.Params,
+            destination.Data, destination.Params, crop: new Rectangle(0, 0, 0, 32)));
+    }
+
+    /// <summary>
+    /// Checks every destination sample against the rounded mean of the source samples it covers, the same spans the
+    /// scaler uses: source pixels [x * sourceWidth / width, (x + 1) * sourceWidth / width), at least one.
+    /// </summary>
+    private static void AssertPlaneMatchesBox(ReadOnlySpan<byte> source, int sourceStride, int sourceWidth,
+        int sourceHeight, int channels, ReadOnlySpan<byte> destination, int destinationStride, int width, int height)
+    {
+        for (int y = 0; y < height; y++)
+        {
+            GetSpan(y, sourceHeight, height, out int firstRow, out int rowCount);
+            for (int x = 0; x < width; x++)
+            {
+                GetSpan(x, sourceWidth, width, out int firstColumn, out int columnCount);
+                for (int channel = 0; channel < channels; channel++)
+                {
+                    double sum = 0;
+                    for (int row = firstRow; row < firstRow + rowCount; row++)
+                    {
+                        for (int column = firstColumn; column < firstColumn + columnCount; column++)
+                        {
+                            sum += source[row * sourceStride + column * channels + channel];
+                        }
+                    }
+
+                    int expected = (int)Math.Round(sum / (rowCount * columnCount));
+                    Assert.InRange(destination[y * destinationStride + x * channels + channel], expected - 1, expected + 1);
+                }
+            }
+        }
+    }
+
+    private static void GetSpan(int index, int sourceSize, int size, out int first, out int count)
+    {
+        first = Math.Min(index * sourceSize / size, sourceSize - 1);
+        count = Math.Max((index + 1) * sourceSize / size - first, 1);
+    }
+
+    private static void AssertPaddingUntouched(Nv12Frame frame)
+    {
+        int pairedWidth = (frame.Width + 1) & ~1;
+        for (int y = 0; y < frame.Height; y++)
+        {
+            Assert.True(frame.Data.AsSpan(y * frame.Stride + frame.Width, frame.Stride - frame.Width).IndexOfAnyExcept(Sentinel) < 0);
+        }
+
+        for (int y = 0; y < (frame.Height + 1) / 2; y++)
+        {
+            int rowStart = frame.ChromaOffset + y * frame.Stride;
+            Assert.True(frame.Data.AsSpan(rowStart + pairedWidth, frame.Stride - pairedWidth).IndexOfAnyExcept(Sentinel) < 0);
+        }
+    }
+
+    /// <summary>
+    /// An NV12 frame with a padded stride and a gap of some rows before the chroma plane, filled with pseudo random
+    /// samples or a fill value.
+    /// </summary>
+    private sealed class Nv12Frame
+    {
+        public Nv12Frame(int width, int height, int stride, int gapRows, byte? fill = null)
+        {
+            Width = width;
+            Height = height;
+            Stride = stride;
+            ChromaOffset = (height + gapRows) * stride;
+            Data = new byte[ChromaOffset + (height + 1) / 2 * stride];
+            if (fill.HasValue)
+            {
+                Array.Fill(Data, fill.Value);
+            }
+            else
+            {
+                new Random(width * 1000 + height).NextBytes(Data);
+            }
+
+            Params = new BufferParams
+            {
+                Width = (uint)width,
+                Height = (uint)height,
+                FullSize = (ulong)Data.Length,
+                PlanesCount = 2,
+                PlaneOffsets = [0, (ulong)ChromaOffset],
+                Stride = (uint)stride
+            };
+        }
+
+        public int Width { get; }
+        public int Height { get; }
+        public int Stride { get; }
+        public int ChromaOffset { get; }
+        public byte[] Data { get; }
+        public BufferParams Params { get; }
+
+        public void Fill(byte y, byte u, byte v)
+        {
+            Data.AsSpan(0, ChromaOffset).Fill(y);
+            for (int i = ChromaOffset; i < Data.Length; i += 2)
+            {
+                Data[i] = u;
+                Data[i + 1] = v;
+            }
+        }
+    }
+}
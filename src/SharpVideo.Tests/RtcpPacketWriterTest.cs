@@ -0,0 +1,171 @@
+using SharpVideo.RtpPlayerDemo.Rtp;
+
+namespace SharpVideo.Tests;
+
+public class RtcpPacketWriterTest
+{
+    private const uint SenderSsrc = 0x11223344;
+    private const uint MediaSsrc = 0xAABBCCDD;
+
+    private readonly byte[] _buffer = new byte[1500];
+
+    [Fact]
+    public void TestNackCoversSixteenPacketGapWithOneItem()
+    {
+        int length = RtcpPacketWriter.WriteGenericNack(_buffer, SenderSsrc, MediaSsrc, 1000, 16);
+
+        // PID 1000, BLP bits 0..14 for 1001..1015
+        Assert.Equal(new byte[]
+        {
+            0x81, 205, 0x00, 0x03,
+            0x11, 0x22, 0x33, 0x44,
+            0xAA, 0xBB, 0xCC, 0xDD,
+            0x03, 0xE8, 0x7F, 0xFF
+        }, _buffer.AsSpan(0, length).ToArray());
+    }
+
+    [Fact]
+    public void TestNackSplitsLongerGapsIntoItems()
+    {
+        int length = RtcpPacketWriter.WriteGenericNack(_buffer, SenderSsrc, MediaSsrc, 65530, 19);
+
+        // 65530 with all 16 following, then 65530 + 17 (wrapped) with the one after it
+        Assert.Equal(20, length);
+        Assert.Equal(0x04, _buffer[3]);
+        Assert.Equal(new byte[] { 0xFF, 0xFA, 0xFF, 0xFF, 0x00, 0x0B, 0x00, 0x01 }, _buffer.AsSpan(12, 8).ToArray());
+    }
+
+    [Fact]
+    public void TestNackForSinglePacketHasEmptyBitmask()
+    {
+        int length = RtcpPacketWriter.WriteGenericNack(_buffer, SenderSsrc, MediaSsrc, 7, 1);
+
+        Assert.Equal(16, length);
+        Assert.Equal(new byte[] { 0x00, 0x07, 0x00, 0x00 }, _buffer.AsSpan(12, 4).ToArray());
+    }
+
+    [Fact]
+    public void TestNackIsTruncatedToMaxItems()
+    {
+        int length = RtcpPacketWriter.WriteGenericNack(_buffer, SenderSsrc, MediaSsrc, 0, 10_000);
+
+        Assert.Equal(12 + RtcpPacketWriter.MAX_NACK_ITEMS * 4, length);
+    }
+
+    [Fact]
+    public void TestPictureLossIndication()
+    {
+        int length = RtcpPacketWriter.WritePictureLossIndication(_buffer, SenderSsrc, MediaSsrc);
+
+        Assert.Equal(new byte[]
+        {
+            0x81, 206, 0x00, 0x02,
+            0x11, 0x22, 0x33, 0x44,
+            0xAA, 0xBB, 0xCC, 0xDD
+        }, _buffer.AsSpan(0, length).ToArray());
+    }
+
+    [Fact]
+    public void TestFullIntraRequest()
+    {
+        int length = RtcpPacketWriter.WriteFullIntraRequest(_buffer, SenderSsrc, MediaSsrc, 9);
+
+        // The media source field is zero, the target and the command sequence number are in the FCI
+        Assert.Equal(new byte[]
+        {
+            0x84, 206, 0x00, 0x04,
+            0x11, 0x22, 0x33, 0x44,
+            0x00, 0x00, 0x00, 0x00,
+            0xAA, 0xBB, 0xCC, 0xDD,
+            0x09, 0x00, 0x00, 0x00
+        }, _buffer.AsSpan(0, length).ToArray());
+    }
+
+    [Fact]
+    public void TestEmptyReceiverReport()
+    {
+        int length = RtcpPacketWriter.WriteReceiverReport(_buffer, SenderSsrc, null, 0, 0);
+
+        Assert.Equal(new byte[] { 0x80, 201, 0x00, 0x01, 0x11, 0x22, 0x33, 0x44 }, _buffer.AsSpan(0, length).ToArray());
+    }
+
+    [Fact]
+    public void TestReceiverReportBlock()
+    {
+        var statistics = new RtpReceptionStatistics(90000) { Ssrc = MediaSsrc };
+        for (long sequenceNumber = 100; sequenceNumber < 110; sequenceNumber++)
+        {
+            if (sequenceNumber != 105)
+            {
+                statistics.OnPacketReceived(sequenceNumber, 3000, 1_000_000_000);
+            }
+        }
+
+        int length = RtcpPacketWriter.WriteReceiverReport(_buffer, SenderSsrc, statistics, 0x01020304, 0x00050006);
+
+        // One of ten lost: fraction 25/256, cumulative 1, highest 109, no jitter for equal transit times
+        Assert.Equal(new byte[]
+        {
+            0x81, 201, 0x00, 0x07,
+            0x11, 0x22, 0x33, 0x44,
+            0xAA, 0xBB, 0xCC, 0xDD,
+            0x19, 0x00, 0x00, 0x01,
+            0x00, 0x00, 0x00, 0x6D,
+            0x00, 0x00, 0x00, 0x00,
+            0x01, 0x02, 0x03, 0x04,
+            0x00, 0x05, 0x00, 0x06
+        }, _buffer.AsSpan(0, length).ToArray());
+    }
+
+    [Fact]
+    public void TestReceiverReportEncodesNegativeLoss()
+    {
+        // Duplicates make the received count exceed the expected one
+        var statistics = new RtpReceptionStatistics(90000) { Ssrc = MediaSsrc };
+        statistics.OnPacketReceived(100, 0, 0);
+        statistics.OnPacketReceived(101, 0, 0);
+        statistics.OnPacketReceived(101, 0, 0);
+
+        RtcpPacketWriter.WriteReceiverReport(_buffer, SenderSsrc, statistics, 0, 0);
+
+        Assert.Equal(new byte[] { 0x00, 0xFF, 0xFF, 0xFF }, _buffer.AsSpan(12, 4).ToArray());
+    }
+
+    [Fact]
+    public void TestSdesCnameIsPaddedToWords()
+    {
+        int length = RtcpPacketWriter.WriteSdesCname(_buffer, SenderSsrc, "ab");
+
+        Assert.Equal(new byte[]
+        {
+            0x81, 202, 0x00, 0x03,
+            0x11, 0x22, 0x33, 0x44,
+            0x01, 0x02, (byte)'a', (byte)'b',
+            0x00, 0x00, 0x00, 0x00
+        }, _buffer.AsSpan(0, length).ToArray());
+    }
+
+    [Fact]
+    public void TestSenderReportIsFoundInCompoundPacket()
+    {
+        // SDES first, then the sender report
+        int length = RtcpPacketWriter.WriteSdesCname(_buffer, MediaSsrc, "cam");
+        var senderReport = new byte[]
+        {
+            0x80, 200, 0x00, 0x06,
+            0xAA, 0xBB, 0xCC, 0xDD,
+            0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+            0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00
+        };
+        senderReport.CopyTo(_buffer, length);
+        var packet = _buffer.AsSpan(0, length + senderReport.Length);
+
+        Assert.True(RtcpPacketWriter.IsRtcp(packet));
+        Assert.True(RtcpPacketWriter.TryReadSenderReport(packet, MediaSsrc, out var ssrc, out var ntpTimestamp));
+        Assert.Equal(MediaSsrc, ssrc);
+        Assert.Equal(0x0102030405060708ul, ntpTimestamp);
+        Assert.False(RtcpPacketWriter.TryReadSenderReport(packet, SenderSsrc, out _, out _));
+    }
+}
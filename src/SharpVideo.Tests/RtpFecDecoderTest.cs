@@ -0,0 +1,186 @@
+using System.Buffers.Binary;
+using SharpVideo.RtpPlayerDemo.Rtp;
+
+namespace SharpVideo.Tests;
+
+public class RtpFecDecoderTest
+{
+    private const int MediaPayloadType = 96;
+    private const int UlpfecPayloadType = 116;
+    private const int FlexfecPayloadType = 118;
+    private const uint MediaSsrc = 0x01020304;
+    private const ushort FirstSequenceNumber = 65534;
+
+    private readonly RtpFecDecoder _decoder = new(UlpfecPayloadType, FlexfecPayloadType);
+    private readonly List<(byte[] Packet, ushort SequenceNumber, uint Timestamp)> _recovered = new();
+    private readonly byte[][] _media;
+
+    public RtpFecDecoderTest()
+    {
+        _decoder.OnPacketRecovered += (packet, sequenceNumber, timestamp) =>
+            _recovered.Add((packet.ToArray(), sequenceNumber, timestamp));
+
+        // Four packets of different sizes across the sequence number wrap, the last one with the marker bit
+        _media = new byte[4][];
+        for (int i = 0; i < _media.Length; i++)
+        {
+            var payload = Enumerable.Range(0, 40 + i * 13).Select(b => (byte)(b * 7 + i)).ToArray();
+            _media[i] = CreatePacket(MediaPayloadType, (ushort)(FirstSequenceNumber + i), 3000u * (uint)(i / 2),
+                i == 3, payload);
+        }
+    }
+
+    [Fact]
+    public void TestUlpfecRecoversOneLostPacket()
+    {
+        AddMedia(0, 1, 3);
+        AddRepair(CreateUlpfecPacket());
+
+        Assert.Single(_recovered);
+        Assert.Equal(_media[2], _recovered[0].Packet);
+        Assert.Equal((ushort)0, _recovered[0].SequenceNumber); // 65534 + 2 wrapped
+        Assert.Equal(3000u, _recovered[0].Timestamp);
+        Assert.Equal(1, _decoder.RecoveredPackets);
+        Assert.Equal(0, _decoder.PendingRepairPackets);
+    }
+
+    [Fact]
+    public void TestFlexfecRecoversOneLostPacket()
+    {
+        AddMedia(1, 2, 3);
+        AddRepair(CreateFlexfecPacket());
+
+        Assert.Single(_recovered);
+        Assert.Equal(_media[0], _recovered[0].Packet);
+        Assert.Equal(0, _decoder.UnusableRepairPackets);
+    }
+
+    [Fact]
+    public void TestRepairPacketWaitsForProtectedPackets()
+    {
+        // Two packets missing, nothing to recover yet
+        AddMedia(0, 3);
+        AddRepair(CreateUlpfecPacket());
+        Assert.Empty(_recovered);
+        Assert.Equal(1, _decoder.PendingRepairPackets);
+
+        AddMedia(1);
+        _decoder.Recover();
+
+        Assert.Single(_recovered);
+        Assert.Equal(_media[2], _recovered[0].Packet);
+        Assert.Equal(0, _decoder.PendingRepairPackets);
+    }
+
+    [Fact]
+    public void TestRepairPacketIsDroppedWhenNothingIsMissing()
+    {
+        AddMedia(0, 1, 2, 3);
+        AddRepair(CreateUlpfecPacket());
+
+        Assert.Empty(_recovered);
+        Assert.Equal(0, _decoder.PendingRepairPackets);
+    }
+
+    [Fact]
+    public void TestTruncatedRepairPacketIsUnusable()
+    {
+        AddMedia(0, 1, 3);
+        var repair = CreateUlpfecPacket();
+        AddRepair(repair.AsSpan(0, RTPHeader.MIN_HEADER_LEN + 8).ToArray());
+
+        Assert.Empty(_recovered);
+        Assert.Equal(1, _decoder.UnusableRepairPackets);
+    }
+
+    private void AddMedia(params int[] indices)
+    {
+        foreach (int i in indices)
+        {
+            _decoder.AddMediaPacket(_media[i], (ushort)(FirstSequenceNumber + i));
+        }
+    }
+
+    private void AddRepair(byte[] packet)
+    {
+        Assert.True(_decoder.IsRepairPayloadType(new RTPHeader(packet).PayloadType));
+        _decoder.AddRepairPacket(new RTPHeader(packet), packet);
+    }
+
+    /// <summary>
+    /// ULPFEC level 0 with a short mask over all four media packets (RFC 5109 7.3, 7.4).
+    /// </summary>
+    private byte[] CreateUlpfecPacket()
+    {
+        var (first, second, length, timestamp, payload) = XorMedia();
+        var fec = new byte[10 + 4 + payload.Length];
+        fec[0] = (byte)(first & 0x3F);
+        fec[1] = second;
+        BinaryPrimitives.WriteUInt16BigEndian(fec.AsSpan(2), FirstSequenceNumber);
+        BinaryPrimitives.WriteUInt32BigEndian(fec.AsSpan(4), timestamp);
+        BinaryPrimitives.WriteUInt16BigEndian(fec.AsSpan(8), length);
+        BinaryPrimitives.WriteUInt16BigEndian(fec.AsSpan(10), (ushort)payload.Length);
+        BinaryPrimitives.WriteUInt16BigEndian(fec.AsSpan(12), 0xF000);
+        payload.CopyTo(fec, 14);
+
+        return CreatePacket(UlpfecPayloadType, 100, 0, false, fec);
+    }
+
+    /// <summary>
+    /// FlexFEC with a flexible mask over all four media packets, the protected SSRC in the CSRC list
+    /// (RFC 8627 4.2.2).
+    /// </summary>
+    private byte[] CreateFlexfecPacket()
+    {
+        var (first, second, length, timestamp, payload) = XorMedia();
+        var fec = new byte[12 + payload.Length];
+        fec[0] = (byte)(first & 0x3F);
+        fec[1] = second;
+        BinaryPrimitives.WriteUInt16BigEndian(fec.AsSpan(2), length);
+        BinaryPrimitives.WriteUInt32BigEndian(fec.AsSpan(4), timestamp);
+        BinaryPrimitives.WriteUInt16BigEndian(fec.AsSpan(8), FirstSequenceNumber);
+
+        // k=1 ends the mask after 15 bits, the most significant of them is the SN base
+        BinaryPrimitives.WriteUInt16BigEndian(fec.AsSpan(10), 0x8000 | 0x7800);
+        payload.CopyTo(fec, 12);
+
+        var packet = CreatePacket(FlexfecPayloadType, 200, 0, false, new byte[4].Concat(fec).ToArray());
+        packet[0] |= 1;
+        BinaryPrimitives.WriteUInt32BigEndian(packet.AsSpan(RTPHeader.MIN_HEADER_LEN), MediaSsrc);
+        return packet;
+    }
+
+    private (byte First, byte Second, ushort Length, uint Timestamp, byte[] Payload) XorMedia()
+    {
+        byte first = 0;
+        byte second = 0;
+        ushort length = 0;
+        uint timestamp = 0;
+        var payload = new byte[_media.Max(packet => packet.Length) - RTPHeader.MIN_HEADER_LEN];
+        foreach (var packet in _media)
+        {
+            first ^= packet[0];
+            second ^= packet[1];
+            length ^= (ushort)(packet.Length - RTPHeader.MIN_HEADER_LEN);
+            timestamp ^= BinaryPrimitives.ReadUInt32BigEndian(packet.AsSpan(4));
+            for (int i = RTPHeader.MIN_HEADER_LEN; i < packet.Length; i++)
+            {
+                payload[i - RTPHeader.MIN_HEADER_LEN] ^= packet[i];
+            }
+        }
+
+        return (first, second, length, timestamp, payload);
+    }
+
+    private static byte[] CreatePacket(int payloadType, ushort sequenceNumber, uint timestamp, bool marker, byte[] payload)
+    {
+        var packet = new byte[RTPHeader.MIN_HEADER_LEN + payload.Length];
+        packet[0] = 0x80;
+        packet[1] = (byte)((marker ? 0x80 : 0) | payloadType);
+        BinaryPrimitives.WriteUInt16BigEndian(packet.AsSpan(2), sequenceNumber);
+        BinaryPrimitives.WriteUInt32BigEndian(packet.AsSpan(4), timestamp);
+        BinaryPrimitives.WriteUInt32BigEndian(packet.AsSpan(8), MediaSsrc);
+        payload.CopyTo(packet, RTPHeader.MIN_HEADER_LEN);
+        return packet;
+    }
+}
@@ -0,0 +1,195 @@
+using System.Buffers.Binary;
+using SharpVideo.RtpPlayerDemo.Rtp;
+
+namespace SharpVideo.Tests;
+
+public class RtpJitterBufferTest
+{
+    private const long StartNs = 1_000_000_000_000;
+    private const long MillisecondNs = 1_000_000;
+
+    private static readonly TimeSpan Latency = TimeSpan.FromMilliseconds(100);
+    private static readonly TimeSpan GapTimeout = TimeSpan.FromMilliseconds(20);
+
+    private readonly RtpJitterBuffer _buffer = new(64, Latency, GapTimeout, 90000);
+    private readonly List<ushort> _released = new();
+    private readonly List<int> _lost = new();
+    private readonly List<(ushort First, int Count)> _gaps = new();
+
+    public RtpJitterBufferTest()
+    {
+        _buffer.OnPacketReleased += (packet, _) => _released.Add(BinaryPrimitives.ReadUInt16BigEndian(packet));
+        _buffer.OnPacketsLost += _lost.Add;
+        _buffer.OnGapDetected += (first, count) => _gaps.Add((first, count));
+    }
+
+    [Fact]
+    public void TestInOrderPacketsAreReleasedImmediately()
+    {
+        for (ushort sequenceNumber = 10; sequenceNumber < 20; sequenceNumber++)
+        {
+            Insert(sequenceNumber, StartNs);
+            Assert.Equal(sequenceNumber, _released[^1]);
+        }
+
+        Assert.Equal(0, _buffer.Count);
+        Assert.Equal(10, _buffer.Statistics.PacketsReceived);
+        Assert.Equal(0, _buffer.Statistics.PacketsLost);
+        Assert.Empty(_gaps);
+    }
+
+    [Fact]
+    public void TestReorderedPacketsAreReleasedInOrder()
+    {
+        Insert(100, StartNs);
+        Insert(102, StartNs);
+        Insert(103, StartNs);
+
+        Assert.Equal(new ushort[] { 100 }, _released);
+        Assert.Equal(2, _buffer.Count);
+        Assert.Equal(new[] { ((ushort)101, 1) }, _gaps);
+
+        Insert(101, StartNs + MillisecondNs);
+
+        Assert.Equal(new ushort[] { 100, 101, 102, 103 }, _released);
+        Assert.Equal(0, _buffer.Count);
+        Assert.Empty(_lost);
+        Assert.Equal(1, _buffer.Statistics.PacketsReordered);
+        Assert.Equal(0, _buffer.Statistics.PacketsLost);
+    }
+
+    [Fact]
+    public void TestGapIsSkippedAfterTimeout()
+    {
+        Insert(100, StartNs);
+        Insert(103, StartNs);
+
+        // The gap timeout starts when the hole is first seen
+        _buffer.Poll(StartNs + GapTimeout.Ticks * 100 - 1);
+        Assert.Equal(new ushort[] { 100 }, _released);
+
+        _buffer.Poll(StartNs + GapTimeout.Ticks * 100);
+        Assert.Equal(new ushort[] { 100, 103 }, _released);
+        Assert.Equal(new[] { 2 }, _lost);
+        Assert.Equal(2, _buffer.Statistics.PacketsSkipped);
+        Assert.Equal(2, _buffer.Statistics.PacketsLost);
+    }
+
+    [Fact]
+    public void TestLatencyBudgetSkipsGapWithoutPoll()
+    {
+        var buffer = new RtpJitterBuffer(64, TimeSpan.FromMilliseconds(10), TimeSpan.FromSeconds(1), 90000);
+        var released = new List<ushort>();
+        buffer.OnPacketReleased += (packet, _) => released.Add(BinaryPrimitives.ReadUInt16BigEndian(packet));
+
+        buffer.Insert(CreatePacket(1), 1, 0, StartNs);
+        buffer.Insert(CreatePacket(3), 3, 0, StartNs);
+        buffer.Insert(CreatePacket(4), 4, 0, StartNs + 10 * MillisecondNs);
+
+        // Packet 3 has been held for the latency budget when packet 4 arrives
+        Assert.Equal(new ushort[] { 1, 3, 4 }, released);
+        Assert.Equal(1, buffer.Statistics.PacketsSkipped);
+    }
+
+    [Fact]
+    public void TestLatePacketIsDropped()
+    {
+        Insert(100, StartNs);
+        Insert(102, StartNs);
+        _buffer.Poll(StartNs + GapTimeout.Ticks * 100);
+        Assert.Equal(new ushort[] { 100, 102 }, _released);
+
+        Insert(101, StartNs + 30 * MillisecondNs);
+
+        Assert.Equal(new ushort[] { 100, 102 }, _released);
+        Assert.Equal(1, _buffer.Statistics.PacketsLate);
+
+        // The late packet still counts as received for the loss statistics
+        Assert.Equal(3, _buffer.Statistics.PacketsReceived);
+        Assert.Equal(0, _buffer.Statistics.PacketsLost);
+    }
+
+    [Fact]
+    public void TestDuplicateIsDropped()
+    {
+        Insert(100, StartNs);
+        Insert(102, StartNs);
+        Insert(102, StartNs);
+        Insert(101, StartNs);
+
+        Assert.Equal(new ushort[] { 100, 101, 102 }, _released);
+        Assert.Equal(1, _buffer.Statistics.PacketsDuplicated);
+        Assert.Equal(3, _buffer.Statistics.PacketsReceived);
+    }
+
+    [Fact]
+    public void TestSequenceNumberWrap()
+    {
+        Insert(65534, StartNs);
+        Insert(0, StartNs);
+        Insert(65535, StartNs);
+        Insert(1, StartNs);
+
+        Assert.Equal(new ushort[] { 65534, 65535, 0, 1 }, _released);
+        Assert.Equal(65536 + 1, _buffer.Statistics.HighestSequenceNumber);
+        Assert.Equal(0, _buffer.Statistics.PacketsLost);
+    }
+
+    [Fact]
+    public void TestSingleStrayPacketIsIgnored()
+    {
+        Insert(100, StartNs);
+        Insert(20000, StartNs);
+        Insert(101, StartNs);
+
+        Assert.Equal(new ushort[] { 100, 101 }, _released);
+        Assert.Equal(0, _buffer.Statistics.Resyncs);
+    }
+
+    [Fact]
+    public void TestResyncKeepsCumulativeCounters()
+    {
+        for (ushort sequenceNumber = 100; sequenceNumber < 110; sequenceNumber++)
+        {
+            if (sequenceNumber != 105)
+            {
+                Insert(sequenceNumber, StartNs);
+            }
+        }
+
+        _buffer.Poll(StartNs + GapTimeout.Ticks * 100);
+        Assert.Equal(1, _buffer.Statistics.PacketsLost);
+        Assert.Equal(256 / 10, _buffer.Statistics.GetFractionLostSinceLastCall());
+
+        // The source restarts: the first packet of the new space is probation, the second confirms the jump
+        Insert(40000, StartNs);
+        Insert(40001, StartNs);
+        Insert(40002, StartNs);
+
+        Assert.Equal(1, _buffer.Statistics.Resyncs);
+        Assert.Equal(new ushort[] { 40001, 40002 }, _released.Skip(9));
+        Assert.Equal(11, _buffer.Statistics.PacketsReceived);
+        Assert.Equal(12, _buffer.Statistics.PacketsExpected);
+        Assert.Equal(1, _buffer.Statistics.PacketsLost);
+        Assert.Equal(0, _buffer.Statistics.GetFractionLostSinceLastCall());
+
+        // Extended sequence numbers stay monotonic for the receiver reports
+        Assert.Equal(65536 + 40002, _buffer.Statistics.HighestSequenceNumber);
+
+        Insert(40004, StartNs);
+        _buffer.Poll(StartNs + GapTimeout.Ticks * 100);
+        Assert.Equal(2, _buffer.Statistics.PacketsLost);
+    }
+
+    private void Insert(ushort sequenceNumber, long receivedTimestampNs)
+    {
+        _buffer.Insert(CreatePacket(sequenceNumber), sequenceNumber, sequenceNumber * 3000u, receivedTimestampNs);
+    }
+
+    private static byte[] CreatePacket(ushort sequenceNumber)
+    {
+        var packet = new byte[16];
+        BinaryPrimitives.WriteUInt16BigEndian(packet, sequenceNumber);
+        return packet;
+    }
+}
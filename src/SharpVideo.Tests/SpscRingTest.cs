@@ -0,0 +1,351 @@
+using System.Diagnostics;
+using System.Runtime.Versioning;
+using SharpVideo.Utils;
+
+namespace SharpVideo.Tests;
+
+[SupportedOSPlatform("linux")]
+public class SpscRingTest
+{
+    [Fact]
+    public void TestCapacityIsRoundedUpToPowerOfTwo()
+    {
+        using var ring = new SpscRing<int>(5);
+
+        Assert.Equal(8, ring.Capacity);
+        Assert.Equal(SpscRingFullMode.DropNewest, ring.FullMode);
+        Assert.Throws<ArgumentOutOfRangeException>(() => new SpscRing<int>(0));
+    }
+
+    [Fact]
+    public void TestIndicesWrapAround()
+    {
+        using var ring = new SpscRing<int>(4);
+        int next = 0;
+        int expected = 0;
+
+        // Three items per round move the indices across the end of the slots in ever different places
+        for (int round = 0; round < 10; round++)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                Assert.True(ring.TryPush(next++));
+            }
+
+            Assert.Equal(3, ring.Count);
+            for (int i = 0; i < 3; i++)
+            {
+                Assert.True(ring.TryPop(out var item));
+                Assert.Equal(expected++, item);
+            }
+        }
+
+        Assert.Equal(0, ring.Count);
+        Assert.False(ring.TryPop(out _));
+    }
+
+    [Fact]
+    public void TestDropNewestRejectsPushWhenFull()
+    {
+        using var ring = new SpscRing<int>(4);
+        for (int i = 0; i < 4; i++)
+        {
+            Assert.True(ring.TryPush(i));
+        }
+
+        Assert.False(ring.TryPush(4));
+
+        Assert.Equal(new[] { 0, 1, 2, 3 }, PopAll(ring));
+        Assert.True(ring.TryPush(5));
+    }
+
+    [Fact]
+    public void TestDropOldestEvictsOldestItems()
+    {
+        var dropped = new List<int>();
+        using var ring = new SpscRing<int>(4, SpscRingFullMode.DropOldest, dropped.Add);
+
+        for (int i = 0; i < 6; i++)
+        {
+            Assert.True(ring.TryPush(i));
+        }
+
+        Assert.Equal(new[] { 0, 1 }, dropped);
+        Assert.Equal(4, ring.Count);
+        Assert.Equal(new[] { 2, 3, 4, 5 }, PopAll(ring));
+    }
+
+    [Fact]
+    public void TestDropOldestWithConcurrentConsumer()
+    {
+        // Producer evictions and consumer pops race for the head; every item must be either popped or dropped once
+        const int count = 200_000;
+        var dropped = new List<int>();
+        using var ring = new SpscRing<int>(8, SpscRingFullMode.DropOldest, dropped.Add);
+        var popped = new List<int>();
+
+        var consumer = Task.Run(() =>
+        {
+            while (ring.TryPop(out var item, Timeout.Infinite))
+            {
+                popped.Add(item);
+            }
+        });
+
+        for (int i = 0; i < count; i++)
+        {
+            Assert.True(ring.TryPush(i));
+        }
+
+        ring.Complete();
+        Assert.True(consumer.Wait(TimeSpan.FromSeconds(30)));
+
+        for (int i = 1; i < popped.Count; i++)
+        {
+            Assert.True(popped[i] > popped[i - 1]);
+        }
+
+        Assert.Equal(Enumerable.Range(0, count), popped.Concat(dropped).Order());
+    }
+
+    [Fact]
+    public void TestBatchPushAndPopAcrossTheEnd()
+    {
+        using var ring = new SpscRing<int>(8);
+        Assert.Equal(5, ring.TryPushBatch(new[] { 0, 1, 2, 3, 4 }));
+        Assert.Equal(5, ring.TryPopBatch(new int[5]));
+
+        // The batch starts at slot 5 and wraps to the start of the slots
+        Assert.Equal(8, ring.TryPushBatch(Enumerable.Range(10, 8).ToArray()));
+        Assert.Equal(0, ring.TryPushBatch(new[] { 99 }));
+
+        var items = new int[3];
+        Assert.Equal(3, ring.TryPopBatch(items));
+        Assert.Equal(new[] { 10, 11, 12 }, items);
+
+        items = new int[10];
+        Assert.Equal(5, ring.TryPopBatch(items));
+        Assert.Equal(new[] { 13, 14, 15, 16, 17 }, items.Take(5));
+        Assert.Equal(0, ring.TryPopBatch(items));
+    }
+
+    [Fact]
+    public void TestDropNewestBatchTakesWhatFits()
+    {
+        using var ring = new SpscRing<int>(8);
+        Assert.Equal(6, ring.TryPushBatch(new[] { 0, 1, 2, 3, 4, 5 }));
+
+        Assert.Equal(2, ring.TryPushBatch(new[] { 6, 7, 8, 9 }));
+        Assert.Equal(Enumerable.Range(0, 8), PopAll(ring));
+    }
+
+    [Fact]
+    public void TestDropOldestBatchLargerThanRing()
+    {
+        var dropped = new List<int>();
+        using var ring = new SpscRing<int>(4, SpscRingFullMode.DropOldest, dropped.Add);
+        Assert.True(ring.TryPush(0));
+
+        Assert.Equal(6, ring.TryPushBatch(new[] { 1, 2, 3, 4, 5, 6 }));
+
+        Assert.Equal(new[] { 1, 2, 0 }, dropped);
+        Assert.Equal(new[] { 3, 4, 5, 6 }, PopAll(ring));
+    }
+
+    [Fact]
+    public void TestCompleteStillDeliversQueuedItems()
+    {
+        using var ring = new SpscRing<int>(4);
+        ring.TryPush(1);
+        ring.TryPush(2);
+        ring.TryPush(3);
+
+        ring.Complete();
+
+        Assert.False(ring.TryPush(4));
+        Assert.Equal(0, ring.TryPushBatch(new[] { 4 }));
+        Assert.True(ring.IsAddingCompleted);
+        Assert.False(ring.IsCompleted);
+
+        Assert.True(ring.TryPop(out var item, Timeout.Infinite));
+        Assert.Equal(1, item);
+        var items = new int[4];
+        Assert.Equal(2, ring.TryPopBatch(items, Timeout.Infinite));
+        Assert.Equal(new[] { 2, 3 }, items.Take(2));
+
+        // A drained, completed ring returns at once instead of waiting
+        Assert.False(ring.TryPop(out _, Timeout.Infinite));
+        Assert.Equal(0, ring.TryPopBatch(items, Timeout.Infinite));
+        Assert.True(ring.IsCompleted);
+    }
+
+    [Fact]
+    public void TestCompleteWakesWaitingConsumer()
+    {
+        using var ring = new SpscRing<int>(4);
+        var consumer = Task.Run(() => ring.TryPop(out _, Timeout.Infinite));
+
+        Thread.Sleep(50);
+        Assert.False(consumer.IsCompleted);
+
+        ring.Complete();
+        Assert.True(consumer.Wait(TimeSpan.FromSeconds(5)));
+        Assert.False(consumer.Result);
+    }
+
+    [Fact]
+    public void TestCompleteWakesWaitingProducer()
+    {
+        using var ring = new SpscRing<int>(1);
+        ring.TryPush(0);
+        var producer = Task.Run(() => ring.TryPush(1, Timeout.Infinite));
+
+        Thread.Sleep(50);
+        Assert.False(producer.IsCompleted);
+
+        ring.Complete();
+        Assert.True(producer.Wait(TimeSpan.FromSeconds(5)));
+        Assert.False(producer.Result);
+    }
+
+    [Fact]
+    public void TestWaitsTimeOut()
+    {
+        using var ring = new SpscRing<int>(1);
+
+        var stopwatch = Stopwatch.StartNew();
+        Assert.False(ring.TryPop(out _, 50));
+        Assert.True(stopwatch.ElapsedMilliseconds >= 40);
+
+        Assert.Equal(0, ring.TryPopBatch(new int[4], 50));
+
+        ring.TryPush(0);
+        stopwatch.Restart();
+        Assert.False(ring.TryPush(1, 50));
+        Assert.True(stopwatch.ElapsedMilliseconds >= 40);
+    }
+
+    [Fact]
+    public void TestCancellationEndsWaits()
+    {
+        using var ring = new SpscRing<int>(1);
+
+        using (var cts = new CancellationTokenSource(50))
+        {
+            Assert.False(ring.TryPop(out _, Timeout.Infinite, cts.Token));
+        }
+
+        ring.TryPush(0);
+        using (var cts = new CancellationTokenSource(50))
+        {
+            Assert.False(ring.TryPush(1, Timeout.Infinite, cts.Token));
+        }
+
+        // The ring is still usable after a cancelled wait
+        Assert.True(ring.TryPop(out var item, Timeout.Infinite));
+        Assert.Equal(0, item);
+    }
+
+    [Fact]
+    public void TestBlockingPushWaitsForConsumer()
+    {
+        using var ring = new SpscRing<int>(1);
+        ring.TryPush(0);
+        var consumer = Task.Run(() =>
+        {
+            Thread.Sleep(50);
+            return ring.TryPop(out var item) ? item : -1;
+        });
+
+        Assert.True(ring.TryPush(1, 5000));
+        Assert.Equal(0, consumer.Result);
+        Assert.True(ring.TryPop(out var next));
+        Assert.Equal(1, next);
+    }
+
+    [Fact]
+    public void TestTwoThreadsKeepOrderWithoutLoss()
+    {
+        const int count = 1_000_000;
+        using var ring = new SpscRing<int>(64);
+
+        var producer = Task.Run(() =>
+        {
+            var batch = new int[16];
+            int next = 0;
+            while (next < count)
+            {
+                // Alternate single and batch pushes, both waiting when the ring is full
+                if ((next & 256) == 0)
+                {
+                    Assert.True(ring.TryPush(next++, Timeout.Infinite));
+                    continue;
+                }
+
+                int length = Math.Min(batch.Length, count - next);
+                for (int i = 0; i < length; i++)
+                {
+                    batch[i] = next + i;
+                }
+
+                int pushed = 0;
+                while (pushed < length)
+                {
+                    pushed += ring.TryPushBatch(batch.AsSpan(pushed, length - pushed));
+                    if (pushed < length)
+                    {
+                        Thread.Yield();
+                    }
+                }
+
+                next += length;
+            }
+
+            ring.Complete();
+        });
+
+        int expected = 0;
+        bool inOrder = true;
+        var items = new int[32];
+        while (true)
+        {
+            if ((expected & 1024) == 0)
+            {
+                if (!ring.TryPop(out var item, Timeout.Infinite))
+                {
+                    break;
+                }
+
+                inOrder &= item == expected++;
+                continue;
+            }
+
+            int popped = ring.TryPopBatch(items, Timeout.Infinite);
+            if (popped == 0)
+            {
+                break;
+            }
+
+            for (int i = 0; i < popped; i++)
+            {
+                inOrder &= items[i] == expected++;
+            }
+        }
+
+        producer.Wait();
+        Assert.True(inOrder);
+        Assert.Equal(count, expected);
+        Assert.True(ring.IsCompleted);
+    }
+
+    private static List<int> PopAll(SpscRing<int> ring)
+    {
+        var items = new List<int>();
+        while (ring.TryPop(out var item))
+        {
+            items.Add(item);
+        }
+
+        return items;
+    }
+}
@@ -0,0 +1,204 @@
+using System.Buffers.Binary;
+using System.Security.Cryptography;
+using SharpVideo.Srtp;
+
+namespace SharpVideo.Tests;
+
+public class SrtpCipherTest
+{
+    // RFC 3711 B.3
+    private static readonly byte[] MasterKey = Convert.FromHexString("E1F97A0D3E018BE0D64FA32C06DE4139");
+    private static readonly byte[] MasterSalt = Convert.FromHexString("0EC675AD498AFEEBB6960B3AABE6");
+
+    // RFC 7714 16.1.1
+    private static readonly byte[] GcmKey = Convert.FromHexString("000102030405060708090A0B0C0D0E0F");
+    private static readonly byte[] GcmSalt = Convert.FromHexString("517569642070726F2071756F");
+    private static readonly byte[] GcmPlainPacket = Convert.FromHexString(
+        "8040F17B8041F8D35501A0B2" +
+        "47616C6C696120657374206F6D6E69732064697669736120696E207061727465732074726573");
+    private static readonly byte[] GcmProtectedPacket = Convert.FromHexString(
+        "8040F17B8041F8D35501A0B2" +
+        "F24DE3A3FB34DE6CACBA861C9D7E4BCABE633BD50D294E6F42A5F47A51C7D19B36DE3ADF8833899D" +
+        "7F27BEB16A9152CF765EE4390CCE");
+
+    [Fact]
+    public void TestKeyDerivationRfc3711()
+    {
+        var policy = new SrtpPolicy(SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_80, MasterKey, MasterSalt);
+
+        Assert.Equal(Convert.FromHexString("C61E7A93744F39EE10734AFE3FF7A087"),
+            SrtpCipher.DeriveKey(policy, SrtpCipher.LABEL_RTP_ENCRYPTION, 16));
+        Assert.Equal(Convert.FromHexString("30CBBC08863D8C85D49DB34A9AE1"),
+            SrtpCipher.DeriveKey(policy, SrtpCipher.LABEL_RTP_SALT, 14));
+        Assert.Equal(Convert.FromHexString("CEBE321F6FF7716B6FD4AB49AF256A156D38BAA4"),
+            SrtpCipher.DeriveKey(policy, SrtpCipher.LABEL_RTP_AUTHENTICATION, 20));
+    }
+
+    [Fact]
+    public void TestAesCmKeyStreamRfc3711()
+    {
+        // RFC 3711 B.2: SSRC, ROC and sequence number 0, so the key stream is AES of salt || counter
+        using var cipher = new SrtpCipher(
+            false,
+            10,
+            Convert.FromHexString("2B7E151628AED2A6ABF7158809CF4F3C"),
+            Convert.FromHexString("F0F1F2F3F4F5F6F7F8F9FAFBFCFD"),
+            new byte[20]);
+
+        var keyStream = new byte[0xFF00 * 16];
+        cipher.ApplyKeyStream(keyStream, 0, 0);
+
+        Assert.Equal(
+            Convert.FromHexString(
+                "E03EAD0935C95E80E166B16DD92B4EB4D23513162B02D0F72A43A2FE4A5F97AB41E95B3BB0A2E8DD477901E4FCA894C0"),
+            keyStream[..48]);
+        Assert.Equal(Convert.FromHexString("EC8CDF7398607CB0F2D21675EA9EA1E4"), keyStream[(0xFEFF * 16)..]);
+    }
+
+    [Fact]
+    public void TestAesGcmProtectRtpRfc7714()
+    {
+        using var cipher = CreateGcmCipher();
+        var buffer = new byte[GcmProtectedPacket.Length];
+        GcmPlainPacket.CopyTo(buffer, 0);
+
+        int length = cipher.ProtectRtp(buffer, GcmPlainPacket.Length, 12, 0x5501A0B2, 0xF17B);
+
+        Assert.Equal(GcmProtectedPacket.Length, length);
+        Assert.Equal(GcmProtectedPacket, buffer);
+    }
+
+    [Fact]
+    public void TestAesGcmUnprotectRtpRfc7714()
+    {
+        using var cipher = CreateGcmCipher();
+        var packet = GcmProtectedPacket.ToArray();
+
+        Assert.True(cipher.TryUnprotectRtp(packet, 12, 0x5501A0B2, 0xF17B, out int length));
+        Assert.Equal(GcmPlainPacket, packet[..length]);
+
+        var tampered = GcmProtectedPacket.ToArray();
+        tampered[20] ^= 1;
+        Assert.False(cipher.TryUnprotectRtp(tampered, 12, 0x5501A0B2, 0xF17B, out _));
+
+        // The ROC is part of the IV
+        packet = GcmProtectedPacket.ToArray();
+        Assert.False(cipher.TryUnprotectRtp(packet, 12, 0x5501A0B2, 0x1_F17B, out _));
+    }
+
+    [Theory]
+    [InlineData(SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_80)]
+    [InlineData(SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_32)]
+    [InlineData(SrtpProtectionProfile.AEAD_AES_128_GCM)]
+    public void TestRtpRoundTrip(SrtpProtectionProfile profile)
+    {
+        var policy = CreatePolicy(profile);
+        using var sender = new SrtpCipher(policy, isRtcp: false);
+        using var receiver = new SrtpCipher(policy, isRtcp: false);
+        var plain = CreateRtpPacket(1000, 0x12345678, 100);
+        var buffer = new byte[plain.Length + sender.TagLength];
+        plain.CopyTo(buffer, 0);
+
+        int protectedLength = sender.ProtectRtp(buffer, plain.Length, 12, 0x12345678, 0x2_03E8);
+
+        Assert.Equal(plain.Length + policy.RtpTagLength, protectedLength);
+        Assert.NotEqual(plain.AsSpan(12).ToArray(), buffer.AsSpan(12, plain.Length - 12).ToArray());
+
+        var tampered = buffer.ToArray();
+        tampered[5] ^= 0x80;
+        Assert.False(receiver.TryUnprotectRtp(tampered, 12, 0x12345678, 0x2_03E8, out _));
+
+        Assert.True(receiver.TryUnprotectRtp(buffer, 12, 0x12345678, 0x2_03E8, out int length));
+        Assert.Equal(plain, buffer[..length]);
+    }
+
+    [Theory]
+    [InlineData(SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_80)]
+    [InlineData(SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_32)]
+    [InlineData(SrtpProtectionProfile.AEAD_AES_128_GCM)]
+    public void TestRtcpRoundTrip(SrtpProtectionProfile profile)
+    {
+        var policy = CreatePolicy(profile);
+        using var sender = new SrtpCipher(policy, isRtcp: true);
+        using var receiver = new SrtpCipher(policy, isRtcp: true);
+
+        // Receiver report without report blocks and an SDES packet, as RtcpSession sends them
+        var plain = Convert.FromHexString("81C90001DEADBEEF81CA0003123456780104746573740000");
+        var buffer = new byte[plain.Length + SrtpCipher.SRTCP_INDEX_LENGTH + sender.TagLength];
+        plain.CopyTo(buffer, 0);
+
+        int protectedLength = sender.ProtectRtcp(buffer, plain.Length, 7);
+
+        Assert.Equal(buffer.Length, protectedLength);
+        Assert.Equal(plain[..8], buffer[..8]);
+        Assert.True(receiver.TryUnprotectRtcp(buffer, out uint index, out int length));
+        Assert.Equal(7u, index);
+        Assert.Equal(plain, buffer[..length]);
+    }
+
+    [Fact]
+    public void TestAesGcmUnprotectAuthenticatedOnlyRtcp()
+    {
+        // E flag clear: the whole packet and the trailer are associated data (RFC 7714 9.2)
+        using var cipher = CreateGcmCipher();
+        var plain = new byte[1200];
+        Convert.FromHexString("81C9012BDEADBEEF").CopyTo(plain, 0);
+        RandomNumberGenerator.Fill(plain.AsSpan(8));
+        uint index = 0x1234;
+
+        var packet = new byte[plain.Length + 16 + SrtpCipher.SRTCP_INDEX_LENGTH];
+        plain.CopyTo(packet, 0);
+        BinaryPrimitives.WriteUInt32BigEndian(packet.AsSpan(packet.Length - SrtpCipher.SRTCP_INDEX_LENGTH), index);
+
+        var iv = new byte[12];
+        BinaryPrimitives.WriteUInt32BigEndian(iv.AsSpan(2), 0xDEADBEEF);
+        BinaryPrimitives.WriteUInt32BigEndian(iv.AsSpan(8), index);
+        for (int i = 0; i < iv.Length; i++)
+        {
+            iv[i] ^= GcmSalt[i];
+        }
+
+        var associatedData = plain.Concat(packet[^SrtpCipher.SRTCP_INDEX_LENGTH..]).ToArray();
+        using (var gcm = new AesGcm(GcmKey, 16))
+        {
+            gcm.Encrypt(iv, ReadOnlySpan<byte>.Empty, Span<byte>.Empty, packet.AsSpan(plain.Length, 16),
+                associatedData);
+        }
+
+        var tampered = packet.ToArray();
+        tampered[600] ^= 1;
+        Assert.False(cipher.TryUnprotectRtcp(tampered, out _, out _));
+
+        Assert.True(cipher.TryUnprotectRtcp(packet, out uint unprotectedIndex, out int length));
+        Assert.Equal(index, unprotectedIndex);
+        Assert.Equal(plain, packet[..length]);
+    }
+
+    private static SrtpCipher CreateGcmCipher()
+    {
+        return new SrtpCipher(true, 16, GcmKey.ToArray(), GcmSalt.ToArray(), null);
+    }
+
+    internal static SrtpPolicy CreatePolicy(SrtpProtectionProfile profile)
+    {
+        return profile == SrtpProtectionProfile.AEAD_AES_128_GCM
+            ? new SrtpPolicy(profile, MasterKey, MasterSalt[..12])
+            : new SrtpPolicy(profile, MasterKey, MasterSalt);
+    }
+
+    internal static byte[] CreateRtpPacket(ushort sequence, uint ssrc, int payloadLength)
+    {
+        var packet = new byte[12 + payloadLength];
+        packet[0] = 0x80;
+        packet[1] = 96;
+        BinaryPrimitives.WriteUInt16BigEndian(packet.AsSpan(2), sequence);
+        BinaryPrimitives.WriteUInt32BigEndian(packet.AsSpan(4), sequence * 3000u);
+        BinaryPrimitives.WriteUInt32BigEndian(packet.AsSpan(8), ssrc);
+        for (int i = 12; i < packet.Length; i++)
+        {
+            packet[i] = (byte)(sequence + i);
+        }
+
+        return packet;
+    }
+}
@@ -0,0 +1,121 @@
+using SharpVideo.Srtp;
+
+namespace SharpVideo.Tests;
+
+public class SrtpReceiveContextTest
+{
+    private const uint Ssrc = 0x0BADCAFE;
+
+    private static readonly SrtpPolicy Policy = SrtpCipherTest.CreatePolicy(SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_80);
+
+    [Fact]
+    public void TestSequenceNumberRollover()
+    {
+        using var sender = new SrtpCipher(Policy, isRtcp: false);
+        using var context = new SrtpReceiveContext(Policy);
+
+        // The ROC increments when the sequence number wraps
+        AssertAccepted(context, sender, 0xFFFE, 0);
+        AssertAccepted(context, sender, 0xFFFF, 0);
+        AssertAccepted(context, sender, 0x0000, 1);
+        AssertAccepted(context, sender, 0x0001, 1);
+
+        // Reordered across the wrap: a late packet from before it still has the previous ROC
+        AssertAccepted(context, sender, 0xFFFD, 0);
+        AssertAccepted(context, sender, 0x0003, 1);
+        AssertAccepted(context, sender, 0x0002, 1);
+        Assert.Equal(0, context.AuthenticationFailures);
+        Assert.Equal(0, context.ReplayedPackets);
+    }
+
+    [Fact]
+    public void TestSecondRollover()
+    {
+        using var sender = new SrtpCipher(Policy, isRtcp: false);
+        using var context = new SrtpReceiveContext(Policy);
+
+        for (uint index = 0; index <= 0x2_0010; index += 0x1000)
+        {
+            AssertAccepted(context, sender, (ushort)index, index >> 16);
+        }
+
+        Assert.Equal(0, context.AuthenticationFailures);
+    }
+
+    [Fact]
+    public void TestReplayIsRejected()
+    {
+        using var sender = new SrtpCipher(Policy, isRtcp: false);
+        using var context = new SrtpReceiveContext(Policy);
+
+        var packet = Protect(sender, 0xFFFF, 0);
+        var replay = packet.ToArray();
+        AssertAccepted(context, sender, 0xFFFE, 0);
+        AssertAccepted(context, sender, 0x0000, 1);
+        Assert.True(context.TryUnprotect(packet, out _));
+
+        Assert.False(context.TryUnprotect(replay, out _));
+        Assert.False(context.TryUnprotect(Protect(sender, 0x0000, 1), out _));
+        Assert.Equal(2, context.ReplayedPackets);
+        Assert.Equal(0, context.AuthenticationFailures);
+    }
+
+    [Fact]
+    public void TestWrongRocIsRejected()
+    {
+        using var sender = new SrtpCipher(Policy, isRtcp: false);
+        using var context = new SrtpReceiveContext(Policy);
+
+        AssertAccepted(context, sender, 10, 0);
+
+        // Far from a wrap the receiver keeps ROC 0, a sender that is a rollover ahead fails authentication
+        Assert.False(context.TryUnprotect(Protect(sender, 11, 1), out _));
+        Assert.Equal(1, context.AuthenticationFailures);
+        AssertAccepted(context, sender, 11, 0);
+    }
+
+    [Fact]
+    public void TestForgedPacketIsNotTracked()
+    {
+        using var sender = new SrtpCipher(Policy, isRtcp: false);
+        using var context = new SrtpReceiveContext(Policy);
+
+        // A forged packet must not start the source's replay window or ROC
+        var forged = Protect(sender, 0xFFF0, 0);
+        forged[^1] ^= 1;
+        Assert.False(context.TryUnprotect(forged, out _));
+
+        AssertAccepted(context, sender, 0x0005, 0);
+        Assert.Equal(1, context.AuthenticationFailures);
+    }
+
+    [Fact]
+    public void TestMalformedPacketIsRejected()
+    {
+        using var context = new SrtpReceiveContext(Policy);
+
+        Assert.False(context.TryUnprotect(new byte[11], out _));
+
+        // Header extension longer than the packet
+        var packet = SrtpCipherTest.CreateRtpPacket(1, Ssrc, 20);
+        packet[0] |= 0x10;
+        packet[14] = 0xFF;
+        Assert.False(context.TryUnprotect(packet, out _));
+    }
+
+    private static void AssertAccepted(SrtpReceiveContext context, SrtpCipher sender, ushort sequence, uint roc)
+    {
+        var packet = Protect(sender, sequence, roc);
+        Assert.True(context.TryUnprotect(packet, out int length));
+        Assert.Equal(SrtpCipherTest.CreateRtpPacket(sequence, Ssrc, 40), packet[..length]);
+    }
+
+    private static byte[] Protect(SrtpCipher sender, ushort sequence, uint roc)
+    {
+        var plain = SrtpCipherTest.CreateRtpPacket(sequence, Ssrc, 40);
+        var buffer = new byte[plain.Length + sender.TagLength];
+        plain.CopyTo(buffer, 0);
+        sender.ProtectRtp(buffer, plain.Length, 12, Ssrc, ((ulong)roc << 16) | sequence);
+        return buffer;
+    }
+}
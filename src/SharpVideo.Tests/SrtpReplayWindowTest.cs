@@ -0,0 +1,76 @@
+using SharpVideo.Srtp;
+
+namespace SharpVideo.Tests;
+
+public class SrtpReplayWindowTest
+{
+    [Fact]
+    public void TestEmptyWindowAcceptsAnything()
+    {
+        var window = new SrtpReplayWindow();
+
+        Assert.False(window.IsReplay(0));
+        Assert.False(window.IsReplay(0xFFFF_FFFF_FFFF));
+    }
+
+    [Fact]
+    public void TestReceivedIndicesAreReplays()
+    {
+        var window = new SrtpReplayWindow();
+        window.Update(1000);
+        window.Update(1002);
+
+        Assert.True(window.IsReplay(1000));
+        Assert.True(window.IsReplay(1002));
+        Assert.False(window.IsReplay(1001));
+        Assert.False(window.IsReplay(1003));
+        Assert.Equal(1002ul, window.Highest);
+
+        // Late but inside the window
+        window.Update(1001);
+        Assert.True(window.IsReplay(1001));
+        Assert.Equal(1002ul, window.Highest);
+    }
+
+    [Fact]
+    public void TestIndicesBehindTheWindowAreReplays()
+    {
+        var window = new SrtpReplayWindow();
+        window.Update(1000);
+
+        Assert.False(window.IsReplay(1000 - SrtpReplayWindow.SIZE + 1));
+        Assert.True(window.IsReplay(1000 - SrtpReplayWindow.SIZE));
+    }
+
+    [Theory]
+    [InlineData(1)]
+    [InlineData(63)]
+    [InlineData(64)]
+    [InlineData(65)]
+    [InlineData(127)]
+    [InlineData(128)]
+    [InlineData(1000)]
+    public void TestWindowShift(int shift)
+    {
+        var window = new SrtpReplayWindow();
+        for (ulong index = 100; index < 100 + SrtpReplayWindow.SIZE; index++)
+        {
+            if (index % 3 == 0)
+            {
+                window.Update(index);
+            }
+        }
+
+        ulong highest = window.Highest + (ulong)shift;
+        window.Update(highest);
+
+        for (ulong index = highest - SrtpReplayWindow.SIZE + 1; index < highest; index++)
+        {
+            bool received = index >= 100 && index < 100 + SrtpReplayWindow.SIZE && index % 3 == 0;
+            Assert.Equal(received, window.IsReplay(index));
+        }
+
+        Assert.True(window.IsReplay(highest));
+        Assert.True(window.IsReplay(highest - SrtpReplayWindow.SIZE));
+    }
+}
@@ -0,0 +1,235 @@
+using System.Runtime.Intrinsics;
+using SharpVideo.Drm;
+using SharpVideo.Utils;
+
+namespace SharpVideo.Tests;
+
+public class YuvToRgbConverterTest
+{
+    private const byte Sentinel = 0xA5;
+
+    [Theory]
+    [InlineData("NV12", YuvColorMatrix.Bt601, YuvRange.Limited)]
+    [InlineData("NV12", YuvColorMatrix.Bt601, YuvRange.Full)]
+    [InlineData("NV12", YuvColorMatrix.Bt709, YuvRange.Limited)]
+    [InlineData("NV12", YuvColorMatrix.Bt709, YuvRange.Full)]
+    [InlineData("NV16", YuvColorMatrix.Bt601, YuvRange.Limited)]
+    [InlineData("NV16", YuvColorMatrix.Bt709, YuvRange.Full)]
+    [InlineData("YUYV", YuvColorMatrix.Bt601, YuvRange.Limited)]
+    [InlineData("YUYV", YuvColorMatrix.Bt601, YuvRange.Full)]
+    [InlineData("YUYV", YuvColorMatrix.Bt709, YuvRange.Limited)]
+    [InlineData("YUYV", YuvColorMatrix.Bt709, YuvRange.Full)]
+    public void TestMatchesReferenceForOddSizeAndPaddedStrides(string format, YuvColorMatrix matrix, YuvRange range)
+    {
+        // 37 pixels per row: two vector blocks of 16 (NV12/NV16) or four of 8 (YUYV) plus a scalar tail with an
+        // odd last pixel
+        var frame = new TestFrame(GetFormat(format), 37, 23, 7);
+
+        foreach (var destinationFormat in new[]
+                 {
+                     KnownPixelFormats.DRM_FORMAT_XRGB8888,
+                     KnownPixelFormats.DRM_FORMAT_BGR888,
+                     KnownPixelFormats.DRM_FORMAT_RGB888
+                 })
+        {
+            int bytesPerPixel = YuvToRgbConverter.GetBytesPerPixel(destinationFormat);
+            int destinationStride = frame.Width * bytesPerPixel + 13;
+            var destination = new byte[frame.Height * destinationStride];
+            Array.Fill(destination, Sentinel);
+
+            YuvToRgbConverter.Convert(frame.Data, frame.Params, frame.Format, destination, destinationStride,
+                destinationFormat, matrix, range, maxDegreeOfParallelism: 1);
+
+            AssertMatchesReference(frame, destination, destinationStride, destinationFormat, matrix, range);
+        }
+    }
+
+    [Fact]
+    public void TestBandsMatchSingleThreadedConversion()
+    {
+        // 4 bands of 32 rows or more, the last band ends on an odd row
+        var frame = new TestFrame(KnownPixelFormats.DRM_FORMAT_NV12, 133, 131, 11);
+        int stride = frame.Width * 4;
+        var single = new byte[frame.Height * stride];
+        var banded = new byte[frame.Height * stride];
+
+        YuvToRgbConverter.Convert(frame.Data, frame.Params, frame.Format, single, stride,
+            KnownPixelFormats.DRM_FORMAT_XRGB8888, maxDegreeOfParallelism: 1);
+        YuvToRgbConverter.Convert(frame.Data, frame.Params, frame.Format, banded, stride,
+            KnownPixelFormats.DRM_FORMAT_XRGB8888, maxDegreeOfParallelism: 4);
+
+        Assert.Equal(single, banded);
+        AssertMatchesReference(frame, banded, stride, KnownPixelFormats.DRM_FORMAT_XRGB8888,
+            YuvColorMatrix.Bt601, YuvRange.Limited);
+    }
+
+    [Theory]
+    [InlineData(YuvColorMatrix.Bt601, YuvRange.Limited)]
+    [InlineData(YuvColorMatrix.Bt601, YuvRange.Full)]
+    [InlineData(YuvColorMatrix.Bt709, YuvRange.Limited)]
+    [InlineData(YuvColorMatrix.Bt709, YuvRange.Full)]
+    public void TestVectorKernelsMatchScalarKernel(YuvColorMatrix matrix, YuvRange range)
+    {
+        // Called directly so that both widths are checked whatever the CPU accelerates
+        var coefficients = YuvToRgbConverter.GetCoefficients(matrix, range);
+        var y = new int[8];
+        var u = new int[8];
+        var v = new int[8];
+        var result128 = new int[8];
+        var result256 = new int[8];
+
+        for (int luma = 0; luma < 256; luma += 8)
+        {
+            for (int cb = 0; cb < 256; cb += 3)
+            {
+                for (int cr = 0; cr < 256; cr += 5)
+                {
+                    for (int i = 0; i < 8; i++)
+                    {
+                        y[i] = luma + i;
+                        u[i] = (cb + i * 37) & 0xFF;
+                        v[i] = (cr + i * 71) & 0xFF;
+                    }
+
+                    YuvToRgbConverter.ToBgrx(Vector128.Create(y), Vector128.Create(u), Vector128.Create(v), coefficients)
+                        .CopyTo(result128);
+                    YuvToRgbConverter.ToBgrx(Vector128.Create(y, 4), Vector128.Create(u, 4), Vector128.Create(v, 4), coefficients)
+                        .CopyTo(result128, 4);
+                    YuvToRgbConverter.ToBgrx(Vector256.Create(y), Vector256.Create(u), Vector256.Create(v), coefficients)
+                        .CopyTo(result256);
+
+                    for (int i = 0; i < 8; i++)
+                    {
+                        int expected = YuvToRgbConverter.ToBgrx(y[i], u[i], v[i], coefficients);
+                        Assert.Equal(expected, result128[i]);
+                        Assert.Equal(expected, result256[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    [Fact]
+    public void TestRejectsTooSmallBuffers()
+    {
+        var frame = new TestFrame(KnownPixelFormats.DRM_FORMAT_NV12, 16, 8, 0);
+
+        Assert.Throws<ArgumentException>(() => YuvToRgbConverter.Convert(frame.Data.AsSpan(0, frame.Data.Length - 1),
+            frame.Params, frame.Format, new byte[16 * 8 * 4], 16 * 4, KnownPixelFormats.DRM_FORMAT_XRGB8888));
+        Assert.Throws<ArgumentException>(() => YuvToRgbConverter.Convert(frame.Data, frame.Params, frame.Format,
+            new byte[16 * 8 * 4 - 1], 16 * 4, KnownPixelFormats.DRM_FORMAT_XRGB8888));
+    }
+
+    private static void AssertMatchesReference(TestFrame frame, byte[] destination, int destinationStride,
+        PixelFormat destinationFormat, YuvColorMatrix matrix, YuvRange range)
+    {
+        int bytesPerPixel = YuvToRgbConverter.GetBytesPerPixel(destinationFormat);
+        for (int row = 0; row < frame.Height; row++)
+        {
+            for (int x = 0; x < frame.Width; x++)
+            {
+                var (y, u, v) = frame.GetPixel(x, row);
+                var (r, g, b) = ReferenceToRgb(y, u, v, matrix, range);
+                var pixel = destination.AsSpan(row * destinationStride + x * bytesPerPixel, bytesPerPixel);
+
+                var (red, green, blue) = destinationFormat == KnownPixelFormats.DRM_FORMAT_BGR888
+                    ? (pixel[0], pixel[1], pixel[2])
+                    : (pixel[2], pixel[1], pixel[0]);
+                Assert.InRange(red, r - 1, r + 1);
+                Assert.InRange(green, g - 1, g + 1);
+                Assert.InRange(blue, b - 1, b + 1);
+                if (bytesPerPixel == 4)
+                {
+                    Assert.Equal(0xFF, pixel[3]);
+                }
+            }
+
+            // The padding at the end of a destination row is left alone
+            var padding = destination.AsSpan(row * destinationStride + frame.Width * bytesPerPixel,
+                destinationStride - frame.Width * bytesPerPixel);
+            Assert.True(padding.IndexOfAnyExcept(Sentinel) < 0);
+        }
+    }
+
+    /// <summary>
+    /// The conversion in floating point, straight from the matrix definition.
+    /// </summary>
+    private static (int R, int G, int B) ReferenceToRgb(int y, int u, int v, YuvColorMatrix matrix, YuvRange range)
+    {
+        double kr = matrix == YuvColorMatrix.Bt601 ? 0.299 : 0.2126;
+        double kb = matrix == YuvColorMatrix.Bt601 ? 0.114 : 0.0722;
+        double kg = 1 - kr - kb;
+
+        double luma = range == YuvRange.Limited ? (y - 16) * 255.0 / 219 : y;
+        double cb = range == YuvRange.Limited ? (u - 128) * 255.0 / 224 : u - 128;
+        double cr = range == YuvRange.Limited ? (v - 128) * 255.0 / 224 : v - 128;
+
+        double r = luma + 2 * (1 - kr) * cr;
+        double g = luma - 2 * kb * (1 - kb) / kg * cb - 2 * kr * (1 - kr) / kg * cr;
+        double b = luma + 2 * (1 - kb) * cb;
+        return (ToByte(r), ToByte(g), ToByte(b));
+    }
+
+    private static int ToByte(double value) => (int)Math.Clamp(Math.Round(value), 0, 255);
+
+    private static PixelFormat GetFormat(string name) => name switch
+    {
+        "NV12" => KnownPixelFormats.DRM_FORMAT_NV12,
+        "NV16" => KnownPixelFormats.DRM_FORMAT_NV16,
+        _ => KnownPixelFormats.DRM_FORMAT_YUYV
+    };
+
+    /// <summary>
+    /// A frame of pseudo random samples with a padded stride and, for the semi-planar formats, a gap before the
+    /// chroma plane.
+    /// </summary>
+    private sealed class TestFrame
+    {
+        public TestFrame(PixelFormat format, int width, int height, int padding)
+        {
+            Format = format;
+            Width = width;
+            Height = height;
+            int pairedWidth = (width + 1) & ~1;
+            bool isPacked = format == KnownPixelFormats.DRM_FORMAT_YUYV;
+            Stride = (isPacked ? pairedWidth * 2 : pairedWidth) + padding;
+            int chromaRows = format == KnownPixelFormats.DRM_FORMAT_NV12 ? (height + 1) / 2 : height;
+            ChromaOffset = isPacked ? 0 : height * Stride + 3 * padding;
+            int length = isPacked ? height * Stride : ChromaOffset + chromaRows * Stride;
+
+            Data = new byte[length];
+            new Random(width * 1000 + height).NextBytes(Data);
+            Params = new BufferParams
+            {
+                Width = (uint)width,
+                Height = (uint)height,
+                FullSize = (ulong)length,
+                PlanesCount = isPacked ? 1 : 2,
+                PlaneOffsets = isPacked ? [0] : [0, (ulong)ChromaOffset],
+                Stride = (uint)Stride
+            };
+        }
+
+        public PixelFormat Format { get; }
+        public int Width { get; }
+        public int Height { get; }
+        public int Stride { get; }
+        public int ChromaOffset { get; }
+        public byte[] Data { get; }
+        public BufferParams Params { get; }
+
+        public (int Y, int U, int V) GetPixel(int x, int row)
+        {
+            int pair = x & ~1;
+            if (Format == KnownPixelFormats.DRM_FORMAT_YUYV)
+            {
+                int offset = row * Stride;
+                return (Data[offset + x * 2], Data[offset + pair * 2 + 1], Data[offset + pair * 2 + 3]);
+            }
+
+            int chromaRow = Format == KnownPixelFormats.DRM_FORMAT_NV12 ? row / 2 : row;
+            int chroma = ChromaOffset + chromaRow * Stride + pair;
+            return (Data[row * Stride + x], Data[chroma], Data[chroma + 1]);
+        }
+    }
+}
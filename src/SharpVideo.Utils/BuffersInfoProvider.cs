@@ -15,6 +15,22 @@ public static class BuffersInfoProvider
                     BitsPerPixel = [8, 4]
                 }
             },
+            {
+                KnownPixelFormats.DRM_FORMAT_NV16,
+                new FormatInfo
+                {
+                    PlanesCount = 2,
+                    BitsPerPixel = [8, 8]
+                }
+            },
+            {
+                KnownPixelFormats.DRM_FORMAT_YUYV,
+                new FormatInfo
+                {
+                    PlanesCount = 1,
+                    BitsPerPixel = [2 * 8]
+                }
+            },
             {
                 KnownPixelFormats.DRM_FORMAT_XRGB8888,
                 new FormatInfo
@@ -73,6 +73,18 @@ public sealed class DrmPresenter : IDisposable
         }
     }
 
+    /// <summary>
+    /// Gets whether an overlay plane is configured.
+    /// </summary>
+    public bool HasOverlayPlane
+    {
+        get
+        {
+            ObjectDisposedException.ThrowIf(_disposed, this);
+            return _overlayPlanePresenter != null;
+        }
+    }
+
     /// <summary>
     /// Gets the primary plane presenter.
     /// Works with any presenter type: DMA, GBM, or GBM Atomic.
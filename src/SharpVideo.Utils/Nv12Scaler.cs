@@ -0,0 +1,454 @@
+using System.Buffers;
+using System.Drawing;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.Intrinsics;
+using System.Runtime.Versioning;
+using SharpVideo.DmaBuffers;
+using SharpVideo.Drm;
+
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// Shrinks NV12 frames, optionally cropped, to NV12 or planar RGB of any size, e.g. for thumbnails and analytics.
+/// </summary>
+/// <remarks>
+/// Each plane is scaled separately, the interleaved chroma plane as an image with two channels. A destination row is
+/// produced in two passes: the source rows it covers are summed (box) or interpolated (bilinear) into a row of 16 bit
+/// values with Vector128/Vector256 operations, then each destination pixel reduces its columns of that row. Only the
+/// first pass touches every covered source byte, so it is the vectorized one, and it reads the source in place: call
+/// <see cref="Scale(SharedDmaBuffer, Span{byte}, BufferParams, ScaleFilter, Rectangle?)"/> on a dequeued capture
+/// buffer before it is queued again instead of copying the full frame out.
+/// Scaling runs on the calling thread; box scaling supports factors up to <see cref="MaxBoxFactor"/>.
+/// </remarks>
+public static class Nv12Scaler
+{
+    /// <summary>
+    /// Largest ratio of source to destination size of the box filter, so that 16 bit sums cannot overflow.
+    /// </summary>
+    public const int MaxBoxFactor = 256;
+
+    private const int WeightBits = 8;
+    private const int WeightOne = 1 << WeightBits;
+
+    /// <summary>
+    /// Scales a mapped NV12 buffer, e.g. the capture buffer a decoder just handed out.
+    /// </summary>
+    [SupportedOSPlatform("linux")]
+    public static void Scale(
+        SharedDmaBuffer source,
+        Span<byte> destination,
+        BufferParams destinationParams,
+        ScaleFilter filter = ScaleFilter.Box,
+        Rectangle? crop = null)
+    {
+        Scale(source.DmaBuffer.GetMappedSpan(), GetBufferParams(source), destination, destinationParams, filter, crop);
+    }
+
+    /// <summary>
+    /// Scales an NV12 frame to an NV12 frame.
+    /// </summary>
+    /// <param name="source">The frame, laid out as described by <paramref name="sourceParams"/>.</param>
+    /// <param name="sourceParams">Size, stride and plane offsets of the frame, both planes have the same stride.</param>
+    /// <param name="destination">Receives the scaled frame.</param>
+    /// <param name="destinationParams">Size, stride and plane offsets of the scaled frame.</param>
+    /// <param name="filter">How destination pixels are computed.</param>
+    /// <param name="crop">Part of the frame to scale, in luma pixels at even coordinates; null for the whole frame.</param>
+    public static void Scale(
+        ReadOnlySpan<byte> source,
+        BufferParams sourceParams,
+        Span<byte> destination,
+        BufferParams destinationParams,
+        ScaleFilter filter = ScaleFilter.Box,
+        Rectangle? crop = null)
+    {
+        var area = GetSourceArea(source, sourceParams, crop);
+        int width = (int)destinationParams.Width;
+        int height = (int)destinationParams.Height;
+        int stride = (int)destinationParams.Stride;
+        if (width == 0 || height == 0)
+        {
+            return;
+        }
+
+        CheckNv12Length(destination.Length, destinationParams, nameof(destination));
+        CheckFactor(filter, area.Width, area.Height, width, height);
+
+        int sourceStride = (int)sourceParams.Stride;
+        ScalePlane(
+            source.Slice(area.Y * sourceStride + area.X), sourceStride, area.Width, area.Height, 1,
+            destination, stride, width, height, filter);
+        ScalePlane(
+            source.Slice((int)sourceParams.PlaneOffsets[1] + area.Y / 2 * sourceStride + area.X), sourceStride,
+            (area.Width + 1) / 2, (area.Height + 1) / 2, 2,
+            destination.Slice((int)destinationParams.PlaneOffsets[1]), stride, (width + 1) / 2, (height + 1) / 2, filter);
+    }
+
+    /// <summary>
+    /// Scales an NV12 frame to planar RGB: a plane of red, one of green and one of blue bytes, each
+    /// <paramref name="width"/> x <paramref name="height"/> without padding, as analytics models take their input.
+    /// </summary>
+    /// <param name="source">The frame, laid out as described by <paramref name="sourceParams"/>.</param>
+    /// <param name="sourceParams">Size, stride and plane offsets of the frame.</param>
+    /// <param name="destination">Receives the 3 planes, at least 3 * width * height bytes.</param>
+    /// <param name="width">Width of the planes.</param>
+    /// <param name="height">Height of the planes.</param>
+    /// <param name="matrix">Matrix the frame was encoded with.</param>
+    /// <param name="range">Value range of the frame.</param>
+    /// <param name="filter">How destination pixels are computed.</param>
+    /// <param name="crop">Part of the frame to scale, in luma pixels at even coordinates; null for the whole frame.</param>
+    public static void ScaleToPlanarRgb(
+        ReadOnlySpan<byte> source,
+        BufferParams sourceParams,
+        Span<byte> destination,
+        int width,
+        int height,
+        YuvColorMatrix matrix = YuvColorMatrix.Bt601,
+        YuvRange range = YuvRange.Limited,
+        ScaleFilter filter = ScaleFilter.Box,
+        Rectangle? crop = null)
+    {
+        var area = GetSourceArea(source, sourceParams, crop);
+        if (width == 0 || height == 0)
+        {
+            return;
+        }
+
+        int planeSize = width * height;
+        if (destination.Length < 3 * planeSize)
+        {
+            throw new ArgumentException(
+                $"Destination has {destination.Length} bytes, {3 * planeSize} are needed", nameof(destination));
+        }
+
+        CheckFactor(filter, area.Width, area.Height, width, height);
+
+        // Scaled to NV16 first, which keeps the chroma of every destination row, then converted row by row
+        int pairedWidth = (width + 1) & ~1;
+        var nv16Params = new BufferParams
+        {
+            Width = (uint)width,
+            Height = (uint)height,
+            FullSize = (ulong)(2 * pairedWidth * height),
+            PlanesCount = 2,
+            PlaneOffsets = [0, (ulong)(pairedWidth * height)],
+            Stride = (uint)pairedWidth
+        };
+
+        var nv16 = ArrayPool<byte>.Shared.Rent(2 * pairedWidth * height);
+        var bgrx = ArrayPool<int>.Shared.Rent(planeSize);
+        try
+        {
+            int sourceStride = (int)sourceParams.Stride;
+            ScalePlane(
+                source.Slice(area.Y * sourceStride + area.X), sourceStride, area.Width, area.Height, 1,
+                nv16, pairedWidth, width, height, filter);
+            ScalePlane(
+                source.Slice((int)sourceParams.PlaneOffsets[1] + area.Y / 2 * sourceStride + area.X), sourceStride,
+                (area.Width + 1) / 2, (area.Height + 1) / 2, 2,
+                nv16.AsSpan(pairedWidth * height), pairedWidth, pairedWidth / 2, height, filter);
+
+            var pixels = bgrx.AsSpan(0, planeSize);
+            YuvToRgbConverter.Convert(nv16, nv16Params, KnownPixelFormats.DRM_FORMAT_NV16,
+                MemoryMarshal.AsBytes(pixels), width * 4, KnownPixelFormats.DRM_FORMAT_XRGB8888, matrix, range,
+                maxDegreeOfParallelism: 1);
+
+            var red = destination.Slice(0, planeSize);
+            var green = destination.Slice(planeSize, planeSize);
+            var blue = destination.Slice(2 * planeSize, planeSize);
+            for (int i = 0; i < pixels.Length; i++)
+            {
+                int pixel = pixels[i];
+                red[i] = (byte)(pixel >> 16);
+                green[i] = (byte)(pixel >> 8);
+                blue[i] = (byte)pixel;
+            }
+        }
+        finally
+        {
+            ArrayPool<byte>.Shared.Return(nv16);
+            ArrayPool<int>.Shared.Return(bgrx);
+        }
+    }
+
+    /// <summary>
+    /// Layout of a contiguous NV12 buffer as <see cref="DrmBufferManager"/> allocates it.
+    /// </summary>
+    [SupportedOSPlatform("linux")]
+    private static BufferParams GetBufferParams(SharedDmaBuffer buffer)
+    {
+        if (buffer.Format != KnownPixelFormats.DRM_FORMAT_NV12)
+        {
+            throw new ArgumentException($"Unsupported format {buffer.Format}, NV12 is required", nameof(buffer));
+        }
+
+        if (buffer.MapStatus != MapStatus.Mapped)
+        {
+            throw new InvalidOperationException("The buffer is not mapped");
+        }
+
+        var layout = BuffersInfoProvider.GetBufferParams(buffer.Width, buffer.Height, buffer.Format);
+        return new BufferParams
+        {
+            Width = buffer.Width,
+            Height = buffer.Height,
+            FullSize = layout.FullSize,
+            PlanesCount = layout.PlanesCount,
+            PlaneOffsets = layout.PlaneOffsets,
+            Stride = buffer.Stride > 0 ? buffer.Stride : layout.Stride
+        };
+    }
+
+    private static Rectangle GetSourceArea(ReadOnlySpan<byte> source, BufferParams sourceParams, Rectangle? crop)
+    {
+        var frame = new Rectangle(0, 0, (int)sourceParams.Width, (int)sourceParams.Height);
+        var area = crop ?? frame;
+        if (area.Width <= 0 || area.Height <= 0 || !frame.Contains(area))
+        {
+            throw new ArgumentOutOfRangeException(nameof(crop), $"Crop {area} is empty or outside of the frame {frame}");
+        }
+
+        if ((area.X & 1) != 0 || (area.Y & 1) != 0)
+        {
+            throw new ArgumentOutOfRangeException(nameof(crop), "The crop must start at even coordinates");
+        }
+
+        CheckNv12Length(source.Length, sourceParams, nameof(source));
+        return area;
+    }
+
+    private static void CheckNv12Length(int length, BufferParams bufferParams, string paramName)
+    {
+        if (bufferParams.PlanesCount < 2)
+        {
+            throw new ArgumentException("NV12 needs the offset of the chroma plane", paramName);
+        }
+
+        long width = bufferParams.Width;
+        long height = bufferParams.Height;
+        long stride = bufferParams.Stride;
+        long pairedWidth = (width + 1) & ~1;
+        if (stride < pairedWidth)
+        {
+            throw new ArgumentException($"Stride {stride} is smaller than the width {width}", paramName);
+        }
+
+        long lumaEnd = (height - 1) * stride + width;
+        long chromaEnd = (long)bufferParams.PlaneOffsets[1] + ((height + 1) / 2 - 1) * stride + pairedWidth;
+        long required = Math.Max(lumaEnd, chromaEnd);
+        if (length < required)
+        {
+            throw new ArgumentException($"Buffer has {length} bytes, a {width}x{height} frame needs {required}", paramName);
+        }
+    }
+
+    private static void CheckFactor(ScaleFilter filter, int sourceWidth, int sourceHeight, int width, int height)
+    {
+        if (filter == ScaleFilter.Box &&
+            ((long)sourceWidth > (long)width * MaxBoxFactor || (long)sourceHeight > (long)height * MaxBoxFactor))
+        {
+            throw new ArgumentOutOfRangeException(nameof(filter),
+                $"Box scaling {sourceWidth}x{sourceHeight} to {width}x{height} exceeds the factor {MaxBoxFactor}");
+        }
+    }
+
+    private static void ScalePlane(
+        ReadOnlySpan<byte> source,
+        int sourceStride,
+        int sourceWidth,
+        int sourceHeight,
+        int channels,
+        Span<byte> destination,
+        int destinationStride,
+        int width,
+        int height,
+        ScaleFilter filter)
+    {
+        int rowLength = sourceWidth * channels;
+        var row = ArrayPool<ushort>.Shared.Rent(rowLength);
+        var columns = ArrayPool<int>.Shared.Rent(3 * width);
+        try
+        {
+            var rowSpan = row.AsSpan(0, rowLength);
+            if (filter == ScaleFilter.Box)
+            {
+                // columns[x] is the first source column of destination column x, columns[width + x] the count
+                for (int x = 0; x < width; x++)
+                {
+                    GetBoxSpan(x, sourceWidth, width, out columns[x], out columns[width + x]);
+                }
+
+                for (int y = 0; y < height; y++)
+                {
+                    GetBoxSpan(y, sourceHeight, height, out int firstRow, out int rowCount);
+                    rowSpan.Clear();
+                    for (int r = firstRow; r < firstRow + rowCount; r++)
+                    {
+                        AddRow(source.Slice(r * sourceStride, rowLength), rowSpan);
+                    }
+
+                    ReduceBox(rowSpan, columns.AsSpan(0, 2 * width), rowCount, channels,
+                        destination.Slice(y * destinationStride, width * channels));
+                }
+            }
+            else
+            {
+                // columns[x] is the left source column of destination column x, columns[width + x] the right one and
+                // columns[2 * width + x] the weight of the right one
+                for (int x = 0; x < width; x++)
+                {
+                    GetBilinearTaps(x, sourceWidth, width, out columns[x], out columns[width + x], out columns[2 * width + x]);
+                }
+
+                for (int y = 0; y < height; y++)
+                {
+                    GetBilinearTaps(y, sourceHeight, height, out int top, out int bottom, out int weight);
+                    InterpolateRows(
+                        source.Slice(top * sourceStride, rowLength),
+                        source.Slice(bottom * sourceStride, rowLength),
+                        weight,
+                        rowSpan);
+
+                    ReduceBilinear(rowSpan, columns.AsSpan(0, 3 * width), channels,
+                        destination.Slice(y * destinationStride, width * channels));
+                }
+            }
+        }
+        finally
+        {
+            ArrayPool<ushort>.Shared.Return(row);
+            ArrayPool<int>.Shared.Return(columns);
+        }
+    }
+
+    /// <summary>
+    /// The source pixels destination pixel <paramref name="index"/> covers, at least one.
+    /// </summary>
+    private static void GetBoxSpan(int index, int sourceSize, int size, out int first, out int count)
+    {
+        first = (int)((long)index * sourceSize / size);
+        int end = (int)((long)(index + 1) * sourceSize / size);
+        first = Math.Min(first, sourceSize - 1);
+        count = Math.Max(end - first, 1);
+    }
+
+    /// <summary>
+    /// The two source pixels around the centre of destination pixel <paramref name="index"/> and the weight of the
+    /// second one, in 1/256.
+    /// </summary>
+    private static void GetBilinearTaps(int index, int sourceSize, int size, out int first, out int second, out int weight)
+    {
+        // Centre of the destination pixel in source coordinates, in 1/256 pixels
+        long position = ((2L * index + 1) * sourceSize * WeightOne / size - WeightOne) / 2;
+        position = Math.Clamp(position, 0, (long)(sourceSize - 1) * WeightOne);
+        first = (int)(position >> WeightBits);
+        weight = (int)(position & (WeightOne - 1));
+        second = Math.Min(first + 1, sourceSize - 1);
+    }
+
+    /// <summary>
+    /// Adds a source row to the 16 bit sums of the covered rows.
+    /// </summary>
+    private static void AddRow(ReadOnlySpan<byte> sourceRow, Span<ushort> sums)
+    {
+        ref byte source = ref MemoryMarshal.GetReference(sourceRow);
+        ref ushort sum = ref MemoryMarshal.GetReference(sums);
+        int length = sourceRow.Length;
+        int i = 0;
+
+        if (Vector256.IsHardwareAccelerated)
+        {
+            for (; i <= length - 32; i += 32)
+            {
+                var bytes = Vector256.LoadUnsafe(ref source, (nuint)i);
+                (Vector256.LoadUnsafe(ref sum, (nuint)i) + Vector256.WidenLower(bytes)).StoreUnsafe(ref sum, (nuint)i);
+                (Vector256.LoadUnsafe(ref sum, (nuint)i + 16) + Vector256.WidenUpper(bytes)).StoreUnsafe(ref sum, (nuint)i + 16);
+            }
+        }
+
+        if (Vector128.IsHardwareAccelerated)
+        {
+            for (; i <= length - 16; i += 16)
+            {
+                var bytes = Vector128.LoadUnsafe(ref source, (nuint)i);
+                (Vector128.LoadUnsafe(ref sum, (nuint)i) + Vector128.WidenLower(bytes)).StoreUnsafe(ref sum, (nuint)i);
+                (Vector128.LoadUnsafe(ref sum, (nuint)i + 8) + Vector128.WidenUpper(bytes)).StoreUnsafe(ref sum, (nuint)i + 8);
+            }
+        }
+
+        for (; i < length; i++)
+        {
+            Unsafe.Add(ref sum, i) += Unsafe.Add(ref source, i);
+        }
+    }
+
+    /// <summary>
+    /// Interpolates between two source rows, the result is in 1/256.
+    /// </summary>
+    private static void InterpolateRows(ReadOnlySpan<byte> topRow, ReadOnlySpan<byte> bottomRow, int weight, Span<ushort> result)
+    {
+        ref byte top = ref MemoryMarshal.GetReference(topRow);
+        ref byte bottom = ref MemoryMarshal.GetReference(bottomRow);
+        ref ushort value = ref MemoryMarshal.GetReference(result);
+        int length = topRow.Length;
+        int i = 0;
+
+        if (Vector128.IsHardwareAccelerated)
+        {
+            var topWeight = Vector128.Create((ushort)(WeightOne - weight));
+            var bottomWeight = Vector128.Create((ushort)weight);
+            for (; i <= length - 16; i += 16)
+            {
+                var upper = Vector128.LoadUnsafe(ref top, (nuint)i);
+                var lower = Vector128.LoadUnsafe(ref bottom, (nuint)i);
+                (Vector128.WidenLower(upper) * topWeight + Vector128.WidenLower(lower) * bottomWeight)
+                    .StoreUnsafe(ref value, (nuint)i);
+                (Vector128.WidenUpper(upper) * topWeight + Vector128.WidenUpper(lower) * bottomWeight)
+                    .StoreUnsafe(ref value, (nuint)i + 8);
+            }
+        }
+
+        for (; i < length; i++)
+        {
+            Unsafe.Add(ref value, i) =
+                (ushort)(Unsafe.Add(ref top, i) * (WeightOne - weight) + Unsafe.Add(ref bottom, i) * weight);
+        }
+    }
+
+    private static void ReduceBox(ReadOnlySpan<ushort> sums, ReadOnlySpan<int> columns, int rowCount, int channels, Span<byte> destinationRow)
+    {
+        int width = columns.Length / 2;
+        for (int x = 0; x < width; x++)
+        {
+            int first = columns[x] * channels;
+            int count = columns[width + x];
+            int area = count * rowCount;
+            for (int channel = 0; channel < channels; channel++)
+            {
+                int sum = 0;
+                for (int i = first + channel; i < first + count * channels; i += channels)
+                {
+                    sum += sums[i];
+                }
+
+                destinationRow[x * channels + channel] = (byte)((sum + area / 2) / area);
+            }
+        }
+    }
+
+    private static void ReduceBilinear(ReadOnlySpan<ushort> values, ReadOnlySpan<int> columns, int channels, Span<byte> destinationRow)
+    {
+        int width = columns.Length / 3;
+        for (int x = 0; x < width; x++)
+        {
+            int left = columns[x] * channels;
+            int right = columns[width + x] * channels;
+            int weight = columns[2 * width + x];
+            for (int channel = 0; channel < channels; channel++)
+            {
+                int value = values[left + channel] * (WeightOne - weight) + values[right + channel] * weight;
+                destinationRow[x * channels + channel] = (byte)((value + (1 << (2 * WeightBits - 1))) >> (2 * WeightBits));
+            }
+        }
+    }
+}
@@ -0,0 +1,19 @@
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// The file format <see cref="RawFrameSink"/> writes.
+/// </summary>
+public enum RawFrameFormat
+{
+    /// <summary>
+    /// The frames' NV12 planes without stride padding, one frame after the other. Opens with
+    /// <c>ffplay -f rawvideo -pixel_format nv12 -video_size WxH</c>.
+    /// </summary>
+    Nv12,
+
+    /// <summary>
+    /// YUV4MPEG2 with planar 4:2:0 frames, the size and frame rate are in the header so players and
+    /// <c>ffmpeg -i</c> open it as is.
+    /// </summary>
+    Y4m
+}
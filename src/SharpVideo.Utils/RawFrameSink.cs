@@ -0,0 +1,283 @@
+using System.Buffers;
+using System.Runtime.InteropServices;
+using System.Runtime.Intrinsics;
+using System.Runtime.Versioning;
+using System.Security.Cryptography;
+using System.Text;
+using Microsoft.Extensions.Logging;
+using SharpVideo.IoUring;
+
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// Writes decoded NV12 frames bit exact to a raw NV12 or Y4M file, e.g. for decoder conformance checks.
+/// </summary>
+/// <remarks>
+/// Rows are copied without their stride padding into the aligned buffers of an <see cref="IoUringFileStream"/>,
+/// which writes full buffers in the background while the next frame is copied, with O_DIRECT unless disabled so a
+/// long dump does not fill the page cache. Without io_uring a <see cref="FileStream"/> is used.
+/// With hashes enabled every frame's MD5 is written to <c>&lt;path&gt;.framemd5</c> in the format of ffmpeg's framemd5
+/// muxer, so <c>ffmpeg -i stream.h264 -f framemd5 -</c> with the same pixel format gives a file to diff against.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed class RawFrameSink : IDisposable
+{
+    private const int StagingBufferSize = 1024 * 1024;
+    private const int StagingBufferCount = 8;
+
+    private static readonly byte[] Y4mFrameHeader = "FRAME\n"u8.ToArray();
+
+    private readonly RawFrameFormat _format;
+    private readonly int _frameRateNumerator;
+    private readonly int _frameRateDenominator;
+    private readonly Stream _file;
+    private readonly StreamWriter? _hashFile;
+    private readonly IncrementalHash? _hash;
+    private readonly byte[] _hashBytes = new byte[16];
+    private byte[] _chromaRow = [];
+    private uint _width;
+    private uint _height;
+    private long _framesWritten;
+    private bool _disposed;
+
+    /// <param name="path">The output file, replaced if it exists.</param>
+    /// <param name="format">The file format.</param>
+    /// <param name="frameRateNumerator">Frame rate numerator, for the Y4M header and the hash file's time base.</param>
+    /// <param name="frameRateDenominator">Frame rate denominator.</param>
+    /// <param name="computeHashes">Write the MD5 of every frame to <c>&lt;path&gt;.framemd5</c>.</param>
+    /// <param name="useIoUring">Write through io_uring where the kernel supports it.</param>
+    /// <param name="directIo">Bypass the page cache with O_DIRECT, only with io_uring and where the file system
+    /// supports it.</param>
+    /// <param name="logger">Logs the chosen write path.</param>
+    public RawFrameSink(
+        string path,
+        RawFrameFormat format,
+        int frameRateNumerator = 30,
+        int frameRateDenominator = 1,
+        bool computeHashes = false,
+        bool useIoUring = true,
+        bool directIo = true,
+        ILogger? logger = null)
+    {
+        ArgumentOutOfRangeException.ThrowIfLessThan(frameRateNumerator, 1);
+        ArgumentOutOfRangeException.ThrowIfLessThan(frameRateDenominator, 1);
+
+        _format = format;
+        _frameRateNumerator = frameRateNumerator;
+        _frameRateDenominator = frameRateDenominator;
+
+        if (useIoUring && IoUringFileStream.IsSupported)
+        {
+            try
+            {
+                var stream = IoUringFileStream.Create(path, StagingBufferSize, StagingBufferCount, directIo);
+                logger?.LogInformation("Writing {Format} frames to {Path} through io_uring, direct I/O: {DirectIo}",
+                    format, path, stream.UsesDirectIo);
+                _file = stream;
+            }
+            catch (InvalidOperationException ex)
+            {
+                // E.g. the io_uring instance limit
+                logger?.LogWarning("Cannot write {Path} through io_uring, falling back to plain writes: {Message}",
+                    path, ex.Message);
+            }
+        }
+
+        if (_file == null)
+        {
+            _file = new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.Read, StagingBufferSize);
+            logger?.LogInformation("Writing {Format} frames to {Path}", format, path);
+        }
+
+        if (computeHashes)
+        {
+            _hash = IncrementalHash.CreateHash(HashAlgorithmName.MD5);
+            _hashFile = new StreamWriter(path + ".framemd5", append: false, new UTF8Encoding(false))
+            {
+                NewLine = "\n"
+            };
+        }
+    }
+
+    /// <summary>
+    /// Frames written so far.
+    /// </summary>
+    public long FramesWritten => _framesWritten;
+
+    /// <summary>
+    /// Lowercase hex MD5 of the last frame's data, null without hashes or before the first frame.
+    /// </summary>
+    public string? LastFrameHash { get; private set; }
+
+    /// <summary>
+    /// Appends a frame. All frames of a file must have the same size.
+    /// </summary>
+    /// <param name="frame">The NV12 frame, e.g. the mapped capture buffer before it is queued again.</param>
+    /// <param name="frameParams">Size, stride and plane offsets of the frame.</param>
+    public void Write(ReadOnlySpan<byte> frame, BufferParams frameParams)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+
+        int width = (int)frameParams.Width;
+        int height = (int)frameParams.Height;
+        int stride = (int)frameParams.Stride;
+        int chromaWidth = (width + 1) & ~1;
+        int chromaHeight = (height + 1) / 2;
+        int chromaOffset = (int)frameParams.PlaneOffsets[1];
+        if (frameParams.PlanesCount != 2 || stride < chromaWidth ||
+            frame.Length < chromaOffset + (long)(chromaHeight - 1) * stride + chromaWidth)
+        {
+            throw new ArgumentException("The frame is not an NV12 frame of the given size", nameof(frame));
+        }
+
+        if (_framesWritten == 0)
+        {
+            Start(frameParams.Width, frameParams.Height);
+        }
+        else if (frameParams.Width != _width || frameParams.Height != _height)
+        {
+            throw new InvalidOperationException(
+                $"Frame size changed from {_width}x{_height} to {width}x{height}, start a new file");
+        }
+
+        if (_format == RawFrameFormat.Y4m)
+        {
+            _file.Write(Y4mFrameHeader);
+        }
+
+        WritePlane(frame, stride, width, height);
+        var chroma = frame.Slice(chromaOffset);
+        if (_format == RawFrameFormat.Nv12)
+        {
+            WritePlane(chroma, stride, chromaWidth, chromaHeight);
+        }
+        else
+        {
+            WriteDeinterleaved(chroma, stride, chromaWidth / 2, chromaHeight);
+        }
+
+        long frameIndex = _framesWritten++;
+        if (_hash != null)
+        {
+            _hash.GetHashAndReset(_hashBytes);
+            LastFrameHash = Convert.ToHexStringLower(_hashBytes);
+            int size = width * height + chromaWidth * chromaHeight;
+            _hashFile!.WriteLine($"0, {frameIndex,10}, {frameIndex,10}, {1,8}, {size,8}, {LastFrameHash}");
+        }
+    }
+
+    private void Start(uint width, uint height)
+    {
+        _width = width;
+        _height = height;
+        _chromaRow = ArrayPool<byte>.Shared.Rent((int)(width + 1) & ~1);
+
+        if (_format == RawFrameFormat.Y4m)
+        {
+            _file.Write(Encoding.ASCII.GetBytes(
+                $"YUV4MPEG2 W{width} H{height} F{_frameRateNumerator}:{_frameRateDenominator} Ip A1:1 C420mpeg2\n"));
+        }
+
+        if (_hashFile != null)
+        {
+            // Time base and duration as ffmpeg writes them for a constant frame rate, pts counts frames
+            _hashFile.WriteLine("#format: frame checksums");
+            _hashFile.WriteLine("#version: 2");
+            _hashFile.WriteLine("#hash: MD5");
+            _hashFile.WriteLine($"#tb 0: {_frameRateDenominator}/{_frameRateNumerator}");
+            _hashFile.WriteLine("#media_type 0: video");
+            _hashFile.WriteLine("#codec_id 0: rawvideo");
+            _hashFile.WriteLine($"#dimensions 0: {width}x{height}");
+            _hashFile.WriteLine("#sar 0: 1/1");
+            _hashFile.WriteLine("#stream#, dts,        pts, duration,     size, hash");
+        }
+    }
+
+    private void WritePlane(ReadOnlySpan<byte> plane, int stride, int rowBytes, int rows)
+    {
+        if (stride == rowBytes)
+        {
+            Append(plane.Slice(0, rowBytes * rows));
+            return;
+        }
+
+        for (int row = 0; row < rows; row++)
+        {
+            Append(plane.Slice(row * stride, rowBytes));
+        }
+    }
+
+    /// <summary>
+    /// Writes the U plane and then the V plane of an interleaved UV plane
+    /// </summary>
+    private void WriteDeinterleaved(ReadOnlySpan<byte> uvPlane, int stride, int chromaWidth, int rows)
+    {
+        var u = _chromaRow.AsSpan(0, chromaWidth);
+        var v = _chromaRow.AsSpan(chromaWidth, chromaWidth);
+        for (int plane = 0; plane < 2; plane++)
+        {
+            var destination = plane == 0 ? u : v;
+            for (int row = 0; row < rows; row++)
+            {
+                Deinterleave(uvPlane.Slice(row * stride, chromaWidth * 2), plane, destination);
+                Append(destination);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Copies every second byte of <paramref name="pairs"/>, starting at <paramref name="first"/>
+    /// </summary>
+    private static void Deinterleave(ReadOnlySpan<byte> pairs, int first, Span<byte> destination)
+    {
+        ref byte source = ref MemoryMarshal.GetReference(pairs);
+        ref byte target = ref MemoryMarshal.GetReference(destination);
+        int x = 0;
+        if (Vector128.IsHardwareAccelerated)
+        {
+            // Each ushort holds a U, V pair: masking or shifting keeps one of them, Narrow packs 16 of them
+            int shift = first * 8;
+            for (; x <= destination.Length - 16; x += 16)
+            {
+                var lower = Vector128.LoadUnsafe(ref source, (nuint)(x * 2)).AsUInt16();
+                var upper = Vector128.LoadUnsafe(ref source, (nuint)(x * 2 + 16)).AsUInt16();
+                Vector128.Narrow(
+                        Vector128.ShiftRightLogical(lower, shift) & Vector128.Create((ushort)0xFF),
+                        Vector128.ShiftRightLogical(upper, shift) & Vector128.Create((ushort)0xFF))
+                    .StoreUnsafe(ref target, (nuint)x);
+            }
+        }
+
+        for (; x < destination.Length; x++)
+        {
+            destination[x] = pairs[x * 2 + first];
+        }
+    }
+
+    private void Append(ReadOnlySpan<byte> data)
+    {
+        _file.Write(data);
+        _hash?.AppendData(data);
+    }
+
+    public void Dispose()
+    {
+        if (_disposed)
+            return;
+
+        _disposed = true;
+        try
+        {
+            _file.Dispose();
+        }
+        finally
+        {
+            _hashFile?.Dispose();
+            _hash?.Dispose();
+            if (_chromaRow.Length > 0)
+            {
+                ArrayPool<byte>.Shared.Return(_chromaRow);
+            }
+        }
+    }
+}
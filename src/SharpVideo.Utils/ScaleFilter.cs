@@ -0,0 +1,19 @@
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// How <see cref="Nv12Scaler"/> computes a destination pixel.
+/// </summary>
+public enum ScaleFilter
+{
+    /// <summary>
+    /// Average of all source pixels the destination pixel covers. Reads every source row, does not alias at large
+    /// factors; the choice for thumbnails and analytics input.
+    /// </summary>
+    Box,
+
+    /// <summary>
+    /// Interpolates the 4 nearest source pixels. Reads only 2 source rows per destination row, so it is the cheaper
+    /// filter for large frames, but skips detail at factors above 2.
+    /// </summary>
+    Bilinear
+}
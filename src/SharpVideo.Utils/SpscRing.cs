@@ -0,0 +1,550 @@
+using System.Numerics;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.Versioning;
+using SharpVideo.Linux.Native;
+using SharpVideo.Linux.Native.C;
+
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+/// </summary>
+/// <remarks>
+/// Push and pop are a few plain loads and stores on indices that live on separate cache lines, so the two threads do
+/// not share a written cache line in the steady state. A side that has to wait spins briefly and then sleeps in
+/// poll() on an eventfd; the other side only pays for a write() to the eventfd when the waiter is actually asleep.
+/// Batch operations publish many items with a single index store and at most one wake-up.
+/// With <see cref="SpscRingFullMode.DropOldest"/> the producer evicts the oldest item itself, so head updates become
+/// compare-and-swaps and popped slots are not cleared; they hold on to their item until it is overwritten.
+/// <see cref="Complete"/> may be called from any thread.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed class SpscRing<T> : IDisposable
+{
+    private readonly T[] _slots;
+    private readonly long _mask;
+    private readonly bool _dropsOldest;
+    private readonly Action<T>? _onDropped;
+    private readonly int _itemsEventFd;
+    private readonly int _spaceEventFd;
+    private SpscRingIndices _indices;
+    private int _consumerWaiting;
+    private int _producerWaiting;
+    private volatile bool _isAddingCompleted;
+    private bool _disposed;
+
+    /// <param name="capacity">Minimum number of items, rounded up to a power of two.</param>
+    /// <param name="fullMode">What a push does when the ring is full.</param>
+    /// <param name="onDropped">Receives the items evicted by <see cref="SpscRingFullMode.DropOldest"/> on the producer
+    /// thread, e.g. to return them to a pool.</param>
+    public SpscRing(int capacity, SpscRingFullMode fullMode = SpscRingFullMode.DropNewest, Action<T>? onDropped = null)
+    {
+        ArgumentOutOfRangeException.ThrowIfLessThan(capacity, 1);
+
+        int size = (int)BitOperations.RoundUpToPowerOf2((uint)capacity);
+        _slots = new T[size];
+        _mask = size - 1;
+        _dropsOldest = fullMode == SpscRingFullMode.DropOldest;
+        _onDropped = onDropped;
+
+        _itemsEventFd = CreateEventFd();
+        try
+        {
+            _spaceEventFd = CreateEventFd();
+        }
+        catch
+        {
+            Libc.close(_itemsEventFd);
+            throw;
+        }
+    }
+
+    public int Capacity => _slots.Length;
+
+    public SpscRingFullMode FullMode => _dropsOldest ? SpscRingFullMode.DropOldest : SpscRingFullMode.DropNewest;
+
+    /// <summary>
+    /// Number of queued items, a snapshot when read by a thread other than the producer or consumer.
+    /// </summary>
+    public int Count => (int)(Volatile.Read(ref _indices.Tail) - Volatile.Read(ref _indices.Head));
+
+    /// <summary>
+    /// True once <see cref="Complete"/> was called.
+    /// </summary>
+    public bool IsAddingCompleted => _isAddingCompleted;
+
+    /// <summary>
+    /// True once <see cref="Complete"/> was called and every item was consumed.
+    /// </summary>
+    public bool IsCompleted => _isAddingCompleted && Count == 0;
+
+    /// <summary>
+    /// Queues an item. Producer thread only.
+    /// </summary>
+    /// <returns>False if the ring is completed, or full in <see cref="SpscRingFullMode.DropNewest"/> mode.</returns>
+    public bool TryPush(T item)
+    {
+        if (_isAddingCompleted)
+        {
+            return false;
+        }
+
+        long tail = _indices.Tail;
+        if (tail - _indices.CachedHead >= _slots.Length)
+        {
+            _indices.CachedHead = Volatile.Read(ref _indices.Head);
+            if (tail - _indices.CachedHead >= _slots.Length)
+            {
+                if (!_dropsOldest)
+                {
+                    return false;
+                }
+
+                EvictOldest(tail, 1);
+            }
+        }
+
+        _slots[tail & _mask] = item;
+        Volatile.Write(ref _indices.Tail, tail + 1);
+        WakeConsumer();
+        return true;
+    }
+
+    /// <summary>
+    /// Queues an item, waiting for the consumer if the ring is full. Producer thread only.
+    /// </summary>
+    /// <param name="item">The item.</param>
+    /// <param name="timeoutMs">Maximum wait in milliseconds, -1 waits until there is room, the ring is completed or
+    /// the token is cancelled.</param>
+    /// <param name="cancellationToken">Ends the wait early.</param>
+    /// <returns>False on timeout, cancellation or completion; the caller still owns the item.</returns>
+    public bool TryPush(T item, int timeoutMs, CancellationToken cancellationToken = default)
+    {
+        var wait = new WaitState(timeoutMs);
+        try
+        {
+            while (true)
+            {
+                if (TryPush(item))
+                {
+                    EndWait(ref wait, ref _producerWaiting);
+                    return true;
+                }
+
+                if (_isAddingCompleted || !AwaitTurn(ref wait, ref _producerWaiting, _spaceEventFd, cancellationToken))
+                {
+                    EndWait(ref wait, ref _producerWaiting);
+                    return false;
+                }
+            }
+        }
+        finally
+        {
+            wait.Registration.Dispose();
+        }
+    }
+
+    /// <summary>
+    /// Queues as many items as fit, in order, with a single publish. Producer thread only.
+    /// </summary>
+    /// <returns>Number of items queued from the start of <paramref name="items"/>. In
+    /// <see cref="SpscRingFullMode.DropOldest"/> mode the whole batch is accepted; if it is larger than the ring its
+    /// first items are dropped right away.</returns>
+    public int TryPushBatch(ReadOnlySpan<T> items)
+    {
+        if (_isAddingCompleted || items.IsEmpty)
+        {
+            return 0;
+        }
+
+        int accepted = items.Length;
+        long tail = _indices.Tail;
+        if (_dropsOldest)
+        {
+            if (items.Length > _slots.Length)
+            {
+                int excess = items.Length - _slots.Length;
+                for (int i = 0; i < excess; i++)
+                {
+                    _onDropped?.Invoke(items[i]);
+                }
+
+                items = items.Slice(excess);
+            }
+
+            if (tail + items.Length - _indices.CachedHead > _slots.Length)
+            {
+                EvictOldest(tail, items.Length);
+            }
+        }
+        else
+        {
+            long free = _slots.Length - (tail - _indices.CachedHead);
+            if (free < items.Length)
+            {
+                _indices.CachedHead = Volatile.Read(ref _indices.Head);
+                free = _slots.Length - (tail - _indices.CachedHead);
+                if (free == 0)
+                {
+                    return 0;
+                }
+            }
+
+            accepted = (int)Math.Min(free, items.Length);
+            items = items.Slice(0, accepted);
+        }
+
+        int start = (int)(tail & _mask);
+        int firstPart = Math.Min(items.Length, _slots.Length - start);
+        items.Slice(0, firstPart).CopyTo(_slots.AsSpan(start));
+        items.Slice(firstPart).CopyTo(_slots);
+
+        Volatile.Write(ref _indices.Tail, tail + items.Length);
+        WakeConsumer();
+        return accepted;
+    }
+
+    /// <summary>
+    /// Takes the oldest item without waiting. Consumer thread only.
+    /// </summary>
+    public bool TryPop(out T item)
+    {
+        while (true)
+        {
+            long head = _dropsOldest ? Volatile.Read(ref _indices.Head) : _indices.Head;
+            if (head >= _indices.CachedTail)
+            {
+                _indices.CachedTail = Volatile.Read(ref _indices.Tail);
+                if (head >= _indices.CachedTail)
+                {
+                    item = default!;
+                    return false;
+                }
+            }
+
+            ref var slot = ref _slots[head & _mask];
+            item = slot;
+            if (!_dropsOldest)
+            {
+                if (RuntimeHelpers.IsReferenceOrContainsReferences<T>())
+                {
+                    slot = default!;
+                }
+
+                Volatile.Write(ref _indices.Head, head + 1);
+                WakeProducer();
+                return true;
+            }
+
+            // Fails if the producer evicted the item meanwhile; its slot may already hold a newer one.
+            if (Interlocked.CompareExchange(ref _indices.Head, head + 1, head) == head)
+            {
+                return true;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Takes the oldest item, waiting for the producer if the ring is empty. Consumer thread only.
+    /// </summary>
+    /// <param name="item">The item.</param>
+    /// <param name="timeoutMs">Maximum wait in milliseconds, -1 waits until an item arrives, the ring is completed or
+    /// the token is cancelled.</param>
+    /// <param name="cancellationToken">Ends the wait early.</param>
+    /// <returns>False on timeout, cancellation or completion.</returns>
+    public bool TryPop(out T item, int timeoutMs, CancellationToken cancellationToken = default)
+    {
+        var wait = new WaitState(timeoutMs);
+        try
+        {
+            while (true)
+            {
+                if (TryPop(out item))
+                {
+                    EndWait(ref wait, ref _consumerWaiting);
+                    return true;
+                }
+
+                if (!AwaitTurn(ref wait, ref _consumerWaiting, _itemsEventFd, cancellationToken))
+                {
+                    EndWait(ref wait, ref _consumerWaiting);
+
+                    // Items pushed right before Complete are still delivered.
+                    return _isAddingCompleted && TryPop(out item);
+                }
+            }
+        }
+        finally
+        {
+            wait.Registration.Dispose();
+        }
+    }
+
+    /// <summary>
+    /// Takes up to <paramref name="items"/>.Length of the oldest items without waiting. Consumer thread only.
+    /// </summary>
+    /// <returns>Number of items written to the start of <paramref name="items"/>.</returns>
+    public int TryPopBatch(Span<T> items)
+    {
+        if (items.IsEmpty)
+        {
+            return 0;
+        }
+
+        while (true)
+        {
+            long head = _dropsOldest ? Volatile.Read(ref _indices.Head) : _indices.Head;
+            if (head >= _indices.CachedTail)
+            {
+                _indices.CachedTail = Volatile.Read(ref _indices.Tail);
+                if (head >= _indices.CachedTail)
+                {
+                    return 0;
+                }
+            }
+
+            int count = (int)Math.Min(_indices.CachedTail - head, items.Length);
+            int start = (int)(head & _mask);
+            int firstPart = Math.Min(count, _slots.Length - start);
+            var first = _slots.AsSpan(start, firstPart);
+            var second = _slots.AsSpan(0, count - firstPart);
+            first.CopyTo(items);
+            second.CopyTo(items.Slice(firstPart));
+
+            if (!_dropsOldest)
+            {
+                if (RuntimeHelpers.IsReferenceOrContainsReferences<T>())
+                {
+                    first.Clear();
+                    second.Clear();
+                }
+
+                Volatile.Write(ref _indices.Head, head + count);
+                WakeProducer();
+                return count;
+            }
+
+            if (Interlocked.CompareExchange(ref _indices.Head, head + count, head) == head)
+            {
+                return count;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Takes up to <paramref name="items"/>.Length of the oldest items, waiting for at least one if the ring is empty.
+    /// Consumer thread only.
+    /// </summary>
+    /// <returns>Number of items written to the start of <paramref name="items"/>, 0 on timeout, cancellation or
+    /// completion.</returns>
+    public int TryPopBatch(Span<T> items, int timeoutMs, CancellationToken cancellationToken = default)
+    {
+        var wait = new WaitState(timeoutMs);
+        try
+        {
+            while (true)
+            {
+                int count = TryPopBatch(items);
+                if (count > 0)
+                {
+                    EndWait(ref wait, ref _consumerWaiting);
+                    return count;
+                }
+
+                if (!AwaitTurn(ref wait, ref _consumerWaiting, _itemsEventFd, cancellationToken))
+                {
+                    EndWait(ref wait, ref _consumerWaiting);
+                    return _isAddingCompleted ? TryPopBatch(items) : 0;
+                }
+            }
+        }
+        finally
+        {
+            wait.Registration.Dispose();
+        }
+    }
+
+    /// <summary>
+    /// Marks the ring as complete: further pushes fail, a waiting producer gives up and a waiting consumer wakes up
+    /// once the ring is drained.
+    /// </summary>
+    public void Complete()
+    {
+        _isAddingCompleted = true;
+        SignalAll();
+    }
+
+    /// <summary>
+    /// Makes room for <paramref name="needed"/> items by moving the head past the oldest ones. Producer thread only.
+    /// </summary>
+    private void EvictOldest(long tail, int needed)
+    {
+        long head = _indices.CachedHead;
+        while (tail + needed - head > _slots.Length)
+        {
+            T oldest = _slots[head & _mask];
+            long seen = Interlocked.CompareExchange(ref _indices.Head, head + 1, head);
+            if (seen == head)
+            {
+                head++;
+                _onDropped?.Invoke(oldest);
+            }
+            else
+            {
+                // The consumer got there first, which may already have made enough room.
+                head = seen;
+            }
+        }
+
+        _indices.CachedHead = head;
+    }
+
+    /// <summary>
+    /// Called after a failed attempt: spins, then announces the sleep and lets the caller retry once, then sleeps.
+    /// </summary>
+    /// <returns>False once the wait is over because of completion, cancellation or timeout.</returns>
+    private bool AwaitTurn(ref WaitState wait, ref int waitingFlag, int eventFd, CancellationToken cancellationToken)
+    {
+        // Short spin first, the other side is often just about to publish. Never spins on a single core.
+        if (!wait.Spinner.NextSpinWillYield)
+        {
+            wait.Spinner.SpinOnce();
+            return true;
+        }
+
+        if (!wait.Announced)
+        {
+            // Announce the sleep before the last attempt, the other side checks the flag after publishing.
+            Interlocked.Exchange(ref waitingFlag, 1);
+            wait.Announced = true;
+            return true;
+        }
+
+        long remaining = wait.Deadline - Environment.TickCount64;
+        if (_isAddingCompleted || cancellationToken.IsCancellationRequested || remaining <= 0)
+        {
+            return false;
+        }
+
+        if (cancellationToken.CanBeCanceled && !wait.IsRegistered)
+        {
+            wait.Registration = cancellationToken.UnsafeRegister(static state => ((SpscRing<T>)state!).SignalAll(), this);
+            wait.IsRegistered = true;
+        }
+
+        WaitForSignal(eventFd, remaining > int.MaxValue ? -1 : (int)remaining);
+        wait.Announced = false;
+        return true;
+    }
+
+    private static void EndWait(ref WaitState wait, ref int waitingFlag)
+    {
+        if (wait.Announced)
+        {
+            Volatile.Write(ref waitingFlag, 0);
+        }
+    }
+
+    private void WakeConsumer()
+    {
+        // Orders the tail store before the flag load, pairing with the exchange in AwaitTurn.
+        Interlocked.MemoryBarrier();
+        if (Volatile.Read(ref _consumerWaiting) != 0 && Interlocked.Exchange(ref _consumerWaiting, 0) != 0)
+        {
+            Signal(_itemsEventFd);
+        }
+    }
+
+    private void WakeProducer()
+    {
+        Interlocked.MemoryBarrier();
+        if (Volatile.Read(ref _producerWaiting) != 0 && Interlocked.Exchange(ref _producerWaiting, 0) != 0)
+        {
+            Signal(_spaceEventFd);
+        }
+    }
+
+    private void SignalAll()
+    {
+        Signal(_itemsEventFd);
+        Signal(_spaceEventFd);
+    }
+
+    private static int CreateEventFd()
+    {
+        int fd = Libc.eventfd(0, EventFdFlags.EFD_NONBLOCK | EventFdFlags.EFD_CLOEXEC);
+        if (fd < 0)
+        {
+            throw new InvalidOperationException($"eventfd failed, errno {Marshal.GetLastPInvokeError()}");
+        }
+
+        return fd;
+    }
+
+    private static unsafe void Signal(int eventFd)
+    {
+        ulong value = 1;
+        Libc.write(eventFd, &value, sizeof(ulong));
+    }
+
+    private static unsafe void WaitForSignal(int eventFd, int timeoutMs)
+    {
+        var pollFd = new PollFd
+        {
+            fd = eventFd,
+            events = PollEvents.POLLIN
+        };
+
+        if (Libc.poll(ref pollFd, 1, timeoutMs) > 0)
+        {
+            ulong value;
+            Libc.read(eventFd, &value, sizeof(ulong));
+        }
+    }
+
+    public void Dispose()
+    {
+        if (_disposed)
+        {
+            return;
+        }
+
+        _disposed = true;
+        _isAddingCompleted = true;
+        Libc.close(_itemsEventFd);
+        Libc.close(_spaceEventFd);
+    }
+
+    private struct WaitState
+    {
+        public SpinWait Spinner;
+        public bool Announced;
+        public bool IsRegistered;
+        public CancellationTokenRegistration Registration;
+        public readonly long Deadline;
+
+        public WaitState(int timeoutMs)
+        {
+            Deadline = timeoutMs < 0 ? long.MaxValue : Environment.TickCount64 + timeoutMs;
+        }
+    }
+}
+
+/// <summary>
+/// Head and tail of a <see cref="SpscRing{T}"/> on separate cache lines, padded against the fields around them.
+/// Explicit layout is not allowed in generic types, hence a separate struct.
+/// </summary>
+[StructLayout(LayoutKind.Explicit, Size = 3 * CACHE_LINE_SIZE)]
+internal struct SpscRingIndices
+{
+    private const int CACHE_LINE_SIZE = 64;
+
+    // Consumer line: next slot to read and the last tail the consumer has seen.
+    [FieldOffset(CACHE_LINE_SIZE)] public long Head;
+    [FieldOffset(CACHE_LINE_SIZE + 8)] public long CachedTail;
+
+    // Producer line: next slot to write and the last head the producer has seen.
+    [FieldOffset(2 * CACHE_LINE_SIZE)] public long Tail;
+    [FieldOffset(2 * CACHE_LINE_SIZE + 8)] public long CachedHead;
+}
@@ -0,0 +1,18 @@
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// What a <see cref="SpscRing{T}"/> does with a push when it is full.
+/// </summary>
+public enum SpscRingFullMode
+{
+    /// <summary>
+    /// The push fails and the caller keeps the new item. Blocking pushes wait for the consumer instead.
+    /// </summary>
+    DropNewest,
+
+    /// <summary>
+    /// The oldest queued item is evicted to make room, pushes never fail or block.
+    /// Suits live data where a late item is worth less than the current one.
+    /// </summary>
+    DropOldest
+}
@@ -0,0 +1,214 @@
+using System.Diagnostics;
+using System.Runtime.Versioning;
+using Microsoft.Extensions.Logging;
+using SharpVideo.DmaBuffers;
+using SharpVideo.Drm;
+
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// Presents <see cref="TestPattern.FillAnimated"/> frames on a <see cref="DrmPresenter"/> at a fixed rate, a load
+/// for the display path that needs no decoder.
+/// </summary>
+/// <remarks>
+/// Frames are numbered by their slot on the frame clock, not by how many were presented: a frame that is not ready
+/// in its slot is skipped and the next one shows the next number, so drops show up as jumps of the burned-in counter.
+/// The overlay plane is fed from a small pool of buffers like a decoder's capture queue, the primary plane through
+/// the DMA presenter's back buffer. GBM presenters are rendered with OpenGL ES and cannot be driven.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed class SyntheticFrameSource
+{
+    public const int DefaultBufferCount = 4;
+
+    private readonly DrmPlaneLastDmaBufferPresenter? _overlayPresenter;
+    private readonly DrmPlaneDoubleBufferPresenter? _primaryPresenter;
+    private readonly Queue<SharedDmaBuffer> _freeBuffers = new();
+    private readonly ILogger _logger;
+
+    private long _framesPresented;
+    private long _framesLate;
+    private long _framesDropped;
+
+    private SyntheticFrameSource(
+        DrmPlaneLastDmaBufferPresenter? overlayPresenter,
+        DrmPlaneDoubleBufferPresenter? primaryPresenter,
+        ILogger logger)
+    {
+        _overlayPresenter = overlayPresenter;
+        _primaryPresenter = primaryPresenter;
+        _logger = logger;
+    }
+
+    /// <summary>
+    /// Frames presented so far.
+    /// </summary>
+    public long FramesPresented => Interlocked.Read(ref _framesPresented);
+
+    /// <summary>
+    /// Frame slots that passed while the previous frame was being filled or presented.
+    /// </summary>
+    public long FramesLate => Interlocked.Read(ref _framesLate);
+
+    /// <summary>
+    /// Frames that were not presented because the display held every buffer or the plane update failed.
+    /// </summary>
+    public long FramesDropped => Interlocked.Read(ref _framesDropped);
+
+    /// <summary>
+    /// Creates a source that draws into the primary plane's back buffer and swaps it.
+    /// </summary>
+    /// <exception cref="NotSupportedException">The primary plane is not presented from DMA buffers</exception>
+    public static SyntheticFrameSource CreateForPrimaryPlane(DrmPresenter presenter, ILogger logger)
+    {
+        var primaryPresenter = presenter.AsDmaBufferPresenter() ??
+                               throw new NotSupportedException("The primary plane is not presented from DMA buffers");
+        var backBuffer = primaryPresenter.GetPrimaryPlaneBackBufferDma();
+        if (!TestPattern.IsSupported(backBuffer.Format))
+        {
+            throw new NotSupportedException($"Unsupported primary plane format {backBuffer.Format.GetName()}");
+        }
+
+        return new SyntheticFrameSource(null, primaryPresenter, logger);
+    }
+
+    /// <summary>
+    /// Creates a source that presents frames on the overlay plane from a pool of buffers.
+    /// </summary>
+    /// <param name="presenter">A presenter with an overlay plane.</param>
+    /// <param name="bufferManager">Allocates the buffers and owns them afterwards; must manage
+    /// <paramref name="format"/>.</param>
+    /// <param name="width">Frame width.</param>
+    /// <param name="height">Frame height.</param>
+    /// <param name="format">The overlay plane format, one of the formats of <see cref="TestPattern.IsSupported"/>.</param>
+    /// <param name="logger">Logger.</param>
+    /// <param name="bufferCount">Buffers in the pool, the display holds up to 2.</param>
+    public static SyntheticFrameSource CreateForOverlayPlane(
+        DrmPresenter presenter,
+        DrmBufferManager bufferManager,
+        uint width,
+        uint height,
+        PixelFormat format,
+        ILogger logger,
+        int bufferCount = DefaultBufferCount)
+    {
+        ArgumentOutOfRangeException.ThrowIfLessThan(bufferCount, 2);
+        if (!presenter.HasOverlayPlane)
+        {
+            throw new ArgumentException("The presenter has no overlay plane", nameof(presenter));
+        }
+
+        if (!TestPattern.IsSupported(format))
+        {
+            throw new NotSupportedException($"Unsupported overlay plane format {format.GetName()}");
+        }
+
+        var source = new SyntheticFrameSource(presenter.OverlayPlanePresenter, null, logger);
+        for (int i = 0; i < bufferCount; i++)
+        {
+            var buffer = bufferManager.AllocateBuffer(width, height, format);
+            buffer.MapBuffer();
+            if (buffer.MapStatus == MapStatus.FailedToMap)
+            {
+                throw new InvalidOperationException($"Failed to map overlay buffer {i}");
+            }
+
+            source._freeBuffers.Enqueue(buffer);
+        }
+
+        return source;
+    }
+
+    /// <summary>
+    /// Presents frames on the calling thread until <paramref name="frameCount"/> frame periods have passed or the
+    /// token is cancelled.
+    /// </summary>
+    /// <param name="framesPerSecond">The target rate.</param>
+    /// <param name="frameCount">Frame periods to run for, null to run until cancelled.</param>
+    /// <param name="cancellationToken">Stops the source.</param>
+    public void Run(double framesPerSecond, long? frameCount = null, CancellationToken cancellationToken = default)
+    {
+        ArgumentOutOfRangeException.ThrowIfNegativeOrZero(framesPerSecond);
+
+        _logger.LogInformation("Presenting synthetic frames on the {Plane} plane at {Rate} frames/s",
+            _overlayPresenter != null ? "overlay" : "primary", framesPerSecond);
+
+        var clock = Stopwatch.StartNew();
+        long slot = 0;
+        while (!cancellationToken.IsCancellationRequested && (frameCount == null || slot < frameCount))
+        {
+            var due = TimeSpan.FromSeconds(slot / framesPerSecond);
+            var wait = due - clock.Elapsed;
+            if (wait > TimeSpan.Zero)
+            {
+                Thread.Sleep(wait);
+            }
+
+            // Behind by whole periods: skip their frames rather than present them late
+            long current = (long)(clock.Elapsed.TotalSeconds * framesPerSecond);
+            if (current > slot)
+            {
+                Interlocked.Add(ref _framesLate, current - slot);
+                slot = current;
+                due = TimeSpan.FromSeconds(slot / framesPerSecond);
+            }
+
+            if (PresentFrame(slot, due))
+            {
+                Interlocked.Increment(ref _framesPresented);
+            }
+            else
+            {
+                Interlocked.Increment(ref _framesDropped);
+            }
+
+            slot++;
+        }
+
+        _logger.LogInformation(
+            "Synthetic source stopped after {Elapsed:F1} s: {Presented} frames presented, {Late} late, {Dropped} dropped",
+            clock.Elapsed.TotalSeconds, FramesPresented, FramesLate, FramesDropped);
+    }
+
+    private bool PresentFrame(long frameIndex, TimeSpan timestamp)
+    {
+        if (_primaryPresenter != null)
+        {
+            var backBuffer = _primaryPresenter.GetPrimaryPlaneBackBufferDma();
+            TestPattern.FillAnimated(backBuffer.DmaBuffer.GetMappedSpan(), GetBufferParams(backBuffer),
+                backBuffer.Format, frameIndex, timestamp);
+            return _primaryPresenter.SwapPrimaryPlaneBuffers();
+        }
+
+        foreach (var presented in _overlayPresenter!.GetPresentedOverlayBuffers())
+        {
+            _freeBuffers.Enqueue(presented);
+        }
+
+        if (!_freeBuffers.TryDequeue(out var buffer))
+        {
+            return false;
+        }
+
+        TestPattern.FillAnimated(buffer.DmaBuffer.GetMappedSpan(), GetBufferParams(buffer), buffer.Format, frameIndex,
+            timestamp);
+        buffer.DmaBuffer.SyncMap();
+
+        // On failure the presenter still returns the buffer once the next one is set
+        return _overlayPresenter.SetOverlayPlaneBuffer(buffer);
+    }
+
+    private static BufferParams GetBufferParams(SharedDmaBuffer buffer)
+    {
+        var layout = BuffersInfoProvider.GetBufferParams(buffer.Width, buffer.Height, buffer.Format);
+        return new BufferParams
+        {
+            Width = buffer.Width,
+            Height = buffer.Height,
+            FullSize = layout.FullSize,
+            PlanesCount = layout.PlanesCount,
+            PlaneOffsets = layout.PlaneOffsets,
+            Stride = buffer.Stride > 0 ? buffer.Stride : layout.Stride
+        };
+    }
+}
@@ -1,5 +1,17 @@
+using System.Runtime.InteropServices;
+using SharpVideo.Drm;
+
 namespace SharpVideo.Utils;
 
+/// <summary>
+/// Fills frames with test patterns.
+/// </summary>
+/// <remarks>
+/// Patterns are made of horizontal runs of one color, written with <see cref="Span{T}.Fill"/> on whole pixels, and
+/// rows that repeat are copied, so filling costs about as much as a memset of the frame.
+/// <see cref="FillAnimated"/> moves the bars and burns the frame number and timestamp in, so a camera pointed at the
+/// display shows dropped or repeated frames and, next to a clock, the latency of the display path.
+/// </remarks>
 public static class TestPattern
 {
     // 5 vertical color bars: Red, Green, Blue, Yellow, Cyan
@@ -13,56 +25,125 @@ public static class TestPattern
         (170, 166, 16) // Cyan
     };
 
-    public static void FillYuv422(Span<byte> buffer, int width, int height)
+    // 75% bars in the usual order, for the format independent patterns
+    private static readonly PatternColor[] Bars =
+    [
+        PatternColor.FromRgb(191, 191, 191),
+        PatternColor.FromRgb(191, 191, 0),
+        PatternColor.FromRgb(0, 191, 191),
+        PatternColor.FromRgb(0, 191, 0),
+        PatternColor.FromRgb(191, 0, 191),
+        PatternColor.FromRgb(191, 0, 0),
+        PatternColor.FromRgb(0, 0, 191),
+        PatternColor.FromRgb(16, 16, 16)
+    ];
+
+    private static readonly PatternColor TextColor = PatternColor.FromRgb(255, 255, 255);
+    private static readonly PatternColor TextBackground = PatternColor.FromRgb(0, 0, 0);
+
+    // 5x7 glyphs, one byte per row, bit 4 is the left column
+    private const string GlyphChars = "0123456789:.";
+    private static readonly byte[] Glyphs =
+    [
+        0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E, // 0
+        0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, // 1
+        0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F, // 2
+        0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E, // 3
+        0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02, // 4
+        0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E, // 5
+        0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E, // 6
+        0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, // 7
+        0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, // 8
+        0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C, // 9
+        0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00, // :
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C  // .
+    ];
+
+    private const int GlyphWidth = 5;
+    private const int GlyphHeight = 7;
+
+    /// <summary>
+    /// Formats <see cref="Fill"/> and <see cref="FillAnimated"/> support, the ones of
+    /// <see cref="BuffersInfoProvider"/>.
+    /// </summary>
+    public static bool IsSupported(PixelFormat format)
     {
-        var barWidth = width / ColorBars.Length;
+        return format == KnownPixelFormats.DRM_FORMAT_NV12 ||
+               format == KnownPixelFormats.DRM_FORMAT_NV16 ||
+               format == KnownPixelFormats.DRM_FORMAT_YUYV ||
+               format == KnownPixelFormats.DRM_FORMAT_XRGB8888 ||
+               format == KnownPixelFormats.DRM_FORMAT_ARGB8888 ||
+               format == KnownPixelFormats.DRM_FORMAT_RGB888;
+    }
 
-        for (var y = 0; y < height; y++)
-        {
-            for (var x = 0; x < width; x += 2)
-            {
-                var barIndex = Math.Min(x / barWidth, ColorBars.Length - 1);
-                var color = ColorBars[barIndex];
+    /// <summary>
+    /// Fills a frame with 8 vertical color bars.
+    /// </summary>
+    /// <param name="buffer">The frame.</param>
+    /// <param name="bufferParams">Size, stride and plane offsets of the frame.</param>
+    /// <param name="format">One of the formats of <see cref="IsSupported"/>.</param>
+    public static void Fill(Span<byte> buffer, BufferParams bufferParams, PixelFormat format)
+    {
+        var canvas = new Canvas(buffer, bufferParams, format);
+        DrawBars(canvas, 0);
+    }
 
-                var baseIndex = (y * width + x) * 2;
+    /// <summary>
+    /// Fills a frame with color bars that move by one bar per second at 60 frames/s, with the frame number and the
+    /// timestamp burned in at the top left.
+    /// </summary>
+    /// <param name="buffer">The frame.</param>
+    /// <param name="bufferParams">Size, stride and plane offsets of the frame.</param>
+    /// <param name="format">One of the formats of <see cref="IsSupported"/>.</param>
+    /// <param name="frameIndex">The frame number, moves the bars.</param>
+    /// <param name="timestamp">The time shown below the frame number, e.g. since the start of the stream.</param>
+    public static void FillAnimated(
+        Span<byte> buffer,
+        BufferParams bufferParams,
+        PixelFormat format,
+        long frameIndex,
+        TimeSpan timestamp)
+    {
+        var canvas = new Canvas(buffer, bufferParams, format);
+        int barWidth = Math.Max(canvas.Width / Bars.Length, 1);
+        DrawBars(canvas, (int)(frameIndex * barWidth / 60 % canvas.Width));
 
-                // YUYV format
-                buffer[baseIndex + 0] = color.Y;
-                buffer[baseIndex + 1] = color.U;
-                buffer[baseIndex + 2] = color.Y;
-                buffer[baseIndex + 3] = color.V;
-            }
+        // Large enough to read from a phone camera: 8 pixel dots at 1080p
+        int scale = Math.Max(canvas.Height / 135 & ~1, 2);
+        int margin = 4 * scale;
+        Span<char> text = stackalloc char[16];
+        frameIndex.TryFormat(text, out int counterLength, "D8");
+        DrawText(canvas, text.Slice(0, counterLength), margin, margin, scale);
+        timestamp.TryFormat(text, out int timeLength, @"hh\:mm\:ss\.fff");
+        DrawText(canvas, text.Slice(0, timeLength), margin, margin + (GlyphHeight + 3) * scale, scale);
+    }
+
+    public static void FillYuv422(Span<byte> buffer, int width, int height)
+    {
+        var barWidth = Math.Max(width / ColorBars.Length, 1);
+
+        // YUYV format, one uint per pixel pair; pair x / 2 takes the bar of pixel x
+        var row = MemoryMarshal.Cast<byte, uint>(buffer.Slice(0, width * 2)).Slice(0, width / 2);
+        for (int bar = 0; bar < ColorBars.Length; bar++)
+        {
+            var color = ColorBars[bar];
+            int start = Math.Min((bar * barWidth + 1) / 2, row.Length);
+            int end = bar == ColorBars.Length - 1 ? row.Length : Math.Min(((bar + 1) * barWidth + 1) / 2, row.Length);
+            row.Slice(start, end - start).Fill(PackYuyv(color.Y, color.U, color.V));
         }
+
+        CopyFirstRow(buffer, width * 2, height);
     }
 
     public static void FillXR24(Span<byte> buffer, int width, int height)
     {
-        for (int y = 0; y < height; y++)
-        {
-            for (int x = 0; x < width; x++)
-            {
-                // Simple color bar pattern
-                byte r = 0, g = 0, b = 0;
-                if (x < width / 3)
-                {
-                    r = 255;
-                }
-                else if (x < width * 2 / 3)
-                {
-                    g = 255;
-                }
-                else
-                {
-                    b = 255;
-                }
+        // Simple color bar pattern
+        var row = MemoryMarshal.Cast<byte, uint>(buffer.Slice(0, width * 4));
+        row.Slice(0, width / 3).Fill(PackArgb(255, 0, 0, 0));
+        row.Slice(width / 3, width * 2 / 3 - width / 3).Fill(PackArgb(0, 255, 0, 0));
+        row.Slice(width * 2 / 3).Fill(PackArgb(0, 0, 255, 0));
 
-                int pos = (y * width + x) * 4;
-                buffer[pos] = b; // Blue
-                buffer[pos + 1] = g; // Green
-                buffer[pos + 2] = r; // Red
-                buffer[pos + 3] = 0; // X (unused)
-            }
-        }
+        CopyFirstRow(buffer, width * 4, height);
     }
 
     public static void FillNV12(Span<byte> buffer, int width, int height)
@@ -77,31 +158,25 @@ public static class TestPattern
         var uvPlane = buffer.Slice(yPlaneSize, uvPlaneSize);
 
         // Fill with color bar pattern using standard ITU-R BT.601 values
-        var barWidth = width / ColorBars.Length;
+        var barWidth = Math.Max(width / ColorBars.Length, 1);
 
-        // Fill Y plane
-        for (int y = 0; y < height; y++)
+        // One row of each plane, the UV pair x / 2 takes the bar of pixel x
+        var uvRow = MemoryMarshal.Cast<byte, ushort>(uvPlane.Slice(0, Math.Min(width, uvPlane.Length))).Slice(0, width / 2);
+        for (int bar = 0; bar < ColorBars.Length; bar++)
         {
-            for (int x = 0; x < width; x++)
-            {
-                var barIndex = Math.Min(x / barWidth, ColorBars.Length - 1);
-                var color = ColorBars[barIndex];
-                yPlane[y * width + x] = color.Y;
-            }
-        }
+            var color = ColorBars[bar];
+            bool last = bar == ColorBars.Length - 1;
+            int start = Math.Min(bar * barWidth, width);
+            int end = last ? width : Math.Min((bar + 1) * barWidth, width);
+            yPlane.Slice(start, end - start).Fill(color.Y);
 
-        // Fill UV plane (interleaved, half resolution)
-        for (int y = 0; y < height / 2; y++)
-        {
-            for (int x = 0; x < width / 2; x++)
-            {
-                var barIndex = Math.Min((x * 2) / barWidth, ColorBars.Length - 1);
-                var color = ColorBars[barIndex];
-                int uvIndex = (y * width) + (x * 2);
-                uvPlane[uvIndex] = color.U;
-                uvPlane[uvIndex + 1] = color.V;
-            }
+            start = Math.Min((bar * barWidth + 1) / 2, uvRow.Length);
+            end = last ? uvRow.Length : Math.Min(((bar + 1) * barWidth + 1) / 2, uvRow.Length);
+            uvRow.Slice(start, end - start).Fill((ushort)(color.U | color.V << 8));
         }
+
+        CopyFirstRow(yPlane, width, height);
+        CopyFirstRow(uvPlane, width, height / 2);
     }
 
     /// <summary>
@@ -110,77 +185,288 @@ public static class TestPattern
     /// </summary>
     public static void FillARGB8888(Span<byte> buffer, int width, int height)
     {
-        // Create a pattern with transparent background and semi-transparent/opaque shapes
+        // Rows only differ by which of these bands they are in, build a row when the band changes, copy it otherwise
+        int previousBands = -1;
         for (int y = 0; y < height; y++)
         {
-            for (int x = 0; x < width; x++)
+            bool top = y < height / 4;
+            bool bottom = y >= height * 3 / 4;
+            bool borderRow = y < 10 || y >= height - 10;
+            bool crossRow = y >= height / 2 - 5 && y <= height / 2 + 5;
+            int bands = (top ? 1 : 0) | (bottom ? 2 : 0) | (borderRow ? 4 : 0) | (crossRow ? 8 : 0);
+
+            var row = buffer.Slice(y * width * 4, width * 4);
+            if (bands == previousBands)
             {
-                int pos = (y * width + x) * 4;
-                byte r = 0, g = 0, b = 0, a = 0;
+                buffer.Slice((y - 1) * width * 4, width * 4).CopyTo(row);
+                continue;
+            }
+
+            previousBands = bands;
+            var pixels = MemoryMarshal.Cast<byte, uint>(row);
 
-                // Draw a semi-transparent red rectangle in top-left quarter
-                if (x < width / 4 && y < height / 4)
+            // A white border (opaque) around the edges, a center cross (semi-transparent white), transparent elsewhere
+            if (borderRow)
+            {
+                pixels.Fill(PackArgb(255, 255, 255, 255));
+            }
+            else
+            {
+                pixels.Fill(crossRow ? PackArgb(255, 255, 255, 128) : 0);
+                if (!crossRow)
                 {
-                    r = 255;
-                    g = 0;
-                    b = 0;
-                    a = 192; // 75% opacity
+                    int crossStart = Math.Max(width / 2 - 5, 0);
+                    int crossEnd = Math.Min(width / 2 + 6, width);
+                    pixels.Slice(crossStart, crossEnd - crossStart).Fill(PackArgb(255, 255, 255, 128));
                 }
-                // Draw a semi-transparent green rectangle in top-right quarter
-                else if (x >= width * 3 / 4 && y < height / 4)
+
+                pixels.Slice(0, Math.Min(10, width)).Fill(PackArgb(255, 255, 255, 255));
+                pixels.Slice(Math.Max(width - 10, 0)).Fill(PackArgb(255, 255, 255, 255));
+            }
+
+            // Semi-transparent rectangles in the corner quarters: red and green at the top, blue and yellow at the
+            // bottom, 75% opacity
+            if (top || bottom)
+            {
+                pixels.Slice(width * 3 / 4).Fill(top ? PackArgb(0, 255, 0, 192) : PackArgb(255, 255, 0, 192));
+                pixels.Slice(0, width / 4).Fill(top ? PackArgb(255, 0, 0, 192) : PackArgb(0, 0, 255, 192));
+            }
+        }
+    }
+
+    private static void DrawBars(Canvas canvas, int offset)
+    {
+        // The bars go into the first row, which is then copied down
+        int barWidth = Math.Max(canvas.Width / Bars.Length, 1);
+        for (int bar = 0; bar < Bars.Length; bar++)
+        {
+            int start = bar * barWidth;
+            int end = bar == Bars.Length - 1 ? canvas.Width : start + barWidth;
+
+            // Shifted right by the offset, the part that leaves the frame comes in on the left
+            start += offset;
+            end += offset;
+            if (start >= canvas.Width)
+            {
+                start -= canvas.Width;
+                end -= canvas.Width;
+            }
+
+            canvas.FillRect(start, 0, Math.Min(end, canvas.Width) - start, 1, Bars[bar]);
+            if (end > canvas.Width)
+            {
+                canvas.FillRect(0, 0, end - canvas.Width, 1, Bars[bar]);
+            }
+        }
+
+        canvas.CopyFirstRow();
+    }
+
+    private static void DrawText(Canvas canvas, ReadOnlySpan<char> text, int left, int top, int scale)
+    {
+        int advance = (GlyphWidth + 1) * scale;
+        canvas.FillRect(left - scale, top - scale, text.Length * advance + scale, (GlyphHeight + 2) * scale,
+            TextBackground);
+
+        for (int i = 0; i < text.Length; i++)
+        {
+            int glyph = GlyphChars.IndexOf(text[i]);
+            if (glyph < 0)
+            {
+                continue;
+            }
+
+            for (int row = 0; row < GlyphHeight; row++)
+            {
+                // One rectangle per run of set dots
+                int bits = Glyphs[glyph * GlyphHeight + row];
+                int column = 0;
+                while (column < GlyphWidth)
                 {
-                    r = 0;
-                    g = 255;
-                    b = 0;
-                    a = 192; // 75% opacity
+                    int mask = 1 << (GlyphWidth - 1 - column);
+                    if ((bits & mask) == 0)
+                    {
+                        column++;
+                        continue;
+                    }
+
+                    int runStart = column;
+                    while (column < GlyphWidth && (bits & (1 << (GlyphWidth - 1 - column))) != 0)
+                    {
+                        column++;
+                    }
+
+                    canvas.FillRect(left + i * advance + runStart * scale, top + row * scale,
+                        (column - runStart) * scale, scale, TextColor);
                 }
-                // Draw a semi-transparent blue rectangle in bottom-left quarter
-                else if (x < width / 4 && y >= height * 3 / 4)
+            }
+        }
+    }
+
+    /// <summary>
+    /// Copies the first row of a plane to the others
+    /// </summary>
+    private static void CopyFirstRow(Span<byte> plane, int rowBytes, int rows)
+    {
+        CopyFirstRow(plane, rowBytes, rowBytes, rows);
+    }
+
+    private static void CopyFirstRow(Span<byte> plane, int stride, int rowBytes, int rows)
+    {
+        var first = plane.Slice(0, rowBytes);
+        for (int y = 1; y < rows; y++)
+        {
+            first.CopyTo(plane.Slice(y * stride, rowBytes));
+        }
+    }
+
+    private static uint PackArgb(byte r, byte g, byte b, byte a) => (uint)(b | g << 8 | r << 16 | a << 24);
+
+    private static uint PackYuyv(byte y, byte u, byte v) => (uint)(y | u << 8 | y << 16 | v << 24);
+
+    private readonly record struct PatternColor(byte R, byte G, byte B, byte Y, byte U, byte V)
+    {
+        /// <summary>
+        /// The color with its BT.601 limited range YUV values
+        /// </summary>
+        public static PatternColor FromRgb(byte r, byte g, byte b)
+        {
+            double y = 16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255;
+            double u = 128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255;
+            double v = 128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255;
+            return new PatternColor(r, g, b, (byte)Math.Round(y), (byte)Math.Round(u), (byte)Math.Round(v));
+        }
+    }
+
+    /// <summary>
+    /// Fills rectangles of one color in a frame of any supported format
+    /// </summary>
+    private readonly ref struct Canvas
+    {
+        private readonly Span<byte> _buffer;
+        private readonly PixelFormat _format;
+        private readonly int _stride;
+        private readonly int _chromaOffset;
+        private readonly int _chromaShiftY;
+        private readonly int _bytesPerPixel;
+
+        public Canvas(Span<byte> buffer, BufferParams bufferParams, PixelFormat format)
+        {
+            if (!IsSupported(format))
+            {
+                throw new ArgumentException($"Unsupported format {format.GetName()}", nameof(format));
+            }
+
+            _buffer = buffer;
+            _format = format;
+            Width = (int)bufferParams.Width;
+            Height = (int)bufferParams.Height;
+            _stride = (int)bufferParams.Stride;
+            _chromaOffset = bufferParams.PlanesCount > 1 ? (int)bufferParams.PlaneOffsets[1] : 0;
+            _chromaShiftY = format == KnownPixelFormats.DRM_FORMAT_NV12 ? 1 : 0;
+            _bytesPerPixel = format == KnownPixelFormats.DRM_FORMAT_RGB888 ? 3
+                : format == KnownPixelFormats.DRM_FORMAT_XRGB8888 || format == KnownPixelFormats.DRM_FORMAT_ARGB8888 ? 4
+                : format == KnownPixelFormats.DRM_FORMAT_YUYV ? 2
+                : 1;
+
+            int rows = _chromaOffset > 0 ? (Height + _chromaShiftY) >> _chromaShiftY : 0;
+            long required = Math.Max((long)(Height - 1) * _stride + Width * _bytesPerPixel,
+                rows > 0 ? _chromaOffset + (long)(rows - 1) * _stride + (Width + 1 & ~1) : 0);
+            if (_stride < Width * _bytesPerPixel || buffer.Length < required)
+            {
+                throw new ArgumentException("The buffer is smaller than the frame", nameof(buffer));
+            }
+        }
+
+        public int Width { get; }
+
+        public int Height { get; }
+
+        /// <summary>
+        /// Copies the first row of each plane to the other rows
+        /// </summary>
+        public void CopyFirstRow()
+        {
+            int rowBytes = Width * _bytesPerPixel;
+            TestPattern.CopyFirstRow(_buffer, _stride, rowBytes, Height);
+            if (_chromaOffset > 0)
+            {
+                TestPattern.CopyFirstRow(_buffer.Slice(_chromaOffset), _stride, Width + 1 & ~1,
+                    (Height + _chromaShiftY) >> _chromaShiftY);
+            }
+        }
+
+        public void FillRect(int x, int y, int width, int height, PatternColor color)
+        {
+            int x0 = Math.Max(x, 0);
+            int y0 = Math.Max(y, 0);
+            int x1 = Math.Min(x + width, Width);
+            int y1 = Math.Min(y + height, Height);
+            if (_format != KnownPixelFormats.DRM_FORMAT_XRGB8888 && _format != KnownPixelFormats.DRM_FORMAT_ARGB8888 &&
+                _format != KnownPixelFormats.DRM_FORMAT_RGB888)
+            {
+                // Whole chroma samples: even columns, and even rows for NV12
+                x0 &= ~1;
+                x1 = Math.Min(x1 + 1 & ~1, Width + 1 & ~1);
+                if (_chromaShiftY == 1)
                 {
-                    r = 0;
-                    g = 0;
-                    b = 255;
-                    a = 192; // 75% opacity
+                    y0 &= ~1;
+                    y1 = Math.Min(y1 + 1 & ~1, Height);
                 }
-                // Draw a semi-transparent yellow rectangle in bottom-right quarter
-                else if (x >= width * 3 / 4 && y >= height * 3 / 4)
+            }
+
+            if (x0 >= x1 || y0 >= y1)
+            {
+                return;
+            }
+
+            int count = x1 - x0;
+            if (_format == KnownPixelFormats.DRM_FORMAT_XRGB8888 || _format == KnownPixelFormats.DRM_FORMAT_ARGB8888)
+            {
+                uint pixel = PackArgb(color.R, color.G, color.B, 255);
+                for (int row = y0; row < y1; row++)
                 {
-                    r = 255;
-                    g = 255;
-                    b = 0;
-                    a = 192; // 75% opacity
+                    MemoryMarshal.Cast<byte, uint>(_buffer.Slice(row * _stride + x0 * 4, count * 4)).Fill(pixel);
                 }
-                // Draw a white border (opaque) around the edges
-                else if (x < 10 || x >= width - 10 || y < 10 || y >= height - 10)
+            }
+            else if (_format == KnownPixelFormats.DRM_FORMAT_RGB888)
+            {
+                // B, G, R in memory; the first pixel is written, then the filled part doubles until the run is full
+                for (int row = y0; row < y1; row++)
                 {
-                    r = 255;
-                    g = 255;
-                    b = 255;
-                    a = 255; // 100% opacity
+                    var run = _buffer.Slice(row * _stride + x0 * 3, count * 3);
+                    run[0] = color.B;
+                    run[1] = color.G;
+                    run[2] = color.R;
+                    for (int filled = 3; filled < run.Length; filled *= 2)
+                    {
+                        run.Slice(0, Math.Min(filled, run.Length - filled)).CopyTo(run.Slice(filled));
+                    }
                 }
-                // Center cross pattern (semi-transparent white)
-                else if ((x >= width / 2 - 5 && x <= width / 2 + 5) ||
-                         (y >= height / 2 - 5 && y <= height / 2 + 5))
+            }
+            else if (_format == KnownPixelFormats.DRM_FORMAT_YUYV)
+            {
+                // An odd last column has no pair of its own
+                uint pair = PackYuyv(color.Y, color.U, color.V);
+                int pairs = (Math.Min(x1, Width & ~1) - x0) / 2;
+                for (int row = y0; row < y1 && pairs > 0; row++)
                 {
-                    r = 255;
-                    g = 255;
-                    b = 255;
-                    a = 128; // 50% opacity
+                    MemoryMarshal.Cast<byte, uint>(_buffer.Slice(row * _stride + x0 * 2, pairs * 4)).Fill(pair);
                 }
-                // Rest is fully transparent
-                else
+            }
+            else
+            {
+                // NV12 and NV16
+                for (int row = y0; row < y1; row++)
                 {
-                    r = 0;
-                    g = 0;
-                    b = 0;
-                    a = 0; // Fully transparent
+                    _buffer.Slice(row * _stride + x0, Math.Min(count, Width - x0)).Fill(color.Y);
                 }
 
-                // ARGB8888 format: B, G, R, A
-                buffer[pos] = b;
-                buffer[pos + 1] = g;
-                buffer[pos + 2] = r;
-                buffer[pos + 3] = a;
+                ushort uv = (ushort)(color.U | color.V << 8);
+                for (int row = y0 >> _chromaShiftY; row < (y1 + _chromaShiftY) >> _chromaShiftY; row++)
+                {
+                    MemoryMarshal.Cast<byte, ushort>(_buffer.Slice(_chromaOffset + row * _stride + x0, count)).Fill(uv);
+                }
             }
         }
     }
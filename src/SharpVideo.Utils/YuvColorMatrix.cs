@@ -0,0 +1,18 @@
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// The matrix a YUV frame was encoded with, see the colour description of the stream (matrix_coefficients in the
+/// H.264 VUI).
+/// </summary>
+public enum YuvColorMatrix
+{
+    /// <summary>
+    /// ITU-R BT.601, standard definition video and most JPEGs.
+    /// </summary>
+    Bt601,
+
+    /// <summary>
+    /// ITU-R BT.709, high definition video.
+    /// </summary>
+    Bt709
+}
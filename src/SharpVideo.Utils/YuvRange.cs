@@ -0,0 +1,17 @@
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// The value range of a YUV frame, see video_full_range_flag in the H.264 VUI.
+/// </summary>
+public enum YuvRange
+{
+    /// <summary>
+    /// Y in [16, 235] and U, V in [16, 240], what cameras and encoders produce unless told otherwise.
+    /// </summary>
+    Limited,
+
+    /// <summary>
+    /// Y, U and V use all of [0, 255].
+    /// </summary>
+    Full
+}
@@ -0,0 +1,566 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.Intrinsics;
+using SharpVideo.Drm;
+
+namespace SharpVideo.Utils;
+
+/// <summary>
+/// Converts decoded or captured YUV frames (NV12, NV16 and YUYV) to packed RGB, e.g. for thumbnails and snapshots.
+/// </summary>
+/// <remarks>
+/// Rows are converted 16 pixels at a time: chroma is duplicated to both pixels of a pair with integer shifts, the
+/// matrix is applied in 16.16 fixed point on Vector256 where the CPU has it and on Vector128 otherwise, and the
+/// result is packed as BGRX words that are stored as is or shuffled into 3 byte pixels. The scalar path for the last
+/// pixels of a row uses the same arithmetic, so the output does not depend on the instruction set.
+/// Frames with enough rows are split into bands that are converted in parallel.
+/// Supported destinations are DRM_FORMAT_XRGB8888 and DRM_FORMAT_ARGB8888 (bytes B, G, R, X/A),
+/// DRM_FORMAT_BGR888 (bytes R, G, B, what image libraries call RGB24) and DRM_FORMAT_RGB888 (bytes B, G, R).
+/// </remarks>
+public static class YuvToRgbConverter
+{
+    private const int FractionBits = 16;
+    private const int Rounding = 1 << (FractionBits - 1);
+    private const int Opaque = unchecked((int)0xFF000000);
+
+    /// <summary>
+    /// Bands smaller than this cost more to schedule than they gain from running on another core.
+    /// </summary>
+    private const int MinRowsPerBand = 32;
+
+    private static readonly Coefficients[] CoefficientTable =
+    [
+        Coefficients.Create(0.299, 0.114, YuvRange.Limited),
+        Coefficients.Create(0.299, 0.114, YuvRange.Full),
+        Coefficients.Create(0.2126, 0.0722, YuvRange.Limited),
+        Coefficients.Create(0.2126, 0.0722, YuvRange.Full),
+    ];
+
+    /// <summary>
+    /// True if frames of <paramref name="format"/> can be converted.
+    /// </summary>
+    public static bool IsSupportedSource(PixelFormat format)
+    {
+        return format == KnownPixelFormats.DRM_FORMAT_NV12 ||
+               format == KnownPixelFormats.DRM_FORMAT_NV16 ||
+               format == KnownPixelFormats.DRM_FORMAT_YUYV;
+    }
+
+    /// <summary>
+    /// Size of a destination pixel in bytes, 0 if <paramref name="format"/> is not a supported destination.
+    /// </summary>
+    public static int GetBytesPerPixel(PixelFormat format)
+    {
+        if (format == KnownPixelFormats.DRM_FORMAT_XRGB8888 || format == KnownPixelFormats.DRM_FORMAT_ARGB8888)
+        {
+            return 4;
+        }
+
+        if (format == KnownPixelFormats.DRM_FORMAT_BGR888 || format == KnownPixelFormats.DRM_FORMAT_RGB888)
+        {
+            return 3;
+        }
+
+        return 0;
+    }
+
+    /// <summary>
+    /// Converts a frame.
+    /// </summary>
+    /// <param name="source">The frame, laid out as described by <paramref name="sourceParams"/>.</param>
+    /// <param name="sourceParams">Size, luma stride and plane offsets of the frame. The chroma plane of NV12 and NV16
+    /// has the stride of the luma plane.</param>
+    /// <param name="sourceFormat">NV12, NV16 or YUYV.</param>
+    /// <param name="destination">Receives the RGB pixels.</param>
+    /// <param name="destinationStride">Bytes per destination row.</param>
+    /// <param name="destinationFormat">Layout of the RGB pixels, see the remarks.</param>
+    /// <param name="matrix">Matrix the frame was encoded with.</param>
+    /// <param name="range">Value range of the frame.</param>
+    /// <param name="maxDegreeOfParallelism">Maximum number of threads, -1 for all cores, 1 to convert on the calling
+    /// thread only.</param>
+    public static void Convert(
+        ReadOnlySpan<byte> source,
+        BufferParams sourceParams,
+        PixelFormat sourceFormat,
+        Span<byte> destination,
+        int destinationStride,
+        PixelFormat destinationFormat,
+        YuvColorMatrix matrix = YuvColorMatrix.Bt601,
+        YuvRange range = YuvRange.Limited,
+        int maxDegreeOfParallelism = -1)
+    {
+        var layout = SourceLayout.Create(sourceParams, sourceFormat);
+        if (layout.Width == 0 || layout.Height == 0)
+        {
+            return;
+        }
+
+        if (source.Length < layout.RequiredLength)
+        {
+            throw new ArgumentException(
+                $"Source has {source.Length} bytes, a {layout.Width}x{layout.Height} frame needs {layout.RequiredLength}",
+                nameof(source));
+        }
+
+        int bytesPerPixel = GetBytesPerPixel(destinationFormat);
+        if (bytesPerPixel == 0)
+        {
+            throw new ArgumentException($"Unsupported destination format {destinationFormat}", nameof(destinationFormat));
+        }
+
+        ArgumentOutOfRangeException.ThrowIfLessThan(destinationStride, layout.Width * bytesPerPixel);
+        long requiredDestination = (long)(layout.Height - 1) * destinationStride + layout.Width * bytesPerPixel;
+        if (destination.Length < requiredDestination)
+        {
+            throw new ArgumentException(
+                $"Destination has {destination.Length} bytes, {requiredDestination} are needed", nameof(destination));
+        }
+
+        var coefficients = GetCoefficients(matrix, range);
+        int threads = maxDegreeOfParallelism > 0 ? maxDegreeOfParallelism : Environment.ProcessorCount;
+        int bands = Math.Clamp(layout.Height / MinRowsPerBand, 1, threads);
+
+        if (destinationFormat == KnownPixelFormats.DRM_FORMAT_BGR888)
+        {
+            ConvertBands<Rgb24Store>(source, layout, destination, destinationStride, coefficients, bands);
+        }
+        else if (destinationFormat == KnownPixelFormats.DRM_FORMAT_RGB888)
+        {
+            ConvertBands<Bgr24Store>(source, layout, destination, destinationStride, coefficients, bands);
+        }
+        else
+        {
+            ConvertBands<Bgrx32Store>(source, layout, destination, destinationStride, coefficients, bands);
+        }
+    }
+
+    internal static Coefficients GetCoefficients(YuvColorMatrix matrix, YuvRange range)
+    {
+        return CoefficientTable[(int)matrix * 2 + (int)range];
+    }
+
+    private static unsafe void ConvertBands<TStore>(
+        ReadOnlySpan<byte> source,
+        SourceLayout layout,
+        Span<byte> destination,
+        int destinationStride,
+        Coefficients coefficients,
+        int bands)
+        where TStore : struct, IPixelStore
+    {
+        if (bands == 1)
+        {
+            ConvertRows<TStore>(source, layout, destination, destinationStride, coefficients, 0, layout.Height);
+            return;
+        }
+
+        fixed (byte* sourcePointer = source)
+        fixed (byte* destinationPointer = destination)
+        {
+            // Spans cannot be captured, the pointers stay valid because Parallel.For returns after the last band
+            nint sourceAddress = (nint)sourcePointer;
+            nint destinationAddress = (nint)destinationPointer;
+            int sourceLength = source.Length;
+            int destinationLength = destination.Length;
+
+            Parallel.For(0, bands, band =>
+            {
+                int firstRow = (int)((long)layout.Height * band / bands);
+                int endRow = (int)((long)layout.Height * (band + 1) / bands);
+                ConvertRows<TStore>(
+                    new ReadOnlySpan<byte>((void*)sourceAddress, sourceLength),
+                    layout,
+                    new Span<byte>((void*)destinationAddress, destinationLength),
+                    destinationStride,
+                    coefficients,
+                    firstRow,
+                    endRow - firstRow);
+            });
+        }
+    }
+
+    private static void ConvertRows<TStore>(
+        ReadOnlySpan<byte> source,
+        SourceLayout layout,
+        Span<byte> destination,
+        int destinationStride,
+        in Coefficients coefficients,
+        int firstRow,
+        int rowCount)
+        where TStore : struct, IPixelStore
+    {
+        int rowBytes = layout.Width * TStore.BytesPerPixel;
+        for (int row = firstRow; row < firstRow + rowCount; row++)
+        {
+            var destinationRow = destination.Slice(row * destinationStride, rowBytes);
+            var lumaRow = source.Slice(row * layout.Stride);
+            if (layout.IsPacked)
+            {
+                ConvertYuyvRow<TStore>(lumaRow, destinationRow, layout.Width, coefficients);
+            }
+            else
+            {
+                var chromaRow = source.Slice(layout.ChromaOffset + (row >> layout.ChromaRowShift) * layout.Stride);
+                ConvertSemiPlanarRow<TStore>(lumaRow, chromaRow, destinationRow, layout.Width, coefficients);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Converts a row of NV12 or NV16: a luma row and a row of interleaved U, V pairs shared by two pixels each.
+    /// </summary>
+    private static void ConvertSemiPlanarRow<TStore>(
+        ReadOnlySpan<byte> lumaRow,
+        ReadOnlySpan<byte> chromaRow,
+        Span<byte> destinationRow,
+        int width,
+        in Coefficients coefficients)
+        where TStore : struct, IPixelStore
+    {
+        ref byte luma = ref MemoryMarshal.GetReference(lumaRow);
+        ref byte chroma = ref MemoryMarshal.GetReference(chromaRow);
+        ref byte destination = ref MemoryMarshal.GetReference(destinationRow);
+
+        int x = 0;
+        if (Vector128.IsHardwareAccelerated)
+        {
+            for (; x <= width - 16; x += 16)
+            {
+                var y = Vector128.LoadUnsafe(ref luma, (nuint)x);
+                var uv = Vector128.LoadUnsafe(ref chroma, (nuint)x).AsUInt16();
+                Convert8<TStore>(
+                    Vector128.WidenLower(y),
+                    DuplicatePairs(Vector128.WidenLower(uv)),
+                    ref Unsafe.Add(ref destination, x * TStore.BytesPerPixel),
+                    coefficients);
+                Convert8<TStore>(
+                    Vector128.WidenUpper(y),
+                    DuplicatePairs(Vector128.WidenUpper(uv)),
+                    ref Unsafe.Add(ref destination, (x + 8) * TStore.BytesPerPixel),
+                    coefficients);
+            }
+        }
+
+        for (; x < width; x++)
+        {
+            int pair = x & ~1;
+            TStore.Store(
+                ToBgrx(lumaRow[x], chromaRow[pair], chromaRow[pair + 1], coefficients),
+                ref Unsafe.Add(ref destination, x * TStore.BytesPerPixel));
+        }
+    }
+
+    /// <summary>
+    /// Converts a row of YUYV: Y0 U Y1 V for every pair of pixels.
+    /// </summary>
+    private static void ConvertYuyvRow<TStore>(
+        ReadOnlySpan<byte> sourceRow,
+        Span<byte> destinationRow,
+        int width,
+        in Coefficients coefficients)
+        where TStore : struct, IPixelStore
+    {
+        ref byte source = ref MemoryMarshal.GetReference(sourceRow);
+        ref byte destination = ref MemoryMarshal.GetReference(destinationRow);
+
+        int x = 0;
+        if (Vector128.IsHardwareAccelerated)
+        {
+            for (; x <= width - 8; x += 8)
+            {
+                var pixels = Vector128.LoadUnsafe(ref source, (nuint)(x * 2));
+                var y = pixels.AsUInt16() & Vector128.Create((ushort)0xFF);
+                var pairs = pixels.AsUInt32();
+                var uv = (Vector128.ShiftRightLogical(pairs, 8) & Vector128.Create(0xFFu)) |
+                         (Vector128.ShiftRightLogical(pairs, 16) & Vector128.Create(0xFF00u));
+                Convert8<TStore>(
+                    y,
+                    DuplicatePairs(uv),
+                    ref Unsafe.Add(ref destination, x * TStore.BytesPerPixel),
+                    coefficients);
+            }
+        }
+
+        for (; x < width; x++)
+        {
+            int pair = (x & ~1) * 2;
+            TStore.Store(
+                ToBgrx(sourceRow[x * 2], sourceRow[pair + 1], sourceRow[pair + 3], coefficients),
+                ref Unsafe.Add(ref destination, x * TStore.BytesPerPixel));
+        }
+    }
+
+    /// <summary>
+    /// Turns 4 chroma pairs, U in the low and V in the high byte of each 16 bit half word, into the 8 pairs of the
+    /// pixels that share them.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    private static Vector128<ushort> DuplicatePairs(Vector128<uint> pairs)
+    {
+        return (pairs | Vector128.ShiftLeft(pairs, 16)).AsUInt16();
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    private static void Convert8<TStore>(
+        Vector128<ushort> y,
+        Vector128<ushort> uv,
+        ref byte destination,
+        in Coefficients coefficients)
+        where TStore : struct, IPixelStore
+    {
+        var u = uv & Vector128.Create((ushort)0xFF);
+        var v = Vector128.ShiftRightLogical(uv, 8);
+
+        if (Vector256.IsHardwareAccelerated)
+        {
+            TStore.Store(ToBgrx(Widen(y), Widen(u), Widen(v), coefficients), ref destination);
+            return;
+        }
+
+        TStore.Store(
+            ToBgrx(
+                Vector128.WidenLower(y).AsInt32(),
+                Vector128.WidenLower(u).AsInt32(),
+                Vector128.WidenLower(v).AsInt32(),
+                coefficients),
+            ref destination);
+        TStore.Store(
+            ToBgrx(
+                Vector128.WidenUpper(y).AsInt32(),
+                Vector128.WidenUpper(u).AsInt32(),
+                Vector128.WidenUpper(v).AsInt32(),
+                coefficients),
+            ref Unsafe.Add(ref destination, 4 * TStore.BytesPerPixel));
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    private static Vector256<int> Widen(Vector128<ushort> value)
+    {
+        return Vector256.Create(Vector128.WidenLower(value), Vector128.WidenUpper(value)).AsInt32();
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    internal static Vector256<int> ToBgrx(Vector256<int> y, Vector256<int> u, Vector256<int> v, in Coefficients k)
+    {
+        var luma = (y - Vector256.Create(k.YOffset)) * k.Y + Vector256.Create(Rounding);
+        u -= Vector256.Create(128);
+        v -= Vector256.Create(128);
+
+        var r = Clamp(Vector256.ShiftRightArithmetic(luma + v * k.RV, FractionBits));
+        var g = Clamp(Vector256.ShiftRightArithmetic(luma - u * k.GU - v * k.GV, FractionBits));
+        var b = Clamp(Vector256.ShiftRightArithmetic(luma + u * k.BU, FractionBits));
+        return b | Vector256.ShiftLeft(g, 8) | Vector256.ShiftLeft(r, 16) | Vector256.Create(Opaque);
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    internal static Vector128<int> ToBgrx(Vector128<int> y, Vector128<int> u, Vector128<int> v, in Coefficients k)
+    {
+        var luma = (y - Vector128.Create(k.YOffset)) * k.Y + Vector128.Create(Rounding);
+        u -= Vector128.Create(128);
+        v -= Vector128.Create(128);
+
+        var r = Clamp(Vector128.ShiftRightArithmetic(luma + v * k.RV, FractionBits));
+        var g = Clamp(Vector128.ShiftRightArithmetic(luma - u * k.GU - v * k.GV, FractionBits));
+        var b = Clamp(Vector128.ShiftRightArithmetic(luma + u * k.BU, FractionBits));
+        return b | Vector128.ShiftLeft(g, 8) | Vector128.ShiftLeft(r, 16) | Vector128.Create(Opaque);
+    }
+
+    internal static int ToBgrx(int y, int u, int v, in Coefficients k)
+    {
+        int luma = (y - k.YOffset) * k.Y + Rounding;
+        u -= 128;
+        v -= 128;
+
+        int r = Math.Clamp((luma + v * k.RV) >> FractionBits, 0, 255);
+        int g = Math.Clamp((luma - u * k.GU - v * k.GV) >> FractionBits, 0, 255);
+        int b = Math.Clamp((luma + u * k.BU) >> FractionBits, 0, 255);
+        return b | (g << 8) | (r << 16) | Opaque;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    private static Vector256<int> Clamp(Vector256<int> value)
+    {
+        return Vector256.Min(Vector256.Max(value, Vector256<int>.Zero), Vector256.Create(255));
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    private static Vector128<int> Clamp(Vector128<int> value)
+    {
+        return Vector128.Min(Vector128.Max(value, Vector128<int>.Zero), Vector128.Create(255));
+    }
+
+    /// <summary>
+    /// Where the planes of a source frame are.
+    /// </summary>
+    private readonly record struct SourceLayout(
+        int Width,
+        int Height,
+        int Stride,
+        int ChromaOffset,
+        int ChromaRowShift,
+        bool IsPacked,
+        long RequiredLength)
+    {
+        public static SourceLayout Create(BufferParams bufferParams, PixelFormat format)
+        {
+            int width = (int)bufferParams.Width;
+            int height = (int)bufferParams.Height;
+            int stride = (int)bufferParams.Stride;
+
+            // Chroma is shared by pairs of pixels, the pair of an odd last pixel is read in full
+            int pairedWidth = (width + 1) & ~1;
+
+            if (format == KnownPixelFormats.DRM_FORMAT_YUYV)
+            {
+                ArgumentOutOfRangeException.ThrowIfLessThan(stride, pairedWidth * 2, nameof(bufferParams));
+                return new SourceLayout(width, height, stride, 0, 0, true,
+                    (long)Math.Max(height - 1, 0) * stride + pairedWidth * 2);
+            }
+
+            int chromaRowShift;
+            if (format == KnownPixelFormats.DRM_FORMAT_NV12)
+            {
+                chromaRowShift = 1;
+            }
+            else if (format == KnownPixelFormats.DRM_FORMAT_NV16)
+            {
+                chromaRowShift = 0;
+            }
+            else
+            {
+                throw new ArgumentException($"Unsupported source format {format}", nameof(format));
+            }
+
+            if (bufferParams.PlanesCount < 2)
+            {
+                throw new ArgumentException($"{format} needs the offset of the chroma plane", nameof(bufferParams));
+            }
+
+            ArgumentOutOfRangeException.ThrowIfLessThan(stride, pairedWidth, nameof(bufferParams));
+            int chromaOffset = (int)bufferParams.PlaneOffsets[1];
+            int chromaRows = (height + chromaRowShift) >> chromaRowShift;
+            long lumaEnd = (long)Math.Max(height - 1, 0) * stride + width;
+            long chromaEnd = chromaOffset + (long)Math.Max(chromaRows - 1, 0) * stride + pairedWidth;
+            return new SourceLayout(width, height, stride, chromaOffset, chromaRowShift, false,
+                Math.Max(lumaEnd, chromaEnd));
+        }
+    }
+
+    /// <summary>
+    /// Fixed point factors of the conversion, with the range scaling folded in.
+    /// </summary>
+    internal readonly record struct Coefficients(int YOffset, int Y, int RV, int GU, int GV, int BU)
+    {
+        public static Coefficients Create(double kr, double kb, YuvRange range)
+        {
+            double kg = 1 - kr - kb;
+            bool limited = range == YuvRange.Limited;
+            double yScale = limited ? 255.0 / 219 : 1;
+            double chromaScale = limited ? 255.0 / 224 : 1;
+
+            return new Coefficients(
+                limited ? 16 : 0,
+                ToFixed(yScale),
+                ToFixed(2 * (1 - kr) * chromaScale),
+                ToFixed(2 * kb * (1 - kb) / kg * chromaScale),
+                ToFixed(2 * kr * (1 - kr) / kg * chromaScale),
+                ToFixed(2 * (1 - kb) * chromaScale));
+        }
+
+        private static int ToFixed(double value) => (int)Math.Round(value * (1 << FractionBits));
+    }
+
+    /// <summary>
+    /// Writes BGRX words, see <see cref="ToBgrx(int, int, int, in Coefficients)"/>, in one destination layout.
+    /// </summary>
+    private interface IPixelStore
+    {
+        static abstract int BytesPerPixel { get; }
+
+        static abstract void Store(int bgrx, ref byte destination);
+
+        static abstract void Store(Vector128<int> bgrx, ref byte destination);
+
+        static abstract void Store(Vector256<int> bgrx, ref byte destination);
+    }
+
+    /// <summary>
+    /// Bytes B, G, R, X: DRM_FORMAT_XRGB8888 and, with opaque alpha, DRM_FORMAT_ARGB8888.
+    /// </summary>
+    private readonly struct Bgrx32Store : IPixelStore
+    {
+        public static int BytesPerPixel => 4;
+
+        public static void Store(int bgrx, ref byte destination) => Unsafe.WriteUnaligned(ref destination, bgrx);
+
+        public static void Store(Vector128<int> bgrx, ref byte destination) => bgrx.AsByte().StoreUnsafe(ref destination);
+
+        public static void Store(Vector256<int> bgrx, ref byte destination) => bgrx.AsByte().StoreUnsafe(ref destination);
+    }
+
+    /// <summary>
+    /// Bytes R, G, B: DRM_FORMAT_BGR888.
+    /// </summary>
+    private readonly struct Rgb24Store : IPixelStore
+    {
+        public static int BytesPerPixel => 3;
+
+        public static void Store(int bgrx, ref byte destination)
+        {
+            destination = (byte)(bgrx >> 16);
+            Unsafe.Add(ref destination, 1) = (byte)(bgrx >> 8);
+            Unsafe.Add(ref destination, 2) = (byte)bgrx;
+        }
+
+        public static void Store(Vector128<int> bgrx, ref byte destination)
+        {
+            StorePacked(
+                Vector128.Shuffle(bgrx.AsByte(), Vector128.Create((byte)2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 0, 0, 0, 0)),
+                ref destination);
+        }
+
+        public static void Store(Vector256<int> bgrx, ref byte destination)
+        {
+            Store(bgrx.GetLower(), ref destination);
+            Store(bgrx.GetUpper(), ref Unsafe.Add(ref destination, 12));
+        }
+    }
+
+    /// <summary>
+    /// Bytes B, G, R: DRM_FORMAT_RGB888.
+    /// </summary>
+    private readonly struct Bgr24Store : IPixelStore
+    {
+        public static int BytesPerPixel => 3;
+
+        public static void Store(int bgrx, ref byte destination)
+        {
+            destination = (byte)bgrx;
+            Unsafe.Add(ref destination, 1) = (byte)(bgrx >> 8);
+            Unsafe.Add(ref destination, 2) = (byte)(bgrx >> 16);
+        }
+
+        public static void Store(Vector128<int> bgrx, ref byte destination)
+        {
+            StorePacked(
+                Vector128.Shuffle(bgrx.AsByte(), Vector128.Create((byte)0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0, 0, 0, 0)),
+                ref destination);
+        }
+
+        public static void Store(Vector256<int> bgrx, ref byte destination)
+        {
+            Store(bgrx.GetLower(), ref destination);
+            Store(bgrx.GetUpper(), ref Unsafe.Add(ref destination, 12));
+        }
+    }
+
+    /// <summary>
+    /// Stores the first 12 bytes of <paramref name="packed"/>, the pixels of a row may end right behind them.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    private static void StorePacked(Vector128<byte> packed, ref byte destination)
+    {
+        Unsafe.WriteUnaligned(ref destination, packed.AsUInt64().ToScalar());
+        Unsafe.WriteUnaligned(ref Unsafe.Add(ref destination, 8), packed.AsUInt32().GetElement(2));
+    }
+}
@@ -133,6 +133,26 @@ public class BitBuffer
         return ReadBits(sizeof(UInt32) * 8, out val);
     }
 
+    /// <summary>
+    /// Reads |byte_count| bytes from a byte aligned offset without copying
+    /// them. The returned memory shares the source bytes.
+    /// </summary>
+    /// <returns>
+    /// false if the offset is not byte aligned or there aren't enough bytes left
+    /// </returns>
+    public bool ReadBytes(int byte_count, out ReadOnlyMemory<byte> val)
+    {
+        if (_bitOffset != 0 || byte_count < 0 || byte_count > _byteCount - _byteOffset)
+        {
+            val = ReadOnlyMemory<byte>.Empty;
+            return false;
+        }
+
+        val = _bytes.Slice(_byteOffset, byte_count);
+        _byteOffset += byte_count;
+        return true;
+    }
+
     /// <summary>
     /// Reads bit-sized values from the buffer.
     /// </summary>
@@ -0,0 +1,301 @@
+﻿using System.Diagnostics;
+
+namespace SharpVideo.H264;
+
+/// <summary>
+/// The writable counterpart of BitBuffer, with write methods symmetric to its
+/// read methods. Writes into a caller provided buffer and fails instead of
+/// growing it.
+/// Sizes/counts specify bits/bytes, for clarity.
+/// Byte order is assumed big-endian/network.
+/// </summary>
+public class BitBufferWriter
+{
+    private readonly Memory<byte> _bytes;
+
+    // The total size of |bytes_|.
+    private readonly int _byteCount;
+
+    // The current offset, in bytes, from the start of |bytes_|.
+    private int _byteOffset;
+
+    // The current offset, in bits, into the current byte.
+    private int _bitOffset;
+
+    public BitBufferWriter(Memory<byte> bytes)
+    {
+        _bytes = bytes;
+        _byteCount = bytes.Length;
+    }
+
+    /// <summary>
+    /// Counts the number of bits used in the binary representation of val.
+    /// </summary>
+    private static int CountBits(UInt64 val)
+    {
+        int bit_count = 0;
+        while (val != 0)
+        {
+            bit_count++;
+            val >>= 1;
+        }
+
+        return bit_count;
+    }
+
+    /// <summary>
+    /// Returns the highest byte of |val| in a byte.
+    /// </summary>
+    private static byte HighestByte(UInt64 val)
+    {
+        return (byte)(val >> 56);
+    }
+
+    /// <summary>
+    /// Returns the result of writing partial data from |source|, of
+    /// |source_bit_count| size in the highest bits, to |target| at
+    /// |target_bit_offset| from the highest bit.
+    /// </summary>
+    private static byte WritePartialByte(byte source, int source_bit_count, byte target, int target_bit_offset)
+    {
+        Debug.Assert(target_bit_offset < 8);
+        Debug.Assert(source_bit_count < 9);
+        Debug.Assert(source_bit_count <= (8 - target_bit_offset));
+
+        // Generate a mask for just the bits we're going to overwrite, so:
+        // The number of bits we want, in the most significant bits...
+        // ...shifted over to the target offset from the most signficant bit.
+        byte mask = (byte)((byte)(0xFF << (8 - source_bit_count)) >> target_bit_offset);
+
+        // We want the target, with the bits we'll overwrite masked off, or'ed with
+        // the bits from the source we want.
+        return (byte)((target & ~mask) | (source >> target_bit_offset));
+    }
+
+    /// <summary>
+    /// Gets the current offset, in bytes/bits, from the start of the buffer. The
+    /// bit offset is the offset into the current byte, in the range [0,7].
+    /// </summary>
+    public void GetCurrentOffset(out int out_byte_offset, out int out_bit_offset)
+    {
+        out_byte_offset = _byteOffset;
+        out_bit_offset = _bitOffset;
+    }
+
+    /// <summary>
+    /// The remaining bits in the byte buffer.
+    /// </summary>
+    public long RemainingBitCount()
+    {
+        return (_byteCount - _byteOffset) * 8 - _bitOffset;
+    }
+
+    /// <summary>
+    /// Number of bytes written so far, a partially written last byte included.
+    /// </summary>
+    public int WrittenByteCount()
+    {
+        return _byteOffset + (_bitOffset == 0 ? 0 : 1);
+    }
+
+    /// <summary>
+    /// Moves current position |byte_count| bytes forward.
+    /// </summary>
+    /// <returns>Returns false if there aren't enough bytes left in the buffer.</returns>
+    public bool ConsumeBytes(int byte_count)
+    {
+        return ConsumeBits(byte_count * 8);
+    }
+
+    /// <summary>
+    /// Moves current position |bit_count| bits forward
+    /// </summary>
+    /// <returns>Returns false if there aren't enough bits left in the buffer.</returns>
+    public bool ConsumeBits(int bit_count)
+    {
+        if (bit_count > RemainingBitCount())
+        {
+            return false;
+        }
+
+        _byteOffset += (_bitOffset + bit_count) / 8;
+        _bitOffset = (_bitOffset + bit_count) % 8;
+        return true;
+    }
+
+    // Sets the current offset to the provied byte/bit offsets. The bit
+    // offset is from the given byte, in the range [0,7].
+    public bool Seek(int byte_offset, int bit_offset)
+    {
+        if (byte_offset > _byteCount || bit_offset > 7 || (byte_offset == _byteCount && bit_offset > 0))
+        {
+            return false;
+        }
+
+        _byteOffset = byte_offset;
+        _bitOffset = bit_offset;
+        return true;
+    }
+
+    /// <summary>
+    /// Writes byte-sized values to the buffer.
+    /// </summary>
+    /// <returns>false if there isn't enough room left for the specified type</returns>
+    public bool WriteUInt8(byte val)
+    {
+        return WriteBits(val, sizeof(byte) * 8);
+    }
+
+    /// <summary>
+    /// Writes byte-sized values to the buffer.
+    /// </summary>
+    /// <returns>false if there isn't enough room left for the specified type</returns>
+    public bool WriteUInt16(UInt16 val)
+    {
+        return WriteBits(val, sizeof(UInt16) * 8);
+    }
+
+    /// <summary>
+    /// Writes byte-sized values to the buffer.
+    /// </summary>
+    /// <returns>false if there isn't enough room left for the specified type</returns>
+    public bool WriteUInt32(UInt32 val)
+    {
+        return WriteBits(val, sizeof(UInt32) * 8);
+    }
+
+    /// <summary>
+    /// Writes bit-sized values to the buffer.
+    /// </summary>
+    /// <param name="val">Value, only its lowest |bit_count| bits are written</param>
+    /// <param name="bit_count">Number of bits, at most 64</param>
+    /// <returns>false if there isn't enough room left for the specified bit count.</returns>
+    public bool WriteBits(UInt64 val, int bit_count)
+    {
+        if (bit_count > RemainingBitCount() || bit_count > 64)
+        {
+            return false;
+        }
+
+        if (bit_count == 0)
+        {
+            return true;
+        }
+
+        int total_bits = bit_count;
+
+        // For simplicity, push the bits we want to read from val to the highest bits.
+        val <<= (sizeof(UInt64) * 8 - bit_count);
+
+        var bytes = _bytes.Span;
+        int byteIndex = _byteOffset;
+
+        // The first byte is relatively special; the bit offset to write to may put us
+        // in the middle of the byte, and the total bit count to write may require we
+        // save the bits at the end of the byte.
+        int remaining_bits_in_current_byte = 8 - _bitOffset;
+        int bits_in_first_byte = Math.Min(bit_count, remaining_bits_in_current_byte);
+        bytes[byteIndex] = WritePartialByte(HighestByte(val), bits_in_first_byte, bytes[byteIndex], _bitOffset);
+        if (bit_count <= remaining_bits_in_current_byte)
+        {
+            // Nothing left to write, so quit early.
+            return ConsumeBits(total_bits);
+        }
+
+        // Subtract what we've written from the bit count, shift it off the value, and
+        // write the remaining full bytes.
+        val <<= bits_in_first_byte;
+        byteIndex++;
+        bit_count -= bits_in_first_byte;
+        while (bit_count >= 8)
+        {
+            bytes[byteIndex++] = HighestByte(val);
+            val <<= 8;
+            bit_count -= 8;
+        }
+
+        // Last byte may also be partial, so write the remaining bits from the top of val.
+        if (bit_count > 0)
+        {
+            bytes[byteIndex] = WritePartialByte(HighestByte(val), bit_count, bytes[byteIndex], 0);
+        }
+
+        // All done! Consume the bits we've written.
+        return ConsumeBits(total_bits);
+    }
+
+    /// <summary>
+    /// Writes value in range [0, num_values - 1], see
+    /// <see cref="BitBuffer.ReadNonSymmetric"/> for the encoding.
+    /// </summary>
+    /// <returns>Returns false if there isn't enough room left.</returns>
+    public bool WriteNonSymmetric(uint val, uint numValues)
+    {
+        Debug.Assert(val < numValues);
+        Debug.Assert(numValues <= (uint)1 << 31);
+
+        if (numValues == 1)
+        {
+            // When there is only one possible value, it requires zero bits to store it.
+            // But WriteBits doesn't support writing zero bits.
+            return true;
+        }
+
+        int countBits = CountBits(numValues);
+        uint numMinBitsValues = ((uint)1 << countBits) - numValues;
+
+        return val < numMinBitsValues
+            ? WriteBits(val, countBits - 1)
+            : WriteBits(val + numMinBitsValues, countBits);
+    }
+
+    /// <summary>
+    /// Writes the exponential golomb encoded version of the supplied value, see
+    /// <see cref="BitBuffer.ReadExponentialGolomb"/> for the encoding.
+    /// </summary>
+    /// <returns>Returns false if there isn't enough room left for the value.</returns>
+    public bool WriteExponentialGolomb(UInt32 val)
+    {
+        // We don't support reading UInt32.MaxValue, because it doesn't fit in a UInt32
+        // when encoded, so don't support writing it either.
+        if (val == UInt32.MaxValue)
+        {
+            return false;
+        }
+
+        UInt64 val_to_encode = (UInt64)val + 1;
+
+        // We need to write CountBits(val+1) 0s and then val+1. Since val (as a
+        // UInt64) has leading zeros, we can just write the total golomb encoded
+        // size worth of bits, knowing the value will appear last.
+        return WriteBits(val_to_encode, CountBits(val_to_encode) * 2 - 1);
+    }
+
+    /// <summary>
+    /// Writes signed exponential golomb values at the current offset. Signed
+    /// exponential golomb values are just the unsigned values mapped to the
+    /// sequence 0, 1, -1, 2, -2, etc. in order.
+    /// </summary>
+    public bool WriteSignedExponentialGolomb(Int32 val)
+    {
+        if (val == 0)
+        {
+            return WriteExponentialGolomb(0);
+        }
+
+        if (val > 0)
+        {
+            UInt32 signed_val = (UInt32)val;
+            return WriteExponentialGolomb((signed_val * 2) - 1);
+        }
+
+        if (val == Int32.MinValue)
+        {
+            // -Int32.MinValue does not fit in an Int32
+            return false;
+        }
+
+        UInt32 unsigned_val = (UInt32)(-val);
+        return WriteExponentialGolomb(unsigned_val * 2);
+    }
+}
\ No newline at end of file
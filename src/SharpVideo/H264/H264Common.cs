@@ -61,6 +61,34 @@ public static class H264Common
         return ret;
     }
 
+    /// <summary>
+    /// The reverse of UnescapeRbsp(): inserts the "\x03" emulation prevention
+    /// byte wherever two "\x00" bytes are followed by a byte in the range
+    /// "\x00" to "\x03", so the output can be carried as a NALU payload.
+    /// </summary>
+    public static byte[] EscapeRbsp(ReadOnlySpan<byte> data)
+    {
+        // At most one emulation byte is inserted for every two input bytes.
+        var ret = new List<byte>(data.Length + data.Length / 2);
+
+        int num_consecutive_zeros = 0;
+        for (int i = 0; i < data.Length; i++)
+        {
+            byte value = data[i];
+            if (value <= 0x03 && num_consecutive_zeros >= 2)
+            {
+                // Emulation prevention byte.
+                ret.Add(0x03);
+                num_consecutive_zeros = 0;
+            }
+
+            ret.Add(value);
+            num_consecutive_zeros = (value == 0x00) ? num_consecutive_zeros + 1 : 0;
+        }
+
+        return ret.ToArray();
+    }
+
     public static bool MoreRbspData(BitBuffer bitBuffer)
     {
         // > If there is no more data in the raw byte sequence payload (RBSP), the
@@ -148,6 +176,27 @@ public static class H264Common
         return true;
     }
 
+    public static bool rbsp_trailing_bits(BitBufferWriter bitBufferWriter)
+    {
+        // rbsp_stop_one_bit  f(1) // equal to 1
+        if (!bitBufferWriter.WriteBits(1, 1))
+        {
+            return false;
+        }
+
+        int out_byte_offset, out_bit_offset;
+        bitBufferWriter.GetCurrentOffset(out out_byte_offset, out out_bit_offset);
+        if (out_bit_offset != 0)
+        {
+            // rbsp_alignment_zero_bit  f(1) // equal to 0
+            if (!bitBufferWriter.WriteBits(0, 8 - out_bit_offset))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
     // Syntax functions and descriptors) (Section 7.2)
     internal static bool byte_aligned(BitBuffer bit_buffer)
     {
@@ -0,0 +1,87 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// A class for writing HRD parameters (`hrd_parameters()`, as defined in Section E.1.2 of the 2012 standard) back to an H264 NALU.
+/// </summary>
+public class H264HrdParametersSerializer
+{
+    public static bool WriteHrdParameters(BitBufferWriter bit_buffer_writer, HrdParametersState hrd_parameters)
+    {
+        // H264 hrd_parameters() NAL Unit.
+        // Section E.1.2. ("HRD parameters syntax") of the
+        // H.264 standard for a complete description.
+
+        // cpb_cnt_minus1[i]  ue(v)
+        if (!bit_buffer_writer.WriteExponentialGolomb(hrd_parameters.cpb_cnt_minus1))
+        {
+            return false;
+        }
+
+        // bit_rate_scale  u(4)
+        if (!bit_buffer_writer.WriteBits(hrd_parameters.bit_rate_scale, 4))
+        {
+            return false;
+        }
+
+        // cpb_size_scale  u(4)
+        if (!bit_buffer_writer.WriteBits(hrd_parameters.cpb_size_scale, 4))
+        {
+            return false;
+        }
+
+        for (int SchedSelIdx = 0; SchedSelIdx <= hrd_parameters.cpb_cnt_minus1;
+             SchedSelIdx++)
+        {
+            if (SchedSelIdx >= hrd_parameters.bit_rate_value_minus1.Count ||
+                SchedSelIdx >= hrd_parameters.cpb_size_value_minus1.Count ||
+                SchedSelIdx >= hrd_parameters.cbr_flag.Count)
+            {
+                return false;
+            }
+
+            // bit_rate_value_minus1[i]  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(hrd_parameters.bit_rate_value_minus1[SchedSelIdx]))
+            {
+                return false;
+            }
+
+            // cpb_size_value_minus1[i]  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(hrd_parameters.cpb_size_value_minus1[SchedSelIdx]))
+            {
+                return false;
+            }
+
+            // cbr_flag[i]  u(1)
+            if (!bit_buffer_writer.WriteBits(hrd_parameters.cbr_flag[SchedSelIdx], 1))
+            {
+                return false;
+            }
+        }
+
+        // initial_cpb_removal_delay_length_minus1  u(5)
+        if (!bit_buffer_writer.WriteBits(hrd_parameters.initial_cpb_removal_delay_length_minus1, 5))
+        {
+            return false;
+        }
+
+        // cpb_removal_delay_length_minus1  u(5)
+        if (!bit_buffer_writer.WriteBits(hrd_parameters.cpb_removal_delay_length_minus1, 5))
+        {
+            return false;
+        }
+
+        // dpb_output_delay_length_minus1  u(5)
+        if (!bit_buffer_writer.WriteBits(hrd_parameters.dpb_output_delay_length_minus1, 5))
+        {
+            return false;
+        }
+
+        // time_offset_length  u(5)
+        if (!bit_buffer_writer.WriteBits(hrd_parameters.time_offset_length, 5))
+        {
+            return false;
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
@@ -48,8 +48,11 @@ class H264NalUnitPayloadParser
                     break;
                 }
             case NalUnitType.SEI_NUT:
-                // unimplemented
-                break;
+                {
+                    // sei_rbsp()
+                    nal_unit_payload.sei = H264SeiParser.ParseSei(bit_buffer);
+                    break;
+                }
             case NalUnitType.SPS_NUT:
                 {
                     // seq_parameter_set_rbsp()
@@ -3,14 +3,75 @@
 public class H264Nalu
 {
     private readonly byte[] _data;
+    private readonly int _offset;
+    private readonly int _length;
     private readonly int _payloadStart;
+    private H264NaluBuffer? _buffer;
 
     public H264Nalu(byte[] data, int payloadStart)
+        : this(data, 0, data.Length, payloadStart, null, null)
+    {
+    }
+
+    public H264Nalu(byte[] data, int payloadStart, long? pts, long? dts)
+        : this(data, 0, data.Length, payloadStart, pts, dts)
+    {
+    }
+
+    /// <summary>
+    /// A NAL unit within a larger buffer, e.g. one of several NAL units of an MP4 sample sharing its buffer
+    /// </summary>
+    /// <param name="data">Buffer holding the NAL unit</param>
+    /// <param name="offset">Offset of the start code in <paramref name="data"/></param>
+    /// <param name="length">Length of the NAL unit including its start code</param>
+    /// <param name="payloadStart">Length of the start code</param>
+    /// <param name="pts">Presentation time stamp in 90 kHz units</param>
+    /// <param name="dts">Decoding time stamp in 90 kHz units</param>
+    public H264Nalu(byte[] data, int offset, int length, int payloadStart, long? pts, long? dts)
     {
         _data = data;
+        _offset = offset;
+        _length = length;
         _payloadStart = payloadStart;
+        Pts = pts;
+        Dts = dts;
+    }
+
+    /// <summary>
+    /// A NAL unit within a pooled buffer, which stays rented until <see cref="Release"/> is called
+    /// </summary>
+    /// <param name="buffer">Buffer holding the NAL unit, gains a reference</param>
+    /// <param name="offset">Offset of the start code in the buffer</param>
+    /// <param name="length">Length of the NAL unit including its start code</param>
+    /// <param name="payloadStart">Length of the start code</param>
+    /// <param name="pts">Presentation time stamp in 90 kHz units</param>
+    /// <param name="dts">Decoding time stamp in 90 kHz units</param>
+    public H264Nalu(H264NaluBuffer buffer, int offset, int length, int payloadStart, long? pts, long? dts)
+        : this(buffer.Array, offset, length, payloadStart, pts, dts)
+    {
+        buffer.AddReference();
+        _buffer = buffer;
     }
 
-    public ReadOnlySpan<byte> Data => _data;
-    public ReadOnlySpan<byte> WithoutHeader => _data.AsSpan(_payloadStart);
+    public ReadOnlySpan<byte> Data => _data.AsSpan(_offset, _length);
+    public ReadOnlySpan<byte> WithoutHeader => _data.AsSpan(_offset + _payloadStart, _length - _payloadStart);
+
+    /// <summary>
+    /// Presentation time stamp in 90 kHz units if the container carried one, e.g. the PTS of the MPEG-TS PES
+    /// </summary>
+    public long? Pts { get; }
+
+    /// <summary>
+    /// Decoding time stamp in 90 kHz units if the container carried one
+    /// </summary>
+    public long? Dts { get; }
+
+    /// <summary>
+    /// Called by the consumer once it is done with the NAL unit, hands a pooled buffer back.
+    /// The data must not be used afterwards. Does nothing for NAL units that own their array.
+    /// </summary>
+    public void Release()
+    {
+        Interlocked.Exchange(ref _buffer, null)?.Release();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+﻿using System.Buffers;
+
+namespace SharpVideo.H264;
+
+/// <summary>
+/// A buffer rented from the shared array pool that holds several NAL units, e.g. the payload of an MPEG-TS PES packet.
+/// The creator and every <see cref="H264Nalu"/> viewing the buffer hold a reference, the array goes back to the pool
+/// once all of them called <see cref="Release"/>.
+/// </summary>
+public sealed class H264NaluBuffer
+{
+    private byte[] _array;
+    private int _references = 1;
+
+    /// <param name="capacity">Minimum size of the buffer</param>
+    public H264NaluBuffer(int capacity)
+    {
+        _array = ArrayPool<byte>.Shared.Rent(capacity);
+    }
+
+    public byte[] Array => _array;
+
+    /// <summary>
+    /// Replaces the array by a larger one, keeping the first <paramref name="length"/> bytes.
+    /// Only allowed while no NAL unit references the buffer.
+    /// </summary>
+    public void Grow(int capacity, int length)
+    {
+        if (Volatile.Read(ref _references) != 1)
+        {
+            throw new InvalidOperationException("The buffer is shared with NAL units");
+        }
+
+        var larger = ArrayPool<byte>.Shared.Rent(capacity);
+        _array.AsSpan(0, length).CopyTo(larger);
+        ArrayPool<byte>.Shared.Return(_array);
+        _array = larger;
+    }
+
+    internal void AddReference()
+    {
+        Interlocked.Increment(ref _references);
+    }
+
+    /// <summary>
+    /// Drops a reference, the last one returns the array to the pool
+    /// </summary>
+    public void Release()
+    {
+        if (Interlocked.Decrement(ref _references) == 0)
+        {
+            ArrayPool<byte>.Shared.Return(_array);
+        }
+    }
+}
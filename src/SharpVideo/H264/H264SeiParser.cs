@@ -0,0 +1,87 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// A class for parsing out an SEI NALU (sei_rbsp()). Only the message
+/// headers are parsed, see SeiMessageState for the payloads.
+/// </summary>
+public static class H264SeiParser
+{
+    /// <summary>
+    /// Unpack RBSP and parse SEI state from the supplied buffer.
+    /// </summary>
+    public static SeiState? ParseSei(ReadOnlySpan<byte> data)
+    {
+        var unpacked_buffer = H264Common.UnescapeRbsp(data);
+        BitBuffer bit_buffer = new BitBuffer(unpacked_buffer.ToArray());
+        return ParseSei(bit_buffer);
+    }
+
+    public static SeiState? ParseSei(BitBuffer bit_buffer)
+    {
+        // H264 SEI Nal Unit (sei_rbsp()) parser.
+        // Section 7.3.2.3 ("Supplemental enhancement information RBSP syntax")
+        // of the H.264 standard for a complete description.
+        var sei = new SeiState();
+
+        do
+        {
+            // sei_message()
+            var sei_message = ParseSeiMessage(bit_buffer);
+            if (sei_message == null)
+            {
+                return null;
+            }
+            sei.sei_message.Add(sei_message);
+        } while (H264Common.MoreRbspData(bit_buffer));
+
+        H264Common.rbsp_trailing_bits(bit_buffer);
+
+        return sei;
+    }
+
+    private static SeiMessageState? ParseSeiMessage(BitBuffer bit_buffer)
+    {
+        // Section 7.3.2.3.1 ("Supplemental enhancement information message
+        // syntax")
+        var sei_message = new SeiMessageState();
+
+        if (!ReadFFCodedValue(bit_buffer, out sei_message.payload_type))
+        {
+            return null;
+        }
+
+        if (!ReadFFCodedValue(bit_buffer, out sei_message.payload_size))
+        {
+            return null;
+        }
+
+        // sei_payload(payloadType, payloadSize)
+        if (!bit_buffer.ReadBytes((int)sei_message.payload_size, out sei_message.payload))
+        {
+#if DEBUG
+            //fprintf(stderr, "invalid payload_size: %" PRIu32 " larger than the NALU\n", sei_message.payload_size);
+#endif  // FPRINT_ERRORS
+            return null;
+        }
+
+        return sei_message;
+    }
+
+    private static bool ReadFFCodedValue(BitBuffer bit_buffer, out uint32_t value)
+    {
+        value = 0;
+        byte byte_tmp;
+        // ff_byte  f(8) // equal to 0xFF
+        // last_payload_type_byte / last_payload_size_byte  u(8)
+        do
+        {
+            if (!bit_buffer.ReadUInt8(out byte_tmp))
+            {
+                return false;
+            }
+            value += byte_tmp;
+        } while (byte_tmp == 0xFF);
+
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// A class for parsing out a pic_timing() SEI payload.
+/// </summary>
+public static class H264SeiPicTimingParser
+{
+    /// <param name="sps_data">The SPS active for the picture, it defines
+    /// which fields are present and their lengths.</param>
+    public static SeiPicTimingState? ParsePicTiming(BitBuffer bit_buffer, SpsDataState sps_data)
+    {
+        // H264 pic_timing() parser.
+        // Section D.1.3 ("Picture timing SEI message syntax") of the H.264
+        // standard for a complete description.
+        var pic_timing = new SeiPicTimingState();
+        var vui = sps_data.vui_parameters_present_flag != 0 ? sps_data.vui_parameters : null;
+        if (vui == null)
+        {
+            // nothing is present without VUI
+            return pic_timing;
+        }
+
+        // CpbDpbDelaysPresentFlag, the NAL HRD takes precedence as both carry
+        // the same lengths when both are present
+        var hrd_parameters = vui.nal_hrd_parameters_present_flag != 0
+            ? vui.nal_hrd_parameters
+            : vui.vcl_hrd_parameters_present_flag != 0 ? vui.vcl_hrd_parameters : null;
+        if (hrd_parameters != null)
+        {
+            // cpb_removal_delay  u(v)
+            if (!bit_buffer.ReadBits((int)hrd_parameters.cpb_removal_delay_length_minus1 + 1, out pic_timing.cpb_removal_delay))
+            {
+                return null;
+            }
+
+            // dpb_output_delay  u(v)
+            if (!bit_buffer.ReadBits((int)hrd_parameters.dpb_output_delay_length_minus1 + 1, out pic_timing.dpb_output_delay))
+            {
+                return null;
+            }
+        }
+
+        if (vui.pic_struct_present_flag == 0)
+        {
+            return pic_timing;
+        }
+
+        // pic_struct  u(4)
+        if (!bit_buffer.ReadBits(4, out pic_timing.pic_struct))
+        {
+            return null;
+        }
+
+        uint32_t time_offset_length = hrd_parameters?.time_offset_length ?? 24;
+        int NumClockTS = SeiPicTimingState.getNumClockTS(pic_timing.pic_struct);
+        for (int i = 0; i < NumClockTS; i++)
+        {
+            uint32_t clock_timestamp_flag, ct_type = 0, nuit_field_based_flag = 0, counting_type = 0;
+            uint32_t full_timestamp_flag = 0, discontinuity_flag = 0, cnt_dropped_flag = 0, n_frames = 0;
+            uint32_t seconds_value = 0, minutes_value = 0, hours_value = 0, flag_tmp;
+            int32_t time_offset = 0;
+
+            // clock_timestamp_flag[i]  u(1)
+            if (!bit_buffer.ReadBits(1, out clock_timestamp_flag))
+            {
+                return null;
+            }
+
+            if (clock_timestamp_flag != 0)
+            {
+                // ct_type  u(2)
+                // nuit_field_based_flag  u(1)
+                // counting_type  u(5)
+                // full_timestamp_flag  u(1)
+                // discontinuity_flag  u(1)
+                // cnt_dropped_flag  u(1)
+                // n_frames  u(8)
+                if (!bit_buffer.ReadBits(2, out ct_type) ||
+                    !bit_buffer.ReadBits(1, out nuit_field_based_flag) ||
+                    !bit_buffer.ReadBits(5, out counting_type) ||
+                    !bit_buffer.ReadBits(1, out full_timestamp_flag) ||
+                    !bit_buffer.ReadBits(1, out discontinuity_flag) ||
+                    !bit_buffer.ReadBits(1, out cnt_dropped_flag) ||
+                    !bit_buffer.ReadBits(8, out n_frames))
+                {
+                    return null;
+                }
+
+                if (full_timestamp_flag != 0)
+                {
+                    // seconds_value  u(6)
+                    // minutes_value  u(6)
+                    // hours_value  u(5)
+                    if (!bit_buffer.ReadBits(6, out seconds_value) ||
+                        !bit_buffer.ReadBits(6, out minutes_value) ||
+                        !bit_buffer.ReadBits(5, out hours_value))
+                    {
+                        return null;
+                    }
+                }
+                else
+                {
+                    // seconds_flag  u(1)
+                    if (!bit_buffer.ReadBits(1, out flag_tmp))
+                    {
+                        return null;
+                    }
+                    if (flag_tmp != 0)
+                    {
+                        // seconds_value  u(6)
+                        // minutes_flag  u(1)
+                        if (!bit_buffer.ReadBits(6, out seconds_value) ||
+                            !bit_buffer.ReadBits(1, out flag_tmp))
+                        {
+                            return null;
+                        }
+                        if (flag_tmp != 0)
+                        {
+                            // minutes_value  u(6)
+                            // hours_flag  u(1)
+                            if (!bit_buffer.ReadBits(6, out minutes_value) ||
+                                !bit_buffer.ReadBits(1, out flag_tmp))
+                            {
+                                return null;
+                            }
+                            // hours_value  u(5)
+                            if (flag_tmp != 0 && !bit_buffer.ReadBits(5, out hours_value))
+                            {
+                                return null;
+                            }
+                        }
+                    }
+                }
+
+                if (time_offset_length > 0)
+                {
+                    // time_offset  i(v)
+                    if (!bit_buffer.ReadBits((int)time_offset_length, out uint32_t bits_tmp))
+                    {
+                        return null;
+                    }
+                    int shift = 32 - (int)time_offset_length;
+                    time_offset = ((int32_t)(bits_tmp << shift)) >> shift;
+                }
+            }
+
+            pic_timing.clock_timestamp_flag.Add(clock_timestamp_flag);
+            pic_timing.ct_type.Add(ct_type);
+            pic_timing.nuit_field_based_flag.Add(nuit_field_based_flag);
+            pic_timing.counting_type.Add(counting_type);
+            pic_timing.full_timestamp_flag.Add(full_timestamp_flag);
+            pic_timing.discontinuity_flag.Add(discontinuity_flag);
+            pic_timing.cnt_dropped_flag.Add(cnt_dropped_flag);
+            pic_timing.n_frames.Add(n_frames);
+            pic_timing.seconds_value.Add(seconds_value);
+            pic_timing.minutes_value.Add(minutes_value);
+            pic_timing.hours_value.Add(hours_value);
+            pic_timing.time_offset.Add(time_offset);
+        }
+
+        return pic_timing;
+    }
+}
\ No newline at end of file
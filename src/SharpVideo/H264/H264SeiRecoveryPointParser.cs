@@ -0,0 +1,41 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// A class for parsing out a recovery_point() SEI payload.
+/// </summary>
+public static class H264SeiRecoveryPointParser
+{
+    public static SeiRecoveryPointState? ParseRecoveryPoint(BitBuffer bit_buffer)
+    {
+        // H264 recovery_point() parser.
+        // Section D.1.7 ("Recovery point SEI message syntax") of the H.264
+        // standard for a complete description.
+        var recovery_point = new SeiRecoveryPointState();
+
+        // recovery_frame_cnt  ue(v)
+        if (!bit_buffer.ReadExponentialGolomb(out recovery_point.recovery_frame_cnt))
+        {
+            return null;
+        }
+
+        // exact_match_flag  u(1)
+        if (!bit_buffer.ReadBits(1, out recovery_point.exact_match_flag))
+        {
+            return null;
+        }
+
+        // broken_link_flag  u(1)
+        if (!bit_buffer.ReadBits(1, out recovery_point.broken_link_flag))
+        {
+            return null;
+        }
+
+        // changing_slice_group_idc  u(2)
+        if (!bit_buffer.ReadBits(2, out recovery_point.changing_slice_group_idc))
+        {
+            return null;
+        }
+
+        return recovery_point;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// A class for parsing out a user_data_unregistered() SEI payload.
+/// </summary>
+public static class H264SeiUserDataUnregisteredParser
+{
+    private const int kUuidSize = 16;
+
+    public static SeiUserDataUnregisteredState? ParseUserDataUnregistered(BitBuffer bit_buffer, uint32_t payload_size)
+    {
+        // H264 user_data_unregistered() parser.
+        // Section D.1.6 ("User data unregistered SEI message syntax") of the
+        // H.264 standard for a complete description.
+        var user_data_unregistered = new SeiUserDataUnregisteredState();
+        if (payload_size < kUuidSize)
+        {
+            return null;
+        }
+
+        // uuid_iso_iec_11578  u(128)
+        if (!bit_buffer.ReadBytes(kUuidSize, out var uuid))
+        {
+            return null;
+        }
+        user_data_unregistered.uuid_iso_iec_11578 = uuid.ToArray();
+
+        // user_data_payload_byte  b(8)
+        if (!bit_buffer.ReadBytes((int)payload_size - kUuidSize, out user_data_unregistered.user_data_payload_byte))
+        {
+            return null;
+        }
+
+        return user_data_unregistered;
+    }
+}
\ No newline at end of file
@@ -220,15 +220,21 @@ public class H264SpsDataParser
                         // scaling_list()
                         if (i < 6)
                         {
-                            sps_data.scaling_list(
+                            if (!sps_data.scaling_list(
                                 bit_buffer, i, sps_data.ScalingList4x4, 16,
-                                sps_data.UseDefaultScalingMatrix4x4Flag);
+                                sps_data.UseDefaultScalingMatrix4x4Flag))
+                            {
+                                return null;
+                            }
                         }
                         else
                         {
-                            sps_data.scaling_list(
+                            if (!sps_data.scaling_list(
                                 bit_buffer, i - 6, sps_data.ScalingList8x8, 64,
-                                sps_data.UseDefaultScalingMatrix4x4Flag);
+                                sps_data.UseDefaultScalingMatrix8x8Flag))
+                            {
+                                return null;
+                            }
                         }
                     }
                 }
@@ -0,0 +1,384 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// A class for writing SPS data (seq_parameter_set_data()) back to an H264
+/// NALU, the counterpart of H264SpsDataParser.
+/// </summary>
+public class H264SpsDataSerializer
+{
+    public static bool WriteSpsData(BitBufferWriter bit_buffer_writer, SpsDataState sps_data)
+    {
+        // H264 SPS Nal Unit (seq_parameter_set_data(()) serializer.
+        // Section 7.3.2.1.1 ("Sequence parameter set data syntax") of the H.264
+        // standard for a complete description.
+
+        // profile_idc  u(8)
+        if (!bit_buffer_writer.WriteBits(sps_data.profile_idc, 8))
+        {
+            return false;
+        }
+
+        // constraint_set0_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.constraint_set0_flag, 1))
+        {
+            return false;
+        }
+
+        // constraint_set1_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.constraint_set1_flag, 1))
+        {
+            return false;
+        }
+
+        // constraint_set2_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.constraint_set2_flag, 1))
+        {
+            return false;
+        }
+
+        // constraint_set3_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.constraint_set3_flag, 1))
+        {
+            return false;
+        }
+
+        // constraint_set4_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.constraint_set4_flag, 1))
+        {
+            return false;
+        }
+
+        // constraint_set5_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.constraint_set5_flag, 1))
+        {
+            return false;
+        }
+
+        // reserved_zero_2bits  u(2)
+        if (!bit_buffer_writer.WriteBits(sps_data.reserved_zero_2bits, 2))
+        {
+            return false;
+        }
+
+        // level_idc  u(8)
+        if (!bit_buffer_writer.WriteBits(sps_data.level_idc, 8))
+        {
+            return false;
+        }
+
+        // seq_parameter_set_id  ue(v)
+        if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.seq_parameter_set_id))
+        {
+            return false;
+        }
+
+        if (sps_data.profile_idc == 100 || sps_data.profile_idc == 110 ||
+            sps_data.profile_idc == 122 || sps_data.profile_idc == 244 ||
+            sps_data.profile_idc == 44 || sps_data.profile_idc == 83 ||
+            sps_data.profile_idc == 86 || sps_data.profile_idc == 118 ||
+            sps_data.profile_idc == 128 || sps_data.profile_idc == 138 ||
+            sps_data.profile_idc == 139 || sps_data.profile_idc == 134 ||
+            sps_data.profile_idc == 135)
+        {
+            // chroma_format_idc  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.chroma_format_idc))
+            {
+                return false;
+            }
+
+            if (sps_data.chroma_format_idc == 3)
+            {
+                // separate_colour_plane_flag  u(1)
+                if (!bit_buffer_writer.WriteBits(sps_data.separate_colour_plane_flag, 1))
+                {
+                    return false;
+                }
+            }
+
+            // bit_depth_luma_minus8  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.bit_depth_luma_minus8))
+            {
+                return false;
+            }
+
+            // bit_depth_chroma_minus8  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.bit_depth_chroma_minus8))
+            {
+                return false;
+            }
+
+            // qpprime_y_zero_transform_bypass_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(sps_data.qpprime_y_zero_transform_bypass_flag, 1))
+            {
+                return false;
+            }
+
+            // seq_scaling_matrix_present_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(sps_data.seq_scaling_matrix_present_flag, 1))
+            {
+                return false;
+            }
+
+            if (sps_data.seq_scaling_matrix_present_flag != 0)
+            {
+                for (UInt32 i = 0; i < ((sps_data.chroma_format_idc != 3) ? 8 : 12);
+                     i++)
+                {
+                    UInt32 seq_scaling_list_present_flag =
+                        (i < sps_data.seq_scaling_list_present_flag.Count) ? sps_data.seq_scaling_list_present_flag[(int)i] : 0;
+
+                    // seq_scaling_list_present_flag[i]  u(1)
+                    if (!bit_buffer_writer.WriteBits(seq_scaling_list_present_flag, 1))
+                    {
+                        return false;
+                    }
+
+                    if (seq_scaling_list_present_flag != 0)
+                    {
+                        // scaling_list()
+                        if (i < 6)
+                        {
+                            if (!scaling_list(
+                                bit_buffer_writer, i, sps_data.ScalingList4x4, 16,
+                                sps_data.UseDefaultScalingMatrix4x4Flag))
+                            {
+                                return false;
+                            }
+                        }
+                        else
+                        {
+                            if (!scaling_list(
+                                bit_buffer_writer, i - 6, sps_data.ScalingList8x8, 64,
+                                sps_data.UseDefaultScalingMatrix8x8Flag))
+                            {
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // log2_max_frame_num_minus4  ue(v)
+        if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.log2_max_frame_num_minus4))
+        {
+            return false;
+        }
+
+        // pic_order_cnt_type  ue(v)
+        if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.pic_order_cnt_type))
+        {
+            return false;
+        }
+
+        if (sps_data.pic_order_cnt_type == 0)
+        {
+            // log2_max_pic_order_cnt_lsb_minus4  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.log2_max_pic_order_cnt_lsb_minus4))
+            {
+                return false;
+            }
+        }
+        else if (sps_data.pic_order_cnt_type == 1)
+        {
+            // delta_pic_order_always_zero_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(sps_data.delta_pic_order_always_zero_flag, 1))
+            {
+                return false;
+            }
+
+            // offset_for_non_ref_pic  se(v)
+            if (!bit_buffer_writer.WriteSignedExponentialGolomb(sps_data.offset_for_non_ref_pic))
+            {
+                return false;
+            }
+
+            // offset_for_top_to_bottom_field  se(v)
+            if (!bit_buffer_writer.WriteSignedExponentialGolomb(sps_data.offset_for_top_to_bottom_field))
+            {
+                return false;
+            }
+
+            // num_ref_frames_in_pic_order_cnt_cycle  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.num_ref_frames_in_pic_order_cnt_cycle))
+            {
+                return false;
+            }
+
+            for (int i = 0; i < sps_data.num_ref_frames_in_pic_order_cnt_cycle;
+                 i++)
+            {
+                if (i >= sps_data.offset_for_ref_frame.Count)
+                {
+                    return false;
+                }
+
+                // offset_for_ref_frame[i]  se(v)
+                if (!bit_buffer_writer.WriteSignedExponentialGolomb(sps_data.offset_for_ref_frame[i]))
+                {
+                    return false;
+                }
+            }
+        }
+
+        // max_num_ref_frames  ue(v)
+        if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.max_num_ref_frames))
+        {
+            return false;
+        }
+
+        // gaps_in_frame_num_value_allowed_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.gaps_in_frame_num_value_allowed_flag, 1))
+        {
+            return false;
+        }
+
+        // pic_width_in_mbs_minus1  ue(v)
+        if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.pic_width_in_mbs_minus1))
+        {
+            return false;
+        }
+
+        // pic_height_in_map_units_minus1  ue(v)
+        if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.pic_height_in_map_units_minus1))
+        {
+            return false;
+        }
+
+        // frame_mbs_only_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.frame_mbs_only_flag, 1))
+        {
+            return false;
+        }
+
+        if (sps_data.frame_mbs_only_flag == 0)
+        {
+            // mb_adaptive_frame_field_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(sps_data.mb_adaptive_frame_field_flag, 1))
+            {
+                return false;
+            }
+        }
+
+        // direct_8x8_inference_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.direct_8x8_inference_flag, 1))
+        {
+            return false;
+        }
+
+        // frame_cropping_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.frame_cropping_flag, 1))
+        {
+            return false;
+        }
+
+        if (sps_data.frame_cropping_flag != 0)
+        {
+            // frame_crop_left_offset  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.frame_crop_left_offset))
+            {
+                return false;
+            }
+
+            // frame_crop_right_offset  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.frame_crop_right_offset))
+            {
+                return false;
+            }
+
+            // frame_crop_top_offset  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.frame_crop_top_offset))
+            {
+                return false;
+            }
+
+            // frame_crop_bottom_offset  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(sps_data.frame_crop_bottom_offset))
+            {
+                return false;
+            }
+        }
+
+        // vui_parameters_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(sps_data.vui_parameters_present_flag, 1))
+        {
+            return false;
+        }
+
+        if (sps_data.vui_parameters_present_flag != 0)
+        {
+            // vui_parameters()
+            if (sps_data.vui_parameters == null ||
+                !H264VuiParametersSerializer.WriteVuiParameters(bit_buffer_writer, sps_data.vui_parameters))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Writes the ith list of |scalingList| as delta_scale values, the reverse
+    /// of SpsDataState.scaling_list(). A list flagged as using the default
+    /// matrix is written as the single delta that makes the first nextScale 0,
+    /// a run of values repeating the last one up to the end of the list is
+    /// cut short the same way.
+    /// </summary>
+    private static bool scaling_list(
+        BitBufferWriter bit_buffer_writer,
+        UInt32 i,
+        List<UInt32> scalingList,
+        UInt32 sizeOfScalingList,
+        List<UInt32> useDefaultScalingMatrixFlag)
+    {
+        if (i < useDefaultScalingMatrixFlag.Count && useDefaultScalingMatrixFlag[(int)i] != 0)
+        {
+            // delta_scale  se(v)
+            return bit_buffer_writer.WriteSignedExponentialGolomb(-8);
+        }
+
+        int start = (int)(i * sizeOfScalingList);
+        if (scalingList.Count < start + sizeOfScalingList)
+        {
+            return false;
+        }
+
+        UInt32 lastScale = 8;
+        for (int j = 0; j < sizeOfScalingList; j++)
+        {
+            int remaining = (int)sizeOfScalingList - j;
+            bool repeats = j > 0;
+            for (int k = 0; repeats && k < remaining; k++)
+            {
+                repeats = scalingList[start + j + k] == lastScale;
+            }
+
+            // nextScale 0 repeats lastScale up to the end of the list
+            UInt32 nextScale = repeats ? 0 : scalingList[start + j];
+            if (nextScale == 0 && !repeats)
+            {
+                // scaling list entries are in the range 1 to 255
+                return false;
+            }
+
+            // delta_scale  se(v)
+            Int32 delta_scale = (Int32)((nextScale - lastScale + 256) % 256);
+            if (delta_scale > 127)
+            {
+                delta_scale -= 256;
+            }
+            if (!bit_buffer_writer.WriteSignedExponentialGolomb(delta_scale))
+            {
+                return false;
+            }
+
+            if (repeats)
+            {
+                break;
+            }
+            lastScale = nextScale;
+        }
+        return true;
+    }
+}
\ No newline at end of file
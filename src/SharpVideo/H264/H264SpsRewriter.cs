@@ -0,0 +1,218 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// Rewrites SPS NALUs so their VUI signals bitstream_restriction with a
+/// max_num_reorder_frames value. Without it a decoder has to assume the worst
+/// case and hold up to the DPB size of pictures back before output; with
+/// max_num_reorder_frames 0 every picture can be output as soon as it is decoded.
+/// </summary>
+/// <remarks>
+/// The value is either configured, when the encoder is known, or inferred from
+/// the stream: 0 is signalled right away for Baseline and for
+/// pic_order_cnt_type 2, where output order equals decoding order, otherwise
+/// once a whole IDR period (or <see cref="kInferPictureCount"/> pictures) was
+/// seen without a B slice. An inferring rewriter stops rewriting for good once
+/// a B slice shows up. NALUs are passed without start code, starting with the
+/// NALU header.
+/// </remarks>
+public sealed class H264SpsRewriter
+{
+    // Pictures without a B slice after which a stream without IDR periods is
+    // taken as not reordering.
+    public const int kInferPictureCount = 300;
+
+    // Bytes of a slice NALU needed to reach slice_type: NALU header,
+    // first_mb_in_slice and slice_type as ue(v) plus emulation bytes.
+    private const int kSliceHeaderPeekSize = 16;
+
+    private readonly uint? _maxNumReorderFrames;
+    private bool _seenIdr;
+    private bool _seenBSlice;
+    private bool _noReorderConfirmed;
+    private int _picturesWithoutBSlice;
+    private byte[]? _lastInput;
+    private byte[]? _lastOutput;
+
+    /// <param name="maxNumReorderFrames">Value to signal, null to infer 0 from
+    /// the slice types.</param>
+    public H264SpsRewriter(uint? maxNumReorderFrames = null)
+    {
+        if (maxNumReorderFrames > H264VuiParametersParser.kMaxDpbFrames)
+        {
+            throw new ArgumentOutOfRangeException(nameof(maxNumReorderFrames),
+                $"max_num_reorder_frames must not exceed {H264VuiParametersParser.kMaxDpbFrames}.");
+        }
+
+        _maxNumReorderFrames = maxNumReorderFrames;
+    }
+
+    /// <summary>
+    /// Number of SPS NALUs rewritten so far.
+    /// </summary>
+    public long RewrittenCount { get; private set; }
+
+    /// <summary>
+    /// True while an inferring rewriter may still start or keep rewriting.
+    /// </summary>
+    public bool IsActive => _maxNumReorderFrames != null || !_seenBSlice;
+
+    /// <summary>
+    /// Feeds a NALU of the stream to the slice type inference. Only the start
+    /// of slice NALUs is parsed, other NALUs are ignored.
+    /// </summary>
+    public void ObserveNalUnit(ReadOnlySpan<byte> nalUnit)
+    {
+        if (_maxNumReorderFrames != null || _seenBSlice || nalUnit.Length < 2)
+        {
+            return;
+        }
+
+        var nal_unit_type = (NalUnitType)(nalUnit[0] & 0x1f);
+        if (nal_unit_type != NalUnitType.CODED_SLICE_OF_NON_IDR_PICTURE_NUT &&
+            nal_unit_type != NalUnitType.CODED_SLICE_OF_IDR_PICTURE_NUT)
+        {
+            return;
+        }
+
+        var unpacked_buffer = H264Common.UnescapeRbsp(nalUnit.Slice(1, Math.Min(nalUnit.Length, kSliceHeaderPeekSize) - 1));
+        var bit_buffer = new BitBuffer(unpacked_buffer.ToArray());
+
+        // first_mb_in_slice  ue(v)
+        // slice_type  ue(v)
+        if (!bit_buffer.ReadExponentialGolomb(out UInt32 first_mb_in_slice) ||
+            !bit_buffer.ReadExponentialGolomb(out UInt32 slice_type))
+        {
+            return;
+        }
+
+        if (slice_type % 5 == (UInt32)SliceType.B)
+        {
+            _seenBSlice = true;
+            _noReorderConfirmed = false;
+            return;
+        }
+
+        if (first_mb_in_slice != 0)
+        {
+            return;
+        }
+
+        // First slice of a picture
+        if (nal_unit_type == NalUnitType.CODED_SLICE_OF_IDR_PICTURE_NUT)
+        {
+            // The previous IDR period ended without a B slice
+            _noReorderConfirmed |= _seenIdr;
+            _seenIdr = true;
+        }
+
+        if (++_picturesWithoutBSlice >= kInferPictureCount)
+        {
+            _noReorderConfirmed = true;
+        }
+    }
+
+    /// <summary>
+    /// Rewrites an SPS NALU to signal the reorder depth.
+    /// </summary>
+    /// <param name="spsNalUnit">SPS NALU, starting with the NALU header.</param>
+    /// <param name="rewritten">The rewritten SPS NALU, including the NALU header.</param>
+    /// <returns>False if the SPS is to be kept: it already signals the value,
+    /// no value is known yet or it could not be parsed.</returns>
+    public bool TryRewrite(ReadOnlySpan<byte> spsNalUnit, out byte[] rewritten)
+    {
+        rewritten = Array.Empty<byte>();
+        if (spsNalUnit.Length < 2 || (NalUnitType)(spsNalUnit[0] & 0x1f) != NalUnitType.SPS_NUT || !IsActive)
+        {
+            return false;
+        }
+
+        // Senders repeat the same SPS in front of every key frame
+        if (_lastInput != null && spsNalUnit.SequenceEqual(_lastInput))
+        {
+            if (_lastOutput == null)
+            {
+                return false;
+            }
+
+            rewritten = _lastOutput;
+            RewrittenCount++;
+            return true;
+        }
+
+        var sps = H264SpsParser.ParseSps(spsNalUnit.Slice(1));
+        if (sps == null)
+        {
+            return false;
+        }
+
+        var sps_data = sps.sps_data;
+        uint? max_num_reorder_frames = _maxNumReorderFrames;
+        if (max_num_reorder_frames == null &&
+            (_noReorderConfirmed || sps_data.profile_idc == 66 || sps_data.pic_order_cnt_type == 2))
+        {
+            max_num_reorder_frames = 0;
+        }
+
+        if (max_num_reorder_frames == null)
+        {
+            // Not known yet, the SPS is not cached so it is looked at again
+            return false;
+        }
+
+        byte[]? output = null;
+        bool changed = false;
+        var vui = sps_data.vui_parameters;
+        if (sps_data.vui_parameters_present_flag == 0 || vui == null)
+        {
+            // All VUI fields absent except the restriction
+            vui = new VuiParametersState();
+            sps_data.vui_parameters = vui;
+            sps_data.vui_parameters_present_flag = 1;
+            changed = true;
+        }
+
+        if (vui.bitstream_restriction_flag == 0)
+        {
+            // Inferred values of Section E.2.1 for an absent bitstream_restriction
+            vui.bitstream_restriction_flag = 1;
+            vui.motion_vectors_over_pic_boundaries_flag = 1;
+            vui.max_bytes_per_pic_denom = 2;
+            vui.max_bits_per_mb_denom = 1;
+            vui.log2_max_mv_length_horizontal = 15;
+            vui.log2_max_mv_length_vertical = 15;
+            vui.max_dec_frame_buffering = 0;
+            changed = true;
+        }
+
+        // Section E.2.1: max_dec_frame_buffering >= max_num_ref_frames and
+        // max_num_reorder_frames <= max_dec_frame_buffering
+        UInt32 max_dec_frame_buffering = Math.Max(
+            Math.Max(vui.max_dec_frame_buffering, sps_data.max_num_ref_frames), max_num_reorder_frames.Value);
+        if (changed ||
+            vui.max_num_reorder_frames != max_num_reorder_frames.Value ||
+            vui.max_dec_frame_buffering != max_dec_frame_buffering)
+        {
+            vui.max_num_reorder_frames = max_num_reorder_frames.Value;
+            vui.max_dec_frame_buffering = max_dec_frame_buffering;
+
+            var payload = H264SpsSerializer.SerializeSps(sps);
+            if (payload != null)
+            {
+                output = new byte[payload.Length + 1];
+                output[0] = spsNalUnit[0];
+                payload.CopyTo(output, 1);
+            }
+        }
+
+        _lastInput = spsNalUnit.ToArray();
+        _lastOutput = output;
+        if (output == null)
+        {
+            return false;
+        }
+
+        rewritten = output;
+        RewrittenCount++;
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// Writes a SPS state back to a seq_parameter_set_rbsp(), the counterpart of
+/// H264SpsParser. Fields are written exactly as stored, so a parsed SPS can be
+/// modified and serialized again.
+/// </summary>
+public static class H264SpsSerializer
+{
+    // Enough for any SPS without scaling matrices or large HRD parameters,
+    // the buffer is doubled until the SPS fits.
+    private const int kInitialBufferSize = 256;
+    private const int kMaxBufferSize = 64 * 1024;
+
+    /// <summary>
+    /// Serialize SPS state and pack RBSP. The result is the SPS NALU payload,
+    /// without the NALU header.
+    /// </summary>
+    public static byte[]? SerializeSps(SpsState sps)
+    {
+        for (int size = kInitialBufferSize; size <= kMaxBufferSize; size *= 2)
+        {
+            var buffer = new byte[size];
+            var bit_buffer_writer = new BitBufferWriter(buffer);
+            if (WriteSps(bit_buffer_writer, sps))
+            {
+                return H264Common.EscapeRbsp(buffer.AsSpan(0, bit_buffer_writer.WrittenByteCount()));
+            }
+        }
+
+        return null;
+    }
+
+    public static bool WriteSps(BitBufferWriter bit_buffer_writer, SpsState sps)
+    {
+        // H264 SPS Nal Unit (seq_parameter_set_rbsp(()) serializer.
+        // Section 7.3.2.1 ("Sequence parameter set RBSP syntax") of the H.264
+        // standard for a complete description.
+
+        // seq_parameter_set_data()
+        if (sps.sps_data == null ||
+            !H264SpsDataSerializer.WriteSpsData(bit_buffer_writer, sps.sps_data))
+        {
+            return false;
+        }
+
+        return H264Common.rbsp_trailing_bits(bit_buffer_writer);
+    }
+}
\ No newline at end of file
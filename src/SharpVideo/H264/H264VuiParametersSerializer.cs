@@ -0,0 +1,239 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// A class for writing a SPS VUI back to an H264 NALU, the counterpart of
+/// H264VuiParametersParser.
+/// </summary>
+public class H264VuiParametersSerializer
+{
+    public static bool WriteVuiParameters(BitBufferWriter bit_buffer_writer, VuiParametersState vui)
+    {
+        // H264 vui_parameters() serializer.
+        // Section E.1 ("VUI parameters syntax") of the H.264 standard for
+        // a complete description.
+
+        // aspect_ratio_info_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.aspect_ratio_info_present_flag, 1))
+        {
+            return false;
+        }
+
+        if (vui.aspect_ratio_info_present_flag != 0)
+        {
+            // aspect_ratio_idc  u(8)
+            if (!bit_buffer_writer.WriteBits(vui.aspect_ratio_idc, 8))
+            {
+                return false;
+            }
+            if (vui.aspect_ratio_idc == (uint)AspectRatioType.AR_EXTENDED_SAR)
+            {
+                // sar_width  u(16)
+                if (!bit_buffer_writer.WriteBits(vui.sar_width, 16))
+                {
+                    return false;
+                }
+                // sar_height  u(16)
+                if (!bit_buffer_writer.WriteBits(vui.sar_height, 16))
+                {
+                    return false;
+                }
+            }
+        }
+
+        // overscan_info_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.overscan_info_present_flag, 1))
+        {
+            return false;
+        }
+
+        if (vui.overscan_info_present_flag != 0)
+        {
+            // overscan_appropriate_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(vui.overscan_appropriate_flag, 1))
+            {
+                return false;
+            }
+        }
+
+        // video_signal_type_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.video_signal_type_present_flag, 1))
+        {
+            return false;
+        }
+
+        if (vui.video_signal_type_present_flag != 0)
+        {
+            // video_format  u(3)
+            if (!bit_buffer_writer.WriteBits(vui.video_format, 3))
+            {
+                return false;
+            }
+            // video_full_range_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(vui.video_full_range_flag, 1))
+            {
+                return false;
+            }
+            // colour_description_present_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(vui.colour_description_present_flag, 1))
+            {
+                return false;
+            }
+            if (vui.colour_description_present_flag != 0)
+            {
+                // colour_primaries  u(8)
+                if (!bit_buffer_writer.WriteBits(vui.colour_primaries, 8))
+                {
+                    return false;
+                }
+                // transfer_characteristics  u(8)
+                if (!bit_buffer_writer.WriteBits(vui.transfer_characteristics, 8))
+                {
+                    return false;
+                }
+                // matrix_coefficients  u(8)
+                if (!bit_buffer_writer.WriteBits(vui.matrix_coefficients, 8))
+                {
+                    return false;
+                }
+            }
+        }
+
+        // chroma_loc_info_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.chroma_loc_info_present_flag, 1))
+        {
+            return false;
+        }
+        if (vui.chroma_loc_info_present_flag != 0)
+        {
+            // chroma_sample_loc_type_top_field  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.chroma_sample_loc_type_top_field))
+            {
+                return false;
+            }
+
+            // chroma_sample_loc_type_bottom_field  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.chroma_sample_loc_type_bottom_field))
+            {
+                return false;
+            }
+        }
+
+        // timing_info_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.timing_info_present_flag, 1))
+        {
+            return false;
+        }
+
+        if (vui.timing_info_present_flag != 0)
+        {
+            // num_units_in_tick  u(32)
+            if (!bit_buffer_writer.WriteUInt32(vui.num_units_in_tick))
+            {
+                return false;
+            }
+            // time_scale  u(32)
+            if (!bit_buffer_writer.WriteUInt32(vui.time_scale))
+            {
+                return false;
+            }
+            // fixed_frame_rate_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(vui.fixed_frame_rate_flag, 1))
+            {
+                return false;
+            }
+        }
+
+        // nal_hrd_parameters_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.nal_hrd_parameters_present_flag, 1))
+        {
+            return false;
+        }
+
+        if (vui.nal_hrd_parameters_present_flag != 0)
+        {
+            // hrd_parameters()
+            if (!H264HrdParametersSerializer.WriteHrdParameters(bit_buffer_writer, vui.nal_hrd_parameters))
+            {
+                return false;
+            }
+        }
+
+        // vcl_hrd_parameters_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.vcl_hrd_parameters_present_flag, 1))
+        {
+            return false;
+        }
+
+        if (vui.vcl_hrd_parameters_present_flag != 0)
+        {
+            // hrd_parameters()
+            if (!H264HrdParametersSerializer.WriteHrdParameters(bit_buffer_writer, vui.vcl_hrd_parameters))
+            {
+                return false;
+            }
+        }
+
+        if (vui.nal_hrd_parameters_present_flag != 0 ||
+            vui.vcl_hrd_parameters_present_flag != 0)
+        {
+            // low_delay_hrd_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(vui.low_delay_hrd_flag, 1))
+            {
+                return false;
+            }
+        }
+
+        // pic_struct_present_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.pic_struct_present_flag, 1))
+        {
+            return false;
+        }
+
+        // bitstream_restriction_flag  u(1)
+        if (!bit_buffer_writer.WriteBits(vui.bitstream_restriction_flag, 1))
+        {
+            return false;
+        }
+
+        if (vui.bitstream_restriction_flag != 0)
+        {
+            // motion_vectors_over_pic_boundaries_flag  u(1)
+            if (!bit_buffer_writer.WriteBits(vui.motion_vectors_over_pic_boundaries_flag, 1))
+            {
+                return false;
+            }
+            // max_bytes_per_pic_denom  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.max_bytes_per_pic_denom))
+            {
+                return false;
+            }
+            // max_bits_per_mb_denom  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.max_bits_per_mb_denom))
+            {
+                return false;
+            }
+            // log2_max_mv_length_horizontal  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.log2_max_mv_length_horizontal))
+            {
+                return false;
+            }
+            // log2_max_mv_length_vertical  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.log2_max_mv_length_vertical))
+            {
+                return false;
+            }
+            // max_num_reorder_frames  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.max_num_reorder_frames))
+            {
+                return false;
+            }
+            // max_dec_frame_buffering  ue(v)
+            if (!bit_buffer_writer.WriteExponentialGolomb(vui.max_dec_frame_buffering))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
@@ -9,6 +9,7 @@ public class NalUnitPayloadState
 {
     public SpsState sps;
     public PpsState pps;
+    public SeiState sei;
     public SliceLayerWithoutPartitioningRbspState slice_layer_without_partitioning_rbsp;
     public PrefixNalUnitRbspState prefix_nal_unit;
     public SubsetSpsState subset_sps;
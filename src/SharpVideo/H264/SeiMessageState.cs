@@ -0,0 +1,62 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// The parsed state of an sei_message(). The payload is kept as RBSP bytes
+/// and parsed the first time it is asked for, so streams carrying SEI cost
+/// only the message framing unless the payload is actually used.
+/// </summary>
+public class SeiMessageState
+{
+    public uint32_t payload_type = 0;
+    public uint32_t payload_size = 0;
+
+    /// <summary>
+    /// sei_payload() bytes, sharing the unescaped NALU buffer.
+    /// </summary>
+    public ReadOnlyMemory<byte> payload;
+
+    private SeiUserDataUnregisteredState? _user_data_unregistered;
+    private SeiRecoveryPointState? _recovery_point;
+
+    /// <summary>
+    /// Parses a user_data_unregistered() payload.
+    /// </summary>
+    /// <returns>null if the message has another type or cannot be parsed.</returns>
+    public SeiUserDataUnregisteredState? GetUserDataUnregistered()
+    {
+        if (_user_data_unregistered == null &&
+            payload_type == (uint32_t)SeiPayloadType.USER_DATA_UNREGISTERED)
+        {
+            _user_data_unregistered = H264SeiUserDataUnregisteredParser.ParseUserDataUnregistered(new BitBuffer(payload), payload_size);
+        }
+        return _user_data_unregistered;
+    }
+
+    /// <summary>
+    /// Parses a recovery_point() payload.
+    /// </summary>
+    /// <returns>null if the message has another type or cannot be parsed.</returns>
+    public SeiRecoveryPointState? GetRecoveryPoint()
+    {
+        if (_recovery_point == null &&
+            payload_type == (uint32_t)SeiPayloadType.RECOVERY_POINT)
+        {
+            _recovery_point = H264SeiRecoveryPointParser.ParseRecoveryPoint(new BitBuffer(payload));
+        }
+        return _recovery_point;
+    }
+
+    /// <summary>
+    /// Parses a pic_timing() payload. Its syntax depends on the HRD and VUI
+    /// parameters of the active SPS, so the result is not cached.
+    /// </summary>
+    /// <returns>null if the message has another type or cannot be parsed.</returns>
+    public SeiPicTimingState? GetPicTiming(SpsDataState sps_data)
+    {
+        if (payload_type != (uint32_t)SeiPayloadType.PIC_TIMING)
+        {
+            return null;
+        }
+        return H264SeiPicTimingParser.ParsePicTiming(new BitBuffer(payload), sps_data);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// SEI payloadType values, Section D.1 of the 2012 standard.
+/// </summary>
+public enum SeiPayloadType : uint
+{
+    BUFFERING_PERIOD = 0,
+    PIC_TIMING = 1,
+    PAN_SCAN_RECT = 2,
+    FILLER_PAYLOAD = 3,
+    USER_DATA_REGISTERED_ITU_T_T35 = 4,
+    USER_DATA_UNREGISTERED = 5,
+    RECOVERY_POINT = 6,
+    DEC_REF_PIC_MARKING_REPETITION = 7,
+    SPARE_PIC = 8,
+    SCENE_INFO = 9,
+    SUB_SEQ_INFO = 10,
+    SUB_SEQ_LAYER_CHARACTERISTICS = 11,
+    SUB_SEQ_CHARACTERISTICS = 12,
+    FULL_FRAME_FREEZE = 13,
+    FULL_FRAME_FREEZE_RELEASE = 14,
+    FULL_FRAME_SNAPSHOT = 15,
+    PROGRESSIVE_REFINEMENT_SEGMENT_START = 16,
+    PROGRESSIVE_REFINEMENT_SEGMENT_END = 17,
+    MOTION_CONSTRAINED_SLICE_GROUP_SET = 18,
+    FILM_GRAIN_CHARACTERISTICS = 19,
+    DEBLOCKING_FILTER_DISPLAY_PREFERENCE = 20,
+    STEREO_VIDEO_INFO = 21,
+    POST_FILTER_HINT = 22,
+    TONE_MAPPING_INFO = 23,
+    FRAME_PACKING_ARRANGEMENT = 45,
+    DISPLAY_ORIENTATION = 47,
+}
\ No newline at end of file
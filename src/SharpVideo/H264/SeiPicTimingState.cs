@@ -0,0 +1,38 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// The parsed state of a pic_timing() SEI payload. The clock timestamp
+/// fields have one entry per NumClockTS, fields of a timestamp whose
+/// clock_timestamp_flag is 0 are stored as 0.
+/// </summary>
+public class SeiPicTimingState
+{
+    public uint32_t cpb_removal_delay = 0;
+    public uint32_t dpb_output_delay = 0;
+    public uint32_t pic_struct = 0;
+    public List<uint32_t> clock_timestamp_flag = new();
+    public List<uint32_t> ct_type = new();
+    public List<uint32_t> nuit_field_based_flag = new();
+    public List<uint32_t> counting_type = new();
+    public List<uint32_t> full_timestamp_flag = new();
+    public List<uint32_t> discontinuity_flag = new();
+    public List<uint32_t> cnt_dropped_flag = new();
+    public List<uint32_t> n_frames = new();
+    public List<uint32_t> seconds_value = new();
+    public List<uint32_t> minutes_value = new();
+    public List<uint32_t> hours_value = new();
+    public List<int32_t> time_offset = new();
+
+    // derived values
+    public static int getNumClockTS(uint32_t pic_struct)
+    {
+        // Table D-1
+        return pic_struct switch
+        {
+            0 or 1 or 2 => 1,
+            3 or 4 or 7 => 2,
+            5 or 6 or 8 => 3,
+            _ => 0,
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// The parsed state of a recovery_point() SEI payload.
+/// </summary>
+public class SeiRecoveryPointState
+{
+    public uint32_t recovery_frame_cnt = 0;
+    public uint32_t exact_match_flag = 0;
+    public uint32_t broken_link_flag = 0;
+    public uint32_t changing_slice_group_idc = 0;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+﻿namespace SharpVideo.H264;
+
+/// <summary>
+/// The parsed state of an sei_rbsp(). Only the message framing is parsed,
+/// the payloads are parsed on request through the SeiMessageState accessors.
+/// </summary>
+public class SeiState
+{
+    public List<SeiMessageState> sei_message = new();
+
+    /// <summary>
+    /// Returns the first message of the given type, or null.
+    /// </summary>
+    public SeiMessageState? GetMessage(SeiPayloadType payload_type)
+    {
+        foreach (var message in sei_message)
+        {
+            if (message.payload_type == (uint32_t)payload_type)
+            {
+                return message;
+            }
+        }
+        return null;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+﻿using System.Buffers.Binary;
+
+namespace SharpVideo.H264;
+
+/// <summary>
+/// The parsed state of a user_data_unregistered() SEI payload.
+/// </summary>
+public class SeiUserDataUnregisteredState
+{
+    // MISB ST 0604 "MISPmicrosectime": capture time in microseconds since the
+    // POSIX epoch, written by many cameras and encoders
+    public static readonly byte[] kMispMicrosecTimeUuid =
+    {
+        0x4d, 0x49, 0x53, 0x50, 0x6d, 0x69, 0x63, 0x72,
+        0x6f, 0x73, 0x65, 0x63, 0x74, 0x69, 0x6d, 0x65
+    };
+
+    // status byte and 8 time bytes with a 0xff after every 2 of the first 6
+    private const int kMispTimestampSize = 12;
+
+    public byte[] uuid_iso_iec_11578 = Array.Empty<byte>();
+    public ReadOnlyMemory<byte> user_data_payload_byte;
+
+    public bool HasUuid(ReadOnlySpan<byte> uuid)
+    {
+        return uuid_iso_iec_11578.AsSpan().SequenceEqual(uuid);
+    }
+
+    /// <summary>
+    /// Reads a MISP microsecond capture timestamp.
+    /// </summary>
+    /// <param name="microseconds">Microseconds since 1970-01-01 UTC.</param>
+    /// <returns>false if the payload does not carry a MISP timestamp or its
+    /// status marks the time as invalid.</returns>
+    public bool TryGetMispTimestamp(out UInt64 microseconds)
+    {
+        microseconds = 0;
+        var data = user_data_payload_byte.Span;
+        if (!HasUuid(kMispMicrosecTimeUuid) || data.Length < kMispTimestampSize)
+        {
+            return false;
+        }
+
+        // status  u(8), bit 7 set: time is not reliable
+        if ((data[0] & 0x80) != 0)
+        {
+            return false;
+        }
+
+        // the start code emulation bytes must be present
+        if (data[3] != 0xff || data[6] != 0xff || data[9] != 0xff)
+        {
+            return false;
+        }
+
+        microseconds =
+            ((UInt64)BinaryPrimitives.ReadUInt16BigEndian(data.Slice(1)) << 48) |
+            ((UInt64)BinaryPrimitives.ReadUInt16BigEndian(data.Slice(4)) << 32) |
+            ((UInt64)BinaryPrimitives.ReadUInt16BigEndian(data.Slice(7)) << 16) |
+            BinaryPrimitives.ReadUInt16BigEndian(data.Slice(10));
+        return true;
+    }
+}
\ No newline at end of file
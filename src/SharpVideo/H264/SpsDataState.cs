@@ -28,12 +28,13 @@ public class SpsDataState
     public UInt32 bit_depth_chroma_minus8 = 0;
     public UInt32 qpprime_y_zero_transform_bypass_flag = 0;
     public UInt32 seq_scaling_matrix_present_flag = 0;
-    public List<UInt32> seq_scaling_list_present_flag;
-    // scaling_list()
-    public List<UInt32> ScalingList4x4;
-    public List<UInt32> UseDefaultScalingMatrix4x4Flag;
-    public List<UInt32> ScalingList8x8;
-    public List<UInt32> UseDefaultScalingMatrix8x8Flag;
+    public List<UInt32> seq_scaling_list_present_flag = new();
+    // scaling_list(), the lists are stored one after another, list i starts at
+    // i * sizeOfScalingList
+    public List<UInt32> ScalingList4x4 = new();
+    public List<UInt32> UseDefaultScalingMatrix4x4Flag = new();
+    public List<UInt32> ScalingList8x8 = new();
+    public List<UInt32> UseDefaultScalingMatrix8x8Flag = new();
     public Int32 delta_scale = 0;
     public UInt32 log2_max_frame_num_minus4 = 0;
     public UInt32 pic_order_cnt_type = 0;
@@ -42,7 +43,7 @@ public class SpsDataState
     public Int32 offset_for_non_ref_pic = 0;
     public Int32 offset_for_top_to_bottom_field = 0;
     public UInt32 num_ref_frames_in_pic_order_cnt_cycle = 0;
-    public List<Int32> offset_for_ref_frame;
+    public List<Int32> offset_for_ref_frame = new();
     public UInt32 max_num_ref_frames = 0;
     public UInt32 gaps_in_frame_num_value_allowed_flag = 0;
     public UInt32 pic_width_in_mbs_minus1 = 0;
@@ -271,13 +272,14 @@ public class SpsDataState
 
                 useDefaultScalingMatrixFlag[(int)i] = (uint)((j == 0 && nextScale == 0) ? 1 : 0);
             }
-            // make sure vector has jth element
-            while (scalingList.Count <= j)
+            // make sure vector has the jth element of the ith list
+            int index = (int)(i * sizeOfScalingList + j);
+            while (scalingList.Count <= index)
             {
                 scalingList.Add(0);
             }
-            scalingList[(int)j] = (nextScale == 0) ? lastScale : nextScale;
-            lastScale = scalingList[(int)j];
+            scalingList[index] = (nextScale == 0) ? lastScale : nextScale;
+            lastScale = scalingList[index];
         }
         return true;
     }
@@ -0,0 +1,126 @@
+using System.Runtime.InteropServices;
+using System.Runtime.Versioning;
+using SharpVideo.Linux.Native.IoUring;
+
+namespace SharpVideo.IoUring;
+
+/// <summary>
+/// Equally sized buffers provided to the kernel through a registered buffer ring (kernel 5.19). Receive requests with
+/// IOSQE_BUFFER_SELECT pick a free buffer when data arrives instead of owning one while they wait, so a single
+/// multishot request can keep receiving into the whole pool.
+/// </summary>
+/// <remarks>
+/// The kernel consumes buffers from the head of the ring, the completion names the buffer by its id. The owner
+/// hands a buffer back with <see cref="Recycle"/> once it is done with the data; recycled buffers become visible to
+/// the kernel with the next <see cref="Publish"/>, so a batch of completions is returned with one memory barrier.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed unsafe class IoUringBufferRing : IDisposable
+{
+    private const int PageSize = 4096;
+    private const int BufferAlignment = 64;
+
+    // The tail overlays the resv field of the first entry
+    private const int TailOffset = 14;
+
+    private readonly IoUringRing _ring;
+    private readonly IoUringBuf* _entries;
+    private readonly byte* _buffers;
+    private readonly ushort _mask;
+    private ushort _tail;
+    private bool _registered;
+    private bool _disposed;
+
+    /// <param name="ring">Ring the buffers are registered with.</param>
+    /// <param name="groupId">Buffer group id, selected by <see cref="IoUringSqe.buf_index"/>.</param>
+    /// <param name="count">Number of buffers, a power of two up to 32768.</param>
+    /// <param name="bufferSize">Size of every buffer.</param>
+    /// <exception cref="InvalidOperationException">The kernel does not support provided buffer rings.</exception>
+    public IoUringBufferRing(IoUringRing ring, ushort groupId, int count, int bufferSize)
+    {
+        if (count <= 0 || count > 32768 || (count & (count - 1)) != 0)
+        {
+            throw new ArgumentOutOfRangeException(nameof(count), "The buffer count must be a power of two up to 32768.");
+        }
+
+        _ring = ring;
+        GroupId = groupId;
+        Count = count;
+        BufferSize = (bufferSize + BufferAlignment - 1) & ~(BufferAlignment - 1);
+        _mask = (ushort)(count - 1);
+
+        _entries = (IoUringBuf*)NativeMemory.AlignedAlloc((nuint)(count * sizeof(IoUringBuf)), PageSize);
+        _buffers = (byte*)NativeMemory.AlignedAlloc((nuint)count * (nuint)BufferSize, PageSize);
+        NativeMemory.Clear(_entries, (nuint)(count * sizeof(IoUringBuf)));
+
+        try
+        {
+            ring.RegisterBufferRing(_entries, (uint)count, groupId);
+            _registered = true;
+        }
+        catch
+        {
+            Dispose();
+            throw;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            Recycle((ushort)i);
+        }
+
+        Publish();
+    }
+
+    public ushort GroupId { get; }
+
+    public int Count { get; }
+
+    /// <summary>
+    /// Size of every buffer, rounded up to the cache line size.
+    /// </summary>
+    public int BufferSize { get; }
+
+    /// <summary>
+    /// Start of the buffer with the given id.
+    /// </summary>
+    public byte* GetBuffer(ushort bufferId) => _buffers + (nuint)bufferId * (nuint)BufferSize;
+
+    /// <summary>
+    /// Returns a buffer to the kernel. It is handed out again after the next <see cref="Publish"/>.
+    /// </summary>
+    public void Recycle(ushort bufferId)
+    {
+        ref var entry = ref _entries[_tail & _mask];
+        entry.addr = (ulong)GetBuffer(bufferId);
+        entry.len = (uint)BufferSize;
+        entry.bid = bufferId;
+        _tail++;
+    }
+
+    /// <summary>
+    /// Makes the recycled buffers visible to the kernel.
+    /// </summary>
+    public void Publish()
+    {
+        Volatile.Write(ref *(ushort*)((byte*)_entries + TailOffset), _tail);
+    }
+
+    public void Dispose()
+    {
+        if (_disposed)
+        {
+            return;
+        }
+
+        _disposed = true;
+        if (_registered)
+        {
+            // Requests still using the group must have completed, otherwise the kernel could write to freed memory
+            _ring.UnregisterBufferRing(GroupId);
+        }
+
+        NativeMemory.AlignedFree(_buffers);
+        NativeMemory.AlignedFree(_entries);
+    }
+}
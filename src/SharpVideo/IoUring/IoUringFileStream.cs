@@ -0,0 +1,694 @@
+using System.Runtime.InteropServices;
+using System.Runtime.Versioning;
+using Microsoft.Win32.SafeHandles;
+using SharpVideo.Linux.Native;
+using SharpVideo.Linux.Native.C;
+using SharpVideo.Linux.Native.IoUring;
+
+namespace SharpVideo.IoUring;
+
+/// <summary>
+/// A file stream doing its I/O through a private io_uring with read-ahead and write-behind in registered buffers.
+/// </summary>
+/// <remarks>
+/// Reading keeps all buffers busy with READ_FIXED requests for the data following the position, so a sequential
+/// reader mostly copies data that has already arrived and makes about one io_uring_enter call per buffer, instead of
+/// one read system call per caller chunk. Forward seeks within the read-ahead window (e.g. past interleaved tracks of
+/// a container) keep it; other seeks restart it at the new position.
+/// Writing copies into the buffers and queues a WRITE_FIXED request for every buffer that is full; the queued
+/// requests are submitted together at the end of the write call, which returns without waiting for the disk. The
+/// last partial buffer is written by <see cref="Flush"/> or on dispose, so after a crash the file may lack up to one
+/// buffer plus the writes in flight. If the buffers cannot be registered (RLIMIT_MEMLOCK) plain READ and WRITE
+/// requests on the same memory are used.
+/// A stream created with direct I/O opens the file with O_DIRECT, so written data goes from the aligned buffers to
+/// the device without passing through the page cache. Writes then have to be sequential from the start of a buffer;
+/// <see cref="Flush"/> writes the partial last buffer padded to a whole block, cuts the file back to its length and
+/// keeps filling that buffer, which is written again once it is full.
+/// Like <see cref="FileStream"/> the stream is not thread safe. Async calls complete synchronously.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed unsafe class IoUringFileStream : Stream
+{
+    public const int DefaultBufferSize = 256 * 1024;
+    public const int DefaultBufferCount = 4;
+
+    private const int BufferAlignment = 4096;
+
+    private const int EINVAL = 22;
+
+    private enum SlotState
+    {
+        Free,
+        Reading,
+        Ready,
+        Filling,
+        Writing
+    }
+
+    private struct Slot
+    {
+        public SlotState State;
+        public long Offset;
+        public int Length;
+
+        /// <summary>
+        /// Bytes read, or bytes written so far
+        /// </summary>
+        public int Done;
+    }
+
+    private readonly SafeFileHandle _handle;
+    private readonly int _fd;
+    private readonly FileAccess _access;
+    private readonly IoUringRing _ring;
+    private readonly byte* _memory;
+    private readonly int _bufferSize;
+    private readonly Slot[] _slots;
+    private readonly bool _fixedBuffers;
+    private readonly bool _directIo;
+    private readonly IoUringCqe[] _completions;
+    private long _position;
+    private long _writtenEnd;
+    private int _inFlight;
+    private int _errno;
+    private bool _disposed;
+
+    // Read-ahead: _readCount slots starting at _readHead cover consecutive file ranges up to _readAheadEnd
+    private int _readHead;
+    private int _readCount;
+    private long _readAheadEnd;
+    private long _endOfFile = long.MaxValue;
+
+    // Write-behind: the slot being filled, -1 if none
+    private int _writeSlot = -1;
+    private int _nextWriteSlot;
+
+    private IoUringFileStream(SafeFileHandle handle, FileAccess access, int bufferSize, int bufferCount, bool directIo)
+    {
+        if (bufferCount <= 0)
+        {
+            throw new ArgumentOutOfRangeException(nameof(bufferCount));
+        }
+
+        _handle = handle;
+        _access = access;
+        _directIo = directIo;
+        _bufferSize = (bufferSize + BufferAlignment - 1) & ~(BufferAlignment - 1);
+        _slots = new Slot[bufferCount];
+        _completions = new IoUringCqe[bufferCount];
+
+        _ring = IoUringRing.Create((uint)bufferCount);
+
+        // The descriptor is used directly until the stream is disposed
+        bool handleAdded = false;
+        handle.DangerousAddRef(ref handleAdded);
+        _fd = (int)handle.DangerousGetHandle();
+        _memory = (byte*)NativeMemory.AlignedAlloc((nuint)_bufferSize * (nuint)bufferCount, BufferAlignment);
+
+        var iovecs = new IoVec[bufferCount];
+        for (int i = 0; i < bufferCount; i++)
+        {
+            iovecs[i].iov_base = (nint)GetBuffer(i);
+            iovecs[i].iov_len = (nuint)_bufferSize;
+        }
+
+        try
+        {
+            _ring.RegisterBuffers(iovecs);
+            _fixedBuffers = true;
+        }
+        catch (InvalidOperationException)
+        {
+            _fixedBuffers = false;
+        }
+    }
+
+    /// <summary>
+    /// True if the kernel supports the requests the stream uses.
+    /// </summary>
+    public static bool IsSupported => IoUringRing.IsSupported;
+
+    /// <summary>
+    /// Opens an existing file for sequential reading.
+    /// </summary>
+    public static IoUringFileStream OpenRead(string path, int bufferSize = DefaultBufferSize, int bufferCount = DefaultBufferCount)
+    {
+        var handle = File.OpenHandle(path, FileMode.Open, FileAccess.Read, FileShare.Read);
+        return Wrap(handle, FileAccess.Read, bufferSize, bufferCount);
+    }
+
+    /// <summary>
+    /// Creates or truncates a file for writing.
+    /// </summary>
+    /// <param name="path">The file.</param>
+    /// <param name="bufferSize">Size of each buffer, rounded up to 4 KiB.</param>
+    /// <param name="bufferCount">Number of buffers.</param>
+    /// <param name="directIo">Bypass the page cache with O_DIRECT, see the remarks. File systems without O_DIRECT
+    /// support (e.g. tmpfs) get a buffered stream, see <see cref="UsesDirectIo"/>.</param>
+    public static IoUringFileStream Create(
+        string path,
+        int bufferSize = DefaultBufferSize,
+        int bufferCount = DefaultBufferCount,
+        bool directIo = false)
+    {
+        if (directIo && TryOpenDirect(path, out var directHandle))
+        {
+            return Wrap(directHandle, FileAccess.Write, bufferSize, bufferCount, directIo: true);
+        }
+
+        var handle = File.OpenHandle(path, FileMode.Create, FileAccess.Write, FileShare.Read);
+        return Wrap(handle, FileAccess.Write, bufferSize, bufferCount, directIo: false);
+    }
+
+    /// <summary>
+    /// True if the buffers are registered with the kernel, false if plain requests are used.
+    /// </summary>
+    public bool UsesFixedBuffers => _fixedBuffers;
+
+    /// <summary>
+    /// True if the file was opened with O_DIRECT.
+    /// </summary>
+    public bool UsesDirectIo => _directIo;
+
+    /// <summary>
+    /// Number of io_uring_enter system calls made so far.
+    /// </summary>
+    public long EnterCalls => _ring.EnterCalls;
+
+    public override bool CanRead => !_disposed && (_access & FileAccess.Read) != 0;
+
+    public override bool CanWrite => !_disposed && (_access & FileAccess.Write) != 0;
+
+    public override bool CanSeek => !_disposed;
+
+    public override long Length => Math.Max(RandomAccess.GetLength(_handle), _writtenEnd);
+
+    public override long Position
+    {
+        get => _position;
+        set
+        {
+            ArgumentOutOfRangeException.ThrowIfNegative(value);
+            _position = value;
+        }
+    }
+
+    public override long Seek(long offset, SeekOrigin origin)
+    {
+        Position = origin switch
+        {
+            SeekOrigin.Begin => offset,
+            SeekOrigin.Current => _position + offset,
+            SeekOrigin.End => Length + offset,
+            _ => throw new ArgumentOutOfRangeException(nameof(origin))
+        };
+        return _position;
+    }
+
+    public override void SetLength(long value) => throw new NotSupportedException();
+
+    public override int Read(byte[] buffer, int offset, int count) => Read(buffer.AsSpan(offset, count));
+
+    public override int Read(Span<byte> buffer)
+    {
+        ThrowIfNot(CanRead);
+        if (_writeSlot >= 0 || _inFlight > 0 && _readCount == 0)
+        {
+            Flush();
+        }
+
+        int total = 0;
+        while (!buffer.IsEmpty)
+        {
+            int slot = LocateReadSlot(_position);
+            if (slot < 0)
+            {
+                if (_position >= _endOfFile)
+                {
+                    break;
+                }
+
+                StartReadAhead(_position);
+                continue;
+            }
+
+            ref var s = ref _slots[slot];
+            if (s.State == SlotState.Reading)
+            {
+                WaitForCompletion();
+                continue;
+            }
+
+            long available = s.Offset + s.Done - _position;
+            if (available <= 0)
+            {
+                break;
+            }
+
+            int count = (int)Math.Min(available, buffer.Length);
+            new ReadOnlySpan<byte>(GetBuffer(slot) + (_position - s.Offset), count).CopyTo(buffer);
+            buffer = buffer.Slice(count);
+            _position += count;
+            total += count;
+        }
+
+        // Reads queued for consumed buffers proceed while the caller processes the data
+        if (_ring.PendingSubmissions > 0)
+        {
+            _ring.Submit();
+        }
+
+        ThrowIfFailed();
+        return total;
+    }
+
+    public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        cancellationToken.ThrowIfCancellationRequested();
+        return Task.FromResult(Read(buffer.AsSpan(offset, count)));
+    }
+
+    public override ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        cancellationToken.ThrowIfCancellationRequested();
+        return ValueTask.FromResult(Read(buffer.Span));
+    }
+
+    public override void Write(byte[] buffer, int offset, int count) => Write(buffer.AsSpan(offset, count));
+
+    public override void Write(ReadOnlySpan<byte> buffer)
+    {
+        ThrowIfNot(CanWrite);
+        if (_readCount > 0)
+        {
+            ResetReadAhead();
+        }
+
+        // A seek ends the buffer being filled
+        if (_writeSlot >= 0 && _position != _slots[_writeSlot].Offset + _slots[_writeSlot].Length)
+        {
+            if (_directIo && _slots[_writeSlot].Length % BufferAlignment != 0)
+            {
+                throw new NotSupportedException("Direct I/O writes must be sequential");
+            }
+
+            QueueWrite(_writeSlot);
+            _writeSlot = -1;
+        }
+
+        while (!buffer.IsEmpty)
+        {
+            if (_writeSlot < 0)
+            {
+                if (_directIo && _position % BufferAlignment != 0)
+                {
+                    throw new NotSupportedException("Direct I/O writes must continue at a 4 KiB aligned position");
+                }
+
+                _writeSlot = AcquireWriteSlot();
+                ref var free = ref _slots[_writeSlot];
+                free.State = SlotState.Filling;
+                free.Offset = _position;
+                free.Length = 0;
+                free.Done = 0;
+            }
+
+            ref var s = ref _slots[_writeSlot];
+            int count = Math.Min(_bufferSize - s.Length, buffer.Length);
+            buffer.Slice(0, count).CopyTo(new Span<byte>(GetBuffer(_writeSlot) + s.Length, count));
+            s.Length += count;
+            buffer = buffer.Slice(count);
+            _position += count;
+
+            if (s.Length == _bufferSize)
+            {
+                QueueWrite(_writeSlot);
+                _writeSlot = -1;
+            }
+        }
+
+        _writtenEnd = Math.Max(_writtenEnd, _position);
+        if (_ring.PendingSubmissions > 0)
+        {
+            _ring.Submit();
+        }
+
+        ThrowIfFailed();
+    }
+
+    public override Task WriteAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+    {
+        cancellationToken.ThrowIfCancellationRequested();
+        Write(buffer.AsSpan(offset, count));
+        return Task.CompletedTask;
+    }
+
+    public override ValueTask WriteAsync(ReadOnlyMemory<byte> buffer, CancellationToken cancellationToken = default)
+    {
+        cancellationToken.ThrowIfCancellationRequested();
+        Write(buffer.Span);
+        return ValueTask.CompletedTask;
+    }
+
+    /// <summary>
+    /// Writes the partially filled buffer and waits until all writes completed.
+    /// </summary>
+    public override void Flush()
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+        if (_writeSlot >= 0 && _directIo)
+        {
+            FlushDirect();
+            return;
+        }
+
+        if (_writeSlot >= 0)
+        {
+            QueueWrite(_writeSlot);
+            _writeSlot = -1;
+        }
+
+        while (_inFlight > 0)
+        {
+            WaitForCompletion();
+        }
+
+        ThrowIfFailed();
+    }
+
+    protected override void Dispose(bool disposing)
+    {
+        if (_disposed)
+        {
+            return;
+        }
+
+        try
+        {
+            if (disposing && CanWrite)
+            {
+                Flush();
+            }
+        }
+        finally
+        {
+            // The kernel must be done with the buffers before they are freed
+            try
+            {
+                while (_inFlight > 0)
+                {
+                    WaitForCompletion();
+                }
+            }
+            finally
+            {
+                _disposed = true;
+                _ring.Dispose();
+                NativeMemory.AlignedFree(_memory);
+                _handle.DangerousRelease();
+                _handle.Dispose();
+                base.Dispose(disposing);
+            }
+        }
+    }
+
+    /// <summary>
+    /// O_DIRECT needs whole blocks: writes the partial buffer padded with zeros, cuts the file back to its length and
+    /// keeps the buffer for filling
+    /// </summary>
+    private void FlushDirect()
+    {
+        ref var s = ref _slots[_writeSlot];
+        int length = s.Length;
+        int padded = (length + BufferAlignment - 1) & ~(BufferAlignment - 1);
+        new Span<byte>(GetBuffer(_writeSlot) + length, padded - length).Clear();
+        s.Length = padded;
+        QueueWrite(_writeSlot);
+
+        while (_inFlight > 0)
+        {
+            WaitForCompletion();
+        }
+
+        s.State = SlotState.Filling;
+        s.Length = length;
+        s.Done = 0;
+        ThrowIfFailed();
+        RandomAccess.SetLength(_handle, _writtenEnd);
+    }
+
+    private static bool TryOpenDirect(string path, out SafeFileHandle handle)
+    {
+        var flags = OpenFlags.O_WRONLY | OpenFlags.O_CREAT | OpenFlags.O_TRUNC | OpenFlags.O_CLOEXEC |
+                    ArchOpenFlags.O_DIRECT;
+        int fd = Libc.open(path, flags, 0b110_100_100);
+        if (fd < 0)
+        {
+            int errno = Marshal.GetLastPInvokeError();
+            if (errno != EINVAL)
+            {
+                throw new IOException($"Failed to open {path} (errno: {errno})", errno);
+            }
+
+            handle = null!;
+            return false;
+        }
+
+        handle = new SafeFileHandle(fd, ownsHandle: true);
+        return true;
+    }
+
+    private static IoUringFileStream Wrap(SafeFileHandle handle, FileAccess access, int bufferSize, int bufferCount,
+        bool directIo = false)
+    {
+        try
+        {
+            return new IoUringFileStream(handle, access, bufferSize, bufferCount, directIo);
+        }
+        catch
+        {
+            handle.Dispose();
+            throw;
+        }
+    }
+
+    private byte* GetBuffer(int slot) => _memory + (nuint)slot * (nuint)_bufferSize;
+
+    /// <summary>
+    /// Finds the read-ahead slot covering a position, recycling the slots before it
+    /// </summary>
+    /// <returns>The slot, or -1 if the position is outside the read-ahead window</returns>
+    private int LocateReadSlot(long position)
+    {
+        while (_readCount > 0)
+        {
+            ref var head = ref _slots[_readHead];
+            if (position < head.Offset || position >= _readAheadEnd)
+            {
+                ResetReadAhead();
+                return -1;
+            }
+
+            // A short read marks the end of the file
+            if (position < head.Offset + head.Length || head.State == SlotState.Ready && head.Done < head.Length)
+            {
+                return _readHead;
+            }
+
+            if (head.State == SlotState.Reading)
+            {
+                WaitForCompletion();
+                continue;
+            }
+
+            head.State = SlotState.Free;
+            _readHead = (_readHead + 1) % _slots.Length;
+            _readCount--;
+            QueueReadAhead();
+        }
+
+        return -1;
+    }
+
+    private void StartReadAhead(long position)
+    {
+        _readHead = 0;
+        _readCount = 0;
+        _readAheadEnd = position;
+        QueueReadAhead();
+    }
+
+    /// <summary>
+    /// Queues reads into the free slots for the data following the read-ahead window
+    /// </summary>
+    private void QueueReadAhead()
+    {
+        while (_readCount < _slots.Length && _readAheadEnd < _endOfFile)
+        {
+            int slot = (_readHead + _readCount) % _slots.Length;
+            ref var s = ref _slots[slot];
+            s.State = SlotState.Reading;
+            s.Offset = _readAheadEnd;
+            s.Length = _bufferSize;
+            s.Done = 0;
+            QueueRequest(GetOp(isRead: true), slot, 0);
+            _readAheadEnd += _bufferSize;
+            _readCount++;
+        }
+    }
+
+    private void ResetReadAhead()
+    {
+        while (_inFlight > 0)
+        {
+            WaitForCompletion();
+        }
+
+        for (int i = 0; i < _slots.Length; i++)
+        {
+            _slots[i].State = SlotState.Free;
+        }
+
+        _readCount = 0;
+    }
+
+    private int AcquireWriteSlot()
+    {
+        int slot = _nextWriteSlot;
+        _nextWriteSlot = (_nextWriteSlot + 1) % _slots.Length;
+        while (_slots[slot].State == SlotState.Writing)
+        {
+            WaitForCompletion();
+        }
+
+        return slot;
+    }
+
+    private void QueueWrite(int slot)
+    {
+        ref var s = ref _slots[slot];
+        if (s.Length == 0)
+        {
+            s.State = SlotState.Free;
+            return;
+        }
+
+        s.State = SlotState.Writing;
+        QueueRequest(GetOp(isRead: false), slot, 0);
+    }
+
+    private IoUringOp GetOp(bool isRead)
+    {
+        if (_fixedBuffers)
+        {
+            return isRead ? IoUringOp.IORING_OP_READ_FIXED : IoUringOp.IORING_OP_WRITE_FIXED;
+        }
+
+        return isRead ? IoUringOp.IORING_OP_READ : IoUringOp.IORING_OP_WRITE;
+    }
+
+    /// <summary>
+    /// Queues the read or write of a slot, starting <paramref name="done"/> bytes into it
+    /// </summary>
+    private void QueueRequest(IoUringOp op, int slot, int done)
+    {
+        var sqe = _ring.GetSqe();
+        while (sqe == null)
+        {
+            // Every slot has at most one request, so the queue only fills up with unsubmitted entries
+            _ring.Submit();
+            sqe = _ring.GetSqe();
+        }
+
+        ref var s = ref _slots[slot];
+        sqe->opcode = op;
+        sqe->fd = _fd;
+        sqe->off = (ulong)(s.Offset + done);
+        sqe->addr = (ulong)(GetBuffer(slot) + done);
+        sqe->len = (uint)(s.Length - done);
+        sqe->buf_index = _fixedBuffers ? (ushort)slot : (ushort)0;
+        sqe->user_data = (ulong)slot;
+        _inFlight++;
+    }
+
+    /// <summary>
+    /// Submits the queued requests and processes at least one completion
+    /// </summary>
+    private void WaitForCompletion()
+    {
+        _ring.SubmitAndWait(1);
+        int count = _ring.ReapCompletions(_completions);
+        for (int i = 0; i < count; i++)
+        {
+            OnCompletion(_completions[i]);
+        }
+    }
+
+    private void OnCompletion(in IoUringCqe cqe)
+    {
+        int slot = (int)cqe.user_data;
+        ref var s = ref _slots[slot];
+        bool isRead = s.State == SlotState.Reading;
+        _inFlight--;
+
+        if (cqe.res == -SocketConstants.EINTR || cqe.res == -SocketConstants.EAGAIN)
+        {
+            QueueRequest(GetOp(isRead), slot, s.Done);
+            return;
+        }
+
+        if (cqe.res < 0)
+        {
+            if (_errno == 0)
+            {
+                _errno = -cqe.res;
+            }
+
+            s.Done = 0;
+            s.State = isRead ? SlotState.Ready : SlotState.Free;
+            return;
+        }
+
+        if (isRead)
+        {
+            // Reads of regular files are only short at the end of the file
+            s.Done = cqe.res;
+            s.State = SlotState.Ready;
+            if (s.Done < s.Length)
+            {
+                _endOfFile = Math.Min(_endOfFile, s.Offset + s.Done);
+            }
+
+            return;
+        }
+
+        // Short writes continue with the rest of the buffer
+        s.Done += cqe.res;
+        if (s.Done < s.Length)
+        {
+            QueueRequest(GetOp(isRead), slot, s.Done);
+            return;
+        }
+
+        s.State = SlotState.Free;
+    }
+
+    private void ThrowIfNot(bool allowed)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+        if (!allowed)
+        {
+            throw new NotSupportedException();
+        }
+    }
+
+    private void ThrowIfFailed()
+    {
+        if (_errno != 0)
+        {
+            int errno = _errno;
+            _errno = 0;
+            throw new IOException($"io_uring file I/O failed (errno: {errno})", errno);
+        }
+    }
+}
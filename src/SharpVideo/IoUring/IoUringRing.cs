@@ -0,0 +1,400 @@
+using System.Diagnostics.CodeAnalysis;
+using System.Runtime.InteropServices;
+using System.Runtime.Versioning;
+using SharpVideo.Linux.Native;
+using SharpVideo.Linux.Native.C;
+using SharpVideo.Linux.Native.IoUring;
+
+namespace SharpVideo.IoUring;
+
+/// <summary>
+/// An io_uring instance: a submission and a completion ring shared with the kernel.
+/// </summary>
+/// <remarks>
+/// Entries taken with <see cref="GetSqe"/> are only queued; <see cref="Submit"/> or <see cref="SubmitAndWait"/> hand
+/// all of them to the kernel in one io_uring_enter call, and completions are read from the shared ring without a
+/// system call. The ring is not thread safe, every instance belongs to one thread at a time.
+/// </remarks>
+[SupportedOSPlatform("linux")]
+public sealed unsafe class IoUringRing : IDisposable
+{
+    /// <summary>
+    /// Setup flags that only make the ring cheaper and are dropped on kernels that do not know them.
+    /// </summary>
+    private const IoUringSetupFlags OptionalFlags =
+        IoUringSetupFlags.IORING_SETUP_SINGLE_ISSUER |
+        IoUringSetupFlags.IORING_SETUP_DEFER_TASKRUN |
+        IoUringSetupFlags.IORING_SETUP_COOP_TASKRUN;
+
+    private static readonly Lazy<bool> _isSupported = new(Probe);
+
+    private readonly int _fd;
+    private readonly byte* _sqRing;
+    private readonly nuint _sqRingSize;
+    private readonly byte* _cqRing;
+    private readonly nuint _cqRingSize;
+    private readonly IoUringSqe* _sqes;
+    private readonly nuint _sqesSize;
+
+    private readonly uint* _sqHead;
+    private readonly uint* _sqTail;
+    private readonly uint _sqMask;
+    private readonly uint _sqEntries;
+    private readonly uint* _cqHead;
+    private readonly uint* _cqTail;
+    private readonly uint _cqMask;
+    private readonly IoUringCqe* _cqes;
+
+    // Tail of the queued entries, published to the kernel on submit
+    private uint _sqeTail;
+    private bool _disposed;
+
+    private IoUringRing(int fd, in IoUringParams p)
+    {
+        _fd = fd;
+        Features = p.features;
+        SetupFlags = p.flags;
+
+        try
+        {
+            _sqRingSize = p.sq_off.array + p.sq_entries * sizeof(uint);
+            _cqRingSize = p.cq_off.cqes + p.cq_entries * (uint)sizeof(IoUringCqe);
+            bool singleMmap = (p.features & IoUringConstants.IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMmap)
+            {
+                _sqRingSize = _cqRingSize = Math.Max(_sqRingSize, _cqRingSize);
+            }
+
+            _sqRing = Map(_sqRingSize, IoUringConstants.IORING_OFF_SQ_RING);
+            _cqRing = singleMmap ? _sqRing : Map(_cqRingSize, IoUringConstants.IORING_OFF_CQ_RING);
+            _sqesSize = p.sq_entries * (uint)sizeof(IoUringSqe);
+            _sqes = (IoUringSqe*)Map(_sqesSize, IoUringConstants.IORING_OFF_SQES);
+        }
+        catch
+        {
+            Unmap();
+            Libc.close(fd);
+            throw;
+        }
+
+        _sqHead = (uint*)(_sqRing + p.sq_off.head);
+        _sqTail = (uint*)(_sqRing + p.sq_off.tail);
+        _sqMask = *(uint*)(_sqRing + p.sq_off.ring_mask);
+        _sqEntries = *(uint*)(_sqRing + p.sq_off.ring_entries);
+        _cqHead = (uint*)(_cqRing + p.cq_off.head);
+        _cqTail = (uint*)(_cqRing + p.cq_off.tail);
+        _cqMask = *(uint*)(_cqRing + p.cq_off.ring_mask);
+        _cqes = (IoUringCqe*)(_cqRing + p.cq_off.cqes);
+
+        // Submission slot i always refers to entry i, so only the tail has to be published
+        var array = (uint*)(_sqRing + p.sq_off.array);
+        for (uint i = 0; i < _sqEntries; i++)
+        {
+            array[i] = i;
+        }
+
+        _sqeTail = *_sqTail;
+    }
+
+    /// <summary>
+    /// True if the kernel provides io_uring and it is not disabled (kernel.io_uring_disabled, seccomp).
+    /// </summary>
+    public static bool IsSupported => _isSupported.Value;
+
+    /// <summary>
+    /// The ring file descriptor.
+    /// </summary>
+    public int Fd => _fd;
+
+    /// <summary>
+    /// IORING_FEAT_* flags of the kernel.
+    /// </summary>
+    public uint Features { get; }
+
+    /// <summary>
+    /// Setup flags the ring was created with, optional flags the kernel does not support are removed.
+    /// </summary>
+    public IoUringSetupFlags SetupFlags { get; }
+
+    public uint SubmissionQueueSize => _sqEntries;
+
+    /// <summary>
+    /// Number of io_uring_enter calls, i.e. the system calls made for submitting and waiting.
+    /// </summary>
+    public long EnterCalls { get; private set; }
+
+    /// <summary>
+    /// Creates a ring with at least <paramref name="entries"/> submission entries.
+    /// </summary>
+    /// <param name="entries">Submission queue size, rounded up to a power of two by the kernel.</param>
+    /// <param name="flags">Setup flags. SINGLE_ISSUER, DEFER_TASKRUN and COOP_TASKRUN are dropped if the kernel
+    /// rejects them.</param>
+    /// <param name="completionEntries">Completion queue size, 0 for twice the submission queue. Multishot requests
+    /// need room for many completions per submission.</param>
+    /// <param name="ring">The ring, or null.</param>
+    /// <param name="errno">Error of io_uring_setup if it failed.</param>
+    public static bool TryCreate(uint entries, IoUringSetupFlags flags, uint completionEntries,
+        [NotNullWhen(true)] out IoUringRing? ring, out int errno)
+    {
+        if (completionEntries > 0)
+        {
+            flags |= IoUringSetupFlags.IORING_SETUP_CQSIZE | IoUringSetupFlags.IORING_SETUP_CLAMP;
+        }
+
+        while (true)
+        {
+            var p = new IoUringParams { flags = flags, cq_entries = completionEntries };
+            int fd = Libc.io_uring_setup(entries, &p);
+            if (fd >= 0)
+            {
+                ring = new IoUringRing(fd, p);
+                errno = 0;
+                return true;
+            }
+
+            errno = Marshal.GetLastPInvokeError();
+            if (errno != IoUringConstants.EINVAL || (flags & OptionalFlags) == 0)
+            {
+                ring = null;
+                return false;
+            }
+
+            // DEFER_TASKRUN (6.1) depends on SINGLE_ISSUER (6.0), COOP_TASKRUN is older (5.19)
+            flags &= (flags & IoUringSetupFlags.IORING_SETUP_DEFER_TASKRUN) != 0
+                ? ~IoUringSetupFlags.IORING_SETUP_DEFER_TASKRUN
+                : ~OptionalFlags;
+        }
+    }
+
+    /// <inheritdoc cref="TryCreate"/>
+    /// <exception cref="InvalidOperationException">io_uring_setup failed.</exception>
+    public static IoUringRing Create(uint entries, IoUringSetupFlags flags = IoUringSetupFlags.None, uint completionEntries = 0)
+    {
+        if (TryCreate(entries, flags, completionEntries, out var ring, out int errno))
+        {
+            return ring;
+        }
+
+        throw new InvalidOperationException($"io_uring_setup failed (errno: {errno})");
+    }
+
+    /// <summary>
+    /// Returns the next free submission entry, cleared, or null if the queue is full. The entry is queued and
+    /// submitted with the next <see cref="Submit"/>.
+    /// </summary>
+    public IoUringSqe* GetSqe()
+    {
+        if (_sqeTail - Volatile.Read(ref *_sqHead) >= _sqEntries)
+        {
+            return null;
+        }
+
+        var sqe = &_sqes[_sqeTail & _sqMask];
+        *sqe = default;
+        _sqeTail++;
+        return sqe;
+    }
+
+    /// <summary>
+    /// Number of entries queued and not submitted yet.
+    /// </summary>
+    public uint PendingSubmissions => _sqeTail - Volatile.Read(ref *_sqHead);
+
+    /// <summary>
+    /// Submits all queued entries without waiting.
+    /// </summary>
+    /// <returns>Number of entries submitted.</returns>
+    /// <exception cref="InvalidOperationException">io_uring_enter failed.</exception>
+    public int Submit()
+    {
+        uint toSubmit = Publish();
+        return toSubmit == 0 ? 0 : Enter(toSubmit, 0, 0, null, 0);
+    }
+
+    /// <summary>
+    /// Submits all queued entries and waits until at least <paramref name="waitCount"/> completions are available.
+    /// No system call is made if nothing is queued and the completions are already there.
+    /// </summary>
+    /// <param name="waitCount">Completions to wait for.</param>
+    /// <param name="timeoutMs">Maximum wait, <see cref="Timeout.Infinite"/> to wait without a limit.</param>
+    /// <returns>False if the timeout expired first.</returns>
+    /// <exception cref="InvalidOperationException">io_uring_enter failed.</exception>
+    public bool SubmitAndWait(uint waitCount, int timeoutMs = Timeout.Infinite)
+    {
+        uint toSubmit = Publish();
+        if (toSubmit == 0 && CompletionCount >= waitCount)
+        {
+            return true;
+        }
+
+        if (timeoutMs == Timeout.Infinite)
+        {
+            return Enter(toSubmit, waitCount, IoUringConstants.IORING_ENTER_GETEVENTS, null, 0) >= 0;
+        }
+
+        var timeout = new TimeSpec
+        {
+            tv_sec = timeoutMs / 1000,
+            tv_nsec = timeoutMs % 1000 * 1_000_000L
+        };
+        var arg = new IoUringGeteventsArg { ts = (ulong)&timeout };
+        return Enter(toSubmit, waitCount, IoUringConstants.IORING_ENTER_GETEVENTS | IoUringConstants.IORING_ENTER_EXT_ARG,
+            &arg, (nuint)sizeof(IoUringGeteventsArg)) >= 0;
+    }
+
+    /// <summary>
+    /// Number of completions ready to be reaped.
+    /// </summary>
+    public uint CompletionCount => Volatile.Read(ref *_cqTail) - *_cqHead;
+
+    /// <summary>
+    /// Copies ready completions and releases their ring slots to the kernel.
+    /// </summary>
+    /// <returns>Number of completions copied.</returns>
+    public int ReapCompletions(Span<IoUringCqe> destination)
+    {
+        uint head = *_cqHead;
+        uint count = Math.Min(Volatile.Read(ref *_cqTail) - head, (uint)destination.Length);
+        for (uint i = 0; i < count; i++)
+        {
+            destination[(int)i] = _cqes[(head + i) & _cqMask];
+        }
+
+        Volatile.Write(ref *_cqHead, head + count);
+        return (int)count;
+    }
+
+    /// <summary>
+    /// Registers fixed buffers for READ_FIXED and WRITE_FIXED. The memory stays pinned until the ring is disposed.
+    /// </summary>
+    /// <exception cref="InvalidOperationException">The kernel refused, e.g. over RLIMIT_MEMLOCK.</exception>
+    public void RegisterBuffers(ReadOnlySpan<IoVec> buffers)
+    {
+        fixed (IoVec* iovecs = buffers)
+        {
+            Register(IoUringConstants.IORING_REGISTER_BUFFERS, iovecs, (uint)buffers.Length, "IORING_REGISTER_BUFFERS");
+        }
+    }
+
+    /// <summary>
+    /// Registers a ring of provided buffers as buffer group <paramref name="groupId"/> (kernel 5.19).
+    /// </summary>
+    /// <param name="entries">Page aligned array of <paramref name="count"/> entries.</param>
+    /// <param name="count">Number of entries, a power of two.</param>
+    /// <param name="groupId">Group selected by requests with IOSQE_BUFFER_SELECT.</param>
+    /// <exception cref="InvalidOperationException">The kernel refused.</exception>
+    public void RegisterBufferRing(IoUringBuf* entries, uint count, ushort groupId)
+    {
+        var reg = new IoUringBufReg
+        {
+            ring_addr = (ulong)entries,
+            ring_entries = count,
+            bgid = groupId
+        };
+        Register(IoUringConstants.IORING_REGISTER_PBUF_RING, &reg, 1, "IORING_REGISTER_PBUF_RING");
+    }
+
+    public void UnregisterBufferRing(ushort groupId)
+    {
+        var reg = new IoUringBufReg { bgid = groupId };
+        Register(IoUringConstants.IORING_UNREGISTER_PBUF_RING, &reg, 1, "IORING_UNREGISTER_PBUF_RING");
+    }
+
+    public void Dispose()
+    {
+        if (_disposed)
+        {
+            return;
+        }
+
+        _disposed = true;
+        Unmap();
+        Libc.close(_fd);
+    }
+
+    private uint Publish()
+    {
+        Volatile.Write(ref *_sqTail, _sqeTail);
+        return _sqeTail - Volatile.Read(ref *_sqHead);
+    }
+
+    /// <returns>Number of entries submitted, -1 if the wait was interrupted or timed out.</returns>
+    private int Enter(uint toSubmit, uint waitCount, uint flags, void* arg, nuint argSize)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+
+        EnterCalls++;
+        int result = Libc.io_uring_enter(_fd, toSubmit, waitCount, flags, arg, argSize);
+        if (result >= 0)
+        {
+            return result;
+        }
+
+        int errno = Marshal.GetLastPInvokeError();
+        if (errno == SocketConstants.EINTR || errno == IoUringConstants.ETIME)
+        {
+            return -1;
+        }
+
+        // The completion ring is full: the caller has to reap before more can be submitted
+        if (errno == IoUringConstants.EBUSY || errno == SocketConstants.EAGAIN)
+        {
+            return 0;
+        }
+
+        throw new InvalidOperationException($"io_uring_enter failed (errno: {errno})");
+    }
+
+    private void Register(uint opcode, void* arg, uint count, string name)
+    {
+        ObjectDisposedException.ThrowIf(_disposed, this);
+
+        if (Libc.io_uring_register(_fd, opcode, arg, count) < 0)
+        {
+            throw new InvalidOperationException($"{name} failed (errno: {Marshal.GetLastPInvokeError()})");
+        }
+    }
+
+    private byte* Map(nuint size, long offset)
+    {
+        var map = Libc.mmap(IntPtr.Zero, size, ProtFlags.PROT_READ | ProtFlags.PROT_WRITE,
+            MapFlags.MAP_SHARED | MapFlags.MAP_POPULATE, _fd, (nint)offset);
+        if (map == Libc.MAP_FAILED)
+        {
+            throw new InvalidOperationException($"Mapping the io_uring rings failed (errno: {Marshal.GetLastPInvokeError()})");
+        }
+
+        return (byte*)map;
+    }
+
+    private void Unmap()
+    {
+        if (_sqes != null)
+        {
+            Libc.munmap(_sqes, _sqesSize);
+        }
+
+        if (_cqRing != null && _cqRing != _sqRing)
+        {
+            Libc.munmap(_cqRing, _cqRingSize);
+        }
+
+        if (_sqRing != null)
+        {
+            Libc.munmap(_sqRing, _sqRingSize);
+        }
+    }
+
+    private static bool Probe()
+    {
+        if (!TryCreate(2, IoUringSetupFlags.None, 0, out var ring, out _))
+        {
+            return false;
+        }
+
+        // Waiting with a timeout needs IORING_ENTER_EXT_ARG (5.11)
+        bool supported = (ring.Features & IoUringConstants.IORING_FEAT_EXT_ARG) != 0;
+        ring.Dispose();
+        return supported;
+    }
+}
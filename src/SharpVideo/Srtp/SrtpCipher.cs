@@ -0,0 +1,423 @@
+using System.Buffers.Binary;
+using System.Numerics;
+using System.Runtime.InteropServices;
+using System.Security.Cryptography;
+
+namespace SharpVideo.Srtp;
+
+/// <summary>
+/// Session keys and packet transforms of one SRTP or SRTCP direction (RFC 3711, RFC 7714).
+/// </summary>
+/// <remarks>
+/// AES runs through System.Security.Cryptography, i.e. OpenSSL with AES-NI or the ARMv8 crypto extensions. AES-CM
+/// encrypts all counter blocks of a packet with one ECB call on a cached transform and XORs the key stream with
+/// vector instructions, so the payload is decrypted in place in the receive buffer. The key stream and packet index
+/// are the caller's business; not thread safe.
+/// </remarks>
+public sealed class SrtpCipher : IDisposable
+{
+    // Key derivation labels (RFC 3711 4.3.1).
+    internal const byte LABEL_RTP_ENCRYPTION = 0x00;
+    internal const byte LABEL_RTP_AUTHENTICATION = 0x01;
+    internal const byte LABEL_RTP_SALT = 0x02;
+    internal const byte LABEL_RTCP_ENCRYPTION = 0x03;
+    internal const byte LABEL_RTCP_AUTHENTICATION = 0x04;
+    internal const byte LABEL_RTCP_SALT = 0x05;
+
+    private const int RTCP_HEADER_LENGTH = 4;
+
+    private const int AES_BLOCK_SIZE = 16;
+    private const int CM_SALT_LENGTH = 14;
+    private const int GCM_IV_LENGTH = 12;
+    private const int AUTH_KEY_LENGTH = 20;
+    private const int HMAC_SHA1_LENGTH = 20;
+
+    /// <summary>
+    /// Length of the E flag and SRTCP index trailer.
+    /// </summary>
+    public const int SRTCP_INDEX_LENGTH = 4;
+
+    private readonly bool _isAead;
+    private readonly byte[] _sessionSalt;
+    private readonly Aes? _aes;
+    private readonly ICryptoTransform? _ecb;
+    private readonly IncrementalHash? _hmac;
+    private readonly AesGcm? _gcm;
+    private byte[] _counterBlocks = new byte[2048];
+    private byte[] _keyStream = new byte[2048];
+    private byte[] _associatedData = new byte[256];
+
+    /// <param name="policy">Suite and master key.</param>
+    /// <param name="isRtcp">Derive the SRTCP instead of the SRTP session keys.</param>
+    public SrtpCipher(SrtpPolicy policy, bool isRtcp)
+        : this(
+            policy.IsAead,
+            isRtcp ? policy.RtcpTagLength : policy.RtpTagLength,
+            DeriveKey(policy, isRtcp ? LABEL_RTCP_ENCRYPTION : LABEL_RTP_ENCRYPTION, policy.MasterKey.Length),
+            DeriveKey(policy, isRtcp ? LABEL_RTCP_SALT : LABEL_RTP_SALT, policy.MasterSalt.Length),
+            policy.IsAead
+                ? null
+                : DeriveKey(policy, isRtcp ? LABEL_RTCP_AUTHENTICATION : LABEL_RTP_AUTHENTICATION, AUTH_KEY_LENGTH))
+    {
+    }
+
+    /// <summary>
+    /// Creates a cipher from session keys, e.g. those of a test vector. Takes the arrays over and clears the keys.
+    /// </summary>
+    internal SrtpCipher(bool isAead, int tagLength, byte[] sessionKey, byte[] sessionSalt, byte[]? authKey)
+    {
+        _isAead = isAead;
+        TagLength = tagLength;
+        _sessionSalt = sessionSalt;
+
+        if (_isAead)
+        {
+            _gcm = new AesGcm(sessionKey, TagLength);
+        }
+        else
+        {
+            _aes = Aes.Create();
+            _aes.Key = sessionKey;
+            _aes.Mode = CipherMode.ECB;
+            _aes.Padding = PaddingMode.None;
+            _ecb = _aes.CreateEncryptor();
+
+            ArgumentNullException.ThrowIfNull(authKey);
+            _hmac = IncrementalHash.CreateHMAC(HashAlgorithmName.SHA1, authKey);
+            CryptographicOperations.ZeroMemory(authKey);
+        }
+
+        CryptographicOperations.ZeroMemory(sessionKey);
+    }
+
+    /// <summary>
+    /// Length of the authentication tag at the end of a protected packet.
+    /// </summary>
+    public int TagLength { get; }
+
+    /// <summary>
+    /// Authenticates and decrypts an SRTP packet in place.
+    /// </summary>
+    /// <param name="packet">The packet including the tag.</param>
+    /// <param name="headerLength">Length of the RTP header including CSRCs and extension.</param>
+    /// <param name="ssrc">SSRC of the packet.</param>
+    /// <param name="index">48 bit packet index, ROC and sequence number.</param>
+    /// <param name="length">Length of the plain RTP packet.</param>
+    /// <returns>False if the packet is not authentic.</returns>
+    public bool TryUnprotectRtp(Span<byte> packet, int headerLength, uint ssrc, ulong index, out int length)
+    {
+        length = packet.Length - TagLength;
+        if (length < headerLength)
+        {
+            return false;
+        }
+
+        var tag = packet.Slice(length, TagLength);
+        var payload = packet.Slice(headerLength, length - headerLength);
+        if (_isAead)
+        {
+            Span<byte> iv = stackalloc byte[GCM_IV_LENGTH];
+            WriteRtpGcmIv(iv, ssrc, index);
+            return TryDecryptGcm(iv, payload, tag, packet.Slice(0, headerLength));
+        }
+
+        Span<byte> roc = stackalloc byte[4];
+        BinaryPrimitives.WriteUInt32BigEndian(roc, (uint)(index >> 16));
+        if (!VerifyHmac(packet.Slice(0, length), roc, tag))
+        {
+            return false;
+        }
+
+        ApplyKeyStream(payload, ssrc, index);
+        return true;
+    }
+
+    /// <summary>
+    /// Encrypts an RTP packet in place and appends the tag.
+    /// </summary>
+    /// <param name="buffer">Buffer holding the packet, with room for the tag.</param>
+    /// <param name="length">Length of the RTP packet.</param>
+    /// <param name="headerLength">Length of the RTP header including CSRCs and extension.</param>
+    /// <param name="ssrc">SSRC of the packet.</param>
+    /// <param name="index">48 bit packet index, ROC and sequence number.</param>
+    /// <returns>Length of the SRTP packet.</returns>
+    public int ProtectRtp(Span<byte> buffer, int length, int headerLength, uint ssrc, ulong index)
+    {
+        var payload = buffer.Slice(headerLength, length - headerLength);
+        var tag = buffer.Slice(length, TagLength);
+        if (_isAead)
+        {
+            Span<byte> iv = stackalloc byte[GCM_IV_LENGTH];
+            WriteRtpGcmIv(iv, ssrc, index);
+            _gcm!.Encrypt(iv, payload, payload, tag, buffer.Slice(0, headerLength));
+        }
+        else
+        {
+            ApplyKeyStream(payload, ssrc, index);
+            Span<byte> roc = stackalloc byte[4];
+            BinaryPrimitives.WriteUInt32BigEndian(roc, (uint)(index >> 16));
+            WriteHmac(buffer.Slice(0, length), roc, tag);
+        }
+
+        return length + TagLength;
+    }
+
+    /// <summary>
+    /// Authenticates and decrypts an SRTCP packet in place.
+    /// </summary>
+    /// <param name="packet">The packet including index and tag.</param>
+    /// <param name="index">31 bit SRTCP index of the packet.</param>
+    /// <param name="length">Length of the plain compound RTCP packet.</param>
+    /// <returns>False if the packet is not authentic.</returns>
+    public bool TryUnprotectRtcp(Span<byte> packet, out uint index, out int length)
+    {
+        index = 0;
+        length = packet.Length - TagLength - SRTCP_INDEX_LENGTH;
+        if (length < RTCP_HEADER_LENGTH + 4)
+        {
+            return false;
+        }
+
+        uint ssrc = BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(4));
+        if (_isAead)
+        {
+            // Header, encrypted part and tag, then the E flag and index (RFC 7714 9).
+            var trailer = packet.Slice(packet.Length - SRTCP_INDEX_LENGTH);
+            uint eAndIndex = BinaryPrimitives.ReadUInt32BigEndian(trailer);
+            index = eAndIndex & 0x7FFFFFFF;
+
+            Span<byte> iv = stackalloc byte[GCM_IV_LENGTH];
+            WriteRtcpGcmIv(iv, ssrc, index);
+            var tag = packet.Slice(length, TagLength);
+            if ((eAndIndex & 0x80000000) == 0)
+            {
+                // Authenticated only: everything is associated data. The length comes from the packet, so the copy
+                // goes to a reused buffer rather than the stack.
+                if (_associatedData.Length < length + SRTCP_INDEX_LENGTH)
+                {
+                    _associatedData = new byte[length + SRTCP_INDEX_LENGTH];
+                }
+
+                var aadOnly = _associatedData.AsSpan(0, length + SRTCP_INDEX_LENGTH);
+                packet.Slice(0, length).CopyTo(aadOnly);
+                trailer.CopyTo(aadOnly.Slice(length));
+                return TryDecryptGcm(iv, Span<byte>.Empty, tag, aadOnly);
+            }
+
+            Span<byte> aad = stackalloc byte[8 + SRTCP_INDEX_LENGTH];
+            packet.Slice(0, 8).CopyTo(aad);
+            trailer.CopyTo(aad.Slice(8));
+            return TryDecryptGcm(iv, packet.Slice(8, length - 8), tag, aad);
+        }
+        else
+        {
+            // Header, encrypted part, E flag and index, then the tag over all of it (RFC 3711 3.4).
+            var authenticated = packet.Slice(0, length + SRTCP_INDEX_LENGTH);
+            if (!VerifyHmac(authenticated, ReadOnlySpan<byte>.Empty, packet.Slice(authenticated.Length, TagLength)))
+            {
+                return false;
+            }
+
+            uint eAndIndex = BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(length));
+            index = eAndIndex & 0x7FFFFFFF;
+            if ((eAndIndex & 0x80000000) != 0)
+            {
+                ApplyKeyStream(packet.Slice(8, length - 8), ssrc, index);
+            }
+
+            return true;
+        }
+    }
+
+    /// <summary>
+    /// Encrypts a compound RTCP packet in place and appends the index and tag.
+    /// </summary>
+    /// <param name="buffer">Buffer holding the packet, with room for <see cref="SRTCP_INDEX_LENGTH"/> + tag bytes.</param>
+    /// <param name="length">Length of the RTCP packet.</param>
+    /// <param name="index">31 bit SRTCP index, incremented by the caller for every packet.</param>
+    /// <returns>Length of the SRTCP packet.</returns>
+    public int ProtectRtcp(Span<byte> buffer, int length, uint index)
+    {
+        uint ssrc = BinaryPrimitives.ReadUInt32BigEndian(buffer.Slice(4));
+        uint eAndIndex = 0x80000000 | (index & 0x7FFFFFFF);
+        if (_isAead)
+        {
+            var trailer = buffer.Slice(length + TagLength, SRTCP_INDEX_LENGTH);
+            BinaryPrimitives.WriteUInt32BigEndian(trailer, eAndIndex);
+
+            Span<byte> iv = stackalloc byte[GCM_IV_LENGTH];
+            WriteRtcpGcmIv(iv, ssrc, index);
+            Span<byte> aad = stackalloc byte[8 + SRTCP_INDEX_LENGTH];
+            buffer.Slice(0, 8).CopyTo(aad);
+            trailer.CopyTo(aad.Slice(8));
+            var encrypted = buffer.Slice(8, length - 8);
+            _gcm!.Encrypt(iv, encrypted, encrypted, buffer.Slice(length, TagLength), aad);
+        }
+        else
+        {
+            ApplyKeyStream(buffer.Slice(8, length - 8), ssrc, index);
+            BinaryPrimitives.WriteUInt32BigEndian(buffer.Slice(length), eAndIndex);
+            WriteHmac(buffer.Slice(0, length + SRTCP_INDEX_LENGTH), ReadOnlySpan<byte>.Empty,
+                buffer.Slice(length + SRTCP_INDEX_LENGTH, TagLength));
+        }
+
+        return length + SRTCP_INDEX_LENGTH + TagLength;
+    }
+
+    private bool TryDecryptGcm(ReadOnlySpan<byte> iv, Span<byte> data, ReadOnlySpan<byte> tag, ReadOnlySpan<byte> associatedData)
+    {
+        try
+        {
+            _gcm!.Decrypt(iv, data, tag, data, associatedData);
+            return true;
+        }
+        catch (AuthenticationTagMismatchException)
+        {
+            return false;
+        }
+    }
+
+    private bool VerifyHmac(ReadOnlySpan<byte> data, ReadOnlySpan<byte> suffix, ReadOnlySpan<byte> tag)
+    {
+        Span<byte> expected = stackalloc byte[HMAC_SHA1_LENGTH];
+        WriteHmac(data, suffix, expected);
+        return CryptographicOperations.FixedTimeEquals(expected.Slice(0, TagLength), tag);
+    }
+
+    private void WriteHmac(ReadOnlySpan<byte> data, ReadOnlySpan<byte> suffix, Span<byte> tag)
+    {
+        Span<byte> hash = stackalloc byte[HMAC_SHA1_LENGTH];
+        _hmac!.AppendData(data);
+        if (!suffix.IsEmpty)
+        {
+            _hmac.AppendData(suffix);
+        }
+
+        _hmac.GetHashAndReset(hash);
+        hash.Slice(0, tag.Length).CopyTo(tag);
+    }
+
+    /// <summary>
+    /// XORs <paramref name="data"/> with the AES-CM key stream of a packet (RFC 3711 4.1.1):
+    /// IV = (salt * 2^16) XOR (SSRC * 2^64) XOR (index * 2^16).
+    /// </summary>
+    internal void ApplyKeyStream(Span<byte> data, uint ssrc, ulong index)
+    {
+        if (data.IsEmpty)
+        {
+            return;
+        }
+
+        int blocks = (data.Length + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+        int streamLength = blocks * AES_BLOCK_SIZE;
+        if (_counterBlocks.Length < streamLength)
+        {
+            _counterBlocks = new byte[streamLength];
+            _keyStream = new byte[streamLength];
+        }
+
+        Span<byte> iv = stackalloc byte[AES_BLOCK_SIZE];
+        _sessionSalt.CopyTo(iv);
+        iv[14] = 0;
+        iv[15] = 0;
+        BinaryPrimitives.WriteUInt32BigEndian(iv.Slice(4), BinaryPrimitives.ReadUInt32BigEndian(iv.Slice(4)) ^ ssrc);
+        for (int i = 0; i < 6; i++)
+        {
+            iv[8 + i] ^= (byte)(index >> (40 - 8 * i));
+        }
+
+        // The 16 bit block counter is added to the IV, payloads stay far below 2^16 blocks so it never carries.
+        ushort ivCounter = BinaryPrimitives.ReadUInt16BigEndian(iv.Slice(14));
+        var counters = _counterBlocks.AsSpan(0, streamLength);
+        for (int block = 0; block < blocks; block++)
+        {
+            var counter = counters.Slice(block * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+            iv.CopyTo(counter);
+            BinaryPrimitives.WriteUInt16BigEndian(counter.Slice(14), (ushort)(ivCounter + block));
+        }
+
+        _ecb!.TransformBlock(_counterBlocks, 0, streamLength, _keyStream, 0);
+        Xor(data, _keyStream.AsSpan(0, data.Length));
+    }
+
+    private static void Xor(Span<byte> data, ReadOnlySpan<byte> keyStream)
+    {
+        int i = 0;
+        if (Vector.IsHardwareAccelerated && data.Length >= Vector<byte>.Count)
+        {
+            var dataVectors = MemoryMarshal.Cast<byte, Vector<byte>>(data);
+            var keyVectors = MemoryMarshal.Cast<byte, Vector<byte>>(keyStream);
+            for (int v = 0; v < dataVectors.Length; v++)
+            {
+                dataVectors[v] ^= keyVectors[v];
+            }
+
+            i = dataVectors.Length * Vector<byte>.Count;
+        }
+
+        for (; i < data.Length; i++)
+        {
+            data[i] ^= keyStream[i];
+        }
+    }
+
+    private void WriteRtpGcmIv(Span<byte> iv, uint ssrc, ulong index)
+    {
+        // 00 00 || SSRC || ROC || SEQ, XOR salt (RFC 7714 8.1).
+        iv.Slice(0, 2).Clear();
+        BinaryPrimitives.WriteUInt32BigEndian(iv.Slice(2), ssrc);
+        BinaryPrimitives.WriteUInt32BigEndian(iv.Slice(6), (uint)(index >> 16));
+        BinaryPrimitives.WriteUInt16BigEndian(iv.Slice(10), (ushort)index);
+        XorSalt(iv);
+    }
+
+    private void WriteRtcpGcmIv(Span<byte> iv, uint ssrc, uint index)
+    {
+        // 00 00 || SSRC || 00 00 || 0 + SRTCP index, XOR salt (RFC 7714 9.1).
+        iv.Slice(0, 2).Clear();
+        BinaryPrimitives.WriteUInt32BigEndian(iv.Slice(2), ssrc);
+        iv.Slice(6, 2).Clear();
+        BinaryPrimitives.WriteUInt32BigEndian(iv.Slice(8), index & 0x7FFFFFFF);
+        XorSalt(iv);
+    }
+
+    private void XorSalt(Span<byte> iv)
+    {
+        for (int i = 0; i < GCM_IV_LENGTH; i++)
+        {
+            iv[i] ^= _sessionSalt[i];
+        }
+    }
+
+    /// <summary>
+    /// AES-CM key derivation with a key derivation rate of 0 (RFC 3711 4.3): the key stream of
+    /// IV = (master salt XOR label * 2^48) * 2^16 under the master key. GCM master salts are 96 bits and padded with
+    /// zeros to the 112 bits of the PRF input (RFC 7714 11).
+    /// </summary>
+    internal static byte[] DeriveKey(SrtpPolicy policy, byte label, int length)
+    {
+        using var aes = Aes.Create();
+        aes.Key = policy.MasterKey;
+
+        int blocks = (length + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+        var counters = new byte[blocks * AES_BLOCK_SIZE];
+        for (int block = 0; block < blocks; block++)
+        {
+            var counter = counters.AsSpan(block * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+            policy.MasterSalt.CopyTo(counter);
+            counter[7] ^= label;
+            BinaryPrimitives.WriteUInt16BigEndian(counter.Slice(CM_SALT_LENGTH), (ushort)block);
+        }
+
+        var keyStream = aes.EncryptEcb(counters, PaddingMode.None);
+        return keyStream[..length];
+    }
+
+    public void Dispose()
+    {
+        _ecb?.Dispose();
+        _aes?.Dispose();
+        _hmac?.Dispose();
+        _gcm?.Dispose();
+    }
+}
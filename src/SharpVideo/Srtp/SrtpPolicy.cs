@@ -0,0 +1,137 @@
+namespace SharpVideo.Srtp;
+
+/// <summary>
+/// Crypto suite and master key of an SRTP session, as negotiated with SDES or configured out of band.
+/// </summary>
+/// <remarks>
+/// Only the defaults of RFC 3711 are supported: a key derivation rate of 0 and no MKI, which is what SDES
+/// offers in practice.
+/// </remarks>
+public sealed class SrtpPolicy
+{
+    private const string INLINE_PREFIX = "inline:";
+    private const string CRYPTO_ATTRIBUTE_PREFIX = "a=crypto:";
+
+    public SrtpPolicy(SrtpProtectionProfile profile, byte[] masterKey, byte[] masterSalt)
+    {
+        var (keyLength, saltLength) = GetMasterKeyLengths(profile);
+        if (masterKey.Length != keyLength)
+        {
+            throw new ArgumentException($"{profile} requires a {keyLength} byte master key, got {masterKey.Length}.", nameof(masterKey));
+        }
+
+        if (masterSalt.Length != saltLength)
+        {
+            throw new ArgumentException($"{profile} requires a {saltLength} byte master salt, got {masterSalt.Length}.", nameof(masterSalt));
+        }
+
+        Profile = profile;
+        MasterKey = masterKey;
+        MasterSalt = masterSalt;
+    }
+
+    public SrtpProtectionProfile Profile { get; }
+
+    public byte[] MasterKey { get; }
+
+    public byte[] MasterSalt { get; }
+
+    /// <summary>
+    /// True for the AES-GCM suites, which authenticate with the cipher instead of HMAC-SHA1.
+    /// </summary>
+    public bool IsAead => Profile is SrtpProtectionProfile.AEAD_AES_128_GCM or SrtpProtectionProfile.AEAD_AES_256_GCM;
+
+    /// <summary>
+    /// Length of the authentication tag appended to SRTP packets.
+    /// </summary>
+    public int RtpTagLength => Profile switch
+    {
+        SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_32 or SrtpProtectionProfile.AES_256_CM_HMAC_SHA1_32 => 4,
+        SrtpProtectionProfile.AEAD_AES_128_GCM or SrtpProtectionProfile.AEAD_AES_256_GCM => 16,
+        _ => 10,
+    };
+
+    /// <summary>
+    /// Length of the authentication tag appended to SRTCP packets, 80 bits for the _32 suites as well (RFC 4568 6.2).
+    /// </summary>
+    public int RtcpTagLength => IsAead ? 16 : 10;
+
+    /// <summary>
+    /// Parses an SDES crypto attribute such as
+    /// <c>a=crypto:1 AES_CM_128_HMAC_SHA1_80 inline:WVNfX19zZW1jdGwgKCkgewkyMjA7fQp9CnVubGVz|2^20</c>.
+    /// The <c>a=crypto:</c> prefix and tag are optional.
+    /// </summary>
+    public static SrtpPolicy Parse(string cryptoAttribute)
+    {
+        var text = cryptoAttribute.Trim();
+        if (text.StartsWith(CRYPTO_ATTRIBUTE_PREFIX, StringComparison.OrdinalIgnoreCase))
+        {
+            text = text.Substring(CRYPTO_ATTRIBUTE_PREFIX.Length);
+        }
+
+        SrtpProtectionProfile? profile = null;
+        string? keyParams = null;
+        foreach (var token in text.Split((char[]?)null, StringSplitOptions.RemoveEmptyEntries))
+        {
+            if (profile == null && Enum.TryParse<SrtpProtectionProfile>(token, ignoreCase: false, out var parsed) && !int.TryParse(token, out _))
+            {
+                profile = parsed;
+            }
+            else if (token.StartsWith(INLINE_PREFIX, StringComparison.Ordinal))
+            {
+                // Several key parameters are only used together with MKIs, the first one is the active key.
+                keyParams ??= token.Substring(INLINE_PREFIX.Length).Split(';')[0];
+            }
+            else if (profile != null && keyParams != null)
+            {
+                throw new NotSupportedException($"SRTP session parameter {token} is not supported.");
+            }
+        }
+
+        if (profile == null || keyParams == null)
+        {
+            throw new FormatException($"Not an SRTP crypto attribute: {cryptoAttribute}");
+        }
+
+        var parts = keyParams.Split('|');
+        if (parts.Length > 2 || (parts.Length == 2 && parts[1].Contains(':')))
+        {
+            throw new NotSupportedException("SRTP master key identifiers (MKI) are not supported.");
+        }
+
+        var keyAndSalt = Convert.FromBase64String(parts[0]);
+        var (keyLength, saltLength) = GetMasterKeyLengths(profile.Value);
+        if (keyAndSalt.Length != keyLength + saltLength)
+        {
+            throw new FormatException($"{profile} requires {keyLength + saltLength} bytes of key and salt, the inline key has {keyAndSalt.Length}.");
+        }
+
+        return new SrtpPolicy(profile.Value, keyAndSalt[..keyLength], keyAndSalt[keyLength..]);
+    }
+
+    /// <summary>
+    /// Reads the first crypto attribute of a key file; empty lines and lines starting with # are skipped.
+    /// </summary>
+    public static SrtpPolicy FromFile(string path)
+    {
+        foreach (var line in File.ReadLines(path))
+        {
+            var trimmed = line.Trim();
+            if (trimmed.Length > 0 && !trimmed.StartsWith('#'))
+            {
+                return Parse(trimmed);
+            }
+        }
+
+        throw new FormatException($"{path} contains no SRTP crypto attribute.");
+    }
+
+    private static (int KeyLength, int SaltLength) GetMasterKeyLengths(SrtpProtectionProfile profile) => profile switch
+    {
+        SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_80 or SrtpProtectionProfile.AES_CM_128_HMAC_SHA1_32 => (16, 14),
+        SrtpProtectionProfile.AES_256_CM_HMAC_SHA1_80 or SrtpProtectionProfile.AES_256_CM_HMAC_SHA1_32 => (32, 14),
+        SrtpProtectionProfile.AEAD_AES_128_GCM => (16, 12),
+        SrtpProtectionProfile.AEAD_AES_256_GCM => (32, 12),
+        _ => throw new ArgumentOutOfRangeException(nameof(profile)),
+    };
+}
@@ -0,0 +1,14 @@
+namespace SharpVideo.Srtp;
+
+/// <summary>
+/// SRTP crypto suites, named as in SDES crypto attributes (RFC 4568, RFC 6188, RFC 7714).
+/// </summary>
+public enum SrtpProtectionProfile
+{
+    AES_CM_128_HMAC_SHA1_80,
+    AES_CM_128_HMAC_SHA1_32,
+    AES_256_CM_HMAC_SHA1_80,
+    AES_256_CM_HMAC_SHA1_32,
+    AEAD_AES_128_GCM,
+    AEAD_AES_256_GCM
+}
@@ -0,0 +1,176 @@
+using System.Buffers.Binary;
+
+namespace SharpVideo.Srtp;
+
+/// <summary>
+/// Removes SRTP protection from the packets of one socket: rollover counter tracking, replay protection and
+/// in-place decryption per SSRC.
+/// </summary>
+/// <remarks>
+/// Only used by the receive thread of the socket. A source is only tracked once one of its packets authenticated,
+/// so spoofed packets cannot fill the source table. The rollover counter of a new source starts at 0, which holds
+/// for senders that start encrypting with the session (there is no in-band way to learn a later ROC with SDES).
+/// </remarks>
+public sealed class SrtpReceiveContext : IDisposable
+{
+    private const int RTP_HEADER_LENGTH = 12;
+    private const int MAX_SOURCES = 256;
+    private const long SOURCE_TIMEOUT_MS = 60_000;
+
+    private sealed class SourceState
+    {
+        public uint Roc;
+        public ushort HighestSequence;
+        public SrtpReplayWindow ReplayWindow;
+        public long LastPacketTicks;
+    }
+
+    private readonly SrtpCipher _cipher;
+    private readonly Dictionary<uint, SourceState> _sources = new();
+    private SourceState? _lastSource;
+    private uint _lastSsrc;
+    private int _authenticationFailures;
+    private int _replayedPackets;
+
+    public SrtpReceiveContext(SrtpPolicy policy)
+    {
+        _cipher = new SrtpCipher(policy, isRtcp: false);
+    }
+
+    /// <summary>
+    /// Number of packets dropped because their authentication tag did not match.
+    /// </summary>
+    public int AuthenticationFailures => Volatile.Read(ref _authenticationFailures);
+
+    /// <summary>
+    /// Number of packets dropped because they were received before.
+    /// </summary>
+    public int ReplayedPackets => Volatile.Read(ref _replayedPackets);
+
+    /// <summary>
+    /// Authenticates and decrypts an SRTP packet in place.
+    /// </summary>
+    /// <param name="packet">The SRTP packet.</param>
+    /// <param name="length">Length of the plain RTP packet at the start of <paramref name="packet"/>.</param>
+    /// <returns>False if the packet is malformed, not authentic or a replay.</returns>
+    public bool TryUnprotect(Span<byte> packet, out int length)
+    {
+        length = 0;
+        int headerLength = GetHeaderLength(packet);
+        if (headerLength < 0 || packet.Length < headerLength + _cipher.TagLength)
+        {
+            Interlocked.Increment(ref _authenticationFailures);
+            return false;
+        }
+
+        uint ssrc = BinaryPrimitives.ReadUInt32BigEndian(packet.Slice(8));
+        ushort sequence = BinaryPrimitives.ReadUInt16BigEndian(packet.Slice(2));
+
+        var source = _lastSource != null && _lastSsrc == ssrc ? _lastSource : _sources.GetValueOrDefault(ssrc);
+        uint roc = source == null ? 0 : EstimateRoc(source, sequence);
+        ulong index = ((ulong)roc << 16) | sequence;
+
+        if (source != null && source.ReplayWindow.IsReplay(index))
+        {
+            Interlocked.Increment(ref _replayedPackets);
+            return false;
+        }
+
+        if (!_cipher.TryUnprotectRtp(packet, headerLength, ssrc, index, out length))
+        {
+            Interlocked.Increment(ref _authenticationFailures);
+            return false;
+        }
+
+        if (source == null)
+        {
+            source = AddSource(ssrc);
+            source.Roc = roc;
+            source.HighestSequence = sequence;
+        }
+        else if (roc > source.Roc)
+        {
+            source.Roc = roc;
+            source.HighestSequence = sequence;
+        }
+        else if (roc == source.Roc && (short)(sequence - source.HighestSequence) > 0)
+        {
+            source.HighestSequence = sequence;
+        }
+
+        source.ReplayWindow.Update(index);
+        source.LastPacketTicks = Environment.TickCount64;
+        _lastSource = source;
+        _lastSsrc = ssrc;
+        return true;
+    }
+
+    /// <summary>
+    /// Guesses the rollover counter of a packet from the highest sequence number seen (RFC 3711 Appendix A).
+    /// </summary>
+    private static uint EstimateRoc(SourceState source, ushort sequence)
+    {
+        ushort highest = source.HighestSequence;
+        if (highest < 0x8000)
+        {
+            return sequence - highest > 0x8000 && source.Roc > 0 ? source.Roc - 1 : source.Roc;
+        }
+
+        return highest - 0x8000 > sequence ? source.Roc + 1 : source.Roc;
+    }
+
+    private SourceState AddSource(uint ssrc)
+    {
+        if (_sources.Count >= MAX_SOURCES)
+        {
+            long now = Environment.TickCount64;
+            foreach (var (staleSsrc, stale) in _sources)
+            {
+                if (now - stale.LastPacketTicks > SOURCE_TIMEOUT_MS)
+                {
+                    _sources.Remove(staleSsrc);
+                }
+            }
+
+            if (_sources.Count >= MAX_SOURCES)
+            {
+                // Forget the least recently active source, it restarts with a fresh replay window if it comes back.
+                var oldest = _sources.MinBy(pair => pair.Value.LastPacketTicks);
+                _sources.Remove(oldest.Key);
+            }
+        }
+
+        var source = new SourceState();
+        _sources[ssrc] = source;
+        return source;
+    }
+
+    /// <summary>
+    /// Length of the RTP header including CSRCs and header extension, or -1 if the packet is too short.
+    /// </summary>
+    private static int GetHeaderLength(ReadOnlySpan<byte> packet)
+    {
+        if (packet.Length < RTP_HEADER_LENGTH)
+        {
+            return -1;
+        }
+
+        int length = RTP_HEADER_LENGTH + 4 * (packet[0] & 0x0F);
+        if ((packet[0] & 0x10) != 0)
+        {
+            if (packet.Length < length + 4)
+            {
+                return -1;
+            }
+
+            length += 4 + 4 * BinaryPrimitives.ReadUInt16BigEndian(packet.Slice(length + 2));
+        }
+
+        return length <= packet.Length ? length : -1;
+    }
+
+    public void Dispose()
+    {
+        _cipher.Dispose();
+    }
+}
@@ -0,0 +1,87 @@
+namespace SharpVideo.Srtp;
+
+/// <summary>
+/// Sliding replay list of the last <see cref="SIZE"/> packet indices of a source (RFC 3711 3.3.2).
+/// </summary>
+/// <remarks>
+/// Bit n of the window is set if index <c>highest - n</c> was received. Indices further back than the window are
+/// treated as replays. Only update the window after the packet was authenticated.
+/// </remarks>
+public struct SrtpReplayWindow
+{
+    public const int SIZE = 128;
+
+    private ulong _highest;
+    private ulong _low;
+    private ulong _high;
+    private bool _isInitialised;
+
+    /// <summary>
+    /// The highest index received so far.
+    /// </summary>
+    public ulong Highest => _highest;
+
+    public bool IsReplay(ulong index)
+    {
+        if (!_isInitialised || index > _highest)
+        {
+            return false;
+        }
+
+        ulong delta = _highest - index;
+        if (delta >= SIZE)
+        {
+            return true;
+        }
+
+        return delta < 64
+            ? (_low & (1UL << (int)delta)) != 0
+            : (_high & (1UL << (int)(delta - 64))) != 0;
+    }
+
+    public void Update(ulong index)
+    {
+        if (!_isInitialised)
+        {
+            _isInitialised = true;
+            _highest = index;
+            _low = 1;
+            _high = 0;
+            return;
+        }
+
+        if (index > _highest)
+        {
+            ulong shift = index - _highest;
+            if (shift >= SIZE)
+            {
+                _low = 0;
+                _high = 0;
+            }
+            else if (shift >= 64)
+            {
+                _high = _low << (int)(shift - 64);
+                _low = 0;
+            }
+            else
+            {
+                _high = (_high << (int)shift) | (_low >> (int)(64 - shift));
+                _low <<= (int)shift;
+            }
+
+            _highest = index;
+            _low |= 1;
+            return;
+        }
+
+        ulong delta = _highest - index;
+        if (delta < 64)
+        {
+            _low |= 1UL << (int)delta;
+        }
+        else if (delta < SIZE)
+        {
+            _high |= 1UL << (int)(delta - 64);
+        }
+    }
+}